@@ -0,0 +1,127 @@
+#include <bench.h>
+#include <arraylist.h>
+#include <common.h>
+#include <stdlib.h>
+
+typedef struct Bench_ctx
+{
+    Arraylist   *alist;
+    int         *keys; /* random permutation of [0, n) */
+    size_t      n;
+} Bench_ctx;
+
+static void alist_create(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    ctx->alist = arraylist_create(sizeof(int), NULL);
+}
+
+static void alist_create_full(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+
+    alist_create(arg);
+    for (i = 0; i < ctx->n; ++i)
+        (void)arraylist_insert_last(ctx->alist, &ctx->keys[i]);
+}
+
+static void alist_destroy(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    arraylist_destroy(ctx->alist);
+    ctx->alist = NULL;
+}
+
+static void bench_insert_first(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+
+    for (i = 0; i < ctx->n; ++i)
+        (void)arraylist_insert_first(ctx->alist, &ctx->keys[i]);
+}
+
+static void bench_insert_last(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+
+    for (i = 0; i < ctx->n; ++i)
+        (void)arraylist_insert_last(ctx->alist, &ctx->keys[i]);
+}
+
+static void bench_get_pos(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+    int val;
+
+    /* keys are a permutation, so they are also random positions */
+    for (i = 0; i < ctx->n; ++i)
+    {
+        (void)arraylist_get_pos(ctx->alist, (size_t)ctx->keys[i], &val);
+        BENCH_KEEP(val);
+    }
+}
+
+static void bench_delete_first(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+
+    for (i = 0; i < ctx->n; ++i)
+        (void)arraylist_delete_first(ctx->alist);
+}
+
+static void bench_delete_last(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+
+    for (i = 0; i < ctx->n; ++i)
+        (void)arraylist_delete_last(ctx->alist);
+}
+
+static void bench_iterate(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    long sum = 0;
+    int val;
+
+    for_each_data(ctx->alist, Arraylist, val)
+        sum += val;
+
+    BENCH_KEEP(sum);
+}
+
+int main(void)
+{
+    Bench_ctx ctx = {0};
+
+    BENCH_INIT("ARRAYLIST");
+
+    ctx.n = BENCH_GET_SIZE(BIT(12));
+    ctx.keys = (int *)malloc(ctx.n * sizeof(int));
+    if (ctx.keys == NULL)
+        return 1;
+
+    bench_keys_permutation(ctx.keys, ctx.n);
+
+    BENCH("insert_first", ctx.n, alist_create, bench_insert_first, alist_destroy, &ctx);
+    BENCH("insert_last", ctx.n, alist_create, bench_insert_last, alist_destroy, &ctx);
+    BENCH("delete_first", ctx.n, alist_create_full, bench_delete_first, alist_destroy, &ctx);
+    BENCH("delete_last", ctx.n, alist_create_full, bench_delete_last, alist_destroy, &ctx);
+
+    /* read only benchmarks share one list, get_pos is O(n) */
+    alist_create_full(&ctx);
+    BENCH("get_pos", ctx.n, NULL, bench_get_pos, NULL, &ctx);
+    BENCH("iterate", ctx.n, NULL, bench_iterate, NULL, &ctx);
+    alist_destroy(&ctx);
+
+    FREE(ctx.keys);
+
+    BENCH_SUMMARY();
+}
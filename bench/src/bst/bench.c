@@ -0,0 +1,108 @@
+#include <bench.h>
+#include <bst.h>
+#include <common.h>
+#include <stdlib.h>
+
+CMP(int)
+
+typedef struct Bench_ctx
+{
+    Bst     *tree;
+    int     *keys; /* random permutation of [0, n) */
+    size_t  n;
+} Bench_ctx;
+
+static void tree_prepare(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    ctx->tree = bst_create(sizeof(int), cmp_int, NULL);
+}
+
+static void tree_prepare_full(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+
+    tree_prepare(arg);
+    for (i = 0; i < ctx->n; ++i)
+        (void)bst_insert(ctx->tree, &ctx->keys[i]);
+}
+
+static void tree_free(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    bst_destroy(ctx->tree);
+    ctx->tree = NULL;
+}
+
+static void bench_insert(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+
+    for (i = 0; i < ctx->n; ++i)
+        (void)bst_insert(ctx->tree, &ctx->keys[i]);
+}
+
+static void bench_search(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+    int val;
+
+    for (i = 0; i < ctx->n; ++i)
+    {
+        (void)bst_search(ctx->tree, &ctx->keys[i], &val);
+        BENCH_KEEP(val);
+    }
+}
+
+static void bench_delete(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+
+    for (i = 0; i < ctx->n; ++i)
+        (void)bst_delete(ctx->tree, &ctx->keys[i]);
+}
+
+static void bench_iterate(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    long sum = 0;
+    int val;
+
+    for_each_data(ctx->tree, Bst, val)
+        sum += val;
+
+    BENCH_KEEP(sum);
+}
+
+int main(void)
+{
+    Bench_ctx ctx = {0};
+
+    BENCH_INIT("BST");
+
+    ctx.n = BENCH_GET_SIZE(BIT(16));
+    ctx.keys = (int *)malloc(ctx.n * sizeof(int));
+    if (ctx.keys == NULL)
+        return 1;
+
+    bench_keys_permutation(ctx.keys, ctx.n);
+
+    BENCH("insert", ctx.n, tree_prepare, bench_insert, tree_free, &ctx);
+    BENCH("delete", ctx.n, tree_prepare_full, bench_delete, tree_free, &ctx);
+
+    /* read only benchmarks share one tree */
+    tree_prepare_full(&ctx);
+    BENCH("search", ctx.n, NULL, bench_search, NULL, &ctx);
+    BENCH("iterate", ctx.n, NULL, bench_iterate, NULL, &ctx);
+    tree_free(&ctx);
+
+    FREE(ctx.keys);
+
+    BENCH_SUMMARY();
+}
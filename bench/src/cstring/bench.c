@@ -0,0 +1,105 @@
+#include <bench.h>
+#include <cstring.h>
+#include <common.h>
+#include <stdlib.h>
+
+#define WORDS_IN_TEXT   BIT(16)
+
+typedef struct Bench_ctx
+{
+    String      *string;
+    char        *text;
+    const char  *pattern;
+    const char  *replacement;
+} Bench_ctx;
+
+static const char *words[] = {"Kukos ", "is ", "a ", "C ", "Master ", "and ", "loves ", "macros "};
+
+static char *text_create(size_t num_words)
+{
+    char *text;
+    size_t len = 0;
+    size_t i;
+    size_t wlen;
+    const char *word;
+
+    text = (char *)malloc(num_words * 8 + 1);
+    if (text == NULL)
+        return NULL;
+
+    for (i = 0; i < num_words; ++i)
+    {
+        word = words[(size_t)rand() % ARRAY_SIZE(words)];
+        wlen = strlen(word);
+        (void)memcpy(text + len, word, wlen);
+        len += wlen;
+    }
+
+    text[len] = '\0';
+
+    return text;
+}
+
+static void string_prepare(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    ctx->string = string_create_from_str(ctx->text);
+}
+
+static void string_free(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    string_destroy(ctx->string);
+    ctx->string = NULL;
+}
+
+static void bench_replace_all(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    (void)string_replace_str_by_str_all(ctx->string, ctx->pattern, ctx->replacement);
+}
+
+static void bench_replace_multi_all(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    const char *patterns[] = {"Kukos", "Master", "macros"};
+    const char *replacements[] = {"Michal", "Guru", "templates"};
+
+    (void)string_replace_multi_all(ctx->string, patterns, replacements, ARRAY_SIZE(patterns));
+}
+
+int main(void)
+{
+    Bench_ctx ctx = {0};
+    size_t len;
+
+    BENCH_INIT("CSTRING");
+
+    ctx.text = text_create(BENCH_GET_SIZE(WORDS_IN_TEXT));
+    if (ctx.text == NULL)
+        return 1;
+
+    /* ops = bytes of text */
+    len = strlen(ctx.text);
+
+    ctx.pattern = "C ";
+    ctx.replacement = "C99 ";
+    BENCH("replace_all_many_matches", len, string_prepare, bench_replace_all, string_free, &ctx);
+
+    ctx.pattern = "Kukos";
+    ctx.replacement = "K";
+    BENCH("replace_all_shrink", len, string_prepare, bench_replace_all, string_free, &ctx);
+
+    ctx.pattern = "Rust";
+    ctx.replacement = "C";
+    BENCH("replace_all_no_match", len, string_prepare, bench_replace_all, string_free, &ctx);
+
+    BENCH("replace_multi_all", len, string_prepare, bench_replace_multi_all, string_free, &ctx);
+
+    FREE(ctx.text);
+
+    BENCH_SUMMARY();
+}
@@ -0,0 +1,150 @@
+#include <bench.h>
+#include <darray.h>
+#include <common.h>
+#include <stdlib.h>
+
+CMP(int)
+
+typedef struct Bench_ctx
+{
+    Darray  *darray;
+    int     *keys; /* random permutation of [0, n) */
+    ssize_t *pos;  /* output of batch search */
+    size_t  n;
+} Bench_ctx;
+
+static void darray_create_unsorted(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    ctx->darray = darray_create(DARRAY_UNSORTED, 0, sizeof(int), cmp_int, NULL);
+}
+
+static void darray_create_sorted(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    ctx->darray = darray_create(DARRAY_SORTED, 0, sizeof(int), cmp_int, NULL);
+}
+
+static void darray_create_full(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+
+    darray_create_sorted(arg);
+    for (i = 0; i < ctx->n; ++i)
+        (void)darray_insert(ctx->darray, &ctx->keys[i]);
+}
+
+static void darray_create_unsorted_full(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+
+    darray_create_unsorted(arg);
+    for (i = 0; i < ctx->n; ++i)
+        (void)darray_insert(ctx->darray, &ctx->keys[i]);
+}
+
+static void darray_free(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    darray_destroy(ctx->darray);
+    ctx->darray = NULL;
+}
+
+static void bench_insert(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+
+    for (i = 0; i < ctx->n; ++i)
+        (void)darray_insert(ctx->darray, &ctx->keys[i]);
+}
+
+static void bench_search(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+    int val;
+
+    for (i = 0; i < ctx->n; ++i)
+    {
+        (void)darray_search_first(ctx->darray, &ctx->keys[i], &val);
+        BENCH_KEEP(val);
+    }
+}
+
+static void bench_search_batch(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    BENCH_KEEP(darray_search_batch(ctx->darray, ctx->keys, ctx->n, ctx->pos));
+}
+
+static void bench_delete(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+
+    for (i = 0; i < ctx->n; ++i)
+        (void)darray_delete(ctx->darray);
+}
+
+static void bench_sort(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    (void)darray_sort(ctx->darray);
+}
+
+static void bench_iterate(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    long sum = 0;
+    int val;
+
+    for_each_data(ctx->darray, Darray, val)
+        sum += val;
+
+    BENCH_KEEP(sum);
+}
+
+int main(void)
+{
+    Bench_ctx ctx = {0};
+
+    BENCH_INIT("DARRAY");
+
+    ctx.n = BENCH_GET_SIZE(BIT(14));
+    ctx.keys = (int *)malloc(ctx.n * sizeof(int));
+    ctx.pos = (ssize_t *)malloc(ctx.n * sizeof(ssize_t));
+    if (ctx.keys == NULL || ctx.pos == NULL)
+    {
+        FREE(ctx.keys);
+        FREE(ctx.pos);
+        return 1;
+    }
+
+    bench_keys_permutation(ctx.keys, ctx.n);
+
+    BENCH("insert", ctx.n, darray_create_unsorted, bench_insert, darray_free, &ctx);
+    BENCH("insert_sorted", ctx.n, darray_create_sorted, bench_insert, darray_free, &ctx);
+    BENCH("delete", ctx.n, darray_create_full, bench_delete, darray_free, &ctx);
+
+    BENCH("sort", ctx.n, darray_create_unsorted_full, bench_sort, darray_free, &ctx);
+
+    /* read only benchmarks share one sorted array */
+    darray_create_full(&ctx);
+    BENCH("search", ctx.n, NULL, bench_search, NULL, &ctx);
+    BENCH("search_batch", ctx.n, NULL, bench_search_batch, NULL, &ctx);
+    BENCH("iterate", ctx.n, NULL, bench_iterate, NULL, &ctx);
+    darray_free(&ctx);
+
+    FREE(ctx.keys);
+    FREE(ctx.pos);
+
+    BENCH_SUMMARY();
+}
@@ -0,0 +1,124 @@
+#include <bench.h>
+#include <fifo.h>
+#include <common.h>
+#include <stdlib.h>
+
+#define STEADY_ENTRIES  BIT(10)
+
+typedef struct Bench_ctx
+{
+    Fifo    *fifo;
+    size_t  n;
+} Bench_ctx;
+
+static void fifo_prepare(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    ctx->fifo = fifo_create(sizeof(int), NULL);
+}
+
+static void fifo_prepare_full(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+    int val;
+
+    fifo_prepare(arg);
+    for (i = 0; i < ctx->n; ++i)
+    {
+        val = (int)i;
+        (void)fifo_enqueue(ctx->fifo, &val);
+    }
+}
+
+static void fifo_prepare_steady(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+    int val;
+
+    fifo_prepare(arg);
+    for (i = 0; i < STEADY_ENTRIES; ++i)
+    {
+        val = (int)i;
+        (void)fifo_enqueue(ctx->fifo, &val);
+    }
+}
+
+static void fifo_free(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    fifo_destroy(ctx->fifo);
+    ctx->fifo = NULL;
+}
+
+static void bench_enqueue(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+    int val;
+
+    for (i = 0; i < ctx->n; ++i)
+    {
+        val = (int)i;
+        (void)fifo_enqueue(ctx->fifo, &val);
+    }
+}
+
+static void bench_dequeue(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+    int val;
+
+    for (i = 0; i < ctx->n; ++i)
+    {
+        (void)fifo_dequeue(ctx->fifo, &val);
+        BENCH_KEEP(val);
+    }
+}
+
+/* queue with constant number of entries, typical producer - consumer usage */
+static void bench_enqueue_dequeue(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+    int val;
+
+    for (i = 0; i < ctx->n; ++i)
+    {
+        (void)fifo_dequeue(ctx->fifo, &val);
+        (void)fifo_enqueue(ctx->fifo, &val);
+    }
+}
+
+static void bench_to_array(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    int *array;
+    size_t size;
+
+    if (fifo_to_array(ctx->fifo, (void *)&array, &size))
+        return;
+
+    BENCH_KEEP(array[size - 1]);
+    FREE(array);
+}
+
+int main(void)
+{
+    Bench_ctx ctx = {0};
+
+    BENCH_INIT("FIFO");
+
+    ctx.n = BENCH_GET_SIZE(BIT(16));
+
+    BENCH("enqueue", ctx.n, fifo_prepare, bench_enqueue, fifo_free, &ctx);
+    BENCH("dequeue", ctx.n, fifo_prepare_full, bench_dequeue, fifo_free, &ctx);
+    BENCH("enqueue_dequeue", ctx.n, fifo_prepare_steady, bench_enqueue_dequeue, fifo_free, &ctx);
+    BENCH("to_array", ctx.n, fifo_prepare_full, bench_to_array, fifo_free, &ctx);
+
+    BENCH_SUMMARY();
+}
@@ -0,0 +1,94 @@
+#include <bench.h>
+#include <filebuffer.h>
+#include <common.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define RECORD_LEN  63
+
+typedef struct Bench_ctx
+{
+    File_buffer     *fb;
+    File_appender   *fa;
+    char            record[RECORD_LEN + 1];
+    int             fd;
+    size_t          n;
+} Bench_ctx;
+
+static void fb_prepare(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    (void)ftruncate(ctx->fd, 0);
+    ctx->fb = file_buffer_create(ctx->fd, PROT_READ | PROT_WRITE);
+}
+
+static void fb_free(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    (void)file_buffer_destroy(ctx->fb);
+    ctx->fb = NULL;
+}
+
+static void fa_prepare(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    (void)ftruncate(ctx->fd, 0);
+    ctx->fa = file_appender_create(ctx->fd, 0);
+}
+
+static void fa_free(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    (void)file_appender_destroy(ctx->fa);
+    ctx->fa = NULL;
+}
+
+/* remap on each append */
+static void bench_file_buffer_append(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+
+    for (i = 0; i < ctx->n; ++i)
+        (void)file_buffer_append(ctx->fb, ctx->record);
+}
+
+/* file grows by extents */
+static void bench_file_appender_append(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+
+    for (i = 0; i < ctx->n; ++i)
+        (void)file_appender_append(ctx->fa, ctx->record, RECORD_LEN);
+}
+
+int main(void)
+{
+    Bench_ctx ctx = {0};
+    char path[] = "/tmp/bench_filebuffer_XXXXXX";
+
+    BENCH_INIT("FILEBUFFER");
+
+    ctx.n = BENCH_GET_SIZE(BIT(14));
+    (void)memset(ctx.record, 'K', RECORD_LEN);
+    ctx.record[RECORD_LEN - 1] = '\n';
+
+    ctx.fd = mkstemp(path);
+    if (ctx.fd == -1)
+        return 1;
+
+    (void)unlink(path);
+
+    BENCH("file_buffer_append", ctx.n, fb_prepare, bench_file_buffer_append, fb_free, &ctx);
+    BENCH("file_appender_append", ctx.n, fa_prepare, bench_file_appender_append, fa_free, &ctx);
+
+    close(ctx.fd);
+
+    BENCH_SUMMARY();
+}
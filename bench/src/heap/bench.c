@@ -0,0 +1,110 @@
+#include <bench.h>
+#include <heap.h>
+#include <common.h>
+#include <stdlib.h>
+
+CMP(int)
+
+typedef struct Bench_ctx
+{
+    Heap        *heap;
+    Heap_entry  **entries;
+    int         *keys; /* random permutation of [0, n) */
+    size_t      n;
+} Bench_ctx;
+
+static void heap_prepare(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+
+    ctx->heap = heap_create(HEAP_MIN, sizeof(int), 2, cmp_int, NULL);
+    for (i = 0; i < ctx->n; ++i)
+        ctx->entries[i] = heap_entry_create(&ctx->keys[i], sizeof(int));
+}
+
+static void heap_prepare_full(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    heap_prepare(arg);
+    (void)heap_build(ctx->heap, ctx->entries, ctx->n);
+}
+
+static void heap_free(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    /* entries which are still in heap */
+    heap_destroy(ctx->heap);
+    ctx->heap = NULL;
+}
+
+static void bench_insert(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+
+    for (i = 0; i < ctx->n; ++i)
+        (void)heap_insert(ctx->heap, ctx->entries[i]);
+}
+
+static void bench_build(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    (void)heap_build(ctx->heap, ctx->entries, ctx->n);
+}
+
+static void bench_extract_top(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+
+    for (i = 0; i < ctx->n; ++i)
+        heap_entry_destroy(heap_extract_top(ctx->heap));
+}
+
+static void bench_change_key(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+    int key;
+
+    /* keys are a permutation, so they are also random indexes, new key is less than every key in heap */
+    for (i = 0; i < ctx->n; ++i)
+    {
+        key = -(int)i - 1;
+        (void)heap_change_key(ctx->heap, (size_t)ctx->keys[i], &key);
+    }
+}
+
+int main(void)
+{
+    Bench_ctx ctx = {0};
+
+    BENCH_INIT("HEAP");
+
+    ctx.n = BENCH_GET_SIZE(BIT(16));
+    ctx.keys = (int *)malloc(ctx.n * sizeof(int));
+    ctx.entries = (Heap_entry **)malloc(ctx.n * sizeof(Heap_entry *));
+    if (ctx.keys == NULL || ctx.entries == NULL)
+    {
+        FREE(ctx.keys);
+        FREE(ctx.entries);
+        return 1;
+    }
+
+    bench_keys_permutation(ctx.keys, ctx.n);
+
+    /* heap has no search and iterator, so build / change_key instead */
+    BENCH("insert", ctx.n, heap_prepare, bench_insert, heap_free, &ctx);
+    BENCH("build", ctx.n, heap_prepare, bench_build, heap_free, &ctx);
+    BENCH("extract_top", ctx.n, heap_prepare_full, bench_extract_top, heap_free, &ctx);
+    BENCH("change_key", ctx.n, heap_prepare_full, bench_change_key, heap_free, &ctx);
+
+    FREE(ctx.keys);
+    FREE(ctx.entries);
+
+    BENCH_SUMMARY();
+}
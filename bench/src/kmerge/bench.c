@@ -0,0 +1,107 @@
+#include <bench.h>
+#include <kmerge.h>
+#include <sort.h>
+#include <common.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_K 256
+
+CMP(int)
+
+typedef struct Bench_ctx
+{
+    int         *keys;      /* k sorted parts of n / k keys */
+    int         *out;
+    const int   *arrays[MAX_K];
+    size_t      num_elements[MAX_K];
+    size_t      n;
+    size_t      k;
+} Bench_ctx;
+
+static void bench_set_k(Bench_ctx *ctx, size_t k)
+{
+    size_t i;
+
+    ctx->k = k;
+    for (i = 0; i < k; ++i)
+    {
+        ctx->arrays[i] = ctx->keys + i * (ctx->n / k);
+        ctx->num_elements[i] = ctx->n / k;
+        (void)sort((void *)ctx->arrays[i], ctx->num_elements[i], cmp_int, sizeof(int));
+    }
+}
+
+static void out_prepare(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+
+    /* concatenation of sorted parts */
+    for (i = 0; i < ctx->k; ++i)
+        (void)memcpy(ctx->out + i * (ctx->n / ctx->k), ctx->arrays[i], ctx->num_elements[i] * sizeof(int));
+}
+
+static void bench_kmerge(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    (void)kmerge((void *)ctx->out, (const void * const *)ctx->arrays, ctx->num_elements, ctx->k, cmp_int, sizeof(int));
+    BENCH_KEEP(ctx->out[0]);
+}
+
+static void bench_kmerge_int(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    (void)kmerge_int(ctx->out, ctx->arrays, ctx->num_elements, ctx->k);
+    BENCH_KEEP(ctx->out[0]);
+}
+
+static void bench_sort(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    (void)sort((void *)ctx->out, ctx->n / ctx->k * ctx->k, cmp_int, sizeof(int));
+}
+
+int main(void)
+{
+    Bench_ctx ctx = {0};
+    size_t i;
+
+    BENCH_INIT("KMERGE");
+
+    ctx.n = BENCH_GET_SIZE(BIT(20));
+    ctx.keys = (int *)malloc(ctx.n * sizeof(int));
+    ctx.out = (int *)malloc(ctx.n * sizeof(int));
+    if (ctx.keys == NULL || ctx.out == NULL)
+    {
+        FREE(ctx.keys);
+        FREE(ctx.out);
+        return 1;
+    }
+
+    for (i = 0; i < ctx.n; ++i)
+        ctx.keys[i] = rand();
+
+    bench_set_k(&ctx, 2);
+    BENCH("kmerge_k2", ctx.n, NULL, bench_kmerge, NULL, &ctx);
+    BENCH("kmerge_int_k2", ctx.n, NULL, bench_kmerge_int, NULL, &ctx);
+
+    bench_set_k(&ctx, 16);
+    BENCH("kmerge_k16", ctx.n, NULL, bench_kmerge, NULL, &ctx);
+    BENCH("kmerge_int_k16", ctx.n, NULL, bench_kmerge_int, NULL, &ctx);
+
+    bench_set_k(&ctx, MAX_K);
+    BENCH("kmerge_k256", ctx.n, NULL, bench_kmerge, NULL, &ctx);
+    BENCH("kmerge_int_k256", ctx.n, NULL, bench_kmerge_int, NULL, &ctx);
+
+    /* what we did before: sort concatenation of parts */
+    BENCH("sort_concat_k256", ctx.n, out_prepare, bench_sort, NULL, &ctx);
+
+    FREE(ctx.keys);
+    FREE(ctx.out);
+
+    BENCH_SUMMARY();
+}
@@ -0,0 +1,108 @@
+#include <bench.h>
+#include <list.h>
+#include <common.h>
+#include <stdlib.h>
+
+CMP(int)
+
+typedef struct Bench_ctx
+{
+    List    *list;
+    int     *keys; /* random permutation of [0, n) */
+    size_t  n;
+} Bench_ctx;
+
+static void list_prepare(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    ctx->list = list_create(sizeof(int), cmp_int, NULL);
+}
+
+static void list_prepare_full(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+
+    list_prepare(arg);
+    for (i = 0; i < ctx->n; ++i)
+        (void)list_insert(ctx->list, &ctx->keys[i]);
+}
+
+static void list_free(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    list_destroy(ctx->list);
+    ctx->list = NULL;
+}
+
+static void bench_insert(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+
+    for (i = 0; i < ctx->n; ++i)
+        (void)list_insert(ctx->list, &ctx->keys[i]);
+}
+
+static void bench_search(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+    int val;
+
+    for (i = 0; i < ctx->n; ++i)
+    {
+        (void)list_search(ctx->list, &ctx->keys[i], &val);
+        BENCH_KEEP(val);
+    }
+}
+
+static void bench_delete(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+
+    for (i = 0; i < ctx->n; ++i)
+        (void)list_delete(ctx->list, &ctx->keys[i]);
+}
+
+static void bench_iterate(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    long sum = 0;
+    int val;
+
+    for_each_data(ctx->list, List, val)
+        sum += val;
+
+    BENCH_KEEP(sum);
+}
+
+int main(void)
+{
+    Bench_ctx ctx = {0};
+
+    BENCH_INIT("LIST");
+
+    ctx.n = BENCH_GET_SIZE(BIT(12));
+    ctx.keys = (int *)malloc(ctx.n * sizeof(int));
+    if (ctx.keys == NULL)
+        return 1;
+
+    bench_keys_permutation(ctx.keys, ctx.n);
+
+    BENCH("insert", ctx.n, list_prepare, bench_insert, list_free, &ctx);
+    BENCH("delete", ctx.n, list_prepare_full, bench_delete, list_free, &ctx);
+
+    /* read only benchmarks share one list (sorted list, O(n) per operation) */
+    list_prepare_full(&ctx);
+    BENCH("search", ctx.n, NULL, bench_search, NULL, &ctx);
+    BENCH("iterate", ctx.n, NULL, bench_iterate, NULL, &ctx);
+    list_free(&ctx);
+
+    FREE(ctx.keys);
+
+    BENCH_SUMMARY();
+}
@@ -0,0 +1,109 @@
+#include <bench.h>
+#include <quantile.h>
+#include <common.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+typedef struct Bench_ctx
+{
+    uint64_t        *latencies; /* ns, long tail */
+    double          *values;
+    size_t          n;
+    Hdr_histogram   *h;
+    Tdigest         *td;
+} Bench_ctx;
+
+static void bench_hdr_record(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+
+    for (i = 0; i < ctx->n; ++i)
+        (void)hdr_histogram_record(ctx->h, ctx->latencies[i]);
+}
+
+static void bench_hdr_record_concurrent(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+
+    for (i = 0; i < ctx->n; ++i)
+        (void)hdr_histogram_record_concurrent(ctx->h, ctx->latencies[i]);
+}
+
+static void bench_hdr_quantile(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    BENCH_KEEP(hdr_histogram_get_quantile(ctx->h, 0.99));
+}
+
+static void tdigest_prepare(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    tdigest_reset(ctx->td);
+}
+
+static void bench_tdigest_add(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+
+    for (i = 0; i < ctx->n; ++i)
+        (void)tdigest_add(ctx->td, ctx->values[i]);
+}
+
+static void bench_tdigest_quantile(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    double value = 0.0;
+
+    (void)tdigest_get_quantile(ctx->td, 0.99, &value);
+    BENCH_KEEP(value);
+}
+
+int main(void)
+{
+    Bench_ctx ctx = {0};
+    size_t i;
+
+    BENCH_INIT("QUANTILE");
+
+    ctx.n = BENCH_GET_SIZE(BIT(20));
+    ctx.latencies = (uint64_t *)malloc(ctx.n * sizeof(uint64_t));
+    ctx.values = (double *)malloc(ctx.n * sizeof(double));
+    ctx.h = hdr_histogram_create(BIT(40), 8, 16);
+    ctx.td = tdigest_create(TDIGEST_DEFAULT_COMPRESSION);
+    if (ctx.latencies == NULL || ctx.values == NULL || ctx.h == NULL || ctx.td == NULL)
+    {
+        FREE(ctx.latencies);
+        FREE(ctx.values);
+        hdr_histogram_destroy(ctx.h);
+        tdigest_destroy(ctx.td);
+        return 1;
+    }
+
+    for (i = 0; i < ctx.n; ++i)
+    {
+        ctx.latencies[i] = (uint64_t)(1000 + rand() % 1000);
+        if (rand() % 100 == 0)
+            ctx.latencies[i] *= (uint64_t)(10 + rand() % 1000);
+
+        ctx.values[i] = (double)ctx.latencies[i];
+    }
+
+    BENCH("hdr_record", ctx.n, NULL, bench_hdr_record, NULL, &ctx);
+    BENCH("hdr_record_concurrent", ctx.n, NULL, bench_hdr_record_concurrent, NULL, &ctx);
+    BENCH("hdr_get_quantile", 1, NULL, bench_hdr_quantile, NULL, &ctx);
+
+    BENCH("tdigest_add", ctx.n, tdigest_prepare, bench_tdigest_add, NULL, &ctx);
+    BENCH("tdigest_get_quantile", 1, NULL, bench_tdigest_quantile, NULL, &ctx);
+
+    FREE(ctx.latencies);
+    FREE(ctx.values);
+    hdr_histogram_destroy(ctx.h);
+    tdigest_destroy(ctx.td);
+
+    BENCH_SUMMARY();
+}
@@ -0,0 +1,124 @@
+#include <bench.h>
+#include <ringbuffer.h>
+#include <common.h>
+#include <stdlib.h>
+
+#define STEADY_ENTRIES  BIT(10)
+
+typedef struct Bench_ctx
+{
+    Ring_buffer *rb;
+    size_t      n;
+} Bench_ctx;
+
+static void rb_prepare(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    ctx->rb = ring_buffer_create(sizeof(int), ctx->n, NULL);
+}
+
+static void rb_prepare_full(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+    int val;
+
+    rb_prepare(arg);
+    for (i = 0; i < ctx->n; ++i)
+    {
+        val = (int)i;
+        (void)ring_buffer_enqueue(ctx->rb, &val);
+    }
+}
+
+static void rb_prepare_steady(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+    int val;
+
+    rb_prepare(arg);
+    for (i = 0; i < STEADY_ENTRIES; ++i)
+    {
+        val = (int)i;
+        (void)ring_buffer_enqueue(ctx->rb, &val);
+    }
+}
+
+static void rb_free(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    ring_buffer_destroy(ctx->rb);
+    ctx->rb = NULL;
+}
+
+static void bench_enqueue(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+    int val;
+
+    for (i = 0; i < ctx->n; ++i)
+    {
+        val = (int)i;
+        (void)ring_buffer_enqueue(ctx->rb, &val);
+    }
+}
+
+static void bench_dequeue(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+    int val;
+
+    for (i = 0; i < ctx->n; ++i)
+    {
+        (void)ring_buffer_dequeue(ctx->rb, &val);
+        BENCH_KEEP(val);
+    }
+}
+
+/* buffer with constant number of entries, typical producer - consumer usage */
+static void bench_enqueue_dequeue(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+    int val;
+
+    for (i = 0; i < ctx->n; ++i)
+    {
+        (void)ring_buffer_dequeue(ctx->rb, &val);
+        (void)ring_buffer_enqueue(ctx->rb, &val);
+    }
+}
+
+static void bench_to_array(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    int *array;
+    size_t size;
+
+    if (ring_buffer_to_array(ctx->rb, (void *)&array, &size))
+        return;
+
+    BENCH_KEEP(array[size - 1]);
+    FREE(array);
+}
+
+int main(void)
+{
+    Bench_ctx ctx = {0};
+
+    BENCH_INIT("RINGBUFFER");
+
+    ctx.n = BENCH_GET_SIZE(BIT(16));
+
+    BENCH("enqueue", ctx.n, rb_prepare, bench_enqueue, rb_free, &ctx);
+    BENCH("dequeue", ctx.n, rb_prepare_full, bench_dequeue, rb_free, &ctx);
+    BENCH("enqueue_dequeue", ctx.n, rb_prepare_steady, bench_enqueue_dequeue, rb_free, &ctx);
+    BENCH("to_array", ctx.n, rb_prepare_full, bench_to_array, rb_free, &ctx);
+
+    BENCH_SUMMARY();
+}
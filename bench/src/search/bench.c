@@ -0,0 +1,116 @@
+#include <bench.h>
+#include <search.h>
+#include <common.h>
+#include <stdlib.h>
+
+#define NUM_KEYS    BIT(12)
+#define SMALL_LEN   64
+
+CMP(int)
+
+typedef struct Bench_ctx
+{
+    int         *sorted;    /* sorted IDs with gaps */
+    int         *eytzinger;
+    int         keys[NUM_KEYS];
+    int         small[SMALL_LEN];
+    size_t      n;
+} Bench_ctx;
+
+static void bench_find_first_sorted(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+
+    for (i = 0; i < NUM_KEYS; ++i)
+        BENCH_KEEP(find_first_sorted((void *)&ctx->keys[i], ctx->sorted, ctx->n, cmp_int, sizeof(int)));
+}
+
+static void bench_find_first_sorted_int(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+
+    for (i = 0; i < NUM_KEYS; ++i)
+        BENCH_KEEP(find_first_sorted_int(ctx->keys[i], ctx->sorted, ctx->n));
+}
+
+static void bench_find_first_interpolation_int(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+
+    for (i = 0; i < NUM_KEYS; ++i)
+        BENCH_KEEP(find_first_interpolation_int(ctx->keys[i], ctx->sorted, ctx->n));
+}
+
+static void bench_eytzinger_find_int(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+
+    for (i = 0; i < NUM_KEYS; ++i)
+        BENCH_KEEP(eytzinger_find_int(ctx->keys[i], ctx->eytzinger, ctx->n));
+}
+
+static void bench_find_first_unsorted(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+
+    for (i = 0; i < NUM_KEYS; ++i)
+        BENCH_KEEP(find_first_unsorted((void *)&ctx->keys[i], ctx->small, SMALL_LEN, cmp_int, sizeof(int)));
+}
+
+static void bench_find_first_unsorted_int(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+
+    for (i = 0; i < NUM_KEYS; ++i)
+        BENCH_KEEP(find_first_unsorted_int(ctx->keys[i], ctx->small, SMALL_LEN));
+}
+
+int main(void)
+{
+    static Bench_ctx ctx;
+    size_t i;
+
+    BENCH_INIT("SEARCH");
+
+    ctx.n = BENCH_GET_SIZE(BIT(22));
+    ctx.sorted = (int *)malloc(ctx.n * sizeof(int));
+    ctx.eytzinger = (int *)malloc(ctx.n * sizeof(int));
+    if (ctx.sorted == NULL || ctx.eytzinger == NULL)
+    {
+        FREE(ctx.sorted);
+        FREE(ctx.eytzinger);
+        return 1;
+    }
+
+    ctx.sorted[0] = 0;
+    for (i = 1; i < ctx.n; ++i)
+        ctx.sorted[i] = ctx.sorted[i - 1] + 1 + rand() % 8;
+
+    (void)eytzinger_build(ctx.sorted, ctx.n, sizeof(int), ctx.eytzinger);
+
+    /* half of keys exist */
+    for (i = 0; i < NUM_KEYS; ++i)
+        ctx.keys[i] = i & 1 ? ctx.sorted[(size_t)rand() % ctx.n] : rand() % ctx.sorted[ctx.n - 1];
+
+    for (i = 0; i < SMALL_LEN; ++i)
+        ctx.small[i] = ctx.keys[(size_t)rand() % NUM_KEYS];
+
+    BENCH("find_first_sorted", NUM_KEYS, NULL, bench_find_first_sorted, NULL, &ctx);
+    BENCH("find_first_sorted_int", NUM_KEYS, NULL, bench_find_first_sorted_int, NULL, &ctx);
+    BENCH("find_first_interpolation_int", NUM_KEYS, NULL, bench_find_first_interpolation_int, NULL, &ctx);
+    BENCH("eytzinger_find_int", NUM_KEYS, NULL, bench_eytzinger_find_int, NULL, &ctx);
+
+    BENCH("find_first_unsorted_64", NUM_KEYS, NULL, bench_find_first_unsorted, NULL, &ctx);
+    BENCH("find_first_unsorted_int_64", NUM_KEYS, NULL, bench_find_first_unsorted_int, NULL, &ctx);
+
+    FREE(ctx.sorted);
+    FREE(ctx.eytzinger);
+
+    BENCH_SUMMARY();
+}
@@ -0,0 +1,109 @@
+#include <bench.h>
+#include <selection.h>
+#include <sort.h>
+#include <common.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PERCENTILES 99
+
+CMP(double)
+
+typedef struct Bench_ctx
+{
+    double  *samples;   /* random latencies, source of every run */
+    double  *array;
+    size_t  ks[PERCENTILES];
+    size_t  n;
+} Bench_ctx;
+
+static void array_prepare(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    (void)memcpy(ctx->array, ctx->samples, ctx->n * sizeof(double));
+}
+
+static void bench_median(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    (void)select_kth_inplace((void *)ctx->array, ctx->n, sizeof(double), ctx->n >> 1, cmp_double);
+    BENCH_KEEP(ctx->array[ctx->n >> 1]);
+}
+
+static void bench_p99(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    (void)select_kth_inplace((void *)ctx->array, ctx->n, sizeof(double), ctx->ks[PERCENTILES - 1], cmp_double);
+    BENCH_KEEP(ctx->array[ctx->ks[PERCENTILES - 1]]);
+}
+
+static void bench_percentiles_multi(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    (void)select_multi_inplace((void *)ctx->array, ctx->n, sizeof(double), ctx->ks, PERCENTILES, cmp_double);
+    BENCH_KEEP(ctx->array[ctx->ks[0]]);
+}
+
+static void bench_percentiles_select_kth(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+
+    ssize_t index = 0;
+
+    /* like array_select_kth per percentile */
+    for (i = 0; i < PERCENTILES; ++i)
+        index = select_kth((void *)ctx->samples, ctx->n, sizeof(double), ctx->ks[i], cmp_double);
+
+    BENCH_KEEP(index);
+}
+
+static void bench_percentiles_sort(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    (void)sort((void *)ctx->array, ctx->n, cmp_double, sizeof(double));
+    BENCH_KEEP(ctx->array[ctx->ks[0]]);
+}
+
+int main(void)
+{
+    Bench_ctx ctx = {0};
+    size_t i;
+
+    BENCH_INIT("SELECTION");
+
+    ctx.n = BENCH_GET_SIZE(BIT(20));
+    ctx.samples = (double *)malloc(ctx.n * sizeof(double));
+    ctx.array = (double *)malloc(ctx.n * sizeof(double));
+    if (ctx.samples == NULL || ctx.array == NULL)
+    {
+        FREE(ctx.samples);
+        FREE(ctx.array);
+        return 1;
+    }
+
+    /* long tail like latencies */
+    for (i = 0; i < ctx.n; ++i)
+        ctx.samples[i] = (double)(rand() % 1000) * (rand() % 4 == 0 ? 10.0 : 1.0);
+
+    for (i = 0; i < PERCENTILES; ++i)
+        ctx.ks[i] = (ctx.n - 1) * (i + 1) / 100;
+
+    BENCH("select_median", ctx.n, array_prepare, bench_median, NULL, &ctx);
+    BENCH("select_p99", ctx.n, array_prepare, bench_p99, NULL, &ctx);
+
+    /* p1 .. p99 */
+    BENCH("percentiles_multi", ctx.n, array_prepare, bench_percentiles_multi, NULL, &ctx);
+    BENCH("percentiles_select_kth", ctx.n, NULL, bench_percentiles_select_kth, NULL, &ctx);
+    BENCH("percentiles_sort", ctx.n, array_prepare, bench_percentiles_sort, NULL, &ctx);
+
+    FREE(ctx.samples);
+    FREE(ctx.array);
+
+    BENCH_SUMMARY();
+}
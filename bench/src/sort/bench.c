@@ -0,0 +1,142 @@
+#include <bench.h>
+#include <sort.h>
+#include <common.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+#define ROW_SIZE 512
+
+typedef struct Row
+{
+    unsigned    key;
+    char        payload[ROW_SIZE - sizeof(unsigned)];
+} Row;
+
+CMP(int)
+
+static int cmp_row(const void *a, const void *b)
+{
+    if (((const Row *)a)->key < ((const Row *)b)->key)
+        return -1;
+
+    if (((const Row *)a)->key > ((const Row *)b)->key)
+        return 1;
+
+    return 0;
+}
+
+typedef struct Bench_ctx
+{
+    int     *keys;      /* random ints, source of every run */
+    int     *array;
+    Row     *rows_src;  /* random rows, source of every run */
+    Row     *rows;
+    size_t  *perm;
+    size_t  n;
+} Bench_ctx;
+
+static void array_prepare(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    (void)memcpy(ctx->array, ctx->keys, ctx->n * sizeof(int));
+}
+
+static void rows_prepare(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    (void)memcpy(ctx->rows, ctx->rows_src, ctx->n * sizeof(Row));
+}
+
+static void bench_sort_int(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    (void)sort((void *)ctx->array, ctx->n, cmp_int, sizeof(int));
+}
+
+static void bench_sort_by_key_int(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    (void)sort_by_key((void *)ctx->array, ctx->n, sizeof(int), 0, sizeof(int), SORT_KEY_SIGNED);
+}
+
+static void bench_quicksort_rows(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    (void)quicksort((void *)ctx->rows, ctx->n, cmp_row, sizeof(Row));
+}
+
+static void bench_sort_indirect_rows(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    (void)sort_indirect((void *)ctx->rows, ctx->n, cmp_row, sizeof(Row));
+}
+
+static void bench_sort_by_key_rows(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    (void)SORT_BY_KEY((void *)ctx->rows, ctx->n, Row, key, SORT_KEY_UNSIGNED);
+}
+
+static void bench_argsort_by_key_rows(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    (void)argsort_by_key((void *)ctx->rows, ctx->n, sizeof(Row), offsetof(Row, key), sizeof(unsigned), SORT_KEY_UNSIGNED, ctx->perm);
+    BENCH_KEEP(ctx->perm[0]);
+}
+
+int main(void)
+{
+    Bench_ctx ctx = {0};
+    size_t i;
+    int ret = 1;
+
+    BENCH_INIT("SORT");
+
+    ctx.n = BENCH_GET_SIZE(BIT(16));
+    ctx.keys = (int *)malloc(ctx.n * sizeof(int));
+    ctx.array = (int *)malloc(ctx.n * sizeof(int));
+    ctx.rows_src = (Row *)malloc(ctx.n * sizeof(Row));
+    ctx.rows = (Row *)malloc(ctx.n * sizeof(Row));
+    ctx.perm = (size_t *)malloc(ctx.n * sizeof(size_t));
+    if (ctx.keys == NULL || ctx.array == NULL || ctx.rows_src == NULL || ctx.rows == NULL || ctx.perm == NULL)
+        goto cleanup;
+
+    for (i = 0; i < ctx.n; ++i)
+    {
+        ctx.keys[i] = rand() - RAND_MAX / 2;
+        ctx.rows_src[i].key = (unsigned)rand();
+        (void)memset(ctx.rows_src[i].payload, (int)i, sizeof(ctx.rows_src[i].payload));
+    }
+
+    BENCH("sort_int", ctx.n, array_prepare, bench_sort_int, NULL, &ctx);
+    BENCH("sort_by_key_int", ctx.n, array_prepare, bench_sort_by_key_int, NULL, &ctx);
+
+    /* the same rows sorted by moving records, pointers and extracted keys */
+    BENCH("quicksort_rows_512B", ctx.n, rows_prepare, bench_quicksort_rows, NULL, &ctx);
+    BENCH("sort_indirect_rows_512B", ctx.n, rows_prepare, bench_sort_indirect_rows, NULL, &ctx);
+    BENCH("sort_by_key_rows_512B", ctx.n, rows_prepare, bench_sort_by_key_rows, NULL, &ctx);
+    BENCH("argsort_by_key_rows_512B", ctx.n, NULL, bench_argsort_by_key_rows, NULL, &ctx);
+
+    ret = 0;
+
+cleanup:
+    FREE(ctx.keys);
+    FREE(ctx.array);
+    FREE(ctx.rows_src);
+    FREE(ctx.rows);
+    FREE(ctx.perm);
+
+    if (ret)
+        return ret;
+
+    BENCH_SUMMARY();
+}
@@ -0,0 +1,122 @@
+#include <bench.h>
+#include <trie.h>
+#include <common.h>
+#include <stdlib.h>
+
+#define WORD_LEN    6
+
+typedef struct Bench_ctx
+{
+    Trie    *trie;
+    char    (*words)[WORD_LEN + 1]; /* random words from [a-z] */
+    size_t  n;
+} Bench_ctx;
+
+static void words_create(char (*words)[WORD_LEN + 1], size_t n)
+{
+    size_t i;
+    size_t j;
+
+    for (i = 0; i < n; ++i)
+    {
+        for (j = 0; j < WORD_LEN; ++j)
+            words[i][j] = (char)('a' + rand() % 26);
+
+        words[i][WORD_LEN] = '\0';
+    }
+}
+
+static void trie_prepare(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    ctx->trie = trie_create();
+}
+
+static void trie_prepare_full(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+
+    trie_prepare(arg);
+    for (i = 0; i < ctx->n; ++i)
+        (void)trie_insert(ctx->trie, ctx->words[i]);
+}
+
+static void trie_free(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+
+    trie_destroy(ctx->trie);
+    ctx->trie = NULL;
+}
+
+static void bench_insert(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+
+    for (i = 0; i < ctx->n; ++i)
+        (void)trie_insert(ctx->trie, ctx->words[i]);
+}
+
+static void bench_find(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+    size_t found = 0;
+
+    for (i = 0; i < ctx->n; ++i)
+        found += trie_find(ctx->trie, ctx->words[i]);
+
+    BENCH_KEEP(found);
+}
+
+static void bench_delete(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t i;
+
+    for (i = 0; i < ctx->n; ++i)
+        (void)trie_delete(ctx->trie, ctx->words[i]);
+}
+
+static void bench_iterate(void *arg)
+{
+    Bench_ctx *ctx = (Bench_ctx *)arg;
+    size_t len = 0;
+    char *word;
+
+    for_each_data(ctx->trie, Trie, word)
+        len += strlen(word);
+
+    BENCH_KEEP(len);
+}
+
+int main(void)
+{
+    Bench_ctx ctx = {0};
+
+    BENCH_INIT("TRIE");
+
+    /* node has pointer for each printable char, so keep trie small */
+    ctx.n = BENCH_GET_SIZE(BIT(14));
+    ctx.words = malloc(ctx.n * sizeof(*ctx.words));
+    if (ctx.words == NULL)
+        return 1;
+
+    words_create(ctx.words, ctx.n);
+
+    BENCH("insert", ctx.n, trie_prepare, bench_insert, trie_free, &ctx);
+    BENCH("delete", ctx.n, trie_prepare_full, bench_delete, trie_free, &ctx);
+
+    /* read only benchmarks share one trie */
+    trie_prepare_full(&ctx);
+    BENCH("find", ctx.n, NULL, bench_find, NULL, &ctx);
+    BENCH("iterate", (size_t)trie_get_num_entries(ctx.trie), NULL, bench_iterate, NULL, &ctx);
+    trie_free(&ctx);
+
+    FREE(ctx.words);
+
+    BENCH_SUMMARY();
+}
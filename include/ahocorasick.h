@@ -0,0 +1,191 @@
+#ifndef AHOCORASICK_H
+#define AHOCORASICK_H
+
+/*
+    Implementation of Aho-Corasick multi-pattern matcher
+
+    Patterns are compiled to dense DFA (every state has transition for every input class),
+    bytes are mapped to classes first (chars unused in patterns share one class),
+    so table has num_states * num_classes entries and each input byte costs 2 lookups,
+    independent of number of patterns.
+
+    Matcher is streaming: text can be fed chunk by chunk, matches crossing chunks are found.
+    Each match is reported as (pattern id, offset of pattern begining in whole stream).
+    Duplicated patterns are reported with id of the first one.
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+
+    LICENCE: GPL 3.0
+*/
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <sys/types.h>
+#include <common.h>
+#include <trie.h>
+
+typedef struct Aho_corasick Aho_corasick;
+
+/*
+    Stream state, can be placed on stack, all fields are private.
+    Many streams can use the same automaton concurrently
+*/
+typedef struct Aho_corasick_stream
+{
+    const Aho_corasick  *____ac;
+    size_t              ____state;
+    size_t              ____offset; /* bytes consumed by stream */
+}Aho_corasick_stream;
+
+/*
+    Callback for each match
+
+    PARAMS
+    @IN id - pattern id
+    @IN offset - offset of pattern begining in stream
+    @IN arg - user argument
+
+    RETURN
+    0 iff matcher should continue
+    Non-zero value iff matcher should stop
+*/
+typedef int (*aho_corasick_match_f)(size_t id, size_t offset, void *arg);
+
+/*
+    Create automaton from array of patterns, pattern id is an index in array
+
+    PARAMS
+    @IN patterns - array of C strings (not empty)
+    @IN num - number of patterns
+
+    RETURN
+    NULL iff failure
+    Pointer to new automaton iff success
+*/
+Aho_corasick *aho_corasick_create(const char * const *patterns, size_t num);
+
+/*
+    Create automaton from words in Trie, pattern id is an index in trie_to_array
+
+    PARAMS
+    @IN trie - pointer to Trie
+
+    RETURN
+    NULL iff failure
+    Pointer to new automaton iff success
+*/
+Aho_corasick *aho_corasick_create_from_trie(const Trie *trie);
+
+/*
+    Destroy automaton
+
+    PARAMS
+    @IN ac - pointer to automaton
+
+    RETURN
+    This is a void function
+*/
+void aho_corasick_destroy(Aho_corasick *ac);
+
+/*
+    Get number of patterns / number of DFA states
+
+    PARAMS
+    @IN ac - pointer to automaton
+
+    RETURN
+    -1 iff failure
+    Number of patterns / states iff success
+*/
+ssize_t aho_corasick_get_num_patterns(const Aho_corasick *ac);
+ssize_t aho_corasick_get_num_states(const Aho_corasick *ac);
+
+/*
+    Get pattern with id @id
+
+    PARAMS
+    @IN ac - pointer to automaton
+    @IN id - pattern id
+
+    RETURN
+    NULL iff failure
+    Pattern iff success
+*/
+const char *aho_corasick_get_pattern(const Aho_corasick *ac, size_t id);
+
+/*
+    Init stream (start from offset 0)
+
+    PARAMS
+    @IN ac - pointer to automaton
+    @OUT stream - pointer to stream
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int aho_corasick_stream_init(const Aho_corasick * ___restrict___ ac, Aho_corasick_stream * ___restrict___ stream);
+
+/*
+    Feed stream with next chunk of text, call @cb for each match.
+    When @cb stops matcher, stream stays just after the byte where match ends,
+    so rest of chunk can be fed again (aho_corasick_stream_get_offset says where)
+
+    PARAMS
+    @IN stream - pointer to stream
+    @IN buf - chunk of text
+    @IN size - size of chunk
+    @IN cb - callback
+    @IN arg - argument passed to callback
+
+    RETURN
+    -1 iff failure
+    Number of reported matches iff success
+*/
+ssize_t aho_corasick_stream_feed(Aho_corasick_stream *stream, const void *buf, size_t size, aho_corasick_match_f cb, void *arg);
+
+/*
+    Get number of bytes consumed by stream
+
+    PARAMS
+    @IN stream - pointer to stream
+
+    RETURN
+    -1 iff failure
+    Offset iff success
+*/
+ssize_t aho_corasick_stream_get_offset(const Aho_corasick_stream *stream);
+
+/*
+    Find all patterns in buffer (one chunk stream)
+
+    PARAMS
+    @IN ac - pointer to automaton
+    @IN buf - text
+    @IN size - size of text
+    @IN cb - callback
+    @IN arg - argument passed to callback
+
+    RETURN
+    -1 iff failure
+    Number of reported matches iff success
+*/
+ssize_t aho_corasick_search(const Aho_corasick *ac, const void *buf, size_t size, aho_corasick_match_f cb, void *arg);
+
+/*
+    Find first match (which ends first) in buffer
+
+    PARAMS
+    @IN ac - pointer to automaton
+    @IN buf - text
+    @IN size - size of text
+    @OUT id - id of matched pattern (can be NULL)
+
+    RETURN
+    -1 iff there is no match (or failure)
+    Offset of pattern begining in buffer iff success
+*/
+ssize_t aho_corasick_find_first(const Aho_corasick *ac, const void *buf, size_t size, size_t *id);
+
+#endif
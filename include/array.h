@@ -469,6 +469,24 @@ ssize_t array_median(const void * ___restrict___ array, size_t len, size_t size_
 */
 ssize_t array_select_kth(const void * ___restrict___ array, size_t len, size_t size_of, size_t k, cmp_f cmp, void * ___restrict___ kth);
 
+/*
+    Get many kth smallest elements in array at once (e.g. percentiles)
+
+    PARAMS
+    @IN array - array
+    @IN len - array len
+    @IN size_of - member size_of
+    @IN ks - ascending sorted ks to get
+    @IN num_ks - number of ks
+    @IN cmp - cmp
+    @OUT kths - num_ks elements, kths[i] is ks[i]th element
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int array_select_multi(const void * ___restrict___ array, size_t len, size_t size_of, const size_t *ks, size_t num_ks, cmp_f cmp, void * ___restrict___ kths);
+
 /*
     Sort array
 
@@ -0,0 +1,228 @@
+#ifndef ASYNCIO_H
+#define ASYNCIO_H
+
+/*
+    Asynchronous file I/O
+
+    Requests are prepared (no syscall), then submitted in one batch and completions are polled,
+    so one thread can keep many reads / writes in flight.
+
+    Backend is io_uring (raw syscalls, no liburing needed),
+    when io_uring is not available (old kernel, seccomp) pool of threads with blocking pread / pwrite is used.
+    Result of request is the same in both backends: number of bytes or -errno.
+    Short read / write is continued until whole buffer is done, end of file or error,
+    so res < size means end of file (or error after res bytes).
+
+    Buffers can be registered (io_uring pins them once, so kernel doesn't map them for each request),
+    O_DIRECT needs aligned buffers, use async_io_alloc_buffer.
+
+    Async_io is not thread safe, one thread prepares, submits and polls requests.
+
+    File_buffer / File_window are not built on top of Async_io: they map file to memory,
+    so data is read by page faults which can't be queued in io_uring.
+    For async access to the same file open it again with async_io_open and read to own buffers.
+
+    example:
+        Async_io *aio = async_io_create(64, 0);
+        int fd = async_io_open("path_to_file", O_RDONLY, true);
+        void *buf = async_io_alloc_buffer(BIT(20));
+        Async_io_completion cqe[16];
+
+        async_io_prep_read(aio, fd, buf, BIT(20), 0, my_data);
+        async_io_submit(aio);
+
+        n = async_io_poll(aio, cqe, 16, 1);
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+
+    LICENCE: GPL 3.0
+*/
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <sys/types.h>
+#include <sys/uio.h> /* struct iovec */
+#include <common.h>
+
+#define ASYNC_IO_BACKEND_URING      0
+#define ASYNC_IO_BACKEND_THREADS    1
+
+/* flags for async_io_create */
+#define ASYNC_IO_FORCE_THREADS      1       /* don't try io_uring */
+
+#define ASYNC_IO_NUM_THREADS        4       /* threads in fallback backend */
+#define ASYNC_IO_ALIGNMENT          4096    /* alignment of buffers for O_DIRECT */
+
+typedef struct Async_io Async_io;
+
+typedef struct Async_io_completion
+{
+    void    *user_data; /* from prep */
+    ssize_t res;        /* number of bytes iff success, -errno iff failure */
+} Async_io_completion;
+
+/*
+    Create async I/O context
+
+    PARAMS
+    @IN queue_depth - max number of requests in flight (prepared + submitted)
+    @IN flags - ASYNC_IO_* flags or 0
+
+    RETURN
+    NULL iff failure
+    Pointer to new Async_io iff success
+*/
+Async_io *async_io_create(size_t queue_depth, int flags);
+
+/*
+    Wait for all submitted requests and destroy context
+
+    PARAMS
+    @IN aio - pointer to Async_io
+
+    RETURN
+    This is a void function
+*/
+void async_io_destroy(Async_io *aio);
+
+/*
+    Get used backend
+
+    PARAMS
+    @IN aio - pointer to Async_io
+
+    RETURN
+    -1 iff failure
+    ASYNC_IO_BACKEND_* iff success
+*/
+int async_io_get_backend(const Async_io *aio);
+
+/*
+    Register buffers for *_fixed requests (at most once per context)
+
+    PARAMS
+    @IN aio - pointer to Async_io
+    @IN iov - buffers
+    @IN num - number of buffers
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int async_io_register_buffers(Async_io * ___restrict___ aio, const struct iovec * ___restrict___ iov, size_t num);
+
+/*
+    Prepare read / write request, it is sent by async_io_submit
+
+    PARAMS
+    @IN aio - pointer to Async_io
+    @IN fd - file descriptor
+    @IN buf - buffer
+    @IN size - number of bytes
+    @IN offset - offset in file
+    @IN user_data - returned in completion
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure (queue is full)
+*/
+int async_io_prep_read(Async_io *aio, int fd, void *buf, size_t size, off_t offset, void *user_data);
+int async_io_prep_write(Async_io *aio, int fd, const void *buf, size_t size, off_t offset, void *user_data);
+
+/*
+    Prepare read / write request on registered buffer
+
+    PARAMS
+    @IN aio - pointer to Async_io
+    @IN fd - file descriptor
+    @IN buf - pointer inside registered buffer
+    @IN size - number of bytes
+    @IN offset - offset in file
+    @IN buf_index - index of registered buffer
+    @IN user_data - returned in completion
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int async_io_prep_read_fixed(Async_io *aio, int fd, void *buf, size_t size, off_t offset, size_t buf_index, void *user_data);
+int async_io_prep_write_fixed(Async_io *aio, int fd, const void *buf, size_t size, off_t offset, size_t buf_index, void *user_data);
+
+/*
+    Submit all prepared requests (one syscall for io_uring)
+
+    PARAMS
+    @IN aio - pointer to Async_io
+
+    RETURN
+    -1 iff failure
+    Number of submitted requests iff success
+*/
+ssize_t async_io_submit(Async_io *aio);
+
+/*
+    Get completions
+
+    PARAMS
+    @IN aio - pointer to Async_io
+    @OUT cqe - array of completions
+    @IN max - size of array
+    @IN min_wait - wait until at least min_wait completions are ready (0 means don't wait)
+
+    RETURN
+    -1 iff failure
+    Number of completions iff success
+*/
+ssize_t async_io_poll(Async_io * ___restrict___ aio, Async_io_completion * ___restrict___ cqe, size_t max, size_t min_wait);
+
+/*
+    Get number of submitted, not completed requests
+
+    PARAMS
+    @IN aio - pointer to Async_io
+
+    RETURN
+    -1 iff failure
+    Number of requests in flight iff success
+*/
+ssize_t async_io_get_inflight(const Async_io *aio);
+
+/*
+    Open file for async I/O
+
+    PARAMS
+    @IN path - path to file
+    @IN open_flag - flags to open file
+    @IN direct - try O_DIRECT (when fs doesn't support it, file is opened without it)
+
+    RETURN
+    -1 iff failure
+    File descriptor iff success
+*/
+int async_io_open(const char *path, int open_flag, bool direct);
+
+/*
+    Alloc buffer aligned to ASYNC_IO_ALIGNMENT (O_DIRECT), free by async_io_free_buffer
+
+    PARAMS
+    @IN size - size of buffer
+
+    RETURN
+    NULL iff failure
+    Pointer to buffer iff success
+*/
+void *async_io_alloc_buffer(size_t size);
+
+/*
+    Free aligned buffer
+
+    PARAMS
+    @IN buf - buffer
+
+    RETURN
+    This is a void function
+*/
+void async_io_free_buffer(void *buf);
+
+#endif
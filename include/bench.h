@@ -0,0 +1,421 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+/*
+    Simple micro-benchmark framework
+
+    Benchmark is a triple of functions: setup (not measured), run (measured), teardown (not measured).
+    Triple is called BENCH_WARMUP times without recording and then BENCH_REPS times,
+    each repetition is timed with CLOCK_MONOTONIC and TSC (rdtsc, only x86).
+    Cycles and cache misses are read from perf_event_open iff env BENCH_PERF=1 and kernel allows it.
+
+    Results per benchmark (time of repetition divided by ops):
+    median, p99 and min ns/op, ops/s (from median), ticks/op, cycles/op, cache-misses/op
+
+    Environment:
+        BENCH_REPS      - number of measured repetitions (default BENCH_DEFAULT_REPS)
+        BENCH_WARMUP    - number of warmup repetitions (default BENCH_DEFAULT_WARMUP)
+        BENCH_SIZE      - number of elements, see BENCH_GET_SIZE
+        BENCH_SEED      - seed of rand() (default BENCH_DEFAULT_SEED), same seed --> same input
+        BENCH_PERF      - 1 --> use hardware counters
+        BENCH_OUTPUT    - append results to this file (to track them over time)
+        BENCH_FORMAT    - format of BENCH_OUTPUT: csv (default) or json (1 object per line)
+
+    example:
+        static void insert(void *arg)
+        {
+            for (i = 0; i < n; ++i)
+                avl_insert(tree, &keys[i]);
+        }
+
+        BENCH_INIT("AVL");
+        BENCH("insert", n, create_tree, insert, destroy_tree, NULL);
+        BENCH_SUMMARY();
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+
+    LICENCE: GPL3.0
+*/
+
+#include <common.h>
+#include <compiler.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define ____BENCH_TICKS() ((uint64_t)__rdtsc())
+#else
+#define ____BENCH_TICKS() ((uint64_t)0)
+#endif
+
+#define BENCH_DEFAULT_REPS      11
+#define BENCH_DEFAULT_WARMUP    2
+#define BENCH_DEFAULT_SEED      1
+
+#define __BENCH_COLOR_INFO__    COLOR_CYAN
+#define __BENCH_MAX_NAME_LENGTH__ 32
+
+/* use this type for benchmarked functions */
+typedef void (*bench_f)(void *arg);
+
+/* private type, result of one benchmark */
+typedef struct ____Bench_result
+{
+    const char  *name;
+    size_t      ops;
+    size_t      reps;
+    double      median_ns;  /* per op */
+    double      p99_ns;     /* per op */
+    double      min_ns;     /* per op */
+    double      ops_per_sec;
+    double      ticks;      /* per op, -1 iff not available */
+    double      cycles;     /* per op, -1 iff not available */
+    double      cache_misses; /* per op, -1 iff not available */
+} ____Bench_result;
+
+/* PRIVATE state of benchmarks */
+static ___unused___ const char *________bench_suite;
+static ___unused___ size_t ________bench_reps;
+static ___unused___ size_t ________bench_warmup;
+static ___unused___ size_t ________bench_counter;
+static ___unused___ size_t ________bench_seed;
+static ___unused___ int ________bench_perf_fd[2] = {-1, -1};
+static ___unused___ FILE *________bench_output;
+static ___unused___ int ________bench_json;
+
+/*
+    Use this macro to protect value from dead code elimination
+*/
+#define BENCH_KEEP(val) \
+    do { \
+        __asm__ __volatile__("" : : "g"(val) : "memory"); \
+    } while (0)
+
+/*
+    Get number of elements for benchmark: env BENCH_SIZE or @default_size
+*/
+#define BENCH_GET_SIZE(default_size) \
+    __extension__ \
+    ({ \
+        const char *______size = getenv("BENCH_SIZE"); \
+        (size_t)(______size != NULL && atol(______size) > 0 ? (size_t)atol(______size) : (size_t)(default_size)); \
+    })
+
+/* PRIVATE FUNCTIONS */
+static ___unused___ size_t ____bench_env(const char *name, size_t default_val)
+{
+    const char *val = getenv(name);
+
+    if (val == NULL || atol(val) < 0)
+        return default_val;
+
+    return (size_t)atol(val);
+}
+
+static ___unused___ int ____bench_cmp_double(const void *a, const void *b)
+{
+    const double da = *(const double *)a;
+    const double db = *(const double *)b;
+
+    return (da > db) - (da < db);
+}
+
+static ___unused___ double ____bench_percentile(double *sorted, size_t n, size_t pct)
+{
+    /* nearest rank */
+    size_t rank = (pct * n + 99) / 100;
+
+    return sorted[rank == 0 ? 0 : rank - 1];
+}
+
+static ___unused___ int ____bench_perf_open(uint64_t config)
+{
+    struct perf_event_attr attr;
+
+    (void)memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static ___unused___ void ____bench_perf_init(void)
+{
+    ________bench_perf_fd[0] = ____bench_perf_open(PERF_COUNT_HW_CPU_CYCLES);
+    ________bench_perf_fd[1] = ____bench_perf_open(PERF_COUNT_HW_CACHE_MISSES);
+    if (________bench_perf_fd[0] != -1 && ________bench_perf_fd[1] != -1)
+        return;
+
+    if (________bench_perf_fd[0] != -1)
+        (void)close(________bench_perf_fd[0]);
+
+    if (________bench_perf_fd[1] != -1)
+        (void)close(________bench_perf_fd[1]);
+
+    ________bench_perf_fd[0] = -1;
+    ________bench_perf_fd[1] = -1;
+    (void)fprintf(stderr, "[BENCH] perf_event_open is not available, hardware counters disabled\n");
+}
+
+static ___unused___ void ____bench_perf_deinit(void)
+{
+    if (________bench_perf_fd[0] == -1)
+        return;
+
+    (void)close(________bench_perf_fd[0]);
+    (void)close(________bench_perf_fd[1]);
+    ________bench_perf_fd[0] = -1;
+    ________bench_perf_fd[1] = -1;
+}
+
+static ___unused___ void ____bench_perf_control(unsigned long request)
+{
+    if (________bench_perf_fd[0] == -1)
+        return;
+
+    (void)ioctl(________bench_perf_fd[0], request, 0);
+    (void)ioctl(________bench_perf_fd[1], request, 0);
+}
+
+static ___unused___ void ____bench_perf_read(double *cycles, double *misses)
+{
+    uint64_t val[2] = {0, 0};
+
+    if (________bench_perf_fd[0] == -1 ||
+        read(________bench_perf_fd[0], &val[0], sizeof(val[0])) != (ssize_t)sizeof(val[0]) ||
+        read(________bench_perf_fd[1], &val[1], sizeof(val[1])) != (ssize_t)sizeof(val[1]))
+    {
+        *cycles = -1.0;
+        *misses = -1.0;
+        return;
+    }
+
+    *cycles = (double)val[0];
+    *misses = (double)val[1];
+}
+
+static ___unused___ void ____bench_output_init(void)
+{
+    const char *path = getenv("BENCH_OUTPUT");
+    const char *format = getenv("BENCH_FORMAT");
+
+    ________bench_json = format != NULL && strcmp(format, "json") == 0;
+    if (path == NULL)
+        return;
+
+    ________bench_output = fopen(path, "a");
+    if (________bench_output == NULL)
+    {
+        (void)fprintf(stderr, "[BENCH] cannot open %s\n", path);
+        return;
+    }
+
+    /* new file, put header */
+    if (!________bench_json && fseek(________bench_output, 0, SEEK_END) == 0 && ftell(________bench_output) == 0)
+        (void)fprintf(________bench_output, "timestamp,suite,name,ops,reps,median_ns,p99_ns,min_ns,ops_per_sec,ticks_per_op,cycles_per_op,cache_misses_per_op\n");
+}
+
+static ___unused___ void ____bench_output_deinit(void)
+{
+    if (________bench_output == NULL)
+        return;
+
+    (void)fclose(________bench_output);
+    ________bench_output = NULL;
+}
+
+/* -1 means not available: empty field in csv, null in json */
+static ___unused___ void ____bench_print_opt(FILE *f, double val, const char *na)
+{
+    if (val < 0.0)
+        (void)fprintf(f, "%s", na);
+    else
+        (void)fprintf(f, "%.2lf", val);
+}
+
+static ___unused___ void ____bench_report(const ____Bench_result *res)
+{
+    const char *na = ________bench_json ? "null" : "";
+    FILE *f = ________bench_output;
+
+    (void)printf(__BENCH_COLOR_INFO__ "[BENCH]" COLOR_RESET "\t%-*s median %10.2lf ns/op  p99 %10.2lf ns/op  %14.0lf ops/s",
+                 __BENCH_MAX_NAME_LENGTH__, res->name, res->median_ns, res->p99_ns, res->ops_per_sec);
+    if (res->cycles >= 0.0)
+        (void)printf("  %8.2lf cycles/op  %8.4lf misses/op", res->cycles, res->cache_misses);
+
+    (void)printf("\n");
+
+    if (f == NULL)
+        return;
+
+    if (________bench_json)
+        (void)fprintf(f, "{\"timestamp\": %ld, \"suite\": \"%s\", \"name\": \"%s\", \"ops\": %zu, \"reps\": %zu, "
+                         "\"median_ns\": %.2lf, \"p99_ns\": %.2lf, \"min_ns\": %.2lf, \"ops_per_sec\": %.2lf, \"ticks_per_op\": ",
+                      (long)time(NULL), ________bench_suite, res->name, res->ops, res->reps,
+                      res->median_ns, res->p99_ns, res->min_ns, res->ops_per_sec);
+    else
+        (void)fprintf(f, "%ld,%s,%s,%zu,%zu,%.2lf,%.2lf,%.2lf,%.2lf,",
+                      (long)time(NULL), ________bench_suite, res->name, res->ops, res->reps,
+                      res->median_ns, res->p99_ns, res->min_ns, res->ops_per_sec);
+
+    ____bench_print_opt(f, res->ticks, na);
+    (void)fprintf(f, ________bench_json ? ", \"cycles_per_op\": " : ",");
+    ____bench_print_opt(f, res->cycles, na);
+    (void)fprintf(f, ________bench_json ? ", \"cache_misses_per_op\": " : ",");
+    ____bench_print_opt(f, res->cache_misses, na);
+    (void)fprintf(f, ________bench_json ? "}\n" : "\n");
+}
+
+static ___unused___ void ____bench_run(const char *name, size_t ops, bench_f setup, bench_f run, bench_f teardown, void *arg)
+{
+    ____Bench_result res;
+    struct timespec start;
+    struct timespec end;
+    double *ns;
+    double *ticks;
+    double *cycles;
+    double *misses;
+    uint64_t tsc;
+    size_t i;
+
+    ns = (double *)malloc(4 * ________bench_reps * sizeof(double));
+    if (ns == NULL || ops == 0)
+    {
+        (void)fprintf(stderr, "[BENCH] %s: nothing to do\n", name);
+        free(ns);
+        return;
+    }
+
+    ticks = ns + ________bench_reps;
+    cycles = ticks + ________bench_reps;
+    misses = cycles + ________bench_reps;
+
+    for (i = 0; i < ________bench_warmup + ________bench_reps; ++i)
+    {
+        if (setup != NULL)
+            setup(arg);
+
+        ____bench_perf_control(PERF_EVENT_IOC_RESET);
+        ____bench_perf_control(PERF_EVENT_IOC_ENABLE);
+        (void)clock_gettime(CLOCK_MONOTONIC, &start);
+        tsc = ____BENCH_TICKS();
+
+        run(arg);
+
+        tsc = ____BENCH_TICKS() - tsc;
+        (void)clock_gettime(CLOCK_MONOTONIC, &end);
+        ____bench_perf_control(PERF_EVENT_IOC_DISABLE);
+
+        if (i >= ________bench_warmup)
+        {
+            ns[i - ________bench_warmup] = (double)(end.tv_sec - start.tv_sec) * 1e9 + (double)(end.tv_nsec - start.tv_nsec);
+            ticks[i - ________bench_warmup] = (double)tsc;
+            ____bench_perf_read(&cycles[i - ________bench_warmup], &misses[i - ________bench_warmup]);
+        }
+
+        if (teardown != NULL)
+            teardown(arg);
+    }
+
+    qsort(ns, ________bench_reps, sizeof(double), ____bench_cmp_double);
+    qsort(ticks, ________bench_reps, sizeof(double), ____bench_cmp_double);
+    qsort(cycles, ________bench_reps, sizeof(double), ____bench_cmp_double);
+    qsort(misses, ________bench_reps, sizeof(double), ____bench_cmp_double);
+
+    res.name = name;
+    res.ops = ops;
+    res.reps = ________bench_reps;
+    res.median_ns = ____bench_percentile(ns, ________bench_reps, 50) / (double)ops;
+    res.p99_ns = ____bench_percentile(ns, ________bench_reps, 99) / (double)ops;
+    res.min_ns = ns[0] / (double)ops;
+    res.ops_per_sec = res.median_ns > 0.0 ? 1e9 / res.median_ns : 0.0;
+    res.ticks = ticks[________bench_reps - 1] > 0.0 ? ____bench_percentile(ticks, ________bench_reps, 50) / (double)ops : -1.0;
+    res.cycles = cycles[0] < 0.0 ? -1.0 : ____bench_percentile(cycles, ________bench_reps, 50) / (double)ops;
+    res.cache_misses = misses[0] < 0.0 ? -1.0 : ____bench_percentile(misses, ________bench_reps, 50) / (double)ops;
+
+    ____bench_report(&res);
+    ++________bench_counter;
+
+    free(ns);
+}
+
+/*
+    Fill @keys with random permutation of [0, @n) (Fisher-Yates), deterministic for BENCH_SEED
+
+    PARAMS
+    @OUT keys - array of @n keys
+    @IN n - number of keys
+
+    RETURN:
+    This is a void function
+*/
+static ___unused___ void bench_keys_permutation(int *keys, size_t n)
+{
+    size_t i;
+    size_t j;
+
+    for (i = 0; i < n; ++i)
+        keys[i] = (int)i;
+
+    for (i = n; i > 1; --i)
+    {
+        j = (size_t)rand() % i;
+        SWAP(keys[i - 1], keys[j]);
+    }
+}
+
+/*
+    Use this macro before benchmarks, @suite is a name of benchmarked library
+*/
+#define BENCH_INIT(suite) \
+    do { \
+        ________bench_suite = (suite); \
+        ________bench_counter = 0; \
+        ________bench_reps = ____bench_env("BENCH_REPS", BENCH_DEFAULT_REPS); \
+        ________bench_warmup = ____bench_env("BENCH_WARMUP", BENCH_DEFAULT_WARMUP); \
+        if (________bench_reps == 0) \
+            ________bench_reps = 1; \
+        ________bench_seed = ____bench_env("BENCH_SEED", BENCH_DEFAULT_SEED); \
+        srand((unsigned)________bench_seed); \
+        if (____bench_env("BENCH_PERF", 0)) \
+            ____bench_perf_init(); \
+        ____bench_output_init(); \
+        printf(__BENCH_COLOR_INFO__ "===== BENCH %s (reps = %zu, warmup = %zu, seed = %zu) =====" COLOR_RESET "\n", \
+               ________bench_suite, ________bench_reps, ________bench_warmup, ________bench_seed); \
+    } while (0)
+
+/*
+    Measure @run (@ops operations), @setup and @teardown are not measured (can be NULL)
+    All functions get @arg
+*/
+#define BENCH(name, ops, setup, run, teardown, arg) \
+    do { \
+        ____bench_run(name, (size_t)(ops), setup, run, teardown, (void *)(arg)); \
+    } while (0)
+
+/*
+    Use this macro at the end of benchmarks
+*/
+#define BENCH_SUMMARY() \
+    do { \
+        ____bench_output_deinit(); \
+        ____bench_perf_deinit(); \
+        printf(__BENCH_COLOR_INFO__ "===== BENCH %s: %zu benchmarks =====" COLOR_RESET "\n", \
+               ________bench_suite, ________bench_counter); \
+        return 0; \
+    } while (0)
+
+#endif
@@ -0,0 +1,245 @@
+#ifndef BLOOM_H
+#define BLOOM_H
+
+/*
+    Implementation of Bloom filters
+
+    Bloom_filter - classic Bloom filter on Bitset, k positions from double hashing
+    Blocked_bloom_filter - cache-blocked Bloom filter, all k bits of key are in one
+    cache line (512 bits), so insert / lookup touch only 1 cache line, bits are tested by SIMD
+
+    Filters with the same params can be merged (union of sets)
+
+    Serialized format (little endian, portable):
+        [uint32 magic][uint32 hashes][uint64 bits] ceil(bits / 64) * [uint64 word]
+    The same on 32 and 64bit targets.
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+
+    LICENCE: GPL 3.0
+*/
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <sys/types.h>
+#include <common.h>
+
+typedef struct Bloom_filter Bloom_filter;
+typedef struct Blocked_bloom_filter Blocked_bloom_filter;
+
+/*
+    Compute optimal number of bits for Bloom filter
+
+    PARAMS
+    @IN n - expected number of entries
+    @IN fpr - target false positive rate (0.0; 1.0)
+
+    RETURN
+    0 iff failure
+    Number of bits iff success
+*/
+size_t bloom_optimal_bits(size_t n, double fpr);
+
+/*
+    Compute optimal number of hash functions for Bloom filter
+
+    PARAMS
+    @IN bits - number of bits in filter
+    @IN n - expected number of entries
+
+    RETURN
+    0 iff failure
+    Number of hash functions iff success
+*/
+size_t bloom_optimal_hashes(size_t bits, size_t n);
+
+/*
+    Create Bloom filter
+
+    PARAMS
+    @IN bits - number of bits
+    @IN hashes - number of hash functions
+
+    RETURN
+    NULL iff failure
+    Pointer to new filter iff success
+*/
+Bloom_filter *bloom_filter_create(size_t bits, size_t hashes);
+
+/*
+    Create Bloom filter for @n entries with false positive rate @fpr
+
+    PARAMS
+    @IN n - expected number of entries
+    @IN fpr - target false positive rate (0.0; 1.0)
+
+    RETURN
+    NULL iff failure
+    Pointer to new filter iff success
+*/
+Bloom_filter *bloom_filter_create_for(size_t n, double fpr);
+
+/*
+    Destroy Bloom filter
+
+    PARAMS
+    @IN filter - pointer to filter
+
+    RETURN
+    This is a void function
+*/
+void bloom_filter_destroy(Bloom_filter *filter);
+
+/*
+    Insert key into filter
+
+    PARAMS
+    @IN filter - pointer to filter
+    @IN data - key
+    @IN size - size of key in bytes
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int bloom_filter_insert(Bloom_filter * ___restrict___ filter, const void * ___restrict___ data, size_t size);
+
+/*
+    Check key in filter
+
+    PARAMS
+    @IN filter - pointer to filter
+    @IN data - key
+    @IN size - size of key in bytes
+
+    RETURN
+    false iff key surely doesn't exist
+    true iff key may exist (or failure)
+*/
+bool bloom_filter_contains(const Bloom_filter * ___restrict___ filter, const void * ___restrict___ data, size_t size);
+
+/*
+    Merge @src into @dst (filters must have the same params)
+
+    PARAMS
+    @IN dst - pointer to filter
+    @IN src - pointer to filter
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int bloom_filter_merge(Bloom_filter *dst, const Bloom_filter *src);
+
+/*
+    Get serialized size / Serialize / Deserialize filter
+
+    PARAMS
+    @IN filter - pointer to filter
+    @IN / @OUT buf - buffer
+    @IN size - size of buffer
+
+    RETURN
+    -1 / NULL iff failure
+    Size / Number of written bytes / Pointer to new filter iff success
+*/
+ssize_t bloom_filter_serialized_size(const Bloom_filter *filter);
+ssize_t bloom_filter_serialize(const Bloom_filter * ___restrict___ filter, void * ___restrict___ buf, size_t size);
+Bloom_filter *bloom_filter_deserialize(const void *buf, size_t size);
+
+/*
+    Create blocked Bloom filter
+
+    PARAMS
+    @IN bits - number of bits (rounded up to 512)
+    @IN hashes - number of hash functions (bits per key)
+
+    RETURN
+    NULL iff failure
+    Pointer to new filter iff success
+*/
+Blocked_bloom_filter *blocked_bloom_filter_create(size_t bits, size_t hashes);
+
+/*
+    Create blocked Bloom filter for @n entries with false positive rate @fpr
+
+    PARAMS
+    @IN n - expected number of entries
+    @IN fpr - target false positive rate (0.0; 1.0)
+
+    RETURN
+    NULL iff failure
+    Pointer to new filter iff success
+*/
+Blocked_bloom_filter *blocked_bloom_filter_create_for(size_t n, double fpr);
+
+/*
+    Destroy blocked Bloom filter
+
+    PARAMS
+    @IN filter - pointer to filter
+
+    RETURN
+    This is a void function
+*/
+void blocked_bloom_filter_destroy(Blocked_bloom_filter *filter);
+
+/*
+    Insert key into filter
+
+    PARAMS
+    @IN filter - pointer to filter
+    @IN data - key
+    @IN size - size of key in bytes
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int blocked_bloom_filter_insert(Blocked_bloom_filter * ___restrict___ filter, const void * ___restrict___ data, size_t size);
+
+/*
+    Check key in filter
+
+    PARAMS
+    @IN filter - pointer to filter
+    @IN data - key
+    @IN size - size of key in bytes
+
+    RETURN
+    false iff key surely doesn't exist
+    true iff key may exist (or failure)
+*/
+bool blocked_bloom_filter_contains(const Blocked_bloom_filter * ___restrict___ filter, const void * ___restrict___ data, size_t size);
+
+/*
+    Merge @src into @dst (filters must have the same params)
+
+    PARAMS
+    @IN dst - pointer to filter
+    @IN src - pointer to filter
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int blocked_bloom_filter_merge(Blocked_bloom_filter *dst, const Blocked_bloom_filter *src);
+
+/*
+    Get serialized size / Serialize / Deserialize filter
+
+    PARAMS
+    @IN filter - pointer to filter
+    @IN / @OUT buf - buffer
+    @IN size - size of buffer
+
+    RETURN
+    -1 / NULL iff failure
+    Size / Number of written bytes / Pointer to new filter iff success
+*/
+ssize_t blocked_bloom_filter_serialized_size(const Blocked_bloom_filter *filter);
+ssize_t blocked_bloom_filter_serialize(const Blocked_bloom_filter * ___restrict___ filter, void * ___restrict___ buf, size_t size);
+Blocked_bloom_filter *blocked_bloom_filter_deserialize(const void *buf, size_t size);
+
+#endif
@@ -4,6 +4,9 @@
 /*
     Implementation of string from char *, like std :: string
 
+    Short strings (< 24 chars) are kept inline in String (no extra allocation),
+    String_view is a non-owning (pointer, length) slice for allocation-free slicing and searching
+
     Author: Michal Kukowski
     email: michalkukowski10@gmail.com
 
@@ -18,6 +21,43 @@
 typedef struct String String;
 typedef struct String_iterator String_iterator;
 
+/*
+    Non-owning view of chars (pointer + length), not null terminated.
+    View is valid as long as viewed buffer is alive and not modified,
+    so slicing and searching by views don't allocate memory.
+    Invalid view (e.g returned on failure) has str == NULL
+*/
+typedef struct String_view
+{
+    const char  *str;
+    size_t      len;
+}String_view;
+
+#define STRING_TOKENIZER_SET_CHARS  4
+
+/*
+    Splitter which yields views of tokens in orginal buffer (no allocation, no copy).
+    Can be placed on stack, all fields are private.
+    Text can be String (string_get_view) or any raw memory, e.g mmapped file:
+        string_view_create(file_buffer_get_buff(fb), (size_t)file_buffer_get_size(fb))
+*/
+typedef struct String_tokenizer
+{
+    const char  *____buf;
+    size_t      ____len;
+    size_t      ____pos;
+    const char  *____delim;         /* multi-char delimeter */
+    size_t      ____delim_len;
+    uint64_t    ____set[4];         /* bitmap of delimeters for big char-set */
+    char        ____set_chars[STRING_TOKENIZER_SET_CHARS];
+    size_t      ____set_len;
+    int         ____type;
+    char        ____quote;
+    bool        ____quoted;
+    bool        ____skip_empty;
+    bool        ____done;
+}String_tokenizer;
+
 IT_FUNC(String, string)
 
 /*
@@ -260,6 +300,98 @@ ssize_t string_find_c_last_substr(const String *string, char c, size_t begin, si
 ssize_t string_find_str_last_substr(const String * ___restrict___ string, const char * ___restrict___ str, size_t begin, size_t end);
 ssize_t string_find_string_last_substr(const String *s1, const String *s2, size_t begin, size_t end);
 
+/*
+    Create view of @len chars from @str / of C string @str / of whole String @string
+
+    PARAMS
+    @IN str - pointer to chars
+    @IN len - number of chars
+    @IN string - pointer to String
+
+    RETURN
+    Invalid view iff failure
+    View iff success
+*/
+String_view string_view_create(const char *str, size_t len);
+String_view string_view_from_str(const char *str);
+String_view string_get_view(const String *string);
+
+/*
+    Test if view is empty (or invalid)
+
+    PARAMS
+    @IN view - view
+
+    RETURN
+    true iff view is empty
+    false iff view is not empty
+*/
+bool string_view_is_empty(String_view view);
+
+/*
+    Get view of substring [begin; end] of view / String without copying
+
+    PARAMS
+    @IN view / string - view / pointer to String
+    @IN begin - begin of substring
+    @IN end - end of substring
+
+    RETURN
+    Invalid view iff failure
+    View iff success
+*/
+String_view string_view_substr(String_view view, size_t begin, size_t end);
+String_view string_substr_view(const String *string, size_t begin, size_t end);
+
+/*
+    Create String with copy of viewed chars
+
+    PARAMS
+    @IN view - view
+
+    RETURN
+    NULL iff failure
+    Pointer to new String iff success
+*/
+String *string_create_from_view(String_view view);
+
+/*
+    Compare views / String with view
+
+    PARAMS
+    @IN v1 / string - 1st view / pointer to String
+    @IN v2 / view - 2nd view
+
+    RETURN
+    < 0 iff v1 < v2
+    = 0 iff v1 == v2
+    > 0 iff v1 > v2
+*/
+int string_view_cmp(String_view v1, String_view v2);
+int string_cmp_view(const String *string, String_view view);
+
+/*
+    Find first / last Occurrence of pattern (char or view) in view / String
+
+    PARAMS
+    @IN view / string - view / pointer to String
+    @IN c / pattern - pattern to find
+    @IN begin - begin of substr
+    @IN end - end of substr
+
+    RETURN
+    -1 iff pattern doesn't exist in view / String
+    position of begining pattern in view / String
+*/
+ssize_t string_view_find_c_first(String_view view, char c);
+ssize_t string_view_find_c_last(String_view view, char c);
+ssize_t string_view_find_view_first(String_view view, String_view pattern);
+ssize_t string_view_find_view_last(String_view view, String_view pattern);
+ssize_t string_find_view_first(const String *string, String_view pattern);
+ssize_t string_find_view_last(const String *string, String_view pattern);
+ssize_t string_find_view_first_substr(const String *string, String_view pattern, size_t begin, size_t end);
+ssize_t string_find_view_last_substr(const String *string, String_view pattern, size_t begin, size_t end);
+
 /*
     Make a copy of @string
 
@@ -419,6 +551,23 @@ int string_replace_string_by_c_all(String *string, const String *string1, char c
 int string_replace_string_by_str_all(String *string, const String *string1, const char * ___restrict___ str);
 int string_replace_string_by_string_all(String *string, const String *string1, const String *string2);
 
+/*
+    Replace all occurrences of many patterns in one scan (Aho-Corasick).
+    Pattern is replaced as soon as it ends (the longest one iff many patterns end at the same char),
+    matches don't overlap and replaced text is not searched again
+
+    PARAMS
+    @IN string - pointer to String
+    @IN patterns - array of patterns (not empty)
+    @IN replacements - array of replacements, replacements[i] for patterns[i] (can be empty)
+    @IN num - number of patterns
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int string_replace_multi_all(String *string, const char * const *patterns, const char * const *replacements, size_t num);
+
 /*
     Split String to array of String wchich are separated by char / char * / String
     in orginal @string
@@ -436,4 +585,77 @@ String **string_split_c(const String *string, char c, size_t *size);
 String **string_split_str(const String * ___restrict___ string, const char * ___restrict___ str, size_t * ___restrict___ size);
 String **string_split_string(const String *string, const String *string2, size_t *size);
 
-#endif
\ No newline at end of file
+/*
+    Init tokenizer over @text with delimeter:
+    char @c / any char from C string @set / multi-char delimeter @delim
+
+    Consecutive delimeters give empty tokens (see string_tokenizer_skip_empty),
+    delimeter at the end of text gives empty last token, empty text has no tokens
+
+    PARAMS
+    @IN tok - pointer to tokenizer
+    @IN text - text to split (must live as long as tokenizer and tokens)
+    @IN c / set / delim - delimeter
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int string_tokenizer_init_c(String_tokenizer *tok, String_view text, char c);
+int string_tokenizer_init_set(String_tokenizer * ___restrict___ tok, String_view text, const char * ___restrict___ set);
+int string_tokenizer_init_view(String_tokenizer *tok, String_view text, String_view delim);
+
+/*
+    Enable quoted fields (like in CSV). Field started by @quote ends at next single @quote,
+    delimeters inside are not treated as delimeters, double quote is an escaped quote (kept as it is in token).
+    Token is a view of chars between quotes, chars between closing quote and delimeter are skipped
+
+    PARAMS
+    @IN tok - pointer to tokenizer
+    @IN quote - quote char
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int string_tokenizer_set_quote(String_tokenizer *tok, char quote);
+
+/*
+    Skip empty tokens (e.g many spaces between words)
+
+    PARAMS
+    @IN tok - pointer to tokenizer
+    @IN skip - skip empty tokens ?
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int string_tokenizer_skip_empty(String_tokenizer *tok, bool skip);
+
+/*
+    Get next token
+
+    PARAMS
+    @IN tok - pointer to tokenizer
+    @OUT token - view of token in text
+
+    RETURN
+    -1 iff there is no more tokens (or failure)
+    Offset of token in text iff success
+*/
+ssize_t string_tokenizer_next(String_tokenizer * ___restrict___ tok, String_view * ___restrict___ token);
+
+/*
+    Was last returned token quoted ?
+
+    PARAMS
+    @IN tok - pointer to tokenizer
+
+    RETURN
+    true iff token was quoted
+    false iff token wasn't quoted (or failure)
+*/
+bool string_tokenizer_is_quoted(const String_tokenizer *tok);
+
+#endif
@@ -0,0 +1,162 @@
+#ifndef CUCKOO_H
+#define CUCKOO_H
+
+/*
+    Implementation of Cuckoo filter (approximate set with deletion)
+
+    Each key is kept as short fingerprint (4 - 16 bits) in one of 2 buckets (4 slots per bucket),
+    alternative bucket is computed from fingerprint only, so entries can be moved (kicked) without key.
+    False positive rate ~= 8 / 2^fingerprint_bits
+
+    Filters with the same params can be merged
+
+    Serialized format (little endian, portable):
+        [uint32 magic][uint32 fp_bits][uint64 buckets][uint64 entries][uint64 victim_index]
+        [uint16 victim_fp][uint16 has_victim][uint32 reserved] buckets * 4 * [uint16 fp]
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+
+    LICENCE: GPL 3.0
+*/
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <sys/types.h>
+#include <common.h>
+
+typedef struct Cuckoo_filter Cuckoo_filter;
+
+/*
+    Compute fingerprint size for target false positive rate
+
+    PARAMS
+    @IN fpr - target false positive rate (0.0; 1.0)
+
+    RETURN
+    0 iff failure
+    Number of fingerprint bits iff success (max 16)
+*/
+size_t cuckoo_optimal_fingerprint_bits(double fpr);
+
+/*
+    Create Cuckoo filter
+
+    PARAMS
+    @IN capacity - max number of entries
+    @IN fp_bits - fingerprint size in bits [4; 16]
+
+    RETURN
+    NULL iff failure
+    Pointer to new filter iff success
+*/
+Cuckoo_filter *cuckoo_filter_create(size_t capacity, size_t fp_bits);
+
+/*
+    Create Cuckoo filter for @capacity entries with false positive rate @fpr
+
+    PARAMS
+    @IN capacity - max number of entries
+    @IN fpr - target false positive rate (0.0; 1.0)
+
+    RETURN
+    NULL iff failure
+    Pointer to new filter iff success
+*/
+Cuckoo_filter *cuckoo_filter_create_for(size_t capacity, double fpr);
+
+/*
+    Destroy Cuckoo filter
+
+    PARAMS
+    @IN filter - pointer to filter
+
+    RETURN
+    This is a void function
+*/
+void cuckoo_filter_destroy(Cuckoo_filter *filter);
+
+/*
+    Insert key into filter
+
+    PARAMS
+    @IN filter - pointer to filter
+    @IN data - key
+    @IN size - size of key in bytes
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure (e.g filter is full)
+*/
+int cuckoo_filter_insert(Cuckoo_filter * ___restrict___ filter, const void * ___restrict___ data, size_t size);
+
+/*
+    Check key in filter
+
+    PARAMS
+    @IN filter - pointer to filter
+    @IN data - key
+    @IN size - size of key in bytes
+
+    RETURN
+    false iff key surely doesn't exist
+    true iff key may exist (or failure)
+*/
+bool cuckoo_filter_contains(const Cuckoo_filter * ___restrict___ filter, const void * ___restrict___ data, size_t size);
+
+/*
+    Delete key from filter (key must be inserted before, otherwise other key can be deleted)
+
+    PARAMS
+    @IN filter - pointer to filter
+    @IN data - key
+    @IN size - size of key in bytes
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure (e.g key doesn't exist)
+*/
+int cuckoo_filter_delete(Cuckoo_filter * ___restrict___ filter, const void * ___restrict___ data, size_t size);
+
+/*
+    Get number of entries in filter
+
+    PARAMS
+    @IN filter - pointer to filter
+
+    RETURN
+    -1 iff failure
+    Number of entries iff success
+*/
+ssize_t cuckoo_filter_get_num_entries(const Cuckoo_filter *filter);
+
+/*
+    Merge @src into @dst (filters must have the same params)
+
+    PARAMS
+    @IN dst - pointer to filter
+    @IN src - pointer to filter
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure (e.g @dst is full, then @dst contains part of @src)
+*/
+int cuckoo_filter_merge(Cuckoo_filter *dst, const Cuckoo_filter *src);
+
+/*
+    Get serialized size / Serialize / Deserialize filter
+
+    PARAMS
+    @IN filter - pointer to filter
+    @IN / @OUT buf - buffer
+    @IN size - size of buffer
+
+    RETURN
+    -1 / NULL iff failure
+    Size / Number of written bytes / Pointer to new filter iff success
+*/
+ssize_t cuckoo_filter_serialized_size(const Cuckoo_filter *filter);
+ssize_t cuckoo_filter_serialize(const Cuckoo_filter * ___restrict___ filter, void * ___restrict___ buf, size_t size);
+Cuckoo_filter *cuckoo_filter_deserialize(const void *buf, size_t size);
+
+#endif
@@ -208,6 +208,22 @@ ssize_t darray_search_first(const Darray * ___restrict___ darray, const void *va
 */
 ssize_t darray_search_last(const Darray * ___restrict___ darray, const void *val_in, void *val_out);
 
+/*
+    Search for many values at once (First of all values),
+    in sorted array lookups are interleaved to overlap cache misses
+
+    PARAMS
+    @IN darray - pointer to Darray
+    @IN vals_in - array of num_vals values with keys
+    @IN num_vals - number of values
+    @OUT pos - array of num_vals positions (-1 iff value doesn't exist)
+
+    RETURN:
+    %-1 iff failure
+    %number of found values iff success
+*/
+ssize_t darray_search_batch(const Darray * ___restrict___ darray, const void * ___restrict___ vals_in, size_t num_vals, ssize_t * ___restrict___ pos);
+
 /*
     If array is unsorted sort the array
 
@@ -0,0 +1,67 @@
+#ifndef EXTSORT_H
+#define EXTSORT_H
+
+/*
+    External (out of core) sort of file with fixed size records
+
+    File can be much bigger than RAM:
+    1. Input is read by File_window in chunks of conf->memory bytes,
+       each chunk is split between threads, sorted by sort() and parts are merged (Loser_tree from kmerge.h)
+       straight to run file (File_appender), so run is written sequentially once.
+    2. Runs are merged by loser tree, each run is read by own File_window (readahead, MADV_SEQUENTIAL),
+       when there are too many runs for memory, groups of runs are merged into bigger runs first.
+
+    Run files are created in tmp_dir and unlinked immediately, so they disappear on crash.
+    Output is written to temp file next to out_path and renamed over it on success,
+    so output can be the same file as input and input is untouched when sort fails.
+
+    example:
+        Extsort_conf conf = { .memory = BIT(30), .threads = 4, .tmp_dir = "/data/tmp" };
+
+        extsort_file("records.bin", "sorted.bin", sizeof(Record), cmp_record, &conf);
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+
+    LICENCE: GPL 3.0
+*/
+
+#include <stddef.h>
+#include <common.h>
+
+#define EXTSORT_MIN_MEMORY  BIT(16) /* 64KB */
+#define EXTSORT_MAX_THREADS 64
+
+typedef struct Extsort_conf
+{
+    size_t      memory;     /* RAM for run, 0 means half of available memory */
+    size_t      threads;    /* threads sorting run, 0 means number of CPUs */
+    const char  *tmp_dir;   /* directory for runs, NULL means $TMPDIR or /tmp */
+} Extsort_conf;
+
+typedef struct Extsort_stats
+{
+    size_t      records;
+    size_t      runs;           /* runs created from input */
+    size_t      merge_passes;   /* 0 iff input fits in memory */
+} Extsort_stats;
+
+/*
+    Sort file with records of size size_of
+
+    PARAMS
+    @IN in_path - path to input file (size has to be multiple of size_of)
+    @IN out_path - path to output file (created or replaced on success), can be equal to in_path
+    @IN size_of - size of record
+    @IN cmp - compare function (see sort.h)
+    @IN conf - configuration or NULL (defaults)
+    @OUT stats - statistics or NULL
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int extsort_file(const char *in_path, const char *out_path, size_t size_of, cmp_f cmp,
+                 const Extsort_conf *conf, Extsort_stats *stats);
+
+#endif
@@ -166,4 +166,383 @@ char *file_buffer_get_buff(const File_buffer *fb);
 */
 ssize_t file_buffer_get_size(const File_buffer *fb);
 
+/*
+	Send part of buffered file to socket without copy to user space (sendfile)
+	Page cache is shared with mapping, so changes in buffer are sent without synch
+
+	PARAMS
+	@IN fb - pointer to file buffer
+	@IN socket - socket (or any fd)
+	@IN offset - offset in file
+	@IN count - number of bytes (trimmed to size of file)
+
+	RETURN:
+	%Number of sent bytes iff success (less than count iff socket is non-blocking and full)
+	%-1 iff failure
+*/
+ssize_t file_buffer_send(const File_buffer *fb, int socket, size_t offset, size_t count);
+
+/*
+	Append-only writer (log / segment files)
+
+	File is grown by big extents (fallocate, ftruncate when fs doesn't support it)
+	and mapped once per extent, so append is only memcpy + cursor update.
+	Write cursor is kept separately from file size, on destroy file is truncated to cursor.
+	After crash file can have zeroed tail (preallocated, not written part of extent).
+
+	Written data can be flushed periodically: each sync_bytes new bytes writeback
+	is started in background (sync_file_range), so disk write doesn't block appender.
+
+    example:
+        File_appender *fa = file_appender_create_from_path("path_to_file", O_RDWR | O_CREAT, 0);
+        file_appender_set_sync(fa, BIT(20));
+
+        file_appender_append(fa, &record, sizeof(record));
+
+        file_appender_destroy(fa);
+*/
+
+#define FILE_APPENDER_DEFAULT_EXTENT ((size_t)1 << 24) /* 16MB */
+
+typedef struct File_appender File_appender;
+
+/*
+	Create appender, new data are placed after current end of file
+
+	PARAMS
+	@IN fd - file descriptor (opened with O_RDWR)
+	@IN extent_size - file grows by this value (0 means FILE_APPENDER_DEFAULT_EXTENT)
+
+	RETURN:
+	%NULL iff failure
+	%Pointer to File_appender iff success
+*/
+File_appender *file_appender_create(int fd, size_t extent_size);
+
+/*
+	Create appender
+
+	PARAMS
+	@IN path - path to file
+	@IN open_flag - flags to open file (O_RDWR is needed)
+	@IN extent_size - file grows by this value (0 means FILE_APPENDER_DEFAULT_EXTENT)
+
+	RETURN:
+	%NULL iff failure
+	%Pointer to File_appender iff success
+*/
+File_appender *file_appender_create_from_path(const char *path, int open_flag, size_t extent_size);
+
+/*
+	Sync, truncate file to written size and destroy appender
+
+	PARAMS
+	@IN fa - pointer to appender
+
+	RETURN:
+	%0 iff success
+	%Non-zero value iff failure
+*/
+int file_appender_destroy(File_appender *fa);
+
+/*
+	Append binary data to file
+
+	PARAMS
+	@IN fa - pointer to appender
+	@IN data - data
+	@IN size - size of data
+
+	RETURN:
+	%0 iff success
+	%Non-zero value iff failure
+*/
+int file_appender_append(File_appender * ___restrict___ fa, const void * ___restrict___ data, size_t size);
+
+/*
+	Reserve @size bytes at the end of file, caller writes record directly to file
+
+	PARAMS
+	@IN fa - pointer to appender
+	@IN size - size of record
+
+	RETURN:
+	%NULL iff failure
+	%Pointer to reserved space iff success (valid until next append / reserve)
+*/
+void *file_appender_reserve(File_appender *fa, size_t size);
+
+/*
+	Set periodic writeback, each @sync_bytes written bytes writeback is started
+	in background (no wait for disk)
+
+	PARAMS
+	@IN fa - pointer to appender
+	@IN sync_bytes - bytes between writebacks (0 means no periodic writeback)
+
+	RETURN:
+	%0 iff success
+	%Non-zero value iff failure
+*/
+int file_appender_set_sync(File_appender *fa, size_t sync_bytes);
+
+/*
+	Synchronize written data with file on disk (wait for disk)
+
+	PARAMS
+	@IN fa - pointer to appender
+
+	RETURN:
+	%0 iff success
+	%Non-zero value iff failure
+*/
+int file_appender_synch(File_appender *fa);
+
+/*
+	Get Buffer (whole file, valid until next append / reserve)
+
+	PARAMS
+	@IN fa - pointer to appender
+
+	RETURN:
+	%Pointer to buffer iff success
+	%NULL iff failure
+*/
+char *file_appender_get_buff(const File_appender *fa);
+
+/*
+	Get written size (position of write cursor)
+
+	PARAMS
+	@IN fa - pointer to appender
+
+	RETURN:
+	%Size iff success
+	%-1 iff failure
+*/
+ssize_t file_appender_get_size(const File_appender *fa);
+
+/*
+	Windowed mapping (huge files)
+
+	File is mapped by fixed size windows on demand, at most max_windows are mapped
+	at once (LRU), so address space and RSS are bounded.
+	Pointer returned by file_window_get / cursor is valid until max_windows other windows are used.
+	Size of file is read on create.
+
+	map_flag is added to MAP_SHARED (e.g MAP_POPULATE to prefault whole window),
+	madvise hints (MADV_SEQUENTIAL, MADV_RANDOM, MADV_WILLNEED, MADV_DONTNEED ...) can be passed to advise functions.
+
+	Cursor reads file sequentially window by window, and prefetches next window (readahead).
+
+    example:
+        File_window *fw = file_window_create_from_path("path_to_file", PROT_READ, O_RDONLY, 0, 0, 0);
+        File_window_cursor cursor;
+        const char *data;
+        ssize_t len;
+
+        file_window_set_advice(fw, MADV_SEQUENTIAL);
+        file_window_cursor_init(fw, &cursor, 0);
+        while ((len = file_window_cursor_next(&cursor, (const void **)&data)) > 0)
+            process(data, len);
+
+        file_window_destroy(fw);
+*/
+
+#define FILE_WINDOW_DEFAULT_SIZE	((size_t)1 << 26) /* 64MB */
+#define FILE_WINDOW_DEFAULT_NUM		8
+
+typedef struct File_window File_window;
+
+/*
+	Cursor for sequential scan, can be placed on stack, all fields are private
+*/
+typedef struct File_window_cursor
+{
+	File_window		*____fw;
+	size_t			____offset;
+} File_window_cursor;
+
+/*
+	Create windowed buffer, nothing is mapped here
+
+	PARAMS
+	@IN fd - file descriptor
+	@IN protect_flag - mmap protect flags
+	@IN map_flag - mmap flags added to MAP_SHARED (e.g MAP_POPULATE or 0)
+	@IN window_size - size of window (0 means FILE_WINDOW_DEFAULT_SIZE), rounded up to page size
+	@IN max_windows - max number of mapped windows (0 means FILE_WINDOW_DEFAULT_NUM)
+
+	RETURN:
+	%NULL iff failure
+	%Pointer to File_window iff success
+*/
+File_window *file_window_create(int fd, int protect_flag, int map_flag, size_t window_size, size_t max_windows);
+
+/*
+	Create windowed buffer
+
+	PARAMS
+	@IN path - path to file
+	@IN protect_flag - mmap protect flags
+	@IN open_flag - flags to open file
+	@IN map_flag - mmap flags added to MAP_SHARED (e.g MAP_POPULATE or 0)
+	@IN window_size - size of window (0 means FILE_WINDOW_DEFAULT_SIZE), rounded up to page size
+	@IN max_windows - max number of mapped windows (0 means FILE_WINDOW_DEFAULT_NUM)
+
+	RETURN:
+	%NULL iff failure
+	%Pointer to File_window iff success
+*/
+File_window *file_window_create_from_path(const char *path, int protect_flag, int open_flag, int map_flag, size_t window_size, size_t max_windows);
+
+/*
+	Unmap all windows and destroy structure
+
+	PARAMS
+	@IN fw - pointer to File_window
+
+	RETURN:
+	%0 iff success
+	%Non-zero value iff failure
+*/
+int file_window_destroy(File_window *fw);
+
+/*
+	Get pointer to file data at @offset
+
+	PARAMS
+	@IN fw - pointer to File_window
+	@IN offset - offset in file
+	@OUT len - number of bytes available from pointer (up to end of window)
+
+	RETURN:
+	%NULL iff failure (or offset >= file size)
+	%Pointer to data iff success
+*/
+void *file_window_get(File_window * ___restrict___ fw, size_t offset, size_t * ___restrict___ len);
+
+/*
+	Copy @size bytes from @offset to @buf (data can cross windows)
+
+	PARAMS
+	@IN fw - pointer to File_window
+	@IN offset - offset in file
+	@OUT buf - buffer
+	@IN size - number of bytes
+
+	RETURN:
+	%-1 iff failure
+	%Number of copied bytes iff success (less than size at end of file)
+*/
+ssize_t file_window_read(File_window * ___restrict___ fw, size_t offset, void * ___restrict___ buf, size_t size);
+
+/*
+	Set default madvise hint (MADV_NORMAL, MADV_SEQUENTIAL, MADV_RANDOM) for every window
+	(mapped and mapped in future), readahead of file is set also
+
+	PARAMS
+	@IN fw - pointer to File_window
+	@IN advice - MADV_* hint
+
+	RETURN:
+	%0 iff success
+	%Non-zero value iff failure
+*/
+int file_window_set_advice(File_window *fw, int advice);
+
+/*
+	Give hint for range of file (MADV_WILLNEED, MADV_DONTNEED ...),
+	for not mapped part of range WILLNEED starts readahead and DONTNEED drops page cache
+
+	PARAMS
+	@IN fw - pointer to File_window
+	@IN offset - begining of range
+	@IN size - size of range
+	@IN advice - MADV_* hint
+
+	RETURN:
+	%0 iff success
+	%Non-zero value iff failure
+*/
+int file_window_advise(File_window *fw, size_t offset, size_t size, int advice);
+
+/*
+	Get size of file
+
+	PARAMS
+	@IN fw - pointer to File_window
+
+	RETURN:
+	%Size iff success
+	%-1 iff failure
+*/
+ssize_t file_window_get_size(const File_window *fw);
+
+/*
+	Get number of mapped windows
+
+	PARAMS
+	@IN fw - pointer to File_window
+
+	RETURN:
+	%Number of windows iff success
+	%-1 iff failure
+*/
+ssize_t file_window_get_num_mapped(const File_window *fw);
+
+/*
+	Init cursor
+
+	PARAMS
+	@IN fw - pointer to File_window
+	@OUT cursor - pointer to cursor
+	@IN offset - start offset
+
+	RETURN:
+	%0 iff success
+	%Non-zero value iff failure
+*/
+int file_window_cursor_init(File_window * ___restrict___ fw, File_window_cursor * ___restrict___ cursor, size_t offset);
+
+/*
+	Get next chunk of file (from cursor to end of window) and move cursor after it
+
+	PARAMS
+	@IN cursor - pointer to cursor
+	@OUT data - pointer to chunk
+
+	RETURN:
+	%-1 iff failure
+	%0 iff end of file
+	%Size of chunk iff success
+*/
+ssize_t file_window_cursor_next(File_window_cursor * ___restrict___ cursor, const void ** ___restrict___ data);
+
+/*
+	Copy next @size bytes to @buf and move cursor
+
+	PARAMS
+	@IN cursor - pointer to cursor
+	@OUT buf - buffer
+	@IN size - number of bytes
+
+	RETURN:
+	%-1 iff failure
+	%Number of copied bytes iff success (0 at end of file)
+*/
+ssize_t file_window_cursor_read(File_window_cursor * ___restrict___ cursor, void * ___restrict___ buf, size_t size);
+
+/*
+	Get offset of cursor
+
+	PARAMS
+	@IN cursor - pointer to cursor
+
+	RETURN:
+	%Offset iff success
+	%-1 iff failure
+*/
+ssize_t file_window_cursor_get_offset(const File_window_cursor *cursor);
+
 #endif
@@ -4,6 +4,9 @@
 /*
     Simple drawing histogram in console
 
+    Streaming quantile sketches (quantile.h) are drawn as percentile distribution:
+    X axis is percentile in permille (500 is p50, 999 is p99.9), Y axis is value at percentile.
+
     Author: Michal Kukowski
     email: michalkukowski10@gmail.com
 
@@ -13,7 +16,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
-
+#include <quantile.h>
 
 /*
     Draw histogram for int only
@@ -41,4 +44,32 @@ int histogram_int_draw( const int64_t *x_values,
                         const char *y_legend,
                         bool reset);
 
+/*
+    Draw percentile distribution of HDR histogram
+
+    PARAMS
+    @IN h - pointer to Hdr_histogram
+    @IN title - your title
+    @IN reset - reset terminal before draw ?
+
+    RETURN
+    0 iff succes
+    Non-zero values iff failure
+*/
+int histogram_hdr_draw(const Hdr_histogram *h, const char *title, bool reset);
+
+/*
+    Draw percentile distribution of t-digest
+
+    PARAMS
+    @IN td - pointer to Tdigest
+    @IN title - your title
+    @IN reset - reset terminal before draw ?
+
+    RETURN
+    0 iff succes
+    Non-zero values iff failure
+*/
+int histogram_tdigest_draw(Tdigest *td, const char *title, bool reset);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,151 @@
+#ifndef KMERGE_H
+#define KMERGE_H
+
+/*
+    K-way merge by tournament (loser) tree
+
+    Tree keeps loser of each match in inner node and winner in root,
+    so after taking winner only matches on path from its leaf to root are replayed:
+    log2(k) comparisons per element instead of k - 1 (linear scan) or 2 * log2(k) (heap).
+    Merge is stable: on equal elements source with lower index wins.
+
+    Loser_tree works on heads (pointers to current elements) of any sources (arrays, iterators, files),
+    caller takes winner, moves its source and gives new head (NULL iff source is empty).
+
+    example:
+        Loser_tree *lt = loser_tree_create(k, cmp);
+
+        loser_tree_init(lt, heads);
+        while ((i = loser_tree_get_winner(lt)) != -1)
+        {
+            consume(loser_tree_get_top(lt));
+            loser_tree_replay(lt, next_of_source(i));
+        }
+
+        loser_tree_destroy(lt);
+
+    kmerge merges arrays, kmerge_int / uint / long / ulong are typed fast paths,
+    keys are kept in tree so there is no call of cmp.
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+
+    LICENCE: GPL 3.0
+*/
+
+#include <stddef.h>
+#include <sys/types.h>
+#include <common.h>
+
+typedef struct Loser_tree Loser_tree;
+
+/*
+    Create loser tree for k sources
+
+    PARAMS
+    @IN k - number of sources
+    @IN cmp - compare function
+
+    RETURN
+    NULL iff failure
+    Pointer to Loser_tree iff success
+*/
+Loser_tree *loser_tree_create(size_t k, cmp_f cmp);
+
+/*
+    Destroy loser tree
+
+    PARAMS
+    @IN lt - pointer to Loser_tree
+
+    RETURN
+    This is a void function
+*/
+void loser_tree_destroy(Loser_tree *lt);
+
+/*
+    Play all matches for new heads
+
+    PARAMS
+    @IN lt - pointer to Loser_tree
+    @IN heads - k pointers to first elements of sources (NULL iff source is empty)
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int loser_tree_init(Loser_tree *lt, const void * const *heads);
+
+/*
+    Get index of source with the smallest head
+
+    PARAMS
+    @IN lt - pointer to Loser_tree
+
+    RETURN
+    -1 iff all sources are empty (or failure)
+    Index of source iff success
+*/
+ssize_t loser_tree_get_winner(const Loser_tree *lt);
+
+/*
+    Get the smallest head
+
+    PARAMS
+    @IN lt - pointer to Loser_tree
+
+    RETURN
+    NULL iff all sources are empty (or failure)
+    Pointer to head iff success
+*/
+const void *loser_tree_get_top(const Loser_tree *lt);
+
+/*
+    Set new head of winner and replay its matches
+
+    PARAMS
+    @IN lt - pointer to Loser_tree
+    @IN head - next element of winner source (NULL iff source is empty)
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int loser_tree_replay(Loser_tree *lt, const void *head);
+
+/*
+    Merge k sorted arrays to out
+
+    PARAMS
+    @OUT out - array for sum of num_elements elements
+    @IN arrays - k sorted arrays
+    @IN num_elements - k sizes of arrays
+    @IN k - number of arrays
+    @IN cmp - compare function
+    @IN size_of - size of element
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int kmerge(void *out, const void * const *arrays, const size_t *num_elements, size_t k, cmp_f cmp, size_t size_of);
+
+/*
+    Merge k sorted arrays of integers to out (ascending order)
+
+    PARAMS
+    @OUT out - array for sum of num_elements elements
+    @IN arrays - k sorted arrays
+    @IN num_elements - k sizes of arrays
+    @IN k - number of arrays
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int kmerge_int(int *out, const int * const *arrays, const size_t *num_elements, size_t k);
+int kmerge_uint(unsigned int *out, const unsigned int * const *arrays, const size_t *num_elements, size_t k);
+int kmerge_long(long *out, const long * const *arrays, const size_t *num_elements, size_t k);
+int kmerge_ulong(unsigned long *out, const unsigned long * const *arrays, const size_t *num_elements, size_t k);
+
+#endif
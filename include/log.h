@@ -22,6 +22,9 @@
 
 	TRACE_MODE -> if defined trace_call works
 
+	TRACE_MODE_BINARY -> if defined TRACE writes binary record (site id, timestamp, thread id)
+	                     to trace file (see log_trace_init), decode it by tools/trace_decoder
+
     SILENT_ERROR -> if defined error logged errors
 
     Usage:
@@ -30,10 +33,26 @@
     2. Normal usage: TRACE, LOG, ERROR in your functions
     3. Clean log system: log_deinit
 
+    Runtime levels (DEBUG_MODE):
+    All LOG_* are compiled in, DEBUG_MODE level is a default level of file.
+    Level can be changed at runtime for all files or for one module (file name with or without extension)
+    by log_set_level / log_set_levels (also from LOG_LEVELS env, e.g LOG_LEVELS="avl=5,*=2").
+    Each LOG site caches its level, so disabled LOG costs one compare.
+    log_set_rate_limit enables token bucket per LOG site, log_set_rotation rotates log file by size.
+
+    Async mode:
+    After log_init call log_async_init, then LOG, TRACE and ERROR only put message
+    (format + raw arguments) to lock-free ring of calling thread,
+    formatting and writing is done by flusher thread in batches.
+    Order is kept per thread. FATAL flushes queue and is always synchronous.
+    log_deinit stops async mode (no thread can log during deinit).
+    In async mode strings passed to TRACE have to be static (as file and function names are).
+
 */
 
 #include <stdio.h> /* FILE* */
 #include <string.h>
+#include <stdint.h>
 
 #define PATH_TO_FILE (strrchr(__FILE__, '/') ? strrchr(__FILE__, '/') + 1 : __FILE__)
 
@@ -50,8 +69,110 @@
     #define DEBUG_LVL DEBUG_MODE
 #endif
 
+#define LOG_LEVEL_DEFAULT -1 /* level from DEBUG_MODE */
+#define LOG_LEVEL_MAX     15
+
 #define FATAL_EXIT_CODE 1
 
+/* Site of LOG (private), key = (levels generation << LOG_SITE_GEN_SHIFT) | cached level */
+#define LOG_SITE_GEN_SHIFT  4
+#define LOG_SITE_LEVEL_MASK ((1UL << LOG_SITE_GEN_SHIFT) - 1)
+
+typedef struct Log_site
+{
+    const char      *file;
+    int             line;
+    int             level;          /* DEBUG_LVL of file */
+    unsigned long   key;
+    uint64_t        tokens;         /* rate limit, in 1/1000000 of message */
+    uint64_t        last;           /* rate limit, last refill in ns */
+    unsigned        suppressed;     /* dropped by rate limit since last message */
+} Log_site;
+
+/* Changed each time when levels are changed (private) */
+extern unsigned long __log_levels_gen__;
+
+/*
+    Slow path of LOG site check (private)
+
+    PARAMS
+    @IN site - LOG site
+    @IN level - level of message
+
+    RETURN
+    1 iff message should be logged
+    0 iff message should be dropped
+*/
+int __log_site_slow(Log_site *site, int level);
+
+/*
+    Check whether LOG site is enabled (private)
+
+    PARAMS
+    @IN site - LOG site
+    @IN level - level of message
+
+    RETURN
+    1 iff message should be logged
+    0 iff message should be dropped
+*/
+static ___inline___ int __log_site_check(Log_site *site, int level)
+{
+    /*
+        When site key is outdated, subtraction wraps, so disabled message
+        with valid key is the only case which is filtered here
+    */
+    if (likely(__atomic_load_n(&site->key, __ATOMIC_RELAXED) -
+               (__atomic_load_n(&__log_levels_gen__, __ATOMIC_RELAXED) << LOG_SITE_GEN_SHIFT) < (unsigned long)level))
+        return 0;
+
+    return __log_site_slow(site, level);
+}
+
+/*
+    Binary trace file:
+    Log_trace_header, site table (num_sites * (Log_trace_site_entry + file + func)),
+    then from data_offset chunks of chunk_size bytes.
+    Each chunk is owned by one thread and keeps Log_trace_records,
+    record with ts == 0 ends chunk.
+*/
+#define LOG_TRACE_SECTION   "log_trace_sites"
+#define LOG_TRACE_MAGIC     "KKTRACE"
+#define LOG_TRACE_VERSION   1
+
+typedef struct Log_trace_site
+{
+    const char  *file;
+    const char  *func;
+    int         line;
+} Log_trace_site;
+
+typedef struct Log_trace_header
+{
+    char        magic[8];       /* LOG_TRACE_MAGIC */
+    uint32_t    version;
+    uint32_t    num_sites;
+    uint64_t    ticks_per_sec;  /* timestamp frequency */
+    uint64_t    chunk_size;
+    uint64_t    data_offset;    /* offset of first chunk */
+    uint64_t    pid;
+} Log_trace_header;
+
+typedef struct Log_trace_site_entry
+{
+    uint32_t    line;
+    uint16_t    file_len;
+    uint16_t    func_len;
+    /* file, func (without '\0') */
+} Log_trace_site_entry;
+
+typedef struct Log_trace_record
+{
+    uint32_t    site;
+    uint32_t    tid;
+    uint64_t    ts;
+} Log_trace_record;
+
 /* PRIVATE MACROS TO GET [H | T ] from __VA_ARGS__ */
 #define LOG_ARGS_HEAD(...) _LOG_ARGS_HEAD(__VA_ARGS__, "")
 #define _LOG_ARGS_HEAD(H, ...) H
@@ -60,12 +181,31 @@
 #define _LOG_ARGS_TAIL(H, ...) __VA_ARGS__
 
 /* PRIVATE LOG MACROS */
+#ifdef DEBUG_MODE
+#define LOG_LEVEL(LVL, ...) \
+    do { \
+        static Log_site ____log_site____ = {__FILE__, __LINE__, DEBUG_LVL, 0, 0, 0, 0}; \
+        if (__log_site_check(&____log_site____, LVL)) \
+            _LOG_LEVEL(LVL, LOG_ARGS_HEAD(__VA_ARGS__), LOG_ARGS_TAIL(__VA_ARGS__)); \
+    } while (0)
+#else
 #define LOG_LEVEL(LVL, ...) _LOG_LEVEL(LVL, LOG_ARGS_HEAD(__VA_ARGS__), LOG_ARGS_TAIL(__VA_ARGS__))
+#endif
 #define _LOG_LEVEL(LVL, msg, ...) __LOG("[LOG %d]\t%s:%s.%d\t" msg "%s", (int)LVL, PATH_TO_FILE, __func__,  __LINE__, __VA_ARGS__)
 #define __LOG(msg, ...) __log__(msg, __VA_ARGS__)
 
 /* PRIVATE TRACE MACROS */
+#ifdef TRACE_MODE_BINARY
+/* each TRACE has own site in LOG_TRACE_SECTION, site id is an index in this section */
+#define _TRACE() \
+    do { \
+        static const Log_trace_site ____log_trace_site____ \
+            __attribute__(( section(LOG_TRACE_SECTION), used, aligned(8) )) = {__FILE__, __func__, __LINE__}; \
+        __trace_binary__(&____log_trace_site____); \
+    } while (0)
+#else
 #define _TRACE() __trace_call__("[TRACE]\t%s:%s\n", PATH_TO_FILE, __func__)
+#endif
 
 /* PRIVATE ERROR MACROS */
 #define ERROR_LOG(...) _ERROR_LOG(LVL, LOG_ARGS_HEAD(__VA_ARGS__), LOG_ARGS_TAIL(__VA_ARGS__))
@@ -104,31 +244,31 @@ static ___inline___ void __attribute__(( format(printf,1, 2) )) __trash__(const
 #define ERROR(msg, ...) _ERROR(msg, __VA_ARGS__)
 #define FATAL(...) _FATAL(__VA_ARGS__)
 
-#if DEBUG_LVL >= LOG_LEVEL_CRIT
+#ifdef DEBUG_MODE
     #define LOG_CRIT(...) LOG_LEVEL(LOG_LEVEL_CRIT, __VA_ARGS__)
 #else
     #define LOG_CRIT(...) __trash__(__VA_ARGS__)
 #endif
 
-#if DEBUG_LVL >= LOG_LEVEL_WARNING
+#ifdef DEBUG_MODE
     #define LOG_WARN(...) LOG_LEVEL(LOG_LEVEL_WARNING, __VA_ARGS__)
 #else
     #define LOG_WARN(...) __trash__(__VA_ARGS__)
 #endif
 
-#if DEBUG_LVL >= LOG_LEVEL_INFO
+#ifdef DEBUG_MODE
     #define LOG_INFO(...) LOG_LEVEL(LOG_LEVEL_INFO, __VA_ARGS__)
 #else
     #define LOG_INFO(...) __trash__(__VA_ARGS__)
 #endif
 
-#if DEBUG_LVL >= LOG_LEVEL_NOTICE
+#ifdef DEBUG_MODE
     #define LOG_NTCE(...) LOG_LEVEL(LOG_LEVEL_NOTICE, __VA_ARGS__)
 #else
     #define LOG_NTCE(...) __trash__(__VA_ARGS__)
 #endif
 
-#if DEBUG_LVL >= LOG_LEVEL_DEBUG
+#ifdef DEBUG_MODE
     #define LOG_DEBG(...) LOG_LEVEL(LOG_LEVEL_DEBUG, __VA_ARGS__)
 #else
     #define LOG_DEBG(...) __trash__(__VA_ARGS__)
@@ -139,6 +279,12 @@ static ___inline___ void __attribute__(( format(printf,1, 2) )) __trash__(const
 #define NO_LOG_TO_FILE  0
 #define LOG_TO_FILE     1
 
+#define LOG_ROTATE_MAX_FILES 99
+
+/* What to do when ring of thread is full in async mode */
+#define LOG_ASYNC_DROP  0
+#define LOG_ASYNC_BLOCK 1
+
 /*
 	Simple log function
 	FUNCTION WORKS IFF DEBUG_MODE is defined
@@ -164,6 +310,18 @@ void __attribute__(( format(printf,1, 2) )) __log__(const char *msg, ...);
 */
 void __attribute__(( format(printf,1, 2) ))  __trace_call__(const char *msg, ...);
 
+/*
+	Binary trace function
+	FUNCTION WORKS IFF log_trace_init has been called
+
+	PARAMS
+	@IN site - trace site
+
+	RETURN:
+	This is a void function
+*/
+void __trace_binary__(const Log_trace_site *site);
+
 /*
 	Simple log error function
 	FUNCTION WORKS IFF SILENT_ERROR is not defined
@@ -235,4 +393,160 @@ FILE *log_get_fd(void);
 */
 FILE *log_get_file(void);
 
+/*
+    Set runtime level of module (DEBUG_MODE)
+
+    PARAMS
+    @IN module - file name with or without extension (avl.c or avl), NULL or "*" means all files
+    @IN level - new level (0 - LOG_LEVEL_MAX) or LOG_LEVEL_DEFAULT to back to DEBUG_MODE level
+
+    RETURN
+    0 iff success
+    non-zero value iff failure
+*/
+int log_set_level(const char *module, int level);
+
+/*
+    Get runtime level of module
+
+    PARAMS
+    @IN module - file name with or without extension, NULL or "*" means all files
+
+    RETURN
+    LOG_LEVEL_DEFAULT iff level is not set
+    Level iff success
+*/
+int log_get_level(const char *module);
+
+/*
+    Set runtime levels from string "module=level,...", "*=level" or "level" set level of all files
+
+    PARAMS
+    @IN spec - levels (e.g "avl=5,rbt.c=3,*=1")
+
+    RETURN
+    0 iff success
+    non-zero value iff failure (levels before error are set)
+*/
+int log_set_levels(const char *spec);
+
+/*
+    Set rate limit (token bucket) for each LOG site
+
+    PARAMS
+    @IN per_sec - messages per second per site (0 means no limit)
+    @IN burst - max messages in burst
+
+    RETURN
+    This is a void function
+*/
+void log_set_rate_limit(unsigned per_sec, unsigned burst);
+
+/*
+    Get number of messages dropped by rate limit
+
+    PARAMS
+    NO PARAMS
+
+    RETURN
+    Number of dropped messages
+*/
+size_t log_get_rate_limited(void);
+
+/*
+    Rotate log file (LOG_TO_FILE) when it is bigger than max_bytes,
+    file.log is moved to file.log.1, file.log.1 to file.log.2 ... up to file.log.max_files
+
+    PARAMS
+    @IN max_bytes - max size of log file (0 means no rotation)
+    @IN max_files - number of kept old files (0 means truncate)
+
+    RETURN
+    0 iff success
+    non-zero value iff failure
+*/
+int log_set_rotation(size_t max_bytes, unsigned max_files);
+
+/*
+    Start async logging (call after log_init)
+
+    PARAMS
+    @IN ring_size - size of ring per thread in bytes (0 means default)
+    @IN policy - LOG_ASYNC_DROP (drop new messages) or LOG_ASYNC_BLOCK (wait for flusher) when ring is full
+
+    RETURN
+    0 iff success
+    non-zero value iff failure
+*/
+int log_async_init(size_t ring_size, int policy);
+
+/*
+    Write all queued messages and stop async logging
+
+    PARAMS
+    NO PARAMS
+
+    RETURN
+    This is a void function
+*/
+void log_async_deinit(void);
+
+/*
+    Wait until all messages queued before call are written
+
+    PARAMS
+    NO PARAMS
+
+    RETURN
+    0 iff success
+    non-zero value iff async mode is off
+*/
+int log_async_flush(void);
+
+/*
+    Get number of messages dropped due to full ring (LOG_ASYNC_DROP policy)
+
+    PARAMS
+    NO PARAMS
+
+    RETURN
+    Number of dropped messages
+*/
+size_t log_async_get_dropped(void);
+
+/*
+    Is async mode on ?
+
+    PARAMS
+    NO PARAMS
+
+    RETURN
+    1 iff async mode is on
+    0 iff async mode is off
+*/
+int log_async_is_enabled(void);
+
+/*
+    Start binary tracing (TRACE_MODE_BINARY) to file
+
+    PARAMS
+    @IN path - path to trace file (NULL means ./logs/trace_<pid>.bin)
+
+    RETURN
+    0 iff success
+    non-zero value iff failure
+*/
+int log_trace_init(const char *path);
+
+/*
+    Stop binary tracing
+
+    PARAMS
+    NO PARAMS
+
+    RETURN
+    This is a void function
+*/
+void log_trace_deinit(void);
+
 #endif
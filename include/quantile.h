@@ -0,0 +1,309 @@
+#ifndef QUANTILE_H
+#define QUANTILE_H
+
+/*
+    Streaming quantiles in constant memory (no buffering of samples)
+
+    Tdigest - merging t-digest of doubles.
+    Samples are buffered and merged with centroids (sorted means with weights) in batches,
+    size of centroid is bounded by q * (1 - q) (k2 scale), so centroids on tails are tiny
+    and p99 / p99.9 are accurate, number of centroids is ~compression.
+    Digests are mergeable: keep one per thread, merge them for report.
+    Tdigest is not thread safe.
+
+    Hdr_histogram - HDR-like log bucketed histogram of uint64 (e.g. latencies in ns).
+    Values are counted in buckets [2^e, 2^(e + 1)) split into 2^(precision_bits - 1) sub buckets,
+    so value at quantile has relative error < 2^(1 - precision_bits) and record is O(1).
+    Counters are split into shards, hdr_histogram_record_concurrent increments shard of calling thread
+    by relaxed atomic (lock-free, no shared cacheline between threads with different shards).
+    Readers sum shards, so they can run in parallel with writers. Histograms with the same params are mergeable.
+
+    example:
+        Hdr_histogram *h = hdr_histogram_create(BIT(40), 8, 16);
+
+        // workers
+        hdr_histogram_record_concurrent(h, latency_ns);
+
+        // reporter
+        p99 = hdr_histogram_get_quantile(h, 0.99);
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+
+    LICENCE: GPL 3.0
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#define TDIGEST_DEFAULT_COMPRESSION     100.0
+
+#define HDR_HISTOGRAM_MIN_PRECISION     2
+#define HDR_HISTOGRAM_MAX_PRECISION     16
+#define HDR_HISTOGRAM_MAX_SHARDS        256
+
+typedef struct Tdigest Tdigest;
+typedef struct Hdr_histogram Hdr_histogram;
+
+/*
+    Create t-digest
+
+    PARAMS
+    @IN compression - accuracy (~number of centroids), e.g. TDIGEST_DEFAULT_COMPRESSION
+
+    RETURN
+    NULL iff failure
+    Pointer to Tdigest iff success
+*/
+Tdigest *tdigest_create(double compression);
+
+/*
+    Destroy t-digest
+
+    PARAMS
+    @IN td - pointer to Tdigest
+
+    RETURN
+    This is a void function
+*/
+void tdigest_destroy(Tdigest *td);
+
+/*
+    Add sample to t-digest
+
+    PARAMS
+    @IN td - pointer to Tdigest
+    @IN value - sample
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int tdigest_add(Tdigest *td, double value);
+
+/*
+    Add sample with weight (e.g. number of the same samples)
+
+    PARAMS
+    @IN td - pointer to Tdigest
+    @IN value - sample
+    @IN weight - weight of sample (> 0)
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int tdigest_add_weighted(Tdigest *td, double value, double weight);
+
+/*
+    Merge src to dst (src is not changed)
+
+    PARAMS
+    @IN dst - pointer to Tdigest
+    @IN src - pointer to Tdigest
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int tdigest_merge(Tdigest *dst, Tdigest *src);
+
+/*
+    Get estimated value at quantile q
+
+    PARAMS
+    @IN td - pointer to Tdigest
+    @IN q - quantile from [0.0, 1.0] (0.99 is p99)
+    @OUT value - estimated value
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure (also when digest is empty)
+*/
+int tdigest_get_quantile(Tdigest *td, double q, double *value);
+
+/*
+    Get total weight of samples
+
+    PARAMS
+    @IN td - pointer to Tdigest
+
+    RETURN
+    Total weight (0 iff failure)
+*/
+double tdigest_get_count(const Tdigest *td);
+
+/*
+    Get number of centroids (memory usage)
+
+    PARAMS
+    @IN td - pointer to Tdigest
+
+    RETURN
+    Number of centroids (after merge of buffered samples)
+*/
+size_t tdigest_get_num_centroids(Tdigest *td);
+
+/*
+    Remove all samples
+
+    PARAMS
+    @IN td - pointer to Tdigest
+
+    RETURN
+    This is a void function
+*/
+void tdigest_reset(Tdigest *td);
+
+/*
+    Create HDR histogram
+
+    PARAMS
+    @IN highest - highest trackable value (bigger values are counted as highest)
+    @IN precision_bits - bits of precision, relative error < 2^(1 - precision_bits)
+    @IN shards - number of shards for hdr_histogram_record_concurrent (1 iff only one writer)
+
+    RETURN
+    NULL iff failure
+    Pointer to Hdr_histogram iff success
+*/
+Hdr_histogram *hdr_histogram_create(uint64_t highest, unsigned precision_bits, size_t shards);
+
+/*
+    Destroy HDR histogram
+
+    PARAMS
+    @IN h - pointer to Hdr_histogram
+
+    RETURN
+    This is a void function
+*/
+void hdr_histogram_destroy(Hdr_histogram *h);
+
+/*
+    Record value (only one writer)
+
+    PARAMS
+    @IN h - pointer to Hdr_histogram
+    @IN value - value
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int hdr_histogram_record(Hdr_histogram *h, uint64_t value);
+
+/*
+    Record value count times (only one writer)
+
+    PARAMS
+    @IN h - pointer to Hdr_histogram
+    @IN value - value
+    @IN count - number of values
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int hdr_histogram_record_n(Hdr_histogram *h, uint64_t value, uint64_t count);
+
+/*
+    Record value, can be called from many threads (lock-free, shard of thread)
+
+    PARAMS
+    @IN h - pointer to Hdr_histogram
+    @IN value - value
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int hdr_histogram_record_concurrent(Hdr_histogram *h, uint64_t value);
+
+/*
+    Add counts of src to dst, histograms must have the same highest and precision
+
+    PARAMS
+    @IN dst - pointer to Hdr_histogram
+    @IN src - pointer to Hdr_histogram
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int hdr_histogram_merge(Hdr_histogram *dst, const Hdr_histogram *src);
+
+/*
+    Get value at quantile q (highest value equivalent to bucket)
+
+    PARAMS
+    @IN h - pointer to Hdr_histogram
+    @IN q - quantile from [0.0, 1.0]
+
+    RETURN
+    Value at quantile (0 iff histogram is empty or failure)
+*/
+uint64_t hdr_histogram_get_quantile(const Hdr_histogram *h, double q);
+
+/*
+    Get values at many quantiles in one pass
+
+    PARAMS
+    @IN h - pointer to Hdr_histogram
+    @IN qs - ascending sorted quantiles
+    @IN num_qs - number of quantiles
+    @OUT values - values at quantiles
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int hdr_histogram_get_quantiles(const Hdr_histogram *h, const double *qs, size_t num_qs, uint64_t *values);
+
+/*
+    Get number of recorded values
+
+    PARAMS
+    @IN h - pointer to Hdr_histogram
+
+    RETURN
+    Number of values
+*/
+uint64_t hdr_histogram_get_count(const Hdr_histogram *h);
+
+/*
+    Get min / max of recorded values
+
+    PARAMS
+    @IN h - pointer to Hdr_histogram
+
+    RETURN
+    Exact min / max (0 iff histogram is empty)
+*/
+uint64_t hdr_histogram_get_min(const Hdr_histogram *h);
+uint64_t hdr_histogram_get_max(const Hdr_histogram *h);
+
+/*
+    Get mean of recorded values (from buckets)
+
+    PARAMS
+    @IN h - pointer to Hdr_histogram
+
+    RETURN
+    Mean (0.0 iff histogram is empty)
+*/
+double hdr_histogram_get_mean(const Hdr_histogram *h);
+
+/*
+    Remove all values (must not race with writers)
+
+    PARAMS
+    @IN h - pointer to Hdr_histogram
+
+    RETURN
+    This is a void function
+*/
+void hdr_histogram_reset(Hdr_histogram *h);
+
+#endif
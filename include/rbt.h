@@ -149,6 +149,24 @@ int rbt_max(const Rbt * ___restrict___ tree, void * ___restrict___ data);
  */
  bool rbt_key_exist(const Rbt * ___restrict___ tree, const void * ___restrict___ data_key);
 
+/*
+    Search for many keys at once, lookups are interleaved: every lane walks
+    one level and prefetches next node, so cache misses of lookups overlap
+
+    PARAMS
+    @IN tree - pointer to tree
+    @IN data_keys - array of num_keys data with search keys
+    @IN num_keys - number of keys
+    @OUT data_out - array for num_keys data (only found are written) or NULL
+    @OUT found - array of num_keys flags (true iff key exists) or NULL
+
+    RETURN:
+    -1 iff failure
+    Number of found keys iff success
+*/
+ssize_t rbt_search_batch(const Rbt * ___restrict___ tree, const void * ___restrict___ data_keys, size_t num_keys,
+                        void * ___restrict___ data_out, bool * ___restrict___ found);
+
 /*
     Delete data with key equals @data_key ( using cmp )
 
@@ -0,0 +1,383 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+/*
+    Event loop (reactor) for non-blocking TCP servers and clients
+
+    Reactor waits on edge-triggered epoll, so each socket is drained (read / accept until EAGAIN)
+    when event comes. Every connection has own input and output buffer:
+    handler gets data from input buffer (on_read) and writes to output buffer,
+    what cannot be sent now is sent when socket becomes writable.
+    Both buffers are limited by REACTOR_MAX_BUFFER: when input is full, on_read is called
+    and connection is closed if handler does not consume anything,
+    write which does not fit in output fails (check reactor_conn_get_pending to slow down producer).
+    When process is out of descriptors, new connections are accepted and closed immediately,
+    so they don't wait in listen queue forever.
+
+    Timers are kept in min heap, epoll_wait sleeps until the nearest deadline.
+
+    Reactor is single threaded, all callbacks are called from reactor_run,
+    only reactor_stop can be called from other threads.
+    For many cores use Reactor_pool: N reactors (1 per thread) listen on the same port (SO_REUSEPORT),
+    kernel balances new connections between them.
+
+    example (echo server):
+        void on_read(Reactor_conn *conn, void *arg)
+        {
+            size_t len;
+            const char *data = reactor_conn_get_input(conn, &len);
+
+            reactor_conn_write(conn, data, len);
+            reactor_conn_consume(conn, len);
+        }
+
+        Reactor_handlers handlers = { .on_read = on_read };
+        Reactor *r = reactor_create();
+
+        reactor_listen(r, "localhost", 8080, &handlers, false);
+        reactor_run(r);
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+
+    LICENCE: GPL 3.0
+*/
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <common.h>
+
+#define REACTOR_MAX_EVENTS      256         /* events taken by one epoll_wait */
+#define REACTOR_READ_CHUNK      BIT(14)     /* min free space in input buffer before read */
+#define REACTOR_MAX_BUFFER      BIT(24)     /* max bytes in input / output buffer of connection */
+
+typedef struct Reactor Reactor;
+typedef struct Reactor_conn Reactor_conn;
+typedef struct Reactor_timer Reactor_timer;
+typedef struct Reactor_pool Reactor_pool;
+
+/* All callbacks are optional (NULL) */
+typedef struct Reactor_handlers
+{
+    void (*on_open)(Reactor_conn *conn, void *arg);     /* connection accepted / connected */
+    void (*on_read)(Reactor_conn *conn, void *arg);     /* new data in input buffer */
+    void (*on_close)(Reactor_conn *conn, void *arg);    /* connection closed (by peer, error or reactor_conn_close) */
+    void *arg;
+} Reactor_handlers;
+
+typedef void (*reactor_timer_f)(Reactor *reactor, Reactor_timer *timer, void *arg);
+
+/*
+    Create reactor
+
+    PARAMS
+    NO PARAMS
+
+    RETURN
+    NULL iff failure
+    Pointer to new Reactor iff success
+*/
+Reactor *reactor_create(void);
+
+/*
+    Close all listeners and connections (on_close is called), cancel timers and destroy reactor
+
+    PARAMS
+    @IN reactor - pointer to Reactor
+
+    RETURN
+    This is a void function
+*/
+void reactor_destroy(Reactor *reactor);
+
+/*
+    Listen on host:port, accepted connections use handlers
+
+    PARAMS
+    @IN reactor - pointer to Reactor
+    @IN host_name - host name
+    @IN port - port
+    @IN handlers - callbacks for accepted connections (copied)
+    @IN reuseport - set SO_REUSEPORT (many reactors on the same port)
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int reactor_listen(Reactor * ___restrict___ reactor, const char * ___restrict___ host_name, int port,
+                   const Reactor_handlers * ___restrict___ handlers, bool reuseport);
+
+/*
+    Start non-blocking connection to host:port, on_open is called when connection is established
+
+    PARAMS
+    @IN reactor - pointer to Reactor
+    @IN host_name - host name
+    @IN port - port
+    @IN handlers - callbacks for connection (copied)
+
+    RETURN
+    NULL iff failure
+    Pointer to new connection iff success
+*/
+Reactor_conn *reactor_connect(Reactor * ___restrict___ reactor, const char * ___restrict___ host_name, int port,
+                              const Reactor_handlers * ___restrict___ handlers);
+
+/*
+    Write data to connection, data which cannot be sent now is buffered
+    Write fails and nothing is written when buffered data + size > REACTOR_MAX_BUFFER
+
+    PARAMS
+    @IN conn - pointer to connection
+    @IN data - data
+    @IN size - number of bytes
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int reactor_conn_write(Reactor_conn * ___restrict___ conn, const void * ___restrict___ data, size_t size);
+
+/*
+    Get not consumed data from input buffer
+
+    PARAMS
+    @IN conn - pointer to connection
+    @OUT size - number of bytes
+
+    RETURN
+    NULL iff failure
+    Pointer to data iff success (valid until next reactor call on this connection)
+*/
+const void *reactor_conn_get_input(const Reactor_conn * ___restrict___ conn, size_t * ___restrict___ size);
+
+/*
+    Remove first size bytes from input buffer
+
+    PARAMS
+    @IN conn - pointer to connection
+    @IN size - number of bytes
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int reactor_conn_consume(Reactor_conn *conn, size_t size);
+
+/*
+    Close connection, on_close is called
+    Output which cannot be sent without blocking is dropped
+    Memory is freed after current events batch, so conn is still valid in callbacks
+
+    PARAMS
+    @IN conn - pointer to connection
+
+    RETURN
+    This is a void function
+*/
+void reactor_conn_close(Reactor_conn *conn);
+
+/*
+    Get socket of connection
+
+    PARAMS
+    @IN conn - pointer to connection
+
+    RETURN
+    -1 iff failure (or connection is closed)
+    Socket iff success
+*/
+int reactor_conn_get_fd(const Reactor_conn *conn);
+
+/*
+    Get number of buffered, not sent bytes
+
+    PARAMS
+    @IN conn - pointer to connection
+
+    RETURN
+    -1 iff failure
+    Number of bytes iff success
+*/
+ssize_t reactor_conn_get_pending(const Reactor_conn *conn);
+
+/*
+    Get reactor of connection
+
+    PARAMS
+    @IN conn - pointer to connection
+
+    RETURN
+    NULL iff failure
+    Pointer to Reactor iff success
+*/
+Reactor *reactor_conn_get_reactor(const Reactor_conn *conn);
+
+/*
+    Set / get user data of connection
+
+    PARAMS
+    @IN conn - pointer to connection
+    @IN data - user data
+
+    RETURN
+    (set) This is a void function
+    (get) User data or NULL
+*/
+void reactor_conn_set_data(Reactor_conn *conn, void *data);
+void *reactor_conn_get_data(const Reactor_conn *conn);
+
+/*
+    Add timer
+
+    PARAMS
+    @IN reactor - pointer to Reactor
+    @IN delay_ms - first expiration after delay_ms
+    @IN interval_ms - period, 0 means one-shot timer
+    @IN cb - callback
+    @IN arg - callback argument
+
+    RETURN
+    NULL iff failure
+    Pointer to timer iff success (one-shot timer is freed after callback)
+*/
+Reactor_timer *reactor_timer_add(Reactor *reactor, uint64_t delay_ms, uint64_t interval_ms, reactor_timer_f cb, void *arg);
+
+/*
+    Cancel timer (can be called in timer callback)
+
+    PARAMS
+    @IN timer - pointer to timer
+
+    RETURN
+    This is a void function
+*/
+void reactor_timer_cancel(Reactor_timer *timer);
+
+/*
+    Get number of active timers
+
+    PARAMS
+    @IN reactor - pointer to Reactor
+
+    RETURN
+    -1 iff failure
+    Number of timers iff success
+*/
+ssize_t reactor_get_num_timers(const Reactor *reactor);
+
+/*
+    Get number of open connections
+
+    PARAMS
+    @IN reactor - pointer to Reactor
+
+    RETURN
+    -1 iff failure
+    Number of connections iff success
+*/
+ssize_t reactor_get_num_conns(const Reactor *reactor);
+
+/*
+    Wait for events at most timeout_ms and handle them with expired timers
+
+    PARAMS
+    @IN reactor - pointer to Reactor
+    @IN timeout_ms - timeout, -1 means wait until event or timer
+
+    RETURN
+    -1 iff failure
+    Number of handled events and timers iff success
+*/
+ssize_t reactor_run_once(Reactor *reactor, int timeout_ms);
+
+/*
+    Handle events until reactor_stop
+
+    PARAMS
+    @IN reactor - pointer to Reactor
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int reactor_run(Reactor *reactor);
+
+/*
+    Stop reactor_run (thread safe)
+
+    PARAMS
+    @IN reactor - pointer to Reactor
+
+    RETURN
+    This is a void function
+*/
+void reactor_stop(Reactor *reactor);
+
+/*
+    Create pool of reactors, each reactor runs in own thread
+
+    PARAMS
+    @IN num_reactors - number of reactors
+
+    RETURN
+    NULL iff failure
+    Pointer to new Reactor_pool iff success
+*/
+Reactor_pool *reactor_pool_create(size_t num_reactors);
+
+/*
+    Stop threads and destroy all reactors
+
+    PARAMS
+    @IN pool - pointer to Reactor_pool
+
+    RETURN
+    This is a void function
+*/
+void reactor_pool_destroy(Reactor_pool *pool);
+
+/*
+    Each reactor listens on host:port (SO_REUSEPORT), call before reactor_pool_start
+
+    PARAMS
+    @IN pool - pointer to Reactor_pool
+    @IN host_name - host name
+    @IN port - port
+    @IN handlers - callbacks for accepted connections
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int reactor_pool_listen(Reactor_pool * ___restrict___ pool, const char * ___restrict___ host_name, int port,
+                        const Reactor_handlers * ___restrict___ handlers);
+
+/*
+    Run reactors in threads
+
+    PARAMS
+    @IN pool - pointer to Reactor_pool
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int reactor_pool_start(Reactor_pool *pool);
+
+/*
+    Get i-th reactor (to add timers or connections before reactor_pool_start)
+
+    PARAMS
+    @IN pool - pointer to Reactor_pool
+    @IN i - index
+
+    RETURN
+    NULL iff failure
+    Pointer to Reactor iff success
+*/
+Reactor *reactor_pool_get(const Reactor_pool *pool, size_t i);
+
+#endif
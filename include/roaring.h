@@ -0,0 +1,251 @@
+#ifndef ROARING_H
+#define ROARING_H
+
+/*
+    Implementation of compressed bitmap (Roaring bitmap)
+
+    Universe of 32bit unsigned integers is divided into 64K chunks (by high 16 bits),
+    each non empty chunk is kept in one of containers:
+        ARRAY   - sorted array of low 16 bits ( cardinality <= 4096 )
+        BITMAP  - 65536 bits ( cardinality > 4096 )
+        RUN     - sorted array of pairs (start, length - 1) ( created by roaring_run_optimize )
+
+    Serialized format (all fields are little endian, so format is portable):
+        [uint32 magic][uint32 num_containers]
+        num_containers * [uint16 key][uint8 type][uint8 reserved][uint32 cardinality][uint32 size][uint32 offset]
+        payloads: ARRAY - size * uint16, RUN - size * 2 * uint16, BITMAP - 1024 * uint64
+    The same on 32 and 64bit targets.
+
+    Buffer does not need any alignment, so it can be read directly from File_buffer mapping
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+
+    LICENCE: GPL 3.0
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <generic.h>
+#include <sys/types.h>
+#include <iterators.h>
+#include <common.h>
+
+typedef struct Roaring Roaring;
+typedef struct Roaring_iterator Roaring_iterator;
+
+/*
+    Iterator returns values (uint32_t) in ascending order,
+    get_node returns value too
+*/
+IT_FUNC(Roaring, roaring)
+
+/*
+    Create empty roaring bitmap
+
+    PARAMS
+    NO PARAMS
+
+    RETURN
+    NULL iff failure
+    Pointer to new roaring bitmap iff success
+*/
+Roaring *roaring_create(void);
+
+/*
+    Create roaring bitmap from array of values
+
+    PARAMS
+    @IN values - array of values (does not need to be sorted)
+    @IN num_values - length of array
+
+    RETURN
+    NULL iff failure
+    Pointer to new roaring bitmap iff success
+*/
+Roaring *roaring_create_from_array(const uint32_t *values, size_t num_values);
+
+/*
+    Destroy roaring bitmap
+
+    PARAMS
+    @IN roaring - pointer to roaring bitmap
+
+    RETURN
+    This is a void function
+*/
+void roaring_destroy(Roaring *roaring);
+
+/*
+    Make a copy of roaring bitmap
+
+    PARAMS
+    @IN roaring - pointer to roaring bitmap
+
+    RETURN
+    NULL iff failure
+    Pointer to new roaring bitmap iff success
+*/
+Roaring *roaring_clone(const Roaring *roaring);
+
+/*
+    Add value to roaring bitmap
+
+    PARAMS
+    @IN roaring - pointer to roaring bitmap
+    @IN val - value to add
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int roaring_add(Roaring *roaring, uint32_t val);
+
+/*
+    Remove value from roaring bitmap
+
+    PARAMS
+    @IN roaring - pointer to roaring bitmap
+    @IN val - value to remove
+
+    RETURN
+    0 iff success (also when value doesn't exist)
+    Non-zero value iff failure
+*/
+int roaring_remove(Roaring *roaring, uint32_t val);
+
+/*
+    Check existence of value in roaring bitmap
+
+    PARAMS
+    @IN roaring - pointer to roaring bitmap
+    @IN val - value to check
+
+    RETURN
+    true iff value exists
+    false iff value doesn't exist or failure
+*/
+bool roaring_contains(const Roaring *roaring, uint32_t val);
+
+/*
+    Get number of values in roaring bitmap
+
+    PARAMS
+    @IN roaring - pointer to roaring bitmap
+
+    RETURN
+    -1 iff failure
+    Cardinality iff success
+*/
+ssize_t roaring_get_cardinality(const Roaring *roaring);
+
+/*
+    Get minimum / maximum value from roaring bitmap
+
+    PARAMS
+    @IN roaring - pointer to roaring bitmap
+    @OUT val - min / max value
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure (e.g empty bitmap)
+*/
+int roaring_min(const Roaring * ___restrict___ roaring, uint32_t * ___restrict___ val);
+int roaring_max(const Roaring * ___restrict___ roaring, uint32_t * ___restrict___ val);
+
+/*
+    Convert containers to RUN containers iff they are smaller in RUN form
+
+    PARAMS
+    @IN roaring - pointer to roaring bitmap
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int roaring_run_optimize(Roaring *roaring);
+
+/*
+    Create new roaring bitmap as union / intersection / difference (r1 \ r2) of r1 and r2
+
+    PARAMS
+    @IN r1 - pointer to 1st roaring bitmap
+    @IN r2 - pointer to 2nd roaring bitmap
+
+    RETURN
+    NULL iff failure
+    Pointer to new roaring bitmap iff success
+*/
+Roaring *roaring_union(const Roaring *r1, const Roaring *r2);
+Roaring *roaring_intersection(const Roaring *r1, const Roaring *r2);
+Roaring *roaring_difference(const Roaring *r1, const Roaring *r2);
+
+/*
+    Get all values as sorted array
+
+    PARAMS
+    @IN roaring - pointer to roaring bitmap
+    @OUT size - length of array
+
+    RETURN
+    NULL iff failure (or empty bitmap)
+    Pointer to new allocated array iff success
+*/
+uint32_t *roaring_to_array(const Roaring * ___restrict___ roaring, size_t * ___restrict___ size);
+
+/*
+    Get size of roaring bitmap in serialized form
+
+    PARAMS
+    @IN roaring - pointer to roaring bitmap
+
+    RETURN
+    -1 iff failure
+    Number of bytes needed by roaring_serialize iff success
+*/
+ssize_t roaring_serialized_size(const Roaring *roaring);
+
+/*
+    Serialize roaring bitmap into buffer
+
+    PARAMS
+    @IN roaring - pointer to roaring bitmap
+    @OUT buf - buffer
+    @IN size - size of buffer in bytes
+
+    RETURN
+    -1 iff failure
+    Number of written bytes iff success
+*/
+ssize_t roaring_serialize(const Roaring * ___restrict___ roaring, void * ___restrict___ buf, size_t size);
+
+/*
+    Create roaring bitmap from serialized buffer
+
+    PARAMS
+    @IN buf - buffer (e.g file_buffer_get_buff)
+    @IN size - size of buffer in bytes
+
+    RETURN
+    NULL iff failure (e.g corrupted buffer)
+    Pointer to new roaring bitmap iff success
+*/
+Roaring *roaring_deserialize(const void *buf, size_t size);
+
+/*
+    Check existence of value directly in serialized buffer (without deserialization)
+
+    PARAMS
+    @IN buf - buffer (e.g file_buffer_get_buff)
+    @IN size - size of buffer in bytes
+    @IN val - value to check
+
+    RETURN
+    -1 iff failure (e.g corrupted buffer)
+    0 iff value doesn't exist
+    1 iff value exists
+*/
+int roaring_serialized_contains(const void *buf, size_t size, uint32_t val);
+
+#endif
@@ -4,6 +4,17 @@
 /*
     Implementation of basic search algorithms
 
+    Binary searches are branchless (conditional move instead of jump) and prefetch
+    both possible next midpoints, so mispredictions and cache misses do not serialize.
+
+    Typed versions (_int, _uint, _long, _ulong) do not call cmp:
+    - unsorted: SIMD linear search (AVX2 / SSE2 iff compiled with), the fastest for small arrays
+    - sorted: branchless binary search
+    - interpolation: for uniformly distributed keys O(log log n), after 4 steps which drop
+      less than 3/4 of range falls back to binary search, so worst case is still O(log n)
+    - eytzinger: array in BFS order of implicit search tree (eytzinger_build), next levels
+      are prefetched in one cache line, the fastest for big read-mostly arrays
+
     Author: Michal Kukowski
     email: michalkukowski10@gmail.com
 
@@ -82,5 +93,164 @@ ssize_t find_first_sorted(const void * ___restrict___ key, const void * ___restr
 */
 ssize_t find_last_sorted(const void * ___restrict___ key, const void * ___restrict___ t, size_t num_elements, cmp_f cmp, size_t size_of);
 
+/*
+    Find First occurrence of every key from @keys in sorted array @t,
+    binary searches of group of keys are interleaved level by level and next probe of every key
+    is prefetched, so cache misses of lookups overlap (much faster than find_first_sorted in loop
+    for arrays bigger than cache)
+
+    PARAMS
+    @IN keys - array of num_keys data with keys to find
+    @IN num_keys - number of keys
+    @IN t - array
+    @IN num_elements - number of elements
+    @IN cmp - compare func
+    @IN size_of - data size of (the same for keys and t)
+    @OUT pos - array of num_keys indexes (-1 iff key doesn't exist in array)
+
+    RETURN
+    -1 iff failure
+    Number of found keys iff success
+*/
+ssize_t find_first_sorted_batch(const void * ___restrict___ keys, size_t num_keys, const void * ___restrict___ t, size_t num_elements,
+                                cmp_f cmp, size_t size_of, ssize_t * ___restrict___ pos);
+
+/*
+    Build Eytzinger (BFS order of implicit binary search tree) layout of sorted array,
+    children of node i are 2i + 1 and 2i + 2. Use the same function to layout payloads.
+
+    PARAMS
+    @IN sorted - sorted array
+    @IN num_elements - number of elements
+    @IN size_of - data size of
+    @OUT out - array for num_elements elements in Eytzinger layout
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int eytzinger_build(const void * ___restrict___ sorted, size_t num_elements, size_t size_of, void * ___restrict___ out);
+
+/*
+    Find first element >= @key in array @t in Eytzinger layout
+
+    PARAMS
+    @IN key - data with key to find
+    @IN t - array in Eytzinger layout
+    @IN num_elements - number of elements
+    @IN cmp - compare func
+    @IN size_of - data size of
+
+    RETURN
+    -1 iff all elements are < key or failure
+    Index in array t (Eytzinger layout) iff success
+*/
+ssize_t eytzinger_lower_bound(const void * ___restrict___ key, const void * ___restrict___ t, size_t num_elements, cmp_f cmp, size_t size_of);
+
+/*
+    Find First / Last occurrence of @key in unsorted array @t by SIMD
+
+    PARAMS
+    @IN key - key to find
+    @IN t - array
+    @IN num_elements - number of elements
+
+    RETURN
+    -1 iff key doesn't exist in array
+    Index in array where is key
+*/
+ssize_t find_first_unsorted_int(int key, const int *t, size_t num_elements);
+ssize_t find_first_unsorted_uint(unsigned int key, const unsigned int *t, size_t num_elements);
+ssize_t find_first_unsorted_long(long key, const long *t, size_t num_elements);
+ssize_t find_first_unsorted_ulong(unsigned long key, const unsigned long *t, size_t num_elements);
+
+ssize_t find_last_unsorted_int(int key, const int *t, size_t num_elements);
+ssize_t find_last_unsorted_uint(unsigned int key, const unsigned int *t, size_t num_elements);
+ssize_t find_last_unsorted_long(long key, const long *t, size_t num_elements);
+ssize_t find_last_unsorted_ulong(unsigned long key, const unsigned long *t, size_t num_elements);
+
+/*
+    Find First / Last occurrence of @key in sorted array @t by branchless binary search
+
+    PARAMS
+    @IN key - key to find
+    @IN t - sorted array
+    @IN num_elements - number of elements
+
+    RETURN
+    -1 iff key doesn't exist in array
+    Index in array where is key
+*/
+ssize_t find_first_sorted_int(int key, const int *t, size_t num_elements);
+ssize_t find_first_sorted_uint(unsigned int key, const unsigned int *t, size_t num_elements);
+ssize_t find_first_sorted_long(long key, const long *t, size_t num_elements);
+ssize_t find_first_sorted_ulong(unsigned long key, const unsigned long *t, size_t num_elements);
+
+ssize_t find_last_sorted_int(int key, const int *t, size_t num_elements);
+ssize_t find_last_sorted_uint(unsigned int key, const unsigned int *t, size_t num_elements);
+ssize_t find_last_sorted_long(long key, const long *t, size_t num_elements);
+ssize_t find_last_sorted_ulong(unsigned long key, const unsigned long *t, size_t num_elements);
+
+/*
+    Get lower bound (first element >= key) / upper bound (first element > key)
+    in sorted array @t by branchless binary search
+
+    PARAMS
+    @IN key - key
+    @IN t - sorted array
+    @IN num_elements - number of elements
+
+    RETURN
+    -1 iff failure
+    Index of bound iff success (num_elements iff there is no such element)
+*/
+ssize_t find_lower_bound_int(int key, const int *t, size_t num_elements);
+ssize_t find_lower_bound_uint(unsigned int key, const unsigned int *t, size_t num_elements);
+ssize_t find_lower_bound_long(long key, const long *t, size_t num_elements);
+ssize_t find_lower_bound_ulong(unsigned long key, const unsigned long *t, size_t num_elements);
+
+ssize_t find_upper_bound_int(int key, const int *t, size_t num_elements);
+ssize_t find_upper_bound_uint(unsigned int key, const unsigned int *t, size_t num_elements);
+ssize_t find_upper_bound_long(long key, const long *t, size_t num_elements);
+ssize_t find_upper_bound_ulong(unsigned long key, const unsigned long *t, size_t num_elements);
+
+/*
+    Find First occurrence of @key in sorted array @t by interpolation search
+
+    PARAMS
+    @IN key - key to find
+    @IN t - sorted array (the best for uniformly distributed keys)
+    @IN num_elements - number of elements
+
+    RETURN
+    -1 iff key doesn't exist in array
+    Index in array where is key
+*/
+ssize_t find_first_interpolation_int(int key, const int *t, size_t num_elements);
+ssize_t find_first_interpolation_uint(unsigned int key, const unsigned int *t, size_t num_elements);
+ssize_t find_first_interpolation_long(long key, const long *t, size_t num_elements);
+ssize_t find_first_interpolation_ulong(unsigned long key, const unsigned long *t, size_t num_elements);
+
+/*
+    Find lower bound (first element >= key) / occurrence of @key in array @t in Eytzinger layout
+
+    PARAMS
+    @IN key - key to find
+    @IN t - array in Eytzinger layout (eytzinger_build)
+    @IN num_elements - number of elements
+
+    RETURN
+    -1 iff there is no such element
+    Index in array t (Eytzinger layout) iff success
+*/
+ssize_t eytzinger_lower_bound_int(int key, const int *t, size_t num_elements);
+ssize_t eytzinger_lower_bound_uint(unsigned int key, const unsigned int *t, size_t num_elements);
+ssize_t eytzinger_lower_bound_long(long key, const long *t, size_t num_elements);
+ssize_t eytzinger_lower_bound_ulong(unsigned long key, const unsigned long *t, size_t num_elements);
+
+ssize_t eytzinger_find_int(int key, const int *t, size_t num_elements);
+ssize_t eytzinger_find_uint(unsigned int key, const unsigned int *t, size_t num_elements);
+ssize_t eytzinger_find_long(long key, const long *t, size_t num_elements);
+ssize_t eytzinger_find_ulong(unsigned long key, const unsigned long *t, size_t num_elements);
 
-#endif
\ No newline at end of file
+#endif
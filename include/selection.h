@@ -4,6 +4,23 @@
 /*
     Implementation of selection algorithms like select_kth
 
+    Selection is introselect: pivot from Floyd-Rivest sample for big ranges
+    (pivot lands just behind kth element, so ~n + min(k, n - k) comparisons),
+    tukey medians for small ranges and median of medians after log2(n) bad splits,
+    so worst case is O(n). Partitioning is 3-way, so duplicates are cheap.
+
+    select_multi_inplace finds many order statistics (e.g. all percentiles) at once,
+    each partition is shared by all ks in range: O(n * log(num_ks)) instead of O(n * num_ks).
+
+    example (p1 .. p99):
+        size_t ks[99];
+
+        for (i = 0; i < 99; ++i)
+            ks[i] = (len - 1) * (i + 1) / 100;
+
+        select_multi_inplace(samples, len, sizeof(*samples), ks, 99, cmp_double);
+        p50 = samples[ks[49]];
+
     Author: Michal Kukowski
     email: michalkukowski10@gmail.com
 
@@ -30,4 +47,38 @@
 */
 ssize_t select_kth(const void *t, size_t len, size_t size_of, size_t k, cmp_f cmp);
 
+/*
+    Rearrange array t so kth positional statistic is on index k,
+    elements before k are <= t[k], elements after k are >= t[k] (no copy of array)
+
+    PARAMS
+    @IN t - array
+    @IN len - array len
+    @IN size_of - size_of array element
+    @IN k - kth element to find (from 0 to len - 1)
+    @IN cmp - compare function
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int select_kth_inplace(void *t, size_t len, size_t size_of, size_t k, cmp_f cmp);
+
+/*
+    Rearrange array t so every kth positional statistic from ks is on index k (like select_kth_inplace for each k)
+
+    PARAMS
+    @IN t - array
+    @IN len - array len
+    @IN size_of - size_of array element
+    @IN ks - ascending sorted ks (duplicates are allowed)
+    @IN num_ks - number of ks
+    @IN cmp - compare function
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int select_multi_inplace(void *t, size_t len, size_t size_of, const size_t *ks, size_t num_ks, cmp_f cmp);
+
 #endif
\ No newline at end of file
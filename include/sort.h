@@ -37,8 +37,40 @@
 */
 
 #include <stddef.h> /* size_t */
+#include <stdbool.h>
 #include <common.h>
 
+/*
+    sort() picks algorithm from tuning table, one entry per class of size_of:
+    size_of <= 4, 8, 16, 32, 64, 128, 256 and 512 (also used for bigger, calibrated with 512).
+    Default table is the same for all classes (insort < 32, binsort < 128, quicksort, not indirect),
+    sort_calibrate measures crossover points on running machine,
+    sort_tuning_save / sort_tuning_load keep table in text file (see tools/sort_tune).
+    Calibrated table is used only when loaded: before main from file in SORT_TUNING env
+    (e.g SORT_TUNING=/etc/sort_tuning.txt ./app) or by calling sort_tuning_load.
+*/
+#define SORT_TUNING_NUM_CLASSES     8
+
+/*
+    How sort_by_key compares key bytes:
+    BYTES - like memcmp (strings, big endian numbers)
+    UNSIGNED / SIGNED - native integer of size 1, 2, 4 or 8
+*/
+typedef enum SORT_KEY_TYPE
+{
+    SORT_KEY_BYTES = 0,
+    SORT_KEY_UNSIGNED,
+    SORT_KEY_SIGNED
+} SORT_KEY_TYPE;
+
+typedef struct Sort_tuning
+{
+    size_t  size_of;            /* class: elements with size <= size_of (last class: every bigger element too) */
+    size_t  insort_threshold;   /* insort iff num_elements < insort_threshold */
+    size_t  binsort_threshold;  /* binsort iff num_elements < binsort_threshold, otherwise quicksort */
+    bool    indirect;           /* quicksort pointers to elements and then move every element once */
+} Sort_tuning;
+
 /*
     Define for insort, please check insort funciton description
 */
@@ -141,4 +173,175 @@ int quicksort(void *t, size_t num_elements, cmp_f cmp, size_t size_of);
 */
 int sort(void *t, size_t num_elements, cmp_f cmp, size_t size_of);
 
+/*
+    Indirect sort: sort array of pointers to elements, then permute t in place,
+    so every element is copied at most once (good for big records)
+
+    PARAMS
+    @IN t - array
+    @IN num_element - number of element in array t
+    @IN cmp - function to compare 2 element in array t ( see example of cmp function )
+    @IN size_of - size of element in array t
+
+    RETURN:
+    %0 if success
+    %Non-zero value if failure
+*/
+int sort_indirect(void *t, size_t num_elements, cmp_f cmp, size_t size_of);
+
+/*
+    Argsort: t is not changed, perm[i] is an index of element which should be on position i
+
+    PARAMS
+    @IN t - array
+    @IN num_element - number of element in array t
+    @IN cmp - function to compare 2 element in array t ( see example of cmp function )
+    @IN size_of - size of element in array t
+    @OUT perm - array of num_elements indexes
+
+    RETURN:
+    %0 if success
+    %Non-zero value if failure
+*/
+int argsort(const void *t, size_t num_elements, cmp_f cmp, size_t size_of, size_t *perm);
+
+/*
+    Apply permutation from argsort to t in place (following cycles),
+    so every element is copied at most once
+
+    PARAMS
+    @IN t - array
+    @IN num_element - number of element in array t
+    @IN size_of - size of element in array t
+    @IN perm - permutation of [0, num_elements), it is not changed,
+               out of range or duplicated index is an error
+
+    RETURN:
+    %0 if success
+    %Non-zero value if failure
+*/
+int sort_permute(void *t, size_t num_elements, size_t size_of, const size_t *perm);
+
+/*
+    Stable argsort by key: key is copied to compact array with indexes
+    and sorted by LSD radix sort, elements are not touched during sorting
+
+    PARAMS
+    @IN t - array
+    @IN num_element - number of element in array t
+    @IN size_of - size of element in array t
+    @IN key_offset - offset of key in element
+    @IN key_size - size of key (1, 2, 4, 8 for integers)
+    @IN type - how to compare keys
+    @OUT perm - array of num_elements indexes
+
+    RETURN:
+    %0 if success
+    %Non-zero value if failure
+*/
+int argsort_by_key(const void *t, size_t num_elements, size_t size_of,
+                   size_t key_offset, size_t key_size, SORT_KEY_TYPE type, size_t *perm);
+
+/*
+    Stable sort by key: argsort_by_key and then move every element once
+
+    PARAMS
+    @IN t - array
+    @IN num_element - number of element in array t
+    @IN size_of - size of element in array t
+    @IN key_offset - offset of key in element
+    @IN key_size - size of key (1, 2, 4, 8 for integers)
+    @IN type - how to compare keys
+
+    RETURN:
+    %0 if success
+    %Non-zero value if failure
+*/
+int sort_by_key(void *t, size_t num_elements, size_t size_of,
+                size_t key_offset, size_t key_size, SORT_KEY_TYPE type);
+
+/*
+    Define for sort_by_key, key is a member of struct TYPE
+
+    e.i
+    SORT_BY_KEY(rows, n, Row, id, SORT_KEY_UNSIGNED);
+*/
+#define SORT_BY_KEY(ARRAY, NUM, TYPE, MEMBER, KEY_TYPE) \
+    (sort_by_key(ARRAY, NUM, sizeof(TYPE), offsetof(TYPE, MEMBER), sizeof(((TYPE *)0)->MEMBER), KEY_TYPE))
+
+/*
+    Get tuning of class with elements of size size_of
+
+    PARAMS
+    @IN size_of - size of element
+    @OUT tuning - tuning of class
+
+    RETURN:
+    %0 if success
+    %Non-zero value if failure
+*/
+int sort_tuning_get(size_t size_of, Sort_tuning *tuning);
+
+/*
+    Set tuning of class tuning->size_of (it has to be one of the class sizes)
+    Tuning table is global, change it before sorting in other threads
+
+    PARAMS
+    @IN tuning - new tuning
+
+    RETURN:
+    %0 if success
+    %Non-zero value if failure
+*/
+int sort_tuning_set(const Sort_tuning *tuning);
+
+/*
+    Restore default tuning table
+
+    PARAMS
+    NO PARAMS
+
+    RETURN:
+    This is a void function
+*/
+void sort_tuning_reset(void);
+
+/*
+    Measure insort / binsort / quicksort / indirect sort for each class on running machine
+    (records with int key) and set tuning table, it takes a few seconds
+
+    PARAMS
+    NO PARAMS
+
+    RETURN:
+    %0 if success
+    %Non-zero value if failure
+*/
+int sort_calibrate(void);
+
+/*
+    Save tuning table to text file, line per class: size_of insort_threshold binsort_threshold indirect
+
+    PARAMS
+    @IN path - path to file
+
+    RETURN:
+    %0 if success
+    %Non-zero value if failure
+*/
+int sort_tuning_save(const char *path);
+
+/*
+    Load tuning table from file created by sort_tuning_save,
+    table is changed only when whole file is correct
+
+    PARAMS
+    @IN path - path to file
+
+    RETURN:
+    %0 if success
+    %Non-zero value if failure
+*/
+int sort_tuning_load(const char *path);
+
 #endif
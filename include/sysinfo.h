@@ -0,0 +1,27 @@
+#ifndef SYSINFO_H
+#define SYSINFO_H
+
+/*
+    Information about running system shared by libs
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+
+    LICENCE: GPL3.0
+*/
+
+#include <stddef.h>
+
+/*
+    Get amount of memory available for new allocations
+    (MemAvailable from /proc/meminfo, free pages iff it is not present)
+
+    PARAMS
+    NO PARAMS
+
+    RETURN
+    Available memory in bytes
+*/
+size_t sysinfo_get_available_memory(void);
+
+#endif
@@ -3,7 +3,11 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h> /* struct iovec */
 #include <netdb.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <compiler.h>
 
 /*
     Simple library for TCP unix sockets
@@ -11,6 +15,16 @@
     Author: Michal Kukowski
     email: michalkukowski10@gmail.com
 
+    Zero-copy transfers:
+        tcp_sendfile - file -> socket in kernel (no copy to user space)
+        tcp_splice - any fd (pipe, socket, file) -> socket through pipe in kernel
+        tcp_writev - header + body in one syscall without joining them in user buffer
+        Tcp_zerocopy - MSG_ZEROCOPY, kernel sends pages of user buffer,
+                       buffer can be reused when completion of send comes (worth for buffers > ~10KB)
+
+    On blocking socket all data is sent, on non-blocking socket
+    functions return number of bytes sent before EAGAIN
+
     LICENCE: GPL3.0
 */
 
@@ -27,6 +41,37 @@
 */
 int tcp_socket_create(const char *host_name, int port);
 
+/* flags for tcp_socket_create_with_flags */
+#define TCP_SOCKET_REUSEADDR    1   /* SO_REUSEADDR, bind even if old connections are in TIME_WAIT */
+#define TCP_SOCKET_REUSEPORT    2   /* SO_REUSEPORT, many sockets (e.g 1 per thread) on the same port */
+#define TCP_SOCKET_NONBLOCK     4   /* O_NONBLOCK */
+
+/*
+    Get socket for tcp connection using by server with options
+
+    PARAMS
+    @IN host_name - host name
+    @IN port - port
+    @IN flags - TCP_SOCKET_* flags
+
+    RETURN
+    New binded Socket iff success
+    -1 iff failure
+*/
+int tcp_socket_create_with_flags(const char *host_name, int port, int flags);
+
+/*
+    Set socket in non-blocking mode
+
+    PARAMS
+    @IN socket - socket
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int tcp_set_nonblocking(int socket);
+
 /*
     Destroy socket (close fd)
 
@@ -63,4 +108,134 @@ int tcp_request_connection(const char *host_name, int port);
 */
 int tcp_accept_connection(int s);
 
-#endif
\ No newline at end of file
+/*
+    Send count bytes of file from offset to socket (sendfile)
+
+    PARAMS
+    @IN socket - socket
+    @IN fd - file descriptor (has to support mmap, e.g regular file)
+    @IN offset - offset in file, updated (NULL means current file position)
+    @IN count - number of bytes
+
+    RETURN
+    -1 iff failure
+    Number of sent bytes iff success (less than count on EOF or EAGAIN)
+*/
+ssize_t tcp_sendfile(int socket, int fd, off_t *offset, size_t count);
+
+/*
+    Send count bytes from fd to socket via pipe in kernel (splice)
+
+    PARAMS
+    @IN socket - socket
+    @IN fd - file descriptor (pipe, socket or file)
+    @IN offset - offset in file, updated (NULL for pipes, sockets or current file position)
+    @IN count - number of bytes
+
+    RETURN
+    -1 iff failure
+    Number of sent bytes iff success (less than count on EOF or EAGAIN on fd)
+*/
+ssize_t tcp_splice(int socket, int fd, off_t *offset, size_t count);
+
+/*
+    Send buffers (e.g header + body) by one syscall, partial writes are continued
+
+    PARAMS
+    @IN socket - socket
+    @IN iov - buffers
+    @IN iovcnt - number of buffers
+
+    RETURN
+    -1 iff failure
+    Number of sent bytes iff success
+*/
+ssize_t tcp_writev(int socket, const struct iovec *iov, int iovcnt);
+
+/* MSG_ZEROCOPY sender, each successful send gets id (0, 1, 2 ...) */
+typedef struct Tcp_zerocopy
+{
+    int         ____socket;
+    uint32_t    ____next_id;    /* id of next send */
+    uint32_t    ____completed;  /* sends with id < completed are done, buffers can be reused */
+    uint64_t    ____copied;     /* sends where kernel copied data anyway (e.g loopback) */
+} Tcp_zerocopy;
+
+/*
+    Enable MSG_ZEROCOPY on socket
+
+    PARAMS
+    @IN zc - pointer to Tcp_zerocopy
+    @IN socket - connected tcp socket
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure (e.g kernel < 4.14)
+*/
+int tcp_zerocopy_init(Tcp_zerocopy *zc, int socket);
+
+/*
+    Send buffer without copy, buffer can't be modified or freed until send is completed.
+    When pinned memory limit is reached and no send is pending, chunk is copied by plain send
+
+    PARAMS
+    @IN zc - pointer to Tcp_zerocopy
+    @IN buf - buffer
+    @IN size - size of buffer
+    @OUT id - id of last send (for tcp_zerocopy_is_done), untouched if nothing was sent without copy, can be NULL
+
+    RETURN
+    -1 iff failure
+    Number of sent bytes iff success
+*/
+ssize_t tcp_zerocopy_send(Tcp_zerocopy * ___restrict___ zc, const void * ___restrict___ buf, size_t size, uint32_t * ___restrict___ id);
+
+/*
+    Read completions from socket error queue
+
+    PARAMS
+    @IN zc - pointer to Tcp_zerocopy
+    @IN timeout_ms - wait for first completion, 0 means don't wait, -1 wait forever
+
+    RETURN
+    -1 iff failure
+    Number of new completed sends iff success
+*/
+ssize_t tcp_zerocopy_reap(Tcp_zerocopy *zc, int timeout_ms);
+
+/*
+    Check whether buffer of send id can be reused
+
+    PARAMS
+    @IN zc - pointer to Tcp_zerocopy
+    @IN id - id from tcp_zerocopy_send
+
+    RETURN
+    true iff send is completed
+    false iff send is in flight
+*/
+bool tcp_zerocopy_is_done(const Tcp_zerocopy *zc, uint32_t id);
+
+/*
+    Get number of sends in flight
+
+    PARAMS
+    @IN zc - pointer to Tcp_zerocopy
+
+    RETURN
+    Number of sends in flight
+*/
+uint32_t tcp_zerocopy_get_pending(const Tcp_zerocopy *zc);
+
+/*
+    Get number of sends where kernel made a copy (zero copy is not possible on this path)
+
+    PARAMS
+    @IN zc - pointer to Tcp_zerocopy
+
+    RETURN
+    Number of copied sends
+*/
+uint64_t tcp_zerocopy_get_copied(const Tcp_zerocopy *zc);
+
+#endif
@@ -4,6 +4,19 @@
 /*
     Simple library for TLS connection
 
+    Contexts keep sessions in cache and server sends session tickets,
+    so client can resume session (tls_get_session -> tls_request_connection_with_session,
+    previous connection has to be closed by tls_shutdown)
+    without full handshake (no certificate verification, no key exchange with RSA / ECDHE signing).
+
+    For event loops handshake can be done step by step on non-blocking socket:
+    tls_accept_start / tls_connect_start, then tls_handshake whenever fd is ready
+    (TLS_HANDSHAKE_WANT_READ / TLS_HANDSHAKE_WANT_WRITE says on what to wait).
+
+    Kernel TLS (tls_context_enable_ktls, OpenSSL >= 3.0 and tls kernel module):
+    after handshake record encryption is done by kernel, so tls_sendfile sends file without copy to user space.
+    Without kTLS tls_sendfile reads file and writes it by SSL_write.
+
     Author: Michal Kukowski
     email: michalkukowski10@gmail.com
 
@@ -11,6 +24,17 @@
 */
 
 #include <openssl/ssl.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+#define TLS_SESSION_CACHE_SIZE      20480   /* sessions in server cache */
+#define TLS_SESSION_TIMEOUT         7200    /* lifetime of session in seconds */
+
+/* tls_handshake results */
+#define TLS_HANDSHAKE_DONE          0
+#define TLS_HANDSHAKE_WANT_READ     1       /* call again when fd is readable */
+#define TLS_HANDSHAKE_WANT_WRITE    2       /* call again when fd is writable */
+#define TLS_HANDSHAKE_ERROR         -1
 
 
 /*
@@ -92,6 +116,33 @@ SSL_CTX *tls_server_context_create(const char *cert, const char *key, int (*veri
 */
 SSL_CTX *tls_client_context_create(const char *cert, const char *key, int (*verify_callback)(int preverify, X509_STORE_CTX* ctx));
 
+/*
+    Configure session resumption (contexts are created with cache of TLS_SESSION_CACHE_SIZE and tickets)
+
+    PARAMS
+    @IN ctx - tls context
+    @IN cache_size - max number of sessions in cache, 0 turns cache off
+    @IN timeout - lifetime of session in seconds
+    @IN tickets - send session tickets (stateless resumption)
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int tls_context_set_session_cache(SSL_CTX *ctx, long cache_size, long timeout, bool tickets);
+
+/*
+    Enable kernel TLS for connections of context
+
+    PARAMS
+    @IN ctx - tls context
+
+    RETURN
+    0 iff success (kTLS is used iff kernel and cipher support it, see tls_ktls_send_enabled)
+    Non-zero value iff failure (OpenSSL without kTLS)
+*/
+int tls_context_enable_ktls(SSL_CTX *ctx);
+
 /*
     Destroy TLS context
 
@@ -129,6 +180,126 @@ SSL *tls_accept(SSL_CTX *ctx, int fd);
 */
 SSL *tls_request_connection(SSL_CTX *ctx, int fd);
 
+/*
+    Request for TLS connection resuming session
+
+    PARAMS
+    @IN ctx - tls context where connection will be added
+    @IN fd - connection file descriptor
+    @IN session - session from previous connection or NULL (full handshake)
+
+    RETURN
+    NULL iff failure
+    NEW pointer to SSL connection iff success
+*/
+SSL *tls_request_connection_with_session(SSL_CTX *ctx, int fd, SSL_SESSION *session);
+
+/*
+    Create SSL for server / client side without handshake, use tls_handshake
+
+    PARAMS
+    @IN ctx - tls context where connection will be added
+    @IN fd - connection file descriptor (non-blocking)
+    @IN session - (client) session to resume or NULL
+
+    RETURN
+    NULL iff failure
+    NEW pointer to SSL connection iff success
+*/
+SSL *tls_accept_start(SSL_CTX *ctx, int fd);
+SSL *tls_connect_start(SSL_CTX *ctx, int fd, SSL_SESSION *session);
+
+/*
+    Make next step of handshake
+
+    PARAMS
+    @IN ssl - ssl from tls_accept_start / tls_connect_start
+
+    RETURN
+    TLS_HANDSHAKE_DONE iff handshake is finished
+    TLS_HANDSHAKE_WANT_READ iff handshake needs data from peer
+    TLS_HANDSHAKE_WANT_WRITE iff socket is full
+    TLS_HANDSHAKE_ERROR iff failure
+*/
+int tls_handshake(SSL *ssl);
+
+/*
+    Get session of connection to resume it later
+    In TLS 1.3 server sends session after handshake, so get it after first read
+
+    PARAMS
+    @IN ssl - ssl
+
+    RETURN
+    NULL iff failure (or there is no resumable session)
+    Pointer to session iff success (free by tls_session_destroy)
+*/
+SSL_SESSION *tls_get_session(SSL *ssl);
+
+/*
+    Free session
+
+    PARAMS
+    @IN session - session
+
+    RETURN
+    This is a void function
+*/
+void tls_session_destroy(SSL_SESSION *session);
+
+/*
+    Check whether connection resumed session (abbreviated handshake)
+
+    PARAMS
+    @IN ssl - ssl
+
+    RETURN
+    true iff session was resumed
+    false iff full handshake was made
+*/
+bool tls_session_reused(const SSL *ssl);
+
+/*
+    Check whether records are encrypted by kernel
+
+    PARAMS
+    @IN ssl - ssl after handshake
+
+    RETURN
+    true iff kTLS is used for sending
+    false iff OpenSSL encrypts records
+*/
+bool tls_ktls_send_enabled(SSL *ssl);
+
+/*
+    Send size bytes of file from offset (blocking connection)
+    With kTLS it is sendfile, otherwise file is read and sent by SSL_write
+
+    PARAMS
+    @IN ssl - ssl
+    @IN fd - file descriptor
+    @IN offset - offset in file
+    @IN size - number of bytes
+
+    RETURN
+    -1 iff failure
+    Number of sent bytes iff success (less than size on EOF)
+*/
+ssize_t tls_sendfile(SSL *ssl, int fd, off_t offset, size_t size);
+
+/*
+    Send close_notify to peer
+    Session of connection destroyed without shutdown is treated as broken and can't be resumed
+
+    PARAMS
+    @IN ssl - ssl
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int tls_shutdown(SSL *ssl);
+
 /*
     Destroy SSL
 
@@ -589,4 +589,111 @@ IT_FUNC_CONTAINER(Tree, tree)
         return concat(prefix, _end)((const type *)it); \
     }
 
+
+/*
+    Macro to create batched search (prefix_search_batch) for binary tree
+    with fields root, cmp, size_of and nodes with fields data, left_son, right_son.
+
+    LANES lookups are in flight, every lane does one step in round
+    and prefetches next node, so cache misses of different keys overlap.
+
+    PARAMS
+    @IN type - tree type
+    @IN node_type - node type
+    @IN prefix - function prefix
+    @IN lanes - number of lookups in flight
+    @IN leaf - value of missing son (NULL or sentinel)
+*/
+#define TREE_SEARCH_BATCH_CREATE(type, node_type, prefix, lanes, leaf) \
+    ssize_t concat(prefix, _search_batch)(const type * ___restrict___ tree, const void * ___restrict___ data_keys, size_t num_keys, \
+                                          void * ___restrict___ data_out, bool * ___restrict___ found) \
+    { \
+        node_type *lane_node[lanes]; \
+        size_t lane_key[lanes]; \
+        node_type *node; \
+        const BYTE *key; \
+        size_t num_lanes; \
+        size_t active; \
+        size_t next; \
+        size_t i; \
+        ssize_t num_found; \
+        int res; \
+        \
+        TRACE(); \
+        \
+        if (tree == NULL) \
+            ERROR("tree == NULL\n", -1); \
+        \
+        if (data_keys == NULL) \
+            ERROR("data_keys == NULL\n", -1); \
+        \
+        if (num_keys == 0) \
+            ERROR("num_keys == 0\n", -1); \
+        \
+        if (found != NULL) \
+            for (i = 0; i < num_keys; ++i) \
+                found[i] = false; \
+        \
+        if (tree->root == (leaf)) \
+            return 0; \
+        \
+        next = 0; \
+        while (next < (lanes) && next < num_keys) \
+        { \
+            lane_node[next] = tree->root; \
+            lane_key[next] = next; \
+            ++next; \
+        } \
+        \
+        num_lanes = next; \
+        active = next; \
+        num_found = 0; \
+        \
+        /* every lane does one step in round, nodes prefetched in previous round are in cache */ \
+        while (active > 0) \
+            for (i = 0; i < num_lanes; ++i) \
+            { \
+                node = lane_node[i]; \
+                if (node == NULL) \
+                    continue; \
+                \
+                key = (const BYTE *)data_keys + lane_key[i] * tree->size_of; \
+                res = tree->cmp(node->data, key); \
+                if (res != 0) \
+                { \
+                    node = res > 0 ? node->left_son : node->right_son; \
+                    if (node != (leaf)) \
+                    { \
+                        load_to_cache(node, CACHE_READ, CACHE_SAVE_NORMAL_PRIO); \
+                        lane_node[i] = node; \
+                        continue; \
+                    } \
+                } \
+                else \
+                { \
+                    ++num_found; \
+                    if (found != NULL) \
+                        found[lane_key[i]] = true; \
+                    \
+                    if (data_out != NULL) \
+                        __ASSIGN__(*((BYTE *)data_out + lane_key[i] * tree->size_of), *(BYTE *)node->data, tree->size_of); \
+                } \
+                \
+                /* lookup is done, lane takes next key */ \
+                if (next < num_keys) \
+                { \
+                    lane_node[i] = tree->root; \
+                    lane_key[i] = next; \
+                    ++next; \
+                } \
+                else \
+                { \
+                    lane_node[i] = NULL; \
+                    --active; \
+                } \
+            } \
+        \
+        return num_found; \
+    }
+
 #endif
@@ -0,0 +1,464 @@
+#include <ahocorasick.h>
+#include <generic.h>
+#include <log.h>
+#include <common.h>
+#include <compiler.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define AHO_CORASICK_ROOT       0
+#define AHO_CORASICK_ALPHABET   256
+
+struct Aho_corasick
+{
+    int32_t     *next;          /* dense DFA, num_states * num_classes */
+    int32_t     *pattern;       /* pattern id ending at state or -1 */
+    int32_t     *report;        /* first state on suffix chain with pattern or -1 */
+    int32_t     *dict;          /* next state on suffix chain with pattern or -1 */
+    size_t      num_states;
+    size_t      num_classes;
+    uint16_t    classes[AHO_CORASICK_ALPHABET];
+
+    char        *patterns;      /* all patterns with '\0' in one buffer */
+    size_t      *offsets;       /* offset of pattern in patterns buffer */
+    size_t      *lens;
+    size_t      num_patterns;
+};
+
+/*
+    Copy patterns to automaton and compute input classes
+
+    PARAMS
+    @IN ac - pointer to automaton
+    @IN patterns - array of patterns
+    @IN num - number of patterns
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+static int __aho_corasick_copy_patterns(Aho_corasick * ___restrict___ ac, const char * const * ___restrict___ patterns, size_t num);
+
+/*
+    Build trie of patterns, then compute fail links and complete DFA in BFS order
+
+    PARAMS
+    @IN ac - pointer to automaton
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+static int __aho_corasick_build(Aho_corasick *ac);
+
+/*
+    Callback used by aho_corasick_find_first, saves first match and stops matcher
+
+    PARAMS
+    @IN id - pattern id
+    @IN offset - offset of pattern
+    @IN arg - pointer to 2 size_t: offset and id
+
+    RETURN
+    Always 1 (stop)
+*/
+static int __aho_corasick_first_cb(size_t id, size_t offset, void *arg);
+
+static int __aho_corasick_copy_patterns(Aho_corasick * ___restrict___ ac, const char * const * ___restrict___ patterns, size_t num)
+{
+    size_t i;
+    size_t j;
+    size_t total;
+    bool used[AHO_CORASICK_ALPHABET];
+
+    TRACE();
+
+    ac->lens = (size_t *)malloc(sizeof(size_t) * num);
+    if (ac->lens == NULL)
+        ERROR("malloc error\n", 1);
+
+    ac->offsets = (size_t *)malloc(sizeof(size_t) * num);
+    if (ac->offsets == NULL)
+        ERROR("malloc error\n", 1);
+
+    total = 0;
+    for (i = 0; i < num; ++i)
+    {
+        if (patterns[i] == NULL || patterns[i][0] == '\0')
+            ERROR("Pattern is empty\n", 1);
+
+        ac->lens[i] = strlen(patterns[i]);
+        ac->offsets[i] = total;
+        total += ac->lens[i] + 1;
+    }
+
+    ac->patterns = (char *)malloc(total);
+    if (ac->patterns == NULL)
+        ERROR("malloc error\n", 1);
+
+    (void)memset(used, 0, sizeof(used));
+    for (i = 0; i < num; ++i)
+    {
+        (void)memcpy(ac->patterns + ac->offsets[i], patterns[i], ac->lens[i] + 1);
+        for (j = 0; j < ac->lens[i]; ++j)
+            used[(BYTE)patterns[i][j]] = true;
+    }
+
+    /* class 0 is for all chars which don't exist in patterns */
+    ac->num_classes = 1;
+    for (i = 0; i < AHO_CORASICK_ALPHABET; ++i)
+        ac->classes[i] = used[i] ? (uint16_t)ac->num_classes++ : 0;
+
+    ac->num_patterns = num;
+
+    return 0;
+}
+
+static int __aho_corasick_build(Aho_corasick *ac)
+{
+    size_t max_states;
+    size_t i;
+    size_t j;
+    size_t c;
+    size_t head;
+    size_t tail;
+    size_t nc;
+    int32_t *fail;
+    int32_t *queue;
+    int32_t state;
+    int32_t child;
+    int32_t num_states;
+    const char *p;
+
+    TRACE();
+
+    nc = ac->num_classes;
+    max_states = 1;
+    for (i = 0; i < ac->num_patterns; ++i)
+        max_states += ac->lens[i];
+
+    if (max_states > (size_t)INT32_MAX / nc)
+        ERROR("Too many states\n", 1);
+
+    ac->next = (int32_t *)malloc(sizeof(int32_t) * max_states * nc);
+    ac->pattern = (int32_t *)malloc(sizeof(int32_t) * max_states);
+    ac->report = (int32_t *)malloc(sizeof(int32_t) * max_states);
+    ac->dict = (int32_t *)malloc(sizeof(int32_t) * max_states);
+    if (ac->next == NULL || ac->pattern == NULL || ac->report == NULL || ac->dict == NULL)
+        ERROR("malloc error\n", 1);
+
+    fail = (int32_t *)malloc(sizeof(int32_t) * max_states);
+    if (fail == NULL)
+        ERROR("malloc error\n", 1);
+
+    queue = (int32_t *)malloc(sizeof(int32_t) * max_states);
+    if (queue == NULL)
+    {
+        FREE(fail);
+        ERROR("malloc error\n", 1);
+    }
+
+    /* trie, -1 means no edge */
+    (void)memset(ac->next, 0xFF, sizeof(int32_t) * nc);
+    ac->pattern[AHO_CORASICK_ROOT] = -1;
+    num_states = 1;
+    for (i = 0; i < ac->num_patterns; ++i)
+    {
+        p = ac->patterns + ac->offsets[i];
+        state = AHO_CORASICK_ROOT;
+        for (j = 0; j < ac->lens[i]; ++j)
+        {
+            c = ac->classes[(BYTE)p[j]];
+            child = ac->next[(size_t)state * nc + c];
+            if (child == -1)
+            {
+                child = num_states++;
+                (void)memset(ac->next + (size_t)child * nc, 0xFF, sizeof(int32_t) * nc);
+                ac->pattern[child] = -1;
+                ac->next[(size_t)state * nc + c] = child;
+            }
+
+            state = child;
+        }
+
+        if (ac->pattern[state] == -1)
+            ac->pattern[state] = (int32_t)i;
+    }
+
+    /* BFS, missing edges go to the same place as edge from fail state */
+    head = 0;
+    tail = 0;
+    ac->report[AHO_CORASICK_ROOT] = -1;
+    ac->dict[AHO_CORASICK_ROOT] = -1;
+    fail[AHO_CORASICK_ROOT] = AHO_CORASICK_ROOT;
+    for (c = 0; c < nc; ++c)
+    {
+        child = ac->next[c];
+        if (child == -1)
+            ac->next[c] = AHO_CORASICK_ROOT;
+        else
+        {
+            fail[child] = AHO_CORASICK_ROOT;
+            queue[tail++] = child;
+        }
+    }
+
+    while (head < tail)
+    {
+        state = queue[head++];
+
+        /* fail state is closer to root, so it is already done */
+        ac->dict[state] = ac->report[fail[state]];
+        ac->report[state] = ac->pattern[state] != -1 ? state : ac->dict[state];
+
+        for (c = 0; c < nc; ++c)
+        {
+            child = ac->next[(size_t)state * nc + c];
+            if (child == -1)
+                ac->next[(size_t)state * nc + c] = ac->next[(size_t)fail[state] * nc + c];
+            else
+            {
+                fail[child] = ac->next[(size_t)fail[state] * nc + c];
+                queue[tail++] = child;
+            }
+        }
+    }
+
+    FREE(fail);
+    FREE(queue);
+
+    ac->num_states = (size_t)num_states;
+
+    return 0;
+}
+
+static int __aho_corasick_first_cb(size_t id, size_t offset, void *arg)
+{
+    size_t *res = (size_t *)arg;
+
+    res[0] = offset;
+    res[1] = id;
+
+    return 1;
+}
+
+Aho_corasick *aho_corasick_create(const char * const *patterns, size_t num)
+{
+    Aho_corasick *ac;
+
+    TRACE();
+
+    if (patterns == NULL)
+        ERROR("patterns == NULL\n", NULL);
+
+    if (num == 0)
+        ERROR("num == 0\n", NULL);
+
+    ac = (Aho_corasick *)calloc(1, sizeof(Aho_corasick));
+    if (ac == NULL)
+        ERROR("calloc error\n", NULL);
+
+    if (__aho_corasick_copy_patterns(ac, patterns, num))
+    {
+        aho_corasick_destroy(ac);
+        ERROR("__aho_corasick_copy_patterns error\n", NULL);
+    }
+
+    if (__aho_corasick_build(ac))
+    {
+        aho_corasick_destroy(ac);
+        ERROR("__aho_corasick_build error\n", NULL);
+    }
+
+    return ac;
+}
+
+Aho_corasick *aho_corasick_create_from_trie(const Trie *trie)
+{
+    Aho_corasick *ac;
+    char **words;
+    size_t size;
+    size_t i;
+
+    TRACE();
+
+    if (trie == NULL)
+        ERROR("trie == NULL\n", NULL);
+
+    words = trie_to_array(trie, &size);
+    if (words == NULL)
+        ERROR("trie_to_array error\n", NULL);
+
+    ac = aho_corasick_create((const char * const *)words, size);
+
+    for (i = 0; i < size; ++i)
+        FREE(words[i]);
+
+    FREE(words);
+
+    if (ac == NULL)
+        ERROR("aho_corasick_create error\n", NULL);
+
+    return ac;
+}
+
+void aho_corasick_destroy(Aho_corasick *ac)
+{
+    TRACE();
+
+    if (ac == NULL)
+        return;
+
+    FREE(ac->next);
+    FREE(ac->pattern);
+    FREE(ac->report);
+    FREE(ac->dict);
+    FREE(ac->patterns);
+    FREE(ac->offsets);
+    FREE(ac->lens);
+    FREE(ac);
+}
+
+ssize_t aho_corasick_get_num_patterns(const Aho_corasick *ac)
+{
+    TRACE();
+
+    if (ac == NULL)
+        ERROR("ac == NULL\n", -1);
+
+    return (ssize_t)ac->num_patterns;
+}
+
+ssize_t aho_corasick_get_num_states(const Aho_corasick *ac)
+{
+    TRACE();
+
+    if (ac == NULL)
+        ERROR("ac == NULL\n", -1);
+
+    return (ssize_t)ac->num_states;
+}
+
+const char *aho_corasick_get_pattern(const Aho_corasick *ac, size_t id)
+{
+    TRACE();
+
+    if (ac == NULL)
+        ERROR("ac == NULL\n", NULL);
+
+    if (id >= ac->num_patterns)
+        ERROR("Incorrect id\n", NULL);
+
+    return ac->patterns + ac->offsets[id];
+}
+
+int aho_corasick_stream_init(const Aho_corasick * ___restrict___ ac, Aho_corasick_stream * ___restrict___ stream)
+{
+    TRACE();
+
+    if (ac == NULL)
+        ERROR("ac == NULL\n", 1);
+
+    if (stream == NULL)
+        ERROR("stream == NULL\n", 1);
+
+    stream->____ac = ac;
+    stream->____state = AHO_CORASICK_ROOT;
+    stream->____offset = 0;
+
+    return 0;
+}
+
+ssize_t aho_corasick_stream_feed(Aho_corasick_stream *stream, const void *buf, size_t size, aho_corasick_match_f cb, void *arg)
+{
+    const Aho_corasick *ac;
+    const BYTE *text = (const BYTE *)buf;
+    const int32_t *next;
+    size_t state;
+    size_t nc;
+    size_t i;
+    size_t id;
+    size_t matches = 0;
+    int32_t t;
+
+    TRACE();
+
+    if (stream == NULL || stream->____ac == NULL)
+        ERROR("stream is not initialized\n", -1);
+
+    if (buf == NULL)
+        ERROR("buf == NULL\n", -1);
+
+    ac = stream->____ac;
+    next = ac->next;
+    nc = ac->num_classes;
+    state = stream->____state;
+
+    for (i = 0; i < size; ++i)
+    {
+        state = (size_t)next[state * nc + ac->classes[text[i]]];
+        if (likely(ac->report[state] == -1))
+            continue;
+
+        for (t = ac->report[state]; t != -1; t = ac->dict[t])
+        {
+            id = (size_t)ac->pattern[t];
+            ++matches;
+
+            if (cb != NULL && cb(id, stream->____offset + i + 1 - ac->lens[id], arg))
+            {
+                stream->____state = state;
+                stream->____offset += i + 1;
+
+                return (ssize_t)matches;
+            }
+        }
+    }
+
+    stream->____state = state;
+    stream->____offset += size;
+
+    return (ssize_t)matches;
+}
+
+ssize_t aho_corasick_stream_get_offset(const Aho_corasick_stream *stream)
+{
+    TRACE();
+
+    if (stream == NULL)
+        ERROR("stream == NULL\n", -1);
+
+    return (ssize_t)stream->____offset;
+}
+
+ssize_t aho_corasick_search(const Aho_corasick *ac, const void *buf, size_t size, aho_corasick_match_f cb, void *arg)
+{
+    Aho_corasick_stream stream;
+
+    TRACE();
+
+    if (aho_corasick_stream_init(ac, &stream))
+        ERROR("aho_corasick_stream_init error\n", -1);
+
+    return aho_corasick_stream_feed(&stream, buf, size, cb, arg);
+}
+
+ssize_t aho_corasick_find_first(const Aho_corasick *ac, const void *buf, size_t size, size_t *id)
+{
+    size_t res[2];
+    ssize_t ret;
+
+    TRACE();
+
+    ret = aho_corasick_search(ac, buf, size, __aho_corasick_first_cb, (void *)res);
+    if (ret == -1)
+        ERROR("aho_corasick_search error\n", -1);
+
+    if (ret == 0)
+        return -1;
+
+    if (id != NULL)
+        *id = res[1];
+
+    return (ssize_t)res[0];
+}
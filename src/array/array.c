@@ -40,6 +40,42 @@ static int __array_delete_pos(void *array, size_t len, size_t size_of, size_t po
 */
 static int __array_insert_pos(void * ___restrict___ array, size_t len, size_t size_of, size_t pos, const void * ___restrict___ data);
 
+/*
+    Branchless binary search of bound of @data in @array,
+    both possible next midpoints are prefetched
+
+    PARAMS
+    @IN array - sorted array
+    @IN len - array len (> 0)
+    @IN size_of - element size of
+    @IN data - data to calculate bound
+    @IN cmp - cmp
+    @IN upper - false for lower bound, true for upper bound
+
+    RETURN
+    Index of bound
+*/
+static ___inline___ size_t __array_bound(const BYTE * ___restrict___ array, size_t len, size_t size_of, const void * ___restrict___ data, cmp_f cmp, bool upper);
+
+static ___inline___ size_t __array_bound(const BYTE * ___restrict___ array, size_t len, size_t size_of, const void * ___restrict___ data, cmp_f cmp, bool upper)
+{
+    size_t base = 0;
+    size_t half;
+
+    while (len > 1)
+    {
+        half = len >> 1;
+        load_to_cache(&array[(base + ((len - half) >> 1)) * size_of], CACHE_READ, CACHE_SAVE_NORMAL_PRIO);
+        load_to_cache(&array[(base + half + ((len - half) >> 1)) * size_of], CACHE_READ, CACHE_SAVE_NORMAL_PRIO);
+
+        /* lower: data > array[mid], upper: data >= array[mid] */
+        base = cmp(data, (const void *)&array[(base + half) * size_of]) > -(int)upper ? base + half : base;
+        len -= half;
+    }
+
+    return base + (size_t)(cmp(data, (const void *)&array[base * size_of]) > -(int)upper);
+}
+
 static int __array_delete_pos(void *array, size_t len, size_t size_of, size_t pos, destructor_f destructor)
 {
     BYTE *_t;
@@ -424,13 +460,6 @@ void array_reverse(void *array, size_t len, size_t size_of)
 
 ssize_t array_lower_bound(const void *array, size_t len, size_t size_of, const void *data, cmp_f cmp)
 {
-    size_t offset_left;
-    size_t offset_right;
-    size_t offset_mid;
-    size_t _size_of = size_of;
-
-    const BYTE *_t;
-
     TRACE();
 
     if (array == NULL)
@@ -445,31 +474,11 @@ ssize_t array_lower_bound(const void *array, size_t len, size_t size_of, const v
     if (cmp == NULL)
         ERROR("cmp == NULL\n", -1);
 
-    _t = (const BYTE *)array;
-    offset_left = 0;
-    offset_right = len * _size_of;
-
-    while (offset_left < offset_right)
-    {
-        offset_mid = ((offset_left / _size_of + offset_right / _size_of) / 2) * _size_of;
-        if (cmp(data, &_t[offset_mid]) <= 0)
-            offset_right = offset_mid;
-        else
-            offset_left = offset_mid + _size_of;
-    }
-
-    return (ssize_t)(offset_left / _size_of);
+    return (ssize_t)__array_bound((const BYTE *)array, len, size_of, data, cmp, false);
 }
 
 ssize_t array_upper_bound(const void *array, size_t len, size_t size_of, const void *data, cmp_f cmp)
 {
-    size_t offset_left;
-    size_t offset_right;
-    size_t offset_mid;
-    size_t _size_of = size_of;
-
-    const BYTE *_t;
-
     TRACE();
 
     if (array == NULL)
@@ -484,20 +493,7 @@ ssize_t array_upper_bound(const void *array, size_t len, size_t size_of, const v
     if (cmp == NULL)
         ERROR("cmp == NULL\n", -1);
 
-    _t = (const BYTE *)array;
-    offset_left = 0;
-    offset_right = len * _size_of;
-
-    while (offset_left < offset_right)
-    {
-        offset_mid = ((offset_left / _size_of + offset_right / _size_of) / 2) * _size_of;
-        if (cmp(data, &_t[offset_mid]) >= 0)
-            offset_left = offset_mid + _size_of;
-        else
-            offset_right = offset_mid;
-    }
-
-    return (ssize_t)(offset_left / _size_of);
+    return (ssize_t)__array_bound((const BYTE *)array, len, size_of, data, cmp, true);
 }
 
 ssize_t array_min(const void * ___restrict___ array, size_t len, size_t size_of, cmp_f cmp, void * ___restrict___ min)
@@ -614,6 +610,41 @@ ssize_t array_median(const void * ___restrict___ array, size_t len, size_t size_
     return array_select_kth(array, len, size_of, len >> 1, cmp, median);
 }
 
+int array_select_multi(const void * ___restrict___ array, size_t len, size_t size_of, const size_t *ks, size_t num_ks, cmp_f cmp, void * ___restrict___ kths)
+{
+    BYTE *t;
+    BYTE *_kths;
+    size_t i;
+
+    TRACE();
+
+    if (array == NULL || kths == NULL)
+        ERROR("array == NULL || kths == NULL\n", 1);
+
+    if (len == 0 || size_of == 0)
+        ERROR("len == 0 || size_of == 0\n", 1);
+
+    t = (BYTE *)malloc(len * size_of);
+    if (t == NULL)
+        ERROR("malloc error\n", 1);
+
+    (void)memcpy(t, array, len * size_of);
+
+    if (select_multi_inplace(t, len, size_of, ks, num_ks, cmp))
+    {
+        FREE(t);
+        ERROR("select_multi_inplace error\n", 1);
+    }
+
+    _kths = (BYTE *)kths;
+    for (i = 0; i < num_ks; ++i)
+        __ASSIGN__(_kths[i * size_of], t[ks[i] * size_of], size_of);
+
+    FREE(t);
+
+    return 0;
+}
+
 ssize_t array_unsorted_find_first(const void * ___restrict___ array, size_t len, size_t size_of, const void * ___restrict___ key, cmp_f cmp,  void *val)
 {
     ssize_t index;
@@ -0,0 +1,972 @@
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE /* O_DIRECT */
+#endif
+
+#include <asyncio.h>
+#include <log.h>
+#include <common.h>
+#include <compiler.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#define ASYNC_IO_OP_READ    0
+#define ASYNC_IO_OP_WRITE   1
+
+typedef struct Async_io_request
+{
+    int             op;
+    int             fd;
+    void            *buf;
+    size_t          size;
+    off_t           offset;
+    void            *user_data;
+} Async_io_request;
+
+/* io_uring request, short completion is resubmitted from done */
+typedef struct Async_io_uring_slot
+{
+    Async_io_request        req;
+    size_t                  done;
+    ssize_t                 buf_index;
+} Async_io_uring_slot;
+
+/* io_uring rings, pointers to shared memory with kernel */
+typedef struct Async_io_uring
+{
+    int                     fd;
+    Async_io_uring_slot     *slots;         /* SQE index == slot index, user_data is slot index */
+    unsigned                *free_slots;
+    size_t                  num_free;
+    unsigned                *sq_head;
+    unsigned                *sq_tail;
+    unsigned                *sq_array;
+    unsigned                sq_mask;
+    unsigned                sq_local_tail;  /* prepared, not published */
+    struct io_uring_sqe     *sqes;
+    unsigned                *cq_head;
+    unsigned                *cq_tail;
+    unsigned                cq_mask;
+    struct io_uring_cqe     *cqes;
+    void                    *sq_ring;
+    size_t                  sq_ring_size;
+    void                    *cq_ring;       /* == sq_ring iff single mmap */
+    size_t                  cq_ring_size;
+    size_t                  sqes_size;
+} Async_io_uring;
+
+/* fallback, requests and completions are queues (size = queue depth) protected by mutex */
+typedef struct Async_io_threads
+{
+    pthread_t               threads[ASYNC_IO_NUM_THREADS];
+    size_t                  num_threads;
+    pthread_mutex_t         mutex;
+    pthread_cond_t          req_cond;
+    pthread_cond_t          cqe_cond;
+    Async_io_request        *reqs;
+    size_t                  req_head;
+    size_t                  req_num;
+    Async_io_completion     *cqes;
+    size_t                  cqe_head;
+    size_t                  cqe_num;
+    bool                    stop;
+} Async_io_threads;
+
+struct Async_io
+{
+    size_t                  depth;
+    size_t                  inflight;   /* submitted, not polled */
+    size_t                  pending;    /* prepared, not submitted */
+    Async_io_request        *prepared;  /* threads backend only */
+    struct iovec            *buffers;   /* registered buffers */
+    size_t                  num_buffers;
+    int                     backend;
+    union
+    {
+        Async_io_uring      uring;
+        Async_io_threads    threads;
+    } u;
+};
+
+/*
+    Setup io_uring
+
+    PARAMS
+    @IN aio - pointer to Async_io
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure (io_uring is not available)
+*/
+static int __async_io_uring_init(Async_io *aio);
+
+/*
+    Destroy io_uring
+
+    PARAMS
+    @IN aio - pointer to Async_io
+
+    RETURN
+    This is a void function
+*/
+static void __async_io_uring_deinit(Async_io *aio);
+
+/*
+    Fill SQE of slot with not done part of request
+
+    PARAMS
+    @IN ring - pointer to Async_io_uring
+    @IN slot - slot index
+
+    RETURN
+    This is a void function
+*/
+static void __async_io_uring_fill_sqe(Async_io_uring *ring, unsigned slot);
+
+/*
+    Put request to io_uring SQ (not published)
+
+    PARAMS
+    @IN aio - pointer to Async_io
+    @IN req - request
+    @IN buf_index - index of registered buffer or -1
+
+    RETURN
+    This is a void function
+*/
+static void __async_io_uring_prep(Async_io * ___restrict___ aio, const Async_io_request * ___restrict___ req, ssize_t buf_index);
+
+/*
+    Get completions from io_uring CQ,
+    short read / write is resubmitted (like in threads backend) and not returned
+
+    PARAMS
+    @IN aio - pointer to Async_io
+    @OUT cqe - array of completions
+    @IN max - size of array
+
+    RETURN
+    -1 iff failure
+    Number of completions iff success
+*/
+static ssize_t __async_io_uring_reap(Async_io * ___restrict___ aio, Async_io_completion * ___restrict___ cqe, size_t max);
+
+/*
+    Start thread pool
+
+    PARAMS
+    @IN aio - pointer to Async_io
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+static int __async_io_threads_init(Async_io *aio);
+
+/*
+    Stop thread pool
+
+    PARAMS
+    @IN aio - pointer to Async_io
+
+    RETURN
+    This is a void function
+*/
+static void __async_io_threads_deinit(Async_io *aio);
+
+/*
+    Worker of thread pool
+
+    PARAMS
+    @IN arg - pointer to Async_io
+
+    RETURN
+    NULL
+*/
+static void *__async_io_worker(void *arg);
+
+/*
+    Do blocking request (whole buffer or error)
+
+    PARAMS
+    @IN req - request
+
+    RETURN
+    Number of bytes iff success
+    -errno iff failure
+*/
+static ssize_t __async_io_do_request(const Async_io_request *req);
+
+/*
+    Prepare request
+
+    PARAMS
+    @IN aio - pointer to Async_io
+    @IN req - request
+    @IN buf_index - index of registered buffer or -1
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+static int __async_io_prep(Async_io * ___restrict___ aio, const Async_io_request * ___restrict___ req, ssize_t buf_index);
+
+static int __async_io_uring_init(Async_io *aio)
+{
+    Async_io_uring *ring = &aio->u.uring;
+    struct io_uring_params params;
+    int fd;
+
+    size_t i;
+
+    TRACE();
+
+    (void)memset(&params, 0, sizeof(params));
+
+    ring->slots = (Async_io_uring_slot *)malloc(sizeof(Async_io_uring_slot) * aio->depth);
+    ring->free_slots = (unsigned *)malloc(sizeof(unsigned) * aio->depth);
+    if (ring->slots == NULL || ring->free_slots == NULL)
+    {
+        FREE(ring->slots);
+        FREE(ring->free_slots);
+        return 1;
+    }
+
+    for (i = 0; i < aio->depth; ++i)
+        ring->free_slots[i] = (unsigned)(aio->depth - 1 - i);
+
+    ring->num_free = aio->depth;
+
+    /* CQ is 2x bigger than SQ, inflight <= depth so CQ never overflows */
+    fd = (int)syscall(__NR_io_uring_setup, (unsigned)aio->depth, &params);
+    if (fd == -1)
+    {
+        FREE(ring->slots);
+        FREE(ring->free_slots);
+        return 1;
+    }
+
+    ring->fd = fd;
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        ring->sq_ring_size = MAX(ring->sq_ring_size, ring->cq_ring_size);
+        ring->cq_ring_size = ring->sq_ring_size;
+    }
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED)
+    {
+        close(fd);
+        FREE(ring->slots);
+        FREE(ring->free_slots);
+        return 1;
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+        ring->cq_ring = ring->sq_ring;
+    else
+    {
+        ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ring == MAP_FAILED)
+        {
+            (void)munmap(ring->sq_ring, ring->sq_ring_size);
+            close(fd);
+            FREE(ring->slots);
+            FREE(ring->free_slots);
+            return 1;
+        }
+    }
+
+    ring->sqes = (struct io_uring_sqe *)mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED)
+    {
+        if (ring->cq_ring != ring->sq_ring)
+            (void)munmap(ring->cq_ring, ring->cq_ring_size);
+
+        (void)munmap(ring->sq_ring, ring->sq_ring_size);
+        close(fd);
+        FREE(ring->slots);
+        FREE(ring->free_slots);
+        return 1;
+    }
+
+    ring->sq_head = (unsigned *)((char *)ring->sq_ring + params.sq_off.head);
+    ring->sq_tail = (unsigned *)((char *)ring->sq_ring + params.sq_off.tail);
+    ring->sq_array = (unsigned *)((char *)ring->sq_ring + params.sq_off.array);
+    ring->sq_mask = *(unsigned *)((char *)ring->sq_ring + params.sq_off.ring_mask);
+    ring->sq_local_tail = *ring->sq_tail;
+
+    ring->cq_head = (unsigned *)((char *)ring->cq_ring + params.cq_off.head);
+    ring->cq_tail = (unsigned *)((char *)ring->cq_ring + params.cq_off.tail);
+    ring->cq_mask = *(unsigned *)((char *)ring->cq_ring + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)((char *)ring->cq_ring + params.cq_off.cqes);
+
+    return 0;
+}
+
+static void __async_io_uring_deinit(Async_io *aio)
+{
+    Async_io_uring *ring = &aio->u.uring;
+
+    TRACE();
+
+    (void)munmap((void *)ring->sqes, ring->sqes_size);
+    if (ring->cq_ring != ring->sq_ring)
+        (void)munmap(ring->cq_ring, ring->cq_ring_size);
+
+    (void)munmap(ring->sq_ring, ring->sq_ring_size);
+    close(ring->fd);
+
+    FREE(ring->slots);
+    FREE(ring->free_slots);
+}
+
+static void __async_io_uring_fill_sqe(Async_io_uring *ring, unsigned slot)
+{
+    const Async_io_uring_slot *s = &ring->slots[slot];
+    struct io_uring_sqe *sqe = &ring->sqes[slot];
+
+    (void)memset(sqe, 0, sizeof(*sqe));
+    if (s->buf_index >= 0)
+    {
+        sqe->opcode = s->req.op == ASYNC_IO_OP_READ ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+        sqe->buf_index = (__u16)s->buf_index;
+    }
+    else
+        sqe->opcode = s->req.op == ASYNC_IO_OP_READ ? IORING_OP_READ : IORING_OP_WRITE;
+
+    sqe->fd = s->req.fd;
+    sqe->addr = (__u64)(uintptr_t)((char *)s->req.buf + s->done);
+    sqe->len = (__u32)(s->req.size - s->done);
+    sqe->off = (__u64)(s->req.offset + (off_t)s->done);
+    sqe->user_data = (__u64)slot;
+}
+
+static void __async_io_uring_prep(Async_io * ___restrict___ aio, const Async_io_request * ___restrict___ req, ssize_t buf_index)
+{
+    Async_io_uring *ring = &aio->u.uring;
+    unsigned slot;
+
+    TRACE();
+
+    /* inflight + pending <= depth, so there is always free slot */
+    slot = ring->free_slots[--ring->num_free];
+    ring->slots[slot].req = *req;
+    ring->slots[slot].done = 0;
+    ring->slots[slot].buf_index = buf_index;
+
+    __async_io_uring_fill_sqe(ring, slot);
+
+    ring->sq_array[ring->sq_local_tail & ring->sq_mask] = slot;
+    ++ring->sq_local_tail;
+}
+
+static ssize_t __async_io_uring_reap(Async_io * ___restrict___ aio, Async_io_completion * ___restrict___ cqe, size_t max)
+{
+    Async_io_uring *ring = &aio->u.uring;
+    const struct io_uring_cqe *entry;
+    Async_io_uring_slot *s;
+    unsigned head;
+    unsigned tail;
+    unsigned sq_tail;
+    unsigned pos;
+    unsigned slot;
+    unsigned resubmit = 0;
+    size_t num = 0;
+    int res;
+    int ret;
+
+    TRACE();
+
+    sq_tail = *ring->sq_tail;
+    head = *ring->cq_head;
+    tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    while (head != tail && num < max)
+    {
+        entry = &ring->cqes[head & ring->cq_mask];
+        slot = (unsigned)entry->user_data;
+        res = entry->res;
+        s = &ring->slots[slot];
+        ++head;
+
+        if (res > 0)
+            s->done += (size_t)res;
+
+        /* short read / write, send rest like blocking loop in threads backend */
+        if ((res > 0 && s->done < s->req.size) || res == -EINTR || res == -EAGAIN)
+        {
+            __async_io_uring_fill_sqe(ring, slot);
+
+            /* before prepared, not submitted requests */
+            for (pos = ring->sq_local_tail; pos != sq_tail + resubmit; --pos)
+                ring->sq_array[pos & ring->sq_mask] = ring->sq_array[(pos - 1) & ring->sq_mask];
+
+            ring->sq_array[(sq_tail + resubmit) & ring->sq_mask] = slot;
+            ++ring->sq_local_tail;
+            ++resubmit;
+            continue;
+        }
+
+        cqe[num].user_data = s->req.user_data;
+        cqe[num].res = res < 0 && s->done == 0 ? (ssize_t)res : (ssize_t)s->done;
+        ring->free_slots[ring->num_free++] = slot;
+        ++num;
+    }
+
+    /* kernel can reuse entries */
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+
+    if (resubmit == 0)
+        return (ssize_t)num;
+
+    __atomic_store_n(ring->sq_tail, sq_tail + resubmit, __ATOMIC_RELEASE);
+    while (resubmit > 0)
+    {
+        ret = (int)syscall(__NR_io_uring_enter, ring->fd, resubmit, 0, 0, NULL, 0);
+        if (ret == -1)
+        {
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+                continue;
+
+            ERROR("io_uring_enter error\n", -1);
+        }
+
+        resubmit -= (unsigned)ret;
+    }
+
+    return (ssize_t)num;
+}
+
+static ssize_t __async_io_do_request(const Async_io_request *req)
+{
+    size_t done = 0;
+    ssize_t ret;
+
+    while (done < req->size)
+    {
+        if (req->op == ASYNC_IO_OP_READ)
+            ret = pread(req->fd, (char *)req->buf + done, req->size - done, req->offset + (off_t)done);
+        else
+            ret = pwrite(req->fd, (const char *)req->buf + done, req->size - done, req->offset + (off_t)done);
+
+        if (ret == -1)
+        {
+            if (errno == EINTR)
+                continue;
+
+            return done > 0 ? (ssize_t)done : -errno;
+        }
+
+        /* end of file */
+        if (ret == 0)
+            break;
+
+        done += (size_t)ret;
+    }
+
+    return (ssize_t)done;
+}
+
+static void *__async_io_worker(void *arg)
+{
+    Async_io *aio = (Async_io *)arg;
+    Async_io_threads *pool = &aio->u.threads;
+    Async_io_request req;
+    ssize_t res;
+
+    (void)pthread_mutex_lock(&pool->mutex);
+    for (;;)
+    {
+        while (pool->req_num == 0 && !pool->stop)
+            (void)pthread_cond_wait(&pool->req_cond, &pool->mutex);
+
+        if (pool->req_num == 0)
+            break;
+
+        req = pool->reqs[pool->req_head];
+        pool->req_head = (pool->req_head + 1) % aio->depth;
+        --pool->req_num;
+
+        (void)pthread_mutex_unlock(&pool->mutex);
+        res = __async_io_do_request(&req);
+        (void)pthread_mutex_lock(&pool->mutex);
+
+        /* inflight <= depth, so there is always place for completion */
+        pool->cqes[(pool->cqe_head + pool->cqe_num) % aio->depth].user_data = req.user_data;
+        pool->cqes[(pool->cqe_head + pool->cqe_num) % aio->depth].res = res;
+        ++pool->cqe_num;
+
+        (void)pthread_cond_signal(&pool->cqe_cond);
+    }
+    (void)pthread_mutex_unlock(&pool->mutex);
+
+    return NULL;
+}
+
+static int __async_io_threads_init(Async_io *aio)
+{
+    Async_io_threads *pool = &aio->u.threads;
+    size_t i;
+
+    TRACE();
+
+    aio->prepared = (Async_io_request *)malloc(sizeof(Async_io_request) * aio->depth);
+    pool->reqs = (Async_io_request *)malloc(sizeof(Async_io_request) * aio->depth);
+    pool->cqes = (Async_io_completion *)malloc(sizeof(Async_io_completion) * aio->depth);
+    if (aio->prepared == NULL || pool->reqs == NULL || pool->cqes == NULL)
+    {
+        FREE(aio->prepared);
+        FREE(pool->reqs);
+        FREE(pool->cqes);
+        ERROR("malloc error\n", 1);
+    }
+
+    pool->req_head = 0;
+    pool->req_num = 0;
+    pool->cqe_head = 0;
+    pool->cqe_num = 0;
+    pool->stop = false;
+
+    (void)pthread_mutex_init(&pool->mutex, NULL);
+    (void)pthread_cond_init(&pool->req_cond, NULL);
+    (void)pthread_cond_init(&pool->cqe_cond, NULL);
+
+    for (i = 0; i < ASYNC_IO_NUM_THREADS; ++i)
+        if (pthread_create(&pool->threads[i], NULL, __async_io_worker, (void *)aio))
+            break;
+
+    pool->num_threads = i;
+
+    /* at least one worker is needed, rest only speeds up */
+    if (pool->num_threads == 0)
+    {
+        (void)pthread_mutex_destroy(&pool->mutex);
+        (void)pthread_cond_destroy(&pool->req_cond);
+        (void)pthread_cond_destroy(&pool->cqe_cond);
+        FREE(aio->prepared);
+        FREE(pool->reqs);
+        FREE(pool->cqes);
+        ERROR("pthread_create error\n", 1);
+    }
+
+    return 0;
+}
+
+static void __async_io_threads_deinit(Async_io *aio)
+{
+    Async_io_threads *pool = &aio->u.threads;
+    size_t i;
+
+    TRACE();
+
+    (void)pthread_mutex_lock(&pool->mutex);
+    pool->stop = true;
+    (void)pthread_cond_broadcast(&pool->req_cond);
+    (void)pthread_mutex_unlock(&pool->mutex);
+
+    for (i = 0; i < pool->num_threads; ++i)
+        (void)pthread_join(pool->threads[i], NULL);
+
+    (void)pthread_mutex_destroy(&pool->mutex);
+    (void)pthread_cond_destroy(&pool->req_cond);
+    (void)pthread_cond_destroy(&pool->cqe_cond);
+
+    FREE(aio->prepared);
+    FREE(pool->reqs);
+    FREE(pool->cqes);
+}
+
+static int __async_io_prep(Async_io * ___restrict___ aio, const Async_io_request * ___restrict___ req, ssize_t buf_index)
+{
+    TRACE();
+
+    if (aio->inflight + aio->pending >= aio->depth)
+        ERROR("queue is full\n", 1);
+
+    if (aio->backend == ASYNC_IO_BACKEND_URING)
+        __async_io_uring_prep(aio, req, buf_index);
+    else
+        aio->prepared[aio->pending] = *req;
+
+    ++aio->pending;
+
+    return 0;
+}
+
+Async_io *async_io_create(size_t queue_depth, int flags)
+{
+    Async_io *aio;
+
+    TRACE();
+
+    if (queue_depth == 0 || queue_depth > 4096)
+        ERROR("queue_depth == 0 || queue_depth > 4096\n", NULL);
+
+    aio = (Async_io *)malloc(sizeof(Async_io));
+    if (aio == NULL)
+        ERROR("malloc error\n", NULL);
+
+    aio->depth = queue_depth;
+    aio->inflight = 0;
+    aio->pending = 0;
+    aio->prepared = NULL;
+    aio->buffers = NULL;
+    aio->num_buffers = 0;
+
+    if (!(flags & ASYNC_IO_FORCE_THREADS) && __async_io_uring_init(aio) == 0)
+    {
+        aio->backend = ASYNC_IO_BACKEND_URING;
+        return aio;
+    }
+
+    if (__async_io_threads_init(aio))
+    {
+        FREE(aio);
+        ERROR("__async_io_threads_init error\n", NULL);
+    }
+
+    aio->backend = ASYNC_IO_BACKEND_THREADS;
+
+    return aio;
+}
+
+void async_io_destroy(Async_io *aio)
+{
+    Async_io_completion cqe[64];
+
+    TRACE();
+
+    if (aio == NULL)
+        return;
+
+    /* kernel / workers can't write to user buffers after destroy */
+    while (aio->inflight > 0)
+        if (async_io_poll(aio, cqe, ARRAY_SIZE(cqe), 1) == -1)
+            break;
+
+    if (aio->backend == ASYNC_IO_BACKEND_URING)
+        __async_io_uring_deinit(aio);
+    else
+        __async_io_threads_deinit(aio);
+
+    FREE(aio->buffers);
+    FREE(aio);
+}
+
+int async_io_get_backend(const Async_io *aio)
+{
+    TRACE();
+
+    if (aio == NULL)
+        ERROR("aio == NULL\n", -1);
+
+    return aio->backend;
+}
+
+int async_io_register_buffers(Async_io * ___restrict___ aio, const struct iovec * ___restrict___ iov, size_t num)
+{
+    TRACE();
+
+    if (aio == NULL || iov == NULL || num == 0)
+        ERROR("aio == NULL || iov == NULL || num == 0\n", 1);
+
+    if (aio->buffers != NULL)
+        ERROR("Buffers are registered\n", 1);
+
+    aio->buffers = (struct iovec *)malloc(sizeof(struct iovec) * num);
+    if (aio->buffers == NULL)
+        ERROR("malloc error\n", 1);
+
+    (void)memcpy(aio->buffers, iov, sizeof(struct iovec) * num);
+
+    if (aio->backend == ASYNC_IO_BACKEND_URING)
+        if (syscall(__NR_io_uring_register, aio->u.uring.fd, IORING_REGISTER_BUFFERS, iov, (unsigned)num) == -1)
+        {
+            FREE(aio->buffers);
+            ERROR("io_uring_register error\n", 1);
+        }
+
+    aio->num_buffers = num;
+
+    return 0;
+}
+
+int async_io_prep_read(Async_io *aio, int fd, void *buf, size_t size, off_t offset, void *user_data)
+{
+    Async_io_request req;
+
+    TRACE();
+
+    if (aio == NULL || buf == NULL || fd < 0)
+        ERROR("aio == NULL || buf == NULL || fd < 0\n", 1);
+
+    req.op = ASYNC_IO_OP_READ;
+    req.fd = fd;
+    req.buf = buf;
+    req.size = size;
+    req.offset = offset;
+    req.user_data = user_data;
+
+    return __async_io_prep(aio, &req, -1);
+}
+
+int async_io_prep_write(Async_io *aio, int fd, const void *buf, size_t size, off_t offset, void *user_data)
+{
+    Async_io_request req;
+
+    TRACE();
+
+    if (aio == NULL || buf == NULL || fd < 0)
+        ERROR("aio == NULL || buf == NULL || fd < 0\n", 1);
+
+    req.op = ASYNC_IO_OP_WRITE;
+    req.fd = fd;
+    req.buf = (void *)buf;
+    req.size = size;
+    req.offset = offset;
+    req.user_data = user_data;
+
+    return __async_io_prep(aio, &req, -1);
+}
+
+int async_io_prep_read_fixed(Async_io *aio, int fd, void *buf, size_t size, off_t offset, size_t buf_index, void *user_data)
+{
+    Async_io_request req;
+    const struct iovec *iov;
+
+    TRACE();
+
+    if (aio == NULL || buf == NULL || fd < 0)
+        ERROR("aio == NULL || buf == NULL || fd < 0\n", 1);
+
+    if (buf_index >= aio->num_buffers)
+        ERROR("buf_index >= num_buffers\n", 1);
+
+    iov = &aio->buffers[buf_index];
+    if ((char *)buf < (char *)iov->iov_base || (char *)buf + size > (char *)iov->iov_base + iov->iov_len)
+        ERROR("buf is not in registered buffer\n", 1);
+
+    req.op = ASYNC_IO_OP_READ;
+    req.fd = fd;
+    req.buf = buf;
+    req.size = size;
+    req.offset = offset;
+    req.user_data = user_data;
+
+    return __async_io_prep(aio, &req, (ssize_t)buf_index);
+}
+
+int async_io_prep_write_fixed(Async_io *aio, int fd, const void *buf, size_t size, off_t offset, size_t buf_index, void *user_data)
+{
+    Async_io_request req;
+    const struct iovec *iov;
+
+    TRACE();
+
+    if (aio == NULL || buf == NULL || fd < 0)
+        ERROR("aio == NULL || buf == NULL || fd < 0\n", 1);
+
+    if (buf_index >= aio->num_buffers)
+        ERROR("buf_index >= num_buffers\n", 1);
+
+    iov = &aio->buffers[buf_index];
+    if ((const char *)buf < (char *)iov->iov_base || (const char *)buf + size > (char *)iov->iov_base + iov->iov_len)
+        ERROR("buf is not in registered buffer\n", 1);
+
+    req.op = ASYNC_IO_OP_WRITE;
+    req.fd = fd;
+    req.buf = (void *)buf;
+    req.size = size;
+    req.offset = offset;
+    req.user_data = user_data;
+
+    return __async_io_prep(aio, &req, (ssize_t)buf_index);
+}
+
+ssize_t async_io_submit(Async_io *aio)
+{
+    Async_io_threads *pool;
+    Async_io_uring *ring;
+    size_t submitted = 0;
+    size_t i;
+    int ret;
+
+    TRACE();
+
+    if (aio == NULL)
+        ERROR("aio == NULL\n", -1);
+
+    if (aio->pending == 0)
+        return 0;
+
+    if (aio->backend == ASYNC_IO_BACKEND_URING)
+    {
+        ring = &aio->u.uring;
+
+        /* publish SQEs, kernel reads tail with acquire */
+        __atomic_store_n(ring->sq_tail, ring->sq_local_tail, __ATOMIC_RELEASE);
+
+        while (submitted < aio->pending)
+        {
+            ret = (int)syscall(__NR_io_uring_enter, ring->fd, (unsigned)(aio->pending - submitted), 0, 0, NULL, 0);
+            if (ret == -1)
+            {
+                if (errno == EINTR || errno == EAGAIN)
+                    continue;
+
+                break;
+            }
+
+            submitted += (size_t)ret;
+        }
+    }
+    else
+    {
+        pool = &aio->u.threads;
+
+        (void)pthread_mutex_lock(&pool->mutex);
+        for (i = 0; i < aio->pending; ++i)
+            pool->reqs[(pool->req_head + pool->req_num + i) % aio->depth] = aio->prepared[i];
+
+        pool->req_num += aio->pending;
+        (void)pthread_cond_broadcast(&pool->req_cond);
+        (void)pthread_mutex_unlock(&pool->mutex);
+
+        submitted = aio->pending;
+    }
+
+    aio->inflight += submitted;
+    aio->pending -= submitted;
+
+    if (aio->pending > 0)
+        ERROR("io_uring_enter error\n", (ssize_t)submitted);
+
+    return (ssize_t)submitted;
+}
+
+ssize_t async_io_poll(Async_io * ___restrict___ aio, Async_io_completion * ___restrict___ cqe, size_t max, size_t min_wait)
+{
+    Async_io_threads *pool;
+    size_t num = 0;
+    ssize_t reaped;
+    int ret;
+
+    TRACE();
+
+    if (aio == NULL || cqe == NULL || max == 0)
+        ERROR("aio == NULL || cqe == NULL || max == 0\n", -1);
+
+    /* can't wait for more than is in flight */
+    min_wait = MIN(min_wait, max);
+    min_wait = MIN(min_wait, aio->inflight);
+
+    if (aio->backend == ASYNC_IO_BACKEND_URING)
+    {
+        for (;;)
+        {
+            reaped = __async_io_uring_reap(aio, cqe + num, max - num);
+            if (reaped == -1)
+                ERROR("__async_io_uring_reap error\n", -1);
+
+            num += (size_t)reaped;
+            if (num >= min_wait)
+                break;
+
+            ret = (int)syscall(__NR_io_uring_enter, aio->u.uring.fd, 0, (unsigned)(min_wait - num), IORING_ENTER_GETEVENTS, NULL, 0);
+            if (ret == -1 && errno != EINTR && errno != EAGAIN)
+                ERROR("io_uring_enter error\n", -1);
+        }
+    }
+    else
+    {
+        pool = &aio->u.threads;
+
+        (void)pthread_mutex_lock(&pool->mutex);
+        while (pool->cqe_num < min_wait)
+            (void)pthread_cond_wait(&pool->cqe_cond, &pool->mutex);
+
+        while (pool->cqe_num > 0 && num < max)
+        {
+            cqe[num] = pool->cqes[pool->cqe_head];
+            pool->cqe_head = (pool->cqe_head + 1) % aio->depth;
+            --pool->cqe_num;
+            ++num;
+        }
+        (void)pthread_mutex_unlock(&pool->mutex);
+    }
+
+    aio->inflight -= num;
+
+    return (ssize_t)num;
+}
+
+ssize_t async_io_get_inflight(const Async_io *aio)
+{
+    TRACE();
+
+    if (aio == NULL)
+        ERROR("aio == NULL\n", -1);
+
+    return (ssize_t)aio->inflight;
+}
+
+int async_io_open(const char *path, int open_flag, bool direct)
+{
+    int fd;
+
+    TRACE();
+
+    if (path == NULL)
+        ERROR("path == NULL\n", -1);
+
+    if (direct)
+    {
+        fd = open(path, open_flag | O_DIRECT, 0644);
+        if (fd != -1)
+            return fd;
+
+        /* tmpfs and some other fs don't support O_DIRECT */
+        if (errno != EINVAL)
+            ERROR("open error\n", -1);
+    }
+
+    fd = open(path, open_flag, 0644);
+    if (fd == -1)
+        ERROR("open error\n", -1);
+
+    return fd;
+}
+
+void *async_io_alloc_buffer(size_t size)
+{
+    void *buf;
+
+    TRACE();
+
+    if (size == 0)
+        ERROR("size == 0\n", NULL);
+
+    /* O_DIRECT needs aligned size also */
+    size = (size + ASYNC_IO_ALIGNMENT - 1) & ~((size_t)ASYNC_IO_ALIGNMENT - 1);
+    if (posix_memalign(&buf, ASYNC_IO_ALIGNMENT, size))
+        ERROR("posix_memalign error\n", NULL);
+
+    return buf;
+}
+
+void async_io_free_buffer(void *buf)
+{
+    TRACE();
+
+    FREE(buf);
+}
@@ -10,6 +10,8 @@
 #define LEFT_BIGGER     1
 #define RIGHT_BIGGER    2
 
+#define AVL_BATCH_LANES 16  /* lookups in flight in avl_search_batch */
+
 
 struct Avl_node
 {
@@ -1201,6 +1203,8 @@ bool avl_key_exist(const Avl * ___restrict___ tree, const void * ___restrict___
     return avl_node_search(tree, data_key) != NULL;
 }
 
+TREE_SEARCH_BATCH_CREATE(Avl, Avl_node, avl, AVL_BATCH_LANES, NULL)
+
 int avl_to_array(const Avl * ___restrict___ tree, void * ___restrict___ array, size_t * ___restrict___ size)
 {
     void *t;
@@ -0,0 +1,678 @@
+#include <generic.h>
+#include <bloom.h>
+#include <bitset.h>
+#include <hash.h>
+#include <log.h>
+#include <common.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#define BLOOM_LN2                   0.69314718055994530942
+#define BLOOM_GOLDEN64              0x9E3779B97F4A7C15ULL
+#define BLOOM_GOLDEN32              0x9E3779B1U
+
+/* "BLM1" and "BBF1" in little endian */
+#define BLOOM_MAGIC                 0x314D4C42U
+#define BLOCKED_BLOOM_MAGIC         0x31464242U
+#define BLOOM_HEADER_SIZE           16
+
+#define BLOCKED_BLOOM_BLOCK_BITS    512
+#define BLOCKED_BLOOM_BLOCK_WORDS   (BLOCKED_BLOOM_BLOCK_BITS / (sizeof(uint64_t) << 3))
+#define BLOCKED_BLOOM_BLOCK_BYTES   (BLOCKED_BLOOM_BLOCK_WORDS * sizeof(uint64_t))
+#define BLOCKED_BLOOM_MAX_HASHES    16
+
+/* blocked filter needs ~20% more bits to keep the same fpr as classic one */
+#define BLOCKED_BLOOM_OVERHEAD      1.2
+
+#define INT_DIV_CEIL(n ,k) (((n) + (k) - 1) / (k))
+
+/* serialized words are always 64bit, independent of DWORD size */
+#define BLOOM_PAYLOAD_SIZE(bits)    (INT_DIV_CEIL(bits, sizeof(uint64_t) << 3) * sizeof(uint64_t))
+
+struct Bloom_filter
+{
+    Bitset  *bitset;
+    size_t  bits;
+    size_t  hashes;
+};
+
+struct Blocked_bloom_filter
+{
+    uint64_t *blocks; /* aligned to cache line */
+    size_t  num_blocks;
+    size_t  hashes;
+};
+
+/*
+    Natural logarithm (to avoid dependency on libm)
+
+    PARAMS
+    @IN x - value > 0
+
+    RETURN
+    ln(x)
+*/
+static double __bloom_ln(double x);
+
+/*
+    Compute 64bit hash of key (murmur on high, xxhash on low bits)
+
+    PARAMS
+    @IN data - key
+    @IN size - size of key
+
+    RETURN
+    hash
+*/
+static ___inline___ uint64_t __bloom_hash(const void *data, size_t size);
+
+/*
+    Create bit mask of key in block
+
+    PARAMS
+    @IN hash - key hash
+    @IN hashes - number of bits per key
+    @OUT mask - mask (BLOCKED_BLOOM_BLOCK_WORDS words)
+
+    RETURN
+    This is a void function
+*/
+static ___inline___ void __blocked_bloom_mask(uint64_t hash, size_t hashes, uint64_t *mask);
+
+/*
+    Get block of key
+
+    PARAMS
+    @IN filter - pointer to filter
+    @IN hash - key hash
+
+    RETURN
+    Pointer to block
+*/
+static ___inline___ uint64_t *__blocked_bloom_block(const Blocked_bloom_filter *filter, uint64_t hash);
+
+/*
+    Check that all bits from @mask are set in @block
+
+    PARAMS
+    @IN block - filter block (aligned to cache line)
+    @IN mask - key mask
+
+    RETURN
+    true iff all bits are set
+    false iff at least one bit is clear
+*/
+static ___inline___ bool __blocked_bloom_test(const uint64_t * ___restrict___ block, const uint64_t * ___restrict___ mask);
+
+/*
+    Store / Load value in little endian
+
+    PARAMS
+    @IN buf - buffer
+    @IN val - value
+
+    RETURN
+    Load: value
+*/
+static ___inline___ void __bloom_store32(BYTE *buf, uint32_t val);
+static ___inline___ void __bloom_store64(BYTE *buf, uint64_t val);
+static ___inline___ uint32_t __bloom_load32(const BYTE *buf);
+static ___inline___ uint64_t __bloom_load64(const BYTE *buf);
+
+/*
+    Serialize array of words with header,
+    words are stored in little endian with their own width, payload is padded by zeros to 64bit words
+
+    PARAMS
+    @IN magic - magic number
+    @IN hashes - number of hash functions
+    @IN bits - number of bits
+    @IN words - array of words
+    @IN word_size - size of word (4 or 8)
+    @IN num_words - length of array
+    @OUT buf - buffer
+    @IN size - size of buffer
+
+    RETURN
+    -1 iff failure
+    Number of written bytes iff success
+*/
+static ssize_t __bloom_serialize(uint32_t magic, size_t hashes, size_t bits, const void *words, size_t word_size, size_t num_words, BYTE *buf, size_t size);
+
+/*
+    Load array of words from serialized payload
+
+    PARAMS
+    @IN buf - payload (after header)
+    @OUT words - array of words
+    @IN word_size - size of word (4 or 8)
+    @IN num_words - length of array
+
+    RETURN
+    This is a void function
+*/
+static void __bloom_deserialize_words(const BYTE *buf, void *words, size_t word_size, size_t num_words);
+
+static double __bloom_ln(double x)
+{
+    double k = 0.0;
+    double y;
+    double y2;
+    double term;
+    double sum = 0.0;
+    int i;
+
+    /* ln(x) = ln(m) + k * ln(2), m in [0.5; 1) */
+    while (x >= 1.0)
+    {
+        x /= 2.0;
+        k += 1.0;
+    }
+
+    while (x < 0.5)
+    {
+        x *= 2.0;
+        k -= 1.0;
+    }
+
+    /* ln(m) = 2 * atanh((m - 1) / (m + 1)) */
+    y = (x - 1.0) / (x + 1.0);
+    y2 = y * y;
+    term = y;
+    for (i = 1; i < 40; i += 2)
+    {
+        sum += term / (double)i;
+        term *= y2;
+    }
+
+    return 2.0 * sum + k * BLOOM_LN2;
+}
+
+static ___inline___ uint64_t __bloom_hash(const void *data, size_t size)
+{
+    return ((uint64_t)hash_murmur(data, size) << 32) | (uint64_t)hash_xxhash(data, size);
+}
+
+static ___inline___ void __blocked_bloom_mask(uint64_t hash, size_t hashes, uint64_t *mask)
+{
+    /* double hashing, position is top 9 bits of 32bit value */
+    const uint32_t a = (uint32_t)hash;
+    const uint32_t b = ((uint32_t)(hash >> 32) * BLOOM_GOLDEN32) | 1U;
+    uint32_t pos;
+    size_t i;
+
+    (void)memset(mask, 0, BLOCKED_BLOOM_BLOCK_BYTES);
+    for (i = 0; i < hashes; ++i)
+    {
+        pos = (a + (uint32_t)i * b) >> 23;
+        SET_BIT(mask[pos >> 6], pos & 63);
+    }
+}
+
+static ___inline___ uint64_t *__blocked_bloom_block(const Blocked_bloom_filter *filter, uint64_t hash)
+{
+    /* fast range reduction instead of modulo */
+    const size_t block = (size_t)(((hash >> 32) * (uint64_t)filter->num_blocks) >> 32);
+
+    return filter->blocks + block * BLOCKED_BLOOM_BLOCK_WORDS;
+}
+
+static ___inline___ bool __blocked_bloom_test(const uint64_t * ___restrict___ block, const uint64_t * ___restrict___ mask)
+{
+#if defined(__AVX2__)
+    const __m256i b0 = _mm256_load_si256((const __m256i *)(const void *)block);
+    const __m256i b1 = _mm256_load_si256((const __m256i *)(const void *)(block + 4));
+    const __m256i m0 = _mm256_loadu_si256((const __m256i *)(const void *)mask);
+    const __m256i m1 = _mm256_loadu_si256((const __m256i *)(const void *)(mask + 4));
+
+    /* testc: (~block & mask) == 0 */
+    return _mm256_testc_si256(b0, m0) && _mm256_testc_si256(b1, m1);
+#elif defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    __m128i miss = zero;
+    size_t i;
+
+    for (i = 0; i < BLOCKED_BLOOM_BLOCK_WORDS; i += 2)
+        miss = _mm_or_si128(miss, _mm_andnot_si128(_mm_load_si128((const __m128i *)(const void *)(block + i)),
+                                                   _mm_loadu_si128((const __m128i *)(const void *)(mask + i))));
+
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(miss, zero)) == 0xFFFF;
+#else
+    uint64_t miss = 0;
+    size_t i;
+
+    for (i = 0; i < BLOCKED_BLOOM_BLOCK_WORDS; ++i)
+        miss |= ~block[i] & mask[i];
+
+    return miss == 0;
+#endif
+}
+
+static ___inline___ void __bloom_store32(BYTE *buf, uint32_t val)
+{
+    buf[0] = (BYTE)(val);
+    buf[1] = (BYTE)(val >> 8);
+    buf[2] = (BYTE)(val >> 16);
+    buf[3] = (BYTE)(val >> 24);
+}
+
+static ___inline___ void __bloom_store64(BYTE *buf, uint64_t val)
+{
+    __bloom_store32(buf, (uint32_t)val);
+    __bloom_store32(buf + 4, (uint32_t)(val >> 32));
+}
+
+static ___inline___ uint32_t __bloom_load32(const BYTE *buf)
+{
+    return (uint32_t)buf[0] | ((uint32_t)buf[1] << 8) | ((uint32_t)buf[2] << 16) | ((uint32_t)buf[3] << 24);
+}
+
+static ___inline___ uint64_t __bloom_load64(const BYTE *buf)
+{
+    return (uint64_t)__bloom_load32(buf) | ((uint64_t)__bloom_load32(buf + 4) << 32);
+}
+
+static ssize_t __bloom_serialize(uint32_t magic, size_t hashes, size_t bits, const void *words, size_t word_size, size_t num_words, BYTE *buf, size_t size)
+{
+    const size_t payload = BLOOM_PAYLOAD_SIZE(bits);
+    size_t i;
+
+    if (BLOOM_HEADER_SIZE + payload > size)
+        ERROR("Buffer is too small\n", -1);
+
+    __bloom_store32(buf, magic);
+    __bloom_store32(buf + 4, (uint32_t)hashes);
+    __bloom_store64(buf + 8, (uint64_t)bits);
+
+    buf += BLOOM_HEADER_SIZE;
+    for (i = 0; i < num_words; ++i)
+    {
+        if (word_size == sizeof(uint64_t))
+            __bloom_store64(buf + i * word_size, ((const uint64_t *)words)[i]);
+        else
+            __bloom_store32(buf + i * word_size, ((const uint32_t *)words)[i]);
+    }
+
+    (void)memset(buf + num_words * word_size, 0, payload - num_words * word_size);
+
+    return (ssize_t)(BLOOM_HEADER_SIZE + payload);
+}
+
+static void __bloom_deserialize_words(const BYTE *buf, void *words, size_t word_size, size_t num_words)
+{
+    size_t i;
+
+    for (i = 0; i < num_words; ++i)
+    {
+        if (word_size == sizeof(uint64_t))
+            ((uint64_t *)words)[i] = __bloom_load64(buf + i * word_size);
+        else
+            ((uint32_t *)words)[i] = __bloom_load32(buf + i * word_size);
+    }
+}
+
+size_t bloom_optimal_bits(size_t n, double fpr)
+{
+    double bits;
+
+    TRACE();
+
+    if (n == 0 || fpr <= 0.0 || fpr >= 1.0)
+        ERROR("n == 0 || fpr not in (0; 1)\n", 0);
+
+    /* m = -n * ln(p) / ln(2)^2 */
+    bits = -(double)n * __bloom_ln(fpr) / (BLOOM_LN2 * BLOOM_LN2);
+
+    return (size_t)bits + 1;
+}
+
+size_t bloom_optimal_hashes(size_t bits, size_t n)
+{
+    double hashes;
+
+    TRACE();
+
+    if (bits == 0 || n == 0)
+        ERROR("bits == 0 || n == 0\n", 0);
+
+    /* k = m / n * ln(2) */
+    hashes = (double)bits / (double)n * BLOOM_LN2 + 0.5;
+    if (hashes < 1.0)
+        return 1;
+
+    return (size_t)hashes;
+}
+
+Bloom_filter *bloom_filter_create(size_t bits, size_t hashes)
+{
+    Bloom_filter *filter;
+
+    TRACE();
+
+    if (bits == 0 || hashes == 0)
+        ERROR("bits == 0 || hashes == 0\n", NULL);
+
+    filter = (Bloom_filter *)malloc(sizeof(Bloom_filter));
+    if (filter == NULL)
+        ERROR("malloc error\n", NULL);
+
+    filter->bitset = bitset_create(bits);
+    if (filter->bitset == NULL)
+    {
+        FREE(filter);
+        ERROR("bitset_create error\n", NULL);
+    }
+
+    filter->bits = bits;
+    filter->hashes = hashes;
+
+    return filter;
+}
+
+Bloom_filter *bloom_filter_create_for(size_t n, double fpr)
+{
+    size_t bits;
+
+    TRACE();
+
+    bits = bloom_optimal_bits(n, fpr);
+    if (bits == 0)
+        ERROR("bloom_optimal_bits error\n", NULL);
+
+    return bloom_filter_create(bits, bloom_optimal_hashes(bits, n));
+}
+
+void bloom_filter_destroy(Bloom_filter *filter)
+{
+    TRACE();
+
+    if (filter == NULL)
+        return;
+
+    bitset_destroy(filter->bitset);
+    FREE(filter);
+}
+
+int bloom_filter_insert(Bloom_filter * ___restrict___ filter, const void * ___restrict___ data, size_t size)
+{
+    uint64_t a;
+    uint64_t b;
+    size_t i;
+
+    TRACE();
+
+    if (filter == NULL || data == NULL || size == 0)
+        ERROR("filter == NULL || data == NULL || size == 0\n", 1);
+
+    a = __bloom_hash(data, size);
+    b = (a * BLOOM_GOLDEN64) | 1;
+    for (i = 0; i < filter->hashes; ++i)
+        bitset_set_bit(filter->bitset, (size_t)((a + (uint64_t)i * b) % filter->bits));
+
+    return 0;
+}
+
+bool bloom_filter_contains(const Bloom_filter * ___restrict___ filter, const void * ___restrict___ data, size_t size)
+{
+    uint64_t a;
+    uint64_t b;
+    size_t i;
+
+    TRACE();
+
+    if (filter == NULL || data == NULL || size == 0)
+        ERROR("filter == NULL || data == NULL || size == 0\n", true);
+
+    a = __bloom_hash(data, size);
+    b = (a * BLOOM_GOLDEN64) | 1;
+    for (i = 0; i < filter->hashes; ++i)
+        if (bitset_get_bit(filter->bitset, (size_t)((a + (uint64_t)i * b) % filter->bits)) == 0)
+            return false;
+
+    return true;
+}
+
+int bloom_filter_merge(Bloom_filter *dst, const Bloom_filter *src)
+{
+    DWORD *dst_words;
+    const DWORD *src_words;
+    size_t num_words;
+    size_t i;
+
+    TRACE();
+
+    if (dst == NULL || src == NULL)
+        ERROR("dst == NULL || src == NULL\n", 1);
+
+    if (dst->bits != src->bits || dst->hashes != src->hashes)
+        ERROR("Filters have different params\n", 1);
+
+    dst_words = bitset_get_set(dst->bitset, &num_words);
+    src_words = bitset_get_set(src->bitset, NULL);
+    for (i = 0; i < num_words; ++i)
+        dst_words[i] |= src_words[i];
+
+    return 0;
+}
+
+ssize_t bloom_filter_serialized_size(const Bloom_filter *filter)
+{
+    TRACE();
+
+    if (filter == NULL)
+        ERROR("filter == NULL\n", -1);
+
+    return (ssize_t)(BLOOM_HEADER_SIZE + BLOOM_PAYLOAD_SIZE(filter->bits));
+}
+
+ssize_t bloom_filter_serialize(const Bloom_filter * ___restrict___ filter, void * ___restrict___ buf, size_t size)
+{
+    const DWORD *words;
+    size_t num_words;
+
+    TRACE();
+
+    if (filter == NULL || buf == NULL)
+        ERROR("filter == NULL || buf == NULL\n", -1);
+
+    words = bitset_get_set(filter->bitset, &num_words);
+
+    return __bloom_serialize(BLOOM_MAGIC, filter->hashes, filter->bits, words, sizeof(DWORD), num_words, (BYTE *)buf, size);
+}
+
+Bloom_filter *bloom_filter_deserialize(const void *buf, size_t size)
+{
+    const BYTE *in = (const BYTE *)buf;
+    Bloom_filter *filter;
+    DWORD *words;
+    uint64_t bits;
+    size_t num_words;
+
+    TRACE();
+
+    if (buf == NULL || size < BLOOM_HEADER_SIZE)
+        ERROR("buf == NULL || size < header\n", NULL);
+
+    if (__bloom_load32(in) != BLOOM_MAGIC)
+        ERROR("Incorrect magic\n", NULL);
+
+    bits = __bloom_load64(in + 8);
+    if (bits == 0 || bits > SIZE_MAX / 2 || INT_DIV_CEIL(bits, sizeof(uint64_t) << 3) > (size - BLOOM_HEADER_SIZE) / sizeof(uint64_t))
+        ERROR("Corrupted buffer\n", NULL);
+
+    filter = bloom_filter_create((size_t)bits, __bloom_load32(in + 4));
+    if (filter == NULL)
+        ERROR("bloom_filter_create error\n", NULL);
+
+    words = bitset_get_set(filter->bitset, &num_words);
+    __bloom_deserialize_words(in + BLOOM_HEADER_SIZE, words, sizeof(DWORD), num_words);
+
+    return filter;
+}
+
+Blocked_bloom_filter *blocked_bloom_filter_create(size_t bits, size_t hashes)
+{
+    Blocked_bloom_filter *filter;
+    void *blocks;
+
+    TRACE();
+
+    if (bits == 0 || hashes == 0)
+        ERROR("bits == 0 || hashes == 0\n", NULL);
+
+    filter = (Blocked_bloom_filter *)malloc(sizeof(Blocked_bloom_filter));
+    if (filter == NULL)
+        ERROR("malloc error\n", NULL);
+
+    filter->num_blocks = INT_DIV_CEIL(bits, BLOCKED_BLOOM_BLOCK_BITS);
+    filter->hashes = MIN(hashes, (size_t)BLOCKED_BLOOM_MAX_HASHES);
+
+    if (posix_memalign(&blocks, BLOCKED_BLOOM_BLOCK_BYTES, filter->num_blocks * BLOCKED_BLOOM_BLOCK_BYTES))
+    {
+        FREE(filter);
+        ERROR("posix_memalign error\n", NULL);
+    }
+
+    filter->blocks = (uint64_t *)blocks;
+    (void)memset(filter->blocks, 0, filter->num_blocks * BLOCKED_BLOOM_BLOCK_BYTES);
+
+    return filter;
+}
+
+Blocked_bloom_filter *blocked_bloom_filter_create_for(size_t n, double fpr)
+{
+    size_t bits;
+    double real_bits;
+
+    TRACE();
+
+    bits = bloom_optimal_bits(n, fpr);
+    if (bits == 0)
+        ERROR("bloom_optimal_bits error\n", NULL);
+
+    real_bits = (double)bits * BLOCKED_BLOOM_OVERHEAD;
+
+    return blocked_bloom_filter_create((size_t)real_bits, bloom_optimal_hashes(bits, n));
+}
+
+void blocked_bloom_filter_destroy(Blocked_bloom_filter *filter)
+{
+    TRACE();
+
+    if (filter == NULL)
+        return;
+
+    FREE(filter->blocks);
+    FREE(filter);
+}
+
+int blocked_bloom_filter_insert(Blocked_bloom_filter * ___restrict___ filter, const void * ___restrict___ data, size_t size)
+{
+    uint64_t mask[BLOCKED_BLOOM_BLOCK_WORDS];
+    uint64_t *block;
+    uint64_t hash;
+    size_t i;
+
+    TRACE();
+
+    if (filter == NULL || data == NULL || size == 0)
+        ERROR("filter == NULL || data == NULL || size == 0\n", 1);
+
+    hash = __bloom_hash(data, size);
+    block = __blocked_bloom_block(filter, hash);
+    __blocked_bloom_mask(hash, filter->hashes, mask);
+
+    for (i = 0; i < BLOCKED_BLOOM_BLOCK_WORDS; ++i)
+        block[i] |= mask[i];
+
+    return 0;
+}
+
+bool blocked_bloom_filter_contains(const Blocked_bloom_filter * ___restrict___ filter, const void * ___restrict___ data, size_t size)
+{
+    uint64_t mask[BLOCKED_BLOOM_BLOCK_WORDS];
+    const uint64_t *block;
+    uint64_t hash;
+
+    TRACE();
+
+    if (filter == NULL || data == NULL || size == 0)
+        ERROR("filter == NULL || data == NULL || size == 0\n", true);
+
+    hash = __bloom_hash(data, size);
+    block = __blocked_bloom_block(filter, hash);
+    load_to_cache(block, CACHE_READ, CACHE_SAVE_LOW_PRIO);
+    __blocked_bloom_mask(hash, filter->hashes, mask);
+
+    return __blocked_bloom_test(block, mask);
+}
+
+int blocked_bloom_filter_merge(Blocked_bloom_filter *dst, const Blocked_bloom_filter *src)
+{
+    size_t i;
+
+    TRACE();
+
+    if (dst == NULL || src == NULL)
+        ERROR("dst == NULL || src == NULL\n", 1);
+
+    if (dst->num_blocks != src->num_blocks || dst->hashes != src->hashes)
+        ERROR("Filters have different params\n", 1);
+
+    for (i = 0; i < dst->num_blocks * BLOCKED_BLOOM_BLOCK_WORDS; ++i)
+        dst->blocks[i] |= src->blocks[i];
+
+    return 0;
+}
+
+ssize_t blocked_bloom_filter_serialized_size(const Blocked_bloom_filter *filter)
+{
+    TRACE();
+
+    if (filter == NULL)
+        ERROR("filter == NULL\n", -1);
+
+    return (ssize_t)(BLOOM_HEADER_SIZE + filter->num_blocks * BLOCKED_BLOOM_BLOCK_BYTES);
+}
+
+ssize_t blocked_bloom_filter_serialize(const Blocked_bloom_filter * ___restrict___ filter, void * ___restrict___ buf, size_t size)
+{
+    TRACE();
+
+    if (filter == NULL || buf == NULL)
+        ERROR("filter == NULL || buf == NULL\n", -1);
+
+    return __bloom_serialize(BLOCKED_BLOOM_MAGIC, filter->hashes, filter->num_blocks * BLOCKED_BLOOM_BLOCK_BITS,
+                             filter->blocks, sizeof(uint64_t), filter->num_blocks * BLOCKED_BLOOM_BLOCK_WORDS, (BYTE *)buf, size);
+}
+
+Blocked_bloom_filter *blocked_bloom_filter_deserialize(const void *buf, size_t size)
+{
+    const BYTE *in = (const BYTE *)buf;
+    Blocked_bloom_filter *filter;
+    uint64_t bits;
+
+    TRACE();
+
+    if (buf == NULL || size < BLOOM_HEADER_SIZE)
+        ERROR("buf == NULL || size < header\n", NULL);
+
+    if (__bloom_load32(in) != BLOCKED_BLOOM_MAGIC)
+        ERROR("Incorrect magic\n", NULL);
+
+    bits = __bloom_load64(in + 8);
+    if (bits == 0 || bits % BLOCKED_BLOOM_BLOCK_BITS != 0 || bits / BLOCKED_BLOOM_BLOCK_BITS > (size - BLOOM_HEADER_SIZE) / BLOCKED_BLOOM_BLOCK_BYTES)
+        ERROR("Corrupted buffer\n", NULL);
+
+    filter = blocked_bloom_filter_create((size_t)bits, __bloom_load32(in + 4));
+    if (filter == NULL)
+        ERROR("blocked_bloom_filter_create error\n", NULL);
+
+    __bloom_deserialize_words(in + BLOOM_HEADER_SIZE, filter->blocks, sizeof(uint64_t), filter->num_blocks * BLOCKED_BLOOM_BLOCK_WORDS);
+
+    return filter;
+}
@@ -10,8 +10,7 @@
 #include <fcntl.h>
 #include <log.h>
 #include <stdlib.h>
-#include <cstring.h>
-#include <ctype.h>
+#include <sysinfo.h>
 #include <string.h>
 
 struct CCache
@@ -26,7 +25,6 @@ static const char * const PATH_TO_CACHE = "./.ccache";
 
 static ___inline___ bool is_aligned(size_t size);
 static ___inline___ size_t align_size(size_t size);
-static size_t get_available_memory(void);
 
 static ___inline___ bool is_aligned(size_t size)
 {
@@ -65,39 +63,6 @@ static ___inline___ size_t align_size(size_t size)
     return size;
 }
 
-static size_t get_available_memory(void)
-{
-    const char * const meminfo = "/proc/meminfo";
-    const char * const token = "MemAvailable:";
-    char buffer [BIT(12)] = {0}; /* 4KB buffer */
-    String *string;
-    int fd;
-    size_t line;
-    char *ptr;
-    size_t ram;
-
-    fd = open(meminfo, O_RDONLY);
-    if (fd == -1)
-        ERROR("open error\n", 0);
-
-    if (read(fd, buffer, ARRAY_SIZE(buffer)) == -1)
-        ERROR("read error\n", 0);
-
-    close(fd);
-
-    string = string_create_from_str(buffer);
-    line = (size_t)string_find_str_first(string, token);
-
-    ptr = &(string_get_str(string)[line]);
-    while (!isdigit(*ptr))
-        ++ptr;
-
-    /* killobytes to bytes */
-    ram = (size_t)strtoul(ptr, NULL, 10) * BIT(10);
-
-    string_destroy(string);
-    return ram;
-}
 
 CCache *ccache_create(size_t size)
 {
@@ -117,7 +82,7 @@ CCache *ccache_create(size_t size)
     cache->mmap_size = (size_t)asize;
     cache->len = size;
 
-    if (size < get_available_memory())
+    if (size < sysinfo_get_available_memory())
     {
         cache->cache = mmap64(NULL, (size_t)asize, PROT_EXEC | PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
         if (cache->cache == MAP_FAILED)
@@ -7,12 +7,25 @@
 #include <ctype.h>
 #include <string.h>
 #include <darray.h>
+#include <ahocorasick.h>
+#include <generic.h>
 
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#define STRING_SSO_BYTES    24
+
+/*
+    Short strings (len < STRING_SSO_BYTES) are kept inline in sso buffer, then str == sso,
+    so String cannot be copied by value
+*/
 struct String
 {
     char *str;
     size_t len;
     size_t allocated;
+    char sso[STRING_SSO_BYTES];
 };
 
 struct String_iterator
@@ -21,25 +34,51 @@ struct String_iterator
     ssize_t index;
 };
 
+typedef enum string_tokenizer_type
+{
+    STRING_TOKENIZER_C,
+    STRING_TOKENIZER_SET,
+    STRING_TOKENIZER_VIEW
+} string_tokenizer_type;
+
 #define INIT_BYTES  BIT(7)
 
-/* Macro to calculate size to alloc ( power of two ) from bytes */
-#define __string_calc_size(bytes) \
+/* max length of printed 64bit integer with sign */
+#define STRING_INT_MAX_CHARS    20
+
+/* after this number of false candidates search can switch to KMP */
+#define STRING_SEARCH_MISSES_LIMIT  64
+
+#if defined(__AVX2__)
+#define STRING_VEC_LEN 32
+typedef __m256i string_vec_t;
+#define string_vec_set1(c)          _mm256_set1_epi8(c)
+#define string_vec_eq_mask(ptr, v)  (WORD)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(const void *)(ptr)), v))
+#elif defined(__SSE2__)
+#define STRING_VEC_LEN 16
+typedef __m128i string_vec_t;
+#define string_vec_set1(c)          _mm_set1_epi8(c)
+#define string_vec_eq_mask(ptr, v)  (WORD)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(const void *)(ptr)), v))
+#endif
+
+/* Macro to calculate size to alloc ( inline buffer or power of two ) from string length, '\0' included */
+#define __string_calc_size(len) \
     __extension__ \
     ({ \
-        size_t __size = BIT(LOG2_long((unsigned long)(bytes - 1)) + 1); \
-        __size < INIT_BYTES ? INIT_BYTES : __size; \
+        size_t __bytes = (size_t)(len) + 1; \
+        __bytes <= STRING_SSO_BYTES ? STRING_SSO_BYTES : \
+            __bytes <= INIT_BYTES ? INIT_BYTES : (size_t)BIT(LOG2_long((unsigned long)(__bytes - 1)) + 1); \
     })
 
 /* macro to create string from primitive type (variable n) and with printf format (fmt) */
-#define __string_create_from(n, fmt, bytes) \
+#define __string_create_from(n, fmt, chars) \
     do { \
         String *s; \
         ssize_t ret; \
         \
         TRACE(); \
         \
-        s = __string_create(__string_calc_size(bytes)); \
+        s = __string_create(__string_calc_size(chars)); \
         if (s == NULL) \
             ERROR("string_create error\n", NULL); \
         \
@@ -155,51 +194,88 @@ static ___inline___ int __string_insert(String * ___restrict___ s, const char *
 
     PARAMS
     @IN pattern - pattern
+    @IN pattern_len - pattern length
 
     RETURN
     NULL iff failure
     States iff success
 */
-static ssize_t *kmp_states_create(const char *pattern);
+static ssize_t *kmp_states_create(const char *pattern, size_t pattern_len);
 
 /*
-    Knuth-Morris-Pratt algorithm
+    Knuth-Morris-Pratt algorithm (text and pattern don't need '\0')
 
     PARAMS
     @IN text - text
+    @IN text_len - text length
     @IN pattern - pattern
+    @IN pattern_len - pattern length
     @IN first - want first occurrence ?
 
     RETURN
     -1 iff text hasn't pattern
     index of pattern begining in text iff success
 */
-static ssize_t kmp(const char *text, const char *pattern, bool first);
+static ssize_t kmp(const char * ___restrict___ text, size_t text_len, const char * ___restrict___ pattern, size_t pattern_len, bool first);
+
+/*
+    Find char in buffer (SIMD scan when available)
+
+    PARAMS
+    @IN text - buffer
+    @IN len - buffer length
+    @IN c - char to find
+    @IN first - want first occurrence ?
+
+    RETURN
+    -1 iff buffer hasn't c
+    index of c in buffer iff success
+*/
+static ___inline___ ssize_t __string_scan_c(const char *text, size_t len, char c, bool first);
+
+/*
+    Find pattern in buffer.
+    Candidates are filtered by first and last char of pattern (SIMD when available) and verified by memcmp,
+    when filter gives too many false candidates or there is no SIMD, Knuth-Morris-Pratt is used
+
+    PARAMS
+    @IN text - buffer
+    @IN text_len - buffer length
+    @IN pattern - pattern
+    @IN pattern_len - pattern length
+    @IN first - want first occurrence ?
+
+    RETURN
+    -1 iff buffer hasn't pattern
+    index of pattern begining in buffer iff success
+*/
+static ssize_t __string_search(const char * ___restrict___ text, size_t text_len, const char * ___restrict___ pattern, size_t pattern_len, bool first);
 
 /*
-    Find pattern in string
+    Find pattern in string, string is not modified so many readers can search the same string
 
     PARAMS
     @IN string - pointer to string
     @IN pattern - pattern to find
+    @IN pattern_len - pattern length
     @IN begin - begin string pos
-    @IN end - end string pos
+    @IN end - end string pos (exclusive)
     @IN first - want you first occurrence ?
 
     RETURN
     -1 iff text hasn't pattern
     index of pattern begining in text iff success
 */
-static ___inline___ ssize_t __string_find_str(const String * ___restrict___ string, const char * ___restrict___ pattern, size_t begin, size_t end, bool first);
+static ___inline___ ssize_t __string_find_str(const String * ___restrict___ string, const char * ___restrict___ pattern, size_t pattern_len, size_t begin, size_t end, bool first);
 
 /*
-    Find pattern in string
+    Find char in string
 
     PARAMS
     @IN string - pointer to string
     @IN c - char to find
     @IN begin - begin string pos
-    @IN end - end string pos
+    @IN end - end string pos (inclusive)
     @IN first - want you first occurrence ?
 
     RETURN
@@ -208,9 +284,85 @@ static ___inline___ ssize_t __string_find_str(const String * ___restrict___ stri
 */
 static ___inline___ ssize_t __string_find_c(const String *string, char c, size_t begin, size_t end, bool first);
 
+/*
+    Find first char from tokenizer char-set in buffer (SIMD scan for small sets)
+
+    PARAMS
+    @IN text - buffer
+    @IN len - buffer length
+    @IN tok - pointer to tokenizer
+
+    RETURN
+    -1 iff buffer hasn't any char from set
+    index of first char from set iff success
+*/
+static ___inline___ ssize_t __string_scan_set(const char * ___restrict___ text, size_t len, const String_tokenizer * ___restrict___ tok);
+
+/*
+    Find next delimeter in tokenizer text
+
+    PARAMS
+    @IN tok - pointer to tokenizer
+    @IN from - begin of search
+    @OUT delim_len - length of found delimeter
+
+    RETURN
+    -1 iff there is no more delimeters
+    position of delimeter in text iff success
+*/
+static ___inline___ ssize_t __string_tokenizer_find_delim(const String_tokenizer * ___restrict___ tok, size_t from, size_t * ___restrict___ delim_len);
+
+/*
+    Init common part of tokenizer
+
+    PARAMS
+    @IN tok - pointer to tokenizer
+    @IN text - text to split
+    @IN type - tokenizer type
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+static ___inline___ int __string_tokenizer_init(String_tokenizer *tok, String_view text, string_tokenizer_type type);
+
+/*
+    Replace all non-overlapping occurrences of pattern (from left to right) by @rep,
+    replaced chars are not searched again.
+    If @rep isn't longer than pattern string is rewritten in place in one pass,
+    otherwise matches are counted first and result is built in new buffer by one copy
+
+    PARAMS
+    @IN s - pointer to String
+    @IN pattern - pattern
+    @IN pattern_len - pattern length
+    @IN rep - replacement (can be NULL iff @rep_len == 0)
+    @IN rep_len - replacement length
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+static int __string_replace_all(String * ___restrict___ s, const char * ___restrict___ pattern, size_t pattern_len, const char * ___restrict___ rep, size_t rep_len);
+
+/*
+    Set new buffer with @len chars as String content, old buffer is freed
+
+    PARAMS
+    @IN s - pointer to String
+    @IN buf - new buffer (or NULL when content is already in sso buffer)
+    @IN size - size of new buffer
+    @IN len - length of string in new buffer
+
+    RETURN
+    This is a void function
+*/
+static ___inline___ void __string_set_buffer(String *s, char *buf, size_t size, size_t len);
+
 static ___inline___ int __string_realloc(String *s, size_t new_len)
 {
     size_t size;
+    char *str;
 
     TRACE();
 
@@ -218,15 +370,43 @@ static ___inline___ int __string_realloc(String *s, size_t new_len)
         ERROR("s == NULL\n", 1);
 
     size = __string_calc_size(new_len);
-    if (size != s->allocated && size >= INIT_BYTES)
+    if (size == s->allocated)
+        return 0;
+
+    if (size == STRING_SSO_BYTES)
     {
-        s->str = (char *)realloc(s->str, size);
-        if (s->str == NULL)
+        /* back to inline buffer, new_len chars are always in first STRING_SSO_BYTES */
+        if (memcpy((void *)s->sso, (void *)s->str, MIN(s->len + 1, size)) == NULL)
+            ERROR("memcpy error\n", 1);
+
+        FREE(s->str);
+        s->str = s->sso;
+    }
+    else if (s->str == s->sso)
+    {
+        str = (char *)malloc(size);
+        if (str == NULL)
+            ERROR("malloc error\n", 1);
+
+        if (memcpy((void *)str, (void *)s->sso, s->len + 1) == NULL)
+        {
+            FREE(str);
+            ERROR("memcpy error\n", 1);
+        }
+
+        s->str = str;
+    }
+    else
+    {
+        str = (char *)realloc(s->str, size);
+        if (str == NULL)
             ERROR("realloc error\n", 1);
 
-        s->allocated = size;
+        s->str = str;
     }
 
+    s->allocated = size;
+
     return 0;
 }
 
@@ -258,13 +438,22 @@ static ___inline___ String *__string_create(size_t bytes)
     if (s == NULL)
         ERROR("malloc error\n", NULL);
 
-    s->str = (char *)malloc(bytes);
-    if (s->str == NULL)
+    if (bytes <= STRING_SSO_BYTES)
     {
-        FREE(s);
-        ERROR("malloc error\n", NULL);
+        s->str = s->sso;
+        bytes = STRING_SSO_BYTES;
+    }
+    else
+    {
+        s->str = (char *)malloc(bytes);
+        if (s->str == NULL)
+        {
+            FREE(s);
+            ERROR("malloc error\n", NULL);
+        }
     }
 
+    s->str[0] = '\0';
     s->len = 0;
     s->allocated = bytes;
 
@@ -349,11 +538,10 @@ static ___inline___ int __string_insert(String * ___restrict___ s, const char *
     return 0;
 }
 
-static ssize_t *kmp_states_create(const char *pattern)
+static ssize_t *kmp_states_create(const char *pattern, size_t pattern_len)
 {
     ssize_t *states;
     size_t i;
-    size_t len;
     ssize_t longest_prefix;
 
     TRACE();
@@ -361,11 +549,10 @@ static ssize_t *kmp_states_create(const char *pattern)
     if(pattern == NULL)
         ERROR("pattern == NULL\n", NULL);
 
-    len = strlen(pattern);
-    if (len == 0)
+    if (pattern_len == 0)
         ERROR("String is empty\n", NULL);
 
-    states = (ssize_t *)malloc(sizeof(ssize_t) * len);
+    states = (ssize_t *)malloc(sizeof(ssize_t) * pattern_len);
     if (states == NULL)
         ERROR("malloc error\n", NULL);
 
@@ -375,7 +562,7 @@ static ssize_t *kmp_states_create(const char *pattern)
     /* 1 char has empty char as longest prefix */
     states[0] = longest_prefix;
 
-    for (i = 1; i < len; ++i)
+    for (i = 1; i < pattern_len; ++i)
     {
 		/* go back while pattern doesn't match */
       	while (longest_prefix > -1 && pattern[longest_prefix + 1] != pattern[i])
@@ -395,12 +582,10 @@ static ssize_t *kmp_states_create(const char *pattern)
     return states;
 }
 
-ssize_t kmp(const char *text, const char *pattern, bool first)
+static ssize_t kmp(const char * ___restrict___ text, size_t text_len, const char * ___restrict___ pattern, size_t pattern_len, bool first)
 {
     ssize_t *states;
-	ssize_t text_len;
-	ssize_t pattern_len;
-	ssize_t i;
+	size_t i;
 	ssize_t matches;
     ssize_t end = -1;
 
@@ -412,13 +597,10 @@ ssize_t kmp(const char *text, const char *pattern, bool first)
     if (pattern == NULL)
         ERROR("pattern == NULL\n", -1);
 
-    states = kmp_states_create(pattern);
+    states = kmp_states_create(pattern, pattern_len);
     if(states == NULL)
         ERROR("kmp_states_create error\n", -1);
 
-    text_len = (ssize_t)strlen(text);
-    pattern_len = (ssize_t)strlen(pattern);
-
     matches = -1;
     for (i = 0; i < text_len; ++i)
     {
@@ -431,9 +613,9 @@ ssize_t kmp(const char *text, const char *pattern, bool first)
 			++matches;
 
 		/* we find pattern in text */
-		if (matches == pattern_len - 1)
+		if (matches == (ssize_t)pattern_len - 1)
         {
-            end = i - pattern_len + 1;
+            end = (ssize_t)(i - pattern_len + 1);
             if (first)
                 break;
             else /* else needed beacuse newest compiler has warn here */
@@ -446,27 +628,154 @@ ssize_t kmp(const char *text, const char *pattern, bool first)
     return end;
 }
 
-static ___inline___ ssize_t __string_find_str(const String * ___restrict___ string, const char * ___restrict___ pattern, size_t begin, size_t end, bool first)
+static ___inline___ ssize_t __string_scan_c(const char *text, size_t len, char c, bool first)
+{
+    size_t i;
+#ifdef STRING_VEC_LEN
+    const string_vec_t vc = string_vec_set1(c);
+    WORD mask;
+#endif
+
+    if (first)
+    {
+        i = 0;
+#ifdef STRING_VEC_LEN
+        for (; i + STRING_VEC_LEN <= len; i += STRING_VEC_LEN)
+        {
+            mask = string_vec_eq_mask(text + i, vc);
+            if (mask)
+                return (ssize_t)(i + (size_t)__builtin_ctz(mask));
+        }
+#endif
+        for (; i < len; ++i)
+            if (text[i] == c)
+                return (ssize_t)i;
+    }
+    else
+    {
+        i = len;
+#ifdef STRING_VEC_LEN
+        while (i >= STRING_VEC_LEN)
+        {
+            i -= STRING_VEC_LEN;
+            mask = string_vec_eq_mask(text + i, vc);
+            if (mask)
+                return (ssize_t)(i + 31 - (size_t)__builtin_clz(mask));
+        }
+#endif
+        while (i-- > 0)
+            if (text[i] == c)
+                return (ssize_t)i;
+    }
+
+    return -1;
+}
+
+static ssize_t __string_search(const char * ___restrict___ text, size_t text_len, const char * ___restrict___ pattern, size_t pattern_len, bool first)
+{
+    size_t candidates;
+#ifdef STRING_VEC_LEN
+    size_t i;
+    ssize_t ret;
+    const string_vec_t vfirst = string_vec_set1(pattern[0]);
+    const string_vec_t vlast = string_vec_set1(pattern[pattern_len - 1]);
+    size_t misses = 0;
+    size_t bit;
+    WORD mask;
+#endif
+
+    TRACE();
+
+    if (pattern_len == 0 || pattern_len > text_len)
+        return -1;
+
+    if (pattern_len == 1)
+        return __string_scan_c(text, text_len, pattern[0], first);
+
+    /* pattern can start only at [0, candidates) */
+    candidates = text_len - pattern_len + 1;
+
+#ifndef STRING_VEC_LEN
+    return kmp(text, text_len, pattern, pattern_len, first);
+#else
+    if (first)
+    {
+        for (i = 0; i + STRING_VEC_LEN <= candidates; i += STRING_VEC_LEN)
+        {
+            /* filter is useless for this text, KMP is linear in worst case */
+            if (misses > STRING_SEARCH_MISSES_LIMIT && misses > (i >> 3))
+            {
+                ret = kmp(text + i, text_len - i, pattern, pattern_len, true);
+                return ret == -1 ? -1 : ret + (ssize_t)i;
+            }
+
+            mask = string_vec_eq_mask(text + i, vfirst) & string_vec_eq_mask(text + i + pattern_len - 1, vlast);
+            while (mask)
+            {
+                bit = (size_t)__builtin_ctz(mask);
+                if (memcmp(text + i + bit + 1, pattern + 1, pattern_len - 2) == 0)
+                    return (ssize_t)(i + bit);
+
+                ++misses;
+                mask &= mask - 1;
+            }
+        }
+
+        for (; i < candidates; ++i)
+            if (text[i] == pattern[0] && text[i + pattern_len - 1] == pattern[pattern_len - 1] &&
+                memcmp(text + i + 1, pattern + 1, pattern_len - 2) == 0)
+                return (ssize_t)i;
+    }
+    else
+    {
+        i = candidates;
+        while (i >= STRING_VEC_LEN)
+        {
+            if (misses > STRING_SEARCH_MISSES_LIMIT && misses > ((candidates - i) >> 3))
+                return kmp(text, i + pattern_len - 1, pattern, pattern_len, false);
+
+            i -= STRING_VEC_LEN;
+            mask = string_vec_eq_mask(text + i, vfirst) & string_vec_eq_mask(text + i + pattern_len - 1, vlast);
+            while (mask)
+            {
+                bit = 31 - (size_t)__builtin_clz(mask);
+                if (memcmp(text + i + bit + 1, pattern + 1, pattern_len - 2) == 0)
+                    return (ssize_t)(i + bit);
+
+                ++misses;
+                mask &= ~((WORD)1 << bit);
+            }
+        }
+
+        while (i-- > 0)
+            if (text[i] == pattern[0] && text[i + pattern_len - 1] == pattern[pattern_len - 1] &&
+                memcmp(text + i + 1, pattern + 1, pattern_len - 2) == 0)
+                return (ssize_t)i;
+    }
+
+    return -1;
+#endif
+}
+
+static ___inline___ ssize_t __string_find_str(const String * ___restrict___ string, const char * ___restrict___ pattern, size_t pattern_len, size_t begin, size_t end, bool first)
 {
     ssize_t ret;
-    char c;
 
     TRACE();
 
     if (string == NULL)
         ERROR("string == NULL\n", -1);
 
+    if (pattern == NULL)
+        ERROR("pattern == NULL\n", -1);
+
     if (end < begin)
         ERROR("end < begin\n", -1);
 
     if (begin > string->len || end > string->len)
         ERROR("begin or end grater than string len\n", -1);
 
-    c = string->str[end];
-    string->str[end] = '\0';
-    ret = kmp(string->str + begin, pattern, first);
-    string->str[end] = c;
-
+    ret = __string_search(string->str + begin, end - begin, pattern, pattern_len, first);
     if (ret == -1)
       return -1;
 
@@ -475,7 +784,7 @@ static ___inline___ ssize_t __string_find_str(const String * ___restrict___ stri
 
 static ___inline___ ssize_t __string_find_c(const String *string, char c, size_t begin, size_t end, bool first)
 {
-    ssize_t i;
+    ssize_t ret;
 
     TRACE();
 
@@ -488,27 +797,123 @@ static ___inline___ ssize_t __string_find_c(const String *string, char c, size_t
     if (begin >= string->len || end > string->len)
         ERROR("begin or end grater than string len\n", -1);
 
-    if (first)
+    /* str[len] is '\0' so [begin, end] is always readable */
+    ret = __string_scan_c(string->str + begin, end - begin + 1, c, first);
+    if (ret == -1)
+        return -1;
+
+    return ret + (ssize_t)begin;
+}
+
+static ___inline___ void __string_set_buffer(String *s, char *buf, size_t size, size_t len)
+{
+    TRACE();
+
+    if (s->str != s->sso)
+        FREE(s->str);
+
+    s->str = buf == NULL ? s->sso : buf;
+    s->allocated = size;
+    s->len = len;
+    s->str[len] = '\0';
+}
+
+static int __string_replace_all(String * ___restrict___ s, const char * ___restrict___ pattern, size_t pattern_len, const char * ___restrict___ rep, size_t rep_len)
+{
+    ssize_t ret;
+    size_t r;
+    size_t w;
+    size_t matches;
+    size_t new_len;
+    size_t size;
+    char *buf;
+    char sso[STRING_SSO_BYTES];
+
+    TRACE();
+
+    if (pattern_len == 0)
+        ERROR("pattern is empty\n", 1);
+
+    if (rep_len <= pattern_len)
     {
-        for (i = (ssize_t)begin; i <= (ssize_t)end; ++i)
-            if (string->str[i] == c)
-                return i;
+        /* result is not longer, so write position never overtakes read position */
+        r = 0;
+        w = 0;
+        while ((ret = __string_search(s->str + r, s->len - r, pattern, pattern_len, true)) != -1)
+        {
+            if (w != r)
+                (void)memmove(s->str + w, s->str + r, (size_t)ret);
+
+            w += (size_t)ret;
+            if (rep_len > 0)
+                (void)memcpy(s->str + w, rep, rep_len);
+
+            w += rep_len;
+            r += (size_t)ret + pattern_len;
+        }
+
+        if (r == 0)
+            return 0;
+
+        (void)memmove(s->str + w, s->str + r, s->len - r);
+        s->len = w + s->len - r;
+        s->str[s->len] = '\0';
+
+        return __string_realloc(s, s->len);
     }
+
+    matches = 0;
+    r = 0;
+    while ((ret = __string_search(s->str + r, s->len - r, pattern, pattern_len, true)) != -1)
+    {
+        ++matches;
+        r += (size_t)ret + pattern_len;
+    }
+
+    if (matches == 0)
+        return 0;
+
+    new_len = s->len + matches * (rep_len - pattern_len);
+    size = __string_calc_size(new_len);
+    if (size == STRING_SSO_BYTES)
+        buf = sso;
     else
     {
-        for (i = (ssize_t)end; i >= (ssize_t)begin; --i)
-            if (string->str[i] == c)
-                return i;
+        buf = (char *)malloc(size);
+        if (buf == NULL)
+            ERROR("malloc error\n", 1);
     }
 
-    return -1;
+    r = 0;
+    w = 0;
+    while (matches-- > 0)
+    {
+        ret = __string_search(s->str + r, s->len - r, pattern, pattern_len, true);
+        (void)memcpy(buf + w, s->str + r, (size_t)ret);
+        w += (size_t)ret;
+        (void)memcpy(buf + w, rep, rep_len);
+        w += rep_len;
+        r += (size_t)ret + pattern_len;
+    }
+
+    (void)memcpy(buf + w, s->str + r, s->len - r);
+
+    if (buf == sso)
+    {
+        (void)memcpy(s->sso, sso, new_len);
+        buf = NULL;
+    }
+
+    __string_set_buffer(s, buf, size, new_len);
+
+    return 0;
 }
 
 String *string_create(void)
 {
     TRACE();
 
-    return __string_create(INIT_BYTES);
+    return __string_create(STRING_SSO_BYTES);
 }
 
 void string_destroy(String *string)
@@ -518,7 +923,9 @@ void string_destroy(String *string)
     if (string == NULL)
         return;
 
-    FREE(string->str);
+    if (string->str != string->sso)
+        FREE(string->str);
+
     FREE(string);
 }
 
@@ -554,7 +961,7 @@ ssize_t string_get_length(const String *string)
 
 String *string_create_from_c(char c)
 {
-   __string_create_from(c, "%c", INIT_BYTES);
+   __string_create_from(c, "%c", 1);
 }
 
 String *string_create_from_str(const char *str)
@@ -567,47 +974,47 @@ String *string_create_from_str(const char *str)
 
 String *string_create_from_i(int n)
 {
-    __string_create_from(n, "%d", INIT_BYTES);
+    __string_create_from(n, "%d", STRING_INT_MAX_CHARS);
 }
 
 String *string_create_from_ui(unsigned int n)
 {
-    __string_create_from(n, "%u", INIT_BYTES);
+    __string_create_from(n, "%u", STRING_INT_MAX_CHARS);
 }
 
 String *string_create_from_l(long n)
 {
-    __string_create_from(n, "%ld", INIT_BYTES);
+    __string_create_from(n, "%ld", STRING_INT_MAX_CHARS);
 }
 
 String *string_create_from_ul(unsigned long n)
 {
-    __string_create_from(n, "%lu", INIT_BYTES);
+    __string_create_from(n, "%lu", STRING_INT_MAX_CHARS);
 }
 
 String *string_create_from_ll(long long n)
 {
-    __string_create_from(n, "%lld", INIT_BYTES);
+    __string_create_from(n, "%lld", STRING_INT_MAX_CHARS);
 }
 
 String *string_create_from_ull(unsigned long long n)
 {
-    __string_create_from(n, "%llu", INIT_BYTES);
+    __string_create_from(n, "%llu", STRING_INT_MAX_CHARS);
 }
 
 String *string_create_from_f(float n)
 {
-    __string_create_from(n, "%f", INIT_BYTES);
+    __string_create_from(n, "%f", INIT_BYTES - 1);
 }
 
 String *string_create_from_d(double n)
 {
-    __string_create_from(n, "%lf", INIT_BYTES);
+    __string_create_from(n, "%lf", INIT_BYTES - 1);
 }
 
 String *string_create_from_ld(long double n)
 {
-    __string_create_from(n, "%Lf", INIT_BYTES);
+    __string_create_from(n, "%Lf", INIT_BYTES - 1);
 }
 
 String *string_concat(const String *s1, const String *s2)
@@ -630,7 +1037,7 @@ String *string_concat(const String *s1, const String *s2)
     ret = snprintf(s->str, s->allocated, "%s%s", s1->str, s2->str);
     if (ret < 0 || ret >= (ssize_t)s->allocated)
     {
-        FREE(s);
+        string_destroy(s);
         ERROR("snprintf error\n", NULL);
     }
 
@@ -769,7 +1176,7 @@ String *string_substr(const String *string, size_t begin, size_t end)
     ret = snprintf(s->str, s->allocated, "%.*s", (int)(end - begin + 1), string->str + begin);
     if (ret < 0 || ret >= (ssize_t)s->allocated)
     {
-        FREE(s);
+        string_destroy(s);
         ERROR("snprintf error\n", NULL);
     }
 
@@ -786,7 +1193,7 @@ ssize_t string_find_c_first(const String *string, char c)
     if (string_is_empty(string))
         ERROR("string is empty\n", -1);
 
-    return __string_find_c(string, c, 0, string->len, true);
+    return __string_find_c(string, c, 0, string->len - 1, true);
 }
 
 ssize_t string_find_str_first(const String * ___restrict___ string, const char * ___restrict___ str)
@@ -805,7 +1212,7 @@ ssize_t string_find_str_first(const String * ___restrict___ string, const char *
     if (strlen(str) == 0)
         ERROR("pattern is empty\n", -1);
 
-    return __string_find_str(string, str, 0, string->len, true);
+    return __string_find_str(string, str, strlen(str), 0, string->len, true);
 }
 
 ssize_t string_find_string_first(const String *s1, const String *s2)
@@ -824,7 +1231,7 @@ ssize_t string_find_string_first(const String *s1, const String *s2)
     if (string_is_empty(s2))
         ERROR("pattern is empty\n", -1);
 
-    return __string_find_str(s1, s2->str, 0, s1->len, true);
+    return __string_find_str(s1, s2->str, s2->len, 0, s1->len, true);
 }
 
 ssize_t string_find_c_last(const String *string, char c)
@@ -835,7 +1242,7 @@ ssize_t string_find_c_last(const String *string, char c)
     if (string_is_empty(string))
         ERROR("string is empty\n", -1);
 
-    return __string_find_c(string, c, 0, string->len, false);
+    return __string_find_c(string, c, 0, string->len - 1, false);
 }
 
 ssize_t string_find_str_last(const String * ___restrict___ string, const char * ___restrict___ str)
@@ -854,7 +1261,7 @@ ssize_t string_find_str_last(const String * ___restrict___ string, const char *
     if (strlen(str) == 0)
         ERROR("pattern is empty\n", -1);
 
-    return __string_find_str(string, str, 0, string->len, false);
+    return __string_find_str(string, str, strlen(str), 0, string->len, false);
 }
 
 ssize_t string_find_string_last(const String *s1, const String *s2)
@@ -873,7 +1280,7 @@ ssize_t string_find_string_last(const String *s1, const String *s2)
     if (string_is_empty(s2))
         ERROR("pattern is empty\n", -1);
 
-    return __string_find_str(s1, s2->str, 0, s1->len, false);
+    return __string_find_str(s1, s2->str, s2->len, 0, s1->len, false);
 }
 
 ssize_t string_find_c_first_substr(const String *string, char c, size_t begin, size_t end)
@@ -885,85 +1292,320 @@ ssize_t string_find_c_first_substr(const String *string, char c, size_t begin, s
     if (string == NULL)
         ERROR("string == NULL\n", -1);
 
-    ret = __string_find_c(string, c, begin, end + 1, true);
-    if (ret == -1)
-        ERROR("__string_find_c\n", -1);
+    ret = __string_find_c(string, c, begin, end, true);
+    if (ret == -1)
+        ERROR("__string_find_c\n", -1);
+
+    return ret;
+}
+
+ssize_t string_find_str_first_substr(const String * ___restrict___ string, const char * ___restrict___ str, size_t begin, size_t end)
+{
+    ssize_t ret;
+
+    TRACE();
+
+    if (string == NULL)
+        ERROR("string == NULL\n", -1);
+
+    if (str == NULL)
+        ERROR("str == NULL\n", -1);
+
+    ret = __string_find_str(string, str, strlen(str), begin, end + 1, true);
+    if (ret == -1)
+        ERROR("__string_find_str\n", -1);
+
+    return ret;
+}
+
+ssize_t string_find_string_first_substr(const String *s1, const String *s2, size_t begin, size_t end)
+{
+    TRACE();
+
+    if (s1 == NULL)
+        ERROR("s1 == NULL\n", -1);
+
+    if (s2 == NULL)
+        ERROR("s2 == NULL\n", -1);
+
+    return __string_find_str(s1, s2->str, s2->len, begin, end + 1, true);
+}
+
+ssize_t string_find_c_last_substr(const String *string, char c, size_t begin, size_t end)
+{
+     ssize_t ret;
+
+    TRACE();
+
+    if (string == NULL)
+        ERROR("string == NULL\n", -1);
+
+    ret = __string_find_c(string, c, begin, end, false);
+    if (ret == -1)
+        ERROR("__string_find_c\n", -1);
+
+    return ret;
+}
+
+ssize_t string_find_str_last_substr(const String * ___restrict___ string, const char * ___restrict___ str, size_t begin, size_t end)
+{
+    ssize_t ret;
+
+    TRACE();
+
+    if (string == NULL)
+        ERROR("string == NULL\n", -1);
+
+    if (str == NULL)
+        ERROR("str == NULL\n", -1);
+
+    ret = __string_find_str(string, str, strlen(str), begin, end + 1, false);
+    if (ret == -1)
+        ERROR("__string_find_str\n", -1);
+
+    return ret;
+}
+
+ssize_t string_find_string_last_substr(const String *s1, const String *s2, size_t begin, size_t end)
+{
+    TRACE();
+
+    if (s1 == NULL)
+        ERROR("s1 == NULL\n", -1);
+
+    if (s2 == NULL)
+        ERROR("s2 == NULL\n", -1);
+
+    return __string_find_str(s1, s2->str, s2->len, begin, end + 1, false);
+}
+
+String_view string_view_create(const char *str, size_t len)
+{
+    String_view view = {NULL, 0};
+
+    TRACE();
+
+    if (str == NULL)
+        ERROR("str == NULL\n", view);
+
+    view.str = str;
+    view.len = len;
+
+    return view;
+}
+
+String_view string_view_from_str(const char *str)
+{
+    String_view view = {NULL, 0};
+
+    TRACE();
+
+    if (str == NULL)
+        ERROR("str == NULL\n", view);
+
+    return string_view_create(str, strlen(str));
+}
+
+String_view string_get_view(const String *string)
+{
+    String_view view = {NULL, 0};
+
+    TRACE();
+
+    if (string == NULL)
+        ERROR("string == NULL\n", view);
+
+    return string_view_create(string->str, string->len);
+}
+
+bool string_view_is_empty(String_view view)
+{
+    TRACE();
+
+    return view.str == NULL || view.len == 0;
+}
+
+String_view string_view_substr(String_view view, size_t begin, size_t end)
+{
+    String_view sub = {NULL, 0};
+
+    TRACE();
+
+    if (view.str == NULL)
+        ERROR("view is invalid\n", sub);
+
+    if (end < begin)
+        ERROR("end < begin\n", sub);
+
+    if (begin >= view.len || end >= view.len)
+        ERROR("begin or end grater than view len\n", sub);
+
+    return string_view_create(view.str + begin, end - begin + 1);
+}
+
+String_view string_substr_view(const String *string, size_t begin, size_t end)
+{
+    String_view view = {NULL, 0};
+
+    TRACE();
+
+    if (string == NULL)
+        ERROR("string == NULL\n", view);
+
+    return string_view_substr(string_get_view(string), begin, end);
+}
+
+String *string_create_from_view(String_view view)
+{
+    String *s;
+
+    TRACE();
+
+    if (view.str == NULL)
+        ERROR("view is invalid\n", NULL);
+
+    s = __string_create(__string_calc_size(view.len));
+    if (s == NULL)
+        ERROR("__string_create error\n", NULL);
+
+    if (view.len > 0)
+        if (memcpy((void *)s->str, (const void *)view.str, view.len) == NULL)
+        {
+            string_destroy(s);
+            ERROR("memcpy error\n", NULL);
+        }
+
+    s->len = view.len;
+    s->str[s->len] = '\0';
+
+    return s;
+}
+
+int string_view_cmp(String_view v1, String_view v2)
+{
+    int ret;
+
+    TRACE();
+
+    if (v1.str == NULL)
+        ERROR("v1 is invalid\n", 0);
+
+    if (v2.str == NULL)
+        ERROR("v2 is invalid\n", 0);
+
+    ret = memcmp(v1.str, v2.str, MIN(v1.len, v2.len));
+    if (ret != 0)
+        return ret;
+
+    return v1.len < v2.len ? -1 : v1.len > v2.len ? 1 : 0;
+}
+
+int string_cmp_view(const String *string, String_view view)
+{
+    TRACE();
+
+    if (string == NULL)
+        ERROR("string == NULL\n", 0);
+
+    return string_view_cmp(string_get_view(string), view);
+}
+
+ssize_t string_view_find_c_first(String_view view, char c)
+{
+    TRACE();
+
+    if (view.str == NULL)
+        ERROR("view is invalid\n", -1);
+
+    return __string_scan_c(view.str, view.len, c, true);
+}
+
+ssize_t string_view_find_c_last(String_view view, char c)
+{
+    TRACE();
+
+    if (view.str == NULL)
+        ERROR("view is invalid\n", -1);
+
+    return __string_scan_c(view.str, view.len, c, false);
+}
+
+ssize_t string_view_find_view_first(String_view view, String_view pattern)
+{
+    TRACE();
+
+    if (view.str == NULL)
+        ERROR("view is invalid\n", -1);
+
+    if (string_view_is_empty(pattern))
+        ERROR("pattern is empty\n", -1);
 
-    return ret;
+    return __string_search(view.str, view.len, pattern.str, pattern.len, true);
 }
 
-ssize_t string_find_str_first_substr(const String * ___restrict___ string, const char * ___restrict___ str, size_t begin, size_t end)
+ssize_t string_view_find_view_last(String_view view, String_view pattern)
 {
-    ssize_t ret;
-
     TRACE();
 
-    if (string == NULL)
-        ERROR("string == NULL\n", -1);
+    if (view.str == NULL)
+        ERROR("view is invalid\n", -1);
 
-    ret = __string_find_str(string, str, begin, end + 1, true);
-    if (ret == -1)
-        ERROR("__string_find_str\n", -1);
+    if (string_view_is_empty(pattern))
+        ERROR("pattern is empty\n", -1);
 
-    return ret;
+    return __string_search(view.str, view.len, pattern.str, pattern.len, false);
 }
 
-ssize_t string_find_string_first_substr(const String *s1, const String *s2, size_t begin, size_t end)
+ssize_t string_find_view_first(const String *string, String_view pattern)
 {
     TRACE();
 
-    if (s1 == NULL)
-        ERROR("s1 == NULL\n", -1);
+    if (string == NULL)
+        ERROR("string == NULL\n", -1);
 
-    if (s2 == NULL)
-        ERROR("s2 == NULL\n", -1);
+    if (string_view_is_empty(pattern))
+        ERROR("pattern is empty\n", -1);
 
-    return string_find_str_first_substr(s1, s2->str, begin, end + 1);
+    return __string_find_str(string, pattern.str, pattern.len, 0, string->len, true);
 }
 
-ssize_t string_find_c_last_substr(const String *string, char c, size_t begin, size_t end)
+ssize_t string_find_view_last(const String *string, String_view pattern)
 {
-     ssize_t ret;
-
     TRACE();
 
     if (string == NULL)
         ERROR("string == NULL\n", -1);
 
-    ret = __string_find_c(string, c, begin, end + 1, false);
-    if (ret == -1)
-        ERROR("__string_find_c\n", -1);
+    if (string_view_is_empty(pattern))
+        ERROR("pattern is empty\n", -1);
 
-    return ret;
+    return __string_find_str(string, pattern.str, pattern.len, 0, string->len, false);
 }
 
-ssize_t string_find_str_last_substr(const String * ___restrict___ string, const char * ___restrict___ str, size_t begin, size_t end)
+ssize_t string_find_view_first_substr(const String *string, String_view pattern, size_t begin, size_t end)
 {
-    ssize_t ret;
-
     TRACE();
 
     if (string == NULL)
         ERROR("string == NULL\n", -1);
 
-    ret = __string_find_str(string, str, begin, end + 1, false);
-    if (ret == -1)
-        ERROR("__string_find_str\n", -1);
+    if (string_view_is_empty(pattern))
+        ERROR("pattern is empty\n", -1);
 
-    return ret;
+    return __string_find_str(string, pattern.str, pattern.len, begin, end + 1, true);
 }
 
-ssize_t string_find_string_last_substr(const String *s1, const String *s2, size_t begin, size_t end)
+ssize_t string_find_view_last_substr(const String *string, String_view pattern, size_t begin, size_t end)
 {
     TRACE();
 
-    if (s1 == NULL)
-        ERROR("s1 == NULL\n", -1);
+    if (string == NULL)
+        ERROR("string == NULL\n", -1);
 
-    if (s2 == NULL)
-        ERROR("s2 == NULL\n", -1);
+    if (string_view_is_empty(pattern))
+        ERROR("pattern is empty\n", -1);
 
-    return string_find_str_last_substr(s1, s2->str, begin, end + 1);
+    return __string_find_str(string, pattern.str, pattern.len, begin, end + 1, false);
 }
 
 String *string_clone(const String *string)
@@ -1142,9 +1784,6 @@ int string_remove_c_last(String *string, char c)
 
 int string_remove_c_all(String *string, char c)
 {
-    ssize_t pos;
-    size_t offset;
-
     TRACE();
 
     if (string == NULL)
@@ -1153,16 +1792,7 @@ int string_remove_c_all(String *string, char c)
     if (string_is_empty(string))
         ERROR("String is empty\n", 1);
 
-
-    offset = 0;
-    while (offset < string->len && !string_is_empty(string) && ((pos = __string_find_c(string, c, offset, string->len, true)) != -1))
-    {
-        offset = (size_t)pos;
-        if (_string_delete_wo_realloc(string, (size_t)pos, 1))
-            ERROR("string_delete error\n", 1);
-    }
-
-    return __string_realloc(string, string->len);
+    return __string_replace_all(string, &c, 1, NULL, 0);
 }
 
 int string_remove_str_first(String * ___restrict___ string, const char * ___restrict___ str)
@@ -1211,8 +1841,6 @@ int string_remove_str_last(String * ___restrict___ string, const char * ___restr
 
 int string_remove_str_all(String * ___restrict___ string, const char * ___restrict___ str)
 {
-    ssize_t pos;
-    size_t offset;
     size_t str_len;
 
     TRACE();
@@ -1228,16 +1856,7 @@ int string_remove_str_all(String * ___restrict___ string, const char * ___restri
 
     str_len = strlen(str);
 
-    offset = 0;
-    while (offset < string->len && !string_is_empty(string) && ((pos = __string_find_str(string, str, offset, string->len, true)) != -1))
-    {
-        offset = (size_t)pos;
-
-        if (_string_delete_wo_realloc(string, (size_t)pos, str_len))
-            ERROR("string_delete error\n", 1);
-    }
-
-    return __string_realloc(string, string->len);
+    return __string_replace_all(string, str, str_len, NULL, 0);
 }
 
 int string_remove_string_first(String *string, const String *pattern)
@@ -1349,7 +1968,7 @@ int string_replace_c_by_c_all(String *string, char c1, char c2)
         return 0;
 
     offset = 0;
-    while (offset < string->len && !string_is_empty(string) && ((pos = __string_find_c(string, c1, offset, string->len, true)) != -1))
+    while (offset < string->len && !string_is_empty(string) && ((pos = __string_find_c(string, c1, offset, string->len - 1, true)) != -1))
     {
         offset = (size_t)pos + 1;
 
@@ -1432,9 +2051,6 @@ int string_replace_c_by_str_last(String * ___restrict___ string, char c1, const
 
 int string_replace_c_by_str_all(String * ___restrict___ string, char c1, const char * ___restrict___ str)
 {
-    ssize_t pos;
-    size_t offset;
-
     char buf[2];
     size_t str_len;
 
@@ -1459,19 +2075,7 @@ int string_replace_c_by_str_all(String * ___restrict___ string, char c1, const c
     if (strcmp(buf, str) == 0)
         return 0;
 
-    offset = 0;
-    while (offset < string->len && !string_is_empty(string) && ((pos = __string_find_c(string, c1, offset, string->len, true)) != -1))
-    {
-        if (_string_delete(string, (size_t)pos, 1))
-            ERROR("_string_delete error\n", 1);
-
-        offset = (size_t)pos;
-
-        if (string_insert_str(string, str, (size_t)pos))
-            ERROR("string_set_char error\n", 1);
-    }
-
-    return 0;
+    return __string_replace_all(string, &c1, 1, str, str_len);
 }
 
 int string_replace_c_by_string_first(String *string, char c1, const String *string2)
@@ -1602,9 +2206,7 @@ int string_replace_str_by_c_last(String * ___restrict___ string, const char * __
 
 int string_replace_str_by_c_all(String * ___restrict___ string, const char * ___restrict___ str1, char c)
 {
-    ssize_t pos;
     size_t len;
-    size_t offset;
     char buf[2];
 
     TRACE();
@@ -1627,18 +2229,7 @@ int string_replace_str_by_c_all(String * ___restrict___ string, const char * ___
     if (strcmp(buf, str1) == 0)
         return 0;
 
-    offset = 0;
-    while (offset < string->len && !string_is_empty(string) && ((pos = __string_find_str(string, str1, offset, string->len, true)) != -1))
-    {
-        offset = (size_t)pos + 1;
-        if (_string_delete(string, (size_t)pos, len))
-            ERROR("_string_delete error\n", 1);
-
-        if (string_insert_c(string, c, (size_t)pos))
-            ERROR("string_insert_c error\n", 1);
-    }
-
-    return 0;
+    return __string_replace_all(string, str1, len, &c, 1);
 }
 
 int string_replace_str_by_str_first(String * ___restrict___ string, const char *str1, const char *str2)
@@ -1717,10 +2308,8 @@ int string_replace_str_by_str_last(String * ___restrict___ string, const char *s
 
 int string_replace_str_by_str_all(String * ___restrict___ string, const char *str1, const char *str2)
 {
-    ssize_t pos;
     size_t len1;
     size_t len2;
-    size_t offset;
 
     TRACE();
 
@@ -1747,21 +2336,7 @@ int string_replace_str_by_str_all(String * ___restrict___ string, const char *st
     if (strcmp(str1, str2) == 0)
         return 0;
 
-    offset = 0;
-    while (offset < string->len && !string_is_empty(string) && ((pos = __string_find_str(string, str1, offset, string->len, true)) != -1))
-    {
-        offset = (size_t)pos;
-
-        if (_string_delete(string, (size_t)pos, len1))
-            ERROR("_string_delete error\n", 1);
-
-        if (string_insert_str(string, str2, (size_t)pos))
-            ERROR("string_insert_str error\n", 1);
-
-        offset += (size_t)ABS((ssize_t)(len1 - len2));
-    }
-
-    return 0;
+    return __string_replace_all(string, str1, len1, str2, len2);
 }
 
 int string_replace_str_by_string_first(String *string, const char * ___restrict___ str1, const String *string2)
@@ -1965,6 +2540,117 @@ int string_replace_string_by_string_all(String *string, const String *string1, c
     return string_replace_str_by_string_all(string, string1->str, string2);
 }
 
+int string_replace_multi_all(String *string, const char * const *patterns, const char * const *replacements, size_t num)
+{
+    Aho_corasick *ac;
+    size_t *lens;
+    size_t *rep_lens;
+    size_t i;
+    size_t id;
+    size_t w;
+    size_t new_len;
+    size_t size;
+    size_t start;
+    ssize_t pos;
+    char *buf;
+    char sso[STRING_SSO_BYTES];
+    bool changed;
+
+    TRACE();
+
+    if (string == NULL)
+        ERROR("string == NULL\n", 1);
+
+    if (patterns == NULL || replacements == NULL)
+        ERROR("patterns == NULL || replacements == NULL\n", 1);
+
+    if (num == 0)
+        ERROR("num == 0\n", 1);
+
+    lens = (size_t *)malloc(sizeof(size_t) * num * 2);
+    if (lens == NULL)
+        ERROR("malloc error\n", 1);
+
+    rep_lens = lens + num;
+    for (i = 0; i < num; ++i)
+    {
+        if (patterns[i] == NULL || replacements[i] == NULL || patterns[i][0] == '\0')
+        {
+            FREE(lens);
+            ERROR("Invalid pattern or replacement\n", 1);
+        }
+
+        lens[i] = strlen(patterns[i]);
+        rep_lens[i] = strlen(replacements[i]);
+    }
+
+    ac = aho_corasick_create(patterns, num);
+    if (ac == NULL)
+    {
+        FREE(lens);
+        ERROR("aho_corasick_create error\n", 1);
+    }
+
+    /*
+        1st pass: compute new length.
+        Match which ends first wins (the longest one when many end at the same byte),
+        search starts again after match so matches don't overlap
+    */
+    new_len = string->len;
+    changed = false;
+    start = 0;
+    while ((pos = aho_corasick_find_first(ac, string->str + start, string->len - start, &id)) != -1)
+    {
+        new_len = new_len - lens[id] + rep_lens[id];
+        changed = true;
+        start += (size_t)pos + lens[id];
+    }
+
+    if (changed)
+    {
+        size = __string_calc_size(new_len);
+        if (size == STRING_SSO_BYTES)
+            buf = sso;
+        else
+        {
+            buf = (char *)malloc(size);
+            if (buf == NULL)
+            {
+                aho_corasick_destroy(ac);
+                FREE(lens);
+                ERROR("malloc error\n", 1);
+            }
+        }
+
+        /* 2nd pass: copy text between matches and replacements */
+        w = 0;
+        start = 0;
+        while ((pos = aho_corasick_find_first(ac, string->str + start, string->len - start, &id)) != -1)
+        {
+            (void)memcpy(buf + w, string->str + start, (size_t)pos);
+            w += (size_t)pos;
+            (void)memcpy(buf + w, replacements[id], rep_lens[id]);
+            w += rep_lens[id];
+            start += (size_t)pos + lens[id];
+        }
+
+        (void)memcpy(buf + w, string->str + start, string->len - start);
+
+        if (buf == sso)
+        {
+            (void)memcpy(string->sso, sso, new_len);
+            buf = NULL;
+        }
+
+        __string_set_buffer(string, buf, size, new_len);
+    }
+
+    aho_corasick_destroy(ac);
+    FREE(lens);
+
+    return 0;
+}
+
 String **string_split_c(const String *string, char c, size_t *size)
 {
     ssize_t pos;
@@ -1991,7 +2677,7 @@ String **string_split_c(const String *string, char c, size_t *size)
     i = 0;
     while (i < string->len)
     {
-        pos = __string_find_c(string, c, i, string->len, true);
+        pos = __string_find_c(string, c, i, string->len - 1, true);
         if (pos > 0 && pos < (ssize_t)string->len)
         {
             temp = string_substr(string, i, (size_t)pos - 1);
@@ -2065,7 +2751,7 @@ String **string_split_str(const String *  ___restrict___ string, const char * __
     i = 0;
     while (i < string->len)
     {
-        pos = __string_find_str(string, str, i, string->len, true);
+        pos = __string_find_str(string, str, len, i, string->len, true);
         if (pos > 0 && pos < (ssize_t)string->len)
         {
             temp = string_substr(string, i, (size_t)pos - 1);
@@ -2237,4 +2923,259 @@ bool string_iterator_end(const String_iterator *it)
         ERROR("it == NULL", 1);
 
     return it->index == -1 || it->str[it->index] == '\0';
-}
\ No newline at end of file
+}
+
+static ___inline___ ssize_t __string_scan_set(const char * ___restrict___ text, size_t len, const String_tokenizer * ___restrict___ tok)
+{
+    size_t i = 0;
+    BYTE c;
+#ifdef STRING_VEC_LEN
+    string_vec_t vset[STRING_TOKENIZER_SET_CHARS];
+    size_t j;
+    WORD mask;
+
+    if (tok->____set_len <= STRING_TOKENIZER_SET_CHARS)
+    {
+        for (j = 0; j < tok->____set_len; ++j)
+            vset[j] = string_vec_set1(tok->____set_chars[j]);
+
+        for (; i + STRING_VEC_LEN <= len; i += STRING_VEC_LEN)
+        {
+            mask = 0;
+            for (j = 0; j < tok->____set_len; ++j)
+                mask |= string_vec_eq_mask(text + i, vset[j]);
+
+            if (mask)
+                return (ssize_t)(i + (size_t)__builtin_ctz(mask));
+        }
+    }
+#endif
+
+    for (; i < len; ++i)
+    {
+        c = (BYTE)text[i];
+        if (tok->____set[c >> 6] & BIT(c & 63))
+            return (ssize_t)i;
+    }
+
+    return -1;
+}
+
+static ___inline___ ssize_t __string_tokenizer_find_delim(const String_tokenizer * ___restrict___ tok, size_t from, size_t * ___restrict___ delim_len)
+{
+    ssize_t pos;
+    const char *text = tok->____buf + from;
+    const size_t len = tok->____len - from;
+
+    switch (tok->____type)
+    {
+        case STRING_TOKENIZER_C:
+        {
+            *delim_len = 1;
+            pos = __string_scan_c(text, len, tok->____set_chars[0], true);
+            break;
+        }
+        case STRING_TOKENIZER_SET:
+        {
+            *delim_len = 1;
+            pos = __string_scan_set(text, len, tok);
+            break;
+        }
+        case STRING_TOKENIZER_VIEW:
+        {
+            *delim_len = tok->____delim_len;
+            pos = __string_search(text, len, tok->____delim, tok->____delim_len, true);
+            break;
+        }
+        default:
+        {
+            ERROR("Incorrect tokenizer type\n", -1);
+        }
+    }
+
+    if (pos == -1)
+        return -1;
+
+    return pos + (ssize_t)from;
+}
+
+static ___inline___ int __string_tokenizer_init(String_tokenizer *tok, String_view text, string_tokenizer_type type)
+{
+    TRACE();
+
+    if (tok == NULL)
+        ERROR("tok == NULL\n", 1);
+
+    if (text.str == NULL)
+        ERROR("text is invalid\n", 1);
+
+    (void)memset(tok, 0, sizeof(*tok));
+
+    tok->____buf = text.str;
+    tok->____len = text.len;
+    tok->____type = (int)type;
+    tok->____done = text.len == 0;
+
+    return 0;
+}
+
+int string_tokenizer_init_c(String_tokenizer *tok, String_view text, char c)
+{
+    TRACE();
+
+    if (__string_tokenizer_init(tok, text, STRING_TOKENIZER_C))
+        ERROR("__string_tokenizer_init error\n", 1);
+
+    tok->____set_chars[0] = c;
+    tok->____set_len = 1;
+
+    return 0;
+}
+
+int string_tokenizer_init_set(String_tokenizer * ___restrict___ tok, String_view text, const char * ___restrict___ set)
+{
+    size_t i;
+    BYTE c;
+
+    TRACE();
+
+    if (set == NULL)
+        ERROR("set == NULL\n", 1);
+
+    if (*set == '\0')
+        ERROR("set is empty\n", 1);
+
+    if (__string_tokenizer_init(tok, text, STRING_TOKENIZER_SET))
+        ERROR("__string_tokenizer_init error\n", 1);
+
+    for (i = 0; set[i] != '\0'; ++i)
+    {
+        c = (BYTE)set[i];
+        tok->____set[c >> 6] |= BIT(c & 63);
+
+        if (i < STRING_TOKENIZER_SET_CHARS)
+            tok->____set_chars[i] = set[i];
+    }
+
+    tok->____set_len = i;
+
+    return 0;
+}
+
+int string_tokenizer_init_view(String_tokenizer *tok, String_view text, String_view delim)
+{
+    TRACE();
+
+    if (string_view_is_empty(delim))
+        ERROR("delim is empty\n", 1);
+
+    if (__string_tokenizer_init(tok, text, STRING_TOKENIZER_VIEW))
+        ERROR("__string_tokenizer_init error\n", 1);
+
+    tok->____delim = delim.str;
+    tok->____delim_len = delim.len;
+
+    return 0;
+}
+
+int string_tokenizer_set_quote(String_tokenizer *tok, char quote)
+{
+    TRACE();
+
+    if (tok == NULL)
+        ERROR("tok == NULL\n", 1);
+
+    if (quote == '\0')
+        ERROR("quote == '\\0'\n", 1);
+
+    tok->____quote = quote;
+
+    return 0;
+}
+
+int string_tokenizer_skip_empty(String_tokenizer *tok, bool skip)
+{
+    TRACE();
+
+    if (tok == NULL)
+        ERROR("tok == NULL\n", 1);
+
+    tok->____skip_empty = skip;
+
+    return 0;
+}
+
+ssize_t string_tokenizer_next(String_tokenizer * ___restrict___ tok, String_view * ___restrict___ token)
+{
+    size_t start;
+    size_t end;
+    size_t from;
+    size_t i;
+    size_t delim_len;
+    ssize_t pos;
+    ssize_t close;
+
+    TRACE();
+
+    if (tok == NULL)
+        ERROR("tok == NULL\n", -1);
+
+    if (token == NULL)
+        ERROR("token == NULL\n", -1);
+
+    do
+    {
+        if (tok->____done)
+            return -1;
+
+        start = tok->____pos;
+        end = tok->____len;
+        from = start;
+        tok->____quoted = false;
+
+        if (tok->____quote != '\0' && start < tok->____len && tok->____buf[start] == tok->____quote)
+        {
+            tok->____quoted = true;
+            i = ++start;
+
+            /* skip escaped quotes */
+            while ((close = __string_scan_c(tok->____buf + i, tok->____len - i, tok->____quote, true)) != -1 &&
+                   i + (size_t)close + 1 < tok->____len && tok->____buf[i + (size_t)close + 1] == tok->____quote)
+                i += (size_t)close + 2;
+
+            if (close != -1)
+            {
+                end = i + (size_t)close;
+                from = end + 1;
+            }
+            else
+                from = tok->____len;
+        }
+
+        pos = __string_tokenizer_find_delim(tok, from, &delim_len);
+        if (pos == -1)
+            tok->____done = true;
+        else
+        {
+            if (!tok->____quoted)
+                end = (size_t)pos;
+
+            tok->____pos = (size_t)pos + delim_len;
+        }
+
+        token->str = tok->____buf + start;
+        token->len = end - start;
+    } while (tok->____skip_empty && token->len == 0);
+
+    return (ssize_t)start;
+}
+
+bool string_tokenizer_is_quoted(const String_tokenizer *tok)
+{
+    TRACE();
+
+    if (tok == NULL)
+        ERROR("tok == NULL\n", false);
+
+    return tok->____quoted;
+}
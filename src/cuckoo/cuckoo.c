@@ -0,0 +1,546 @@
+#include <generic.h>
+#include <cuckoo.h>
+#include <hash.h>
+#include <log.h>
+#include <common.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CUCKOO_BUCKET_SIZE      4
+#define CUCKOO_MAX_KICKS        500
+#define CUCKOO_LOAD_FACTOR      0.95
+#define CUCKOO_MIN_FP_BITS      4
+#define CUCKOO_MAX_FP_BITS      16
+#define CUCKOO_EMPTY            0
+
+/* "CKF1" in little endian */
+#define CUCKOO_MAGIC            0x31464B43U
+#define CUCKOO_HEADER_SIZE      40
+
+#define CUCKOO_ALT_CONST        0x5BD1E995U
+
+struct Cuckoo_filter
+{
+    uint16_t    *table; /* num_buckets * CUCKOO_BUCKET_SIZE fingerprints */
+    size_t      num_buckets; /* power of 2 */
+    size_t      fp_bits;
+    size_t      entries;
+    size_t      victim_index;
+    uint32_t    rand_state;
+    uint16_t    victim_fp;
+    bool        has_victim;
+};
+
+/*
+    Allocate empty filter
+
+    PARAMS
+    @IN num_buckets - number of buckets (power of 2)
+    @IN fp_bits - fingerprint size in bits
+
+    RETURN
+    NULL iff failure
+    Pointer to new filter iff success
+*/
+static Cuckoo_filter *__cuckoo_filter_alloc(size_t num_buckets, size_t fp_bits);
+
+/*
+    Compute fingerprint and 1st bucket of key
+
+    PARAMS
+    @IN filter - pointer to filter
+    @IN data - key
+    @IN size - size of key
+    @OUT fp - fingerprint
+    @OUT index - 1st bucket
+
+    RETURN
+    This is a void function
+*/
+static ___inline___ void __cuckoo_fp_index(const Cuckoo_filter *filter, const void *data, size_t size, uint16_t *fp, size_t *index);
+
+/*
+    Compute alternative bucket
+
+    PARAMS
+    @IN filter - pointer to filter
+    @IN index - bucket
+    @IN fp - fingerprint
+
+    RETURN
+    Alternative bucket
+*/
+static ___inline___ size_t __cuckoo_alt_index(const Cuckoo_filter *filter, size_t index, uint16_t fp);
+
+/*
+    Try to put fingerprint into free slot of bucket
+
+    PARAMS
+    @IN filter - pointer to filter
+    @IN index - bucket
+    @IN fp - fingerprint
+
+    RETURN
+    true iff fingerprint has been inserted
+    false iff bucket is full
+*/
+static ___inline___ bool __cuckoo_bucket_insert(Cuckoo_filter *filter, size_t index, uint16_t fp);
+
+/*
+    Find fingerprint in bucket
+
+    PARAMS
+    @IN filter - pointer to filter
+    @IN index - bucket
+    @IN fp - fingerprint
+
+    RETURN
+    -1 iff fingerprint doesn't exist
+    Slot index iff success
+*/
+static ___inline___ ssize_t __cuckoo_bucket_find(const Cuckoo_filter *filter, size_t index, uint16_t fp);
+
+/*
+    Insert fingerprint into bucket @index or its alternative
+
+    PARAMS
+    @IN filter - pointer to filter
+    @IN fp - fingerprint
+    @IN index - bucket
+
+    RETURN
+    0 iff success
+    Non-zero value iff filter is full
+*/
+static int __cuckoo_insert_fp(Cuckoo_filter *filter, uint16_t fp, size_t index);
+
+/*
+    Store / Load value in little endian
+
+    PARAMS
+    @IN buf - buffer
+    @IN val - value
+
+    RETURN
+    Load: value
+*/
+static ___inline___ void __cuckoo_store16(BYTE *buf, uint16_t val);
+static ___inline___ void __cuckoo_store32(BYTE *buf, uint32_t val);
+static ___inline___ void __cuckoo_store64(BYTE *buf, uint64_t val);
+static ___inline___ uint16_t __cuckoo_load16(const BYTE *buf);
+static ___inline___ uint32_t __cuckoo_load32(const BYTE *buf);
+static ___inline___ uint64_t __cuckoo_load64(const BYTE *buf);
+
+static Cuckoo_filter *__cuckoo_filter_alloc(size_t num_buckets, size_t fp_bits)
+{
+    Cuckoo_filter *filter;
+
+    filter = (Cuckoo_filter *)malloc(sizeof(Cuckoo_filter));
+    if (filter == NULL)
+        ERROR("malloc error\n", NULL);
+
+    filter->table = (uint16_t *)calloc(num_buckets * CUCKOO_BUCKET_SIZE, sizeof(uint16_t));
+    if (filter->table == NULL)
+    {
+        FREE(filter);
+        ERROR("calloc error\n", NULL);
+    }
+
+    filter->num_buckets = num_buckets;
+    filter->fp_bits = fp_bits;
+    filter->entries = 0;
+    filter->victim_index = 0;
+    filter->victim_fp = CUCKOO_EMPTY;
+    filter->has_victim = false;
+    filter->rand_state = 2463534242U;
+
+    return filter;
+}
+
+static ___inline___ void __cuckoo_fp_index(const Cuckoo_filter *filter, const void *data, size_t size, uint16_t *fp, size_t *index)
+{
+    const uint64_t hash = ((uint64_t)hash_murmur(data, size) << 32) | (uint64_t)hash_xxhash(data, size);
+    uint16_t f;
+
+    f = (uint16_t)((hash >> 48) & (BIT(filter->fp_bits) - 1));
+    if (f == CUCKOO_EMPTY)
+        f = 1;
+
+    *fp = f;
+    *index = (size_t)hash & (filter->num_buckets - 1);
+}
+
+static ___inline___ size_t __cuckoo_alt_index(const Cuckoo_filter *filter, size_t index, uint16_t fp)
+{
+    return (index ^ (size_t)((uint32_t)fp * CUCKOO_ALT_CONST)) & (filter->num_buckets - 1);
+}
+
+static ___inline___ bool __cuckoo_bucket_insert(Cuckoo_filter *filter, size_t index, uint16_t fp)
+{
+    uint16_t *bucket = &filter->table[index * CUCKOO_BUCKET_SIZE];
+    size_t i;
+
+    for (i = 0; i < CUCKOO_BUCKET_SIZE; ++i)
+        if (bucket[i] == CUCKOO_EMPTY)
+        {
+            bucket[i] = fp;
+            return true;
+        }
+
+    return false;
+}
+
+static ___inline___ ssize_t __cuckoo_bucket_find(const Cuckoo_filter *filter, size_t index, uint16_t fp)
+{
+    const uint16_t *bucket = &filter->table[index * CUCKOO_BUCKET_SIZE];
+    ssize_t i;
+
+    for (i = 0; i < CUCKOO_BUCKET_SIZE; ++i)
+        if (bucket[i] == fp)
+            return i;
+
+    return -1;
+}
+
+static int __cuckoo_insert_fp(Cuckoo_filter *filter, uint16_t fp, size_t index)
+{
+    size_t i;
+    size_t slot;
+    uint16_t victim;
+
+    if (filter->has_victim)
+        return 1;
+
+    if (__cuckoo_bucket_insert(filter, index, fp))
+        goto inserted;
+
+    index = __cuckoo_alt_index(filter, index, fp);
+    if (__cuckoo_bucket_insert(filter, index, fp))
+        goto inserted;
+
+    for (i = 0; i < CUCKOO_MAX_KICKS; ++i)
+    {
+        /* xorshift32 */
+        filter->rand_state ^= filter->rand_state << 13;
+        filter->rand_state ^= filter->rand_state >> 17;
+        filter->rand_state ^= filter->rand_state << 5;
+
+        slot = index * CUCKOO_BUCKET_SIZE + (filter->rand_state & (CUCKOO_BUCKET_SIZE - 1));
+        victim = filter->table[slot];
+        filter->table[slot] = fp;
+        fp = victim;
+
+        index = __cuckoo_alt_index(filter, index, fp);
+        if (__cuckoo_bucket_insert(filter, index, fp))
+            goto inserted;
+    }
+
+    /* table is full, keep last kicked fingerprint aside, so no entry is lost */
+    filter->victim_fp = fp;
+    filter->victim_index = index;
+    filter->has_victim = true;
+
+inserted:
+    ++filter->entries;
+
+    return 0;
+}
+
+static ___inline___ void __cuckoo_store16(BYTE *buf, uint16_t val)
+{
+    buf[0] = (BYTE)(val);
+    buf[1] = (BYTE)(val >> 8);
+}
+
+static ___inline___ void __cuckoo_store32(BYTE *buf, uint32_t val)
+{
+    __cuckoo_store16(buf, (uint16_t)val);
+    __cuckoo_store16(buf + 2, (uint16_t)(val >> 16));
+}
+
+static ___inline___ void __cuckoo_store64(BYTE *buf, uint64_t val)
+{
+    __cuckoo_store32(buf, (uint32_t)val);
+    __cuckoo_store32(buf + 4, (uint32_t)(val >> 32));
+}
+
+static ___inline___ uint16_t __cuckoo_load16(const BYTE *buf)
+{
+    return (uint16_t)((uint32_t)buf[0] | ((uint32_t)buf[1] << 8));
+}
+
+static ___inline___ uint32_t __cuckoo_load32(const BYTE *buf)
+{
+    return (uint32_t)__cuckoo_load16(buf) | ((uint32_t)__cuckoo_load16(buf + 2) << 16);
+}
+
+static ___inline___ uint64_t __cuckoo_load64(const BYTE *buf)
+{
+    return (uint64_t)__cuckoo_load32(buf) | ((uint64_t)__cuckoo_load32(buf + 4) << 32);
+}
+
+size_t cuckoo_optimal_fingerprint_bits(double fpr)
+{
+    size_t bits;
+
+    TRACE();
+
+    if (fpr <= 0.0 || fpr >= 1.0)
+        ERROR("fpr not in (0; 1)\n", 0);
+
+    /* fpr ~= 2 * bucket_size / 2^bits */
+    for (bits = CUCKOO_MIN_FP_BITS; bits < CUCKOO_MAX_FP_BITS; ++bits)
+        if ((double)(2 * CUCKOO_BUCKET_SIZE) / (double)BIT(bits) <= fpr)
+            return bits;
+
+    return CUCKOO_MAX_FP_BITS;
+}
+
+Cuckoo_filter *cuckoo_filter_create(size_t capacity, size_t fp_bits)
+{
+    Cuckoo_filter *filter;
+    double buckets;
+    size_t num_buckets = 1;
+
+    TRACE();
+
+    if (capacity == 0)
+        ERROR("capacity == 0\n", NULL);
+
+    if (fp_bits < CUCKOO_MIN_FP_BITS || fp_bits > CUCKOO_MAX_FP_BITS)
+        ERROR("Incorrect fingerprint size\n", NULL);
+
+    buckets = (double)capacity / (CUCKOO_BUCKET_SIZE * CUCKOO_LOAD_FACTOR);
+    while ((double)num_buckets < buckets)
+        num_buckets <<= 1;
+
+    filter = __cuckoo_filter_alloc(num_buckets, fp_bits);
+    if (filter == NULL)
+        ERROR("__cuckoo_filter_alloc error\n", NULL);
+
+    return filter;
+}
+
+Cuckoo_filter *cuckoo_filter_create_for(size_t capacity, double fpr)
+{
+    size_t fp_bits;
+
+    TRACE();
+
+    fp_bits = cuckoo_optimal_fingerprint_bits(fpr);
+    if (fp_bits == 0)
+        ERROR("cuckoo_optimal_fingerprint_bits error\n", NULL);
+
+    return cuckoo_filter_create(capacity, fp_bits);
+}
+
+void cuckoo_filter_destroy(Cuckoo_filter *filter)
+{
+    TRACE();
+
+    if (filter == NULL)
+        return;
+
+    FREE(filter->table);
+    FREE(filter);
+}
+
+int cuckoo_filter_insert(Cuckoo_filter * ___restrict___ filter, const void * ___restrict___ data, size_t size)
+{
+    uint16_t fp;
+    size_t index;
+
+    TRACE();
+
+    if (filter == NULL || data == NULL || size == 0)
+        ERROR("filter == NULL || data == NULL || size == 0\n", 1);
+
+    __cuckoo_fp_index(filter, data, size, &fp, &index);
+    if (__cuckoo_insert_fp(filter, fp, index))
+        ERROR("Filter is full\n", 1);
+
+    return 0;
+}
+
+bool cuckoo_filter_contains(const Cuckoo_filter * ___restrict___ filter, const void * ___restrict___ data, size_t size)
+{
+    uint16_t fp;
+    size_t i1;
+    size_t i2;
+
+    TRACE();
+
+    if (filter == NULL || data == NULL || size == 0)
+        ERROR("filter == NULL || data == NULL || size == 0\n", true);
+
+    __cuckoo_fp_index(filter, data, size, &fp, &i1);
+    i2 = __cuckoo_alt_index(filter, i1, fp);
+
+    if (__cuckoo_bucket_find(filter, i1, fp) >= 0 || __cuckoo_bucket_find(filter, i2, fp) >= 0)
+        return true;
+
+    return filter->has_victim && filter->victim_fp == fp && (filter->victim_index == i1 || filter->victim_index == i2);
+}
+
+int cuckoo_filter_delete(Cuckoo_filter * ___restrict___ filter, const void * ___restrict___ data, size_t size)
+{
+    uint16_t fp;
+    size_t index;
+    size_t i;
+    ssize_t slot;
+
+    TRACE();
+
+    if (filter == NULL || data == NULL || size == 0)
+        ERROR("filter == NULL || data == NULL || size == 0\n", 1);
+
+    __cuckoo_fp_index(filter, data, size, &fp, &index);
+
+    for (i = 0; i < 2; ++i)
+    {
+        slot = __cuckoo_bucket_find(filter, index, fp);
+        if (slot >= 0)
+        {
+            filter->table[index * CUCKOO_BUCKET_SIZE + (size_t)slot] = CUCKOO_EMPTY;
+            --filter->entries;
+
+            /* now there is free slot, try to put victim into table */
+            if (filter->has_victim)
+            {
+                filter->has_victim = false;
+                --filter->entries;
+                (void)__cuckoo_insert_fp(filter, filter->victim_fp, filter->victim_index);
+            }
+
+            return 0;
+        }
+
+        index = __cuckoo_alt_index(filter, index, fp);
+    }
+
+    if (filter->has_victim && filter->victim_fp == fp &&
+        (filter->victim_index == index || filter->victim_index == __cuckoo_alt_index(filter, index, fp)))
+    {
+        filter->has_victim = false;
+        --filter->entries;
+
+        return 0;
+    }
+
+    ERROR("Key doesn't exist\n", 1);
+}
+
+ssize_t cuckoo_filter_get_num_entries(const Cuckoo_filter *filter)
+{
+    TRACE();
+
+    if (filter == NULL)
+        ERROR("filter == NULL\n", -1);
+
+    return (ssize_t)filter->entries;
+}
+
+int cuckoo_filter_merge(Cuckoo_filter *dst, const Cuckoo_filter *src)
+{
+    size_t i;
+
+    TRACE();
+
+    if (dst == NULL || src == NULL)
+        ERROR("dst == NULL || src == NULL\n", 1);
+
+    if (dst->num_buckets != src->num_buckets || dst->fp_bits != src->fp_bits)
+        ERROR("Filters have different params\n", 1);
+
+    for (i = 0; i < src->num_buckets * CUCKOO_BUCKET_SIZE; ++i)
+        if (src->table[i] != CUCKOO_EMPTY)
+            if (__cuckoo_insert_fp(dst, src->table[i], i / CUCKOO_BUCKET_SIZE))
+                ERROR("Filter is full\n", 1);
+
+    if (src->has_victim)
+        if (__cuckoo_insert_fp(dst, src->victim_fp, src->victim_index))
+            ERROR("Filter is full\n", 1);
+
+    return 0;
+}
+
+ssize_t cuckoo_filter_serialized_size(const Cuckoo_filter *filter)
+{
+    TRACE();
+
+    if (filter == NULL)
+        ERROR("filter == NULL\n", -1);
+
+    return (ssize_t)(CUCKOO_HEADER_SIZE + filter->num_buckets * CUCKOO_BUCKET_SIZE * sizeof(uint16_t));
+}
+
+ssize_t cuckoo_filter_serialize(const Cuckoo_filter * ___restrict___ filter, void * ___restrict___ buf, size_t size)
+{
+    BYTE *out = (BYTE *)buf;
+    size_t needed;
+    size_t i;
+
+    TRACE();
+
+    if (filter == NULL || buf == NULL)
+        ERROR("filter == NULL || buf == NULL\n", -1);
+
+    needed = (size_t)cuckoo_filter_serialized_size(filter);
+    if (needed > size)
+        ERROR("Buffer is too small\n", -1);
+
+    __cuckoo_store32(out, CUCKOO_MAGIC);
+    __cuckoo_store32(out + 4, (uint32_t)filter->fp_bits);
+    __cuckoo_store64(out + 8, (uint64_t)filter->num_buckets);
+    __cuckoo_store64(out + 16, (uint64_t)filter->entries);
+    __cuckoo_store64(out + 24, (uint64_t)filter->victim_index);
+    __cuckoo_store16(out + 32, filter->victim_fp);
+    __cuckoo_store16(out + 34, (uint16_t)filter->has_victim);
+    __cuckoo_store32(out + 36, 0);
+
+    for (i = 0; i < filter->num_buckets * CUCKOO_BUCKET_SIZE; ++i)
+        __cuckoo_store16(out + CUCKOO_HEADER_SIZE + i * sizeof(uint16_t), filter->table[i]);
+
+    return (ssize_t)needed;
+}
+
+Cuckoo_filter *cuckoo_filter_deserialize(const void *buf, size_t size)
+{
+    const BYTE *in = (const BYTE *)buf;
+    Cuckoo_filter *filter;
+    uint64_t num_buckets;
+    size_t fp_bits;
+    size_t i;
+
+    TRACE();
+
+    if (buf == NULL || size < CUCKOO_HEADER_SIZE)
+        ERROR("buf == NULL || size < header\n", NULL);
+
+    if (__cuckoo_load32(in) != CUCKOO_MAGIC)
+        ERROR("Incorrect magic\n", NULL);
+
+    fp_bits = __cuckoo_load32(in + 4);
+    num_buckets = __cuckoo_load64(in + 8);
+    if (num_buckets == 0 || (num_buckets & (num_buckets - 1)) != 0 ||
+        num_buckets > (size - CUCKOO_HEADER_SIZE) / (CUCKOO_BUCKET_SIZE * sizeof(uint16_t)) ||
+        __cuckoo_load64(in + 24) >= num_buckets)
+        ERROR("Corrupted buffer\n", NULL);
+
+    if (fp_bits < CUCKOO_MIN_FP_BITS || fp_bits > CUCKOO_MAX_FP_BITS)
+        ERROR("Incorrect fingerprint size\n", NULL);
+
+    filter = __cuckoo_filter_alloc((size_t)num_buckets, fp_bits);
+    if (filter == NULL)
+        ERROR("__cuckoo_filter_alloc error\n", NULL);
+
+    filter->entries = (size_t)__cuckoo_load64(in + 16);
+    filter->victim_index = (size_t)__cuckoo_load64(in + 24);
+    filter->victim_fp = __cuckoo_load16(in + 32);
+    filter->has_victim = CAST_TO_BOOL(__cuckoo_load16(in + 34));
+
+    for (i = 0; i < filter->num_buckets * CUCKOO_BUCKET_SIZE; ++i)
+        filter->table[i] = __cuckoo_load16(in + CUCKOO_HEADER_SIZE + i * sizeof(uint16_t));
+
+    return filter;
+}
@@ -3,6 +3,7 @@
 #include <darray.h>
 #include <generic.h>
 #include <array.h>
+#include <search.h>
 #include <log.h>
 #include <common.h>
 #include <compiler.h>
@@ -381,6 +382,39 @@ ssize_t darray_search_last(const Darray * ___restrict___ darray, const void *val
         return array_sorted_find_last(darray->array, darray->num_entries, darray->size_of, val_in, darray->cmp, val_out);
 }
 
+ssize_t darray_search_batch(const Darray * ___restrict___ darray, const void * ___restrict___ vals_in, size_t num_vals, ssize_t * ___restrict___ pos)
+{
+    size_t i;
+    ssize_t num_found;
+
+    TRACE();
+
+    if (darray == NULL || vals_in == NULL || pos == NULL)
+        ERROR("darray == NULL || vals_in == NULL || pos == NULL\n", -1);
+
+    if (num_vals == 0)
+        ERROR("num_vals == 0\n", -1);
+
+    if (darray->num_entries == 0)
+        ERROR("num_entries == 0\n", -1);
+
+    if (darray->cmp == NULL)
+        ERROR("CMP is needed\n", -1);
+
+    if (darray->type == DARRAY_SORTED)
+        return find_first_sorted_batch(vals_in, num_vals, darray->array, darray->num_entries, darray->cmp, darray->size_of, pos);
+
+    /* linear search is not bounded by latency */
+    num_found = 0;
+    for (i = 0; i < num_vals; ++i)
+    {
+        pos[i] = find_first_unsorted((const BYTE *)vals_in + i * darray->size_of, darray->array, darray->num_entries, darray->cmp, darray->size_of);
+        num_found += pos[i] != -1;
+    }
+
+    return num_found;
+}
+
 int darray_sort(Darray *darray)
 {
     TRACE();
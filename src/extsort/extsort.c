@@ -0,0 +1,749 @@
+#include <extsort.h>
+#include <filebuffer.h>
+#include <kmerge.h>
+#include <sort.h>
+#include <sysinfo.h>
+#include <log.h>
+#include <common.h>
+#include <generic.h>
+#include <compiler.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#define EXTSORT_MIN_PART        BIT(12) /* don't start thread for less records */
+#define EXTSORT_OUT_BUFFER      BIT(20) /* output is appended by 1MB blocks */
+#define EXTSORT_SYNC_BYTES      BIT(26) /* background writeback each 64MB */
+#define EXTSORT_MAX_FAN_IN      512     /* max runs merged at once (open files) */
+#define EXTSORT_RUN_WINDOWS     2       /* mapped windows per run while merging */
+
+typedef struct Extsort_run
+{
+    int     fd;     /* unlinked temp file */
+    size_t  size;
+} Extsort_run;
+
+/* sorted sequence in RAM or in run file */
+typedef struct Extsort_source
+{
+    const BYTE          *ptr;   /* current record, NULL iff source is empty */
+    const BYTE          *end;   /* end of current chunk */
+    File_window         *fw;    /* NULL iff source is in RAM */
+    File_window_cursor  cursor;
+} Extsort_source;
+
+/* part of chunk sorted by one thread */
+typedef struct Extsort_part
+{
+    BYTE    *t;
+    size_t  num_elements;
+    size_t  size_of;
+    cmp_f   cmp;
+    int     ret;
+} Extsort_part;
+
+typedef struct Extsort_ctx
+{
+    size_t          size_of;
+    cmp_f           cmp;
+    size_t          memory;
+    size_t          threads;
+    const char      *tmp_dir;
+    Extsort_run     *runs;
+    size_t          num_runs;
+    size_t          size_runs;  /* allocated */
+} Extsort_ctx;
+
+/*
+    Create unlinked temp file in ctx->tmp_dir
+
+    PARAMS
+    @IN ctx - pointer to Extsort_ctx
+
+    RETURN
+    -1 iff failure
+    File descriptor iff success
+*/
+static int __extsort_tmp_file(const Extsort_ctx *ctx);
+
+/*
+    Create temp file for output next to @out_path, it is renamed to @out_path on success,
+    so input is not destroyed when sort fails (input can be equal to output)
+
+    PARAMS
+    @IN out_path - path to output file
+    @OUT path - path of created file
+    @IN size - size of @path buffer
+
+    RETURN
+    -1 iff failure
+    File descriptor iff success
+*/
+static int __extsort_out_file(const char * ___restrict___ out_path, char * ___restrict___ path, size_t size);
+
+/*
+    Add run to ctx->runs
+
+    PARAMS
+    @IN ctx - pointer to Extsort_ctx
+    @IN fd - file of run
+    @IN size - size of run
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+static int __extsort_add_run(Extsort_ctx *ctx, int fd, size_t size);
+
+/*
+    Thread function, sort part
+
+    PARAMS
+    @IN arg - pointer to Extsort_part
+
+    RETURN
+    NULL
+*/
+static void *__extsort_sort_part(void *arg);
+
+/*
+    Split chunk between threads and sort parts in parallel
+
+    PARAMS
+    @IN ctx - pointer to Extsort_ctx
+    @IN chunk - chunk
+    @IN num_elements - number of records in chunk
+    @OUT parts - sorted parts (ctx->threads entries)
+
+    RETURN
+    -1 iff failure
+    Number of parts iff success
+*/
+static ssize_t __extsort_sort_chunk(const Extsort_ctx *ctx, BYTE *chunk, size_t num_elements, Extsort_part *parts);
+
+/*
+    Open run as source of merge
+
+    PARAMS
+    @IN ctx - pointer to Extsort_ctx
+    @IN run - run
+    @IN window_size - size of window (multiple of size_of and page size)
+    @OUT source - source
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+static int __extsort_source_open(const Extsort_ctx *ctx, const Extsort_run *run, size_t window_size, Extsort_source *source);
+
+/*
+    Move source to next record
+
+    PARAMS
+    @IN source - source
+    @IN size_of - size of record
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+static ___inline___ int __extsort_source_next(Extsort_source *source, size_t size_of);
+
+/*
+    Merge sources by loser tree (see kmerge.h) and append result to file fd
+
+    PARAMS
+    @IN ctx - pointer to Extsort_ctx
+    @IN sources - sources
+    @IN k - number of sources
+    @IN fd - output file
+
+    RETURN
+    -1 iff failure
+    Number of written bytes iff success
+*/
+static ssize_t __extsort_merge(const Extsort_ctx *ctx, Extsort_source *sources, size_t k, int fd);
+
+/*
+    Merge runs[first, first + k) into file fd and close them
+
+    PARAMS
+    @IN ctx - pointer to Extsort_ctx
+    @IN runs - runs
+    @IN k - number of runs
+    @IN window_size - size of window per run
+    @IN fd - output file
+
+    RETURN
+    -1 iff failure
+    Number of written bytes iff success
+*/
+static ssize_t __extsort_merge_runs(const Extsort_ctx *ctx, Extsort_run *runs, size_t k, size_t window_size, int fd);
+
+static int __extsort_tmp_file(const Extsort_ctx *ctx)
+{
+    char path[PATH_MAX];
+    int fd;
+
+    TRACE();
+
+    if (snprintf(path, sizeof(path), "%s/extsort_XXXXXX", ctx->tmp_dir) >= (int)sizeof(path))
+        ERROR("tmp_dir is too long\n", -1);
+
+    fd = mkstemp(path);
+    if (fd == -1)
+        ERROR("mkstemp error\n", -1);
+
+    /* file lives until fd is closed */
+    (void)unlink(path);
+
+    return fd;
+}
+
+static int __extsort_out_file(const char * ___restrict___ out_path, char * ___restrict___ path, size_t size)
+{
+    int fd;
+
+    TRACE();
+
+    if (snprintf(path, size, "%s.extsort_XXXXXX", out_path) >= (int)size)
+        ERROR("out_path is too long\n", -1);
+
+    fd = mkstemp(path);
+    if (fd == -1)
+        ERROR("mkstemp error\n", -1);
+
+    /* mkstemp creates file with 0600 */
+    (void)fchmod(fd, 0644);
+
+    return fd;
+}
+
+static int __extsort_add_run(Extsort_ctx *ctx, int fd, size_t size)
+{
+    Extsort_run *runs;
+
+    TRACE();
+
+    if (ctx->num_runs == ctx->size_runs)
+    {
+        runs = (Extsort_run *)realloc(ctx->runs, MAX(ctx->size_runs << 1, (size_t)16) * sizeof(Extsort_run));
+        if (runs == NULL)
+            ERROR("realloc error\n", 1);
+
+        ctx->runs = runs;
+        ctx->size_runs = MAX(ctx->size_runs << 1, (size_t)16);
+    }
+
+    ctx->runs[ctx->num_runs].fd = fd;
+    ctx->runs[ctx->num_runs].size = size;
+    ++ctx->num_runs;
+
+    return 0;
+}
+
+static void *__extsort_sort_part(void *arg)
+{
+    Extsort_part *part = (Extsort_part *)arg;
+
+    part->ret = sort((void *)part->t, part->num_elements, part->cmp, part->size_of);
+
+    return NULL;
+}
+
+static ssize_t __extsort_sort_chunk(const Extsort_ctx *ctx, BYTE *chunk, size_t num_elements, Extsort_part *parts)
+{
+    pthread_t threads[EXTSORT_MAX_THREADS];
+    bool started[EXTSORT_MAX_THREADS] = {0};
+    size_t num_parts;
+    size_t offset;
+    size_t i;
+    int ret = 0;
+
+    TRACE();
+
+    num_parts = MAX(num_elements / (size_t)EXTSORT_MIN_PART, (size_t)1);
+    num_parts = MIN(num_parts, ctx->threads);
+    for (i = 0, offset = 0; i < num_parts; ++i)
+    {
+        parts[i].t = chunk + offset * ctx->size_of;
+        parts[i].num_elements = num_elements / num_parts + (i < num_elements % num_parts);
+        parts[i].size_of = ctx->size_of;
+        parts[i].cmp = ctx->cmp;
+        parts[i].ret = 0;
+
+        offset += parts[i].num_elements;
+    }
+
+    for (i = 1; i < num_parts; ++i)
+        started[i] = pthread_create(&threads[i], NULL, __extsort_sort_part, (void *)&parts[i]) == 0;
+
+    /* part 0 and parts without thread are sorted by caller */
+    for (i = 0; i < num_parts; ++i)
+        if (!started[i])
+            (void)__extsort_sort_part((void *)&parts[i]);
+
+    for (i = 1; i < num_parts; ++i)
+        if (started[i])
+            (void)pthread_join(threads[i], NULL);
+
+    for (i = 0; i < num_parts; ++i)
+        ret |= parts[i].ret;
+
+    if (ret)
+        ERROR("sort error\n", -1);
+
+    return (ssize_t)num_parts;
+}
+
+static int __extsort_source_open(const Extsort_ctx *ctx, const Extsort_run *run, size_t window_size, Extsort_source *source)
+{
+    const void *data;
+    ssize_t len;
+
+    TRACE();
+
+    source->fw = file_window_create(run->fd, PROT_READ, 0, window_size, EXTSORT_RUN_WINDOWS);
+    if (source->fw == NULL)
+        ERROR("file_window_create error\n", 1);
+
+    (void)file_window_set_advice(source->fw, MADV_SEQUENTIAL);
+    if (file_window_cursor_init(source->fw, &source->cursor, 0))
+    {
+        (void)file_window_destroy(source->fw);
+        ERROR("file_window_cursor_init error\n", 1);
+    }
+
+    /* window is multiple of size_of, so chunk has only whole records */
+    len = file_window_cursor_next(&source->cursor, &data);
+    if (len <= 0 || (size_t)len % ctx->size_of)
+    {
+        (void)file_window_destroy(source->fw);
+        ERROR("file_window_cursor_next error\n", 1);
+    }
+
+    source->ptr = (const BYTE *)data;
+    source->end = source->ptr + len;
+
+    return 0;
+}
+
+static ___inline___ int __extsort_source_next(Extsort_source *source, size_t size_of)
+{
+    const void *data;
+    ssize_t len;
+
+    source->ptr += size_of;
+    if (likely(source->ptr < source->end))
+        return 0;
+
+    source->ptr = NULL;
+    if (source->fw == NULL)
+        return 0;
+
+    len = file_window_cursor_next(&source->cursor, &data);
+    if (len == -1)
+        ERROR("file_window_cursor_next error\n", 1);
+
+    if (len > 0)
+    {
+        source->ptr = (const BYTE *)data;
+        source->end = source->ptr + len;
+    }
+
+    return 0;
+}
+
+static ssize_t __extsort_merge(const Extsort_ctx *ctx, Extsort_source *sources, size_t k, int fd)
+{
+    File_appender *fa;
+    Loser_tree *lt;
+    const void **heads;
+    BYTE *buffer;
+    size_t buffer_size;
+    size_t written = 0;
+    size_t used = 0;
+    size_t i;
+    ssize_t winner;
+    int ret = 0;
+
+    TRACE();
+
+    buffer_size = MAX((size_t)EXTSORT_OUT_BUFFER / ctx->size_of, (size_t)1) * ctx->size_of;
+    buffer = (BYTE *)malloc(buffer_size);
+    if (buffer == NULL)
+        ERROR("malloc error\n", -1);
+
+    heads = (const void **)malloc(k * sizeof(void *));
+    if (heads == NULL)
+    {
+        FREE(buffer);
+        ERROR("malloc error\n", -1);
+    }
+
+    for (i = 0; i < k; ++i)
+        heads[i] = (const void *)sources[i].ptr;
+
+    lt = loser_tree_create(k, ctx->cmp);
+    if (lt == NULL || loser_tree_init(lt, heads))
+    {
+        loser_tree_destroy(lt);
+        FREE(buffer);
+        FREE(heads);
+        ERROR("loser_tree error\n", -1);
+    }
+
+    fa = file_appender_create(fd, 0);
+    if (fa == NULL)
+    {
+        loser_tree_destroy(lt);
+        FREE(buffer);
+        FREE(heads);
+        ERROR("file_appender_create error\n", -1);
+    }
+
+    (void)file_appender_set_sync(fa, EXTSORT_SYNC_BYTES);
+
+    while ((winner = loser_tree_get_winner(lt)) != -1)
+    {
+        __ASSIGN__(buffer[used], *(BYTE *)sources[winner].ptr, ctx->size_of);
+        used += ctx->size_of;
+
+        if (used == buffer_size)
+        {
+            if (file_appender_append(fa, buffer, used))
+            {
+                ret = 1;
+                break;
+            }
+
+            written += used;
+            used = 0;
+        }
+
+        if (__extsort_source_next(&sources[winner], ctx->size_of))
+        {
+            ret = 1;
+            break;
+        }
+
+        (void)loser_tree_replay(lt, (const void *)sources[winner].ptr);
+    }
+
+    if (ret == 0 && used > 0)
+    {
+        ret = file_appender_append(fa, buffer, used);
+        written += used;
+    }
+
+    ret |= file_appender_destroy(fa);
+
+    loser_tree_destroy(lt);
+    FREE(buffer);
+    FREE(heads);
+
+    if (ret)
+        ERROR("merge error\n", -1);
+
+    return (ssize_t)written;
+}
+
+static ssize_t __extsort_merge_runs(const Extsort_ctx *ctx, Extsort_run *runs, size_t k, size_t window_size, int fd)
+{
+    Extsort_source *sources;
+    ssize_t written = -1;
+    size_t opened;
+    size_t i;
+
+    TRACE();
+
+    sources = (Extsort_source *)calloc(k, sizeof(Extsort_source));
+    if (sources == NULL)
+        ERROR("calloc error\n", -1);
+
+    for (opened = 0; opened < k; ++opened)
+        if (__extsort_source_open(ctx, &runs[opened], window_size, &sources[opened]))
+            break;
+
+    if (opened == k)
+        written = __extsort_merge(ctx, sources, k, fd);
+
+    for (i = 0; i < opened; ++i)
+        (void)file_window_destroy(sources[i].fw);
+
+    for (i = 0; i < k; ++i)
+    {
+        close(runs[i].fd);
+        runs[i].fd = -1;
+    }
+
+    FREE(sources);
+
+    if (written == -1)
+        ERROR("merge error\n", -1);
+
+    return written;
+}
+
+int extsort_file(const char *in_path, const char *out_path, size_t size_of, cmp_f cmp,
+                 const Extsort_conf *conf, Extsort_stats *stats)
+{
+    Extsort_ctx ctx = {0};
+    Extsort_part parts[EXTSORT_MAX_THREADS];
+    Extsort_source sources[EXTSORT_MAX_THREADS];
+    Extsort_stats _stats = {0};
+    File_window *fw = NULL;
+    File_window_cursor cursor;
+    BYTE *chunk = NULL;
+    struct stat st;
+    char out_tmp[PATH_MAX];
+    size_t chunk_size;
+    size_t file_size;
+    size_t page_size;
+    size_t unit;
+    size_t window_size;
+    size_t fan_in;
+    size_t num_runs;
+    size_t group;
+    size_t i;
+    size_t j;
+    ssize_t len;
+    ssize_t num_parts = 0;
+    ssize_t written;
+    int fd;
+    int out = -1;
+    int ret = 1;
+
+    TRACE();
+
+    if (in_path == NULL || out_path == NULL || cmp == NULL)
+        ERROR("in_path == NULL || out_path == NULL || cmp == NULL\n", 1);
+
+    if (size_of < 1)
+        ERROR("size_of < 1\n", 1);
+
+    if (stat(in_path, &st) == -1)
+        ERROR("stat error\n", 1);
+
+    file_size = (size_t)st.st_size;
+    if (file_size % size_of)
+        ERROR("Size of file is not multiple of size_of\n", 1);
+
+    ctx.size_of = size_of;
+    ctx.cmp = cmp;
+    ctx.memory = conf != NULL ? conf->memory : 0;
+    ctx.threads = conf != NULL ? conf->threads : 0;
+    ctx.tmp_dir = conf != NULL ? conf->tmp_dir : NULL;
+
+    if (ctx.memory == 0)
+        ctx.memory = sysinfo_get_available_memory() >> 1;
+
+    ctx.memory = MAX(ctx.memory, (size_t)EXTSORT_MIN_MEMORY);
+    ctx.memory = MAX(ctx.memory, size_of);
+
+    if (ctx.threads == 0)
+        ctx.threads = (size_t)MAX(sysconf(_SC_NPROCESSORS_ONLN), 1L);
+
+    ctx.threads = MIN(ctx.threads, (size_t)EXTSORT_MAX_THREADS);
+
+    if (ctx.tmp_dir == NULL)
+        ctx.tmp_dir = getenv("TMPDIR");
+
+    if (ctx.tmp_dir == NULL)
+        ctx.tmp_dir = "/tmp";
+
+    _stats.records = file_size / size_of;
+
+    /* empty input, nothing to read */
+    if (file_size == 0)
+    {
+        out = open(out_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (out == -1)
+            ERROR("open error\n", 1);
+
+        close(out);
+        if (stats != NULL)
+            *stats = _stats;
+
+        return 0;
+    }
+
+    chunk_size = MIN(ctx.memory / size_of, _stats.records) * size_of;
+    chunk = (BYTE *)malloc(chunk_size);
+    if (chunk == NULL)
+        ERROR("malloc error\n", 1);
+
+    fw = file_window_create_from_path(in_path, PROT_READ, O_RDONLY, 0, 0, 0);
+    if (fw == NULL)
+        goto cleanup;
+
+    (void)file_window_set_advice(fw, MADV_SEQUENTIAL);
+    if (file_window_cursor_init(fw, &cursor, 0))
+        goto cleanup;
+
+    /* 1. runs */
+    while ((len = file_window_cursor_read(&cursor, chunk, chunk_size)) > 0)
+    {
+        num_parts = __extsort_sort_chunk(&ctx, chunk, (size_t)len / size_of, parts);
+        if (num_parts == -1)
+            goto cleanup;
+
+        /* whole input is in RAM, merge parts to output later */
+        if ((size_t)len == file_size)
+            break;
+
+        for (i = 0; i < (size_t)num_parts; ++i)
+        {
+            sources[i].ptr = parts[i].t;
+            sources[i].end = parts[i].t + parts[i].num_elements * size_of;
+            sources[i].fw = NULL;
+        }
+
+        fd = __extsort_tmp_file(&ctx);
+        if (fd == -1)
+            goto cleanup;
+
+        written = __extsort_merge(&ctx, sources, (size_t)num_parts, fd);
+        if (written != len || __extsort_add_run(&ctx, fd, (size_t)written))
+        {
+            close(fd);
+            goto cleanup;
+        }
+    }
+
+    if (len == -1)
+        goto cleanup;
+
+    /* input can be equal to output */
+    (void)file_window_destroy(fw);
+    fw = NULL;
+
+    _stats.runs = MAX(ctx.num_runs, (size_t)1);
+
+    if (ctx.num_runs == 0)
+    {
+        out = __extsort_out_file(out_path, out_tmp, sizeof(out_tmp));
+        if (out == -1)
+            goto cleanup;
+
+        for (i = 0; i < (size_t)num_parts; ++i)
+        {
+            sources[i].ptr = parts[i].t;
+            sources[i].end = parts[i].t + parts[i].num_elements * size_of;
+            sources[i].fw = NULL;
+        }
+
+        if (__extsort_merge(&ctx, sources, (size_t)num_parts, out) != (ssize_t)file_size)
+            goto cleanup;
+
+        ret = 0;
+        goto cleanup;
+    }
+
+    /* 2. merge, RAM for chunk is used by windows now */
+    FREE(chunk);
+
+    /* window has only whole records */
+    page_size = (size_t)sysconf(_SC_PAGESIZE);
+    for (i = page_size, j = size_of; j != 0; )
+    {
+        group = i % j;
+        i = j;
+        j = group;
+    }
+
+    unit = size_of / i * page_size;
+    fan_in = MAX(ctx.memory / (EXTSORT_RUN_WINDOWS * unit), (size_t)2);
+    fan_in = MIN(fan_in, (size_t)EXTSORT_MAX_FAN_IN);
+
+    while (ctx.num_runs > fan_in)
+    {
+        window_size = MAX(ctx.memory / (EXTSORT_RUN_WINDOWS * fan_in) / unit, (size_t)1) * unit;
+
+        /* merged run i replaces group i */
+        for (i = 0, num_runs = 0; i < ctx.num_runs; i += group, ++num_runs)
+        {
+            group = MIN(fan_in, ctx.num_runs - i);
+            if (group == 1)
+            {
+                /* move, slot i must not own fd anymore */
+                if (num_runs != i)
+                {
+                    ctx.runs[num_runs] = ctx.runs[i];
+                    ctx.runs[i].fd = -1;
+                }
+                continue;
+            }
+
+            fd = __extsort_tmp_file(&ctx);
+            if (fd == -1)
+                goto cleanup;
+
+            written = __extsort_merge_runs(&ctx, &ctx.runs[i], group, window_size, fd);
+            if (written == -1)
+            {
+                close(fd);
+                goto cleanup;
+            }
+
+            ctx.runs[num_runs].fd = fd;
+            ctx.runs[num_runs].size = (size_t)written;
+        }
+
+        /* closed runs after num_runs */
+        ctx.num_runs = num_runs;
+        ++_stats.merge_passes;
+    }
+
+    out = __extsort_out_file(out_path, out_tmp, sizeof(out_tmp));
+    if (out == -1)
+        goto cleanup;
+
+    window_size = MAX(ctx.memory / (EXTSORT_RUN_WINDOWS * ctx.num_runs) / unit, (size_t)1) * unit;
+    written = __extsort_merge_runs(&ctx, ctx.runs, ctx.num_runs, window_size, out);
+    ctx.num_runs = 0;
+    ++_stats.merge_passes;
+
+    if (written != (ssize_t)file_size)
+        goto cleanup;
+
+    ret = 0;
+
+cleanup:
+    if (fw != NULL)
+        (void)file_window_destroy(fw);
+
+    for (i = 0; i < ctx.num_runs; ++i)
+        if (ctx.runs[i].fd != -1)
+            close(ctx.runs[i].fd);
+
+    if (out != -1)
+    {
+        close(out);
+
+        /* replace output only when whole file is sorted */
+        if (ret == 0 && rename(out_tmp, out_path) == -1)
+            ret = 1;
+
+        if (ret)
+            (void)unlink(out_tmp);
+    }
+
+    FREE(ctx.runs);
+    FREE(chunk);
+
+    if (ret)
+        ERROR("extsort error\n", 1);
+
+    if (stats != NULL)
+        *stats = _stats;
+
+    return 0;
+}
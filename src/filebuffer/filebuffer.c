@@ -9,11 +9,13 @@
 #include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <tcp.h>
 #include <log.h>
 #include <compiler.h>
 #include <common.h>
 #include <fcntl.h>
 #include <stdbool.h>
+#include <errno.h>
 
 struct File_buffer
 {
@@ -227,6 +229,23 @@ ssize_t file_buffer_get_size(const File_buffer *fb)
 	return (ssize_t)fb->size;
 }
 
+ssize_t file_buffer_send(const File_buffer *fb, int socket, size_t offset, size_t count)
+{
+	off_t off;
+
+	TRACE();
+
+	if (fb == NULL)
+		ERROR("fb == NULL\n", -1);
+
+	if (offset > fb->size)
+		ERROR("offset > size of file\n", -1);
+
+	off = (off_t)offset;
+
+	return tcp_sendfile(socket, fb->fd, &off, MIN(count, fb->size - offset));
+}
+
 /**** FILE BUFFER 64 ****/
 
 File_buffer *file_buffer64_create(int fd, int protect_flag)
@@ -328,4 +347,715 @@ int file_buffer64_append(File_buffer * ___restrict___ fb, const char * ___restri
     fb->size = (size_t)new_size;
 
     return 0;
-}
\ No newline at end of file
+}
+/**** FILE APPENDER ****/
+
+struct File_appender
+{
+	char			*buffer;
+	size_t			cursor; /* written bytes */
+	size_t			capacity; /* mapped and preallocated size */
+	size_t			extent_size;
+	size_t			sync_bytes; /* 0 means no periodic writeback */
+	size_t			synced; /* writeback started up to this offset */
+	int				fd;
+	bool			has_private_file;
+};
+
+/*
+	Preallocate file to @new_capacity and map it
+
+	PARAMS
+	@IN fa - pointer to appender
+	@IN new_capacity - new capacity (aligned to extent)
+
+	RETURN:
+	%0 iff success
+	%Non-zero value iff failure
+*/
+static int __file_appender_grow(File_appender *fa, size_t new_capacity);
+
+static int __file_appender_grow(File_appender *fa, size_t new_capacity)
+{
+	char *buffer;
+
+	TRACE();
+
+	/* fallocate reserves blocks, so writes to mapping don't fail on full disk (SIGBUS) */
+	if (fallocate(fa->fd, 0, (off_t)fa->capacity, (off_t)(new_capacity - fa->capacity)) == -1)
+	{
+		if (errno != EOPNOTSUPP)
+			ERROR("fallocate error\n", 1);
+
+		if (ftruncate(fa->fd, (off_t)new_capacity) == -1)
+			ERROR("ftruncate error\n", 1);
+	}
+
+	if (fa->buffer == NULL)
+		buffer = (char *)mmap(NULL, new_capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fa->fd, 0);
+	else
+		buffer = (char *)mremap((void *)fa->buffer, fa->capacity, new_capacity, MREMAP_MAYMOVE);
+
+	if (buffer == MAP_FAILED)
+		ERROR("mmap error\n", 1);
+
+	fa->buffer = buffer;
+	fa->capacity = new_capacity;
+
+	return 0;
+}
+
+File_appender *file_appender_create(int fd, size_t extent_size)
+{
+	File_appender *fa;
+	struct stat ft;
+	size_t page_size = (size_t)getpagesize();
+
+	TRACE();
+
+	if (fd < 0)
+		ERROR("fd < 0\n", NULL);
+
+	if (extent_size == 0)
+		extent_size = FILE_APPENDER_DEFAULT_EXTENT;
+
+	/* extent is a multiple of page size */
+	extent_size = (extent_size + page_size - 1) & ~(page_size - 1);
+
+	if (fstat(fd, &ft) == -1)
+		ERROR("fstat error\n", NULL);
+
+	fa = (File_appender *)malloc(sizeof(File_appender));
+	if (fa == NULL)
+		ERROR("malloc error\n", NULL);
+
+	fa->buffer = NULL;
+	fa->cursor = (size_t)ft.st_size;
+	fa->capacity = (size_t)ft.st_size;
+	fa->extent_size = extent_size;
+	fa->sync_bytes = 0;
+	fa->synced = fa->cursor;
+	fa->fd = fd;
+	fa->has_private_file = false;
+
+	if (__file_appender_grow(fa, (fa->cursor / extent_size + 1) * extent_size))
+	{
+		FREE(fa);
+		ERROR("__file_appender_grow error\n", NULL);
+	}
+
+	return fa;
+}
+
+File_appender *file_appender_create_from_path(const char *path, int open_flag, size_t extent_size)
+{
+	File_appender *fa;
+	int fd;
+
+	TRACE();
+
+	if (path == NULL)
+		ERROR("path == NULL\n", NULL);
+
+	fd = open(path, open_flag, 0644);
+	if (fd == -1)
+		ERROR("open error\n", NULL);
+
+	fa = file_appender_create(fd, extent_size);
+	if (fa == NULL)
+	{
+		close(fd);
+		ERROR("file_appender_create error\n", NULL);
+	}
+
+	fa->has_private_file = true;
+	return fa;
+}
+
+int file_appender_destroy(File_appender *fa)
+{
+	int ret = 0;
+
+	TRACE();
+
+	if (fa == NULL)
+		return 1;
+
+	if (file_appender_synch(fa))
+		ret = 1;
+
+	if (munmap((void *)fa->buffer, fa->capacity) == -1)
+		ret = 1;
+
+	/* cut preallocated tail */
+	if (ftruncate(fa->fd, (off_t)fa->cursor) == -1)
+		ret = 1;
+
+	if (fa->has_private_file)
+		close(fa->fd);
+
+	FREE(fa);
+
+	if (ret)
+		ERROR("destroy error\n", 1);
+
+	return 0;
+}
+
+void *file_appender_reserve(File_appender *fa, size_t size)
+{
+	size_t offset;
+	size_t needed;
+
+	TRACE();
+
+	if (fa == NULL || size == 0)
+		ERROR("fa == NULL || size == 0\n", NULL);
+
+	offset = fa->cursor;
+	needed = offset + size;
+	if (unlikely(needed > fa->capacity))
+		if (__file_appender_grow(fa, (needed + fa->extent_size - 1) / fa->extent_size * fa->extent_size))
+			ERROR("__file_appender_grow error\n", NULL);
+
+	fa->cursor = needed;
+
+	/* start writeback of data before this record (record is not written yet) */
+	if (fa->sync_bytes != 0 && offset - fa->synced >= fa->sync_bytes)
+	{
+		(void)sync_file_range(fa->fd, (off_t)fa->synced, (off_t)(offset - fa->synced), SYNC_FILE_RANGE_WRITE);
+		fa->synced = offset;
+	}
+
+	return (void *)(fa->buffer + offset);
+}
+
+int file_appender_append(File_appender * ___restrict___ fa, const void * ___restrict___ data, size_t size)
+{
+	void *ptr;
+
+	TRACE();
+
+	if (fa == NULL || data == NULL || size == 0)
+		ERROR("fa == NULL || data == NULL || size == 0\n", 1);
+
+	ptr = file_appender_reserve(fa, size);
+	if (ptr == NULL)
+		ERROR("file_appender_reserve error\n", 1);
+
+	(void)memcpy(ptr, data, size);
+
+	return 0;
+}
+
+int file_appender_set_sync(File_appender *fa, size_t sync_bytes)
+{
+	TRACE();
+
+	if (fa == NULL)
+		ERROR("fa == NULL\n", 1);
+
+	fa->sync_bytes = sync_bytes;
+
+	return 0;
+}
+
+int file_appender_synch(File_appender *fa)
+{
+	TRACE();
+
+	if (fa == NULL)
+		ERROR("fa == NULL\n", 1);
+
+	if (fa->cursor > 0 && msync((void *)fa->buffer, fa->cursor, MS_SYNC) == -1)
+		ERROR("msync error\n", 1);
+
+	fa->synced = fa->cursor;
+
+	return 0;
+}
+
+char *file_appender_get_buff(const File_appender *fa)
+{
+	TRACE();
+
+	if (fa == NULL)
+		ERROR("fa == NULL\n", NULL);
+
+	return fa->buffer;
+}
+
+ssize_t file_appender_get_size(const File_appender *fa)
+{
+	TRACE();
+
+	if (fa == NULL)
+		ERROR("fa == NULL\n", -1);
+
+	return (ssize_t)fa->cursor;
+}
+
+/**** FILE WINDOW ****/
+
+typedef struct File_window_map
+{
+	char			*addr; /* NULL iff slot is free */
+	size_t			index; /* window index in file */
+	size_t			len;
+	size_t			last_use;
+} File_window_map;
+
+struct File_window
+{
+	File_window_map	*maps;
+	size_t			max_windows;
+	size_t			num_mapped;
+	size_t			window_size;
+	size_t			file_size;
+	size_t			clock; /* LRU clock */
+	size_t			last; /* last used slot */
+	int				fd;
+	int				protect_flag;
+	int				map_flag;
+	int				advice;
+	bool			has_private_file;
+};
+
+/*
+	Convert MADV_* hint to POSIX_FADV_* hint
+
+	PARAMS
+	@IN advice - MADV_* hint
+
+	RETURN:
+	%-1 iff there is no equivalent
+	%POSIX_FADV_* iff success
+*/
+static int __file_window_fadvice(int advice);
+
+/*
+	Get mapped window, map it (evict LRU window) if needed
+
+	PARAMS
+	@IN fw - pointer to File_window
+	@IN index - window index
+
+	RETURN:
+	%NULL iff failure
+	%Pointer to window iff success
+*/
+static File_window_map *__file_window_map(File_window *fw, size_t index);
+
+static int __file_window_fadvice(int advice)
+{
+	switch (advice)
+	{
+		case MADV_NORMAL:
+		{
+			return POSIX_FADV_NORMAL;
+		}
+		case MADV_SEQUENTIAL:
+		{
+			return POSIX_FADV_SEQUENTIAL;
+		}
+		case MADV_RANDOM:
+		{
+			return POSIX_FADV_RANDOM;
+		}
+		case MADV_WILLNEED:
+		{
+			return POSIX_FADV_WILLNEED;
+		}
+		case MADV_DONTNEED:
+		{
+			return POSIX_FADV_DONTNEED;
+		}
+		default:
+		{
+			return -1;
+		}
+	}
+}
+
+static File_window_map *__file_window_map(File_window *fw, size_t index)
+{
+	File_window_map *map;
+	size_t i;
+	size_t victim = 0;
+	size_t offset;
+	void *addr;
+
+	TRACE();
+
+	/* sequential access hits the same window many times */
+	map = &fw->maps[fw->last];
+	if (likely(map->addr != NULL && map->index == index))
+	{
+		map->last_use = ++fw->clock;
+		return map;
+	}
+
+	for (i = 0; i < fw->max_windows; ++i)
+	{
+		map = &fw->maps[i];
+		if (map->addr == NULL)
+		{
+			victim = i;
+			continue;
+		}
+
+		if (map->index == index)
+		{
+			map->last_use = ++fw->clock;
+			fw->last = i;
+			return map;
+		}
+	}
+
+	/* all slots are used, evict least recently used window */
+	if (fw->num_mapped == fw->max_windows)
+	{
+		for (i = 1; i < fw->max_windows; ++i)
+			if (fw->maps[i].last_use < fw->maps[victim].last_use)
+				victim = i;
+
+		if (munmap((void *)fw->maps[victim].addr, fw->maps[victim].len) == -1)
+			ERROR("munmap error\n", NULL);
+
+		fw->maps[victim].addr = NULL;
+		--fw->num_mapped;
+	}
+
+	map = &fw->maps[victim];
+	offset = index * fw->window_size;
+	map->len = MIN(fw->window_size, fw->file_size - offset);
+
+	addr = mmap(NULL, map->len, fw->protect_flag, MAP_SHARED | fw->map_flag, fw->fd, (off_t)offset);
+	if (addr == MAP_FAILED)
+		ERROR("mmap error\n", NULL);
+
+	if (fw->advice != MADV_NORMAL)
+		(void)madvise(addr, map->len, fw->advice);
+
+	map->addr = (char *)addr;
+	map->index = index;
+	map->last_use = ++fw->clock;
+	fw->last = victim;
+	++fw->num_mapped;
+
+	return map;
+}
+
+File_window *file_window_create(int fd, int protect_flag, int map_flag, size_t window_size, size_t max_windows)
+{
+	File_window *fw;
+	struct stat ft;
+	size_t page_size = (size_t)getpagesize();
+
+	TRACE();
+
+	if (fd < 0)
+		ERROR("fd < 0\n", NULL);
+
+	if (window_size == 0)
+		window_size = FILE_WINDOW_DEFAULT_SIZE;
+
+	if (max_windows == 0)
+		max_windows = FILE_WINDOW_DEFAULT_NUM;
+
+	/* mmap offset has to be aligned to page */
+	window_size = (window_size + page_size - 1) & ~(page_size - 1);
+
+	if (fstat(fd, &ft) == -1)
+		ERROR("fstat error\n", NULL);
+
+	fw = (File_window *)malloc(sizeof(File_window));
+	if (fw == NULL)
+		ERROR("malloc error\n", NULL);
+
+	fw->maps = (File_window_map *)calloc(max_windows, sizeof(File_window_map));
+	if (fw->maps == NULL)
+	{
+		FREE(fw);
+		ERROR("calloc error\n", NULL);
+	}
+
+	fw->max_windows = max_windows;
+	fw->num_mapped = 0;
+	fw->window_size = window_size;
+	fw->file_size = (size_t)ft.st_size;
+	fw->clock = 0;
+	fw->last = 0;
+	fw->fd = fd;
+	fw->protect_flag = protect_flag;
+	fw->map_flag = map_flag;
+	fw->advice = MADV_NORMAL;
+	fw->has_private_file = false;
+
+	return fw;
+}
+
+File_window *file_window_create_from_path(const char *path, int protect_flag, int open_flag, int map_flag, size_t window_size, size_t max_windows)
+{
+	File_window *fw;
+	int fd;
+
+	TRACE();
+
+	if (path == NULL)
+		ERROR("path == NULL\n", NULL);
+
+	fd = open(path, open_flag, 0644);
+	if (fd == -1)
+		ERROR("open error\n", NULL);
+
+	fw = file_window_create(fd, protect_flag, map_flag, window_size, max_windows);
+	if (fw == NULL)
+	{
+		close(fd);
+		ERROR("file_window_create error\n", NULL);
+	}
+
+	fw->has_private_file = true;
+	return fw;
+}
+
+int file_window_destroy(File_window *fw)
+{
+	size_t i;
+	int ret = 0;
+
+	TRACE();
+
+	if (fw == NULL)
+		return 1;
+
+	for (i = 0; i < fw->max_windows; ++i)
+		if (fw->maps[i].addr != NULL)
+			if (munmap((void *)fw->maps[i].addr, fw->maps[i].len) == -1)
+				ret = 1;
+
+	if (fw->has_private_file)
+		close(fw->fd);
+
+	FREE(fw->maps);
+	FREE(fw);
+
+	if (ret)
+		ERROR("munmap error\n", 1);
+
+	return 0;
+}
+
+void *file_window_get(File_window * ___restrict___ fw, size_t offset, size_t * ___restrict___ len)
+{
+	File_window_map *map;
+	size_t in_window;
+
+	TRACE();
+
+	if (fw == NULL || len == NULL)
+		ERROR("fw == NULL || len == NULL\n", NULL);
+
+	/* end of file is not an error */
+	if (offset >= fw->file_size)
+		return NULL;
+
+	map = __file_window_map(fw, offset / fw->window_size);
+	if (map == NULL)
+		ERROR("__file_window_map error\n", NULL);
+
+	in_window = offset % fw->window_size;
+	*len = map->len - in_window;
+
+	return (void *)(map->addr + in_window);
+}
+
+ssize_t file_window_read(File_window * ___restrict___ fw, size_t offset, void * ___restrict___ buf, size_t size)
+{
+	const char *data;
+	size_t len;
+	size_t copied = 0;
+
+	TRACE();
+
+	if (fw == NULL || buf == NULL)
+		ERROR("fw == NULL || buf == NULL\n", -1);
+
+	while (copied < size && offset < fw->file_size)
+	{
+		data = (const char *)file_window_get(fw, offset, &len);
+		if (data == NULL)
+			ERROR("file_window_get error\n", -1);
+
+		len = MIN(len, size - copied);
+		(void)memcpy((char *)buf + copied, data, len);
+
+		copied += len;
+		offset += len;
+	}
+
+	return (ssize_t)copied;
+}
+
+int file_window_set_advice(File_window *fw, int advice)
+{
+	size_t i;
+	int fadvice;
+
+	TRACE();
+
+	if (fw == NULL)
+		ERROR("fw == NULL\n", 1);
+
+	if (advice != MADV_NORMAL && advice != MADV_SEQUENTIAL && advice != MADV_RANDOM)
+		ERROR("Only NORMAL, SEQUENTIAL and RANDOM can be set for all windows\n", 1);
+
+	fadvice = __file_window_fadvice(advice);
+	(void)posix_fadvise(fw->fd, 0, 0, fadvice);
+
+	for (i = 0; i < fw->max_windows; ++i)
+		if (fw->maps[i].addr != NULL)
+			if (madvise((void *)fw->maps[i].addr, fw->maps[i].len, advice) == -1)
+				ERROR("madvise error\n", 1);
+
+	fw->advice = advice;
+
+	return 0;
+}
+
+int file_window_advise(File_window *fw, size_t offset, size_t size, int advice)
+{
+	const File_window_map *map;
+	size_t begin;
+	size_t end;
+	size_t page_size = (size_t)getpagesize();
+	size_t i;
+	int fadvice;
+
+	TRACE();
+
+	if (fw == NULL)
+		ERROR("fw == NULL\n", 1);
+
+	if (offset >= fw->file_size || size == 0)
+		return 0;
+
+	size = MIN(size, fw->file_size - offset);
+
+	/* mapped windows */
+	for (i = 0; i < fw->max_windows; ++i)
+	{
+		map = &fw->maps[i];
+		if (map->addr == NULL)
+			continue;
+
+		begin = MAX(offset, map->index * fw->window_size);
+		end = MIN(offset + size, map->index * fw->window_size + map->len);
+		if (begin >= end)
+			continue;
+
+		/* madvise needs page aligned address */
+		begin = (begin - map->index * fw->window_size) & ~(page_size - 1);
+		end -= map->index * fw->window_size;
+		if (madvise((void *)(map->addr + begin), end - begin, advice) == -1)
+			ERROR("madvise error\n", 1);
+	}
+
+	/* page cache (not mapped part) */
+	fadvice = __file_window_fadvice(advice);
+	if (fadvice == POSIX_FADV_WILLNEED || fadvice == POSIX_FADV_DONTNEED)
+		(void)posix_fadvise(fw->fd, (off_t)offset, (off_t)size, fadvice);
+
+	return 0;
+}
+
+ssize_t file_window_get_size(const File_window *fw)
+{
+	TRACE();
+
+	if (fw == NULL)
+		ERROR("fw == NULL\n", -1);
+
+	return (ssize_t)fw->file_size;
+}
+
+ssize_t file_window_get_num_mapped(const File_window *fw)
+{
+	TRACE();
+
+	if (fw == NULL)
+		ERROR("fw == NULL\n", -1);
+
+	return (ssize_t)fw->num_mapped;
+}
+
+int file_window_cursor_init(File_window * ___restrict___ fw, File_window_cursor * ___restrict___ cursor, size_t offset)
+{
+	TRACE();
+
+	if (fw == NULL || cursor == NULL)
+		ERROR("fw == NULL || cursor == NULL\n", 1);
+
+	cursor->____fw = fw;
+	cursor->____offset = MIN(offset, fw->file_size);
+
+	return 0;
+}
+
+ssize_t file_window_cursor_next(File_window_cursor * ___restrict___ cursor, const void ** ___restrict___ data)
+{
+	File_window *fw;
+	size_t len;
+	size_t next;
+
+	TRACE();
+
+	if (cursor == NULL || data == NULL)
+		ERROR("cursor == NULL || data == NULL\n", -1);
+
+	fw = cursor->____fw;
+	if (cursor->____offset >= fw->file_size)
+		return 0;
+
+	*data = file_window_get(fw, cursor->____offset, &len);
+	if (*data == NULL)
+		ERROR("file_window_get error\n", -1);
+
+	cursor->____offset += len;
+
+	/* readahead of next window, it will be ready when caller finishes this one */
+	next = cursor->____offset;
+	if (next < fw->file_size)
+		(void)posix_fadvise(fw->fd, (off_t)next, (off_t)MIN(fw->window_size, fw->file_size - next), POSIX_FADV_WILLNEED);
+
+	return (ssize_t)len;
+}
+
+ssize_t file_window_cursor_read(File_window_cursor * ___restrict___ cursor, void * ___restrict___ buf, size_t size)
+{
+	ssize_t ret;
+
+	TRACE();
+
+	if (cursor == NULL || buf == NULL)
+		ERROR("cursor == NULL || buf == NULL\n", -1);
+
+	ret = file_window_read(cursor->____fw, cursor->____offset, buf, size);
+	if (ret == -1)
+		ERROR("file_window_read error\n", -1);
+
+	cursor->____offset += (size_t)ret;
+
+	return ret;
+}
+
+ssize_t file_window_cursor_get_offset(const File_window_cursor *cursor)
+{
+	TRACE();
+
+	if (cursor == NULL)
+		ERROR("cursor == NULL\n", -1);
+
+	return (ssize_t)cursor->____offset;
+}
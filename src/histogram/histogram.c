@@ -16,6 +16,9 @@
 
 #define LEGEND_LINES 5
 
+#define QUANTILE_X_LEGEND "percentile [permille]"
+#define QUANTILE_Y_LEGEND "value"
+
 #define X_AXIS_LINES 2
 #define X_AXIS_COLUMNS 1
 
@@ -33,6 +36,9 @@
         printf("%*s", (int)(x), ""); \
     } while (0)
 
+/* percentiles drawn for quantile sketches */
+static const double histogram_quantiles[] = {0.1, 0.25, 0.5, 0.75, 0.9, 0.95, 0.99, 0.999, 1.0};
+
 /*
     Get terminal size
 
@@ -785,3 +791,53 @@ int histogram_int_draw( const int64_t *x_values,
 
     return 0;
 }
+
+int histogram_hdr_draw(const Hdr_histogram *h, const char *title, bool reset)
+{
+    int64_t x_values[ARRAY_SIZE(histogram_quantiles)];
+    int64_t y_values[ARRAY_SIZE(histogram_quantiles)];
+    uint64_t values[ARRAY_SIZE(histogram_quantiles)];
+    size_t i;
+
+    TRACE();
+
+    if (h == NULL)
+        ERROR("h == NULL\n", 1);
+
+    if (hdr_histogram_get_quantiles(h, histogram_quantiles, ARRAY_SIZE(histogram_quantiles), values))
+        ERROR("hdr_histogram_get_quantiles error\n", 1);
+
+    for (i = 0; i < ARRAY_SIZE(histogram_quantiles); ++i)
+    {
+        x_values[i] = (int64_t)(histogram_quantiles[i] * 1000.0 + 0.5);
+        y_values[i] = (int64_t)MIN(values[i], (uint64_t)INT64_MAX);
+    }
+
+    return histogram_int_draw(x_values, y_values, ARRAY_SIZE(x_values), ARRAY_SIZE(y_values),
+                              title, QUANTILE_X_LEGEND, QUANTILE_Y_LEGEND, reset);
+}
+
+int histogram_tdigest_draw(Tdigest *td, const char *title, bool reset)
+{
+    int64_t x_values[ARRAY_SIZE(histogram_quantiles)];
+    int64_t y_values[ARRAY_SIZE(histogram_quantiles)];
+    double value;
+    size_t i;
+
+    TRACE();
+
+    if (td == NULL)
+        ERROR("td == NULL\n", 1);
+
+    for (i = 0; i < ARRAY_SIZE(histogram_quantiles); ++i)
+    {
+        if (tdigest_get_quantile(td, histogram_quantiles[i], &value))
+            ERROR("tdigest_get_quantile error\n", 1);
+
+        x_values[i] = (int64_t)(histogram_quantiles[i] * 1000.0 + 0.5);
+        y_values[i] = (int64_t)(value >= 0.0 ? value + 0.5 : value - 0.5);
+    }
+
+    return histogram_int_draw(x_values, y_values, ARRAY_SIZE(x_values), ARRAY_SIZE(y_values),
+                              title, QUANTILE_X_LEGEND, QUANTILE_Y_LEGEND, reset);
+}
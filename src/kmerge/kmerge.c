@@ -0,0 +1,360 @@
+#include <kmerge.h>
+#include <log.h>
+#include <common.h>
+#include <generic.h>
+#include <compiler.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+/*
+    Nodes: tree[0] is winner, tree[1 .. k) are losers of matches,
+    leaf of source i is k + i (implicit), so tree is complete for every k.
+    win[] is used only during init (winners of subtrees).
+*/
+struct Loser_tree
+{
+    cmp_f       cmp;
+    size_t      k;
+    size_t      *tree;
+    size_t      *win;
+    const void  **heads;
+};
+
+/*
+    Build loser tree bottom up, BEFORE(a, b) is true iff source a wins with source b
+
+    PARAMS
+    @IN TREE - losers (k entries)
+    @IN WIN - winners (2 * k entries)
+    @IN K - number of sources
+    @IN BEFORE - match
+*/
+#define __KMERGE_BUILD(TREE, WIN, K, BEFORE) \
+    do { \
+        size_t ______i; \
+        size_t ______w; \
+        size_t ______l; \
+        for (______i = 0; ______i < (K); ++______i) \
+            (WIN)[(K) + ______i] = ______i; \
+        for (______i = (K) - 1; ______i > 0; --______i) \
+        { \
+            ______w = (WIN)[2 * ______i]; \
+            ______l = (WIN)[2 * ______i + 1]; \
+            if (BEFORE(______l, ______w)) \
+                SWAP(______w, ______l); \
+            (TREE)[______i] = ______l; \
+            (WIN)[______i] = ______w; \
+        } \
+        (TREE)[0] = (K) > 1 ? (WIN)[1] : 0; \
+    } while (0)
+
+/*
+    Replay matches of winner from its leaf to root
+
+    PARAMS
+    @IN TREE - losers
+    @IN K - number of sources
+    @IN BEFORE - match
+*/
+#define __KMERGE_REPLAY(TREE, K, BEFORE) \
+    do { \
+        size_t ______w = (TREE)[0]; \
+        size_t ______n; \
+        for (______n = ((K) + ______w) >> 1; ______n > 0; ______n >>= 1) \
+            if (BEFORE((TREE)[______n], ______w)) \
+                SWAP((TREE)[______n], ______w); \
+        (TREE)[0] = ______w; \
+    } while (0)
+
+/*
+    Match of generic tree, empty source loses, on equal elements lower index wins
+
+    PARAMS
+    @IN lt - pointer to Loser_tree
+    @IN a - index of source
+    @IN b - index of source
+
+    RETURN
+    true iff a wins
+*/
+static ___inline___ bool __loser_tree_before(const Loser_tree *lt, size_t a, size_t b);
+
+/*
+    Check params of kmerge functions
+
+    PARAMS
+    @IN out - output array
+    @IN arrays - arrays
+    @IN num_elements - sizes of arrays
+    @IN k - number of arrays
+
+    RETURN
+    0 iff params are correct
+    Non-zero value iff not
+*/
+static int __kmerge_check(const void *out, const void *arrays, const size_t *num_elements, size_t k);
+
+static ___inline___ bool __loser_tree_before(const Loser_tree *lt, size_t a, size_t b)
+{
+    int ret;
+
+    if (lt->heads[a] == NULL)
+        return false;
+
+    if (lt->heads[b] == NULL)
+        return true;
+
+    ret = lt->cmp(lt->heads[a], lt->heads[b]);
+
+    return ret < 0 || (ret == 0 && a < b);
+}
+
+static int __kmerge_check(const void *out, const void *arrays, const size_t *num_elements, size_t k)
+{
+    TRACE();
+
+    if (out == NULL || arrays == NULL || num_elements == NULL)
+        ERROR("out == NULL || arrays == NULL || num_elements == NULL\n", 1);
+
+    if (k == 0)
+        ERROR("k == 0\n", 1);
+
+    return 0;
+}
+
+Loser_tree *loser_tree_create(size_t k, cmp_f cmp)
+{
+    Loser_tree *lt;
+
+    TRACE();
+
+    if (k == 0)
+        ERROR("k == 0\n", NULL);
+
+    if (cmp == NULL)
+        ERROR("cmp == NULL\n", NULL);
+
+    lt = (Loser_tree *)malloc(sizeof(Loser_tree));
+    if (lt == NULL)
+        ERROR("malloc error\n", NULL);
+
+    /* tree and win in one block */
+    lt->tree = (size_t *)malloc(3 * k * sizeof(size_t));
+    if (lt->tree == NULL)
+    {
+        FREE(lt);
+        ERROR("malloc error\n", NULL);
+    }
+
+    lt->heads = (const void **)calloc(k, sizeof(void *));
+    if (lt->heads == NULL)
+    {
+        FREE(lt->tree);
+        FREE(lt);
+        ERROR("calloc error\n", NULL);
+    }
+
+    lt->win = lt->tree + k;
+    lt->k = k;
+    lt->cmp = cmp;
+    lt->tree[0] = 0;
+
+    return lt;
+}
+
+void loser_tree_destroy(Loser_tree *lt)
+{
+    TRACE();
+
+    if (lt == NULL)
+        return;
+
+    FREE(lt->tree);
+    FREE(lt->heads);
+    FREE(lt);
+}
+
+int loser_tree_init(Loser_tree *lt, const void * const *heads)
+{
+    TRACE();
+
+    if (lt == NULL || heads == NULL)
+        ERROR("lt == NULL || heads == NULL\n", 1);
+
+    (void)memcpy((void *)lt->heads, (const void *)heads, lt->k * sizeof(void *));
+
+#define __BEFORE(A, B) __loser_tree_before(lt, A, B)
+    __KMERGE_BUILD(lt->tree, lt->win, lt->k, __BEFORE);
+#undef __BEFORE
+
+    return 0;
+}
+
+ssize_t loser_tree_get_winner(const Loser_tree *lt)
+{
+    TRACE();
+
+    if (lt == NULL)
+        ERROR("lt == NULL\n", -1);
+
+    if (lt->heads[lt->tree[0]] == NULL)
+        return -1;
+
+    return (ssize_t)lt->tree[0];
+}
+
+const void *loser_tree_get_top(const Loser_tree *lt)
+{
+    TRACE();
+
+    if (lt == NULL)
+        ERROR("lt == NULL\n", NULL);
+
+    return lt->heads[lt->tree[0]];
+}
+
+int loser_tree_replay(Loser_tree *lt, const void *head)
+{
+    TRACE();
+
+    if (lt == NULL)
+        ERROR("lt == NULL\n", 1);
+
+    lt->heads[lt->tree[0]] = head;
+
+#define __BEFORE(A, B) __loser_tree_before(lt, A, B)
+    __KMERGE_REPLAY(lt->tree, lt->k, __BEFORE);
+#undef __BEFORE
+
+    return 0;
+}
+
+int kmerge(void *out, const void * const *arrays, const size_t *num_elements, size_t k, cmp_f cmp, size_t size_of)
+{
+    Loser_tree *lt;
+    size_t *pos;
+    BYTE *_out = (BYTE *)out;
+    size_t i;
+    size_t w;
+
+    TRACE();
+
+    if (__kmerge_check(out, (const void *)arrays, num_elements, k))
+        ERROR("Invalid params\n", 1);
+
+    if (cmp == NULL || size_of == 0)
+        ERROR("cmp == NULL || size_of == 0\n", 1);
+
+    lt = loser_tree_create(k, cmp);
+    if (lt == NULL)
+        ERROR("loser_tree_create error\n", 1);
+
+    pos = (size_t *)calloc(k, sizeof(size_t));
+    if (pos == NULL)
+    {
+        loser_tree_destroy(lt);
+        ERROR("calloc error\n", 1);
+    }
+
+    for (i = 0; i < k; ++i)
+        lt->heads[i] = num_elements[i] > 0 ? arrays[i] : NULL;
+
+#define __BEFORE(A, B) __loser_tree_before(lt, A, B)
+    __KMERGE_BUILD(lt->tree, lt->win, k, __BEFORE);
+
+    while (lt->heads[lt->tree[0]] != NULL)
+    {
+        w = lt->tree[0];
+        __ASSIGN__(*_out, *(const BYTE *)lt->heads[w], size_of);
+        _out += size_of;
+
+        if (++pos[w] < num_elements[w])
+            lt->heads[w] = (const BYTE *)lt->heads[w] + size_of;
+        else
+            lt->heads[w] = NULL;
+
+        __KMERGE_REPLAY(lt->tree, k, __BEFORE);
+    }
+#undef __BEFORE
+
+    FREE(pos);
+    loser_tree_destroy(lt);
+
+    return 0;
+}
+
+/*
+    Typed merge, keys of heads are kept in tree, so match is inlined compare
+
+    PARAMS
+    @IN NAME - name of function
+    @IN TYPE - type of element
+*/
+#define KMERGE_TYPED(NAME, TYPE) \
+int NAME(TYPE *out, const TYPE * const *arrays, const size_t *num_elements, size_t k) \
+{ \
+    TYPE *keys; \
+    size_t *tree; \
+    size_t *pos; \
+    bool *done; \
+    size_t total = 0; \
+    size_t i; \
+    size_t w; \
+    \
+    TRACE(); \
+    \
+    if (__kmerge_check((const void *)out, (const void *)arrays, num_elements, k)) \
+        ERROR("Invalid params\n", 1); \
+    \
+    keys = (TYPE *)malloc(k * sizeof(TYPE)); \
+    tree = (size_t *)malloc(3 * k * sizeof(size_t)); \
+    pos = (size_t *)calloc(k, sizeof(size_t)); \
+    done = (bool *)malloc(k * sizeof(bool)); \
+    if (keys == NULL || tree == NULL || pos == NULL || done == NULL) \
+    { \
+        FREE(keys); \
+        FREE(tree); \
+        FREE(pos); \
+        FREE(done); \
+        ERROR("malloc error\n", 1); \
+    } \
+    \
+    for (i = 0; i < k; ++i) \
+    { \
+        done[i] = num_elements[i] == 0; \
+        keys[i] = done[i] ? (TYPE)0 : arrays[i][0]; \
+        total += num_elements[i]; \
+    } \
+    \
+    /* empty source loses, on equal keys lower index wins */ \
+    __KMERGE_BUILD(tree, tree + k, k, __KMERGE_TYPED_BEFORE); \
+    \
+    for (i = 0; i < total; ++i) \
+    { \
+        w = tree[0]; \
+        out[i] = keys[w]; \
+        \
+        if (likely(++pos[w] < num_elements[w])) \
+            keys[w] = arrays[w][pos[w]]; \
+        else \
+            done[w] = true; \
+        \
+        __KMERGE_REPLAY(tree, k, __KMERGE_TYPED_BEFORE); \
+    } \
+    \
+    FREE(keys); \
+    FREE(tree); \
+    FREE(pos); \
+    FREE(done); \
+    \
+    return 0; \
+}
+
+#define __KMERGE_TYPED_BEFORE(A, B) \
+    (!done[A] && (done[B] || keys[A] < keys[B] || (keys[A] == keys[B] && (A) < (B))))
+
+KMERGE_TYPED(kmerge_int, int)
+KMERGE_TYPED(kmerge_uint, unsigned int)
+KMERGE_TYPED(kmerge_long, long)
+KMERGE_TYPED(kmerge_ulong, unsigned long)
@@ -202,8 +202,12 @@ static int __list_delete(List * ___restrict___ list, const void * ___restrict___
             list_node_destroy(list->head);
             list->head = ptr;
 
+            /* the only node was deleted, tail is freed too */
             if (ptr == guard)
+            {
                 list->head = NULL;
+                list->tail = NULL;
+            }
         }
         else
         {
@@ -227,7 +231,9 @@ static int __list_delete(List * ___restrict___ list, const void * ___restrict___
 
     list_node_destroy(guard);
 
-    list->tail->next = NULL;
+    if (list->tail != NULL)
+        list->tail->next = NULL;
+
     --list->length;
 
     if (list->length == 0)
@@ -293,8 +299,12 @@ static int __list_delete_all(List * ___restrict___ list, const void * ___restric
                 ++deleted;
             }
 
+            /* all nodes were deleted, tail is freed too */
             if (ptr == guard)
+            {
                 list->head = NULL;
+                list->tail = NULL;
+            }
         }
         else
         {
@@ -325,7 +335,8 @@ static int __list_delete_all(List * ___restrict___ list, const void * ___restric
 	}
 
     list_node_destroy(guard);
-    list->tail->next = NULL;
+    if (list->tail != NULL)
+        list->tail->next = NULL;
 
     list->length -= deleted;
 
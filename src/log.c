@@ -6,28 +6,2029 @@
 #include <string.h> 	/* strlen, SSE  */
 #include <fcntl.h>
 #include <compiler.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>		/* STDERR_FILENO */
+#include <sys/uio.h>	/* writev */
+#include <sys/mman.h>	/* mmap */
+#include <sys/syscall.h>	/* SYS_gettid */
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>	/* __rdtsc */
+#endif
 
 static ___unused___ FILE *logfd = NULL;
 static ___unused___ FILE *logfile = NULL;
 static ___unused___ const char * const logdir = "./logs";
 
-FILE *log_get_fd(void)
+FILE *log_get_fd(void)
+{
+	return logfd;
+}
+
+FILE *log_get_file(void)
+{
+	return logfile;
+}
+
+#define LOGBUF_SIZE	128
+
+/*
+	Count bytes written to log file and rotate it when it is too big
+
+	PARAMS
+	@IN bytes - bytes written to file
+
+	RETURN
+	This is a void function
+*/
+static void __log_file_written(size_t bytes);
+
+/*
+	Async backend
+
+	Each thread owns a ring (single producer), flusher thread is the only consumer.
+	Producer stores format pointer + raw arguments (strings are copied, TRACE strings are static),
+	formatting and writing is done by flusher in batches (writev per sink)
+*/
+
+#define LOG_ASYNC_MIN_RING_SIZE		((size_t)1 << 14)
+#define LOG_ASYNC_DEFAULT_RING_SIZE	((size_t)1 << 20)
+#define LOG_ASYNC_MAX_ARGS			16
+#define LOG_ASYNC_MAX_TEXT			1024	/* copied strings / preformatted message per record */
+#define LOG_ASYNC_MAX_LINE			4096	/* formatted message is truncated to this size */
+#define LOG_ASYNC_SPEC_SIZE			32
+#define LOG_ASYNC_ALIGN				16
+#define LOG_ASYNC_CACHELINE			64
+#define LOG_ASYNC_BATCH_SIZE		((size_t)1 << 16)
+#define LOG_ASYNC_IOV_MAX			64
+#define LOG_ASYNC_IDLE_NS			1000000L
+#define LOG_ASYNC_WAIT_NS			10000L
+#define LOG_ASYNC_FMT_CACHE			64		/* power of 2 */
+
+#define LOG_ASYNC_SINK_CONSOLE		0
+#define LOG_ASYNC_SINK_FILE			1
+#define LOG_ASYNC_SINKS				2
+
+#define LOG_ASYNC_RECORD_ALIGN(size) (((size) + LOG_ASYNC_ALIGN - 1) & ~((size_t)LOG_ASYNC_ALIGN - 1))
+
+/* snprintf with 0, 1 or 2 '*' arguments before value */
+#define LOG_ASYNC_SNPRINTF(buf, size, spec, stars, w, val) \
+	((stars) == 0 ? snprintf(buf, size, spec, val) : \
+	 (stars) == 1 ? snprintf(buf, size, spec, (w)[0], val) : \
+	 snprintf(buf, size, spec, (w)[0], (w)[1], val))
+
+typedef enum log_async_kind
+{
+	LOG_ASYNC_KIND_PAD = 0,	/* skip to the ring begining */
+	LOG_ASYNC_KIND_LOG,
+	LOG_ASYNC_KIND_TRACE,
+	LOG_ASYNC_KIND_ERROR
+} log_async_kind;
+
+typedef enum log_async_arg_type
+{
+	LOG_ASYNC_ARG_NONE = 0, /* %% */
+	LOG_ASYNC_ARG_INT,
+	LOG_ASYNC_ARG_LONG,
+	LOG_ASYNC_ARG_LLONG,
+	LOG_ASYNC_ARG_INTMAX,
+	LOG_ASYNC_ARG_SIZE,
+	LOG_ASYNC_ARG_PTRDIFF,
+	LOG_ASYNC_ARG_DOUBLE,
+	LOG_ASYNC_ARG_PTR,
+	LOG_ASYNC_ARG_STR,			/* string copied to record */
+	LOG_ASYNC_ARG_STR_STATIC,	/* only pointer is kept */
+	LOG_ASYNC_ARG_UNSUPPORTED
+} log_async_arg_type;
+
+/* int types by length modifier: none, hh / h, l, ll, j, z, t, L */
+static const uint8_t log_async_int_types[] =
+{
+	LOG_ASYNC_ARG_INT, LOG_ASYNC_ARG_INT, LOG_ASYNC_ARG_LONG, LOG_ASYNC_ARG_LLONG,
+	LOG_ASYNC_ARG_INTMAX, LOG_ASYNC_ARG_SIZE, LOG_ASYNC_ARG_PTRDIFF, LOG_ASYNC_ARG_UNSUPPORTED
+};
+
+typedef union Log_async_arg
+{
+	int			i;
+	long		l;
+	long long	ll;
+	intmax_t	im;
+	size_t		sz;		/* also offset of copied string in record text */
+	ptrdiff_t	pd;
+	double		d;
+	const void	*p;
+} Log_async_arg;
+
+/*
+	Record in ring, aligned to LOG_ASYNC_ALIGN
+	Header is followed by args[nargs], types[nargs] and text[text_len]
+*/
+typedef struct Log_async_record
+{
+	uint32_t	size;		/* whole record with padding */
+	uint8_t		kind;
+	uint8_t		nargs;
+	uint16_t	text_len;
+	const char	*fmt;		/* NULL iff text is preformatted message */
+} Log_async_record;
+
+typedef struct Log_async_spec
+{
+	const char	*begin;		/* '%' */
+	const char	*end;		/* after conversion char */
+	int			stars;		/* number of '*' int arguments before value */
+	int			type;
+} Log_async_spec;
+
+/* Argument types of format, parsed once per thread */
+typedef struct Log_async_fmt
+{
+	const char	*fmt;
+	uint8_t		nargs;
+	uint8_t		preformat;	/* format can't be deferred */
+	uint8_t		types[LOG_ASYNC_MAX_ARGS];
+} Log_async_fmt;
+
+typedef struct Log_async_ring
+{
+	char					*buf;
+	size_t					mask;
+	struct Log_async_ring	*next;
+	int						dead;	/* owner thread exited, ring can be reused */
+
+	/* producer cache line */
+	size_t					head ___align___(LOG_ASYNC_CACHELINE);
+	size_t					tail_cache;
+
+	/* flusher cache line */
+	size_t					tail ___align___(LOG_ASYNC_CACHELINE);
+	size_t					read;	/* formatted, but not written yet */
+} Log_async_ring;
+
+typedef struct Log_async_batch
+{
+	char			buf[LOG_ASYNC_BATCH_SIZE];
+	size_t			len;
+	struct iovec	iov[LOG_ASYNC_SINKS][LOG_ASYNC_IOV_MAX];
+	int				iovcnt[LOG_ASYNC_SINKS];
+} Log_async_batch;
+
+static int log_async_enabled = 0;
+static int log_async_stop = 0;
+static int log_async_policy = LOG_ASYNC_DROP;
+static unsigned log_async_gen = 0;
+static size_t log_async_ring_size = 0;
+static size_t log_async_dropped = 0;
+static int log_async_fd[LOG_ASYNC_SINKS] = {-1, -1};
+static int log_async_console_all = 0; /* console gets all records, not only errors */
+static Log_async_ring *log_async_rings = NULL;
+static pthread_t log_async_thread;
+static pthread_key_t log_async_key;
+
+#if defined(DEBUG_MODE) || defined(TRACE_MODE) || !defined(SILENT_ERROR)
+static __thread Log_async_ring *log_async_tls_ring = NULL;
+static __thread unsigned log_async_tls_gen = 0;
+static __thread Log_async_fmt log_async_fmt_cache[LOG_ASYNC_FMT_CACHE];
+#endif
+
+/*
+	Sleep for @ns nanoseconds
+
+	PARAMS
+	@IN ns - nanoseconds
+
+	RETURN
+	This is a void function
+*/
+static void __log_async_sleep(long ns);
+
+/*
+	Parse first conversion spec in @fmt
+
+	PARAMS
+	@IN fmt - format
+	@OUT spec - parsed spec
+
+	RETURN
+	0 iff spec has been found
+	1 iff there is no more specs
+	-1 iff spec is not supported by deferred formatting
+*/
+static int __log_async_parse_spec(const char *fmt, Log_async_spec *spec);
+
+/*
+	Mark ring of exiting thread as dead (pthread key destructor)
+
+	PARAMS
+	@IN arg - ring
+
+	RETURN
+	This is a void function
+*/
+static void __log_async_thread_exit(void *arg);
+
+/* producer side is used only by enabled LOG / TRACE / ERROR */
+#if defined(DEBUG_MODE) || defined(TRACE_MODE) || !defined(SILENT_ERROR)
+
+/*
+	Get ring of calling thread, reuse dead ring or create new one
+
+	PARAMS
+	NO PARAMS
+
+	RETURN
+	NULL iff failure
+	Pointer to ring iff success
+*/
+static Log_async_ring *__log_async_get_ring(void);
+
+/*
+	Reserve contiguous @size bytes in ring (padding record is written when needed)
+
+	PARAMS
+	@IN ring - ring
+	@IN size - size of record
+	@OUT total - bytes to publish (with padding)
+
+	RETURN
+	NULL iff record has been dropped
+	Pointer to record iff success
+*/
+static char *__log_async_reserve(Log_async_ring *ring, size_t size, size_t *total);
+
+/*
+	Get argument types of format from cache of calling thread (parse format on miss)
+
+	PARAMS
+	@IN fmt - format (static)
+
+	RETURN
+	Pointer to cache entry
+*/
+static const Log_async_fmt *__log_async_get_fmt(const char *fmt);
+
+/*
+	Store message in calling thread ring
+
+	PARAMS
+	@IN kind - record kind
+	@IN fmt - format
+	@IN args - arguments
+
+	RETURN
+	This is a void function
+*/
+static void __log_async_push(int kind, const char *fmt, va_list args);
+#endif
+
+/*
+	Write all iovecs to fd, handle partial writes
+
+	PARAMS
+	@IN fd - file descriptor
+	@IN iov - iovecs
+	@IN cnt - number of iovecs
+
+	RETURN
+	This is a void function
+*/
+static void __log_async_writev(int fd, struct iovec *iov, int cnt);
+
+/*
+	Write batch to sinks and release written records
+
+	PARAMS
+	@IN batch - batch
+
+	RETURN
+	This is a void function
+*/
+static void __log_async_batch_write(Log_async_batch *batch);
+
+/*
+	Format record and append it to batch
+
+	PARAMS
+	@IN rec - record
+	@IN batch - batch
+
+	RETURN
+	This is a void function
+*/
+static void __log_async_format(const Log_async_record *rec, Log_async_batch *batch);
+
+/*
+	Format all published records from ring
+
+	PARAMS
+	@IN ring - ring
+	@IN batch - batch
+
+	RETURN
+	Number of formatted records
+*/
+static size_t __log_async_drain(Log_async_ring *ring, Log_async_batch *batch);
+
+/*
+	Flusher thread main
+
+	PARAMS
+	@IN arg - unused
+
+	RETURN
+	NULL
+*/
+static void *__log_async_flusher(void *arg);
+
+static void __log_async_sleep(long ns)
+{
+	struct timespec ts;
+
+	ts.tv_sec = 0;
+	ts.tv_nsec = ns;
+	(void)nanosleep(&ts, NULL);
+}
+
+static int __log_async_parse_spec(const char *fmt, Log_async_spec *spec)
+{
+	const char *p;
+	int len_mod = 0;
+	int precision = 0;
+
+	p = strchr(fmt, '%');
+	if (p == NULL)
+		return 1;
+
+	spec->begin = p++;
+	spec->stars = 0;
+	spec->type = LOG_ASYNC_ARG_UNSUPPORTED;
+
+	while (*p != '\0' && strchr("-+ #0'", *p) != NULL)
+		++p;
+
+	if (*p == '*')
+	{
+		++spec->stars;
+		++p;
+	}
+	else
+		while (*p >= '0' && *p <= '9')
+			++p;
+
+	if (*p == '.')
+	{
+		precision = 1;
+		++p;
+		if (*p == '*')
+		{
+			++spec->stars;
+			++p;
+		}
+		else
+			while (*p >= '0' && *p <= '9')
+				++p;
+	}
+
+	switch (*p)
+	{
+		case 'h':
+		{
+			len_mod = 1;
+			if (*++p == 'h')
+				++p;
+			break;
+		}
+		case 'l':
+		{
+			len_mod = 2;
+			if (*++p == 'l')
+			{
+				len_mod = 3;
+				++p;
+			}
+			break;
+		}
+		case 'q':
+		{
+			len_mod = 3;
+			++p;
+			break;
+		}
+		case 'j':
+		{
+			len_mod = 4;
+			++p;
+			break;
+		}
+		case 'z':
+		{
+			len_mod = 5;
+			++p;
+			break;
+		}
+		case 't':
+		{
+			len_mod = 6;
+			++p;
+			break;
+		}
+		case 'L':
+		{
+			len_mod = 7;
+			++p;
+			break;
+		}
+		default:
+		{
+			break;
+		}
+	}
+
+	if (*p == '\0')
+		return -1;
+
+	spec->end = p + 1;
+	if (spec->end - spec->begin >= LOG_ASYNC_SPEC_SIZE)
+		return -1;
+
+	switch (*p)
+	{
+		case 'd':
+		case 'i':
+		case 'o':
+		case 'u':
+		case 'x':
+		case 'X':
+		{
+			spec->type = log_async_int_types[len_mod];
+			break;
+		}
+		case 'c':
+		{
+			if (len_mod == 0)
+				spec->type = LOG_ASYNC_ARG_INT;
+			break;
+		}
+		case 'e':
+		case 'E':
+		case 'f':
+		case 'F':
+		case 'g':
+		case 'G':
+		case 'a':
+		case 'A':
+		{
+			if (len_mod == 0 || len_mod == 2)
+				spec->type = LOG_ASYNC_ARG_DOUBLE;
+			break;
+		}
+		case 's':
+		{
+			/* with precision string can be not terminated, so can't be copied */
+			if (len_mod == 0 && !precision)
+				spec->type = LOG_ASYNC_ARG_STR;
+			break;
+		}
+		case 'p':
+		{
+			spec->type = LOG_ASYNC_ARG_PTR;
+			break;
+		}
+		case '%':
+		{
+			spec->type = LOG_ASYNC_ARG_NONE;
+			break;
+		}
+		default:
+		{
+			break;
+		}
+	}
+
+	return spec->type == LOG_ASYNC_ARG_UNSUPPORTED ? -1 : 0;
+}
+
+static void __log_async_thread_exit(void *arg)
+{
+	__atomic_store_n(&((Log_async_ring *)arg)->dead, 1, __ATOMIC_RELEASE);
+}
+
+#if defined(DEBUG_MODE) || defined(TRACE_MODE) || !defined(SILENT_ERROR)
+
+static Log_async_ring *__log_async_get_ring(void)
+{
+	Log_async_ring *ring;
+	unsigned gen;
+	int expected;
+	void *ptr;
+
+	gen = __atomic_load_n(&log_async_gen, __ATOMIC_ACQUIRE);
+	if (likely(log_async_tls_ring != NULL && log_async_tls_gen == gen))
+		return log_async_tls_ring;
+
+	/* try to reuse ring of exited thread */
+	for (ring = __atomic_load_n(&log_async_rings, __ATOMIC_ACQUIRE); ring != NULL; ring = ring->next)
+	{
+		expected = 1;
+		if (__atomic_load_n(&ring->dead, __ATOMIC_RELAXED) &&
+			__atomic_compare_exchange_n(&ring->dead, &expected, 0, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+			break;
+	}
+
+	if (ring == NULL)
+	{
+		if (posix_memalign(&ptr, LOG_ASYNC_CACHELINE, sizeof(Log_async_ring)))
+			return NULL;
+
+		ring = (Log_async_ring *)ptr;
+		(void)memset(ring, 0, sizeof(*ring));
+		ring->buf = (char *)malloc(log_async_ring_size);
+		if (ring->buf == NULL)
+		{
+			free(ring);
+			return NULL;
+		}
+
+		ring->mask = log_async_ring_size - 1;
+
+		ring->next = __atomic_load_n(&log_async_rings, __ATOMIC_RELAXED);
+		while (!__atomic_compare_exchange_n(&log_async_rings, &ring->next, ring, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+			;
+	}
+
+	(void)pthread_setspecific(log_async_key, ring);
+	log_async_tls_ring = ring;
+	log_async_tls_gen = gen;
+
+	return ring;
+}
+
+static char *__log_async_reserve(Log_async_ring *ring, size_t size, size_t *total)
+{
+	const size_t capacity = ring->mask + 1;
+	size_t pos = ring->head & ring->mask;
+	size_t contig = capacity - pos;
+	size_t needed = size <= contig ? size : size + contig;
+	Log_async_record *pad;
+
+	while (needed > capacity - (ring->head - ring->tail_cache))
+	{
+		ring->tail_cache = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+		if (needed <= capacity - (ring->head - ring->tail_cache))
+			break;
+
+		if (log_async_policy == LOG_ASYNC_DROP)
+		{
+			(void)__atomic_fetch_add(&log_async_dropped, 1, __ATOMIC_RELAXED);
+			return NULL;
+		}
+
+		__log_async_sleep(LOG_ASYNC_WAIT_NS);
+	}
+
+	/* record can't be splitted, so skip end of ring */
+	if (size > contig)
+	{
+		pad = (Log_async_record *)(void *)(ring->buf + pos);
+		pad->size = (uint32_t)contig;
+		pad->kind = LOG_ASYNC_KIND_PAD;
+		pos = 0;
+	}
+
+	*total = needed;
+
+	return ring->buf + pos;
+}
+
+static const Log_async_fmt *__log_async_get_fmt(const char *fmt)
+{
+	Log_async_fmt *entry;
+	Log_async_spec spec;
+	const char *p = fmt;
+	size_t nargs = 0;
+	int i;
+	int ret;
+
+	entry = &log_async_fmt_cache[((uintptr_t)fmt >> 3) & (LOG_ASYNC_FMT_CACHE - 1)];
+	if (likely(entry->fmt == fmt))
+		return entry;
+
+	entry->preformat = 0;
+	for (;;)
+	{
+		ret = __log_async_parse_spec(p, &spec);
+		if (ret == 1)
+			break;
+
+		if (ret == -1 || nargs + (size_t)spec.stars + 1 > LOG_ASYNC_MAX_ARGS)
+		{
+			entry->preformat = 1;
+			break;
+		}
+
+		p = spec.end;
+		if (spec.type == LOG_ASYNC_ARG_NONE)
+			continue;
+
+		for (i = 0; i < spec.stars; ++i)
+			entry->types[nargs++] = LOG_ASYNC_ARG_INT;
+
+		entry->types[nargs++] = (uint8_t)spec.type;
+	}
+
+	entry->nargs = (uint8_t)nargs;
+	entry->fmt = fmt;
+
+	return entry;
+}
+
+static void __log_async_push(int kind, const char *fmt, va_list args)
+{
+	const Log_async_fmt *entry;
+	Log_async_ring *ring;
+	Log_async_record *rec;
+	Log_async_arg vals[LOG_ASYNC_MAX_ARGS];
+	uint8_t types[LOG_ASYNC_MAX_ARGS];
+	const char *strs[LOG_ASYNC_MAX_ARGS];
+	size_t lens[LOG_ASYNC_MAX_ARGS];
+	Log_async_arg *rec_vals;
+	uint8_t *rec_types;
+	char *text;
+	const char *s;
+	size_t nargs;
+	size_t text_len = 0;
+	size_t size;
+	size_t total;
+	size_t i;
+	int ret;
+	int preformat;
+	va_list copy;
+	va_list size_copy;
+
+	/* nothing will be written */
+	if (kind != LOG_ASYNC_KIND_ERROR && !log_async_console_all && __atomic_load_n(&log_async_fd[LOG_ASYNC_SINK_FILE], __ATOMIC_RELAXED) == -1)
+		return;
+
+	ring = __log_async_get_ring();
+	if (ring == NULL)
+		return;
+
+	entry = __log_async_get_fmt(fmt);
+	nargs = entry->nargs;
+	preformat = entry->preformat;
+
+	va_copy(copy, args);
+	for (i = 0; i < nargs && !preformat; ++i)
+	{
+		types[i] = entry->types[i];
+		switch (types[i])
+		{
+			case LOG_ASYNC_ARG_INT:
+			{
+				vals[i].i = va_arg(args, int);
+				break;
+			}
+			case LOG_ASYNC_ARG_LONG:
+			{
+				vals[i].l = va_arg(args, long);
+				break;
+			}
+			case LOG_ASYNC_ARG_LLONG:
+			{
+				vals[i].ll = va_arg(args, long long);
+				break;
+			}
+			case LOG_ASYNC_ARG_INTMAX:
+			{
+				vals[i].im = va_arg(args, intmax_t);
+				break;
+			}
+			case LOG_ASYNC_ARG_SIZE:
+			{
+				vals[i].sz = va_arg(args, size_t);
+				break;
+			}
+			case LOG_ASYNC_ARG_PTRDIFF:
+			{
+				vals[i].pd = va_arg(args, ptrdiff_t);
+				break;
+			}
+			case LOG_ASYNC_ARG_DOUBLE:
+			{
+				vals[i].d = va_arg(args, double);
+				break;
+			}
+			case LOG_ASYNC_ARG_PTR:
+			{
+				vals[i].p = va_arg(args, const void *);
+				break;
+			}
+			case LOG_ASYNC_ARG_STR:
+			{
+				s = va_arg(args, const char *);
+				if (s == NULL)
+					s = "(null)";
+
+				/* TRACE passes only file and function names, they live forever */
+				if (kind == LOG_ASYNC_KIND_TRACE)
+				{
+					types[i] = LOG_ASYNC_ARG_STR_STATIC;
+					vals[i].p = s;
+					break;
+				}
+
+				if (text_len == LOG_ASYNC_MAX_TEXT)
+				{
+					preformat = 1;
+					break;
+				}
+
+				strs[i] = s;
+				lens[i] = strnlen(s, LOG_ASYNC_MAX_TEXT - text_len - 1);
+				vals[i].sz = text_len;
+				text_len += lens[i] + 1;
+				break;
+			}
+			default:
+			{
+				preformat = 1;
+				break;
+			}
+		}
+	}
+
+	if (preformat)
+	{
+		va_copy(size_copy, copy);
+		ret = vsnprintf(NULL, 0, fmt, size_copy);
+		va_end(size_copy);
+		if (ret < 0)
+		{
+			va_end(copy);
+			return;
+		}
+
+		nargs = 0;
+		text_len = (size_t)ret + 1 < LOG_ASYNC_MAX_TEXT ? (size_t)ret + 1 : LOG_ASYNC_MAX_TEXT;
+	}
+
+	size = LOG_ASYNC_RECORD_ALIGN(sizeof(Log_async_record) + nargs * (sizeof(Log_async_arg) + sizeof(uint8_t)) + text_len);
+	rec = (Log_async_record *)(void *)__log_async_reserve(ring, size, &total);
+	if (rec == NULL)
+	{
+		va_end(copy);
+		return;
+	}
+
+	rec->size = (uint32_t)size;
+	rec->kind = (uint8_t)kind;
+	rec->nargs = (uint8_t)nargs;
+	rec->text_len = (uint16_t)text_len;
+	rec->fmt = preformat ? NULL : fmt;
+
+	rec_vals = (Log_async_arg *)(void *)(rec + 1);
+	rec_types = (uint8_t *)(rec_vals + nargs);
+	text = (char *)(rec_types + nargs);
+
+	if (preformat)
+		(void)vsnprintf(text, text_len, fmt, copy);
+	else
+	{
+		for (i = 0; i < nargs; ++i)
+		{
+			rec_vals[i] = vals[i];
+			rec_types[i] = types[i];
+			if (types[i] == LOG_ASYNC_ARG_STR)
+			{
+				(void)memcpy(text + vals[i].sz, strs[i], lens[i]);
+				text[vals[i].sz + lens[i]] = '\0';
+			}
+		}
+	}
+
+	va_end(copy);
+
+	__atomic_store_n(&ring->head, ring->head + total, __ATOMIC_RELEASE);
+}
+#endif
+
+static void __log_async_writev(int fd, struct iovec *iov, int cnt)
+{
+	ssize_t ret;
+
+	while (cnt > 0)
+	{
+		ret = writev(fd, iov, cnt);
+		if (ret < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			return;
+		}
+
+		while (cnt > 0 && (size_t)ret >= iov->iov_len)
+		{
+			ret -= (ssize_t)iov->iov_len;
+			++iov;
+			--cnt;
+		}
+
+		if (cnt > 0)
+		{
+			iov->iov_base = (char *)iov->iov_base + ret;
+			iov->iov_len -= (size_t)ret;
+		}
+	}
+}
+
+static void __log_async_batch_write(Log_async_batch *batch)
+{
+	Log_async_ring *ring;
+	size_t bytes = 0;
+	int i;
+
+	/* writev consumes iov, so count file bytes before */
+	for (i = 0; i < batch->iovcnt[LOG_ASYNC_SINK_FILE]; ++i)
+		bytes += batch->iov[LOG_ASYNC_SINK_FILE][i].iov_len;
+
+	for (i = 0; i < LOG_ASYNC_SINKS; ++i)
+	{
+		if (batch->iovcnt[i] > 0)
+			__log_async_writev(log_async_fd[i], batch->iov[i], batch->iovcnt[i]);
+
+		batch->iovcnt[i] = 0;
+	}
+
+	if (bytes > 0)
+		__log_file_written(bytes);
+
+	batch->len = 0;
+
+	/* everything formatted is written now, so producers can reuse space */
+	for (ring = __atomic_load_n(&log_async_rings, __ATOMIC_ACQUIRE); ring != NULL; ring = ring->next)
+		__atomic_store_n(&ring->tail, ring->read, __ATOMIC_RELEASE);
+}
+
+static void __log_async_format(const Log_async_record *rec, Log_async_batch *batch)
+{
+	const Log_async_arg *vals;
+	const uint8_t *types;
+	const char *text;
+	const char *p;
+	char *out = batch->buf + batch->len;
+	char spec_buf[LOG_ASYNC_SPEC_SIZE];
+	Log_async_spec spec;
+	Log_async_arg val;
+	size_t len = 0;
+	size_t n;
+	size_t arg = 0;
+	int w[2] = {0, 0};
+	int ret;
+	int i;
+	int sinks[LOG_ASYNC_SINKS];
+	struct iovec *iov;
+
+	if (rec->fmt == NULL)
+	{
+		len = strlen((const char *)(rec + 1));
+		(void)memcpy(out, rec + 1, len);
+	}
+	else
+	{
+		vals = (const Log_async_arg *)(const void *)(rec + 1);
+		types = (const uint8_t *)(vals + rec->nargs);
+		text = (const char *)(types + rec->nargs);
+		p = rec->fmt;
+
+		/* the same parser as in producer, so specs and args match */
+		while (__log_async_parse_spec(p, &spec) == 0)
+		{
+			n = (size_t)(spec.begin - p);
+			n = n < LOG_ASYNC_MAX_LINE - 1 - len ? n : LOG_ASYNC_MAX_LINE - 1 - len;
+			(void)memcpy(out + len, p, n);
+			len += n;
+			p = spec.end;
+
+			if (spec.type == LOG_ASYNC_ARG_NONE)
+			{
+				if (len < LOG_ASYNC_MAX_LINE - 1)
+					out[len++] = '%';
+
+				continue;
+			}
+
+			for (i = 0; i < spec.stars; ++i)
+				w[i] = vals[arg++].i;
+
+			n = (size_t)(spec.end - spec.begin);
+			(void)memcpy(spec_buf, spec.begin, n);
+			spec_buf[n] = '\0';
+
+			val = vals[arg];
+			switch (types[arg])
+			{
+				case LOG_ASYNC_ARG_INT:
+				{
+					ret = LOG_ASYNC_SNPRINTF(out + len, LOG_ASYNC_MAX_LINE - len, spec_buf, spec.stars, w, val.i);
+					break;
+				}
+				case LOG_ASYNC_ARG_LONG:
+				{
+					ret = LOG_ASYNC_SNPRINTF(out + len, LOG_ASYNC_MAX_LINE - len, spec_buf, spec.stars, w, val.l);
+					break;
+				}
+				case LOG_ASYNC_ARG_LLONG:
+				{
+					ret = LOG_ASYNC_SNPRINTF(out + len, LOG_ASYNC_MAX_LINE - len, spec_buf, spec.stars, w, val.ll);
+					break;
+				}
+				case LOG_ASYNC_ARG_INTMAX:
+				{
+					ret = LOG_ASYNC_SNPRINTF(out + len, LOG_ASYNC_MAX_LINE - len, spec_buf, spec.stars, w, val.im);
+					break;
+				}
+				case LOG_ASYNC_ARG_SIZE:
+				{
+					ret = LOG_ASYNC_SNPRINTF(out + len, LOG_ASYNC_MAX_LINE - len, spec_buf, spec.stars, w, val.sz);
+					break;
+				}
+				case LOG_ASYNC_ARG_PTRDIFF:
+				{
+					ret = LOG_ASYNC_SNPRINTF(out + len, LOG_ASYNC_MAX_LINE - len, spec_buf, spec.stars, w, val.pd);
+					break;
+				}
+				case LOG_ASYNC_ARG_DOUBLE:
+				{
+					ret = LOG_ASYNC_SNPRINTF(out + len, LOG_ASYNC_MAX_LINE - len, spec_buf, spec.stars, w, val.d);
+					break;
+				}
+				case LOG_ASYNC_ARG_PTR:
+				{
+					ret = LOG_ASYNC_SNPRINTF(out + len, LOG_ASYNC_MAX_LINE - len, spec_buf, spec.stars, w, val.p);
+					break;
+				}
+				case LOG_ASYNC_ARG_STR:
+				{
+					ret = LOG_ASYNC_SNPRINTF(out + len, LOG_ASYNC_MAX_LINE - len, spec_buf, spec.stars, w, text + val.sz);
+					break;
+				}
+				case LOG_ASYNC_ARG_STR_STATIC:
+				{
+					ret = LOG_ASYNC_SNPRINTF(out + len, LOG_ASYNC_MAX_LINE - len, spec_buf, spec.stars, w, (const char *)val.p);
+					break;
+				}
+				default:
+				{
+					ret = 0;
+					break;
+				}
+			}
+
+			++arg;
+			if (ret > 0)
+				len += (size_t)ret < LOG_ASYNC_MAX_LINE - len ? (size_t)ret : LOG_ASYNC_MAX_LINE - 1 - len;
+		}
+
+		n = strlen(p);
+		n = n < LOG_ASYNC_MAX_LINE - 1 - len ? n : LOG_ASYNC_MAX_LINE - 1 - len;
+		(void)memcpy(out + len, p, n);
+		len += n;
+	}
+
+	if (len == 0)
+		return;
+
+	sinks[LOG_ASYNC_SINK_CONSOLE] = rec->kind == LOG_ASYNC_KIND_ERROR || log_async_console_all;
+	sinks[LOG_ASYNC_SINK_FILE] = log_async_fd[LOG_ASYNC_SINK_FILE] != -1;
+
+	for (i = 0; i < LOG_ASYNC_SINKS; ++i)
+	{
+		if (!sinks[i])
+			continue;
+
+		/* glue with previous message if possible */
+		if (batch->iovcnt[i] > 0)
+		{
+			iov = &batch->iov[i][batch->iovcnt[i] - 1];
+			if ((char *)iov->iov_base + iov->iov_len == out)
+			{
+				iov->iov_len += len;
+				continue;
+			}
+		}
+
+		iov = &batch->iov[i][batch->iovcnt[i]++];
+		iov->iov_base = out;
+		iov->iov_len = len;
+	}
+
+	batch->len += len;
+}
+
+static size_t __log_async_drain(Log_async_ring *ring, Log_async_batch *batch)
+{
+	const Log_async_record *rec;
+	size_t head;
+	size_t num = 0;
+
+	head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+	while (ring->read != head)
+	{
+		rec = (const Log_async_record *)(const void *)(ring->buf + (ring->read & ring->mask));
+		if (rec->kind != LOG_ASYNC_KIND_PAD)
+		{
+			if (LOG_ASYNC_BATCH_SIZE - batch->len < LOG_ASYNC_MAX_LINE ||
+				batch->iovcnt[LOG_ASYNC_SINK_CONSOLE] == LOG_ASYNC_IOV_MAX ||
+				batch->iovcnt[LOG_ASYNC_SINK_FILE] == LOG_ASYNC_IOV_MAX)
+				__log_async_batch_write(batch);
+
+			__log_async_format(rec, batch);
+			++num;
+		}
+
+		ring->read += rec->size;
+	}
+
+	return num;
+}
+
+static void *__log_async_flusher(void *arg)
+{
+	static Log_async_batch batch;
+	Log_async_ring *ring;
+	size_t num;
+	int stop;
+
+	(void)arg;
+
+	batch.len = 0;
+	batch.iovcnt[LOG_ASYNC_SINK_CONSOLE] = 0;
+	batch.iovcnt[LOG_ASYNC_SINK_FILE] = 0;
+
+	for (;;)
+	{
+		/* read flag before draining, so nothing pushed before deinit is lost */
+		stop = __atomic_load_n(&log_async_stop, __ATOMIC_ACQUIRE);
+
+		num = 0;
+		for (ring = __atomic_load_n(&log_async_rings, __ATOMIC_ACQUIRE); ring != NULL; ring = ring->next)
+			num += __log_async_drain(ring, &batch);
+
+		__log_async_batch_write(&batch);
+
+		if (num == 0 && stop)
+			break;
+
+		/* don't chase producers, let them fill rings and take it in one batch */
+		__log_async_sleep(LOG_ASYNC_IDLE_NS);
+	}
+
+	return NULL;
+}
+
+int log_async_init(size_t ring_size, int policy)
+{
+	size_t size;
+
+	if (__atomic_load_n(&log_async_enabled, __ATOMIC_ACQUIRE))
+		return 1;
+
+	if (policy != LOG_ASYNC_DROP && policy != LOG_ASYNC_BLOCK)
+		return 1;
+
+	size = ring_size == 0 ? LOG_ASYNC_DEFAULT_RING_SIZE : ring_size;
+	if (size < LOG_ASYNC_MIN_RING_SIZE)
+		size = LOG_ASYNC_MIN_RING_SIZE;
+
+	/* power of 2 */
+	while (size & (size - 1))
+		size = (size | (size - 1)) + 1;
+
+	/* writes bypass stdio, so flush what is buffered now */
+	if (logfd != NULL)
+		(void)fflush(logfd);
+
+	if (logfile != NULL)
+		(void)fflush(logfile);
+
+	(void)fflush(stderr);
+
+	log_async_fd[LOG_ASYNC_SINK_CONSOLE] = logfd != NULL ? fileno(logfd) : STDERR_FILENO;
+	log_async_fd[LOG_ASYNC_SINK_FILE] = logfile != NULL ? fileno(logfile) : -1;
+	log_async_console_all = logfd != NULL;
+	log_async_policy = policy;
+	log_async_ring_size = size;
+	log_async_dropped = 0;
+	log_async_stop = 0;
+
+	if (pthread_key_create(&log_async_key, __log_async_thread_exit))
+		return 1;
+
+	/* rings cached by threads in previous session are not valid */
+	(void)__atomic_add_fetch(&log_async_gen, 1, __ATOMIC_RELEASE);
+
+	if (pthread_create(&log_async_thread, NULL, __log_async_flusher, NULL))
+	{
+		(void)pthread_key_delete(log_async_key);
+		return 1;
+	}
+
+	__atomic_store_n(&log_async_enabled, 1, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+void log_async_deinit(void)
+{
+	Log_async_ring *ring;
+	Log_async_ring *next;
+
+	if (!__atomic_load_n(&log_async_enabled, __ATOMIC_ACQUIRE))
+		return;
+
+	__atomic_store_n(&log_async_enabled, 0, __ATOMIC_RELEASE);
+	__atomic_store_n(&log_async_stop, 1, __ATOMIC_RELEASE);
+	(void)pthread_join(log_async_thread, NULL);
+	(void)pthread_key_delete(log_async_key);
+
+	for (ring = log_async_rings; ring != NULL; ring = next)
+	{
+		next = ring->next;
+		free(ring->buf);
+		free(ring);
+	}
+
+	log_async_rings = NULL;
+}
+
+int log_async_flush(void)
+{
+	Log_async_ring *ring;
+	size_t head;
+
+	if (!__atomic_load_n(&log_async_enabled, __ATOMIC_ACQUIRE))
+		return 1;
+
+	for (ring = __atomic_load_n(&log_async_rings, __ATOMIC_ACQUIRE); ring != NULL; ring = ring->next)
+	{
+		head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+		while (__atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) < head)
+			__log_async_sleep(LOG_ASYNC_WAIT_NS);
+	}
+
+	return 0;
+}
+
+size_t log_async_get_dropped(void)
+{
+	return __atomic_load_n(&log_async_dropped, __ATOMIC_RELAXED);
+}
+
+int log_async_is_enabled(void)
+{
+	return __atomic_load_n(&log_async_enabled, __ATOMIC_RELAXED);
+}
+
+/*
+	Runtime levels, rate limit and rotation
+*/
+
+#define LOG_MODULES_MAX				64
+#define LOG_MODULE_NAME_SIZE		32
+#define LOG_RATE_TOKEN				1000000ULL	/* one message in micro tokens */
+#define LOG_ROTATE_PATH_SIZE		(LOGBUF_SIZE + 12)	/* path + ".%u" */
+
+typedef struct Log_module
+{
+	char	name[LOG_MODULE_NAME_SIZE];
+	int		level;
+} Log_module;
+
+unsigned long __log_levels_gen__ = 1; /* sites start with key 0, so they are outdated */
+
+static pthread_mutex_t log_levels_mutex = PTHREAD_MUTEX_INITIALIZER;
+static Log_module log_modules[LOG_MODULES_MAX];
+static size_t log_num_modules = 0;
+static int log_default_level = LOG_LEVEL_DEFAULT;
+
+static unsigned log_rate_per_sec = 0;
+static unsigned log_rate_burst = 0;
+static size_t log_rate_limited = 0;
+
+static pthread_mutex_t log_rotate_mutex = PTHREAD_MUTEX_INITIALIZER;
+static char log_path[LOGBUF_SIZE] = {0};
+static size_t log_rotate_max_bytes = 0;
+static unsigned log_rotate_max_files = 0;
+static size_t log_file_bytes = 0;
+
+/*
+	Check if file matches module name (file name without extension)
+
+	PARAMS
+	@IN file - file path
+	@IN module - module name
+
+	RETURN
+	1 iff file matches module
+	0 iff not
+*/
+static int __log_module_match(const char *file, const char *module);
+
+/*
+	Get module name from file name (avl.c and avl is the same module)
+
+	PARAMS
+	@IN module - file name
+	@OUT name - module name (LOG_MODULE_NAME_SIZE bytes)
+
+	RETURN
+	0 iff success
+	Non-zero value iff failure
+*/
+static int __log_module_name(const char *module, char *name);
+
+/*
+	Find module in table, call with log_levels_mutex locked
+
+	PARAMS
+	@IN module - module name
+
+	RETURN
+	NULL iff module is not in table
+	Pointer to module iff success
+*/
+static Log_module *__log_module_find(const char *module);
+
+/*
+	Get level of site from table, default level or DEBUG_LVL of site
+
+	PARAMS
+	@IN site - LOG site
+
+	RETURN
+	Level of site
+*/
+static int __log_site_level(const Log_site *site);
+
+/*
+	Take token from site bucket, log number of suppressed messages if any
+
+	PARAMS
+	@IN site - LOG site
+
+	RETURN
+	1 iff message should be logged
+	0 iff message should be dropped
+*/
+static int __log_site_rate(Log_site *site);
+
+/*
+	Write message to log file
+
+	PARAMS
+	@IN msg - format
+	@IN args - arguments
+
+	RETURN
+	This is a void function
+*/
+static void __log_file_vprintf(const char *msg, va_list args);
+
+/*
+	Rotate log file, call with log_rotate_mutex locked
+
+	PARAMS
+	NO PARAMS
+
+	RETURN
+	This is a void function
+*/
+static void __log_rotate(void);
+
+static int __log_module_match(const char *file, const char *module)
+{
+	const char *name = strrchr(file, '/');
+	size_t len = strlen(module);
+
+	name = name == NULL ? file : name + 1;
+	if (strncmp(name, module, len) != 0)
+		return 0;
+
+	return name[len] == '\0' || name[len] == '.';
+}
+
+static int __log_module_name(const char *module, char *name)
+{
+	size_t len = strcspn(module, ".");
+
+	if (len == 0 || len >= LOG_MODULE_NAME_SIZE)
+		return 1;
+
+	(void)memcpy(name, module, len);
+	name[len] = '\0';
+
+	return 0;
+}
+
+static Log_module *__log_module_find(const char *module)
+{
+	size_t i;
+
+	for (i = 0; i < log_num_modules; ++i)
+		if (strcmp(log_modules[i].name, module) == 0)
+			return &log_modules[i];
+
+	return NULL;
+}
+
+static int __log_site_level(const Log_site *site)
+{
+	int level = site->level;
+	size_t i;
+
+	(void)pthread_mutex_lock(&log_levels_mutex);
+
+	if (log_default_level != LOG_LEVEL_DEFAULT)
+		level = log_default_level;
+
+	for (i = 0; i < log_num_modules; ++i)
+		if (__log_module_match(site->file, log_modules[i].name))
+		{
+			level = log_modules[i].level;
+			break;
+		}
+
+	(void)pthread_mutex_unlock(&log_levels_mutex);
+
+	if (level < 0)
+		return 0;
+
+	return level > LOG_LEVEL_MAX ? LOG_LEVEL_MAX : level;
+}
+
+static int __log_site_rate(Log_site *site)
+{
+	struct timespec ts;
+	uint64_t per_sec;
+	uint64_t max_tokens;
+	uint64_t refill_ns;
+	uint64_t now;
+	uint64_t elapsed;
+	uint64_t tokens;
+	unsigned suppressed;
+	const char *file;
+
+	per_sec = __atomic_load_n(&log_rate_per_sec, __ATOMIC_RELAXED);
+	if (per_sec == 0)
+		return 1;
+
+	max_tokens = (uint64_t)__atomic_load_n(&log_rate_burst, __ATOMIC_RELAXED) * LOG_RATE_TOKEN;
+
+	(void)clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+	now = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+
+	/* site is shared by threads, race only makes limit less accurate */
+	elapsed = now - __atomic_load_n(&site->last, __ATOMIC_RELAXED);
+	tokens = __atomic_load_n(&site->tokens, __ATOMIC_RELAXED);
+
+	/* per_sec tokens per 1e9 ns, so ns * per_sec / 1000 micro tokens */
+	refill_ns = max_tokens * 1000 / per_sec;
+	if (elapsed >= refill_ns)
+		tokens = max_tokens;
+	else
+		tokens += elapsed * per_sec / 1000;
+
+	if (tokens > max_tokens)
+		tokens = max_tokens;
+
+	__atomic_store_n(&site->last, now, __ATOMIC_RELAXED);
+
+	if (tokens < LOG_RATE_TOKEN)
+	{
+		__atomic_store_n(&site->tokens, tokens, __ATOMIC_RELAXED);
+		(void)__atomic_add_fetch(&site->suppressed, 1, __ATOMIC_RELAXED);
+		(void)__atomic_add_fetch(&log_rate_limited, 1, __ATOMIC_RELAXED);
+		return 0;
+	}
+
+	__atomic_store_n(&site->tokens, tokens - LOG_RATE_TOKEN, __ATOMIC_RELAXED);
+
+	suppressed = __atomic_exchange_n(&site->suppressed, 0, __ATOMIC_RELAXED);
+	if (suppressed > 0)
+	{
+		file = strrchr(site->file, '/');
+		__log__("[LOG]\t%s.%d\tsuppressed %u messages\n", file == NULL ? site->file : file + 1, site->line, suppressed);
+	}
+
+	return 1;
+}
+
+static void __log_rotate(void)
 {
-	return logfd;
+	char from[LOG_ROTATE_PATH_SIZE];
+	char to[LOG_ROTATE_PATH_SIZE];
+	FILE *new_file;
+	unsigned i;
+
+	if (logfile == NULL || log_path[0] == '\0')
+		return;
+
+	/* file.N-1 -> file.N, ..., file -> file.1 */
+	for (i = log_rotate_max_files; i > 1; --i)
+	{
+		(void)snprintf(from, sizeof(from), "%s.%u", log_path, i - 1);
+		(void)snprintf(to, sizeof(to), "%s.%u", log_path, i);
+		(void)rename(from, to);
+	}
+
+	if (log_rotate_max_files > 0)
+	{
+		(void)snprintf(to, sizeof(to), "%s.1", log_path);
+		(void)rename(log_path, to);
+	}
+
+	/*
+		Writers use logfile without log_rotate_mutex, so stream can't be replaced.
+		Open new file aside and move its fd under stream lock, on failure old stream is kept.
+		Async backend writes by the same fd number, so it follows automatically.
+	*/
+	new_file = fopen(log_path, "w");
+	if (new_file != NULL)
+	{
+		flockfile(logfile);
+		(void)fflush(logfile);
+		(void)dup2(fileno(new_file), fileno(logfile));
+		funlockfile(logfile);
+
+		(void)fclose(new_file);
+	}
+
+	/* also on failure, otherwise every write would rotate files again */
+	__atomic_store_n(&log_file_bytes, 0, __ATOMIC_RELAXED);
 }
 
-FILE *log_get_file(void)
+static void __log_file_written(size_t bytes)
 {
-	return logfile;
+	size_t max = __atomic_load_n(&log_rotate_max_bytes, __ATOMIC_RELAXED);
+
+	if (max == 0)
+		return;
+
+	if (__atomic_add_fetch(&log_file_bytes, bytes, __ATOMIC_RELAXED) < max)
+		return;
+
+	(void)pthread_mutex_lock(&log_rotate_mutex);
+	if (__atomic_load_n(&log_file_bytes, __ATOMIC_RELAXED) >= max)
+		__log_rotate();
+	(void)pthread_mutex_unlock(&log_rotate_mutex);
 }
 
-#define LOGBUF_SIZE	128
+static void __log_file_vprintf(const char *msg, va_list args)
+{
+	int ret;
+
+	ret = vfprintf(logfile, msg, args);
+	if (ret > 0)
+		__log_file_written((size_t)ret);
+}
+
+int __log_site_slow(Log_site *site, int level)
+{
+	unsigned long gen;
+	unsigned long key;
+
+	gen = __atomic_load_n(&__log_levels_gen__, __ATOMIC_ACQUIRE);
+	key = __atomic_load_n(&site->key, __ATOMIC_RELAXED);
+	if ((key >> LOG_SITE_GEN_SHIFT) != gen)
+	{
+		key = (gen << LOG_SITE_GEN_SHIFT) | (unsigned long)__log_site_level(site);
+		__atomic_store_n(&site->key, key, __ATOMIC_RELAXED);
+	}
+
+	if ((int)(key & LOG_SITE_LEVEL_MASK) < level)
+		return 0;
+
+	return __log_site_rate(site);
+}
+
+int log_set_level(const char *module, int level)
+{
+	char name[LOG_MODULE_NAME_SIZE];
+	Log_module *entry;
+	int ret = 0;
+
+	if (level < LOG_LEVEL_DEFAULT || level > LOG_LEVEL_MAX)
+		return 1;
+
+	if (module != NULL && __log_module_name(module, name))
+		return 1;
+
+	(void)pthread_mutex_lock(&log_levels_mutex);
+
+	if (module == NULL || strcmp(name, "*") == 0)
+		__atomic_store_n(&log_default_level, level, __ATOMIC_RELAXED);
+	else
+	{
+		entry = __log_module_find(name);
+		if (level == LOG_LEVEL_DEFAULT)
+		{
+			/* remove, order doesn't matter */
+			if (entry != NULL)
+				*entry = log_modules[--log_num_modules];
+		}
+		else if (entry != NULL)
+			entry->level = level;
+		else if (log_num_modules < LOG_MODULES_MAX)
+		{
+			entry = &log_modules[log_num_modules++];
+			(void)strcpy(entry->name, name);
+			entry->level = level;
+		}
+		else
+			ret = 1;
+	}
+
+	/* all sites will refresh cached level */
+	if (ret == 0)
+		(void)__atomic_add_fetch(&__log_levels_gen__, 1, __ATOMIC_RELEASE);
+
+	(void)pthread_mutex_unlock(&log_levels_mutex);
+
+	return ret;
+}
+
+int log_get_level(const char *module)
+{
+	char name[LOG_MODULE_NAME_SIZE];
+	const Log_module *entry;
+	int level;
+
+	if (module == NULL || strcmp(module, "*") == 0)
+		return __atomic_load_n(&log_default_level, __ATOMIC_RELAXED);
+
+	if (__log_module_name(module, name))
+		return LOG_LEVEL_DEFAULT;
+
+	(void)pthread_mutex_lock(&log_levels_mutex);
+	entry = __log_module_find(name);
+	level = entry == NULL ? LOG_LEVEL_DEFAULT : entry->level;
+	(void)pthread_mutex_unlock(&log_levels_mutex);
+
+	return level;
+}
+
+int log_set_levels(const char *spec)
+{
+	char name[LOG_MODULE_NAME_SIZE];
+	const char *p = spec;
+	const char *eq;
+	const char *end;
+	char *num_end;
+	size_t len;
+	long level;
+
+	if (spec == NULL)
+		return 1;
+
+	while (*p != '\0')
+	{
+		end = strchr(p, ',');
+		if (end == NULL)
+			end = p + strlen(p);
+
+		eq = memchr(p, '=', (size_t)(end - p));
+		if (eq == NULL)
+		{
+			/* only level, set default */
+			name[0] = '*';
+			name[1] = '\0';
+			eq = p - 1;
+		}
+		else
+		{
+			len = (size_t)(eq - p);
+			if (len == 0 || len >= LOG_MODULE_NAME_SIZE)
+				return 1;
+
+			(void)memcpy(name, p, len);
+			name[len] = '\0';
+		}
+
+		level = strtol(eq + 1, &num_end, 10);
+		if (num_end == eq + 1 || num_end != end)
+			return 1;
+
+		if (level < LOG_LEVEL_DEFAULT || level > LOG_LEVEL_MAX)
+			return 1;
+
+		if (log_set_level(name, (int)level))
+			return 1;
+
+		p = *end == ',' ? end + 1 : end;
+	}
+
+	return 0;
+}
+
+void log_set_rate_limit(unsigned per_sec, unsigned burst)
+{
+	__atomic_store_n(&log_rate_burst, burst == 0 ? 1 : burst, __ATOMIC_RELAXED);
+	__atomic_store_n(&log_rate_per_sec, per_sec, __ATOMIC_RELAXED);
+}
+
+size_t log_get_rate_limited(void)
+{
+	return __atomic_load_n(&log_rate_limited, __ATOMIC_RELAXED);
+}
+
+int log_set_rotation(size_t max_bytes, unsigned max_files)
+{
+	if (max_files > LOG_ROTATE_MAX_FILES)
+		return 1;
+
+	(void)pthread_mutex_lock(&log_rotate_mutex);
+	log_rotate_max_files = max_files;
+	__atomic_store_n(&log_rotate_max_bytes, max_bytes, __ATOMIC_RELAXED);
+	(void)pthread_mutex_unlock(&log_rotate_mutex);
+
+	return 0;
+}
+
+/*
+	Binary trace backend
+
+	File is extended by chunks, each thread maps own chunk (MAP_SHARED)
+	and writes fixed size records to it, so TRACE costs timestamp + 16 bytes store
+*/
+
+#define LOG_TRACE_CHUNK_SIZE		((size_t)1 << 20)
+#define LOG_TRACE_CALIBRATE_NS		20000000L
+
+extern const Log_trace_site __start_log_trace_sites[] ___weak___;
+extern const Log_trace_site __stop_log_trace_sites[] ___weak___;
+
+static int log_trace_fd = -1;
+static unsigned log_trace_gen = 0;
+static size_t log_trace_offset = 0;	/* next free chunk */
+
+static __thread Log_trace_record *log_trace_pos = NULL;
+static __thread Log_trace_record *log_trace_end = NULL;
+static __thread void *log_trace_chunk = NULL;
+static __thread uint32_t log_trace_tid = 0;
+static __thread unsigned log_trace_tls_gen = 0;
+
+/* chunk of exited thread is unmapped by key destructor */
+static pthread_key_t log_trace_key;
+static pthread_once_t log_trace_key_once = PTHREAD_ONCE_INIT;
+
+/*
+	Get timestamp (TSC on x86, monotonic ns otherwise)
+
+	PARAMS
+	NO PARAMS
+
+	RETURN
+	Timestamp
+*/
+static ___inline___ uint64_t __log_trace_timestamp(void);
+
+/*
+	Calibrate timestamp frequency
+
+	PARAMS
+	NO PARAMS
+
+	RETURN
+	Ticks per second
+*/
+static uint64_t __log_trace_ticks_per_sec(void);
+
+/*
+	Unmap current chunk and map new one for calling thread
+
+	PARAMS
+	NO PARAMS
+
+	RETURN
+	0 iff success
+	Non-zero value iff failure (tracing is off)
+*/
+static int __log_trace_next_chunk(void);
+
+/*
+	Unmap chunk of exiting thread (destructor of log_trace_key)
+
+	PARAMS
+	@IN chunk - mapped chunk
+
+	RETURN
+	This is a void function
+*/
+static void __log_trace_thread_exit(void *chunk);
+
+/*
+	Create log_trace_key (once)
+
+	PARAMS
+	NO PARAMS
+
+	RETURN
+	This is a void function
+*/
+static void __log_trace_key_create(void);
+
+/*
+	Write header and site table to trace file
+
+	PARAMS
+	@IN fd - trace file
+	@IN data_offset - offset of first chunk
+
+	RETURN
+	0 iff success
+	Non-zero value iff failure
+*/
+static int __log_trace_write_header(int fd, size_t data_offset);
+
+static ___inline___ uint64_t __log_trace_timestamp(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return (uint64_t)__rdtsc();
+#else
+	struct timespec ts;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static uint64_t __log_trace_ticks_per_sec(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	struct timespec t0;
+	struct timespec t1;
+	uint64_t c0;
+	uint64_t c1;
+	uint64_t ns;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &t0);
+	c0 = __log_trace_timestamp();
+	__log_async_sleep(LOG_TRACE_CALIBRATE_NS);
+	(void)clock_gettime(CLOCK_MONOTONIC, &t1);
+	c1 = __log_trace_timestamp();
+
+	ns = (uint64_t)(t1.tv_sec - t0.tv_sec) * 1000000000ULL + (uint64_t)t1.tv_nsec - (uint64_t)t0.tv_nsec;
+
+	return (uint64_t)((double)(c1 - c0) * 1e9 / (double)ns);
+#else
+	return 1000000000ULL;
+#endif
+}
+
+static void __log_trace_thread_exit(void *chunk)
+{
+	(void)munmap(chunk, LOG_TRACE_CHUNK_SIZE);
+}
+
+static void __log_trace_key_create(void)
+{
+	(void)pthread_key_create(&log_trace_key, __log_trace_thread_exit);
+}
+
+static int __log_trace_next_chunk(void)
+{
+	size_t offset;
+	void *chunk;
+	int fd;
+
+	if (log_trace_chunk != NULL)
+	{
+		(void)munmap(log_trace_chunk, LOG_TRACE_CHUNK_SIZE);
+		(void)pthread_setspecific(log_trace_key, NULL);
+	}
+
+	log_trace_chunk = NULL;
+	log_trace_pos = NULL;
+	log_trace_end = NULL;
+
+	fd = __atomic_load_n(&log_trace_fd, __ATOMIC_ACQUIRE);
+	if (fd == -1)
+		return 1;
+
+	if (log_trace_tid == 0)
+		log_trace_tid = (uint32_t)syscall(SYS_gettid);
+
+	offset = __atomic_fetch_add(&log_trace_offset, LOG_TRACE_CHUNK_SIZE, __ATOMIC_RELAXED);
+
+	/* extend file (never shrink, other threads may have extended it more) */
+	if (pwrite(fd, "", 1, (off_t)(offset + LOG_TRACE_CHUNK_SIZE - 1)) != 1)
+		return 1;
+
+	chunk = mmap(NULL, LOG_TRACE_CHUNK_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, (off_t)offset);
+	if (chunk == MAP_FAILED)
+		return 1;
+
+	if (pthread_setspecific(log_trace_key, chunk))
+	{
+		(void)munmap(chunk, LOG_TRACE_CHUNK_SIZE);
+		return 1;
+	}
+
+	log_trace_chunk = chunk;
+	log_trace_pos = (Log_trace_record *)chunk;
+	log_trace_end = log_trace_pos + LOG_TRACE_CHUNK_SIZE / sizeof(Log_trace_record);
+	log_trace_tls_gen = __atomic_load_n(&log_trace_gen, __ATOMIC_ACQUIRE);
+
+	return 0;
+}
+
+static int __log_trace_write_header(int fd, size_t data_offset)
+{
+	Log_trace_header *header;
+	Log_trace_site_entry *entry;
+	const Log_trace_site *site;
+	char *buf;
+	size_t num_sites = 0;
+	size_t size;
+	size_t file_len;
+	size_t func_len;
+	size_t written;
+	ssize_t ret;
+
+	if (__start_log_trace_sites != NULL)
+		num_sites = (size_t)(__stop_log_trace_sites - __start_log_trace_sites);
+
+	buf = (char *)calloc(1, data_offset);
+	if (buf == NULL)
+		return 1;
+
+	header = (Log_trace_header *)(void *)buf;
+	(void)memcpy(header->magic, LOG_TRACE_MAGIC, sizeof(LOG_TRACE_MAGIC));
+	header->version = LOG_TRACE_VERSION;
+	header->num_sites = (uint32_t)num_sites;
+	header->ticks_per_sec = __log_trace_ticks_per_sec();
+	header->chunk_size = LOG_TRACE_CHUNK_SIZE;
+	header->data_offset = data_offset;
+	header->pid = (uint64_t)getpid();
+
+	size = sizeof(Log_trace_header);
+	for (site = __start_log_trace_sites; site != NULL && site < __stop_log_trace_sites; ++site)
+	{
+		file_len = strlen(site->file);
+		func_len = strlen(site->func);
+
+		entry = (Log_trace_site_entry *)(void *)(buf + size);
+		entry->line = (uint32_t)site->line;
+		entry->file_len = (uint16_t)file_len;
+		entry->func_len = (uint16_t)func_len;
+		size += sizeof(Log_trace_site_entry);
+
+		(void)memcpy(buf + size, site->file, file_len);
+		size += file_len;
+		(void)memcpy(buf + size, site->func, func_len);
+		size += func_len;
+
+		/* keep entries aligned */
+		size = (size + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1);
+	}
+
+	written = 0;
+	while (written < data_offset)
+	{
+		ret = write(fd, buf + written, data_offset - written);
+		if (ret < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			free(buf);
+			return 1;
+		}
+
+		written += (size_t)ret;
+	}
+
+	free(buf);
+
+	return 0;
+}
+
+void __trace_binary__(const Log_trace_site *site)
+{
+	Log_trace_record *rec;
+
+	if (unlikely(log_trace_pos == log_trace_end || log_trace_tls_gen != __atomic_load_n(&log_trace_gen, __ATOMIC_RELAXED)))
+		if (__log_trace_next_chunk())
+			return;
+
+	rec = log_trace_pos++;
+	rec->site = (uint32_t)(site - __start_log_trace_sites);
+	rec->tid = log_trace_tid;
+	rec->ts = __log_trace_timestamp();
+}
+
+int log_trace_init(const char *path)
+{
+	const Log_trace_site *site;
+	char buf[LOGBUF_SIZE];
+	struct stat st;
+	size_t size;
+	size_t page;
+	int fd;
+
+	if (__atomic_load_n(&log_trace_fd, __ATOMIC_ACQUIRE) != -1)
+		return 1;
+
+	if (pthread_once(&log_trace_key_once, __log_trace_key_create))
+		return 1;
+
+	if (path == NULL)
+	{
+		/* create directory if doesn't exist */
+		if (stat(logdir, &st) == -1)
+			if (mkdir(logdir, 0775) == -1)
+			{
+				perror("mkdir error\n");
+				return 1;
+			}
+
+		(void)snprintf(buf, sizeof(buf), "%s/trace_%ld.bin", logdir, (long)getpid());
+		path = buf;
+	}
+
+	fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd == -1)
+	{
+		perror("open error\n");
+		return 1;
+	}
+
+	/* chunks have to be page aligned for mmap */
+	size = sizeof(Log_trace_header);
+	for (site = __start_log_trace_sites; site != NULL && site < __stop_log_trace_sites; ++site)
+		size += sizeof(Log_trace_site_entry) + strlen(site->file) + strlen(site->func) + sizeof(uint32_t);
+
+	page = (size_t)sysconf(_SC_PAGESIZE);
+	size = (size + page - 1) & ~(page - 1);
+
+	if (__log_trace_write_header(fd, size))
+	{
+		perror("write error\n");
+		(void)close(fd);
+		return 1;
+	}
+
+	log_trace_offset = size;
+
+	/* chunks mapped by threads in previous session are not valid */
+	(void)__atomic_add_fetch(&log_trace_gen, 1, __ATOMIC_RELEASE);
+	__atomic_store_n(&log_trace_fd, fd, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+void log_trace_deinit(void)
+{
+	int fd;
+
+	fd = __atomic_exchange_n(&log_trace_fd, -1, __ATOMIC_ACQ_REL);
+	if (fd == -1)
+		return;
+
+	/* other threads unmap own chunks on next TRACE or on exit */
+	(void)__atomic_add_fetch(&log_trace_gen, 1, __ATOMIC_RELEASE);
+
+	if (log_trace_chunk != NULL)
+	{
+		(void)munmap(log_trace_chunk, LOG_TRACE_CHUNK_SIZE);
+		(void)pthread_setspecific(log_trace_key, NULL);
+	}
+
+	log_trace_chunk = NULL;
+	log_trace_pos = NULL;
+	log_trace_end = NULL;
+
+	(void)close(fd);
+}
 
 #ifdef DEBUG_MODE
 void __log__(const char *msg, ...)
 {
 	va_list args;
 
+	if (log_async_is_enabled())
+	{
+		va_start(args, msg);
+		__log_async_push(LOG_ASYNC_KIND_LOG, msg, args);
+		va_end(args);
+		return;
+	}
+
 	if (logfd != NULL)
 	{
     	va_start(args, msg);
@@ -38,7 +2039,7 @@ void __log__(const char *msg, ...)
 	if (logfile != NULL)
 	{
 		va_start (args, msg);
-		vfprintf(logfile, msg, args);
+		__log_file_vprintf(msg, args);
 		va_end(args);
 	}
 }
@@ -51,6 +2052,14 @@ void __trace_call__(const char *msg, ...)
 {
     va_list args;
 
+	if (log_async_is_enabled())
+	{
+		va_start(args, msg);
+		__log_async_push(LOG_ASYNC_KIND_TRACE, msg, args);
+		va_end(args);
+		return;
+	}
+
 	if (logfd != NULL)
 	{
     	va_start(args, msg);
@@ -61,7 +2070,7 @@ void __trace_call__(const char *msg, ...)
 	if (logfile != NULL)
 	{
 		va_start (args, msg);
-		vfprintf(logfile, msg, args);
+		__log_file_vprintf(msg, args);
 		va_end(args);
 	}
 }
@@ -74,6 +2083,14 @@ void __error__(const char *msg, ...)
 {
 	va_list args;
 
+	if (log_async_is_enabled())
+	{
+		va_start(args, msg);
+		__log_async_push(LOG_ASYNC_KIND_ERROR, msg, args);
+		va_end(args);
+		return;
+	}
+
 	if (logfd == NULL)
 	{
     	va_start(args, msg);
@@ -90,7 +2107,7 @@ void __error__(const char *msg, ...)
 	if (logfile != NULL)
 	{
 		va_start (args, msg);
-		vfprintf(logfile, msg, args);
+		__log_file_vprintf(msg, args);
 		va_end(args);
 	}
 }
@@ -102,6 +2119,9 @@ void __fatal__(const char *msg, ...)
 {
 	va_list args;
 
+	/* keep order, messages from queue first */
+	(void)log_async_flush();
+
 	if (logfd == NULL)
 	{
     	va_start(args, msg);
@@ -118,7 +2138,7 @@ void __fatal__(const char *msg, ...)
 	if (logfile != NULL)
 	{
 		va_start (args, msg);
-		vfprintf(logfile, msg, args);
+		__log_file_vprintf(msg, args);
 		va_end(args);
 	}
 }
@@ -132,6 +2152,7 @@ int log_init(const FILE *fd, int to_file)
 
 	char buf[LOGBUF_SIZE];
 	size_t len;
+	const char *levels;
 
 	logfd = (FILE *)fd; /* NULL is ok, log only to file */
 	if (fd != NULL && (fd != stderr || fd != stdout))
@@ -185,10 +2206,18 @@ int log_init(const FILE *fd, int to_file)
 			perror("fopen error\n");
 			return 1;
 		}
+
+		/* needed by rotation */
+		(void)strcpy(log_path, buf);
+		log_file_bytes = 0;
 	}
 	else
 		logfile = NULL;
 
+	levels = getenv("LOG_LEVELS");
+	if (levels != NULL && log_set_levels(levels))
+		fprintf(stderr, "LOG_LEVELS: wrong spec %s\n", levels);
+
 	return 0;
 }
 #else
@@ -198,14 +2227,18 @@ int log_init(const FILE *fd, int to_file) { (void)fd; (void)to_file; return 0; }
 #ifdef DEBUG_MODE
 void log_deinit(void)
 {
+	log_async_deinit();
+	log_trace_deinit();
+
 	if (logfile != NULL)
 	{
 		(void)fclose(logfile);
 		logfile = NULL;
 	}
 
+	log_path[0] = '\0';
 	logfd = NULL;
 }
 #else
-void log_deinit(void) { }
+void log_deinit(void) { log_async_deinit(); log_trace_deinit(); }
 #endif
@@ -0,0 +1,470 @@
+#include <quantile.h>
+#include <log.h>
+#include <common.h>
+#include <compiler.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#define HDR_CACHE_LINE      64
+#define HDR_COUNTS_PER_LINE (HDR_CACHE_LINE / sizeof(uint64_t))
+
+/* shard header, one cache line per shard */
+typedef struct Hdr_shard
+{
+    uint64_t count;
+    uint64_t min;
+    uint64_t max;
+} ___align___(HDR_CACHE_LINE) Hdr_shard;
+
+struct Hdr_histogram
+{
+    uint64_t    highest;
+    unsigned    precision_bits;
+    size_t      num_buckets;
+    size_t      stride;     /* counters per shard, multiple of cache line */
+    size_t      num_shards;
+    Hdr_shard   *shards;
+    uint64_t    *counts;    /* num_shards * stride */
+};
+
+/* id of thread + 1 (0 iff not assigned yet) */
+static __thread size_t hdr_tls_shard = 0;
+static size_t hdr_next_shard = 0;
+
+/*
+    Get index of bucket for value:
+    values < 2^p have own bucket, next buckets are [2^e, 2^(e + 1)) split into 2^(p - 1) sub buckets
+
+    PARAMS
+    @IN precision_bits - precision (p)
+    @IN value - value
+
+    RETURN
+    Index of bucket
+*/
+static ___inline___ size_t __hdr_index(unsigned precision_bits, uint64_t value);
+
+/*
+    Get lowest and highest value of bucket
+
+    PARAMS
+    @IN precision_bits - precision
+    @IN index - index of bucket
+    @OUT low - lowest value
+    @OUT high - highest value
+
+    RETURN
+    This is a void function
+*/
+static ___inline___ void __hdr_bucket_range(unsigned precision_bits, size_t index, uint64_t *low, uint64_t *high);
+
+/*
+    Get count of bucket from all shards
+
+    PARAMS
+    @IN h - pointer to Hdr_histogram
+    @IN index - index of bucket
+
+    RETURN
+    Count of bucket
+*/
+static ___inline___ uint64_t __hdr_bucket_count(const Hdr_histogram *h, size_t index);
+
+/*
+    Record value count times in shard (atomic iff concurrent)
+
+    PARAMS
+    @IN h - pointer to Hdr_histogram
+    @IN shard - index of shard
+    @IN value - value
+    @IN count - number of values
+    @IN concurrent - use atomic operations?
+
+    RETURN
+    This is a void function
+*/
+static ___inline___ void __hdr_record(Hdr_histogram *h, size_t shard, uint64_t value, uint64_t count, bool concurrent);
+
+static ___inline___ size_t __hdr_index(unsigned precision_bits, uint64_t value)
+{
+    const uint64_t sub_mask = (uint64_t)BIT(precision_bits) - 1;
+    const unsigned msb = 63 - (unsigned)__builtin_clzll(value | sub_mask);
+    const unsigned shift = msb - (precision_bits - 1);
+
+    return ((size_t)shift << (precision_bits - 1)) + (size_t)(value >> shift);
+}
+
+static ___inline___ void __hdr_bucket_range(unsigned precision_bits, size_t index, uint64_t *low, uint64_t *high)
+{
+    size_t shift;
+
+    if (index < (size_t)BIT(precision_bits))
+    {
+        *low = (uint64_t)index;
+        *high = (uint64_t)index;
+        return;
+    }
+
+    shift = (index >> (precision_bits - 1)) - 1;
+    *low = (uint64_t)(index - (shift << (precision_bits - 1))) << shift;
+    *high = *low + (((uint64_t)1 << shift) - 1);
+}
+
+static ___inline___ uint64_t __hdr_bucket_count(const Hdr_histogram *h, size_t index)
+{
+    uint64_t count = 0;
+    size_t i;
+
+    for (i = 0; i < h->num_shards; ++i)
+        count += __atomic_load_n(&h->counts[i * h->stride + index], __ATOMIC_RELAXED);
+
+    return count;
+}
+
+static ___inline___ void __hdr_record(Hdr_histogram *h, size_t shard, uint64_t value, uint64_t count, bool concurrent)
+{
+    Hdr_shard *s = &h->shards[shard];
+    uint64_t *counter;
+    uint64_t cur;
+
+    value = MIN(value, h->highest);
+    counter = &h->counts[shard * h->stride + __hdr_index(h->precision_bits, value)];
+
+    if (!concurrent)
+    {
+        *counter += count;
+        s->min = MIN(s->min, value);
+        s->max = MAX(s->max, value);
+        s->count += count;
+        return;
+    }
+
+    (void)__atomic_fetch_add(counter, count, __ATOMIC_RELAXED);
+    (void)__atomic_fetch_add(&s->count, count, __ATOMIC_RELAXED);
+
+    /* extremes change rarely, so CAS loops are almost never taken */
+    cur = __atomic_load_n(&s->min, __ATOMIC_RELAXED);
+    while (value < cur && !__atomic_compare_exchange_n(&s->min, &cur, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+
+    cur = __atomic_load_n(&s->max, __ATOMIC_RELAXED);
+    while (value > cur && !__atomic_compare_exchange_n(&s->max, &cur, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+Hdr_histogram *hdr_histogram_create(uint64_t highest, unsigned precision_bits, size_t shards)
+{
+    Hdr_histogram *h;
+    size_t i;
+
+    TRACE();
+
+    if (precision_bits < HDR_HISTOGRAM_MIN_PRECISION || precision_bits > HDR_HISTOGRAM_MAX_PRECISION)
+        ERROR("precision_bits has to be in [%d, %d]\n", NULL, HDR_HISTOGRAM_MIN_PRECISION, HDR_HISTOGRAM_MAX_PRECISION);
+
+    if (highest == 0)
+        ERROR("highest == 0\n", NULL);
+
+    if (shards == 0 || shards > HDR_HISTOGRAM_MAX_SHARDS)
+        ERROR("shards has to be in [1, %d]\n", NULL, HDR_HISTOGRAM_MAX_SHARDS);
+
+    h = (Hdr_histogram *)malloc(sizeof(Hdr_histogram));
+    if (h == NULL)
+        ERROR("malloc error\n", NULL);
+
+    h->highest = highest;
+    h->precision_bits = precision_bits;
+    h->num_buckets = __hdr_index(precision_bits, highest) + 1;
+    h->stride = (h->num_buckets + HDR_COUNTS_PER_LINE - 1) / HDR_COUNTS_PER_LINE * HDR_COUNTS_PER_LINE;
+    h->num_shards = shards;
+
+    if (posix_memalign((void **)&h->shards, HDR_CACHE_LINE, shards * sizeof(Hdr_shard)))
+    {
+        FREE(h);
+        ERROR("posix_memalign error\n", NULL);
+    }
+
+    if (posix_memalign((void **)&h->counts, HDR_CACHE_LINE, shards * h->stride * sizeof(uint64_t)))
+    {
+        FREE(h->shards);
+        FREE(h);
+        ERROR("posix_memalign error\n", NULL);
+    }
+
+    for (i = 0; i < shards; ++i)
+    {
+        h->shards[i].count = 0;
+        h->shards[i].min = UINT64_MAX;
+        h->shards[i].max = 0;
+    }
+
+    (void)memset(h->counts, 0, shards * h->stride * sizeof(uint64_t));
+
+    return h;
+}
+
+void hdr_histogram_destroy(Hdr_histogram *h)
+{
+    TRACE();
+
+    if (h == NULL)
+        return;
+
+    FREE(h->shards);
+    FREE(h->counts);
+    FREE(h);
+}
+
+int hdr_histogram_record(Hdr_histogram *h, uint64_t value)
+{
+    TRACE();
+
+    if (h == NULL)
+        ERROR("h == NULL\n", 1);
+
+    __hdr_record(h, 0, value, 1, false);
+
+    return 0;
+}
+
+int hdr_histogram_record_n(Hdr_histogram *h, uint64_t value, uint64_t count)
+{
+    TRACE();
+
+    if (h == NULL)
+        ERROR("h == NULL\n", 1);
+
+    if (count == 0)
+        return 0;
+
+    __hdr_record(h, 0, value, count, false);
+
+    return 0;
+}
+
+int hdr_histogram_record_concurrent(Hdr_histogram *h, uint64_t value)
+{
+    TRACE();
+
+    if (h == NULL)
+        ERROR("h == NULL\n", 1);
+
+    if (unlikely(hdr_tls_shard == 0))
+        hdr_tls_shard = __atomic_fetch_add(&hdr_next_shard, 1, __ATOMIC_RELAXED) + 1;
+
+    __hdr_record(h, (hdr_tls_shard - 1) % h->num_shards, value, 1, true);
+
+    return 0;
+}
+
+int hdr_histogram_merge(Hdr_histogram *dst, const Hdr_histogram *src)
+{
+    uint64_t count;
+    uint64_t low;
+    uint64_t high;
+    size_t i;
+
+    TRACE();
+
+    if (dst == NULL || src == NULL)
+        ERROR("dst == NULL || src == NULL\n", 1);
+
+    if (dst == src)
+        ERROR("dst == src\n", 1);
+
+    if (dst->highest != src->highest || dst->precision_bits != src->precision_bits)
+        ERROR("histograms have different params\n", 1);
+
+    for (i = 0; i < src->num_buckets; ++i)
+    {
+        count = __hdr_bucket_count(src, i);
+        if (count == 0)
+            continue;
+
+        (void)__atomic_fetch_add(&dst->counts[i], count, __ATOMIC_RELAXED);
+        (void)__atomic_fetch_add(&dst->shards[0].count, count, __ATOMIC_RELAXED);
+    }
+
+    /* exact extremes of src, bucket is updated above */
+    if (hdr_histogram_get_count(src) > 0)
+    {
+        low = hdr_histogram_get_min(src);
+        high = hdr_histogram_get_max(src);
+
+        dst->shards[0].min = MIN(dst->shards[0].min, low);
+        dst->shards[0].max = MAX(dst->shards[0].max, high);
+    }
+
+    return 0;
+}
+
+int hdr_histogram_get_quantiles(const Hdr_histogram *h, const double *qs, size_t num_qs, uint64_t *values)
+{
+    uint64_t total;
+    uint64_t rank;
+    uint64_t cumulative = 0;
+    uint64_t low;
+    uint64_t high;
+    uint64_t min;
+    uint64_t max;
+    size_t bucket = 0;
+    size_t i;
+
+    TRACE();
+
+    if (h == NULL || qs == NULL || values == NULL)
+        ERROR("h == NULL || qs == NULL || values == NULL\n", 1);
+
+    for (i = 0; i < num_qs; ++i)
+    {
+        if (!(qs[i] >= 0.0 && qs[i] <= 1.0))
+            ERROR("q has to be in [0.0, 1.0]\n", 1);
+
+        if (i > 0 && qs[i] < qs[i - 1])
+            ERROR("qs are not sorted\n", 1);
+    }
+
+    total = hdr_histogram_get_count(h);
+    if (total == 0)
+    {
+        (void)memset(values, 0, num_qs * sizeof(uint64_t));
+        return 0;
+    }
+
+    min = hdr_histogram_get_min(h);
+    max = hdr_histogram_get_max(h);
+
+    /* one pass: quantiles are sorted, so bucket only moves forward */
+    for (i = 0; i < num_qs; ++i)
+    {
+        rank = (uint64_t)(qs[i] * (double)total + 0.5);
+        rank = MAX(rank, (uint64_t)1);
+        rank = MIN(rank, total);
+
+        while (cumulative < rank && bucket < h->num_buckets)
+            cumulative += __hdr_bucket_count(h, bucket++);
+
+        __hdr_bucket_range(h->precision_bits, bucket - 1, &low, &high);
+        high = MIN(high, max);
+        values[i] = MAX(high, min);
+    }
+
+    return 0;
+}
+
+uint64_t hdr_histogram_get_quantile(const Hdr_histogram *h, double q)
+{
+    uint64_t value;
+
+    TRACE();
+
+    if (hdr_histogram_get_quantiles(h, &q, 1, &value))
+        ERROR("hdr_histogram_get_quantiles error\n", 0);
+
+    return value;
+}
+
+uint64_t hdr_histogram_get_count(const Hdr_histogram *h)
+{
+    uint64_t count = 0;
+    size_t i;
+
+    TRACE();
+
+    if (h == NULL)
+        ERROR("h == NULL\n", 0);
+
+    for (i = 0; i < h->num_shards; ++i)
+        count += __atomic_load_n(&h->shards[i].count, __ATOMIC_RELAXED);
+
+    return count;
+}
+
+uint64_t hdr_histogram_get_min(const Hdr_histogram *h)
+{
+    uint64_t min = UINT64_MAX;
+    uint64_t cur;
+    size_t i;
+
+    TRACE();
+
+    if (h == NULL)
+        ERROR("h == NULL\n", 0);
+
+    for (i = 0; i < h->num_shards; ++i)
+    {
+        cur = __atomic_load_n(&h->shards[i].min, __ATOMIC_RELAXED);
+        min = MIN(min, cur);
+    }
+
+    return min == UINT64_MAX && hdr_histogram_get_count(h) == 0 ? 0 : min;
+}
+
+uint64_t hdr_histogram_get_max(const Hdr_histogram *h)
+{
+    uint64_t max = 0;
+    uint64_t cur;
+    size_t i;
+
+    TRACE();
+
+    if (h == NULL)
+        ERROR("h == NULL\n", 0);
+
+    for (i = 0; i < h->num_shards; ++i)
+    {
+        cur = __atomic_load_n(&h->shards[i].max, __ATOMIC_RELAXED);
+        max = MAX(max, cur);
+    }
+
+    return max;
+}
+
+double hdr_histogram_get_mean(const Hdr_histogram *h)
+{
+    double sum = 0.0;
+    uint64_t total = 0;
+    uint64_t count;
+    uint64_t low;
+    uint64_t high;
+    size_t i;
+
+    TRACE();
+
+    if (h == NULL)
+        ERROR("h == NULL\n", 0.0);
+
+    for (i = 0; i < h->num_buckets; ++i)
+    {
+        count = __hdr_bucket_count(h, i);
+        if (count == 0)
+            continue;
+
+        /* middle of bucket */
+        __hdr_bucket_range(h->precision_bits, i, &low, &high);
+        sum += (double)count * ((double)low + (double)(high - low) / 2.0);
+        total += count;
+    }
+
+    return total == 0 ? 0.0 : sum / (double)total;
+}
+
+void hdr_histogram_reset(Hdr_histogram *h)
+{
+    size_t i;
+
+    TRACE();
+
+    if (h == NULL)
+        return;
+
+    for (i = 0; i < h->num_shards; ++i)
+    {
+        h->shards[i].count = 0;
+        h->shards[i].min = UINT64_MAX;
+        h->shards[i].max = 0;
+    }
+
+    (void)memset(h->counts, 0, h->num_shards * h->stride * sizeof(uint64_t));
+}
@@ -0,0 +1,443 @@
+#include <quantile.h>
+#include <sort.h>
+#include <log.h>
+#include <common.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define TDIGEST_MIN_COMPRESSION     10.0
+#define TDIGEST_MAX_COMPRESSION     10000.0
+#define TDIGEST_BUFFER_FACTOR       5   /* buffer for compression * factor samples */
+#define TDIGEST_LN2                 0.6931471805599453
+
+typedef struct Tdigest_centroid
+{
+    union
+    {
+        double      mean;
+        uint64_t    key;    /* in buffer: mean as ordered key for radix sort */
+    } u;
+    double weight;
+} Tdigest_centroid;
+
+struct Tdigest
+{
+    double              compression;
+    double              total;          /* weight of centroids and buffer */
+    double              min;
+    double              max;
+
+    Tdigest_centroid    *centroids;     /* sorted by mean */
+    size_t              num_centroids;
+    size_t              size_centroids;
+
+    Tdigest_centroid    *buffer;        /* not merged samples */
+    size_t              num_buffer;
+    size_t              size_buffer;
+
+    Tdigest_centroid    *tmp;           /* for merge, size_centroids + size_buffer entries */
+};
+
+/*
+    Map double to uint64 with the same order (negative: flip all bits, positive: flip sign bit)
+
+    PARAMS
+    @IN value - double (not NaN)
+
+    RETURN
+    Ordered key
+*/
+static ___inline___ uint64_t __tdigest_to_key(double value);
+
+/*
+    Inverse of __tdigest_to_key
+
+    PARAMS
+    @IN key - ordered key
+
+    RETURN
+    double
+*/
+static ___inline___ double __tdigest_from_key(uint64_t key);
+
+/*
+    Merge buffer with centroids and compress them
+
+    PARAMS
+    @IN td - pointer to Tdigest
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+static int __tdigest_flush(Tdigest *td);
+
+/*
+    Normalizer of k2 scale: total * Z / compression,
+    Z = 4 * ln(total / compression) + 24 keeps number of centroids ~compression
+
+    PARAMS
+    @IN td - pointer to Tdigest
+
+    RETURN
+    Normalizer, max weight of centroid at q is normalizer * q * (1 - q)
+*/
+static ___inline___ double __tdigest_normalizer(const Tdigest *td);
+
+static ___inline___ uint64_t __tdigest_to_key(double value)
+{
+    uint64_t bits;
+
+    (void)memcpy(&bits, &value, sizeof(bits));
+
+    return bits & BIT(63) ? ~bits : bits | BIT(63);
+}
+
+static ___inline___ double __tdigest_from_key(uint64_t key)
+{
+    double value;
+
+    key = key & BIT(63) ? key & ~BIT(63) : ~key;
+    (void)memcpy(&value, &key, sizeof(value));
+
+    return value;
+}
+
+static ___inline___ double __tdigest_normalizer(const Tdigest *td)
+{
+    double z = 24.0;
+
+    if (td->total > td->compression * 2.0)
+        z += 4.0 * TDIGEST_LN2 * (double)LOG2_long((unsigned long)(td->total / td->compression));
+
+    return td->total * z / td->compression;
+}
+
+static int __tdigest_flush(Tdigest *td)
+{
+    Tdigest_centroid *centroids;
+    Tdigest_centroid *tmp;
+    Tdigest_centroid cur;
+    size_t i;
+    size_t j;
+    size_t n;
+    size_t out;
+    double w_so_far;
+    double proposed;
+    double q0;
+    double q2;
+    double normalizer;
+
+    TRACE();
+
+    if (td->num_buffer == 0)
+        return 0;
+
+    /* grow arrays before merge, so failure leaves digest unchanged */
+    n = td->num_centroids + td->num_buffer;
+    if (n > td->size_centroids)
+    {
+        centroids = (Tdigest_centroid *)realloc(td->centroids, n * sizeof(Tdigest_centroid));
+        if (centroids == NULL)
+            ERROR("realloc error\n", 1);
+
+        td->centroids = centroids;
+
+        tmp = (Tdigest_centroid *)realloc(td->tmp, (n + td->size_buffer) * sizeof(Tdigest_centroid));
+        if (tmp == NULL)
+            ERROR("realloc error\n", 1);
+
+        td->tmp = tmp;
+        td->size_centroids = n;
+    }
+
+    /* radix sort of keys is few times faster than sort with double compare */
+    if (sort_by_key((void *)td->buffer, td->num_buffer, sizeof(Tdigest_centroid),
+                    offsetof(Tdigest_centroid, u.key), sizeof(uint64_t), SORT_KEY_UNSIGNED))
+        ERROR("sort_by_key error\n", 1);
+
+    for (j = 0; j < td->num_buffer; ++j)
+        td->buffer[j].u.mean = __tdigest_from_key(td->buffer[j].u.key);
+
+    /* merge 2 sorted lists */
+    i = 0;
+    j = 0;
+    n = 0;
+    while (i < td->num_centroids || j < td->num_buffer)
+    {
+        if (j == td->num_buffer || (i < td->num_centroids && td->centroids[i].u.mean <= td->buffer[j].u.mean))
+            td->tmp[n++] = td->centroids[i++];
+        else
+            td->tmp[n++] = td->buffer[j++];
+    }
+
+    /* compress in place, ends (q = 0, q = 1) are never merged */
+    normalizer = __tdigest_normalizer(td);
+    out = 0;
+    w_so_far = 0.0;
+    cur = td->tmp[0];
+    for (i = 1; i < n; ++i)
+    {
+        proposed = cur.weight + td->tmp[i].weight;
+        q0 = w_so_far / td->total;
+        q2 = (w_so_far + proposed) / td->total;
+
+        if (proposed <= normalizer * q0 * (1.0 - q0) && proposed <= normalizer * q2 * (1.0 - q2))
+        {
+            cur.u.mean += (td->tmp[i].u.mean - cur.u.mean) * td->tmp[i].weight / proposed;
+            cur.weight = proposed;
+        }
+        else
+        {
+            w_so_far += cur.weight;
+            td->tmp[out++] = cur;
+            cur = td->tmp[i];
+        }
+    }
+
+    td->tmp[out++] = cur;
+
+    (void)memcpy(td->centroids, td->tmp, out * sizeof(Tdigest_centroid));
+    td->num_centroids = out;
+    td->num_buffer = 0;
+
+    return 0;
+}
+
+Tdigest *tdigest_create(double compression)
+{
+    Tdigest *td;
+
+    TRACE();
+
+    if (!(compression >= TDIGEST_MIN_COMPRESSION && compression <= TDIGEST_MAX_COMPRESSION))
+        ERROR("compression has to be in [%lf, %lf]\n", NULL, TDIGEST_MIN_COMPRESSION, TDIGEST_MAX_COMPRESSION);
+
+    td = (Tdigest *)calloc(1, sizeof(Tdigest));
+    if (td == NULL)
+        ERROR("calloc error\n", NULL);
+
+    td->compression = compression;
+    td->size_centroids = (size_t)(compression * 2.0);
+    td->size_buffer = (size_t)(compression * TDIGEST_BUFFER_FACTOR);
+
+    td->centroids = (Tdigest_centroid *)malloc(td->size_centroids * sizeof(Tdigest_centroid));
+    td->buffer = (Tdigest_centroid *)malloc(td->size_buffer * sizeof(Tdigest_centroid));
+    td->tmp = (Tdigest_centroid *)malloc((td->size_centroids + td->size_buffer) * sizeof(Tdigest_centroid));
+    if (td->centroids == NULL || td->buffer == NULL || td->tmp == NULL)
+    {
+        tdigest_destroy(td);
+        ERROR("malloc error\n", NULL);
+    }
+
+    return td;
+}
+
+void tdigest_destroy(Tdigest *td)
+{
+    TRACE();
+
+    if (td == NULL)
+        return;
+
+    FREE(td->centroids);
+    FREE(td->buffer);
+    FREE(td->tmp);
+    FREE(td);
+}
+
+int tdigest_add(Tdigest *td, double value)
+{
+    TRACE();
+
+    return tdigest_add_weighted(td, value, 1.0);
+}
+
+int tdigest_add_weighted(Tdigest *td, double value, double weight)
+{
+    TRACE();
+
+    if (td == NULL)
+        ERROR("td == NULL\n", 1);
+
+    /* NaN is not equal to itself */
+    if (value != value)
+        ERROR("value is NaN\n", 1);
+
+    if (!(weight > 0.0))
+        ERROR("weight <= 0\n", 1);
+
+    if (td->num_buffer == td->size_buffer && __tdigest_flush(td))
+        ERROR("__tdigest_flush error\n", 1);
+
+    if (td->total == 0.0)
+    {
+        td->min = value;
+        td->max = value;
+    }
+    else
+    {
+        td->min = MIN(td->min, value);
+        td->max = MAX(td->max, value);
+    }
+
+    td->buffer[td->num_buffer].u.key = __tdigest_to_key(value);
+    td->buffer[td->num_buffer].weight = weight;
+    ++td->num_buffer;
+    td->total += weight;
+
+    return 0;
+}
+
+int tdigest_merge(Tdigest *dst, Tdigest *src)
+{
+    size_t i;
+
+    TRACE();
+
+    if (dst == NULL || src == NULL)
+        ERROR("dst == NULL || src == NULL\n", 1);
+
+    if (dst == src)
+        ERROR("dst == src\n", 1);
+
+    if (__tdigest_flush(src))
+        ERROR("__tdigest_flush error\n", 1);
+
+    /* centroids of src are weighted samples for dst */
+    for (i = 0; i < src->num_centroids; ++i)
+        if (tdigest_add_weighted(dst, src->centroids[i].u.mean, src->centroids[i].weight))
+            ERROR("tdigest_add_weighted error\n", 1);
+
+    if (src->num_centroids > 0)
+    {
+        dst->min = MIN(dst->min, src->min);
+        dst->max = MAX(dst->max, src->max);
+    }
+
+    return 0;
+}
+
+int tdigest_get_quantile(Tdigest *td, double q, double *value)
+{
+    const Tdigest_centroid *c;
+    double index;
+    double w_so_far;
+    double dw;
+    double z1;
+    double z2;
+    size_t i;
+    size_t n;
+
+    TRACE();
+
+    if (td == NULL || value == NULL)
+        ERROR("td == NULL || value == NULL\n", 1);
+
+    if (!(q >= 0.0 && q <= 1.0))
+        ERROR("q has to be in [0.0, 1.0]\n", 1);
+
+    if (td->total == 0.0)
+        ERROR("tdigest is empty\n", 1);
+
+    if (__tdigest_flush(td))
+        ERROR("__tdigest_flush error\n", 1);
+
+    c = td->centroids;
+    n = td->num_centroids;
+    index = q * td->total;
+
+    if (n == 1 || index < 1.0)
+    {
+        *value = n == 1 ? c[0].u.mean : td->min;
+        return 0;
+    }
+
+    if (index >= td->total - 1.0)
+    {
+        *value = td->max;
+        return 0;
+    }
+
+    /* between min and center of first centroid */
+    if (c[0].weight > 2.0 && index < c[0].weight / 2.0)
+    {
+        *value = td->min + (index - 1.0) / (c[0].weight / 2.0 - 1.0) * (c[0].u.mean - td->min);
+        return 0;
+    }
+
+    /* interpolation between centers of centroids, singletons are points */
+    w_so_far = c[0].weight / 2.0;
+    for (i = 0; i + 1 < n; ++i)
+    {
+        dw = (c[i].weight + c[i + 1].weight) / 2.0;
+        if (w_so_far + dw > index)
+        {
+            z1 = index - w_so_far - (c[i].weight == 1.0 ? 0.5 : 0.0);
+            z2 = w_so_far + dw - index - (c[i + 1].weight == 1.0 ? 0.5 : 0.0);
+
+            if (z1 <= 0.0)
+                *value = c[i].u.mean;
+            else if (z2 <= 0.0)
+                *value = c[i + 1].u.mean;
+            else
+                *value = (c[i].u.mean * z2 + c[i + 1].u.mean * z1) / (z1 + z2);
+
+            return 0;
+        }
+
+        w_so_far += dw;
+    }
+
+    /* between center of last centroid and max */
+    if (c[n - 1].weight > 2.0)
+    {
+        z1 = index - w_so_far;
+        *value = c[n - 1].u.mean + z1 / (c[n - 1].weight / 2.0 - 1.0) * (td->max - c[n - 1].u.mean);
+        *value = MIN(*value, td->max);
+    }
+    else
+        *value = td->max;
+
+    return 0;
+}
+
+double tdigest_get_count(const Tdigest *td)
+{
+    TRACE();
+
+    if (td == NULL)
+        ERROR("td == NULL\n", 0.0);
+
+    return td->total;
+}
+
+size_t tdigest_get_num_centroids(Tdigest *td)
+{
+    TRACE();
+
+    if (td == NULL)
+        ERROR("td == NULL\n", 0);
+
+    if (__tdigest_flush(td))
+        ERROR("__tdigest_flush error\n", 0);
+
+    return td->num_centroids;
+}
+
+void tdigest_reset(Tdigest *td)
+{
+    TRACE();
+
+    if (td == NULL)
+        return;
+
+    td->num_centroids = 0;
+    td->num_buffer = 0;
+    td->total = 0.0;
+    td->min = 0.0;
+    td->max = 0.0;
+}
@@ -38,6 +38,8 @@ struct Rbt
 #define RBT_BLACK   0
 #define RBT_RED     1
 
+#define RBT_BATCH_LANES         16  /* lookups in flight in rbt_search_batch */
+
 #define SENTINEL_BUFFER_SIZE    16  /* provide allignment */
 #define SENTINEL_VALUE          (BYTE)-1
 #define SENTINEL_COLOR          RBT_BLACK
@@ -1028,6 +1030,8 @@ bool rbt_key_exist(const Rbt * ___restrict___ tree, const void * ___restrict___
    return rbt_node_search(tree, data_key) != NULL;
 }
 
+TREE_SEARCH_BATCH_CREATE(Rbt, Rbt_node, rbt, RBT_BATCH_LANES, sentinel)
+
 int rbt_to_array(const Rbt * ___restrict___ tree, void * ___restrict___ array, size_t * ___restrict___ size)
 {
     void *t;
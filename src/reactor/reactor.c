@@ -0,0 +1,1348 @@
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE /* accept4 */
+#endif
+
+#include <reactor.h>
+#include <tcp.h>
+#include <heap.h>
+#include <log.h>
+#include <common.h>
+#include <compiler.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#define REACTOR_HANDLE_LISTENER 0
+#define REACTOR_HANDLE_CONN     1
+#define REACTOR_HANDLE_WAKEUP   2
+
+/* first field of each object registered in epoll, epoll_event.data.ptr points to it */
+typedef struct Reactor_handle
+{
+    int     type;
+    int     fd;
+} Reactor_handle;
+
+typedef struct Reactor_listener
+{
+    Reactor_handle              handle;
+    Reactor_handlers            handlers;
+    struct Reactor_listener     *next;
+} Reactor_listener;
+
+/* data is in buf[begin, end) */
+typedef struct Reactor_buffer
+{
+    char    *buf;
+    size_t  begin;
+    size_t  end;
+    size_t  size;
+} Reactor_buffer;
+
+struct Reactor_conn
+{
+    Reactor_handle      handle;
+    Reactor             *reactor;
+    Reactor_handlers    handlers;
+    void                *data;
+
+    Reactor_buffer      in;
+    Reactor_buffer      out;
+
+    bool                connecting;
+    bool                closed;
+
+    Reactor_conn        *prev;  /* list of open connections */
+    Reactor_conn        *next;  /* list of open or closed connections */
+};
+
+struct Reactor_timer
+{
+    Reactor         *reactor;
+    Heap_entry      *entry;     /* NULL when timer callback is running */
+    uint64_t        interval;
+    reactor_timer_f cb;
+    void            *arg;
+    bool            cancelled;
+};
+
+/* data in timers heap, seq keeps order of timers with the same deadline */
+typedef struct Reactor_timer_key
+{
+    uint64_t        deadline;
+    uint64_t        seq;
+    Reactor_timer   *timer;
+} Reactor_timer_key;
+
+struct Reactor
+{
+    int                 epfd;
+    Reactor_handle      wakeup;     /* eventfd, reactor_stop from other threads */
+    int                 spare_fd;   /* closed to accept and drop connection when out of descriptors */
+    int                 stop;       /* atomic */
+
+    Heap                *timers;
+    uint64_t            timer_seq;
+
+    Reactor_listener    *listeners;
+    Reactor_conn        *conns;
+    Reactor_conn        *closed;    /* freed after events batch */
+    size_t              num_conns;
+};
+
+struct Reactor_pool
+{
+    Reactor     **reactors;
+    pthread_t   *threads;
+    size_t      num_reactors;
+    size_t      num_threads;    /* started */
+};
+
+/*
+    Get time from CLOCK_MONOTONIC in ms
+
+    PARAMS
+    NO PARAMS
+
+    RETURN
+    Time in ms
+*/
+static ___inline___ uint64_t __reactor_now_ms(void);
+
+/*
+    Compare timer keys by deadline then by seq
+
+    PARAMS
+    @IN a - pointer to Reactor_timer_key
+    @IN b - pointer to Reactor_timer_key
+
+    RETURN
+    -1 iff a < b
+    0 iff a == b
+    1 iff a > b
+*/
+static int __reactor_timer_cmp(const void *a, const void *b);
+
+/*
+    Insert timer to heap with deadline
+
+    PARAMS
+    @IN reactor - pointer to Reactor
+    @IN timer - pointer to timer
+    @IN deadline - deadline in ms
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+static int __reactor_timer_insert(Reactor *reactor, Reactor_timer *timer, uint64_t deadline);
+
+/*
+    Call callbacks of expired timers
+
+    PARAMS
+    @IN reactor - pointer to Reactor
+
+    RETURN
+    Number of called timers
+*/
+static size_t __reactor_timers_run(Reactor *reactor);
+
+/*
+    Get epoll_wait timeout (min of timeout_ms and time to nearest deadline)
+
+    PARAMS
+    @IN reactor - pointer to Reactor
+    @IN timeout_ms - user timeout, -1 means infinity
+
+    RETURN
+    Timeout for epoll_wait
+*/
+static int __reactor_get_timeout(const Reactor *reactor, int timeout_ms);
+
+/*
+    Make room for at least size bytes after buffer end (buffer keeps at most REACTOR_MAX_BUFFER bytes)
+
+    PARAMS
+    @IN buffer - pointer to buffer
+    @IN size - number of bytes
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+static int __reactor_buffer_reserve(Reactor_buffer *buffer, size_t size);
+
+/*
+    Create connection on socket and register it in epoll
+
+    PARAMS
+    @IN reactor - pointer to Reactor
+    @IN fd - non-blocking socket
+    @IN handlers - callbacks
+
+    RETURN
+    NULL iff failure
+    Pointer to new connection iff success
+*/
+static Reactor_conn *__reactor_conn_create(Reactor *reactor, int fd, const Reactor_handlers *handlers);
+
+/*
+    Send as many bytes from output buffer as possible
+
+    PARAMS
+    @IN conn - pointer to connection
+
+    RETURN
+    0 iff success (socket can be still writable or is full)
+    Non-zero value iff failure (connection has to be closed)
+*/
+static int __reactor_conn_flush(Reactor_conn *conn);
+
+/*
+    Read socket until EAGAIN or EOF and call on_read,
+    when input is full on_read is called before next read
+
+    PARAMS
+    @IN conn - pointer to connection
+
+    RETURN
+    This is a void function
+*/
+static void __reactor_conn_on_readable(Reactor_conn *conn);
+
+/*
+    Finish connecting or flush output buffer
+
+    PARAMS
+    @IN conn - pointer to connection
+
+    RETURN
+    This is a void function
+*/
+static void __reactor_conn_on_writable(Reactor_conn *conn);
+
+/*
+    Accept connections until EAGAIN
+
+    PARAMS
+    @IN reactor - pointer to Reactor
+    @IN listener - pointer to listener
+
+    RETURN
+    This is a void function
+*/
+static void __reactor_accept(Reactor *reactor, Reactor_listener *listener);
+
+/*
+    Free connections closed in last events batch
+
+    PARAMS
+    @IN reactor - pointer to Reactor
+
+    RETURN
+    This is a void function
+*/
+static void __reactor_free_closed(Reactor *reactor);
+
+/*
+    Thread of Reactor_pool
+
+    PARAMS
+    @IN arg - pointer to Reactor
+
+    RETURN
+    NULL
+*/
+static void *__reactor_pool_thread(void *arg);
+
+static ___inline___ uint64_t __reactor_now_ms(void)
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static int __reactor_timer_cmp(const void *a, const void *b)
+{
+    const Reactor_timer_key *ka = (const Reactor_timer_key *)a;
+    const Reactor_timer_key *kb = (const Reactor_timer_key *)b;
+
+    if (ka->deadline != kb->deadline)
+        return ka->deadline < kb->deadline ? -1 : 1;
+
+    if (ka->seq != kb->seq)
+        return ka->seq < kb->seq ? -1 : 1;
+
+    return 0;
+}
+
+static int __reactor_timer_insert(Reactor *reactor, Reactor_timer *timer, uint64_t deadline)
+{
+    Reactor_timer_key key;
+
+    TRACE();
+
+    key.deadline = deadline;
+    key.seq = ++reactor->timer_seq;
+    key.timer = timer;
+
+    timer->entry = heap_entry_create((const void *)&key, sizeof(key));
+    if (timer->entry == NULL)
+        ERROR("heap_entry_create error\n", 1);
+
+    if (heap_insert(reactor->timers, timer->entry))
+    {
+        heap_entry_destroy(timer->entry);
+        timer->entry = NULL;
+        ERROR("heap_insert error\n", 1);
+    }
+
+    return 0;
+}
+
+static size_t __reactor_timers_run(Reactor *reactor)
+{
+    Heap_entry *entry;
+    Reactor_timer_key key;
+    Reactor_timer *timer;
+    uint64_t now;
+    uint64_t deadline;
+    size_t called = 0;
+
+    TRACE();
+
+    now = __reactor_now_ms();
+    while (!heap_is_empty(reactor->timers))
+    {
+        (void)heap_entry_get_data(heap_get_top(reactor->timers), (void *)&key);
+        if (key.deadline > now)
+            break;
+
+        entry = heap_extract_top(reactor->timers);
+        heap_entry_destroy(entry);
+
+        timer = key.timer;
+        timer->entry = NULL;
+
+        /* reactor_timer_cancel could not remove timer from heap */
+        if (timer->cancelled)
+        {
+            FREE(timer);
+            continue;
+        }
+
+        timer->cb(reactor, timer, timer->arg);
+        ++called;
+
+        if (timer->interval == 0 || timer->cancelled)
+        {
+            FREE(timer);
+            continue;
+        }
+
+        /* don't fire periodic timer many times in a row after long callback */
+        deadline = key.deadline + timer->interval;
+        if (deadline <= now)
+            deadline = now + timer->interval;
+
+        if (__reactor_timer_insert(reactor, timer, deadline))
+        {
+            LOG("Periodic timer dropped\n");
+            FREE(timer);
+        }
+    }
+
+    return called;
+}
+
+static int __reactor_get_timeout(const Reactor *reactor, int timeout_ms)
+{
+    Reactor_timer_key key;
+    uint64_t now;
+    uint64_t left;
+
+    if (heap_is_empty(reactor->timers))
+        return timeout_ms;
+
+    (void)heap_entry_get_data(heap_get_top(reactor->timers), (void *)&key);
+    now = __reactor_now_ms();
+    left = key.deadline > now ? key.deadline - now : 0;
+
+    if (timeout_ms >= 0 && (uint64_t)timeout_ms < left)
+        return timeout_ms;
+
+    /* left can be huge, but int timeout is enough, loop wakes up earlier and computes again */
+    if (left > INT32_MAX)
+        return INT32_MAX;
+
+    return (int)left;
+}
+
+static int __reactor_buffer_reserve(Reactor_buffer *buffer, size_t size)
+{
+    size_t len;
+    size_t new_size;
+    char *new_buf;
+
+    if (buffer->size - buffer->end >= size)
+        return 0;
+
+    len = buffer->end - buffer->begin;
+    if (size > REACTOR_MAX_BUFFER - len)
+        ERROR("buffer is full\n", 1);
+
+    if (buffer->begin > 0)
+    {
+        (void)memmove(buffer->buf, buffer->buf + buffer->begin, len);
+        buffer->begin = 0;
+        buffer->end = len;
+    }
+
+    if (buffer->size - len >= size)
+        return 0;
+
+    new_size = buffer->size == 0 ? REACTOR_READ_CHUNK : buffer->size;
+    while (new_size - len < size)
+        new_size <<= 1;
+
+    new_buf = (char *)realloc(buffer->buf, new_size);
+    if (new_buf == NULL)
+        ERROR("realloc error\n", 1);
+
+    buffer->buf = new_buf;
+    buffer->size = new_size;
+
+    return 0;
+}
+
+static Reactor_conn *__reactor_conn_create(Reactor *reactor, int fd, const Reactor_handlers *handlers)
+{
+    Reactor_conn *conn;
+    struct epoll_event ev;
+    int on = 1;
+
+    TRACE();
+
+    conn = (Reactor_conn *)calloc(1, sizeof(Reactor_conn));
+    if (conn == NULL)
+        ERROR("calloc error\n", NULL);
+
+    conn->handle.type = REACTOR_HANDLE_CONN;
+    conn->handle.fd = fd;
+    conn->reactor = reactor;
+    if (handlers != NULL)
+        conn->handlers = *handlers;
+
+    /* small request - response messages, don't wait for more data */
+    (void)setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.ptr = (void *)&conn->handle;
+    if (epoll_ctl(reactor->epfd, EPOLL_CTL_ADD, fd, &ev) == -1)
+    {
+        FREE(conn);
+        ERROR("epoll_ctl error\n", NULL);
+    }
+
+    conn->next = reactor->conns;
+    if (reactor->conns != NULL)
+        reactor->conns->prev = conn;
+
+    reactor->conns = conn;
+    ++reactor->num_conns;
+
+    return conn;
+}
+
+static int __reactor_conn_flush(Reactor_conn *conn)
+{
+    ssize_t n;
+
+    TRACE();
+
+    while (conn->out.begin < conn->out.end)
+    {
+        n = send(conn->handle.fd, conn->out.buf + conn->out.begin, conn->out.end - conn->out.begin, MSG_NOSIGNAL);
+        if (n == -1)
+        {
+            if (errno == EINTR)
+                continue;
+
+            if (errno == EAGAIN)
+                return 0;
+
+            ERROR("send error\n", 1);
+        }
+
+        conn->out.begin += (size_t)n;
+    }
+
+    conn->out.begin = 0;
+    conn->out.end = 0;
+
+    return 0;
+}
+
+static void __reactor_conn_on_readable(Reactor_conn *conn)
+{
+    ssize_t n;
+    size_t len;
+    size_t room;
+    bool eof = false;
+    bool got = false;
+
+    TRACE();
+
+    /* edge triggered, so read until EAGAIN even after short read, FIN may be behind data */
+    for (;;)
+    {
+        len = conn->in.end - conn->in.begin;
+        if (len == REACTOR_MAX_BUFFER)
+        {
+            if (conn->handlers.on_read != NULL)
+                conn->handlers.on_read(conn, conn->handlers.arg);
+
+            got = false;
+            if (conn->closed)
+                return;
+
+            if (conn->in.end - conn->in.begin == REACTOR_MAX_BUFFER)
+            {
+                LOG("Connection %d input is full\n", conn->handle.fd);
+                eof = true;
+                break;
+            }
+
+            continue;
+        }
+
+        if (__reactor_buffer_reserve(&conn->in, MIN((size_t)REACTOR_READ_CHUNK, (size_t)REACTOR_MAX_BUFFER - len)))
+        {
+            eof = true;
+            break;
+        }
+
+        room = MIN(conn->in.size - conn->in.end, (size_t)REACTOR_MAX_BUFFER - len);
+        n = recv(conn->handle.fd, conn->in.buf + conn->in.end, room, 0);
+        if (n > 0)
+        {
+            conn->in.end += (size_t)n;
+            got = true;
+            continue;
+        }
+
+        if (n == -1 && errno == EINTR)
+            continue;
+
+        if (n == -1 && errno == EAGAIN)
+            break;
+
+        /* n == 0 (peer closed) or error */
+        eof = true;
+        break;
+    }
+
+    if (got && conn->handlers.on_read != NULL)
+        conn->handlers.on_read(conn, conn->handlers.arg);
+
+    if (eof)
+        reactor_conn_close(conn);
+}
+
+static void __reactor_conn_on_writable(Reactor_conn *conn)
+{
+    int err = 0;
+    socklen_t len = sizeof(err);
+
+    TRACE();
+
+    if (conn->connecting)
+    {
+        if (getsockopt(conn->handle.fd, SOL_SOCKET, SO_ERROR, &err, &len) == -1 || err != 0)
+        {
+            LOG("Connection %d failed\n", conn->handle.fd);
+            reactor_conn_close(conn);
+            return;
+        }
+
+        conn->connecting = false;
+        if (conn->handlers.on_open != NULL)
+            conn->handlers.on_open(conn, conn->handlers.arg);
+
+        if (conn->closed)
+            return;
+    }
+
+    if (__reactor_conn_flush(conn))
+        reactor_conn_close(conn);
+}
+
+static void __reactor_accept(Reactor *reactor, Reactor_listener *listener)
+{
+    int fd;
+    Reactor_conn *conn;
+
+    TRACE();
+
+    for (;;)
+    {
+        fd = accept4(listener->handle.fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd == -1)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+
+            /*
+                Edge triggered listener does not report connections left in queue again,
+                so when out of descriptors use spare one to accept and drop them
+            */
+            if ((errno == EMFILE || errno == ENFILE) && reactor->spare_fd != -1)
+            {
+                close(reactor->spare_fd);
+                fd = accept4(listener->handle.fd, NULL, NULL, SOCK_CLOEXEC);
+                if (fd != -1)
+                {
+                    LOG("Connection %d dropped, out of descriptors\n", fd);
+                    close(fd);
+                }
+
+                reactor->spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+                if (fd != -1)
+                    continue;
+            }
+
+            if (errno != EAGAIN)
+                LOG("accept error: %s\n", strerror(errno));
+
+            return;
+        }
+
+        conn = __reactor_conn_create(reactor, fd, &listener->handlers);
+        if (conn == NULL)
+        {
+            close(fd);
+            continue;
+        }
+
+        LOG("Connection %d accepted\n", fd);
+
+        if (conn->handlers.on_open != NULL)
+            conn->handlers.on_open(conn, conn->handlers.arg);
+    }
+}
+
+static void __reactor_free_closed(Reactor *reactor)
+{
+    Reactor_conn *conn;
+
+    while (reactor->closed != NULL)
+    {
+        conn = reactor->closed;
+        reactor->closed = conn->next;
+
+        FREE(conn->in.buf);
+        FREE(conn->out.buf);
+        FREE(conn);
+    }
+}
+
+static void *__reactor_pool_thread(void *arg)
+{
+    (void)reactor_run((Reactor *)arg);
+
+    return NULL;
+}
+
+Reactor *reactor_create(void)
+{
+    Reactor *reactor;
+    struct epoll_event ev;
+
+    TRACE();
+
+    reactor = (Reactor *)calloc(1, sizeof(Reactor));
+    if (reactor == NULL)
+        ERROR("calloc error\n", NULL);
+
+    reactor->timers = heap_create(HEAP_MIN, sizeof(Reactor_timer_key), 2, __reactor_timer_cmp, NULL);
+    if (reactor->timers == NULL)
+    {
+        FREE(reactor);
+        ERROR("heap_create error\n", NULL);
+    }
+
+    reactor->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (reactor->epfd == -1)
+    {
+        heap_destroy(reactor->timers);
+        FREE(reactor);
+        ERROR("epoll_create1 error\n", NULL);
+    }
+
+    reactor->spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    if (reactor->spare_fd == -1)
+    {
+        close(reactor->epfd);
+        heap_destroy(reactor->timers);
+        FREE(reactor);
+        ERROR("open error\n", NULL);
+    }
+
+    reactor->wakeup.type = REACTOR_HANDLE_WAKEUP;
+    reactor->wakeup.fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (reactor->wakeup.fd == -1)
+    {
+        close(reactor->spare_fd);
+        close(reactor->epfd);
+        heap_destroy(reactor->timers);
+        FREE(reactor);
+        ERROR("eventfd error\n", NULL);
+    }
+
+    ev.events = EPOLLIN;
+    ev.data.ptr = (void *)&reactor->wakeup;
+    if (epoll_ctl(reactor->epfd, EPOLL_CTL_ADD, reactor->wakeup.fd, &ev) == -1)
+    {
+        close(reactor->wakeup.fd);
+        close(reactor->spare_fd);
+        close(reactor->epfd);
+        heap_destroy(reactor->timers);
+        FREE(reactor);
+        ERROR("epoll_ctl error\n", NULL);
+    }
+
+    return reactor;
+}
+
+void reactor_destroy(Reactor *reactor)
+{
+    Reactor_listener *listener;
+    Heap_entry *entry;
+    Reactor_timer_key key;
+
+    TRACE();
+
+    if (reactor == NULL)
+        return;
+
+    while (reactor->listeners != NULL)
+    {
+        listener = reactor->listeners;
+        reactor->listeners = listener->next;
+
+        tcp_socket_destroy(listener->handle.fd);
+        FREE(listener);
+    }
+
+    while (reactor->conns != NULL)
+        reactor_conn_close(reactor->conns);
+
+    __reactor_free_closed(reactor);
+
+    while (!heap_is_empty(reactor->timers))
+    {
+        entry = heap_extract_top(reactor->timers);
+        (void)heap_entry_get_data(entry, (void *)&key);
+        heap_entry_destroy(entry);
+        FREE(key.timer);
+    }
+
+    heap_destroy(reactor->timers);
+    close(reactor->wakeup.fd);
+    if (reactor->spare_fd != -1)
+        close(reactor->spare_fd);
+
+    close(reactor->epfd);
+    FREE(reactor);
+}
+
+int reactor_listen(Reactor * ___restrict___ reactor, const char * ___restrict___ host_name, int port,
+                   const Reactor_handlers * ___restrict___ handlers, bool reuseport)
+{
+    Reactor_listener *listener;
+    struct epoll_event ev;
+    int flags = TCP_SOCKET_REUSEADDR | TCP_SOCKET_NONBLOCK;
+
+    TRACE();
+
+    if (reactor == NULL)
+        ERROR("reactor == NULL\n", 1);
+
+    if (host_name == NULL)
+        ERROR("host_name == NULL\n", 1);
+
+    if (handlers == NULL)
+        ERROR("handlers == NULL\n", 1);
+
+    if (reuseport)
+        flags |= TCP_SOCKET_REUSEPORT;
+
+    listener = (Reactor_listener *)calloc(1, sizeof(Reactor_listener));
+    if (listener == NULL)
+        ERROR("calloc error\n", 1);
+
+    listener->handle.type = REACTOR_HANDLE_LISTENER;
+    listener->handlers = *handlers;
+
+    listener->handle.fd = tcp_socket_create_with_flags(host_name, port, flags);
+    if (listener->handle.fd == -1)
+    {
+        FREE(listener);
+        ERROR("tcp_socket_create_with_flags error\n", 1);
+    }
+
+    if (listen(listener->handle.fd, SOMAXCONN) == -1)
+    {
+        tcp_socket_destroy(listener->handle.fd);
+        FREE(listener);
+        ERROR("listen error\n", 1);
+    }
+
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.ptr = (void *)&listener->handle;
+    if (epoll_ctl(reactor->epfd, EPOLL_CTL_ADD, listener->handle.fd, &ev) == -1)
+    {
+        tcp_socket_destroy(listener->handle.fd);
+        FREE(listener);
+        ERROR("epoll_ctl error\n", 1);
+    }
+
+    listener->next = reactor->listeners;
+    reactor->listeners = listener;
+
+    LOG("Listening on %s:%d\n", host_name, port);
+
+    return 0;
+}
+
+Reactor_conn *reactor_connect(Reactor * ___restrict___ reactor, const char * ___restrict___ host_name, int port,
+                              const Reactor_handlers * ___restrict___ handlers)
+{
+    struct sockaddr_in sn = {0};
+    struct hostent *he;
+    Reactor_conn *conn;
+    int fd;
+    int ret;
+
+    TRACE();
+
+    if (reactor == NULL)
+        ERROR("reactor == NULL\n", NULL);
+
+    if (host_name == NULL)
+        ERROR("host_name == NULL\n", NULL);
+
+    he = gethostbyname(host_name);
+    if (he == NULL)
+        ERROR("gethostbyname error\n", NULL);
+
+    sn.sin_family = AF_INET;
+    sn.sin_port = htons((unsigned short)port);
+    sn.sin_addr = *(struct in_addr *)(he->h_addr_list[0]);
+
+    fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == -1)
+        ERROR("socket create error\n", NULL);
+
+    ret = connect(fd, (struct sockaddr *)&sn, sizeof(sn));
+    if (ret == -1 && errno != EINPROGRESS)
+    {
+        close(fd);
+        ERROR("connect error\n", NULL);
+    }
+
+    conn = __reactor_conn_create(reactor, fd, handlers);
+    if (conn == NULL)
+    {
+        close(fd);
+        ERROR("__reactor_conn_create error\n", NULL);
+    }
+
+    /* EPOLLOUT comes when connection is established or failed */
+    conn->connecting = ret == -1;
+
+    if (!conn->connecting && conn->handlers.on_open != NULL)
+        conn->handlers.on_open(conn, conn->handlers.arg);
+
+    return conn;
+}
+
+int reactor_conn_write(Reactor_conn * ___restrict___ conn, const void * ___restrict___ data, size_t size)
+{
+    ssize_t n = 0;
+
+    TRACE();
+
+    if (conn == NULL)
+        ERROR("conn == NULL\n", 1);
+
+    if (data == NULL && size > 0)
+        ERROR("data == NULL\n", 1);
+
+    if (conn->closed)
+        ERROR("connection is closed\n", 1);
+
+    if (size == 0)
+        return 0;
+
+    if (size > REACTOR_MAX_BUFFER - (conn->out.end - conn->out.begin))
+        ERROR("output is full\n", 1);
+
+    /* fast path, nothing is waiting so send directly without copy */
+    if (!conn->connecting && conn->out.begin == conn->out.end)
+    {
+        do {
+            n = send(conn->handle.fd, data, size, MSG_NOSIGNAL);
+        } while (n == -1 && errno == EINTR);
+
+        if (n == -1)
+        {
+            if (errno != EAGAIN)
+                ERROR("send error\n", 1);
+
+            n = 0;
+        }
+
+        if ((size_t)n == size)
+            return 0;
+    }
+
+    if (__reactor_buffer_reserve(&conn->out, size - (size_t)n))
+        ERROR("__reactor_buffer_reserve error\n", 1);
+
+    (void)memcpy(conn->out.buf + conn->out.end, (const char *)data + n, size - (size_t)n);
+    conn->out.end += size - (size_t)n;
+
+    return 0;
+}
+
+const void *reactor_conn_get_input(const Reactor_conn * ___restrict___ conn, size_t * ___restrict___ size)
+{
+    TRACE();
+
+    if (conn == NULL)
+        ERROR("conn == NULL\n", NULL);
+
+    if (size == NULL)
+        ERROR("size == NULL\n", NULL);
+
+    *size = conn->in.end - conn->in.begin;
+
+    return (const void *)(conn->in.buf + conn->in.begin);
+}
+
+int reactor_conn_consume(Reactor_conn *conn, size_t size)
+{
+    TRACE();
+
+    if (conn == NULL)
+        ERROR("conn == NULL\n", 1);
+
+    if (size > conn->in.end - conn->in.begin)
+        ERROR("size > input size\n", 1);
+
+    conn->in.begin += size;
+    if (conn->in.begin == conn->in.end)
+    {
+        conn->in.begin = 0;
+        conn->in.end = 0;
+    }
+
+    return 0;
+}
+
+void reactor_conn_close(Reactor_conn *conn)
+{
+    Reactor *reactor;
+
+    TRACE();
+
+    if (conn == NULL || conn->closed)
+        return;
+
+    reactor = conn->reactor;
+    conn->closed = true;
+
+    if (!conn->connecting)
+        (void)__reactor_conn_flush(conn);
+
+    (void)epoll_ctl(reactor->epfd, EPOLL_CTL_DEL, conn->handle.fd, NULL);
+    close(conn->handle.fd);
+
+    LOG("Connection %d closed\n", conn->handle.fd);
+
+    conn->handle.fd = -1;
+
+    if (conn->prev != NULL)
+        conn->prev->next = conn->next;
+    else
+        reactor->conns = conn->next;
+
+    if (conn->next != NULL)
+        conn->next->prev = conn->prev;
+
+    --reactor->num_conns;
+
+    if (conn->handlers.on_close != NULL)
+        conn->handlers.on_close(conn, conn->handlers.arg);
+
+    conn->prev = NULL;
+    conn->next = reactor->closed;
+    reactor->closed = conn;
+}
+
+int reactor_conn_get_fd(const Reactor_conn *conn)
+{
+    TRACE();
+
+    if (conn == NULL)
+        ERROR("conn == NULL\n", -1);
+
+    return conn->handle.fd;
+}
+
+ssize_t reactor_conn_get_pending(const Reactor_conn *conn)
+{
+    TRACE();
+
+    if (conn == NULL)
+        ERROR("conn == NULL\n", -1);
+
+    return (ssize_t)(conn->out.end - conn->out.begin);
+}
+
+Reactor *reactor_conn_get_reactor(const Reactor_conn *conn)
+{
+    TRACE();
+
+    if (conn == NULL)
+        ERROR("conn == NULL\n", NULL);
+
+    return conn->reactor;
+}
+
+void reactor_conn_set_data(Reactor_conn *conn, void *data)
+{
+    TRACE();
+
+    if (conn == NULL)
+        return;
+
+    conn->data = data;
+}
+
+void *reactor_conn_get_data(const Reactor_conn *conn)
+{
+    TRACE();
+
+    if (conn == NULL)
+        ERROR("conn == NULL\n", NULL);
+
+    return conn->data;
+}
+
+Reactor_timer *reactor_timer_add(Reactor *reactor, uint64_t delay_ms, uint64_t interval_ms, reactor_timer_f cb, void *arg)
+{
+    Reactor_timer *timer;
+
+    TRACE();
+
+    if (reactor == NULL)
+        ERROR("reactor == NULL\n", NULL);
+
+    if (cb == NULL)
+        ERROR("cb == NULL\n", NULL);
+
+    timer = (Reactor_timer *)calloc(1, sizeof(Reactor_timer));
+    if (timer == NULL)
+        ERROR("calloc error\n", NULL);
+
+    timer->reactor = reactor;
+    timer->interval = interval_ms;
+    timer->cb = cb;
+    timer->arg = arg;
+
+    if (__reactor_timer_insert(reactor, timer, __reactor_now_ms() + delay_ms))
+    {
+        FREE(timer);
+        ERROR("__reactor_timer_insert error\n", NULL);
+    }
+
+    return timer;
+}
+
+void reactor_timer_cancel(Reactor_timer *timer)
+{
+    Reactor_timer_key key = {0};
+    Heap_entry *entry;
+    Heap *timers;
+
+    TRACE();
+
+    if (timer == NULL)
+        return;
+
+    /* in own callback, timer is not in heap, __reactor_timers_run frees it */
+    if (timer->entry == NULL)
+    {
+        timer->cancelled = true;
+        return;
+    }
+
+    /* key {0, 0} is less than any other key, so timer goes to the top and can be extracted */
+    timers = timer->reactor->timers;
+    key.timer = timer;
+    if (heap_change_key(timers, (size_t)heap_entry_get_pos(timer->entry), (const void *)&key))
+    {
+        timer->cancelled = true;
+        return;
+    }
+
+    entry = heap_extract_top(timers);
+    heap_entry_destroy(entry);
+    FREE(timer);
+}
+
+ssize_t reactor_get_num_timers(const Reactor *reactor)
+{
+    TRACE();
+
+    if (reactor == NULL)
+        ERROR("reactor == NULL\n", -1);
+
+    return heap_get_num_entries(reactor->timers);
+}
+
+ssize_t reactor_get_num_conns(const Reactor *reactor)
+{
+    TRACE();
+
+    if (reactor == NULL)
+        ERROR("reactor == NULL\n", -1);
+
+    return (ssize_t)reactor->num_conns;
+}
+
+ssize_t reactor_run_once(Reactor *reactor, int timeout_ms)
+{
+    struct epoll_event events[REACTOR_MAX_EVENTS];
+    Reactor_handle *handle;
+    Reactor_conn *conn;
+    uint64_t val;
+    int n;
+    int i;
+
+    TRACE();
+
+    if (reactor == NULL)
+        ERROR("reactor == NULL\n", -1);
+
+    n = epoll_wait(reactor->epfd, events, REACTOR_MAX_EVENTS, __reactor_get_timeout(reactor, timeout_ms));
+    if (n == -1)
+    {
+        if (errno != EINTR)
+            ERROR("epoll_wait error\n", -1);
+
+        n = 0;
+    }
+
+    for (i = 0; i < n; ++i)
+    {
+        handle = (Reactor_handle *)events[i].data.ptr;
+        switch (handle->type)
+        {
+            case REACTOR_HANDLE_LISTENER:
+            {
+                __reactor_accept(reactor, (Reactor_listener *)handle);
+                break;
+            }
+            case REACTOR_HANDLE_CONN:
+            {
+                conn = (Reactor_conn *)handle;
+
+                /* closed by callback of previous event in this batch */
+                if (conn->closed)
+                    break;
+
+                if (events[i].events & EPOLLOUT)
+                    __reactor_conn_on_writable(conn);
+
+                if (!conn->closed && (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)))
+                    __reactor_conn_on_readable(conn);
+
+                break;
+            }
+            case REACTOR_HANDLE_WAKEUP:
+            {
+                if (read(handle->fd, &val, sizeof(val)) == -1)
+                    LOG("eventfd read error\n");
+
+                break;
+            }
+            default:
+            {
+                LOG("Unknown handle type %d\n", handle->type);
+                break;
+            }
+        }
+    }
+
+    n += (int)__reactor_timers_run(reactor);
+    __reactor_free_closed(reactor);
+
+    return (ssize_t)n;
+}
+
+int reactor_run(Reactor *reactor)
+{
+    TRACE();
+
+    if (reactor == NULL)
+        ERROR("reactor == NULL\n", 1);
+
+    while (!__atomic_load_n(&reactor->stop, __ATOMIC_ACQUIRE))
+        if (reactor_run_once(reactor, -1) == -1)
+            ERROR("reactor_run_once error\n", 1);
+
+    __atomic_store_n(&reactor->stop, 0, __ATOMIC_RELEASE);
+
+    return 0;
+}
+
+void reactor_stop(Reactor *reactor)
+{
+    uint64_t val = 1;
+
+    TRACE();
+
+    if (reactor == NULL)
+        return;
+
+    __atomic_store_n(&reactor->stop, 1, __ATOMIC_RELEASE);
+    if (write(reactor->wakeup.fd, &val, sizeof(val)) == -1)
+        LOG("eventfd write error\n");
+}
+
+Reactor_pool *reactor_pool_create(size_t num_reactors)
+{
+    Reactor_pool *pool;
+    size_t i;
+
+    TRACE();
+
+    if (num_reactors == 0)
+        ERROR("num_reactors == 0\n", NULL);
+
+    pool = (Reactor_pool *)calloc(1, sizeof(Reactor_pool));
+    if (pool == NULL)
+        ERROR("calloc error\n", NULL);
+
+    pool->reactors = (Reactor **)calloc(num_reactors, sizeof(Reactor *));
+    pool->threads = (pthread_t *)calloc(num_reactors, sizeof(pthread_t));
+    if (pool->reactors == NULL || pool->threads == NULL)
+    {
+        FREE(pool->reactors);
+        FREE(pool->threads);
+        FREE(pool);
+        ERROR("calloc error\n", NULL);
+    }
+
+    pool->num_reactors = num_reactors;
+    for (i = 0; i < num_reactors; ++i)
+    {
+        pool->reactors[i] = reactor_create();
+        if (pool->reactors[i] == NULL)
+        {
+            reactor_pool_destroy(pool);
+            ERROR("reactor_create error\n", NULL);
+        }
+    }
+
+    return pool;
+}
+
+void reactor_pool_destroy(Reactor_pool *pool)
+{
+    size_t i;
+
+    TRACE();
+
+    if (pool == NULL)
+        return;
+
+    for (i = 0; i < pool->num_threads; ++i)
+        reactor_stop(pool->reactors[i]);
+
+    for (i = 0; i < pool->num_threads; ++i)
+        (void)pthread_join(pool->threads[i], NULL);
+
+    for (i = 0; i < pool->num_reactors; ++i)
+        reactor_destroy(pool->reactors[i]);
+
+    FREE(pool->reactors);
+    FREE(pool->threads);
+    FREE(pool);
+}
+
+int reactor_pool_listen(Reactor_pool * ___restrict___ pool, const char * ___restrict___ host_name, int port,
+                        const Reactor_handlers * ___restrict___ handlers)
+{
+    size_t i;
+
+    TRACE();
+
+    if (pool == NULL)
+        ERROR("pool == NULL\n", 1);
+
+    if (pool->num_threads > 0)
+        ERROR("pool is already started\n", 1);
+
+    for (i = 0; i < pool->num_reactors; ++i)
+        if (reactor_listen(pool->reactors[i], host_name, port, handlers, true))
+            ERROR("reactor_listen error\n", 1);
+
+    return 0;
+}
+
+int reactor_pool_start(Reactor_pool *pool)
+{
+    TRACE();
+
+    if (pool == NULL)
+        ERROR("pool == NULL\n", 1);
+
+    if (pool->num_threads > 0)
+        ERROR("pool is already started\n", 1);
+
+    for (; pool->num_threads < pool->num_reactors; ++pool->num_threads)
+        if (pthread_create(&pool->threads[pool->num_threads], NULL, __reactor_pool_thread, (void *)pool->reactors[pool->num_threads]))
+            ERROR("pthread_create error\n", 1);
+
+    return 0;
+}
+
+Reactor *reactor_pool_get(const Reactor_pool *pool, size_t i)
+{
+    TRACE();
+
+    if (pool == NULL)
+        ERROR("pool == NULL\n", NULL);
+
+    if (i >= pool->num_reactors)
+        ERROR("i >= num_reactors\n", NULL);
+
+    return pool->reactors[i];
+}
@@ -0,0 +1,1965 @@
+#include <generic.h>
+#include <roaring.h>
+#include <log.h>
+#include <common.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ROARING_KEY(val)            ((uint16_t)((val) >> 16))
+#define ROARING_LOW(val)            ((uint16_t)((val) & 0xFFFF))
+#define ROARING_VALUE(key, low)     (((uint32_t)(key) << 16) | (uint32_t)(low))
+
+#define ROARING_CHUNK_SIZE          ((uint32_t)BIT(16))
+#define ROARING_ARRAY_MAX           4096
+#define ROARING_BITMAP_WORDS        (ROARING_CHUNK_SIZE / (sizeof(uint64_t) << 3))
+#define ROARING_BITMAP_BYTES        (ROARING_BITMAP_WORDS * sizeof(uint64_t))
+
+#define ROARING_INIT_CONTAINERS     4
+#define ROARING_INIT_ARRAY          4
+
+/* "RBM1" in little endian */
+#define ROARING_MAGIC               0x314D4252U
+#define ROARING_HEADER_SIZE         8
+#define ROARING_CONTAINER_HDR_SIZE  16
+
+typedef enum roaring_container_type
+{
+    ROARING_ARRAY = 0,
+    ROARING_BITMAP,
+    ROARING_RUN
+} roaring_container_type_t;
+
+typedef struct Roaring_container
+{
+    void                        *data;      /* ARRAY: uint16_t[], BITMAP: uint64_t[], RUN: uint16_t pairs (start, len - 1) */
+    size_t                      size;       /* ARRAY: num of values, RUN: num of runs, BITMAP: num of words */
+    size_t                      capacity;   /* ARRAY / RUN: allocated entries */
+    size_t                      cardinality;
+    uint16_t                    key;
+    roaring_container_type_t    type;
+} Roaring_container;
+
+struct Roaring
+{
+    Roaring_container   *containers; /* sorted by key */
+    size_t              num_containers;
+    size_t              capacity;
+};
+
+struct Roaring_iterator
+{
+    const Roaring_container *containers;
+    size_t                  num_containers;
+    ssize_t                 index;
+    uint16_t                low;
+};
+
+/*
+    Find first entry in sorted array greater or equal than @val
+
+    PARAMS
+    @IN array - sorted array
+    @IN size - array length
+    @IN val - value
+
+    RETURN
+    Index of entry (size iff all entries are lower than @val)
+*/
+static ___inline___ size_t __roaring_array_lower_bound(const uint16_t *array, size_t size, uint32_t val);
+
+/*
+    Find first run which ends at position greater or equal than @val
+
+    PARAMS
+    @IN runs - array of runs
+    @IN size - number of runs
+    @IN val - value
+
+    RETURN
+    Index of run (size iff all runs end before @val)
+*/
+static ___inline___ size_t __roaring_run_lower_bound(const uint16_t *runs, size_t size, uint32_t val);
+
+/*
+    Set bits [start; end] in bitmap
+
+    PARAMS
+    @IN words - bitmap
+    @IN start - first bit
+    @IN end - last bit
+
+    RETURN
+    This is a void function
+*/
+static void __roaring_bitmap_set_range(uint64_t *words, uint32_t start, uint32_t end);
+
+/*
+    Init empty container
+
+    PARAMS
+    @OUT container - pointer to container
+    @IN key - high 16 bits
+    @IN type - container type
+    @IN capacity - num of entries (ignored for BITMAP)
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+static int __roaring_container_init(Roaring_container *container, uint16_t key, roaring_container_type_t type, size_t capacity);
+
+/*
+    Get size of container data in bytes
+
+    PARAMS
+    @IN container - pointer to container
+
+    RETURN
+    Size of used part of data
+*/
+static ___inline___ size_t __roaring_container_data_size(const Roaring_container *container);
+
+/*
+    Make a copy of container
+
+    PARAMS
+    @OUT dst - pointer to new container
+    @IN src - pointer to container
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+static int __roaring_container_clone(Roaring_container * ___restrict___ dst, const Roaring_container * ___restrict___ src);
+
+/*
+    Check existence of low 16 bits in container
+
+    PARAMS
+    @IN container - pointer to container
+    @IN low - low 16 bits
+
+    RETURN
+    true iff value exists
+    false iff value doesn't exist
+*/
+static bool __roaring_container_contains(const Roaring_container *container, uint16_t low);
+
+/*
+    Decompress any container into bitmap
+
+    PARAMS
+    @IN container - pointer to container
+    @OUT words - bitmap (ROARING_BITMAP_WORDS words)
+
+    RETURN
+    This is a void function
+*/
+static void __roaring_container_to_bitmap(const Roaring_container * ___restrict___ container, uint64_t * ___restrict___ words);
+
+/*
+    Create ARRAY or BITMAP container (depends on cardinality) from bitmap
+
+    PARAMS
+    @OUT container - pointer to container
+    @IN key - high 16 bits
+    @IN words - bitmap (ROARING_BITMAP_WORDS words)
+
+    RETURN
+    0 iff success (container with cardinality == 0 has no data)
+    Non-zero value iff failure
+*/
+static int __roaring_container_from_bitmap(Roaring_container * ___restrict___ container, uint16_t key, const uint64_t * ___restrict___ words);
+
+/*
+    Create RUN container from bitmap
+
+    PARAMS
+    @OUT container - pointer to container
+    @IN key - high 16 bits
+    @IN words - bitmap (ROARING_BITMAP_WORDS words)
+    @IN runs - number of runs in bitmap
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+static int __roaring_container_runs_from_bitmap(Roaring_container * ___restrict___ container, uint16_t key, const uint64_t * ___restrict___ words, size_t runs);
+
+/*
+    Count runs of ones in bitmap
+
+    PARAMS
+    @IN words - bitmap (ROARING_BITMAP_WORDS words)
+
+    RETURN
+    Number of runs
+*/
+static size_t __roaring_bitmap_count_runs(const uint64_t *words);
+
+/*
+    Add / Remove low 16 bits to / from container
+
+    PARAMS
+    @IN container - pointer to container
+    @IN low - low 16 bits
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+static int __roaring_container_add(Roaring_container *container, uint16_t low);
+static int __roaring_container_remove(Roaring_container *container, uint16_t low);
+
+/*
+    Find smallest value >= @from / greatest value <= @from in container
+
+    PARAMS
+    @IN container - pointer to container
+    @IN from - low 16 bits
+    @OUT low - found value
+
+    RETURN
+    true iff value has been found
+    false iff there is no such value
+*/
+static bool __roaring_container_next(const Roaring_container * ___restrict___ container, uint32_t from, uint16_t * ___restrict___ low);
+static bool __roaring_container_prev(const Roaring_container * ___restrict___ container, uint32_t from, uint16_t * ___restrict___ low);
+
+/*
+    Write all values from container into array
+
+    PARAMS
+    @IN container - pointer to container
+    @OUT out - array for values
+
+    RETURN
+    Number of written values
+*/
+static size_t __roaring_container_to_values(const Roaring_container * ___restrict___ container, uint32_t * ___restrict___ out);
+
+/*
+    Find container with @key
+
+    PARAMS
+    @IN roaring - pointer to roaring bitmap
+    @IN key - high 16 bits
+
+    RETURN
+    Index of first container with key >= @key
+*/
+static size_t __roaring_lower_bound(const Roaring *roaring, uint16_t key);
+
+/*
+    Insert container into roaring at @pos (container is moved, not copied)
+
+    PARAMS
+    @IN roaring - pointer to roaring bitmap
+    @IN pos - position
+    @IN container - pointer to container
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+static int __roaring_insert_container(Roaring * ___restrict___ roaring, size_t pos, const Roaring_container * ___restrict___ container);
+
+/*
+    Delete container at @pos
+
+    PARAMS
+    @IN roaring - pointer to roaring bitmap
+    @IN pos - position
+
+    RETURN
+    This is a void function
+*/
+static void __roaring_delete_container(Roaring *roaring, size_t pos);
+
+/*
+    Append copy of container at the end of roaring
+
+    PARAMS
+    @IN roaring - pointer to roaring bitmap
+    @IN container - pointer to container
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+static int __roaring_append_clone(Roaring * ___restrict___ roaring, const Roaring_container * ___restrict___ container);
+
+/*
+    Append container created from bitmap at the end of roaring (empty bitmap is skipped)
+
+    PARAMS
+    @IN roaring - pointer to roaring bitmap
+    @IN key - high 16 bits
+    @IN words - bitmap
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+static int __roaring_append_bitmap(Roaring * ___restrict___ roaring, uint16_t key, const uint64_t * ___restrict___ words);
+
+/*
+    Store / Load value in little endian
+
+    PARAMS
+    @IN buf - buffer
+    @IN val - value
+
+    RETURN
+    Load: value
+*/
+static ___inline___ void __roaring_store16(BYTE *buf, uint16_t val);
+static ___inline___ void __roaring_store32(BYTE *buf, uint32_t val);
+static ___inline___ void __roaring_store64(BYTE *buf, uint64_t val);
+static ___inline___ uint16_t __roaring_load16(const BYTE *buf);
+static ___inline___ uint32_t __roaring_load32(const BYTE *buf);
+static ___inline___ uint64_t __roaring_load64(const BYTE *buf);
+
+/*
+    Check serialized container header and compute its payload size
+
+    PARAMS
+    @IN size - size of buffer
+    @IN hdr - pointer to container header in buffer
+    @OUT payload - payload size
+
+    RETURN
+    0 iff success
+    Non-zero value iff header is corrupted
+*/
+static int __roaring_check_header(size_t size, const BYTE *hdr, size_t *payload);
+
+static ___inline___ size_t __roaring_array_lower_bound(const uint16_t *array, size_t size, uint32_t val)
+{
+    size_t left = 0;
+    size_t right = size;
+    size_t middle;
+
+    while (left < right)
+    {
+        middle = left + ((right - left) >> 1);
+        if ((uint32_t)array[middle] < val)
+            left = middle + 1;
+        else
+            right = middle;
+    }
+
+    return left;
+}
+
+static ___inline___ size_t __roaring_run_lower_bound(const uint16_t *runs, size_t size, uint32_t val)
+{
+    size_t left = 0;
+    size_t right = size;
+    size_t middle;
+
+    while (left < right)
+    {
+        middle = left + ((right - left) >> 1);
+        if ((uint32_t)runs[middle << 1] + (uint32_t)runs[(middle << 1) + 1] < val)
+            left = middle + 1;
+        else
+            right = middle;
+    }
+
+    return left;
+}
+
+static void __roaring_bitmap_set_range(uint64_t *words, uint32_t start, uint32_t end)
+{
+    const size_t first = start >> 6;
+    const size_t last = end >> 6;
+    const uint64_t first_mask = ~(uint64_t)0 << (start & 63);
+    const uint64_t last_mask = ~(uint64_t)0 >> (63 - (end & 63));
+    size_t i;
+
+    if (first == last)
+    {
+        words[first] |= first_mask & last_mask;
+        return;
+    }
+
+    words[first] |= first_mask;
+    for (i = first + 1; i < last; ++i)
+        words[i] = ~(uint64_t)0;
+
+    words[last] |= last_mask;
+}
+
+static int __roaring_container_init(Roaring_container *container, uint16_t key, roaring_container_type_t type, size_t capacity)
+{
+    container->key = key;
+    container->type = type;
+    container->size = 0;
+    container->cardinality = 0;
+    container->capacity = capacity;
+
+    switch (type)
+    {
+        case ROARING_ARRAY:
+        {
+            container->data = malloc(sizeof(uint16_t) * capacity);
+            break;
+        }
+        case ROARING_RUN:
+        {
+            container->data = malloc(sizeof(uint16_t) * 2 * capacity);
+            break;
+        }
+        case ROARING_BITMAP:
+        {
+            container->data = calloc(ROARING_BITMAP_WORDS, sizeof(uint64_t));
+            container->size = ROARING_BITMAP_WORDS;
+            container->capacity = ROARING_BITMAP_WORDS;
+            break;
+        }
+        default:
+        {
+            container->data = NULL;
+            break;
+        }
+    }
+
+    if (container->data == NULL)
+        ERROR("malloc error\n", 1);
+
+    return 0;
+}
+
+static ___inline___ size_t __roaring_container_data_size(const Roaring_container *container)
+{
+    switch (container->type)
+    {
+        case ROARING_ARRAY:
+            return container->size * sizeof(uint16_t);
+        case ROARING_RUN:
+            return container->size * sizeof(uint16_t) * 2;
+        case ROARING_BITMAP:
+            return ROARING_BITMAP_BYTES;
+        default:
+            return 0;
+    }
+}
+
+static int __roaring_container_clone(Roaring_container * ___restrict___ dst, const Roaring_container * ___restrict___ src)
+{
+    if (__roaring_container_init(dst, src->key, src->type, MAX(src->size, (size_t)1)))
+        ERROR("__roaring_container_init error\n", 1);
+
+    (void)memcpy(dst->data, src->data, __roaring_container_data_size(src));
+    dst->size = src->size;
+    dst->cardinality = src->cardinality;
+
+    return 0;
+}
+
+static bool __roaring_container_contains(const Roaring_container *container, uint16_t low)
+{
+    const uint16_t *array;
+    const uint64_t *words;
+    size_t pos;
+
+    switch (container->type)
+    {
+        case ROARING_ARRAY:
+        {
+            array = (const uint16_t *)container->data;
+            pos = __roaring_array_lower_bound(array, container->size, low);
+
+            return pos < container->size && array[pos] == low;
+        }
+        case ROARING_BITMAP:
+        {
+            words = (const uint64_t *)container->data;
+
+            return CAST_TO_BOOL(GET_BIT(words[low >> 6], low & 63));
+        }
+        case ROARING_RUN:
+        {
+            array = (const uint16_t *)container->data;
+            pos = __roaring_run_lower_bound(array, container->size, low);
+
+            return pos < container->size && array[pos << 1] <= low;
+        }
+        default:
+            return false;
+    }
+}
+
+static void __roaring_container_to_bitmap(const Roaring_container * ___restrict___ container, uint64_t * ___restrict___ words)
+{
+    const uint16_t *array;
+    size_t i;
+
+    switch (container->type)
+    {
+        case ROARING_ARRAY:
+        {
+            (void)memset(words, 0, ROARING_BITMAP_BYTES);
+            array = (const uint16_t *)container->data;
+            for (i = 0; i < container->size; ++i)
+                SET_BIT(words[array[i] >> 6], array[i] & 63);
+
+            break;
+        }
+        case ROARING_BITMAP:
+        {
+            (void)memcpy(words, container->data, ROARING_BITMAP_BYTES);
+            break;
+        }
+        case ROARING_RUN:
+        {
+            (void)memset(words, 0, ROARING_BITMAP_BYTES);
+            array = (const uint16_t *)container->data;
+            for (i = 0; i < container->size; ++i)
+                __roaring_bitmap_set_range(words, array[i << 1], (uint32_t)array[i << 1] + (uint32_t)array[(i << 1) + 1]);
+
+            break;
+        }
+        default:
+        {
+            (void)memset(words, 0, ROARING_BITMAP_BYTES);
+            break;
+        }
+    }
+}
+
+static int __roaring_container_from_bitmap(Roaring_container * ___restrict___ container, uint16_t key, const uint64_t * ___restrict___ words)
+{
+    size_t cardinality = 0;
+    size_t i;
+    size_t n;
+    uint64_t word;
+    uint16_t *array;
+
+    for (i = 0; i < ROARING_BITMAP_WORDS; ++i)
+        cardinality += (size_t)__builtin_popcountll(words[i]);
+
+    if (cardinality == 0)
+    {
+        container->key = key;
+        container->type = ROARING_ARRAY;
+        container->data = NULL;
+        container->size = 0;
+        container->capacity = 0;
+        container->cardinality = 0;
+
+        return 0;
+    }
+
+    if (cardinality > ROARING_ARRAY_MAX)
+    {
+        if (__roaring_container_init(container, key, ROARING_BITMAP, 0))
+            ERROR("__roaring_container_init error\n", 1);
+
+        (void)memcpy(container->data, words, ROARING_BITMAP_BYTES);
+        container->cardinality = cardinality;
+
+        return 0;
+    }
+
+    if (__roaring_container_init(container, key, ROARING_ARRAY, cardinality))
+        ERROR("__roaring_container_init error\n", 1);
+
+    array = (uint16_t *)container->data;
+    n = 0;
+    for (i = 0; i < ROARING_BITMAP_WORDS; ++i)
+    {
+        word = words[i];
+        while (word)
+        {
+            array[n++] = (uint16_t)((i << 6) + (size_t)__builtin_ctzll(word));
+            word &= word - 1;
+        }
+    }
+
+    container->size = cardinality;
+    container->cardinality = cardinality;
+
+    return 0;
+}
+
+static size_t __roaring_bitmap_count_runs(const uint64_t *words)
+{
+    size_t runs = 0;
+    size_t i;
+    uint64_t carry = 0;
+
+    for (i = 0; i < ROARING_BITMAP_WORDS; ++i)
+    {
+        /* bit is begin of run iff it is set and previous bit is clear */
+        runs += (size_t)__builtin_popcountll(words[i] & ~((words[i] << 1) | carry));
+        carry = words[i] >> 63;
+    }
+
+    return runs;
+}
+
+static int __roaring_container_runs_from_bitmap(Roaring_container * ___restrict___ container, uint16_t key, const uint64_t * ___restrict___ words, size_t runs)
+{
+    uint16_t *array;
+    size_t n = 0;
+    size_t cardinality = 0;
+    uint32_t pos = 0;
+    uint32_t start;
+
+    if (__roaring_container_init(container, key, ROARING_RUN, runs))
+        ERROR("__roaring_container_init error\n", 1);
+
+    array = (uint16_t *)container->data;
+    while (pos < ROARING_CHUNK_SIZE)
+    {
+        if (words[pos >> 6] == 0)
+        {
+            pos = (pos | 63) + 1;
+            continue;
+        }
+
+        if (!GET_BIT(words[pos >> 6], pos & 63))
+        {
+            ++pos;
+            continue;
+        }
+
+        start = pos;
+        while (pos < ROARING_CHUNK_SIZE && GET_BIT(words[pos >> 6], pos & 63))
+            ++pos;
+
+        array[n << 1] = (uint16_t)start;
+        array[(n << 1) + 1] = (uint16_t)(pos - start - 1);
+        cardinality += pos - start;
+        ++n;
+    }
+
+    container->size = n;
+    container->cardinality = cardinality;
+
+    return 0;
+}
+
+static int __roaring_container_add(Roaring_container *container, uint16_t low)
+{
+    uint64_t words[ROARING_BITMAP_WORDS];
+    Roaring_container temp;
+    uint16_t *array;
+    size_t pos;
+    size_t new_capacity;
+    void *new_data;
+
+    if (__roaring_container_contains(container, low))
+        return 0;
+
+    switch (container->type)
+    {
+        case ROARING_BITMAP:
+        {
+            SET_BIT(((uint64_t *)container->data)[low >> 6], low & 63);
+            ++container->cardinality;
+
+            return 0;
+        }
+        case ROARING_ARRAY:
+        {
+            if (container->size < ROARING_ARRAY_MAX)
+            {
+                if (container->size == container->capacity)
+                {
+                    new_capacity = MAX(container->capacity << 1, (size_t)ROARING_INIT_ARRAY);
+                    new_capacity = MIN(new_capacity, (size_t)ROARING_ARRAY_MAX);
+                    new_data = realloc(container->data, sizeof(uint16_t) * new_capacity);
+                    if (new_data == NULL)
+                        ERROR("realloc error\n", 1);
+
+                    container->data = new_data;
+                    container->capacity = new_capacity;
+                }
+
+                array = (uint16_t *)container->data;
+                pos = __roaring_array_lower_bound(array, container->size, low);
+                (void)memmove(&array[pos + 1], &array[pos], sizeof(uint16_t) * (container->size - pos));
+                array[pos] = low;
+                ++container->size;
+                ++container->cardinality;
+
+                return 0;
+            }
+
+            break;
+        }
+        case ROARING_RUN:
+            break;
+        default:
+            ERROR("Incorrect container type\n", 1);
+    }
+
+    /* full ARRAY or RUN, rebuild container via bitmap */
+    __roaring_container_to_bitmap(container, words);
+    SET_BIT(words[low >> 6], low & 63);
+
+    if (__roaring_container_from_bitmap(&temp, container->key, words))
+        ERROR("__roaring_container_from_bitmap error\n", 1);
+
+    FREE(container->data);
+    *container = temp;
+
+    return 0;
+}
+
+static int __roaring_container_remove(Roaring_container *container, uint16_t low)
+{
+    uint64_t words[ROARING_BITMAP_WORDS];
+    Roaring_container temp;
+    uint16_t *array;
+    size_t pos;
+
+    if (!__roaring_container_contains(container, low))
+        return 0;
+
+    switch (container->type)
+    {
+        case ROARING_ARRAY:
+        {
+            array = (uint16_t *)container->data;
+            pos = __roaring_array_lower_bound(array, container->size, low);
+            (void)memmove(&array[pos], &array[pos + 1], sizeof(uint16_t) * (container->size - pos - 1));
+            --container->size;
+            --container->cardinality;
+
+            return 0;
+        }
+        case ROARING_BITMAP:
+        {
+            CLEAR_BIT(((uint64_t *)container->data)[low >> 6], low & 63);
+            --container->cardinality;
+            if (container->cardinality > ROARING_ARRAY_MAX)
+                return 0;
+
+            break;
+        }
+        case ROARING_RUN:
+            break;
+        default:
+            ERROR("Incorrect container type\n", 1);
+    }
+
+    /* BITMAP became sparse or RUN has been modified, rebuild container via bitmap */
+    __roaring_container_to_bitmap(container, words);
+    CLEAR_BIT(words[low >> 6], low & 63);
+
+    if (__roaring_container_from_bitmap(&temp, container->key, words))
+        ERROR("__roaring_container_from_bitmap error\n", 1);
+
+    FREE(container->data);
+    *container = temp;
+
+    return 0;
+}
+
+static bool __roaring_container_next(const Roaring_container * ___restrict___ container, uint32_t from, uint16_t * ___restrict___ low)
+{
+    const uint16_t *array;
+    const uint64_t *words;
+    size_t pos;
+    uint64_t word;
+
+    if (from >= ROARING_CHUNK_SIZE)
+        return false;
+
+    switch (container->type)
+    {
+        case ROARING_ARRAY:
+        {
+            array = (const uint16_t *)container->data;
+            pos = __roaring_array_lower_bound(array, container->size, from);
+            if (pos >= container->size)
+                return false;
+
+            *low = array[pos];
+            return true;
+        }
+        case ROARING_RUN:
+        {
+            array = (const uint16_t *)container->data;
+            pos = __roaring_run_lower_bound(array, container->size, from);
+            if (pos >= container->size)
+                return false;
+
+            *low = (uint16_t)MAX((uint32_t)array[pos << 1], from);
+            return true;
+        }
+        case ROARING_BITMAP:
+        {
+            words = (const uint64_t *)container->data;
+            pos = from >> 6;
+            word = words[pos] & (~(uint64_t)0 << (from & 63));
+            while (word == 0)
+            {
+                if (++pos >= ROARING_BITMAP_WORDS)
+                    return false;
+
+                word = words[pos];
+            }
+
+            *low = (uint16_t)((pos << 6) + (size_t)__builtin_ctzll(word));
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+static bool __roaring_container_prev(const Roaring_container * ___restrict___ container, uint32_t from, uint16_t * ___restrict___ low)
+{
+    const uint16_t *array;
+    const uint64_t *words;
+    size_t pos;
+    uint64_t word;
+
+    if (from >= ROARING_CHUNK_SIZE)
+        from = ROARING_CHUNK_SIZE - 1;
+
+    switch (container->type)
+    {
+        case ROARING_ARRAY:
+        {
+            array = (const uint16_t *)container->data;
+            pos = __roaring_array_lower_bound(array, container->size, from + 1);
+            if (pos == 0)
+                return false;
+
+            *low = array[pos - 1];
+            return true;
+        }
+        case ROARING_RUN:
+        {
+            array = (const uint16_t *)container->data;
+            pos = __roaring_run_lower_bound(array, container->size, from);
+            if (pos < container->size && array[pos << 1] <= from)
+            {
+                *low = (uint16_t)from;
+                return true;
+            }
+
+            if (pos == 0)
+                return false;
+
+            --pos;
+            *low = (uint16_t)((uint32_t)array[pos << 1] + (uint32_t)array[(pos << 1) + 1]);
+            return true;
+        }
+        case ROARING_BITMAP:
+        {
+            words = (const uint64_t *)container->data;
+            pos = from >> 6;
+            word = words[pos] & (~(uint64_t)0 >> (63 - (from & 63)));
+            while (word == 0)
+            {
+                if (pos == 0)
+                    return false;
+
+                word = words[--pos];
+            }
+
+            *low = (uint16_t)((pos << 6) + 63 - (size_t)__builtin_clzll(word));
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+static size_t __roaring_container_to_values(const Roaring_container * ___restrict___ container, uint32_t * ___restrict___ out)
+{
+    const uint16_t *array;
+    const uint64_t *words;
+    size_t n = 0;
+    size_t i;
+    uint32_t j;
+    uint32_t end;
+    uint64_t word;
+
+    switch (container->type)
+    {
+        case ROARING_ARRAY:
+        {
+            array = (const uint16_t *)container->data;
+            for (i = 0; i < container->size; ++i)
+                out[n++] = ROARING_VALUE(container->key, array[i]);
+
+            break;
+        }
+        case ROARING_RUN:
+        {
+            array = (const uint16_t *)container->data;
+            for (i = 0; i < container->size; ++i)
+            {
+                end = (uint32_t)array[i << 1] + (uint32_t)array[(i << 1) + 1];
+                for (j = array[i << 1]; j <= end; ++j)
+                    out[n++] = ROARING_VALUE(container->key, j);
+            }
+
+            break;
+        }
+        case ROARING_BITMAP:
+        {
+            words = (const uint64_t *)container->data;
+            for (i = 0; i < ROARING_BITMAP_WORDS; ++i)
+            {
+                word = words[i];
+                while (word)
+                {
+                    out[n++] = ROARING_VALUE(container->key, (i << 6) + (size_t)__builtin_ctzll(word));
+                    word &= word - 1;
+                }
+            }
+
+            break;
+        }
+        default:
+            break;
+    }
+
+    return n;
+}
+
+static size_t __roaring_lower_bound(const Roaring *roaring, uint16_t key)
+{
+    size_t left = 0;
+    size_t right = roaring->num_containers;
+    size_t middle;
+
+    while (left < right)
+    {
+        middle = left + ((right - left) >> 1);
+        if (roaring->containers[middle].key < key)
+            left = middle + 1;
+        else
+            right = middle;
+    }
+
+    return left;
+}
+
+static int __roaring_insert_container(Roaring * ___restrict___ roaring, size_t pos, const Roaring_container * ___restrict___ container)
+{
+    Roaring_container *new_containers;
+    size_t new_capacity;
+
+    if (roaring->num_containers == roaring->capacity)
+    {
+        new_capacity = MAX(roaring->capacity << 1, (size_t)ROARING_INIT_CONTAINERS);
+        new_containers = (Roaring_container *)realloc(roaring->containers, sizeof(Roaring_container) * new_capacity);
+        if (new_containers == NULL)
+            ERROR("realloc error\n", 1);
+
+        roaring->containers = new_containers;
+        roaring->capacity = new_capacity;
+    }
+
+    (void)memmove(&roaring->containers[pos + 1], &roaring->containers[pos], sizeof(Roaring_container) * (roaring->num_containers - pos));
+    roaring->containers[pos] = *container;
+    ++roaring->num_containers;
+
+    return 0;
+}
+
+static void __roaring_delete_container(Roaring *roaring, size_t pos)
+{
+    FREE(roaring->containers[pos].data);
+    (void)memmove(&roaring->containers[pos], &roaring->containers[pos + 1], sizeof(Roaring_container) * (roaring->num_containers - pos - 1));
+    --roaring->num_containers;
+}
+
+static int __roaring_append_clone(Roaring * ___restrict___ roaring, const Roaring_container * ___restrict___ container)
+{
+    Roaring_container temp;
+
+    if (__roaring_container_clone(&temp, container))
+        ERROR("__roaring_container_clone error\n", 1);
+
+    if (__roaring_insert_container(roaring, roaring->num_containers, &temp))
+    {
+        FREE(temp.data);
+        ERROR("__roaring_insert_container error\n", 1);
+    }
+
+    return 0;
+}
+
+static int __roaring_append_bitmap(Roaring * ___restrict___ roaring, uint16_t key, const uint64_t * ___restrict___ words)
+{
+    Roaring_container temp;
+
+    if (__roaring_container_from_bitmap(&temp, key, words))
+        ERROR("__roaring_container_from_bitmap error\n", 1);
+
+    if (temp.cardinality == 0)
+        return 0;
+
+    if (__roaring_insert_container(roaring, roaring->num_containers, &temp))
+    {
+        FREE(temp.data);
+        ERROR("__roaring_insert_container error\n", 1);
+    }
+
+    return 0;
+}
+
+static ___inline___ void __roaring_store16(BYTE *buf, uint16_t val)
+{
+    buf[0] = (BYTE)(val);
+    buf[1] = (BYTE)(val >> 8);
+}
+
+static ___inline___ void __roaring_store32(BYTE *buf, uint32_t val)
+{
+    __roaring_store16(buf, (uint16_t)val);
+    __roaring_store16(buf + 2, (uint16_t)(val >> 16));
+}
+
+static ___inline___ void __roaring_store64(BYTE *buf, uint64_t val)
+{
+    __roaring_store32(buf, (uint32_t)val);
+    __roaring_store32(buf + 4, (uint32_t)(val >> 32));
+}
+
+static ___inline___ uint16_t __roaring_load16(const BYTE *buf)
+{
+    return (uint16_t)((uint32_t)buf[0] | ((uint32_t)buf[1] << 8));
+}
+
+static ___inline___ uint32_t __roaring_load32(const BYTE *buf)
+{
+    return (uint32_t)__roaring_load16(buf) | ((uint32_t)__roaring_load16(buf + 2) << 16);
+}
+
+static ___inline___ uint64_t __roaring_load64(const BYTE *buf)
+{
+    return (uint64_t)__roaring_load32(buf) | ((uint64_t)__roaring_load32(buf + 4) << 32);
+}
+
+static int __roaring_check_header(size_t size, const BYTE *hdr, size_t *payload)
+{
+    const BYTE type = hdr[2];
+    const size_t cardinality = __roaring_load32(hdr + 4);
+    const size_t entries = __roaring_load32(hdr + 8);
+    const size_t offset = __roaring_load32(hdr + 12);
+
+    if (cardinality == 0 || cardinality > ROARING_CHUNK_SIZE)
+        ERROR("Incorrect cardinality\n", 1);
+
+    switch (type)
+    {
+        case ROARING_ARRAY:
+        {
+            if (entries != cardinality || entries > ROARING_ARRAY_MAX)
+                ERROR("Incorrect array container\n", 1);
+
+            *payload = entries * sizeof(uint16_t);
+            break;
+        }
+        case ROARING_BITMAP:
+        {
+            if (entries != ROARING_BITMAP_WORDS)
+                ERROR("Incorrect bitmap container\n", 1);
+
+            *payload = ROARING_BITMAP_BYTES;
+            break;
+        }
+        case ROARING_RUN:
+        {
+            if (entries == 0 || entries > (ROARING_CHUNK_SIZE >> 1))
+                ERROR("Incorrect run container\n", 1);
+
+            *payload = entries * sizeof(uint16_t) * 2;
+            break;
+        }
+        default:
+            ERROR("Incorrect container type\n", 1);
+    }
+
+    if (offset > size || *payload > size - offset)
+        ERROR("Container out of buffer\n", 1);
+
+    return 0;
+}
+
+Roaring *roaring_create(void)
+{
+    Roaring *roaring;
+
+    TRACE();
+
+    roaring = (Roaring *)malloc(sizeof(Roaring));
+    if (roaring == NULL)
+        ERROR("malloc error\n", NULL);
+
+    roaring->containers = (Roaring_container *)malloc(sizeof(Roaring_container) * ROARING_INIT_CONTAINERS);
+    if (roaring->containers == NULL)
+    {
+        FREE(roaring);
+        ERROR("malloc error\n", NULL);
+    }
+
+    roaring->num_containers = 0;
+    roaring->capacity = ROARING_INIT_CONTAINERS;
+
+    return roaring;
+}
+
+Roaring *roaring_create_from_array(const uint32_t *values, size_t num_values)
+{
+    Roaring *roaring;
+    size_t i;
+
+    TRACE();
+
+    if (values == NULL || num_values == 0)
+        ERROR("values == NULL || num_values == 0\n", NULL);
+
+    roaring = roaring_create();
+    if (roaring == NULL)
+        ERROR("roaring_create error\n", NULL);
+
+    for (i = 0; i < num_values; ++i)
+        if (roaring_add(roaring, values[i]))
+        {
+            roaring_destroy(roaring);
+            ERROR("roaring_add error\n", NULL);
+        }
+
+    return roaring;
+}
+
+void roaring_destroy(Roaring *roaring)
+{
+    size_t i;
+
+    TRACE();
+
+    if (roaring == NULL)
+        return;
+
+    for (i = 0; i < roaring->num_containers; ++i)
+        FREE(roaring->containers[i].data);
+
+    FREE(roaring->containers);
+    FREE(roaring);
+}
+
+Roaring *roaring_clone(const Roaring *roaring)
+{
+    Roaring *clone;
+    size_t i;
+
+    TRACE();
+
+    if (roaring == NULL)
+        ERROR("roaring == NULL\n", NULL);
+
+    clone = roaring_create();
+    if (clone == NULL)
+        ERROR("roaring_create error\n", NULL);
+
+    for (i = 0; i < roaring->num_containers; ++i)
+        if (__roaring_append_clone(clone, &roaring->containers[i]))
+        {
+            roaring_destroy(clone);
+            ERROR("__roaring_append_clone error\n", NULL);
+        }
+
+    return clone;
+}
+
+int roaring_add(Roaring *roaring, uint32_t val)
+{
+    Roaring_container container;
+    const uint16_t key = ROARING_KEY(val);
+    size_t pos;
+
+    TRACE();
+
+    if (roaring == NULL)
+        ERROR("roaring == NULL\n", 1);
+
+    pos = __roaring_lower_bound(roaring, key);
+    if (pos < roaring->num_containers && roaring->containers[pos].key == key)
+        return __roaring_container_add(&roaring->containers[pos], ROARING_LOW(val));
+
+    if (__roaring_container_init(&container, key, ROARING_ARRAY, ROARING_INIT_ARRAY))
+        ERROR("__roaring_container_init error\n", 1);
+
+    ((uint16_t *)container.data)[0] = ROARING_LOW(val);
+    container.size = 1;
+    container.cardinality = 1;
+
+    if (__roaring_insert_container(roaring, pos, &container))
+    {
+        FREE(container.data);
+        ERROR("__roaring_insert_container error\n", 1);
+    }
+
+    return 0;
+}
+
+int roaring_remove(Roaring *roaring, uint32_t val)
+{
+    const uint16_t key = ROARING_KEY(val);
+    size_t pos;
+
+    TRACE();
+
+    if (roaring == NULL)
+        ERROR("roaring == NULL\n", 1);
+
+    pos = __roaring_lower_bound(roaring, key);
+    if (pos >= roaring->num_containers || roaring->containers[pos].key != key)
+        return 0;
+
+    if (__roaring_container_remove(&roaring->containers[pos], ROARING_LOW(val)))
+        ERROR("__roaring_container_remove error\n", 1);
+
+    if (roaring->containers[pos].cardinality == 0)
+        __roaring_delete_container(roaring, pos);
+
+    return 0;
+}
+
+bool roaring_contains(const Roaring *roaring, uint32_t val)
+{
+    const uint16_t key = ROARING_KEY(val);
+    size_t pos;
+
+    TRACE();
+
+    if (roaring == NULL)
+        ERROR("roaring == NULL\n", false);
+
+    pos = __roaring_lower_bound(roaring, key);
+    if (pos >= roaring->num_containers || roaring->containers[pos].key != key)
+        return false;
+
+    return __roaring_container_contains(&roaring->containers[pos], ROARING_LOW(val));
+}
+
+ssize_t roaring_get_cardinality(const Roaring *roaring)
+{
+    size_t cardinality = 0;
+    size_t i;
+
+    TRACE();
+
+    if (roaring == NULL)
+        ERROR("roaring == NULL\n", -1);
+
+    for (i = 0; i < roaring->num_containers; ++i)
+        cardinality += roaring->containers[i].cardinality;
+
+    return (ssize_t)cardinality;
+}
+
+int roaring_min(const Roaring * ___restrict___ roaring, uint32_t * ___restrict___ val)
+{
+    uint16_t low;
+
+    TRACE();
+
+    if (roaring == NULL || val == NULL)
+        ERROR("roaring == NULL || val == NULL\n", 1);
+
+    if (roaring->num_containers == 0)
+        ERROR("Roaring is empty\n", 1);
+
+    if (!__roaring_container_next(&roaring->containers[0], 0, &low))
+        ERROR("Empty container\n", 1);
+
+    *val = ROARING_VALUE(roaring->containers[0].key, low);
+
+    return 0;
+}
+
+int roaring_max(const Roaring * ___restrict___ roaring, uint32_t * ___restrict___ val)
+{
+    const Roaring_container *container;
+    uint16_t low;
+
+    TRACE();
+
+    if (roaring == NULL || val == NULL)
+        ERROR("roaring == NULL || val == NULL\n", 1);
+
+    if (roaring->num_containers == 0)
+        ERROR("Roaring is empty\n", 1);
+
+    container = &roaring->containers[roaring->num_containers - 1];
+    if (!__roaring_container_prev(container, ROARING_CHUNK_SIZE - 1, &low))
+        ERROR("Empty container\n", 1);
+
+    *val = ROARING_VALUE(container->key, low);
+
+    return 0;
+}
+
+int roaring_run_optimize(Roaring *roaring)
+{
+    uint64_t words[ROARING_BITMAP_WORDS];
+    Roaring_container temp;
+    Roaring_container *container;
+    size_t i;
+    size_t runs;
+
+    TRACE();
+
+    if (roaring == NULL)
+        ERROR("roaring == NULL\n", 1);
+
+    for (i = 0; i < roaring->num_containers; ++i)
+    {
+        container = &roaring->containers[i];
+        if (container->type == ROARING_RUN)
+            continue;
+
+        __roaring_container_to_bitmap(container, words);
+        runs = __roaring_bitmap_count_runs(words);
+        if (runs * sizeof(uint16_t) * 2 >= __roaring_container_data_size(container))
+            continue;
+
+        if (__roaring_container_runs_from_bitmap(&temp, container->key, words, runs))
+            ERROR("__roaring_container_runs_from_bitmap error\n", 1);
+
+        FREE(container->data);
+        *container = temp;
+    }
+
+    return 0;
+}
+
+Roaring *roaring_union(const Roaring *r1, const Roaring *r2)
+{
+    uint64_t words1[ROARING_BITMAP_WORDS];
+    uint64_t words2[ROARING_BITMAP_WORDS];
+    Roaring *roaring;
+    const Roaring_container *c1;
+    const Roaring_container *c2;
+    size_t i = 0;
+    size_t j = 0;
+    size_t k;
+    int err;
+
+    TRACE();
+
+    if (r1 == NULL || r2 == NULL)
+        ERROR("r1 == NULL || r2 == NULL\n", NULL);
+
+    roaring = roaring_create();
+    if (roaring == NULL)
+        ERROR("roaring_create error\n", NULL);
+
+    while (i < r1->num_containers || j < r2->num_containers)
+    {
+        c1 = i < r1->num_containers ? &r1->containers[i] : NULL;
+        c2 = j < r2->num_containers ? &r2->containers[j] : NULL;
+
+        if (c2 == NULL || (c1 != NULL && c1->key < c2->key))
+        {
+            err = __roaring_append_clone(roaring, c1);
+            ++i;
+        }
+        else if (c1 == NULL || c2->key < c1->key)
+        {
+            err = __roaring_append_clone(roaring, c2);
+            ++j;
+        }
+        else
+        {
+            __roaring_container_to_bitmap(c1, words1);
+            __roaring_container_to_bitmap(c2, words2);
+            for (k = 0; k < ROARING_BITMAP_WORDS; ++k)
+                words1[k] |= words2[k];
+
+            err = __roaring_append_bitmap(roaring, c1->key, words1);
+            ++i;
+            ++j;
+        }
+
+        if (err)
+        {
+            roaring_destroy(roaring);
+            ERROR("Cannot append container\n", NULL);
+        }
+    }
+
+    return roaring;
+}
+
+Roaring *roaring_intersection(const Roaring *r1, const Roaring *r2)
+{
+    uint64_t words1[ROARING_BITMAP_WORDS];
+    uint64_t words2[ROARING_BITMAP_WORDS];
+    Roaring *roaring;
+    const Roaring_container *c1;
+    const Roaring_container *c2;
+    size_t i = 0;
+    size_t j = 0;
+    size_t k;
+
+    TRACE();
+
+    if (r1 == NULL || r2 == NULL)
+        ERROR("r1 == NULL || r2 == NULL\n", NULL);
+
+    roaring = roaring_create();
+    if (roaring == NULL)
+        ERROR("roaring_create error\n", NULL);
+
+    while (i < r1->num_containers && j < r2->num_containers)
+    {
+        c1 = &r1->containers[i];
+        c2 = &r2->containers[j];
+
+        if (c1->key < c2->key)
+        {
+            ++i;
+            continue;
+        }
+
+        if (c2->key < c1->key)
+        {
+            ++j;
+            continue;
+        }
+
+        /* sparse container can be filtered by lookups in the 2nd one */
+        if (c2->type == ROARING_ARRAY && c1->type != ROARING_ARRAY)
+            SWAP(c1, c2);
+
+        if (c1->type == ROARING_ARRAY)
+        {
+            (void)memset(words1, 0, ROARING_BITMAP_BYTES);
+            for (k = 0; k < c1->size; ++k)
+                if (__roaring_container_contains(c2, ((const uint16_t *)c1->data)[k]))
+                    SET_BIT(words1[((const uint16_t *)c1->data)[k] >> 6], ((const uint16_t *)c1->data)[k] & 63);
+        }
+        else
+        {
+            __roaring_container_to_bitmap(c1, words1);
+            __roaring_container_to_bitmap(c2, words2);
+            for (k = 0; k < ROARING_BITMAP_WORDS; ++k)
+                words1[k] &= words2[k];
+        }
+
+        if (__roaring_append_bitmap(roaring, c1->key, words1))
+        {
+            roaring_destroy(roaring);
+            ERROR("__roaring_append_bitmap error\n", NULL);
+        }
+
+        ++i;
+        ++j;
+    }
+
+    return roaring;
+}
+
+Roaring *roaring_difference(const Roaring *r1, const Roaring *r2)
+{
+    uint64_t words1[ROARING_BITMAP_WORDS];
+    uint64_t words2[ROARING_BITMAP_WORDS];
+    Roaring *roaring;
+    const Roaring_container *c1;
+    const Roaring_container *c2;
+    size_t i = 0;
+    size_t j = 0;
+    size_t k;
+    int err;
+
+    TRACE();
+
+    if (r1 == NULL || r2 == NULL)
+        ERROR("r1 == NULL || r2 == NULL\n", NULL);
+
+    roaring = roaring_create();
+    if (roaring == NULL)
+        ERROR("roaring_create error\n", NULL);
+
+    while (i < r1->num_containers)
+    {
+        c1 = &r1->containers[i];
+        while (j < r2->num_containers && r2->containers[j].key < c1->key)
+            ++j;
+
+        c2 = j < r2->num_containers && r2->containers[j].key == c1->key ? &r2->containers[j] : NULL;
+        if (c2 == NULL)
+            err = __roaring_append_clone(roaring, c1);
+        else
+        {
+            __roaring_container_to_bitmap(c1, words1);
+            __roaring_container_to_bitmap(c2, words2);
+            for (k = 0; k < ROARING_BITMAP_WORDS; ++k)
+                words1[k] &= ~words2[k];
+
+            err = __roaring_append_bitmap(roaring, c1->key, words1);
+        }
+
+        if (err)
+        {
+            roaring_destroy(roaring);
+            ERROR("Cannot append container\n", NULL);
+        }
+
+        ++i;
+    }
+
+    return roaring;
+}
+
+uint32_t *roaring_to_array(const Roaring * ___restrict___ roaring, size_t * ___restrict___ size)
+{
+    uint32_t *array;
+    size_t cardinality;
+    size_t n = 0;
+    size_t i;
+
+    TRACE();
+
+    if (roaring == NULL || size == NULL)
+        ERROR("roaring == NULL || size == NULL\n", NULL);
+
+    cardinality = (size_t)roaring_get_cardinality(roaring);
+    if (cardinality == 0)
+        ERROR("Roaring is empty\n", NULL);
+
+    array = (uint32_t *)malloc(sizeof(uint32_t) * cardinality);
+    if (array == NULL)
+        ERROR("malloc error\n", NULL);
+
+    for (i = 0; i < roaring->num_containers; ++i)
+        n += __roaring_container_to_values(&roaring->containers[i], &array[n]);
+
+    *size = n;
+
+    return array;
+}
+
+ssize_t roaring_serialized_size(const Roaring *roaring)
+{
+    size_t size;
+    size_t i;
+
+    TRACE();
+
+    if (roaring == NULL)
+        ERROR("roaring == NULL\n", -1);
+
+    size = ROARING_HEADER_SIZE + ROARING_CONTAINER_HDR_SIZE * roaring->num_containers;
+    for (i = 0; i < roaring->num_containers; ++i)
+        size += __roaring_container_data_size(&roaring->containers[i]);
+
+    return (ssize_t)size;
+}
+
+ssize_t roaring_serialize(const Roaring * ___restrict___ roaring, void * ___restrict___ buf, size_t size)
+{
+    const Roaring_container *container;
+    BYTE *out = (BYTE *)buf;
+    BYTE *hdr;
+    ssize_t needed;
+    size_t offset;
+    size_t i;
+    size_t j;
+
+    TRACE();
+
+    if (roaring == NULL || buf == NULL)
+        ERROR("roaring == NULL || buf == NULL\n", -1);
+
+    needed = roaring_serialized_size(roaring);
+    if (needed < 0 || (size_t)needed > size)
+        ERROR("Buffer is too small\n", -1);
+
+    if ((size_t)needed > UINT32_MAX)
+        ERROR("Roaring is too big to serialize\n", -1);
+
+    __roaring_store32(out, ROARING_MAGIC);
+    __roaring_store32(out + 4, (uint32_t)roaring->num_containers);
+
+    offset = ROARING_HEADER_SIZE + ROARING_CONTAINER_HDR_SIZE * roaring->num_containers;
+    for (i = 0; i < roaring->num_containers; ++i)
+    {
+        container = &roaring->containers[i];
+        hdr = out + ROARING_HEADER_SIZE + ROARING_CONTAINER_HDR_SIZE * i;
+
+        __roaring_store16(hdr, container->key);
+        hdr[2] = (BYTE)container->type;
+        hdr[3] = 0;
+        __roaring_store32(hdr + 4, (uint32_t)container->cardinality);
+        __roaring_store32(hdr + 8, (uint32_t)container->size);
+        __roaring_store32(hdr + 12, (uint32_t)offset);
+
+        switch (container->type)
+        {
+            case ROARING_ARRAY:
+            {
+                for (j = 0; j < container->size; ++j)
+                    __roaring_store16(out + offset + j * sizeof(uint16_t), ((const uint16_t *)container->data)[j]);
+
+                break;
+            }
+            case ROARING_RUN:
+            {
+                for (j = 0; j < container->size << 1; ++j)
+                    __roaring_store16(out + offset + j * sizeof(uint16_t), ((const uint16_t *)container->data)[j]);
+
+                break;
+            }
+            case ROARING_BITMAP:
+            {
+                for (j = 0; j < ROARING_BITMAP_WORDS; ++j)
+                    __roaring_store64(out + offset + j * sizeof(uint64_t), ((const uint64_t *)container->data)[j]);
+
+                break;
+            }
+            default:
+                ERROR("Incorrect container type\n", -1);
+        }
+
+        offset += __roaring_container_data_size(container);
+    }
+
+    return (ssize_t)offset;
+}
+
+Roaring *roaring_deserialize(const void *buf, size_t size)
+{
+    const BYTE *in = (const BYTE *)buf;
+    const BYTE *hdr;
+    const BYTE *payload;
+    Roaring *roaring;
+    Roaring_container container;
+    uint16_t *array;
+    uint64_t *words;
+    size_t num_containers;
+    size_t payload_size;
+    size_t cardinality;
+    size_t i;
+    size_t j;
+    uint32_t prev_end;
+    uint32_t end;
+
+    TRACE();
+
+    if (buf == NULL || size < ROARING_HEADER_SIZE)
+        ERROR("buf == NULL || size < header\n", NULL);
+
+    if (__roaring_load32(in) != ROARING_MAGIC)
+        ERROR("Incorrect magic\n", NULL);
+
+    num_containers = __roaring_load32(in + 4);
+    if (num_containers > ROARING_CHUNK_SIZE || ROARING_HEADER_SIZE + ROARING_CONTAINER_HDR_SIZE * num_containers > size)
+        ERROR("Incorrect number of containers\n", NULL);
+
+    roaring = roaring_create();
+    if (roaring == NULL)
+        ERROR("roaring_create error\n", NULL);
+
+    for (i = 0; i < num_containers; ++i)
+    {
+        hdr = in + ROARING_HEADER_SIZE + ROARING_CONTAINER_HDR_SIZE * i;
+        if (__roaring_check_header(size, hdr, &payload_size))
+            goto corrupted;
+
+        if (i > 0 && __roaring_load16(hdr) <= roaring->containers[i - 1].key)
+            goto corrupted;
+
+        if (__roaring_container_init(&container, __roaring_load16(hdr), (roaring_container_type_t)hdr[2], __roaring_load32(hdr + 8)))
+            goto error;
+
+        container.size = __roaring_load32(hdr + 8);
+        container.cardinality = __roaring_load32(hdr + 4);
+        payload = in + __roaring_load32(hdr + 12);
+        cardinality = 0;
+
+        switch (container.type)
+        {
+            case ROARING_ARRAY:
+            {
+                array = (uint16_t *)container.data;
+                for (j = 0; j < container.size; ++j)
+                {
+                    array[j] = __roaring_load16(payload + j * sizeof(uint16_t));
+                    if (j > 0 && array[j] <= array[j - 1])
+                        break;
+                }
+
+                cardinality = j;
+                break;
+            }
+            case ROARING_RUN:
+            {
+                array = (uint16_t *)container.data;
+                prev_end = 0;
+                for (j = 0; j < container.size; ++j)
+                {
+                    array[j << 1] = __roaring_load16(payload + (j << 1) * sizeof(uint16_t));
+                    array[(j << 1) + 1] = __roaring_load16(payload + ((j << 1) + 1) * sizeof(uint16_t));
+                    end = (uint32_t)array[j << 1] + (uint32_t)array[(j << 1) + 1];
+                    if (end >= ROARING_CHUNK_SIZE || (j > 0 && array[j << 1] <= prev_end))
+                        break;
+
+                    prev_end = end;
+                    cardinality += (size_t)array[(j << 1) + 1] + 1;
+                }
+
+                if (j != container.size)
+                    cardinality = 0;
+
+                break;
+            }
+            case ROARING_BITMAP:
+            {
+                words = (uint64_t *)container.data;
+                for (j = 0; j < ROARING_BITMAP_WORDS; ++j)
+                {
+                    words[j] = __roaring_load64(payload + j * sizeof(uint64_t));
+                    cardinality += (size_t)__builtin_popcountll(words[j]);
+                }
+
+                break;
+            }
+            default:
+                break;
+        }
+
+        if (cardinality != container.cardinality || __roaring_insert_container(roaring, roaring->num_containers, &container))
+        {
+            FREE(container.data);
+            goto corrupted;
+        }
+    }
+
+    return roaring;
+
+corrupted:
+    roaring_destroy(roaring);
+    ERROR("Corrupted buffer\n", NULL);
+
+error:
+    roaring_destroy(roaring);
+    ERROR("__roaring_container_init error\n", NULL);
+}
+
+int roaring_serialized_contains(const void *buf, size_t size, uint32_t val)
+{
+    const BYTE *in = (const BYTE *)buf;
+    const BYTE *hdr;
+    const BYTE *payload;
+    const uint16_t key = ROARING_KEY(val);
+    const uint16_t low = ROARING_LOW(val);
+    size_t num_containers;
+    size_t payload_size;
+    size_t entries;
+    size_t left;
+    size_t right;
+    size_t middle;
+    uint32_t start;
+
+    TRACE();
+
+    if (buf == NULL || size < ROARING_HEADER_SIZE)
+        ERROR("buf == NULL || size < header\n", -1);
+
+    if (__roaring_load32(in) != ROARING_MAGIC)
+        ERROR("Incorrect magic\n", -1);
+
+    num_containers = __roaring_load32(in + 4);
+    if (num_containers > ROARING_CHUNK_SIZE || ROARING_HEADER_SIZE + ROARING_CONTAINER_HDR_SIZE * num_containers > size)
+        ERROR("Incorrect number of containers\n", -1);
+
+    /* find container */
+    left = 0;
+    right = num_containers;
+    while (left < right)
+    {
+        middle = left + ((right - left) >> 1);
+        if (__roaring_load16(in + ROARING_HEADER_SIZE + ROARING_CONTAINER_HDR_SIZE * middle) < key)
+            left = middle + 1;
+        else
+            right = middle;
+    }
+
+    if (left >= num_containers)
+        return 0;
+
+    hdr = in + ROARING_HEADER_SIZE + ROARING_CONTAINER_HDR_SIZE * left;
+    if (__roaring_load16(hdr) != key)
+        return 0;
+
+    if (__roaring_check_header(size, hdr, &payload_size))
+        ERROR("Corrupted buffer\n", -1);
+
+    entries = __roaring_load32(hdr + 8);
+    payload = in + __roaring_load32(hdr + 12);
+
+    switch (hdr[2])
+    {
+        case ROARING_ARRAY:
+        {
+            left = 0;
+            right = entries;
+            while (left < right)
+            {
+                middle = left + ((right - left) >> 1);
+                if (__roaring_load16(payload + middle * sizeof(uint16_t)) < low)
+                    left = middle + 1;
+                else
+                    right = middle;
+            }
+
+            return left < entries && __roaring_load16(payload + left * sizeof(uint16_t)) == low;
+        }
+        case ROARING_RUN:
+        {
+            left = 0;
+            right = entries;
+            while (left < right)
+            {
+                middle = left + ((right - left) >> 1);
+                start = __roaring_load16(payload + (middle << 1) * sizeof(uint16_t));
+                if (start + __roaring_load16(payload + ((middle << 1) + 1) * sizeof(uint16_t)) < low)
+                    left = middle + 1;
+                else
+                    right = middle;
+            }
+
+            return left < entries && __roaring_load16(payload + (left << 1) * sizeof(uint16_t)) <= low;
+        }
+        case ROARING_BITMAP:
+            return (int)GET_BIT(__roaring_load64(payload + (size_t)(low >> 6) * sizeof(uint64_t)), low & 63);
+        default:
+            ERROR("Incorrect container type\n", -1);
+    }
+}
+
+Roaring_iterator *roaring_iterator_create(const Roaring *roaring, iti_mode_t mode)
+{
+    Roaring_iterator *iterator;
+
+    TRACE();
+
+    if (roaring == NULL)
+        ERROR("roaring == NULL\n", NULL);
+
+    if (mode != ITI_BEGIN && mode != ITI_END)
+        ERROR("Incorrect mode\n", NULL);
+
+    iterator = (Roaring_iterator *)malloc(sizeof(Roaring_iterator));
+    if (iterator == NULL)
+        ERROR("malloc error\n", NULL);
+
+    iterator->containers = roaring->containers;
+    iterator->num_containers = roaring->num_containers;
+    iterator->low = 0;
+
+    if (mode == ITI_BEGIN)
+    {
+        iterator->index = 0;
+        if (iterator->num_containers > 0)
+            (void)__roaring_container_next(&iterator->containers[0], 0, &iterator->low);
+    }
+    else
+    {
+        iterator->index = (ssize_t)iterator->num_containers - 1;
+        if (iterator->num_containers > 0)
+            (void)__roaring_container_prev(&iterator->containers[iterator->index], ROARING_CHUNK_SIZE - 1, &iterator->low);
+    }
+
+    return iterator;
+}
+
+void roaring_iterator_destroy(Roaring_iterator *iterator)
+{
+    TRACE();
+
+    if (iterator == NULL)
+        return;
+
+    FREE(iterator);
+}
+
+bool roaring_iterator_end(const Roaring_iterator *iterator)
+{
+    TRACE();
+
+    if (iterator == NULL)
+        ERROR("iterator == NULL\n", true);
+
+    return (iterator->index < 0 || (size_t)iterator->index >= iterator->num_containers);
+}
+
+int roaring_iterator_get_data(const Roaring_iterator *iterator, void *val)
+{
+    TRACE();
+
+    if (iterator == NULL || val == NULL)
+        ERROR("iterator == NULL || val == NULL\n", 1);
+
+    if (roaring_iterator_end(iterator))
+        ERROR("Iterator is out of range\n", 1);
+
+    *(uint32_t *)val = ROARING_VALUE(iterator->containers[iterator->index].key, iterator->low);
+
+    return 0;
+}
+
+int roaring_iterator_get_node(const Roaring_iterator *iterator, void *node)
+{
+    TRACE();
+
+    if (iterator == NULL || node == NULL)
+        ERROR("iterator == NULL || node == NULL\n", 1);
+
+    return roaring_iterator_get_data(iterator, node);
+}
+
+int roaring_iterator_next(Roaring_iterator *iterator)
+{
+    TRACE();
+
+    if (iterator == NULL)
+        ERROR("iterator == NULL\n", 1);
+
+    if (roaring_iterator_end(iterator))
+        return 0;
+
+    if (__roaring_container_next(&iterator->containers[iterator->index], (uint32_t)iterator->low + 1, &iterator->low))
+        return 0;
+
+    if ((size_t)++iterator->index < iterator->num_containers)
+        (void)__roaring_container_next(&iterator->containers[iterator->index], 0, &iterator->low);
+
+    return 0;
+}
+
+int roaring_iterator_prev(Roaring_iterator *iterator)
+{
+    TRACE();
+
+    if (iterator == NULL)
+        ERROR("iterator == NULL\n", 1);
+
+    if (roaring_iterator_end(iterator))
+        return 0;
+
+    if (iterator->low > 0 && __roaring_container_prev(&iterator->containers[iterator->index], (uint32_t)iterator->low - 1, &iterator->low))
+        return 0;
+
+    if (iterator->index-- > 0)
+        (void)__roaring_container_prev(&iterator->containers[iterator->index], ROARING_CHUNK_SIZE - 1, &iterator->low);
+
+    return 0;
+}
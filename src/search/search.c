@@ -2,6 +2,117 @@
 #include <sys/types.h>
 #include <log.h>
 #include <generic.h>
+#include <compiler.h>
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#define SEARCH_CACHE_LINE               64  /* eytzinger prefetches descendants from one cache line */
+#define SEARCH_INTERPOLATION_SMALL      16  /* range up to this size is finished by binary search */
+#define SEARCH_INTERPOLATION_BAD_STEPS  4   /* after this number of bad steps binary search is used */
+#define SEARCH_BATCH_LANES              16  /* keys searched together in find_first_sorted_batch */
+
+/* long is 32bit on ILP32, SIMD compare width has to match it */
+#if __SIZEOF_LONG__ == 8
+#define SEARCH_LONG_BITS 64
+#else
+#define SEARCH_LONG_BITS 32
+#endif
+
+#if defined(__AVX2__)
+#define SEARCH_VEC_BYTES 32
+typedef __m256i search_vec_t;
+#define search_vec_set32(x)         _mm256_set1_epi32((int)(x))
+#define search_vec_set64(x)         _mm256_set1_epi64x((long long)(x))
+#define search_vec_load(ptr)        _mm256_loadu_si256((const __m256i *)(const void *)(ptr))
+#define search_vec_eq32_mask(ptr, v) \
+    (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(search_vec_load(ptr), v)))
+#define search_vec_eq64_mask(ptr, v) \
+    (unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(search_vec_load(ptr), v)))
+#elif defined(__SSE2__)
+#define SEARCH_VEC_BYTES 16
+typedef __m128i search_vec_t;
+#define search_vec_set32(x)         _mm_set1_epi32((int)(x))
+#define search_vec_set64(x)         _mm_set1_epi64x((long long)(x))
+#define search_vec_load(ptr)        _mm_loadu_si128((const __m128i *)(const void *)(ptr))
+#define search_vec_eq32_mask(ptr, v) \
+    (unsigned)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(search_vec_load(ptr), v)))
+/* SSE2 has not 64bit compare, 64bit lane is equal iff both 32bit halves are equal */
+#define search_vec_eq64_mask(ptr, v) \
+    __extension__ \
+    ({ \
+        const __m128i __eq = _mm_cmpeq_epi32(search_vec_load(ptr), v); \
+        (unsigned)_mm_movemask_pd(_mm_castsi128_pd(_mm_and_si128(__eq, _mm_shuffle_epi32(__eq, _MM_SHUFFLE(2, 3, 0, 1))))); \
+    })
+#endif
+
+#define search_prefetch(addr) load_to_cache(addr, CACHE_READ, CACHE_SAVE_NORMAL_PRIO)
+
+/*
+    Branchless binary search: half of range is dropped by conditional move,
+    both possible next midpoints are prefetched
+
+    PARAMS
+    @IN key - data with key to find
+    @IN t - array
+    @IN num_elements - number of elements (> 0)
+    @IN cmp - compare func
+    @IN size_of - data size of
+    @IN upper - false for lower bound (first >= key), true for upper bound (first > key)
+
+    RETURN
+    Index of bound (num_elements iff all elements are before bound)
+*/
+static ___inline___ size_t __search_bound(const void * ___restrict___ key, const BYTE * ___restrict___ t, size_t num_elements, cmp_f cmp, size_t size_of, bool upper);
+
+/*
+    Eytzinger layout of sorted array by in-order walk over implicit tree
+
+    PARAMS
+    @IN sorted - sorted array
+    @OUT out - array in Eytzinger layout
+    @IN i - index of next element in sorted
+    @IN k - node (1-based)
+    @IN num_elements - number of elements
+    @IN size_of - data size of
+
+    RETURN
+    Index of next element in sorted after subtree k
+*/
+static size_t __eytzinger_build(const BYTE * ___restrict___ sorted, BYTE * ___restrict___ out, size_t i, size_t k, size_t num_elements, size_t size_of);
+
+static ___inline___ size_t __search_bound(const void * ___restrict___ key, const BYTE * ___restrict___ t, size_t num_elements, cmp_f cmp, size_t size_of, bool upper)
+{
+    size_t base = 0;
+    size_t half;
+
+    while (num_elements > 1)
+    {
+        half = num_elements >> 1;
+        search_prefetch(&t[(base + ((num_elements - half) >> 1)) * size_of]);
+        search_prefetch(&t[(base + half + ((num_elements - half) >> 1)) * size_of]);
+
+        /* lower: t[mid] < key, upper: t[mid] <= key */
+        base = cmp((const void *)&t[(base + half) * size_of], key) < (int)upper ? base + half : base;
+        num_elements -= half;
+    }
+
+    return base + (size_t)(cmp((const void *)&t[base * size_of], key) < (int)upper);
+}
+
+static size_t __eytzinger_build(const BYTE * ___restrict___ sorted, BYTE * ___restrict___ out, size_t i, size_t k, size_t num_elements, size_t size_of)
+{
+    if (k > num_elements)
+        return i;
+
+    i = __eytzinger_build(sorted, out, i, k << 1, num_elements, size_of);
+    (void)memcpy(&out[(k - 1) * size_of], &sorted[i * size_of], size_of);
+
+    return __eytzinger_build(sorted, out, i + 1, (k << 1) + 1, num_elements, size_of);
+}
 
 ssize_t find_first_unsorted(const void * ___restrict___ key, const void * ___restrict___ t, size_t num_elements, cmp_f cmp, size_t size_of)
 {
@@ -65,11 +176,35 @@ ssize_t find_last_unsorted(const void * ___restrict___ key, const void * ___rest
 
 ssize_t find_first_sorted(const void * ___restrict___ key, const void * ___restrict___ t, size_t num_elements, cmp_f cmp, size_t size_of)
 {
-    BYTE *_t;
+    const BYTE *_t;
+    size_t index;
+
+    TRACE();
+
+    if (key == NULL)
+        ERROR("key == NULL\n", -1);
 
-    size_t left;
-    size_t right;
-    size_t middle;
+    if (t == NULL)
+        ERROR("t == NULL\n", -1);
+
+    if (cmp == NULL)
+        ERROR("cmp == NULL\n", -1);
+
+    if (num_elements == 0)
+        ERROR("Empty array\n", -1);
+
+    _t = (const BYTE *)t;
+    index = __search_bound(key, _t, num_elements, cmp, size_of, false);
+    if (index < num_elements && cmp((const void *)&_t[index * size_of], key) == 0)
+        return (ssize_t)index;
+
+    return -1;
+}
+
+ssize_t find_last_sorted(const void * ___restrict___ key, const void * ___restrict___ t, size_t num_elements, cmp_f cmp, size_t size_of)
+{
+    const BYTE *_t;
+    size_t index;
 
     TRACE();
 
@@ -85,32 +220,113 @@ ssize_t find_first_sorted(const void * ___restrict___ key, const void * ___restr
     if (num_elements == 0)
         ERROR("Empty array\n", -1);
 
-     _t = (BYTE *)t;
+    _t = (const BYTE *)t;
+    index = __search_bound(key, _t, num_elements, cmp, size_of, true);
+    if (index > 0 && cmp((const void *)&_t[(index - 1) * size_of], key) == 0)
+        return (ssize_t)index - 1;
+
+    return -1;
+}
+
+ssize_t find_first_sorted_batch(const void * ___restrict___ keys, size_t num_keys, const void * ___restrict___ t, size_t num_elements,
+                                cmp_f cmp, size_t size_of, ssize_t * ___restrict___ pos)
+{
+    size_t base[SEARCH_BATCH_LANES];
+    const BYTE *_t;
+    const BYTE *_keys;
+    size_t first;
+    size_t lanes;
+    size_t n;
+    size_t half;
+    size_t next_half;
+    size_t index;
+    size_t i;
+    ssize_t num_found;
+
+    TRACE();
+
+    if (keys == NULL)
+        ERROR("keys == NULL\n", -1);
+
+    if (t == NULL)
+        ERROR("t == NULL\n", -1);
+
+    if (cmp == NULL)
+        ERROR("cmp == NULL\n", -1);
+
+    if (pos == NULL)
+        ERROR("pos == NULL\n", -1);
+
+    if (num_keys == 0)
+        ERROR("num_keys == 0\n", -1);
+
+    if (num_elements == 0)
+        ERROR("Empty array\n", -1);
+
+    _t = (const BYTE *)t;
+    _keys = (const BYTE *)keys;
+    num_found = 0;
 
-    left = 0;
-    right = (num_elements - 1) * size_of;
-    while (left < right)
+    for (first = 0; first < num_keys; first += lanes)
     {
-        middle = ((left / size_of + right / size_of) >> 1) * size_of;
-        if (cmp((void *)(_t + middle), key) < 0)
-            left = middle + size_of;
-        else
-            right = middle;
+        lanes = MIN((size_t)SEARCH_BATCH_LANES, num_keys - first);
+        for (i = 0; i < lanes; ++i)
+            base[i] = 0;
+
+        /* branchless search has the same number of steps for every key, so lanes go together */
+        n = num_elements;
+        while (n > 1)
+        {
+            half = n >> 1;
+            next_half = (n - half) >> 1;
+            for (i = 0; i < lanes; ++i)
+            {
+                base[i] = cmp((const void *)&_t[(base[i] + half) * size_of], (const void *)&_keys[(first + i) * size_of]) < 0 ?
+                          base[i] + half : base[i];
+                search_prefetch(&_t[(base[i] + next_half) * size_of]);
+            }
+
+            n -= half;
+        }
+
+        for (i = 0; i < lanes; ++i)
+        {
+            index = base[i] + (size_t)(cmp((const void *)&_t[base[i] * size_of], (const void *)&_keys[(first + i) * size_of]) < 0);
+            if (index < num_elements && cmp((const void *)&_t[index * size_of], (const void *)&_keys[(first + i) * size_of]) == 0)
+            {
+                pos[first + i] = (ssize_t)index;
+                ++num_found;
+            }
+            else
+                pos[first + i] = -1;
+        }
     }
 
-    if (cmp((void *)(_t + left), key) == 0)
-        return (ssize_t)left / (ssize_t)size_of;
-
-    return -1;
+    return num_found;
 }
 
-ssize_t find_last_sorted(const void * ___restrict___ key, const void * ___restrict___ t, size_t num_elements, cmp_f cmp, size_t size_of)
+int eytzinger_build(const void * ___restrict___ sorted, size_t num_elements, size_t size_of, void * ___restrict___ out)
 {
-    BYTE *_t;
+    TRACE();
+
+    if (sorted == NULL || out == NULL)
+        ERROR("sorted == NULL || out == NULL\n", 1);
+
+    if (num_elements == 0)
+        ERROR("Empty array\n", 1);
+
+    if (size_of == 0)
+        ERROR("size_of == 0\n", 1);
 
-    size_t left;
-    size_t right;
-    size_t middle;
+    (void)__eytzinger_build((const BYTE *)sorted, (BYTE *)out, 0, 1, num_elements, size_of);
+
+    return 0;
+}
+
+ssize_t eytzinger_lower_bound(const void * ___restrict___ key, const void * ___restrict___ t, size_t num_elements, cmp_f cmp, size_t size_of)
+{
+    const BYTE *_t;
+    size_t k;
 
     TRACE();
 
@@ -126,21 +342,289 @@ ssize_t find_last_sorted(const void * ___restrict___ key, const void * ___restri
     if (num_elements == 0)
         ERROR("Empty array\n", -1);
 
-     _t = (BYTE *)t;
+    _t = (const BYTE *)t;
 
-    left = 0;
-    right = (num_elements - 1) * size_of;
-    while (left < right)
+    /* go right iff node < key, prefetch grandchildren (4 nodes in a row) */
+    k = 1;
+    while (k <= num_elements)
     {
-        middle = ((left / size_of + right / size_of + 1) >> 1) * size_of;
-        if (cmp((void *)(_t + middle), key) > 0)
-            right = middle - size_of;
-        else
-            left = middle;
+        search_prefetch(&_t[((k << 2) - 1 < num_elements ? (k << 2) - 1 : 0) * size_of]);
+        k = (k << 1) + (size_t)(cmp((const void *)&_t[(k - 1) * size_of], key) < 0);
     }
 
-    if (cmp((void *)(_t + left), key) == 0)
-        return (ssize_t)left / (ssize_t)size_of;
+    /* cancel right turns after last left turn */
+    k >>= __builtin_ffsl((long)~k);
 
-    return -1;
-}
\ No newline at end of file
+    return k == 0 ? -1 : (ssize_t)(k - 1);
+}
+
+/*
+    Typed searches, no cmp calls
+
+    TYPE - type of element
+    UTYPE - unsigned type with the same size (distances for interpolation)
+    SUFFIX - suffix of functions
+    BITS - 32 or 64 (SIMD lanes)
+*/
+#define SEARCH_TYPED(TYPE, UTYPE, SUFFIX, BITS) \
+static ___inline___ size_t __search_lower_bound_##SUFFIX(TYPE key, const TYPE *t, size_t num_elements) \
+{ \
+    size_t base = 0; \
+    size_t half; \
+    \
+    while (num_elements > 1) \
+    { \
+        half = num_elements >> 1; \
+        search_prefetch(&t[base + ((num_elements - half) >> 1)]); \
+        search_prefetch(&t[base + half + ((num_elements - half) >> 1)]); \
+        base = t[base + half] < key ? base + half : base; \
+        num_elements -= half; \
+    } \
+    \
+    return base + (size_t)(t[base] < key); \
+} \
+\
+static ___inline___ size_t __search_upper_bound_##SUFFIX(TYPE key, const TYPE *t, size_t num_elements) \
+{ \
+    size_t base = 0; \
+    size_t half; \
+    \
+    while (num_elements > 1) \
+    { \
+        half = num_elements >> 1; \
+        search_prefetch(&t[base + ((num_elements - half) >> 1)]); \
+        search_prefetch(&t[base + half + ((num_elements - half) >> 1)]); \
+        base = t[base + half] <= key ? base + half : base; \
+        num_elements -= half; \
+    } \
+    \
+    return base + (size_t)(t[base] <= key); \
+} \
+\
+ssize_t find_first_unsorted_##SUFFIX(TYPE key, const TYPE *t, size_t num_elements) \
+{ \
+    size_t i = 0; \
+    \
+    TRACE(); \
+    \
+    if (t == NULL) \
+        ERROR("t == NULL\n", -1); \
+    \
+    if (num_elements == 0) \
+        ERROR("Empty array\n", -1); \
+    \
+    SEARCH_VEC_FIRST(TYPE, BITS); \
+    \
+    for (; i < num_elements; ++i) \
+        if (t[i] == key) \
+            return (ssize_t)i; \
+    \
+    return -1; \
+} \
+\
+ssize_t find_last_unsorted_##SUFFIX(TYPE key, const TYPE *t, size_t num_elements) \
+{ \
+    size_t i = num_elements; \
+    \
+    TRACE(); \
+    \
+    if (t == NULL) \
+        ERROR("t == NULL\n", -1); \
+    \
+    if (num_elements == 0) \
+        ERROR("Empty array\n", -1); \
+    \
+    SEARCH_VEC_LAST(TYPE, BITS); \
+    \
+    while (i > 0) \
+        if (t[--i] == key) \
+            return (ssize_t)i; \
+    \
+    return -1; \
+} \
+\
+ssize_t find_first_sorted_##SUFFIX(TYPE key, const TYPE *t, size_t num_elements) \
+{ \
+    size_t index; \
+    \
+    TRACE(); \
+    \
+    if (t == NULL) \
+        ERROR("t == NULL\n", -1); \
+    \
+    if (num_elements == 0) \
+        ERROR("Empty array\n", -1); \
+    \
+    index = __search_lower_bound_##SUFFIX(key, t, num_elements); \
+    \
+    return index < num_elements && t[index] == key ? (ssize_t)index : -1; \
+} \
+\
+ssize_t find_last_sorted_##SUFFIX(TYPE key, const TYPE *t, size_t num_elements) \
+{ \
+    size_t index; \
+    \
+    TRACE(); \
+    \
+    if (t == NULL) \
+        ERROR("t == NULL\n", -1); \
+    \
+    if (num_elements == 0) \
+        ERROR("Empty array\n", -1); \
+    \
+    index = __search_upper_bound_##SUFFIX(key, t, num_elements); \
+    \
+    return index > 0 && t[index - 1] == key ? (ssize_t)index - 1 : -1; \
+} \
+\
+ssize_t find_lower_bound_##SUFFIX(TYPE key, const TYPE *t, size_t num_elements) \
+{ \
+    TRACE(); \
+    \
+    if (t == NULL) \
+        ERROR("t == NULL\n", -1); \
+    \
+    if (num_elements == 0) \
+        ERROR("Empty array\n", -1); \
+    \
+    return (ssize_t)__search_lower_bound_##SUFFIX(key, t, num_elements); \
+} \
+\
+ssize_t find_upper_bound_##SUFFIX(TYPE key, const TYPE *t, size_t num_elements) \
+{ \
+    TRACE(); \
+    \
+    if (t == NULL) \
+        ERROR("t == NULL\n", -1); \
+    \
+    if (num_elements == 0) \
+        ERROR("Empty array\n", -1); \
+    \
+    return (ssize_t)__search_upper_bound_##SUFFIX(key, t, num_elements); \
+} \
+\
+ssize_t find_first_interpolation_##SUFFIX(TYPE key, const TYPE *t, size_t num_elements) \
+{ \
+    size_t left; \
+    size_t right; \
+    size_t pos; \
+    size_t range; \
+    size_t bad_steps = SEARCH_INTERPOLATION_BAD_STEPS; \
+    \
+    TRACE(); \
+    \
+    if (t == NULL) \
+        ERROR("t == NULL\n", -1); \
+    \
+    if (num_elements == 0) \
+        ERROR("Empty array\n", -1); \
+    \
+    if (key < t[0] || key > t[num_elements - 1]) \
+        return -1; \
+    \
+    /* invariant: t[left - 1] < key <= t[right] */ \
+    left = 0; \
+    right = num_elements - 1; \
+    while (right - left > SEARCH_INTERPOLATION_SMALL && t[left] < key) \
+    { \
+        /* distances as unsigned, so key - t[left] can not overflow */ \
+        range = right - left; \
+        pos = left + (size_t)((double)((UTYPE)key - (UTYPE)t[left]) / \
+                              (double)((UTYPE)t[right] - (UTYPE)t[left]) * (double)range); \
+        pos = MIN(pos, right - 1); \
+        \
+        if (t[pos] < key) \
+            left = pos + 1; \
+        else \
+            right = pos; \
+        \
+        /* keys are not uniform, less than 3/4 of range dropped */ \
+        if (right - left > (range >> 2) && --bad_steps == 0) \
+            break; \
+    } \
+    \
+    left += __search_lower_bound_##SUFFIX(key, t + left, right - left + 1); \
+    \
+    return t[left] == key ? (ssize_t)left : -1; \
+} \
+\
+ssize_t eytzinger_lower_bound_##SUFFIX(TYPE key, const TYPE *t, size_t num_elements) \
+{ \
+    /* descendants of k at depth log2(block) are in one cache line */ \
+    const size_t block = SEARCH_CACHE_LINE / sizeof(TYPE); \
+    size_t k; \
+    \
+    TRACE(); \
+    \
+    if (t == NULL) \
+        ERROR("t == NULL\n", -1); \
+    \
+    if (num_elements == 0) \
+        ERROR("Empty array\n", -1); \
+    \
+    k = 1; \
+    while (k <= num_elements) \
+    { \
+        search_prefetch(&t[k * block - 1 < num_elements ? k * block - 1 : 0]); \
+        k = (k << 1) + (size_t)(t[k - 1] < key); \
+    } \
+    \
+    k >>= __builtin_ffsl((long)~k); \
+    \
+    return k == 0 ? -1 : (ssize_t)(k - 1); \
+} \
+\
+ssize_t eytzinger_find_##SUFFIX(TYPE key, const TYPE *t, size_t num_elements) \
+{ \
+    ssize_t index; \
+    \
+    TRACE(); \
+    \
+    index = eytzinger_lower_bound_##SUFFIX(key, t, num_elements); \
+    \
+    return index != -1 && t[index] == key ? index : -1; \
+}
+
+#if defined(SEARCH_VEC_BYTES)
+
+/* blocks of SIMD lanes, i is index of first not checked element */
+#define SEARCH_VEC_FIRST(TYPE, BITS) \
+    do { \
+        const size_t __lanes = SEARCH_VEC_BYTES / sizeof(TYPE); \
+        const search_vec_t __v = search_vec_set##BITS(key); \
+        unsigned __mask; \
+        \
+        for (; i + __lanes <= num_elements; i += __lanes) \
+        { \
+            __mask = search_vec_eq##BITS##_mask(t + i, __v); \
+            if (__mask) \
+                return (ssize_t)(i + (size_t)__builtin_ctz(__mask)); \
+        } \
+    } while (0)
+
+/* blocks of SIMD lanes from the end, i is index after last not checked element */
+#define SEARCH_VEC_LAST(TYPE, BITS) \
+    do { \
+        const size_t __lanes = SEARCH_VEC_BYTES / sizeof(TYPE); \
+        const search_vec_t __v = search_vec_set##BITS(key); \
+        unsigned __mask; \
+        \
+        for (; i >= __lanes; i -= __lanes) \
+        { \
+            __mask = search_vec_eq##BITS##_mask(t + i - __lanes, __v); \
+            if (__mask) \
+                return (ssize_t)(i - __lanes + (size_t)(31 - __builtin_clz(__mask))); \
+        } \
+    } while (0)
+
+#else
+
+#define SEARCH_VEC_FIRST(TYPE, BITS) do { } while (0)
+#define SEARCH_VEC_LAST(TYPE, BITS) do { } while (0)
+
+#endif
+
+SEARCH_TYPED(int, unsigned int, int, 32)
+SEARCH_TYPED(unsigned int, unsigned int, uint, 32)
+SEARCH_TYPED(long, unsigned long, long, SEARCH_LONG_BITS)
+SEARCH_TYPED(unsigned long, unsigned long, ulong, SEARCH_LONG_BITS)
@@ -8,66 +8,381 @@
 #include <string.h>
 #include <search.h>
 
-ssize_t select_kth(const void *t, size_t len, size_t size_of, size_t k, cmp_f cmp)
+#define SELECT_SMALL        16  /* ranges up to this size are sorted by insort */
+#define SELECT_FR_MIN       600 /* Floyd-Rivest sampling from this size */
+#define SELECT_MOM_GROUP    5
+
+/*
+    Integer square root
+
+    PARAMS
+    @IN x - number
+
+    RETURN
+    floor(sqrt(x))
+*/
+static size_t __select_isqrt(size_t x);
+
+/*
+    Get pivot by median of medians of 5 (guaranteed 30% / 70% split)
+
+    PARAMS
+    @IN t - array
+    @IN left - first index of range
+    @IN right - last index of range
+    @IN cmp - compare function
+    @IN size_of - size of element
+
+    RETURN
+    -1 iff failure
+    Index of pivot iff success
+*/
+static ssize_t __select_pivot_mom(BYTE *t, size_t left, size_t right, cmp_f cmp, size_t size_of);
+
+/*
+    Get pivot by Floyd-Rivest: select k in small sample around expected position of k,
+    so pivot is very close to kth element and next range is tiny
+
+    PARAMS
+    @IN t - array
+    @IN left - first index of range
+    @IN right - last index of range
+    @IN k - index of kth element (left <= k <= right)
+    @IN cmp - compare function
+    @IN size_of - size of element
+
+    RETURN
+    -1 iff failure
+    Index of pivot iff success
+*/
+static ssize_t __select_pivot_fr(BYTE *t, size_t left, size_t right, size_t k, cmp_f cmp, size_t size_of);
+
+/*
+    Introselect: rearrange t[left .. right] so t[k] is on its sorted position,
+    t[left .. k) <= t[k] <= t(k .. right]
+
+    Pivots are taken from Floyd-Rivest sample (big ranges) or tukey medians (small ranges),
+    after log2(n) bad splits median of medians is used, so worst case is O(n)
+
+    PARAMS
+    @IN t - array
+    @IN left - first index of range
+    @IN right - last index of range
+    @IN k - index of kth element (left <= k <= right)
+    @IN cmp - compare function
+    @IN size_of - size of element
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+static int __select_range(BYTE *t, size_t left, size_t right, size_t k, cmp_f cmp, size_t size_of);
+
+/*
+    Multi selection: select middle k, then recurse to left part with smaller ks and right part with bigger ks
+
+    PARAMS
+    @IN t - array
+    @IN left - first index of range
+    @IN right - last index of range
+    @IN ks - sorted indexes in range
+    @IN num_ks - number of ks
+    @IN cmp - compare function
+    @IN size_of - size of element
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+static int __select_multi(BYTE *t, size_t left, size_t right, const size_t *ks, size_t num_ks, cmp_f cmp, size_t size_of);
+
+/*
+    Check params of selection functions
+
+    PARAMS
+    @IN t - array
+    @IN len - array len
+    @IN size_of - size of element
+    @IN cmp - compare function
+
+    RETURN
+    0 iff params are correct
+    Non-zero value iff not
+*/
+static int __select_check(const void *t, size_t len, size_t size_of, cmp_f cmp);
+
+static size_t __select_isqrt(size_t x)
 {
-    size_t offset_left;
-    size_t offset_right;
-    size_t _size_of = size_of;
-    size_t left;
-    size_t right;
-    size_t p_index;
-    size_t range;
-    size_t ith;
+    size_t r;
+    size_t y;
 
-    BYTE *_t;
-    BYTE var[size_of];
+    if (x < 2)
+        return x;
+
+    /* newton from above */
+    r = x;
+    y = (r + 1) >> 1;
+    while (y < r)
+    {
+        r = y;
+        y = (r + x / r) >> 1;
+    }
+
+    return r;
+}
+
+static ssize_t __select_pivot_mom(BYTE *t, size_t left, size_t right, cmp_f cmp, size_t size_of)
+{
+    size_t groups = 0;
+    size_t i;
+    size_t len;
+    size_t mid;
+
+    TRACE();
+
+    for (i = left; i <= right; i += SELECT_MOM_GROUP)
+    {
+        len = MIN((size_t)SELECT_MOM_GROUP, right - i + 1);
+        if (insort((void *)(t + i * size_of), len, cmp, size_of))
+            ERROR("insort error\n", -1);
+
+        /* medians are collected on the begining of range */
+        mid = i + (len >> 1);
+        __SWAP__(t[mid * size_of], t[(left + groups) * size_of], size_of);
+        ++groups;
+    }
+
+    mid = left + ((groups - 1) >> 1);
+    if (__select_range(t, left, left + groups - 1, mid, cmp, size_of))
+        ERROR("__select_range error\n", -1);
+
+    return (ssize_t)mid;
+}
+
+static ssize_t __select_pivot_fr(BYTE *t, size_t left, size_t right, size_t k, cmp_f cmp, size_t size_of)
+{
+    const size_t n = right - left + 1;
+    const size_t i = k - left;
+    const size_t lg = (size_t)LOG2_long((unsigned long)n);
+    size_t s;
+    size_t sd;
+    size_t lo;
+    size_t hi;
+
+    TRACE();
+
+    /* s = n^(2/3) / 2, sd = sqrt(ln(n) * s) / 2 (ln(n) ~ 0.7 * log2(n)) */
+    s = (size_t)BIT((lg << 1) / 3) >> 1;
+    sd = __select_isqrt(lg * s * 7 / 10) >> 1;
+
+    lo = i * s / n;
+    hi = (n - i) * s / n;
+
+    /* move sample to the center */
+    if (i < (n >> 1))
+    {
+        lo += sd;
+        hi = hi > sd ? hi - sd : 0;
+    }
+    else
+    {
+        lo = lo > sd ? lo - sd : 0;
+        hi += sd;
+    }
+
+    lo = MIN(lo, i);
+    hi = MIN(hi, right - k);
+
+    if (__select_range(t, k - lo, k + hi, k, cmp, size_of))
+        ERROR("__select_range error\n", -1);
+
+    return (ssize_t)k;
+}
+
+static int __select_range(BYTE *t, size_t left, size_t right, size_t k, cmp_f cmp, size_t size_of)
+{
+    size_t budget;
+    size_t n;
+    size_t lt;
+    size_t gt;
+    ssize_t pivot;
+
+    TRACE();
+
+    budget = (size_t)LOG2_long((unsigned long)(right - left + 1)) + 1;
+    while (left < right)
+    {
+        n = right - left + 1;
+        if (n <= SELECT_SMALL)
+            return insort((void *)(t + left * size_of), n, cmp, size_of);
+
+        if (budget == 0)
+            pivot = __select_pivot_mom(t, left, right, cmp, size_of);
+        else if (n >= SELECT_FR_MIN)
+            pivot = __select_pivot_fr(t, left, right, k, cmp, size_of);
+        else
+            pivot = (ssize_t)(left + partition_get_pivot_median(t + left * size_of, n, size_of, cmp));
+
+        if (pivot == -1)
+            ERROR("pivot error\n", 1);
 
+        __SWAP__(t[(size_t)pivot * size_of], t[left * size_of], size_of);
+
+        /* 3 way: [left, lt) < pivot, [lt, gt) == pivot, [gt, right] > pivot, duplicates end selection */
+        pivot = partition_bentley(t, left, right, cmp, size_of, &lt, &gt);
+        if (pivot == -1)
+            ERROR("partition_bentley error\n", 1);
+
+        lt = (size_t)pivot;
+        if (k < lt)
+            right = lt - 1;
+        else if (k >= gt)
+            left = gt;
+        else
+            return 0;
+
+        /* part bigger than 3/4 is a bad split */
+        if ((right - left + 1) > n - (n >> 2) && budget > 0)
+            --budget;
+    }
+
+    return 0;
+}
+
+static int __select_multi(BYTE *t, size_t left, size_t right, const size_t *ks, size_t num_ks, cmp_f cmp, size_t size_of)
+{
+    size_t mid;
+    size_t k;
+    size_t first;
+    size_t last;
+
+    TRACE();
+
+    while (num_ks > 0)
+    {
+        if (right - left + 1 <= SELECT_SMALL)
+            return insort((void *)(t + left * size_of), right - left + 1, cmp, size_of);
+
+        mid = num_ks >> 1;
+        k = ks[mid];
+        if (__select_range(t, left, right, k, cmp, size_of))
+            ERROR("__select_range error\n", 1);
+
+        /* the same k can be requested many times */
+        first = mid;
+        while (first > 0 && ks[first - 1] == k)
+            --first;
+
+        last = mid + 1;
+        while (last < num_ks && ks[last] == k)
+            ++last;
+
+        /* smaller part by recursion, bigger by loop */
+        if (first < num_ks - last)
+        {
+            if (first > 0 && __select_multi(t, left, k - 1, ks, first, cmp, size_of))
+                ERROR("__select_multi error\n", 1);
+
+            left = k + 1;
+            ks += last;
+            num_ks -= last;
+        }
+        else
+        {
+            if (last < num_ks && __select_multi(t, k + 1, right, ks + last, num_ks - last, cmp, size_of))
+                ERROR("__select_multi error\n", 1);
+
+            right = k - 1;
+            num_ks = first;
+        }
+    }
+
+    return 0;
+}
+
+static int __select_check(const void *t, size_t len, size_t size_of, cmp_f cmp)
+{
     TRACE();
 
     if (t == NULL)
-        ERROR("t == NULL\n", -1);
+        ERROR("t == NULL\n", 1);
 
     if (len == 0)
-        ERROR("len == 0\n", -1);
+        ERROR("len == 0\n", 1);
 
     if (size_of == 0)
-        ERROR("size_of == 0\n", -1);
+        ERROR("size_of == 0\n", 1);
 
     if (cmp == NULL)
-        ERROR("cmp is needed\n", -1);
+        ERROR("cmp is needed\n", 1);
+
+    return 0;
+}
+
+ssize_t select_kth(const void *t, size_t len, size_t size_of, size_t k, cmp_f cmp)
+{
+    BYTE *_t;
+    ssize_t index;
+
+    TRACE();
+
+    if (__select_check(t, len, size_of, cmp))
+        ERROR("Invalid params\n", -1);
 
     if (k >= len)
         ERROR("k must be >= 0 and < len\n", -1);
 
-    _t = (BYTE *)malloc(len * _size_of);
+    _t = (BYTE *)malloc(len * size_of);
     if (_t == NULL)
         ERROR("malloc error\n", -1);
 
-    (void)memcpy(_t, t, len * _size_of);
-
-    offset_left = 0;
-    offset_right = (len - 1) * _size_of;
+    (void)memcpy(_t, t, len * size_of);
 
-    while ((ssize_t)offset_left < (ssize_t)offset_right)
+    if (__select_range(_t, 0, len - 1, k, cmp, size_of))
     {
-        range = (offset_right - offset_left) / _size_of + 1;
-        p_index = partition_get_pivot_median(_t + offset_left, range, size_of, cmp) *_size_of + offset_left;
-        __SWAP__(_t[p_index], _t[offset_left], _size_of);
-
-        p_index = (size_t)partition_hoare(_t, offset_left / _size_of, offset_right / _size_of, cmp, size_of, &left, &right);
-        ith = p_index - (offset_left / _size_of);
-
-        if(k < ith)
-            offset_right = (p_index - 1) * _size_of;
-        else
-        {
-            k -= ith;
-            offset_left = (p_index) * _size_of;
-        }
+        FREE(_t);
+        ERROR("__select_range error\n", -1);
     }
 
-    __ASSIGN__(var[0], _t[offset_left], _size_of);
+    index = find_first_unsorted(&_t[k * size_of], t, len, cmp, size_of);
     FREE(_t);
 
-    return find_first_unsorted(&var[0], t, len, cmp, size_of);
-}
\ No newline at end of file
+    return index;
+}
+
+int select_kth_inplace(void *t, size_t len, size_t size_of, size_t k, cmp_f cmp)
+{
+    TRACE();
+
+    if (__select_check(t, len, size_of, cmp))
+        ERROR("Invalid params\n", 1);
+
+    if (k >= len)
+        ERROR("k must be >= 0 and < len\n", 1);
+
+    return __select_range((BYTE *)t, 0, len - 1, k, cmp, size_of);
+}
+
+int select_multi_inplace(void *t, size_t len, size_t size_of, const size_t *ks, size_t num_ks, cmp_f cmp)
+{
+    size_t i;
+
+    TRACE();
+
+    if (__select_check(t, len, size_of, cmp))
+        ERROR("Invalid params\n", 1);
+
+    if (ks == NULL || num_ks == 0)
+        ERROR("ks == NULL || num_ks == 0\n", 1);
+
+    for (i = 0; i < num_ks; ++i)
+    {
+        if (ks[i] >= len)
+            ERROR("k must be >= 0 and < len\n", 1);
+
+        if (i > 0 && ks[i] < ks[i - 1])
+            ERROR("ks are not sorted\n", 1);
+    }
+
+    return __select_multi((BYTE *)t, 0, len - 1, ks, num_ks, cmp, size_of);
+}
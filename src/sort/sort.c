@@ -8,13 +8,68 @@
 #include <common.h>
 #include <assert.h>
 #include <partition.h>
+#include <time.h>
 
 #define MERGESORT_CUTOFF 8
 #define QUICKSORT_CUTOFF 8
 
+/* default tuning */
 #define INSORT_TRESHOLD      32
 #define BINSORT_TRESHOLD     128
 
+/* calibration: elements sorted in one measurement, measurements per point, size for indirect test */
+#define SORT_CALIBRATE_ELEMENTS         BIT(14)
+#define SORT_CALIBRATE_REPS             3
+#define SORT_CALIBRATE_INDIRECT_N       BIT(12)
+#define SORT_CALIBRATE_INDIRECT_GAIN    0.9 /* indirect sort has to be 10% faster */
+
+/* radix sort by key: 1 byte per pass */
+#define SORT_RADIX_BUCKETS  BIT(8)
+
+#define SORT_TUNING_FILE_HEADER "# size_of insort_threshold binsort_threshold indirect\n"
+#define SORT_TUNING_ENV         "SORT_TUNING"   /* path to tuning file loaded before main */
+
+typedef int (*sort_f)(void *t, size_t num_elements, cmp_f cmp, size_t size_of);
+
+/* pointer to element while sorting, index of element after */
+typedef union Sort_ref
+{
+    BYTE    *ptr;
+    size_t  index;
+} Sort_ref;
+
+#define SORT_TUNING_DEFAULT(SIZE) { SIZE, INSORT_TRESHOLD, BINSORT_TRESHOLD, false }
+
+static const Sort_tuning sort_tuning_default[SORT_TUNING_NUM_CLASSES] =
+{
+    SORT_TUNING_DEFAULT(4),
+    SORT_TUNING_DEFAULT(8),
+    SORT_TUNING_DEFAULT(16),
+    SORT_TUNING_DEFAULT(32),
+    SORT_TUNING_DEFAULT(64),
+    SORT_TUNING_DEFAULT(128),
+    SORT_TUNING_DEFAULT(256),
+    SORT_TUNING_DEFAULT(512)
+};
+
+static Sort_tuning sort_tuning[SORT_TUNING_NUM_CLASSES] =
+{
+    SORT_TUNING_DEFAULT(4),
+    SORT_TUNING_DEFAULT(8),
+    SORT_TUNING_DEFAULT(16),
+    SORT_TUNING_DEFAULT(32),
+    SORT_TUNING_DEFAULT(64),
+    SORT_TUNING_DEFAULT(128),
+    SORT_TUNING_DEFAULT(256),
+    SORT_TUNING_DEFAULT(512)
+};
+
+/* number of elements checked by calibration */
+static const size_t sort_calibrate_n[] = {8, 12, 16, 24, 32, 48, 64, 96, 128, 192, 256, 384, 512};
+
+/* user cmp for indirect sort */
+static __thread cmp_f sort_indirect_cmp;
+
 /*
     Merge 2 subarrays of t array and write it to buffer so in buffer we got merged array
 
@@ -61,6 +116,209 @@ static int _quicksort(  void        *t,
                         cmp_f       cmp,
                         size_t      size_of);
 
+/*
+    Binsort without checks and cut off to insort
+
+    PARAMS
+    @IN t - array
+    @IN num_element - number of element in array t
+    @IN cmp - compare function
+    @IN size_of - size of element
+
+    RETURN:
+    %0 if success
+    %Non-zero value if failure
+*/
+static int __binsort(void *t, size_t num_elements, cmp_f cmp, size_t size_of);
+
+/*
+    Quicksort without checks and cut off to insort
+
+    PARAMS
+    @IN t - array
+    @IN num_element - number of element in array t
+    @IN cmp - compare function
+    @IN size_of - size of element
+
+    RETURN:
+    %0 if success
+    %Non-zero value if failure
+*/
+static int __quicksort(void *t, size_t num_elements, cmp_f cmp, size_t size_of);
+
+/*
+    Get tuning class for elements of size size_of
+
+    PARAMS
+    @IN size_of - size of element
+
+    RETURN:
+    Pointer to tuning in global table
+*/
+static Sort_tuning *__sort_tuning_find(size_t size_of);
+
+/*
+    Sort using tuning table
+
+    PARAMS
+    @IN t - array
+    @IN num_element - number of element in array t
+    @IN cmp - compare function
+    @IN size_of - size of element
+    @IN allow_indirect - false iff indirect sort cannot be used (sorting of pointers)
+
+    RETURN:
+    %0 if success
+    %Non-zero value if failure
+*/
+static int __sort(void *t, size_t num_elements, cmp_f cmp, size_t size_of, bool allow_indirect);
+
+/*
+    Compare pointers to elements using sort_indirect_cmp
+
+    PARAMS
+    @IN a - pointer to Sort_ref
+    @IN b - pointer to Sort_ref
+
+    RETURN:
+    Result of user cmp
+*/
+static int __sort_indirect_cmp(const void *a, const void *b);
+
+/*
+    Argsort without checks
+
+    PARAMS
+    @IN t - array
+    @IN num_element - number of element in array t
+    @IN cmp - compare function
+    @IN size_of - size of element
+    @OUT perm - permutation, perm[i] is an index of element which should be on position i
+
+    RETURN:
+    %0 if success
+    %Non-zero value if failure
+*/
+static int __argsort(const BYTE *t, size_t num_elements, cmp_f cmp, size_t size_of, size_t *perm);
+
+/*
+    Apply permutation to t following cycles
+
+    PARAMS
+    @IN t - array
+    @IN num_element - number of element in array t
+    @IN size_of - size of element
+    @IN perm - permutation, after call it is an identity
+
+    RETURN:
+    This is a void function
+*/
+static void __sort_permute(BYTE *t, size_t num_elements, size_t size_of, size_t *perm);
+
+/*
+    Copy key to radix entry in memcmp order (big endian, sign bit flipped)
+
+    PARAMS
+    @OUT dst - key in entry
+    @IN src - key in element
+    @IN key_size - size of key
+    @IN type - type of key
+
+    RETURN:
+    This is a void function
+*/
+static ___inline___ void __sort_key_extract(BYTE *dst, const BYTE *src, size_t key_size, SORT_KEY_TYPE type);
+
+/*
+    Argsort by key without checks (LSD radix sort of (index, key) entries)
+
+    PARAMS
+    @IN t - array
+    @IN num_element - number of element in array t
+    @IN size_of - size of element
+    @IN key_offset - offset of key in element
+    @IN key_size - size of key
+    @IN type - type of key
+    @OUT perm - permutation
+
+    RETURN:
+    %0 if success
+    %Non-zero value if failure
+*/
+static int __argsort_by_key(const BYTE *t, size_t num_elements, size_t size_of,
+                            size_t key_offset, size_t key_size, SORT_KEY_TYPE type, size_t *perm);
+
+/*
+    Check params of *by_key functions
+
+    PARAMS
+    @IN t - array
+    @IN num_element - number of element in array t
+    @IN size_of - size of element
+    @IN key_offset - offset of key in element
+    @IN key_size - size of key
+    @IN type - type of key
+
+    RETURN:
+    %0 iff params are correct
+    %Non-zero value iff not
+*/
+static int __sort_by_key_check(const void *t, size_t num_elements, size_t size_of,
+                               size_t key_offset, size_t key_size, SORT_KEY_TYPE type);
+
+/*
+    Compare records by int key at the beginning (calibration)
+
+    PARAMS
+    @IN a - pointer to record
+    @IN b - pointer to record
+
+    RETURN:
+    -1 iff a < b, 0 iff a == b, 1 iff a > b
+*/
+static int __sort_calibrate_cmp(const void *a, const void *b);
+
+/*
+    Measure time of sorting many arrays with num_elements records,
+    each array is copied from src before sorting (the same for each algorithm)
+
+    PARAMS
+    @IN f - sort function
+    @IN src - records to sort (SORT_CALIBRATE_ELEMENTS)
+    @IN work - work buffer (SORT_CALIBRATE_ELEMENTS)
+    @IN num_elements - number of elements in one sort
+    @IN size_of - size of record
+
+    RETURN:
+    Best time in ns
+*/
+static double __sort_calibrate_measure(sort_f f, const BYTE *src, BYTE *work, size_t num_elements, size_t size_of);
+
+/*
+    Measure crossover points for one class
+
+    PARAMS
+    @IN src - records to sort (SORT_CALIBRATE_ELEMENTS)
+    @IN work - work buffer (SORT_CALIBRATE_ELEMENTS)
+    @IN size_of - size of record
+    @OUT tuning - measured tuning
+
+    RETURN:
+    This is a void function
+*/
+static void __sort_calibrate_class(const BYTE *src, BYTE *work, size_t size_of, Sort_tuning *tuning);
+
+/*
+    Load tuning table from file pointed by SORT_TUNING env, defaults are kept on failure
+
+    PARAMS
+    NO PARAMS
+
+    RETURN:
+    This is a void function
+*/
+static void __sort_tuning_init(void) ___before_main___(0);
+
 
 ___inline___ static int merge(  void        *t,
                                 size_t      offset_left,
@@ -241,7 +499,7 @@ int insort(void *t, size_t num_elements, cmp_f cmp, size_t size_of)
     return 0;
 }
 
-int binsort(void *t, size_t num_elements, cmp_f cmp, size_t size_of)
+static int __binsort(void *t, size_t num_elements, cmp_f cmp, size_t size_of)
 {
     size_t size;
 
@@ -265,17 +523,10 @@ int binsort(void *t, size_t num_elements, cmp_f cmp, size_t size_of)
 
     TRACE();
 
-    if (t == NULL || cmp == NULL)
-        ERROR("t == NULL || cmp == NULL\n", 1);
-
-    if (size_of < 1)
-        ERROR("size_of < 1\n", 1);
-
-    if (num_elements == 0)
-        ERROR("Nothing to sort\n", 1);
-
-    if (num_elements < INSORT_TRESHOLD)
-        return insort(t, num_elements, cmp, size_of);
+    assert(t != NULL);
+    assert(cmp != NULL);
+    assert(size_of >= 1);
+    assert(num_elements >= 1);
 
     size = (size_t)_size_of * num_elements;
 
@@ -283,7 +534,8 @@ int binsort(void *t, size_t num_elements, cmp_f cmp, size_t size_of)
     if (array == NULL)
         ERROR("malloc error\n", 1);
 
-    offset_middle = (ssize_t)(size >> 1);
+    /* middle has to be aligned to element, size >> 1 is not for odd num_elements */
+    offset_middle = (ssize_t)(num_elements >> 1) * _size_of;
     offset_left = offset_middle;
     offset_right = offset_middle;
 
@@ -339,6 +591,359 @@ int binsort(void *t, size_t num_elements, cmp_f cmp, size_t size_of)
     return 0;
 }
 
+static int __quicksort(void *t, size_t num_elements, cmp_f cmp, size_t size_of)
+{
+    TRACE();
+
+    assert(t != NULL);
+    assert(cmp != NULL);
+    assert(size_of >= 1);
+
+    if (num_elements < 2)
+        return 0;
+
+    return _quicksort(t, 0, (num_elements - 1) * size_of, cmp, size_of);
+}
+
+static Sort_tuning *__sort_tuning_find(size_t size_of)
+{
+    size_t i;
+
+    for (i = 0; i < SORT_TUNING_NUM_CLASSES - 1; ++i)
+        if (size_of <= sort_tuning[i].size_of)
+            return &sort_tuning[i];
+
+    return &sort_tuning[SORT_TUNING_NUM_CLASSES - 1];
+}
+
+static int __sort(void *t, size_t num_elements, cmp_f cmp, size_t size_of, bool allow_indirect)
+{
+    const Sort_tuning *tuning;
+
+    TRACE();
+
+    tuning = __sort_tuning_find(size_of);
+
+    if (num_elements < tuning->insort_threshold)
+        return insort(t, num_elements, cmp, size_of);
+    else if (num_elements < tuning->binsort_threshold)
+        return __binsort(t, num_elements, cmp, size_of);
+    else if (allow_indirect && tuning->indirect)
+        return sort_indirect(t, num_elements, cmp, size_of);
+    else
+        return __quicksort(t, num_elements, cmp, size_of);
+}
+
+static int __sort_indirect_cmp(const void *a, const void *b)
+{
+    return sort_indirect_cmp((const void *)((const Sort_ref *)a)->ptr, (const void *)((const Sort_ref *)b)->ptr);
+}
+
+static int __argsort(const BYTE *t, size_t num_elements, cmp_f cmp, size_t size_of, size_t *perm)
+{
+    Sort_ref *refs;
+    cmp_f prev_cmp;
+    size_t i;
+    int ret;
+
+    TRACE();
+
+    /* perm is used as refs during sorting */
+    ___compile_time_check_cond___(sizeof(Sort_ref) != sizeof(size_t))
+    refs = (Sort_ref *)perm;
+
+    for (i = 0; i < num_elements; ++i)
+        refs[i].ptr = (BYTE *)t + i * size_of;
+
+    /* cmp can sort something too, so restore previous one */
+    prev_cmp = sort_indirect_cmp;
+    sort_indirect_cmp = cmp;
+    ret = __sort((void *)refs, num_elements, __sort_indirect_cmp, sizeof(Sort_ref), false);
+    sort_indirect_cmp = prev_cmp;
+
+    if (ret)
+        ERROR("sort error\n", 1);
+
+    for (i = 0; i < num_elements; ++i)
+        refs[i].index = (size_t)(refs[i].ptr - t) / size_of;
+
+    return 0;
+}
+
+static void __sort_permute(BYTE *t, size_t num_elements, size_t size_of, size_t *perm)
+{
+    BYTE buffer[size_of];
+    size_t i;
+    size_t j;
+    size_t k;
+
+    TRACE();
+
+    /* move each cycle of permutation using 1 buffer */
+    for (i = 0; i < num_elements; ++i)
+    {
+        if (perm[i] == i)
+            continue;
+
+        __ASSIGN__(buffer[0], t[i * size_of], size_of);
+
+        j = i;
+        while (perm[j] != i)
+        {
+            k = perm[j];
+            __ASSIGN__(t[j * size_of], t[k * size_of], size_of);
+            perm[j] = j;
+            j = k;
+        }
+
+        __ASSIGN__(t[j * size_of], buffer[0], size_of);
+        perm[j] = j;
+    }
+}
+
+static ___inline___ void __sort_key_extract(BYTE *dst, const BYTE *src, size_t key_size, SORT_KEY_TYPE type)
+{
+    size_t i;
+
+    if (type == SORT_KEY_BYTES)
+    {
+        (void)memcpy(dst, src, key_size);
+        return;
+    }
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    for (i = 0; i < key_size; ++i)
+        dst[i] = src[key_size - 1 - i];
+#else
+    (void)i;
+    (void)memcpy(dst, src, key_size);
+#endif
+
+    if (type == SORT_KEY_SIGNED)
+        dst[0] ^= (BYTE)0x80;
+}
+
+static int __argsort_by_key(const BYTE *t, size_t num_elements, size_t size_of,
+                            size_t key_offset, size_t key_size, SORT_KEY_TYPE type, size_t *perm)
+{
+    size_t count[SORT_RADIX_BUCKETS];
+    const size_t entry_size = sizeof(size_t) + key_size;
+    BYTE *src;
+    BYTE *dst;
+    BYTE *temp;
+    size_t byte;
+    size_t sum;
+    size_t c;
+    size_t i;
+
+    TRACE();
+
+    src = (BYTE *)malloc(num_elements * entry_size);
+    if (src == NULL)
+        ERROR("malloc error\n", 1);
+
+    dst = (BYTE *)malloc(num_elements * entry_size);
+    if (dst == NULL)
+    {
+        FREE(src);
+        ERROR("malloc error\n", 1);
+    }
+
+    /* entry: index, key in memcmp order, so elements are not touched anymore */
+    for (i = 0; i < num_elements; ++i)
+    {
+        (void)memcpy(&src[i * entry_size], &i, sizeof(size_t));
+        __sort_key_extract(&src[i * entry_size + sizeof(size_t)], &t[i * size_of + key_offset], key_size, type);
+    }
+
+    /* LSD: from the last byte of key, each pass is stable */
+    for (byte = key_size; byte > 0; --byte)
+    {
+        (void)memset(count, 0, sizeof(count));
+        for (i = 0; i < num_elements; ++i)
+            ++count[src[i * entry_size + sizeof(size_t) + byte - 1]];
+
+        /* the same byte in every key */
+        if (count[src[sizeof(size_t) + byte - 1]] == num_elements)
+            continue;
+
+        for (i = 0, sum = 0; i < SORT_RADIX_BUCKETS; ++i)
+        {
+            c = count[i];
+            count[i] = sum;
+            sum += c;
+        }
+
+        for (i = 0; i < num_elements; ++i)
+            (void)memcpy(&dst[count[src[i * entry_size + sizeof(size_t) + byte - 1]]++ * entry_size],
+                         &src[i * entry_size],
+                         entry_size);
+
+        temp = src;
+        src = dst;
+        dst = temp;
+    }
+
+    for (i = 0; i < num_elements; ++i)
+        (void)memcpy(&perm[i], &src[i * entry_size], sizeof(size_t));
+
+    FREE(src);
+    FREE(dst);
+
+    return 0;
+}
+
+static int __sort_by_key_check(const void *t, size_t num_elements, size_t size_of,
+                               size_t key_offset, size_t key_size, SORT_KEY_TYPE type)
+{
+    TRACE();
+
+    if (t == NULL)
+        ERROR("t == NULL\n", 1);
+
+    if (size_of < 1)
+        ERROR("size_of < 1\n", 1);
+
+    if (num_elements == 0)
+        ERROR("Nothing to sort\n", 1);
+
+    if (key_size < 1 || key_offset >= size_of || key_size > size_of - key_offset)
+        ERROR("Key out of element\n", 1);
+
+    switch (type)
+    {
+        case SORT_KEY_BYTES:
+        {
+            break;
+        }
+        case SORT_KEY_UNSIGNED:
+        case SORT_KEY_SIGNED:
+        {
+            if (key_size != 1 && key_size != 2 && key_size != 4 && key_size != 8)
+                ERROR("Integer key has to have 1, 2, 4 or 8 bytes\n", 1);
+
+            break;
+        }
+        default:
+        {
+            ERROR("Invalid key type\n", 1);
+        }
+    }
+
+    return 0;
+}
+
+static int __sort_calibrate_cmp(const void *a, const void *b)
+{
+    int ka;
+    int kb;
+
+    (void)memcpy(&ka, a, sizeof(int));
+    (void)memcpy(&kb, b, sizeof(int));
+
+    return (ka > kb) - (ka < kb);
+}
+
+static double __sort_calibrate_measure(sort_f f, const BYTE *src, BYTE *work, size_t num_elements, size_t size_of)
+{
+    struct timespec start;
+    struct timespec end;
+    const size_t size = num_elements * size_of;
+    const size_t batches = SORT_CALIBRATE_ELEMENTS / num_elements;
+    size_t rep;
+    size_t b;
+    double ns;
+    double best = -1.0;
+
+    TRACE();
+
+    for (rep = 0; rep < SORT_CALIBRATE_REPS; ++rep)
+    {
+        (void)memcpy(work, src, batches * size);
+
+        (void)clock_gettime(CLOCK_MONOTONIC, &start);
+        for (b = 0; b < batches; ++b)
+            (void)f(work + b * size, num_elements, __sort_calibrate_cmp, size_of);
+
+        (void)clock_gettime(CLOCK_MONOTONIC, &end);
+
+        ns = (double)(end.tv_sec - start.tv_sec) * 1e9 + (double)(end.tv_nsec - start.tv_nsec);
+        if (best < 0.0 || ns < best)
+            best = ns;
+    }
+
+    return best;
+}
+
+static void __sort_calibrate_class(const BYTE *src, BYTE *work, size_t size_of, Sort_tuning *tuning)
+{
+    double t_insort[ARRAY_SIZE(sort_calibrate_n)];
+    double t_binsort[ARRAY_SIZE(sort_calibrate_n)];
+    double t_quicksort[ARRAY_SIZE(sort_calibrate_n)];
+    size_t i;
+    size_t n;
+    size_t last;
+    size_t first;
+
+    TRACE();
+
+    for (i = 0; i < ARRAY_SIZE(sort_calibrate_n); ++i)
+    {
+        n = sort_calibrate_n[i];
+        t_insort[i] = __sort_calibrate_measure(insort, src, work, n, size_of);
+        t_binsort[i] = __sort_calibrate_measure(__binsort, src, work, n, size_of);
+        t_quicksort[i] = __sort_calibrate_measure(__quicksort, src, work, n, size_of);
+    }
+
+    /*
+        Crossover is the first n after the last win of simpler algorithm,
+        for small n algorithms are almost the same, so the first loss is just a noise
+    */
+    last = ARRAY_SIZE(sort_calibrate_n);
+    for (i = ARRAY_SIZE(sort_calibrate_n); i > 0; --i)
+        if (t_insort[i - 1] <= MIN(t_binsort[i - 1], t_quicksort[i - 1]))
+        {
+            last = i - 1;
+            break;
+        }
+
+    first = last == ARRAY_SIZE(sort_calibrate_n) ? 0 : last + 1;
+    tuning->insort_threshold = first < ARRAY_SIZE(sort_calibrate_n) ? sort_calibrate_n[first] : sort_calibrate_n[first - 1] + 1;
+
+    last = ARRAY_SIZE(sort_calibrate_n);
+    for (i = ARRAY_SIZE(sort_calibrate_n); i > first; --i)
+        if (t_binsort[i - 1] <= t_quicksort[i - 1])
+        {
+            last = i - 1;
+            break;
+        }
+
+    first = last == ARRAY_SIZE(sort_calibrate_n) ? first : last + 1;
+    tuning->binsort_threshold = first < ARRAY_SIZE(sort_calibrate_n) ? sort_calibrate_n[first] : sort_calibrate_n[first - 1] + 1;
+
+    tuning->indirect = __sort_calibrate_measure(sort_indirect, src, work, SORT_CALIBRATE_INDIRECT_N, size_of) <
+                       __sort_calibrate_measure(__quicksort, src, work, SORT_CALIBRATE_INDIRECT_N, size_of) * SORT_CALIBRATE_INDIRECT_GAIN;
+}
+
+int binsort(void *t, size_t num_elements, cmp_f cmp, size_t size_of)
+{
+    TRACE();
+
+    if (t == NULL || cmp == NULL)
+        ERROR("t == NULL || cmp == NULL\n", 1);
+
+    if (size_of < 1)
+        ERROR("size_of < 1\n", 1);
+
+    if (num_elements == 0)
+        ERROR("Nothing to sort\n", 1);
+
+    if (num_elements < __sort_tuning_find(size_of)->insort_threshold)
+        return insort(t, num_elements, cmp, size_of);
+
+    return __binsort(t, num_elements, cmp, size_of);
+}
+
 int mergesort(void *t, size_t num_elements, cmp_f cmp, size_t size_of)
 {
     ssize_t i;
@@ -368,7 +973,7 @@ int mergesort(void *t, size_t num_elements, cmp_f cmp, size_t size_of)
     if (num_elements == 0)
         ERROR("Nothing to sort\n", 1);
 
-    if (num_elements < INSORT_TRESHOLD)
+    if (num_elements < __sort_tuning_find(size_of)->insort_threshold)
         return insort(t, num_elements, cmp, size_of);
 
     size = num_elements * size_of;
@@ -430,7 +1035,7 @@ int quicksort(void *t, size_t num_elements, cmp_f cmp, size_t size_of)
     if (num_elements == 0)
         ERROR("Nothing to sort\n", 1);
 
-    if (num_elements < INSORT_TRESHOLD)
+    if (num_elements < __sort_tuning_find(size_of)->insort_threshold)
         return insort(t, num_elements, cmp, size_of);
 
     return _quicksort(t, 0, (num_elements - 1) * size_of, cmp, size_of);
@@ -449,10 +1054,338 @@ int sort(void *t, size_t num_elements, cmp_f cmp, size_t size_of)
     if (num_elements == 0)
         ERROR("Nothing to sort\n", 1);
 
-	if (num_elements < INSORT_TRESHOLD)
-		return insort(t, num_elements, cmp, size_of);
-	else if (num_elements < BINSORT_TRESHOLD)
-		return binsort(t, num_elements, cmp, size_of);
-	else
-		return quicksort(t, num_elements, cmp, size_of);
+    return __sort(t, num_elements, cmp, size_of, true);
+}
+
+int sort_indirect(void *t, size_t num_elements, cmp_f cmp, size_t size_of)
+{
+    size_t *perm;
+
+    TRACE();
+
+    if (t == NULL || cmp == NULL)
+        ERROR("t == NULL || cmp == NULL\n", 1);
+
+    if (size_of < 1)
+        ERROR("size_of < 1\n", 1);
+
+    if (num_elements == 0)
+        ERROR("Nothing to sort\n", 1);
+
+    perm = (size_t *)malloc(num_elements * sizeof(size_t));
+    if (perm == NULL)
+        ERROR("malloc error\n", 1);
+
+    if (__argsort((const BYTE *)t, num_elements, cmp, size_of, perm))
+    {
+        FREE(perm);
+        ERROR("argsort error\n", 1);
+    }
+
+    __sort_permute((BYTE *)t, num_elements, size_of, perm);
+    FREE(perm);
+
+    return 0;
+}
+
+int argsort(const void *t, size_t num_elements, cmp_f cmp, size_t size_of, size_t *perm)
+{
+    TRACE();
+
+    if (t == NULL || cmp == NULL || perm == NULL)
+        ERROR("t == NULL || cmp == NULL || perm == NULL\n", 1);
+
+    if (size_of < 1)
+        ERROR("size_of < 1\n", 1);
+
+    if (num_elements == 0)
+        ERROR("Nothing to sort\n", 1);
+
+    return __argsort((const BYTE *)t, num_elements, cmp, size_of, perm);
+}
+
+int sort_permute(void *t, size_t num_elements, size_t size_of, const size_t *perm)
+{
+    size_t *_perm;
+    BYTE *seen;
+    size_t i;
+
+    TRACE();
+
+    if (t == NULL || perm == NULL)
+        ERROR("t == NULL || perm == NULL\n", 1);
+
+    if (size_of < 1)
+        ERROR("size_of < 1\n", 1);
+
+    if (num_elements == 0)
+        ERROR("Nothing to permute\n", 1);
+
+    /* user perm is not changed */
+    _perm = (size_t *)malloc(num_elements * sizeof(size_t));
+    if (_perm == NULL)
+        ERROR("malloc error\n", 1);
+
+    /* duplicated index would make cycle walk infinite */
+    seen = (BYTE *)calloc((num_elements + 7) >> 3, sizeof(BYTE));
+    if (seen == NULL)
+    {
+        FREE(_perm);
+        ERROR("calloc error\n", 1);
+    }
+
+    for (i = 0; i < num_elements; ++i)
+    {
+        if (perm[i] >= num_elements)
+        {
+            FREE(seen);
+            FREE(_perm);
+            ERROR("perm[i] >= num_elements\n", 1);
+        }
+
+        if (GET_BIT(seen[perm[i] >> 3], perm[i] & 7))
+        {
+            FREE(seen);
+            FREE(_perm);
+            ERROR("perm[i] is duplicated\n", 1);
+        }
+
+        SET_BIT(seen[perm[i] >> 3], perm[i] & 7);
+        _perm[i] = perm[i];
+    }
+
+    FREE(seen);
+
+    __sort_permute((BYTE *)t, num_elements, size_of, _perm);
+    FREE(_perm);
+
+    return 0;
+}
+
+int argsort_by_key(const void *t, size_t num_elements, size_t size_of,
+                   size_t key_offset, size_t key_size, SORT_KEY_TYPE type, size_t *perm)
+{
+    TRACE();
+
+    if (perm == NULL)
+        ERROR("perm == NULL\n", 1);
+
+    if (__sort_by_key_check(t, num_elements, size_of, key_offset, key_size, type))
+        ERROR("Invalid params\n", 1);
+
+    return __argsort_by_key((const BYTE *)t, num_elements, size_of, key_offset, key_size, type, perm);
+}
+
+int sort_by_key(void *t, size_t num_elements, size_t size_of,
+                size_t key_offset, size_t key_size, SORT_KEY_TYPE type)
+{
+    size_t *perm;
+
+    TRACE();
+
+    if (__sort_by_key_check(t, num_elements, size_of, key_offset, key_size, type))
+        ERROR("Invalid params\n", 1);
+
+    perm = (size_t *)malloc(num_elements * sizeof(size_t));
+    if (perm == NULL)
+        ERROR("malloc error\n", 1);
+
+    if (__argsort_by_key((const BYTE *)t, num_elements, size_of, key_offset, key_size, type, perm))
+    {
+        FREE(perm);
+        ERROR("argsort error\n", 1);
+    }
+
+    __sort_permute((BYTE *)t, num_elements, size_of, perm);
+    FREE(perm);
+
+    return 0;
+}
+
+int sort_tuning_get(size_t size_of, Sort_tuning *tuning)
+{
+    TRACE();
+
+    if (tuning == NULL)
+        ERROR("tuning == NULL\n", 1);
+
+    if (size_of < 1)
+        ERROR("size_of < 1\n", 1);
+
+    *tuning = *__sort_tuning_find(size_of);
+
+    return 0;
+}
+
+int sort_tuning_set(const Sort_tuning *tuning)
+{
+    size_t i;
+
+    TRACE();
+
+    if (tuning == NULL)
+        ERROR("tuning == NULL\n", 1);
+
+    if (tuning->binsort_threshold < tuning->insort_threshold)
+        ERROR("binsort_threshold < insort_threshold\n", 1);
+
+    for (i = 0; i < SORT_TUNING_NUM_CLASSES; ++i)
+        if (sort_tuning[i].size_of == tuning->size_of)
+        {
+            sort_tuning[i] = *tuning;
+            return 0;
+        }
+
+    ERROR("size_of is not a class size\n", 1);
+}
+
+void sort_tuning_reset(void)
+{
+    TRACE();
+
+    (void)memcpy(sort_tuning, sort_tuning_default, sizeof(sort_tuning));
+}
+
+int sort_calibrate(void)
+{
+    Sort_tuning tuning[SORT_TUNING_NUM_CLASSES];
+    const size_t max_size_of = sort_tuning_default[SORT_TUNING_NUM_CLASSES - 1].size_of;
+    BYTE *src;
+    BYTE *work;
+    size_t i;
+    size_t j;
+    int key;
+
+    TRACE();
+
+    src = (BYTE *)calloc(SORT_CALIBRATE_ELEMENTS, max_size_of);
+    work = (BYTE *)malloc(SORT_CALIBRATE_ELEMENTS * max_size_of);
+    if (src == NULL || work == NULL)
+    {
+        FREE(src);
+        FREE(work);
+        ERROR("malloc error\n", 1);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(tuning); ++i)
+        tuning[i].size_of = sort_tuning_default[i].size_of;
+
+    /* class is measured with the biggest records in class, random keys, the same for every algorithm */
+    for (i = 0; i < ARRAY_SIZE(tuning); ++i)
+    {
+        for (j = 0; j < SORT_CALIBRATE_ELEMENTS; ++j)
+        {
+            key = rand();
+            (void)memcpy(src + j * tuning[i].size_of, &key, sizeof(int));
+        }
+
+        __sort_calibrate_class(src, work, tuning[i].size_of, &tuning[i]);
+    }
+
+    (void)memcpy(sort_tuning, tuning, sizeof(sort_tuning));
+
+    FREE(src);
+    FREE(work);
+
+    return 0;
+}
+
+static void __sort_tuning_init(void)
+{
+    const char *path;
+
+    path = getenv(SORT_TUNING_ENV);
+    if (path != NULL && path[0] != '\0' && sort_tuning_load(path))
+        (void)fprintf(stderr, SORT_TUNING_ENV ": can't load %s, default tuning is used\n", path);
+}
+
+int sort_tuning_save(const char *path)
+{
+    FILE *file;
+    size_t i;
+    int ret = 0;
+
+    TRACE();
+
+    if (path == NULL)
+        ERROR("path == NULL\n", 1);
+
+    file = fopen(path, "w");
+    if (file == NULL)
+        ERROR("fopen error\n", 1);
+
+    if (fprintf(file, SORT_TUNING_FILE_HEADER) < 0)
+        ret = 1;
+
+    for (i = 0; i < SORT_TUNING_NUM_CLASSES; ++i)
+        if (fprintf(file, "%zu %zu %zu %d\n", sort_tuning[i].size_of, sort_tuning[i].insort_threshold,
+                    sort_tuning[i].binsort_threshold, (int)sort_tuning[i].indirect) < 0)
+            ret = 1;
+
+    if (fclose(file))
+        ret = 1;
+
+    if (ret)
+        ERROR("write error\n", 1);
+
+    return 0;
+}
+
+int sort_tuning_load(const char *path)
+{
+    Sort_tuning tuning[SORT_TUNING_NUM_CLASSES];
+    Sort_tuning entry;
+    FILE *file;
+    char line[128];
+    size_t loaded = 0;
+    size_t i;
+    int indirect;
+
+    TRACE();
+
+    if (path == NULL)
+        ERROR("path == NULL\n", 1);
+
+    file = fopen(path, "r");
+    if (file == NULL)
+        ERROR("fopen error\n", 1);
+
+    (void)memcpy(tuning, sort_tuning_default, sizeof(tuning));
+
+    while (fgets(line, (int)sizeof(line), file) != NULL)
+    {
+        if (line[0] == '#' || line[0] == '\n')
+            continue;
+
+        if (sscanf(line, "%zu %zu %zu %d", &entry.size_of, &entry.insort_threshold, &entry.binsort_threshold, &indirect) != 4 ||
+            entry.binsort_threshold < entry.insort_threshold)
+        {
+            (void)fclose(file);
+            ERROR("bad line in tuning file\n", 1);
+        }
+
+        entry.indirect = indirect != 0;
+
+        for (i = 0; i < SORT_TUNING_NUM_CLASSES; ++i)
+            if (tuning[i].size_of == entry.size_of)
+                break;
+
+        if (i == SORT_TUNING_NUM_CLASSES)
+        {
+            (void)fclose(file);
+            ERROR("size_of is not a class size\n", 1);
+        }
+
+        tuning[i] = entry;
+        ++loaded;
+    }
+
+    (void)fclose(file);
+
+    if (loaded == 0)
+        ERROR("empty tuning file\n", 1);
+
+    (void)memcpy(sort_tuning, tuning, sizeof(sort_tuning));
+
+    return 0;
 }
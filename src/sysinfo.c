@@ -0,0 +1,31 @@
+#include <sysinfo.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <common.h>
+
+size_t sysinfo_get_available_memory(void)
+{
+    char line[BIT(8)];
+    FILE *file;
+    size_t kb;
+    size_t ram = 0;
+
+    file = fopen("/proc/meminfo", "r");
+    if (file != NULL)
+    {
+        while (fgets(line, (int)sizeof(line), file) != NULL)
+            if (sscanf(line, "MemAvailable: %zu kB", &kb) == 1)
+            {
+                /* killobytes to bytes */
+                ram = kb * BIT(10);
+                break;
+            }
+
+        fclose(file);
+    }
+
+    if (ram == 0)
+        ram = (size_t)sysconf(_SC_AVPHYS_PAGES) * (size_t)sysconf(_SC_PAGESIZE);
+
+    return ram;
+}
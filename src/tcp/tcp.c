@@ -1,3 +1,7 @@
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE /* splice, pipe2 */
+#endif
+
 #include <tcp.h>
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -8,19 +12,70 @@
 #include <log.h>
 #include <stdbool.h>
 #include <log.h>
+#include <common.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/sendfile.h>
+#include <linux/errqueue.h>
+
+#ifndef SO_ZEROCOPY
+    #define SO_ZEROCOPY     60
+#endif
+
+#ifndef MSG_ZEROCOPY
+    #define MSG_ZEROCOPY    0x4000000
+#endif
+
+#define TCP_SPLICE_CHUNK    (1 << 16) /* default pipe capacity */
+
+/*
+    Wait until socket is writable (when blocking fd is spliced to non-blocking socket)
+
+    PARAMS
+    @IN socket - socket
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+static int __tcp_wait_writable(int socket);
+
+static int __tcp_wait_writable(int socket)
+{
+    struct pollfd pfd;
+
+    pfd.fd = socket;
+    pfd.events = POLLOUT;
+    pfd.revents = 0;
+
+    while (poll(&pfd, 1, -1) == -1)
+        if (errno != EINTR)
+            return 1;
+
+    return (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)) != 0;
+}
 
 int tcp_socket_create(const char *host_name, int port)
+{
+    TRACE();
+
+    return tcp_socket_create_with_flags(host_name, port, 0);
+}
+
+int tcp_socket_create_with_flags(const char *host_name, int port, int flags)
 {
     struct sockaddr_in sn = {0};
     int s;
+    int on = 1;
     struct hostent *he;
 
     TRACE();
 
     he = gethostbyname(host_name);
     if (he == NULL)
-    ERROR("gethostbyname error\n", -1);
+        ERROR("gethostbyname error\n", -1);
 
     sn.sin_family = AF_INET;
     sn.sin_port = htons((unsigned short)port);
@@ -32,14 +87,52 @@ int tcp_socket_create(const char *host_name, int port)
 
 	LOG("Socket %d created\n", s);
 
+    /* options have to be set before bind */
+    if ((flags & TCP_SOCKET_REUSEADDR) && setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) == -1)
+    {
+        close(s);
+        ERROR("setsockopt SO_REUSEADDR error\n", -1);
+    }
+
+    if ((flags & TCP_SOCKET_REUSEPORT) && setsockopt(s, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) == -1)
+    {
+        close(s);
+        ERROR("setsockopt SO_REUSEPORT error\n", -1);
+    }
+
+    if ((flags & TCP_SOCKET_NONBLOCK) && tcp_set_nonblocking(s))
+    {
+        close(s);
+        ERROR("tcp_set_nonblocking error\n", -1);
+    }
+
 	if (bind(s, (struct sockaddr *)&sn, sizeof(sn)) == -1)
+    {
+        close(s);
         ERROR("socket bind error\n", -1);
+    }
 
 	LOG("Socket %d binded\n", s);
 
 	return s;
 }
 
+int tcp_set_nonblocking(int socket)
+{
+    int flags;
+
+    TRACE();
+
+    flags = fcntl(socket, F_GETFL, 0);
+    if (flags == -1)
+        ERROR("fcntl error\n", 1);
+
+    if (fcntl(socket, F_SETFL, flags | O_NONBLOCK) == -1)
+        ERROR("fcntl error\n", 1);
+
+    return 0;
+}
+
 void tcp_socket_destroy(int socket)
 {
     TRACE();
@@ -93,7 +186,7 @@ int tcp_accept_connection(int s)
 
 	LOG("Socket %d is listening\n", s);
 	sn.sin_family = AF_INET;
-	if (listen(s, 1) == -1)
+	if (listen(s, SOMAXCONN) == -1)
 		ERROR("listen socket error\n", -1);
 
 	fd = accept(s, (struct sockaddr *)&sn, (socklen_t *)&l);
@@ -103,4 +196,352 @@ int tcp_accept_connection(int s)
 	LOG("Connection from %d socket, accepted on %d fd\n", s, fd);
 
     return fd;
-}
\ No newline at end of file
+}
+
+ssize_t tcp_sendfile(int socket, int fd, off_t *offset, size_t count)
+{
+    size_t sent = 0;
+    ssize_t n;
+
+    TRACE();
+
+    while (sent < count)
+    {
+        n = sendfile(socket, fd, offset, count - sent);
+        if (n == -1)
+        {
+            if (errno == EINTR)
+                continue;
+
+            if (errno == EAGAIN)
+                break;
+
+            ERROR("sendfile error\n", -1);
+        }
+
+        /* EOF */
+        if (n == 0)
+            break;
+
+        sent += (size_t)n;
+    }
+
+    return (ssize_t)sent;
+}
+
+ssize_t tcp_splice(int socket, int fd, off_t *offset, size_t count)
+{
+    int pipefd[2];
+    size_t sent = 0;
+    size_t in_pipe = 0;
+    ssize_t n;
+    bool eof = false;
+
+    TRACE();
+
+    if (pipe2(pipefd, O_CLOEXEC) == -1)
+        ERROR("pipe2 error\n", -1);
+
+    while (sent < count && !eof)
+    {
+        /* fd -> pipe, page references are moved, no copy */
+        n = splice(fd, offset, pipefd[1], NULL, MIN(count - sent, (size_t)TCP_SPLICE_CHUNK), SPLICE_F_MOVE | SPLICE_F_MORE);
+        if (n == -1)
+        {
+            if (errno == EINTR)
+                continue;
+
+            if (errno != EAGAIN)
+            {
+                close(pipefd[0]);
+                close(pipefd[1]);
+                ERROR("splice error\n", -1);
+            }
+
+            break;
+        }
+
+        if (n == 0)
+            eof = true;
+
+        in_pipe = (size_t)n;
+
+        /* pipe -> socket, pipe has to be drained, otherwise data is lost */
+        while (in_pipe > 0)
+        {
+            n = splice(pipefd[0], NULL, socket, NULL, in_pipe, SPLICE_F_MOVE | SPLICE_F_MORE);
+            if (n == -1)
+            {
+                if (errno == EINTR || (errno == EAGAIN && __tcp_wait_writable(socket) == 0))
+                    continue;
+
+                close(pipefd[0]);
+                close(pipefd[1]);
+                ERROR("splice error\n", -1);
+            }
+
+            in_pipe -= (size_t)n;
+            sent += (size_t)n;
+        }
+    }
+
+    close(pipefd[0]);
+    close(pipefd[1]);
+
+    return (ssize_t)sent;
+}
+
+ssize_t tcp_writev(int socket, const struct iovec *iov, int iovcnt)
+{
+    struct msghdr msg = {0};
+    size_t sent = 0;
+    size_t len;
+    ssize_t n;
+    int i = 0;
+
+    TRACE();
+
+    if (iov == NULL || iovcnt < 0)
+        ERROR("Invalid arguments\n", -1);
+
+    while (i < iovcnt)
+    {
+        msg.msg_iov = (struct iovec *)&iov[i];
+        msg.msg_iovlen = (size_t)(iovcnt - i);
+
+        n = sendmsg(socket, &msg, MSG_NOSIGNAL);
+        if (n == -1)
+        {
+            if (errno == EINTR)
+                continue;
+
+            if (errno == EAGAIN)
+                break;
+
+            ERROR("sendmsg error\n", -1);
+        }
+
+        sent += (size_t)n;
+
+        /* skip sent buffers */
+        while (i < iovcnt && (size_t)n >= iov[i].iov_len)
+        {
+            n -= (ssize_t)iov[i].iov_len;
+            ++i;
+        }
+
+        if (n == 0)
+            continue;
+
+        /* buffer i is sent partially, send its rest alone to not modify iov */
+        len = iov[i].iov_len - (size_t)n;
+        while (len > 0)
+        {
+            n = send(socket, (const char *)iov[i].iov_base + iov[i].iov_len - len, len, MSG_NOSIGNAL);
+            if (n == -1)
+            {
+                if (errno == EINTR)
+                    continue;
+
+                if (errno == EAGAIN)
+                    return (ssize_t)sent;
+
+                ERROR("send error\n", -1);
+            }
+
+            len -= (size_t)n;
+            sent += (size_t)n;
+        }
+
+        ++i;
+    }
+
+    return (ssize_t)sent;
+}
+
+int tcp_zerocopy_init(Tcp_zerocopy *zc, int socket)
+{
+    int on = 1;
+
+    TRACE();
+
+    if (zc == NULL)
+        ERROR("zc == NULL\n", 1);
+
+    if (setsockopt(socket, SOL_SOCKET, SO_ZEROCOPY, &on, sizeof(on)) == -1)
+        ERROR("setsockopt SO_ZEROCOPY error\n", 1);
+
+    zc->____socket = socket;
+    zc->____next_id = 0;
+    zc->____completed = 0;
+    zc->____copied = 0;
+
+    return 0;
+}
+
+ssize_t tcp_zerocopy_send(Tcp_zerocopy * ___restrict___ zc, const void * ___restrict___ buf, size_t size, uint32_t * ___restrict___ id)
+{
+    size_t sent = 0;
+    ssize_t n;
+    bool zerocopied = false;
+
+    TRACE();
+
+    if (zc == NULL)
+        ERROR("zc == NULL\n", -1);
+
+    if (buf == NULL)
+        ERROR("buf == NULL\n", -1);
+
+    while (sent < size)
+    {
+        n = send(zc->____socket, (const char *)buf + sent, size - sent, MSG_ZEROCOPY | MSG_NOSIGNAL);
+        if (n == -1)
+        {
+            if (errno == EINTR)
+                continue;
+
+            /* ENOBUFS - too many pages pinned (optmem limit) */
+            if (errno == ENOBUFS)
+            {
+                /* wait for completions to unpin pages */
+                if (zc->____completed != zc->____next_id)
+                {
+                    if (tcp_zerocopy_reap(zc, -1) == -1)
+                        ERROR("tcp_zerocopy_reap error\n", -1);
+
+                    continue;
+                }
+
+                /* nothing to wait for, chunk doesn't fit in limit, so copy it */
+                do {
+                    n = send(zc->____socket, (const char *)buf + sent, size - sent, MSG_NOSIGNAL);
+                } while (n == -1 && errno == EINTR);
+
+                if (n == -1)
+                {
+                    if (errno == EAGAIN)
+                        break;
+
+                    ERROR("send error\n", -1);
+                }
+
+                sent += (size_t)n;
+                continue;
+            }
+
+            if (errno == EAGAIN)
+                break;
+
+            ERROR("send error\n", -1);
+        }
+
+        /* kernel counts each successful send call */
+        ++zc->____next_id;
+        zerocopied = true;
+        sent += (size_t)n;
+    }
+
+    if (id != NULL && zerocopied)
+        *id = zc->____next_id - 1;
+
+    return (ssize_t)sent;
+}
+
+ssize_t tcp_zerocopy_reap(Tcp_zerocopy *zc, int timeout_ms)
+{
+    char control[CMSG_SPACE(sizeof(struct sock_extended_err))];
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+    struct sock_extended_err *serr;
+    struct pollfd pfd;
+    uint32_t before;
+    int ret;
+
+    TRACE();
+
+    if (zc == NULL)
+        ERROR("zc == NULL\n", -1);
+
+    before = zc->____completed;
+
+    if (timeout_ms != 0 && zc->____completed != zc->____next_id)
+    {
+        /* error queue is signaled by POLLERR, there is no need to request it */
+        pfd.fd = zc->____socket;
+        pfd.events = 0;
+        pfd.revents = 0;
+
+        do {
+            ret = poll(&pfd, 1, timeout_ms);
+        } while (ret == -1 && errno == EINTR);
+
+        if (ret == -1)
+            ERROR("poll error\n", -1);
+    }
+
+    for (;;)
+    {
+        (void)memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        if (recvmsg(zc->____socket, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) == -1)
+        {
+            if (errno == EINTR)
+                continue;
+
+            if (errno == EAGAIN)
+                break;
+
+            ERROR("recvmsg error\n", -1);
+        }
+
+        for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            serr = (struct sock_extended_err *)(void *)CMSG_DATA(cmsg);
+            if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+                continue;
+
+            /* sends [ee_info, ee_data] are completed, tcp completes them in order */
+            if (serr->ee_data + 1 - zc->____completed <= zc->____next_id - zc->____completed)
+                zc->____completed = serr->ee_data + 1;
+
+            if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+                zc->____copied += serr->ee_data - serr->ee_info + 1;
+        }
+    }
+
+    return (ssize_t)(zc->____completed - before);
+}
+
+bool tcp_zerocopy_is_done(const Tcp_zerocopy *zc, uint32_t id)
+{
+    TRACE();
+
+    if (zc == NULL)
+        ERROR("zc == NULL\n", false);
+
+    /* id < completed, ids wrap around like tcp sequence numbers */
+    return (int32_t)(id - zc->____completed) < 0;
+}
+
+uint32_t tcp_zerocopy_get_pending(const Tcp_zerocopy *zc)
+{
+    TRACE();
+
+    if (zc == NULL)
+        ERROR("zc == NULL\n", 0);
+
+    return zc->____next_id - zc->____completed;
+}
+
+uint64_t tcp_zerocopy_get_copied(const Tcp_zerocopy *zc)
+{
+    TRACE();
+
+    if (zc == NULL)
+        ERROR("zc == NULL\n", 0);
+
+    return zc->____copied;
+}
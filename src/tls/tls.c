@@ -1,9 +1,16 @@
 #include <tls.h>
 #include <openssl/err.h>
 #include <log.h>
+#include <common.h>
 #include <openssl/engine.h>
 #include <openssl/conf.h>
 #include <openssl/ssl.h>
+#include <unistd.h>
+
+#define TLS_SENDFILE_CHUNK  (1 << 14) /* max TLS record */
+
+/* the same for all contexts of this library, session from other context is not resumed */
+static const unsigned char tls_session_id_context[] = "MyLibs";
 
 /*
     Create tls context for server / client (based on get_method function)
@@ -35,6 +42,19 @@ static SSL_CTX *__tls_context_create(const char *cert, const char *key, int (*ve
 */
 static int __verify_callback(int preverify, X509_STORE_CTX* ctx);
 
+/*
+    Create SSL on fd
+
+    PARAMS
+    @IN ctx - tls context
+    @IN fd - connection file descriptor
+
+    RETURN
+    NULL iff failure
+    New SSL iff success
+*/
+static SSL *__tls_ssl_create(SSL_CTX *ctx, int fd);
+
 static int __verify_callback(int preverify, X509_STORE_CTX* ctx)
 {
     char   buf[256];
@@ -95,11 +115,41 @@ static SSL_CTX *__tls_context_create(const char *cert, const char *key, int (*ve
     SSL_CTX_set_verify_depth(ctx, 0);
     SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER, verify_callback ? verify_callback : __verify_callback);
 
+    /* server keeps sessions and sends tickets, client gets them to resume next connection */
+    if (SSL_CTX_set_session_id_context(ctx, tls_session_id_context, sizeof(tls_session_id_context)) != 1 ||
+        tls_context_set_session_cache(ctx, TLS_SESSION_CACHE_SIZE, TLS_SESSION_TIMEOUT, true))
+    {
+        SSL_CTX_free(ctx);
+        ERROR("Cannot configure session cache\n", NULL);
+    }
+
     LOG("TLS context created and configured\n");
 
     return ctx;
 }
 
+static SSL *__tls_ssl_create(SSL_CTX *ctx, int fd)
+{
+    SSL *ssl;
+
+    TRACE();
+
+    if (ctx == NULL)
+        ERROR("ctx == NULL\n", NULL);
+
+    ssl = SSL_new(ctx);
+    if (ssl == NULL)
+        ERROR("SSL_new error\n", NULL);
+
+    if (SSL_set_fd(ssl, fd) != 1)
+    {
+        SSL_free(ssl);
+        ERROR("SSL_set_fd error\n", NULL);
+    }
+
+    return ssl;
+}
+
 void tls_once_init(void)
 {
     TRACE();
@@ -142,7 +192,9 @@ void tls_clenup(void)
 */
 
     /* new way from 1.1.0 */
+#if OPENSSL_VERSION_NUMBER < 0x30000000L
     FIPS_mode_set(0);
+#endif
     CRYPTO_set_locking_callback(NULL);
     CRYPTO_set_id_callback(NULL);
     ENGINE_cleanup();
@@ -182,17 +234,58 @@ void tls_context_destroy(SSL_CTX *ctx)
     SSL_CTX_free(ctx);
 }
 
+int tls_context_set_session_cache(SSL_CTX *ctx, long cache_size, long timeout, bool tickets)
+{
+    TRACE();
+
+    if (ctx == NULL)
+        ERROR("ctx == NULL\n", 1);
+
+    if (cache_size < 0 || timeout <= 0)
+        ERROR("Invalid arguments\n", 1);
+
+    if (cache_size == 0)
+        (void)SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+    else
+    {
+        (void)SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_BOTH);
+        (void)SSL_CTX_sess_set_cache_size(ctx, cache_size);
+    }
+
+    (void)SSL_CTX_set_timeout(ctx, timeout);
+
+    if (tickets)
+        (void)SSL_CTX_clear_options(ctx, SSL_OP_NO_TICKET);
+    else
+        (void)SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+
+    return 0;
+}
+
+int tls_context_enable_ktls(SSL_CTX *ctx)
+{
+    TRACE();
+
+    if (ctx == NULL)
+        ERROR("ctx == NULL\n", 1);
+
+#ifdef SSL_OP_ENABLE_KTLS
+    (void)SSL_CTX_set_options(ctx, SSL_OP_ENABLE_KTLS);
+    return 0;
+#else
+    ERROR("OpenSSL without kTLS support\n", 1);
+#endif
+}
+
 SSL *tls_accept(SSL_CTX *ctx, int fd)
 {
     SSL *ssl;
 
     TRACE();
 
-    ssl = SSL_new(ctx);
+    ssl = __tls_ssl_create(ctx, fd);
     if (ssl == NULL)
-        ERROR("SSL_new error\n", NULL);
-
-    SSL_set_fd(ssl, fd);
+        ERROR("__tls_ssl_create error\n", NULL);
 
     if (SSL_accept(ssl) <= 0)
     {
@@ -207,16 +300,21 @@ SSL *tls_accept(SSL_CTX *ctx, int fd)
 }
 
 SSL *tls_request_connection(SSL_CTX *ctx, int fd)
+{
+    TRACE();
+
+    return tls_request_connection_with_session(ctx, fd, NULL);
+}
+
+SSL *tls_request_connection_with_session(SSL_CTX *ctx, int fd, SSL_SESSION *session)
 {
     SSL *ssl;
 
     TRACE();
 
-    ssl = SSL_new(ctx);
+    ssl = tls_connect_start(ctx, fd, session);
     if (ssl == NULL)
-        ERROR("SSL_new error\n", NULL);
-
-    SSL_set_fd(ssl, fd);
+        ERROR("tls_connect_start error\n", NULL);
 
     if (SSL_connect(ssl) <= 0)
     {
@@ -225,11 +323,205 @@ SSL *tls_request_connection(SSL_CTX *ctx, int fd)
         ERROR("SSL_connect error\n", NULL);
     }
 
-    LOG("TLS connection for %d fd done\n", fd);
+    LOG("TLS connection for %d fd done, session reused = %d\n", fd, SSL_session_reused(ssl));
+
+    return ssl;
+}
+
+SSL *tls_accept_start(SSL_CTX *ctx, int fd)
+{
+    SSL *ssl;
+
+    TRACE();
+
+    ssl = __tls_ssl_create(ctx, fd);
+    if (ssl == NULL)
+        ERROR("__tls_ssl_create error\n", NULL);
+
+    SSL_set_accept_state(ssl);
+
+    return ssl;
+}
+
+SSL *tls_connect_start(SSL_CTX *ctx, int fd, SSL_SESSION *session)
+{
+    SSL *ssl;
+
+    TRACE();
+
+    ssl = __tls_ssl_create(ctx, fd);
+    if (ssl == NULL)
+        ERROR("__tls_ssl_create error\n", NULL);
+
+    /* expired or foreign session is not an error, full handshake is made */
+    if (session != NULL && SSL_set_session(ssl, session) != 1)
+    {
+        SSL_free(ssl);
+        ERROR("SSL_set_session error\n", NULL);
+    }
+
+    SSL_set_connect_state(ssl);
 
     return ssl;
 }
 
+int tls_handshake(SSL *ssl)
+{
+    int ret;
+
+    TRACE();
+
+    if (ssl == NULL)
+        ERROR("ssl == NULL\n", TLS_HANDSHAKE_ERROR);
+
+    ret = SSL_do_handshake(ssl);
+    if (ret == 1)
+        return TLS_HANDSHAKE_DONE;
+
+    switch (SSL_get_error(ssl, ret))
+    {
+        case SSL_ERROR_WANT_READ:
+        {
+            return TLS_HANDSHAKE_WANT_READ;
+        }
+        case SSL_ERROR_WANT_WRITE:
+        {
+            return TLS_HANDSHAKE_WANT_WRITE;
+        }
+        default:
+        {
+            ERR_print_errors_fp(stderr);
+            ERROR("SSL_do_handshake error\n", TLS_HANDSHAKE_ERROR);
+        }
+    }
+
+    return TLS_HANDSHAKE_ERROR;
+}
+
+SSL_SESSION *tls_get_session(SSL *ssl)
+{
+    SSL_SESSION *session;
+
+    TRACE();
+
+    if (ssl == NULL)
+        ERROR("ssl == NULL\n", NULL);
+
+    session = SSL_get1_session(ssl);
+    if (session == NULL)
+        ERROR("SSL_get1_session error\n", NULL);
+
+    if (SSL_SESSION_is_resumable(session) != 1)
+    {
+        SSL_SESSION_free(session);
+        ERROR("session is not resumable\n", NULL);
+    }
+
+    return session;
+}
+
+void tls_session_destroy(SSL_SESSION *session)
+{
+    TRACE();
+
+    if (session == NULL)
+        return;
+
+    SSL_SESSION_free(session);
+}
+
+bool tls_session_reused(const SSL *ssl)
+{
+    TRACE();
+
+    if (ssl == NULL)
+        ERROR("ssl == NULL\n", false);
+
+    return SSL_session_reused(ssl) == 1;
+}
+
+bool tls_ktls_send_enabled(SSL *ssl)
+{
+    TRACE();
+
+    if (ssl == NULL)
+        ERROR("ssl == NULL\n", false);
+
+#ifdef SSL_OP_ENABLE_KTLS
+    return BIO_get_ktls_send(SSL_get_wbio(ssl)) == 1;
+#else
+    return false;
+#endif
+}
+
+ssize_t tls_sendfile(SSL *ssl, int fd, off_t offset, size_t size)
+{
+    char buf[TLS_SENDFILE_CHUNK];
+    size_t sent = 0;
+    ssize_t n;
+    int ret;
+
+    TRACE();
+
+    if (ssl == NULL)
+        ERROR("ssl == NULL\n", -1);
+
+#ifdef SSL_OP_ENABLE_KTLS
+    /* kernel reads pages and encrypts them */
+    if (tls_ktls_send_enabled(ssl))
+    {
+        while (sent < size)
+        {
+            n = SSL_sendfile(ssl, fd, offset + (off_t)sent, size - sent, 0);
+            if (n < 0)
+                ERROR("SSL_sendfile error\n", -1);
+
+            if (n == 0)
+                break;
+
+            sent += (size_t)n;
+        }
+
+        return (ssize_t)sent;
+    }
+#endif
+
+    while (sent < size)
+    {
+        n = pread(fd, buf, MIN(sizeof(buf), size - sent), offset + (off_t)sent);
+        if (n == -1)
+            ERROR("pread error\n", -1);
+
+        if (n == 0)
+            break;
+
+        ret = SSL_write(ssl, buf, (int)n);
+        if (ret <= 0)
+        {
+            ERR_print_errors_fp(stderr);
+            ERROR("SSL_write error\n", -1);
+        }
+
+        sent += (size_t)n;
+    }
+
+    return (ssize_t)sent;
+}
+
+int tls_shutdown(SSL *ssl)
+{
+    TRACE();
+
+    if (ssl == NULL)
+        ERROR("ssl == NULL\n", 1);
+
+    /* 0 - close_notify sent, 1 - also received from peer */
+    if (SSL_shutdown(ssl) < 0)
+        ERROR("SSL_shutdown error\n", 1);
+
+    return 0;
+}
+
 void tls_ssl_destroy(SSL *ssl)
 {
     TRACE();
@@ -0,0 +1,354 @@
+#include <ahocorasick.h>
+#include <test.h>
+#include <generic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_MATCHES 100000
+
+typedef struct Match
+{
+    size_t id;
+    size_t offset;
+}Match;
+
+typedef struct Matches
+{
+    Match   *m;
+    size_t  len;
+    size_t  stop_at;    /* stop after this number of matches, 0 means never */
+}Matches;
+
+static int collect(size_t id, size_t offset, void *arg);
+static int match_cmp(const void *a, const void *b);
+
+static int collect(size_t id, size_t offset, void *arg)
+{
+    Matches *ms = (Matches *)arg;
+
+    if (ms->len < MAX_MATCHES)
+    {
+        ms->m[ms->len].id = id;
+        ms->m[ms->len].offset = offset;
+        ++ms->len;
+    }
+
+    return ms->stop_at != 0 && ms->len == ms->stop_at;
+}
+
+static int match_cmp(const void *a, const void *b)
+{
+    const Match *m1 = (const Match *)a;
+    const Match *m2 = (const Match *)b;
+
+    if (m1->offset != m2->offset)
+        return m1->offset < m2->offset ? -1 : 1;
+
+    if (m1->id != m2->id)
+        return m1->id < m2->id ? -1 : 1;
+
+    return 0;
+}
+
+test_f test_create(void)
+{
+    const char *patterns[] = {"he", "she", "his", "hers"};
+    const char *bad[] = {"he", ""};
+    Aho_corasick *ac;
+
+    T_CHECK(aho_corasick_create(NULL, 1) == NULL);
+    T_CHECK(aho_corasick_create(patterns, 0) == NULL);
+    T_CHECK(aho_corasick_create(bad, ARRAY_SIZE(bad)) == NULL);
+    T_CHECK(aho_corasick_create_from_trie(NULL) == NULL);
+
+    ac = aho_corasick_create(patterns, ARRAY_SIZE(patterns));
+    T_ERROR(ac == NULL);
+
+    T_EXPECT(aho_corasick_get_num_patterns(ac), 4);
+    /* root, h, he, hi, his, her, hers, s, sh, she */
+    T_EXPECT(aho_corasick_get_num_states(ac), 10);
+    T_CHECK(strcmp(aho_corasick_get_pattern(ac, 3), "hers") == 0);
+    T_CHECK(aho_corasick_get_pattern(ac, 4) == NULL);
+
+    T_EXPECT(aho_corasick_get_num_patterns(NULL), -1);
+    T_EXPECT(aho_corasick_get_num_states(NULL), -1);
+
+    aho_corasick_destroy(ac);
+}
+
+test_f test_search(void)
+{
+    const char *patterns[] = {"he", "she", "his", "hers"};
+    const char *text = "ushers";
+    Match m[16];
+    Matches ms = {m, 0, 0};
+    Aho_corasick *ac = aho_corasick_create(patterns, ARRAY_SIZE(patterns));
+    T_ERROR(ac == NULL);
+
+    T_EXPECT(aho_corasick_search(ac, text, strlen(text), collect, &ms), 3);
+    T_EXPECT(ms.len, 3);
+
+    /* at the same end, longer pattern is reported first */
+    T_EXPECT(m[0].id, 1);
+    T_EXPECT(m[0].offset, 1);
+    T_EXPECT(m[1].id, 0);
+    T_EXPECT(m[1].offset, 2);
+    T_EXPECT(m[2].id, 3);
+    T_EXPECT(m[2].offset, 2);
+
+    /* without callback only count */
+    T_EXPECT(aho_corasick_search(ac, text, strlen(text), NULL, NULL), 3);
+    T_EXPECT(aho_corasick_search(ac, "xyz", 3, NULL, NULL), 0);
+    T_EXPECT(aho_corasick_search(ac, text, 0, NULL, NULL), 0);
+    T_EXPECT(aho_corasick_search(ac, NULL, 1, NULL, NULL), -1);
+    T_EXPECT(aho_corasick_search(NULL, text, 1, NULL, NULL), -1);
+
+    aho_corasick_destroy(ac);
+}
+
+test_f test_overlap_duplicates(void)
+{
+    const char *patterns[] = {"a", "aa", "aaa", "aa", "\xff\x01"};
+    const char text[] = "aaaa\xff\x01";
+    Match m[32];
+    Matches ms = {m, 0, 0};
+    Aho_corasick *ac = aho_corasick_create(patterns, ARRAY_SIZE(patterns));
+    T_ERROR(ac == NULL);
+
+    /* a: 4, aa: 3, aaa: 2, binary: 1 */
+    T_EXPECT(aho_corasick_search(ac, text, sizeof(text) - 1, collect, &ms), 10);
+    qsort(m, ms.len, sizeof(*m), match_cmp);
+
+    /* duplicated pattern is reported with the first id */
+    T_EXPECT(m[0].id, 0);
+    T_EXPECT(m[0].offset, 0);
+    T_EXPECT(m[1].id, 1);
+    T_EXPECT(m[1].offset, 0);
+    T_EXPECT(m[2].id, 2);
+    T_EXPECT(m[2].offset, 0);
+    T_EXPECT(m[9].id, 4);
+    T_EXPECT(m[9].offset, 4);
+
+    aho_corasick_destroy(ac);
+}
+
+test_f test_stream(void)
+{
+    const char *patterns[] = {"error", "warn", "fatal", "err", "or"};
+    const char *text = "error: fatal warning, terror or errand";
+    Match m1[64];
+    Match m2[64];
+    Matches ms1 = {m1, 0, 0};
+    Matches ms2 = {m2, 0, 0};
+    Aho_corasick_stream stream;
+    size_t i;
+    size_t len = strlen(text);
+    Aho_corasick *ac = aho_corasick_create(patterns, ARRAY_SIZE(patterns));
+    T_ERROR(ac == NULL);
+
+    T_CHECK(aho_corasick_search(ac, text, len, collect, &ms1) > 0);
+
+    /* byte by byte */
+    T_EXPECT(aho_corasick_stream_init(ac, &stream), 0);
+    for (i = 0; i < len; ++i)
+        T_CHECK(aho_corasick_stream_feed(&stream, text + i, 1, collect, &ms2) >= 0);
+
+    T_EXPECT(aho_corasick_stream_get_offset(&stream), len);
+    T_EXPECT(ms1.len, ms2.len);
+    T_CHECK(memcmp(m1, m2, sizeof(*m1) * ms1.len) == 0);
+
+    /* uneven chunks */
+    ms2.len = 0;
+    T_EXPECT(aho_corasick_stream_init(ac, &stream), 0);
+    for (i = 0; i < len; i += 7)
+        T_CHECK(aho_corasick_stream_feed(&stream, text + i, MIN((size_t)7, len - i), collect, &ms2) >= 0);
+
+    T_EXPECT(ms1.len, ms2.len);
+    T_CHECK(memcmp(m1, m2, sizeof(*m1) * ms1.len) == 0);
+
+    T_EXPECT(aho_corasick_stream_init(NULL, &stream), 1);
+    T_EXPECT(aho_corasick_stream_init(ac, NULL), 1);
+    T_EXPECT(aho_corasick_stream_get_offset(NULL), -1);
+
+    aho_corasick_destroy(ac);
+}
+
+test_f test_stop(void)
+{
+    const char *patterns[] = {"ab", "b", "c"};
+    const char *text = "abcabc";
+    Match m[16];
+    Matches ms = {m, 0, 2};
+    Aho_corasick_stream stream;
+    ssize_t off;
+    size_t id;
+    Aho_corasick *ac = aho_corasick_create(patterns, ARRAY_SIZE(patterns));
+    T_ERROR(ac == NULL);
+
+    T_EXPECT(aho_corasick_stream_init(ac, &stream), 0);
+    T_EXPECT(aho_corasick_stream_feed(&stream, text, 6, collect, &ms), 2);
+    T_EXPECT(aho_corasick_stream_get_offset(&stream), 2);
+
+    /* feed the rest */
+    ms.stop_at = 0;
+    off = aho_corasick_stream_get_offset(&stream);
+    T_EXPECT(aho_corasick_stream_feed(&stream, text + off, 6 - (size_t)off, collect, &ms), 4);
+    T_EXPECT(ms.len, 6);
+    T_EXPECT(m[5].id, 2);
+    T_EXPECT(m[5].offset, 5);
+
+    T_EXPECT(aho_corasick_find_first(ac, text, 6, &id), 0);
+    T_EXPECT(id, 0);
+    T_EXPECT(aho_corasick_find_first(ac, text + 3, 3, NULL), 0);
+    T_EXPECT(aho_corasick_find_first(ac, "xxc", 3, &id), 2);
+    T_EXPECT(id, 2);
+    T_EXPECT(aho_corasick_find_first(ac, "xyz", 3, &id), -1);
+
+    aho_corasick_destroy(ac);
+}
+
+test_f test_from_trie(void)
+{
+    const char *words[] = {"cat", "category", "dog", "do", "at"};
+    const char *text = "a category of dogs";
+    char **arr;
+    size_t size;
+    size_t i;
+    Match m[32];
+    Matches ms = {m, 0, 0};
+    Aho_corasick *ac;
+    Trie *trie = trie_create();
+    T_ERROR(trie == NULL);
+
+    for (i = 0; i < ARRAY_SIZE(words); ++i)
+        T_EXPECT(trie_insert(trie, words[i]), 0);
+
+    ac = aho_corasick_create_from_trie(trie);
+    T_ERROR(ac == NULL);
+    T_EXPECT(aho_corasick_get_num_patterns(ac), ARRAY_SIZE(words));
+
+    /* cat, category, at, do, dog */
+    T_EXPECT(aho_corasick_search(ac, text, strlen(text), collect, &ms), 5);
+
+    arr = trie_to_array(trie, &size);
+    T_ERROR(arr == NULL);
+    T_EXPECT(size, ARRAY_SIZE(words));
+
+    for (i = 0; i < ms.len; ++i)
+        T_CHECK(strncmp(text + m[i].offset, arr[m[i].id], strlen(arr[m[i].id])) == 0);
+
+    for (i = 0; i < size; ++i)
+    {
+        T_CHECK(strcmp(aho_corasick_get_pattern(ac, i), arr[i]) == 0);
+        FREE(arr[i]);
+    }
+
+    FREE(arr);
+    aho_corasick_destroy(ac);
+    trie_destroy(trie);
+}
+
+test_f test_random(void)
+{
+    const size_t num_patterns = 500;
+    const size_t text_len = 20000;
+    char **patterns;
+    char *text;
+    Match *m1;
+    Match *m2;
+    Matches ms;
+    Aho_corasick_stream stream;
+    size_t i;
+    size_t j;
+    size_t k;
+    size_t len;
+    size_t chunk;
+    Aho_corasick *ac;
+
+    patterns = (char **)malloc(sizeof(char *) * num_patterns);
+    text = (char *)malloc(text_len);
+    m1 = (Match *)malloc(sizeof(Match) * MAX_MATCHES);
+    m2 = (Match *)malloc(sizeof(Match) * MAX_MATCHES);
+    T_ERROR(patterns == NULL || text == NULL || m1 == NULL || m2 == NULL);
+
+    /* small alphabet to get a lot of matches */
+    for (i = 0; i < num_patterns; ++i)
+    {
+        len = 1 + (size_t)rand() % 6;
+        patterns[i] = (char *)malloc(len + 1);
+        T_ERROR(patterns[i] == NULL);
+        for (j = 0; j < len; ++j)
+            patterns[i][j] = (char)('a' + rand() % 4);
+        patterns[i][len] = '\0';
+    }
+
+    for (i = 0; i < text_len; ++i)
+        text[i] = (char)('a' + rand() % 5);
+
+    ac = aho_corasick_create((const char * const *)patterns, num_patterns);
+    T_ERROR(ac == NULL);
+
+    /* brute force, duplicates are reported with the first id */
+    k = 0;
+    for (i = 0; i < text_len; ++i)
+        for (j = 0; j < num_patterns; ++j)
+        {
+            len = strlen(patterns[j]);
+            if (i + len <= text_len && memcmp(text + i, patterns[j], len) == 0)
+            {
+                for (len = 0; len < j; ++len)
+                    if (strcmp(patterns[len], patterns[j]) == 0)
+                        break;
+
+                if (len == j && k < MAX_MATCHES)
+                {
+                    m1[k].id = j;
+                    m1[k].offset = i;
+                    ++k;
+                }
+            }
+        }
+
+    T_ERROR(k >= MAX_MATCHES);
+
+    ms.m = m2;
+    ms.len = 0;
+    ms.stop_at = 0;
+    T_EXPECT(aho_corasick_stream_init(ac, &stream), 0);
+    for (i = 0; i < text_len; i += chunk)
+    {
+        chunk = MIN(1 + (size_t)rand() % 97, text_len - i);
+        T_CHECK(aho_corasick_stream_feed(&stream, text + i, chunk, collect, &ms) >= 0);
+    }
+
+    T_EXPECT(ms.len, k);
+    qsort(m2, ms.len, sizeof(*m2), match_cmp);
+    T_CHECK(memcmp(m1, m2, sizeof(*m1) * k) == 0);
+
+    aho_corasick_destroy(ac);
+    for (i = 0; i < num_patterns; ++i)
+        FREE(patterns[i]);
+
+    FREE(patterns);
+    FREE(text);
+    FREE(m1);
+    FREE(m2);
+}
+
+void test(void)
+{
+    TEST(test_create());
+    TEST(test_search());
+    TEST(test_overlap_duplicates());
+    TEST(test_stream());
+    TEST(test_stop());
+    TEST(test_from_trie());
+    TEST(test_random());
+}
+
+int main(void)
+{
+    TEST_INIT("AHOCORASICK");
+    test();
+    TEST_SUMMARY();
+}
@@ -914,6 +914,35 @@ test_f test_select_kth(void)
     T_ASSERT(t2[index], 0.9);
 }
 
+test_f test_select_multi(void)
+{
+    const int t[] = {1, 6, 3, 9, 8, 2, 4, 5, 7};
+    const size_t ks[] = {0, 2, 2, 4, 8};
+    int kths[ARRAY_SIZE(ks)];
+    const double t2[] = {0.1, 0.6, 0.3, 0.9, 0.8, 0.2, 0.4, 0.5, 0.7};
+    const size_t ks2[] = {1, 7};
+    double kths2[ARRAY_SIZE(ks2)];
+
+    T_EXPECT(array_select_multi(t, ARRAY_SIZE(t), sizeof(*t), ks, ARRAY_SIZE(ks), cmp_int, kths), 0);
+    T_ASSERT(kths[0], 1);
+    T_ASSERT(kths[1], 3);
+    T_ASSERT(kths[2], 3);
+    T_ASSERT(kths[3], 5);
+    T_ASSERT(kths[4], 9);
+
+    /* array is not changed */
+    T_ASSERT(t[0], 1);
+    T_ASSERT(t[1], 6);
+
+    T_EXPECT(array_select_multi(t2, ARRAY_SIZE(t2), sizeof(*t2), ks2, ARRAY_SIZE(ks2), cmp_double, kths2), 0);
+    T_ASSERT(kths2[0], 0.2);
+    T_ASSERT(kths2[1], 0.8);
+
+    T_CHECK(array_select_multi(NULL, ARRAY_SIZE(t), sizeof(*t), ks, ARRAY_SIZE(ks), cmp_int, kths) != 0);
+    T_CHECK(array_select_multi(t, ARRAY_SIZE(t), sizeof(*t), ks, ARRAY_SIZE(ks), cmp_int, NULL) != 0);
+    T_CHECK(array_select_multi(t, ARRAY_SIZE(t), sizeof(*t), ks2, ARRAY_SIZE(ks2), NULL, kths) != 0);
+}
+
 test_f test_median(void)
 {
     int t[] = {1, 6, 3, 9, 8, 2, 4, 5, 7};
@@ -1302,6 +1331,7 @@ void test(void)
     TEST(test_check_sorted());
     TEST(test_check_reverse_sorted());
     TEST(test_select_kth());
+    TEST(test_select_multi());
     TEST(test_median());
     TEST(test_min());
     TEST(test_max());
@@ -0,0 +1,325 @@
+#include <asyncio.h>
+#include <test.h>
+#include <common.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <pthread.h>
+
+#define CHUNK_SIZE  BIT(16)
+#define NUM_CHUNKS  64
+
+const char* const test_dir = "./files";
+
+___before_main___(1) void test_init(void)
+{
+    struct stat st;
+
+    if (stat(test_dir, &st) == -1)
+        mkdir(test_dir, 0775);
+}
+
+___after_main___(1) void test_deinit(void)
+{
+    rmdir(test_dir);
+}
+
+/* data comes to pipe in 2 parts */
+static void *pipe_writer(void *arg)
+{
+    const int fd = *(int *)arg;
+    char buf[CHUNK_SIZE / 2];
+    size_t i;
+
+    for (i = 0; i < sizeof(buf); ++i)
+        buf[i] = (char)i;
+
+    T_EXPECT(write(fd, buf, sizeof(buf)), (ssize_t)sizeof(buf));
+    (void)usleep(50000);
+    T_EXPECT(write(fd, buf, sizeof(buf)), (ssize_t)sizeof(buf));
+
+    return NULL;
+}
+
+/* write chunks, read them back in random order and check */
+static void test_write_read(int flags)
+{
+    char *path;
+    char *buf;
+    int fd;
+    size_t i;
+    size_t chunk;
+    size_t done;
+    ssize_t n;
+    ssize_t j;
+    Async_io_completion cqe[16];
+    Async_io *aio;
+
+    aio = async_io_create(16, flags);
+    T_ERROR(aio == NULL);
+
+    if (flags & ASYNC_IO_FORCE_THREADS)
+        T_EXPECT(async_io_get_backend(aio), ASYNC_IO_BACKEND_THREADS);
+
+    T_ERROR(asprintf(&path, "%s/%s_%d", test_dir, __func__, flags) == -1);
+    fd = async_io_open(path, O_RDWR | O_CREAT | O_TRUNC, true);
+    T_ERROR(fd == -1);
+
+    buf = (char *)async_io_alloc_buffer(CHUNK_SIZE * NUM_CHUNKS);
+    T_ERROR(buf == NULL);
+    T_EXPECT((size_t)buf % ASYNC_IO_ALIGNMENT, 0);
+
+    for (i = 0; i < CHUNK_SIZE * NUM_CHUNKS; ++i)
+        buf[i] = (char)(i / CHUNK_SIZE + i % 7);
+
+    /* writes, queue is smaller than number of chunks */
+    chunk = 0;
+    done = 0;
+    while (done < NUM_CHUNKS)
+    {
+        /* chunk - done requests are in flight */
+        while (chunk < NUM_CHUNKS && chunk - done < 16)
+        {
+            T_EXPECT(async_io_prep_write(aio, fd, buf + chunk * CHUNK_SIZE, CHUNK_SIZE, (off_t)(chunk * CHUNK_SIZE), (void *)chunk), 0);
+            ++chunk;
+        }
+
+        T_CHECK(async_io_submit(aio) >= 0);
+
+        n = async_io_poll(aio, cqe, ARRAY_SIZE(cqe), 1);
+        T_ERROR(n <= 0);
+        for (j = 0; j < n; ++j)
+            T_EXPECT(cqe[j].res, CHUNK_SIZE);
+
+        done += (size_t)n;
+    }
+
+    T_EXPECT(async_io_get_inflight(aio), 0);
+
+    /* read back, reversed order */
+    (void)memset(buf, 0, CHUNK_SIZE * NUM_CHUNKS);
+    for (chunk = 0; chunk < NUM_CHUNKS; chunk += 16)
+    {
+        for (i = 0; i < 16; ++i)
+            T_EXPECT(async_io_prep_read(aio, fd, buf + (NUM_CHUNKS - 1 - chunk - i) * CHUNK_SIZE, CHUNK_SIZE,
+                                        (off_t)((NUM_CHUNKS - 1 - chunk - i) * CHUNK_SIZE), (void *)(chunk + i)), 0);
+
+        /* queue is full */
+        T_CHECK(async_io_prep_read(aio, fd, buf, CHUNK_SIZE, 0, NULL) != 0);
+
+        T_EXPECT(async_io_submit(aio), 16);
+
+        done = 0;
+        while (done < 16)
+        {
+            n = async_io_poll(aio, cqe, ARRAY_SIZE(cqe), 16 - done);
+            T_ERROR(n <= 0);
+            for (j = 0; j < n; ++j)
+            {
+                T_EXPECT(cqe[j].res, CHUNK_SIZE);
+                T_CHECK((size_t)cqe[j].user_data >= chunk && (size_t)cqe[j].user_data < chunk + 16);
+            }
+
+            done += (size_t)n;
+        }
+    }
+
+    for (i = 0; i < CHUNK_SIZE * NUM_CHUNKS; ++i)
+        T_ASSERT(buf[i], (char)(i / CHUNK_SIZE + i % 7));
+
+    /* read after end of file */
+    T_EXPECT(async_io_prep_read(aio, fd, buf, CHUNK_SIZE, (off_t)(CHUNK_SIZE * NUM_CHUNKS), NULL), 0);
+    T_EXPECT(async_io_submit(aio), 1);
+    T_EXPECT(async_io_poll(aio, cqe, ARRAY_SIZE(cqe), 1), 1);
+    T_EXPECT(cqe[0].res, 0);
+
+    /* end of file in the middle, the same result in both backends */
+    T_EXPECT(async_io_prep_read(aio, fd, buf, CHUNK_SIZE * 2, (off_t)(CHUNK_SIZE * (NUM_CHUNKS - 1)), NULL), 0);
+    T_EXPECT(async_io_submit(aio), 1);
+    T_EXPECT(async_io_poll(aio, cqe, ARRAY_SIZE(cqe), 1), 1);
+    T_EXPECT(cqe[0].res, CHUNK_SIZE);
+
+    /* bad fd */
+    T_EXPECT(async_io_prep_read(aio, 1000, buf, CHUNK_SIZE, 0, NULL), 0);
+    T_EXPECT(async_io_submit(aio), 1);
+    T_EXPECT(async_io_poll(aio, cqe, ARRAY_SIZE(cqe), 1), 1);
+    T_CHECK(cqe[0].res < 0);
+
+    async_io_destroy(aio);
+    async_io_free_buffer(buf);
+
+    close(fd);
+    T_ERROR(remove(path) == -1);
+    FREE(path);
+}
+
+static void test_fixed(int flags)
+{
+    char *path;
+    char *buf;
+    int fd;
+    size_t i;
+    struct iovec iov;
+    Async_io_completion cqe[4];
+    Async_io *aio;
+
+    aio = async_io_create(4, flags);
+    T_ERROR(aio == NULL);
+
+    T_ERROR(asprintf(&path, "%s/%s_%d", test_dir, __func__, flags) == -1);
+    fd = async_io_open(path, O_RDWR | O_CREAT | O_TRUNC, false);
+    T_ERROR(fd == -1);
+
+    buf = (char *)async_io_alloc_buffer(CHUNK_SIZE * 2);
+    T_ERROR(buf == NULL);
+
+    /* not registered yet */
+    T_CHECK(async_io_prep_write_fixed(aio, fd, buf, CHUNK_SIZE, 0, 0, NULL) != 0);
+
+    iov.iov_base = buf;
+    iov.iov_len = CHUNK_SIZE * 2;
+    T_EXPECT(async_io_register_buffers(aio, &iov, 1), 0);
+    T_CHECK(async_io_register_buffers(aio, &iov, 1) != 0);
+
+    for (i = 0; i < CHUNK_SIZE; ++i)
+        buf[i] = (char)i;
+
+    T_CHECK(async_io_prep_write_fixed(aio, fd, buf, CHUNK_SIZE, 0, 1, NULL) != 0);
+    T_CHECK(async_io_prep_write_fixed(aio, fd, buf + CHUNK_SIZE, CHUNK_SIZE + 1, 0, 0, NULL) != 0);
+
+    T_EXPECT(async_io_prep_write_fixed(aio, fd, buf, CHUNK_SIZE, 0, 0, NULL), 0);
+    T_EXPECT(async_io_submit(aio), 1);
+    T_EXPECT(async_io_poll(aio, cqe, ARRAY_SIZE(cqe), 1), 1);
+    T_EXPECT(cqe[0].res, CHUNK_SIZE);
+
+    T_EXPECT(async_io_prep_read_fixed(aio, fd, buf + CHUNK_SIZE, CHUNK_SIZE, 0, 0, (void *)buf), 0);
+    T_EXPECT(async_io_submit(aio), 1);
+    T_EXPECT(async_io_poll(aio, cqe, ARRAY_SIZE(cqe), 1), 1);
+    T_EXPECT(cqe[0].res, CHUNK_SIZE);
+    T_CHECK(cqe[0].user_data == (void *)buf);
+
+    T_EXPECT(memcmp(buf, buf + CHUNK_SIZE, CHUNK_SIZE), 0);
+
+    /* destroy waits for requests in flight */
+    T_EXPECT(async_io_prep_read_fixed(aio, fd, buf + CHUNK_SIZE, CHUNK_SIZE, 0, 0, NULL), 0);
+    T_EXPECT(async_io_submit(aio), 1);
+
+    async_io_destroy(aio);
+    async_io_free_buffer(buf);
+
+    close(fd);
+    T_ERROR(remove(path) == -1);
+    FREE(path);
+}
+
+test_f test_short_read(void)
+{
+    Async_io_completion cqe[1];
+    Async_io *aio;
+    pthread_t thread;
+    char *buf;
+    int pipefd[2];
+    int null_fd;
+    size_t i;
+
+    aio = async_io_create(4, 0);
+    T_ERROR(aio == NULL);
+
+    /* threads backend uses pread which doesn't work on pipes, it loops anyway */
+    if (async_io_get_backend(aio) != ASYNC_IO_BACKEND_URING)
+    {
+        async_io_destroy(aio);
+        return;
+    }
+
+    buf = (char *)async_io_alloc_buffer(CHUNK_SIZE);
+    T_ERROR(buf == NULL);
+    T_ERROR(pipe(pipefd) == -1);
+
+    /* first completion has only half of data, rest is read by resubmitted request */
+    T_EXPECT(async_io_prep_read(aio, pipefd[0], buf, CHUNK_SIZE, 0, (void *)buf), 0);
+    T_EXPECT(async_io_submit(aio), 1);
+    T_ERROR(pthread_create(&thread, NULL, pipe_writer, (void *)&pipefd[1]) != 0);
+
+    /* prepared, not submitted request is not sent with resubmitted one */
+    null_fd = open("/dev/null", O_WRONLY);
+    T_ERROR(null_fd == -1);
+    T_EXPECT(async_io_prep_write(aio, null_fd, buf, 16, 0, NULL), 0);
+
+    T_EXPECT(async_io_poll(aio, cqe, ARRAY_SIZE(cqe), 1), 1);
+    T_EXPECT(cqe[0].res, CHUNK_SIZE);
+    T_CHECK(cqe[0].user_data == (void *)buf);
+    T_EXPECT(async_io_get_inflight(aio), 0);
+
+    T_EXPECT(async_io_submit(aio), 1);
+    T_EXPECT(async_io_poll(aio, cqe, ARRAY_SIZE(cqe), 1), 1);
+    T_EXPECT(cqe[0].res, 16);
+    T_CHECK(cqe[0].user_data == NULL);
+    close(null_fd);
+
+    for (i = 0; i < CHUNK_SIZE; ++i)
+        T_ASSERT(buf[i], (char)(i % (CHUNK_SIZE / 2)));
+
+    (void)pthread_join(thread, NULL);
+
+    close(pipefd[0]);
+    close(pipefd[1]);
+    async_io_destroy(aio);
+    async_io_free_buffer(buf);
+}
+
+test_f test_create(void)
+{
+    Async_io *aio;
+
+    T_CHECK(async_io_create(0, 0) == NULL);
+
+    aio = async_io_create(8, 0);
+    T_ERROR(aio == NULL);
+
+    T_CHECK(async_io_get_backend(aio) == ASYNC_IO_BACKEND_URING || async_io_get_backend(aio) == ASYNC_IO_BACKEND_THREADS);
+    T_EXPECT(async_io_get_inflight(aio), 0);
+    T_EXPECT(async_io_submit(aio), 0);
+
+    async_io_destroy(aio);
+}
+
+test_f test_write_read_default(void)
+{
+    test_write_read(0);
+}
+
+test_f test_write_read_threads(void)
+{
+    test_write_read(ASYNC_IO_FORCE_THREADS);
+}
+
+test_f test_fixed_default(void)
+{
+    test_fixed(0);
+}
+
+test_f test_fixed_threads(void)
+{
+    test_fixed(ASYNC_IO_FORCE_THREADS);
+}
+
+void test(void)
+{
+    TEST(test_create());
+    TEST(test_write_read_default());
+    TEST(test_write_read_threads());
+    TEST(test_fixed_default());
+    TEST(test_fixed_threads());
+    TEST(test_short_read());
+}
+
+int main(void)
+{
+    TEST_INIT("ASYNCIO");
+    test();
+    TEST_SUMMARY();
+}
@@ -0,0 +1,198 @@
+#include <bloom.h>
+#include <test.h>
+#include <generic.h>
+#include <stdlib.h>
+
+test_f test_sizing(void)
+{
+    size_t bits;
+
+    T_EXPECT(bloom_optimal_bits(0, 0.01), 0);
+    T_EXPECT(bloom_optimal_bits(100, 0.0), 0);
+    T_EXPECT(bloom_optimal_bits(100, 1.0), 0);
+
+    /* ~9.59 bits per entry for 1% */
+    bits = bloom_optimal_bits(1000, 0.01);
+    T_CHECK(bits >= 9500 && bits <= 9700);
+    T_EXPECT(bloom_optimal_hashes(bits, 1000), 7);
+
+    /* ~4.79 bits per entry for 10% */
+    bits = bloom_optimal_bits(1000, 0.1);
+    T_CHECK(bits >= 4700 && bits <= 4900);
+    T_EXPECT(bloom_optimal_hashes(bits, 1000), 3);
+
+    T_EXPECT(bloom_optimal_hashes(1, 1000), 1);
+}
+
+test_f test_bloom_insert_contains(void)
+{
+    const size_t n = 10000;
+    const double fpr = 0.01;
+    size_t i;
+    size_t key;
+    size_t fp = 0;
+    Bloom_filter *filter = bloom_filter_create_for(n, fpr);
+    T_ERROR(filter == NULL);
+
+    for (i = 0; i < n; ++i)
+        T_EXPECT(bloom_filter_insert(filter, &i, sizeof(i)), 0);
+
+    /* no false negatives */
+    for (i = 0; i < n; ++i)
+        T_CHECK(bloom_filter_contains(filter, &i, sizeof(i)));
+
+    for (i = 0; i < n * 10; ++i)
+    {
+        key = n + i;
+        fp += bloom_filter_contains(filter, &key, sizeof(key));
+    }
+
+    T_CHECK((double)fp / (double)(n * 10) < fpr * 2);
+
+    bloom_filter_destroy(filter);
+}
+
+test_f test_blocked_bloom_insert_contains(void)
+{
+    const size_t n = 10000;
+    const double fpr = 0.01;
+    size_t i;
+    size_t key;
+    size_t fp = 0;
+    Blocked_bloom_filter *filter = blocked_bloom_filter_create_for(n, fpr);
+    T_ERROR(filter == NULL);
+
+    for (i = 0; i < n; ++i)
+        T_EXPECT(blocked_bloom_filter_insert(filter, &i, sizeof(i)), 0);
+
+    for (i = 0; i < n; ++i)
+        T_CHECK(blocked_bloom_filter_contains(filter, &i, sizeof(i)));
+
+    for (i = 0; i < n * 10; ++i)
+    {
+        key = n + i;
+        fp += blocked_bloom_filter_contains(filter, &key, sizeof(key));
+    }
+
+    T_CHECK((double)fp / (double)(n * 10) < fpr * 2);
+
+    blocked_bloom_filter_destroy(filter);
+}
+
+test_f test_merge(void)
+{
+    const size_t n = 1000;
+    size_t i;
+    Bloom_filter *b1 = bloom_filter_create(BIT(14), 5);
+    Bloom_filter *b2 = bloom_filter_create(BIT(14), 5);
+    Bloom_filter *b3 = bloom_filter_create(BIT(14), 4);
+    Blocked_bloom_filter *bb1 = blocked_bloom_filter_create(BIT(14), 5);
+    Blocked_bloom_filter *bb2 = blocked_bloom_filter_create(BIT(14), 5);
+    Blocked_bloom_filter *bb3 = blocked_bloom_filter_create(BIT(15), 5);
+    T_ERROR(b1 == NULL || b2 == NULL || b3 == NULL);
+    T_ERROR(bb1 == NULL || bb2 == NULL || bb3 == NULL);
+
+    for (i = 0; i < n; ++i)
+    {
+        if (ODD(i))
+        {
+            T_EXPECT(bloom_filter_insert(b1, &i, sizeof(i)), 0);
+            T_EXPECT(blocked_bloom_filter_insert(bb1, &i, sizeof(i)), 0);
+        }
+        else
+        {
+            T_EXPECT(bloom_filter_insert(b2, &i, sizeof(i)), 0);
+            T_EXPECT(blocked_bloom_filter_insert(bb2, &i, sizeof(i)), 0);
+        }
+    }
+
+    T_CHECK(bloom_filter_merge(b1, b3) != 0);
+    T_CHECK(blocked_bloom_filter_merge(bb1, bb3) != 0);
+
+    T_EXPECT(bloom_filter_merge(b1, b2), 0);
+    T_EXPECT(blocked_bloom_filter_merge(bb1, bb2), 0);
+
+    for (i = 0; i < n; ++i)
+    {
+        T_CHECK(bloom_filter_contains(b1, &i, sizeof(i)));
+        T_CHECK(blocked_bloom_filter_contains(bb1, &i, sizeof(i)));
+    }
+
+    bloom_filter_destroy(b1);
+    bloom_filter_destroy(b2);
+    bloom_filter_destroy(b3);
+    blocked_bloom_filter_destroy(bb1);
+    blocked_bloom_filter_destroy(bb2);
+    blocked_bloom_filter_destroy(bb3);
+}
+
+test_f test_serialize(void)
+{
+    const size_t n = 1000;
+    size_t i;
+    ssize_t size;
+    BYTE *buf;
+    Bloom_filter *b1 = bloom_filter_create_for(n, 0.01);
+    Bloom_filter *b2;
+    Blocked_bloom_filter *bb1 = blocked_bloom_filter_create_for(n, 0.01);
+    Blocked_bloom_filter *bb2;
+    T_ERROR(b1 == NULL);
+    T_ERROR(bb1 == NULL);
+
+    for (i = 0; i < n; ++i)
+    {
+        T_EXPECT(bloom_filter_insert(b1, &i, sizeof(i)), 0);
+        T_EXPECT(blocked_bloom_filter_insert(bb1, &i, sizeof(i)), 0);
+    }
+
+    size = bloom_filter_serialized_size(b1);
+    T_ERROR(size <= 0);
+    buf = (BYTE *)malloc((size_t)size + 1);
+    T_ERROR(buf == NULL);
+
+    T_EXPECT(bloom_filter_serialize(b1, buf + 1, (size_t)size - 1), -1);
+    T_EXPECT(bloom_filter_serialize(b1, buf + 1, (size_t)size), size);
+    T_CHECK(blocked_bloom_filter_deserialize(buf + 1, (size_t)size) == NULL);
+    T_CHECK(bloom_filter_deserialize(buf + 1, (size_t)size - 1) == NULL);
+
+    b2 = bloom_filter_deserialize(buf + 1, (size_t)size);
+    T_ERROR(b2 == NULL);
+    for (i = 0; i < n; ++i)
+        T_CHECK(bloom_filter_contains(b2, &i, sizeof(i)));
+
+    FREE(buf);
+
+    size = blocked_bloom_filter_serialized_size(bb1);
+    T_ERROR(size <= 0);
+    buf = (BYTE *)malloc((size_t)size + 1);
+    T_ERROR(buf == NULL);
+
+    T_EXPECT(blocked_bloom_filter_serialize(bb1, buf + 1, (size_t)size), size);
+    bb2 = blocked_bloom_filter_deserialize(buf + 1, (size_t)size);
+    T_ERROR(bb2 == NULL);
+    for (i = 0; i < n; ++i)
+        T_CHECK(blocked_bloom_filter_contains(bb2, &i, sizeof(i)));
+
+    FREE(buf);
+
+    bloom_filter_destroy(b1);
+    bloom_filter_destroy(b2);
+    blocked_bloom_filter_destroy(bb1);
+    blocked_bloom_filter_destroy(bb2);
+}
+
+void test(void)
+{
+    TEST(test_sizing());
+    TEST(test_bloom_insert_contains());
+    TEST(test_blocked_bloom_insert_contains());
+    TEST(test_merge());
+    TEST(test_serialize());
+}
+
+int main(void)
+{
+    TEST_INIT("BLOOM");
+    test();
+    TEST_SUMMARY();
+}
@@ -1,6 +1,7 @@
 #include <test.h>
 #include <cstring.h>
 #include <string.h>
+#include <stdlib.h>
 
 test_f test_create(void)
 {
@@ -559,6 +560,373 @@ test_f test_find_substr_string(void)
     string_destroy(s);
 }
 
+test_f test_find_long(void)
+{
+    String *s;
+    char text[1024];
+    char pattern[64];
+    const size_t text_len = sizeof(text) - 1;
+    size_t pattern_len;
+    size_t pos;
+    size_t i;
+
+    /* every candidate passes first / last char filter */
+    memset(text, 'a', text_len);
+    text[text_len] = '\0';
+    text[text_len - 2] = 'b';
+
+    s = string_create_from_str(text);
+    T_ERROR(s == NULL);
+
+    T_EXPECT(string_find_str_first(s, "aba"), (ssize_t)text_len - 3);
+    T_EXPECT(string_find_str_last(s, "aba"), (ssize_t)text_len - 3);
+    T_EXPECT(string_find_str_first(s, "aaa"), 0);
+    T_EXPECT(string_find_str_last(s, "aaa"), (ssize_t)text_len - 5);
+    T_EXPECT(string_find_str_first(s, "aca"), -1);
+    T_EXPECT(string_find_c_first(s, 'b'), (ssize_t)text_len - 2);
+    T_EXPECT(string_find_c_last(s, 'a'), (ssize_t)text_len - 1);
+
+    string_destroy(s);
+
+    /* patterns crossing vector boundaries */
+    for (i = 0; i < text_len; ++i)
+        text[i] = (char)('a' + i % 23);
+
+    s = string_create_from_str(text);
+    T_ERROR(s == NULL);
+
+    for (pattern_len = 1; pattern_len < sizeof(pattern); pattern_len += 7)
+        for (pos = 0; pos + pattern_len <= 100; pos += 13)
+        {
+            memcpy(pattern, text + pos, pattern_len);
+            pattern[pattern_len] = '\0';
+
+            T_EXPECT(string_find_str_first(s, pattern), (ssize_t)(strstr(text, pattern) - text));
+            T_EXPECT(string_find_str_first_substr(s, pattern, pos, pos + pattern_len - 1), (ssize_t)pos);
+            T_EXPECT(string_find_str_first_substr(s, pattern, pos + 1, text_len - 1), (ssize_t)pos + 23);
+            T_EXPECT(string_find_str_last_substr(s, pattern, 0, pos + pattern_len - 1), (ssize_t)pos);
+            T_EXPECT(string_find_str_last(s, pattern), (ssize_t)(pos + ((text_len - pattern_len - pos) / 23) * 23));
+        }
+
+    /* search doesn't touch the string */
+    T_EXPECT(string_find_str_first_substr(s, "bcd", 0, 2), -1);
+    T_EXPECT(string_find_c_last_substr(s, 'd', 0, 2), -1);
+    T_EXPECT(strcmp(string_get_str(s), text), 0);
+
+    string_destroy(s);
+}
+
+test_f test_sso(void)
+{
+    String *s;
+    String *clone;
+    char expt[256];
+    size_t i;
+
+    s = string_create();
+    T_ERROR(s == NULL);
+
+    /* grow from inline buffer to heap and shrink back */
+    for (i = 0; i < 200; ++i)
+    {
+        expt[i] = (char)('a' + i % 26);
+        expt[i + 1] = '\0';
+        T_EXPECT(string_append_c(s, expt[i]), 0);
+        T_EXPECT(string_get_length(s), (ssize_t)i + 1);
+        T_EXPECT(strcmp(string_get_str(s), expt), 0);
+    }
+
+    clone = string_clone(s);
+    T_ERROR(clone == NULL);
+    T_EXPECT(string_cmp(s, clone), 0);
+    string_destroy(clone);
+
+    for (i = 200; i > 0; --i)
+    {
+        T_EXPECT(string_cut(s, 1), 0);
+        expt[i - 1] = '\0';
+        T_EXPECT(string_get_length(s), (ssize_t)i - 1);
+        T_EXPECT(strcmp(string_get_str(s), expt), 0);
+    }
+
+    string_destroy(s);
+
+    /* borders of inline buffer */
+    memset(expt, 'x', sizeof(expt));
+    for (i = 20; i < 140; ++i)
+    {
+        expt[i] = '\0';
+
+        s = string_create_from_str(expt);
+        T_ERROR(s == NULL);
+        T_EXPECT(string_get_length(s), (ssize_t)i);
+        T_EXPECT(strcmp(string_get_str(s), expt), 0);
+
+        clone = string_clone(s);
+        T_ERROR(clone == NULL);
+        T_EXPECT(string_insert_c(clone, 'y', 0), 0);
+        T_EXPECT(string_get_length(clone), (ssize_t)i + 1);
+        T_EXPECT(string_delete(clone, 0, 1), 0);
+        T_EXPECT(string_cmp(s, clone), 0);
+
+        string_destroy(clone);
+        string_destroy(s);
+
+        expt[i] = 'x';
+    }
+}
+
+test_f test_view(void)
+{
+    String *s;
+    String *temp;
+    String_view view;
+    String_view sub;
+    char *str = "Kukos Master C Kukos";
+    char c[] = {'z', 'K', 'k', 'C', ' '};
+    ssize_t expt_c_f[] = {-1, 0, 2, 13, 5};
+    ssize_t expt_c_l[] = {-1, 15, 17, 13, 14};
+    char *strr[] = {"kos", "er ", "Ala", "koss", "C"};
+    ssize_t expt_str_f[] = {2, 10, -1, -1, 13};
+    ssize_t expt_str_l[] = {17, 10, -1, -1, 13};
+    int i;
+
+    s = string_create_from_str(str);
+    T_ERROR(s == NULL);
+
+    view = string_get_view(s);
+    T_CHECK(view.str == string_get_str(s));
+    T_EXPECT(view.len, strlen(str));
+    T_EXPECT(string_cmp_view(s, string_view_from_str(str)), 0);
+
+    for (i = 0; i < ARRAY_SIZE(c); ++i)
+    {
+        T_EXPECT(string_view_find_c_first(view, c[i]), expt_c_f[i]);
+        T_EXPECT(string_view_find_c_last(view, c[i]), expt_c_l[i]);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(strr); ++i)
+    {
+        T_EXPECT(string_view_find_view_first(view, string_view_from_str(strr[i])), expt_str_f[i]);
+        T_EXPECT(string_view_find_view_last(view, string_view_from_str(strr[i])), expt_str_l[i]);
+        T_EXPECT(string_find_view_first(s, string_view_from_str(strr[i])), expt_str_f[i]);
+        T_EXPECT(string_find_view_last(s, string_view_from_str(strr[i])), expt_str_l[i]);
+    }
+
+    /* "Master" */
+    sub = string_substr_view(s, 6, 11);
+    T_CHECK(sub.str == string_get_str(s) + 6);
+    T_EXPECT(sub.len, 6);
+    T_EXPECT(string_view_cmp(sub, string_view_create("Master", 6)), 0);
+    T_CHECK(string_view_cmp(sub, string_view_create("Mast", 4)) > 0);
+    T_CHECK(string_view_cmp(sub, string_view_create("Mastes", 6)) < 0);
+    T_EXPECT(string_find_view_first_substr(s, string_view_create("Kukos", 5), 1, 19), 15);
+    T_EXPECT(string_find_view_last_substr(s, string_view_create("Kukos", 5), 0, 18), 0);
+
+    /* "ste" */
+    T_EXPECT(string_view_substr(sub, 2, 4).len, 3);
+    T_EXPECT(string_view_cmp(string_view_substr(sub, 2, 4), string_view_create("ste", 3)), 0);
+    T_CHECK(string_view_substr(sub, 2, 6).str == NULL);
+    T_CHECK(string_substr_view(s, 5, 20).str == NULL);
+    T_CHECK(string_view_is_empty(string_view_create(NULL, 0)));
+    T_CHECK(string_view_is_empty(string_view_create(str, 0)));
+    T_CHECK(!string_view_is_empty(sub));
+
+    temp = string_create_from_view(sub);
+    T_ERROR(temp == NULL);
+    T_EXPECT(strcmp(string_get_str(temp), "Master"), 0);
+    T_EXPECT(string_get_length(temp), 6);
+    string_destroy(temp);
+
+    string_destroy(s);
+}
+
+test_f test_tokenizer(void)
+{
+    String *s;
+    String_tokenizer tok;
+    String_view token;
+    char buf[256];
+    char *csv = "Kukos,,\"Master, C\",\"say \"\"hi\"\"\"x,";
+    char *expt_csv[] = {"Kukos", "", "Master, C", "say \"\"hi\"\"", ""};
+    ssize_t expt_csv_off[] = {0, 6, 8, 20, 33};
+    char *words = "  Kukos \t Master\tC  ";
+    char *expt_words[] = {"Kukos", "Master", "C"};
+    char *expt_str[] = {"a", "b", "", "c"};
+    ssize_t off;
+    size_t i;
+    size_t j;
+
+    s = string_create_from_str(csv);
+    T_ERROR(s == NULL);
+
+    T_EXPECT(string_tokenizer_init_c(&tok, string_get_view(s), ','), 0);
+    T_EXPECT(string_tokenizer_set_quote(&tok, '"'), 0);
+    for (i = 0; i < ARRAY_SIZE(expt_csv); ++i)
+    {
+        T_EXPECT(string_tokenizer_next(&tok, &token), expt_csv_off[i]);
+        T_EXPECT(token.len, strlen(expt_csv[i]));
+        T_EXPECT(string_view_cmp(token, string_view_from_str(expt_csv[i])), 0);
+        T_EXPECT(string_tokenizer_is_quoted(&tok), i == 2 || i == 3);
+    }
+    T_EXPECT(string_tokenizer_next(&tok, &token), -1);
+    T_EXPECT(string_tokenizer_next(&tok, &token), -1);
+
+    string_destroy(s);
+
+    /* char-set and skip of empty tokens */
+    T_EXPECT(string_tokenizer_init_set(&tok, string_view_from_str(words), " \t"), 0);
+    T_EXPECT(string_tokenizer_skip_empty(&tok, true), 0);
+    for (i = 0; i < ARRAY_SIZE(expt_words); ++i)
+    {
+        T_CHECK(string_tokenizer_next(&tok, &token) != -1);
+        T_EXPECT(string_view_cmp(token, string_view_from_str(expt_words[i])), 0);
+    }
+    T_EXPECT(string_tokenizer_next(&tok, &token), -1);
+
+    /* multi-char delimeter on raw, not terminated buffer */
+    memcpy(buf, "a::b::::c::XXXX", 15);
+    T_EXPECT(string_tokenizer_init_view(&tok, string_view_create(buf, 9), string_view_from_str("::")), 0);
+    for (i = 0; i < ARRAY_SIZE(expt_str); ++i)
+    {
+        T_CHECK(string_tokenizer_next(&tok, &token) != -1);
+        T_EXPECT(string_view_cmp(token, string_view_from_str(expt_str[i])), 0);
+    }
+    T_EXPECT(string_tokenizer_next(&tok, &token), -1);
+
+    /* long fields, delimeters crossing vector boundaries, big char-set */
+    for (i = 0; i < sizeof(buf); ++i)
+        buf[i] = i % 37 == 36 ? ';' : (i % 41 == 40 ? '|' : 'x');
+
+    T_EXPECT(string_tokenizer_init_set(&tok, string_view_create(buf, sizeof(buf)), ";|.-_"), 0);
+    i = 0;
+    while ((off = string_tokenizer_next(&tok, &token)) != -1)
+    {
+        T_EXPECT(off, (ssize_t)i);
+        for (j = 0; j < token.len; ++j)
+            T_EXPECT(token.str[j], 'x');
+
+        i += token.len + 1;
+        T_CHECK(i > sizeof(buf) || buf[i - 1] == ';' || buf[i - 1] == '|');
+    }
+    T_EXPECT(i, sizeof(buf) + 1);
+
+    /* empty text has no tokens */
+    T_EXPECT(string_tokenizer_init_c(&tok, string_view_create(buf, 0), ','), 0);
+    T_EXPECT(string_tokenizer_next(&tok, &token), -1);
+
+    T_CHECK(string_tokenizer_init_set(&tok, string_view_from_str(words), "") != 0);
+    T_CHECK(string_tokenizer_init_view(&tok, string_view_from_str(words), string_view_create(words, 0)) != 0);
+    T_CHECK(string_tokenizer_init_c(&tok, string_view_create(NULL, 0), ',') != 0);
+}
+
+test_f test_replace_all_big(void)
+{
+    String *s;
+    char *buf;
+    const size_t n = 1 << 20;
+    size_t i;
+
+    buf = (char *)malloc(n + 1);
+    T_ERROR(buf == NULL);
+
+    /* many matches: "ab" repeated */
+    for (i = 0; i < n; ++i)
+        buf[i] = ODD(i) ? 'b' : 'a';
+    buf[n] = '\0';
+
+    s = string_create_from_str(buf);
+    T_ERROR(s == NULL);
+
+    /* grow */
+    T_EXPECT(string_replace_str_by_str_all(s, "ab", "xyz"), 0);
+    T_EXPECT(string_get_length(s), (ssize_t)(n / 2 * 3));
+    for (i = 0; i < n / 2 * 3; i += 3)
+        T_ASSERT(strncmp(string_get_str(s) + i, "xyz", 3), 0);
+
+    /* shrink */
+    T_EXPECT(string_replace_str_by_c_all(s, "xyz", 'q'), 0);
+    T_EXPECT(string_get_length(s), (ssize_t)(n / 2));
+    T_EXPECT(string_find_c_first(s, 'x'), -1);
+
+    /* remove */
+    T_EXPECT(string_remove_c_all(s, 'q'), 0);
+    T_EXPECT(string_get_length(s), 0);
+
+    string_destroy(s);
+
+    /* no match */
+    s = string_create_from_str(buf);
+    T_ERROR(s == NULL);
+
+    T_EXPECT(string_replace_str_by_str_all(s, "ba ", "xyz"), 0);
+    T_EXPECT(string_remove_str_all(s, "aa"), 0);
+    T_EXPECT(string_replace_c_by_str_all(s, 'c', "xyz"), 0);
+    T_EXPECT(string_get_length(s), (ssize_t)n);
+    T_EXPECT(strcmp(string_get_str(s), buf), 0);
+
+    string_destroy(s);
+    FREE(buf);
+
+    /* replacement isn't searched again, matches don't overlap */
+    s = string_create_from_str("aaaaa");
+    T_ERROR(s == NULL);
+
+    T_EXPECT(string_replace_c_by_str_all(s, 'a', "ba"), 0);
+    T_EXPECT(strcmp(string_get_str(s), "bababababa"), 0);
+    T_EXPECT(string_replace_str_by_c_all(s, "aba", 'c'), 0);
+    T_EXPECT(strcmp(string_get_str(s), "bcbcba"), 0);
+    T_EXPECT(string_replace_str_by_str_all(s, "bc", "bcbc"), 0);
+    T_EXPECT(strcmp(string_get_str(s), "bcbcbcbcba"), 0);
+
+    string_destroy(s);
+}
+
+test_f test_replace_multi(void)
+{
+    String *s;
+    char *buf;
+    const char *patterns[] = {"he", "she", "his", "hers", "x"};
+    const char *replacements[] = {"HE", "", "HIS_HIS", "H", "x"};
+    const size_t n = 1 << 16;
+    size_t i;
+
+    s = string_create_from_str("ushers and his shed, he hers xx");
+    T_ERROR(s == NULL);
+
+    T_EXPECT(string_replace_multi_all(s, patterns, replacements, ARRAY_SIZE(patterns)), 0);
+    T_EXPECT(strcmp(string_get_str(s), "urs and HIS_HIS d, HE HErs xx"), 0);
+    T_EXPECT(string_get_length(s), strlen("urs and HIS_HIS d, HE HErs xx"));
+
+    /* nothing to replace */
+    T_EXPECT(string_replace_multi_all(s, patterns + 4, replacements + 4, 1), 0);
+    T_EXPECT(strcmp(string_get_str(s), "urs and HIS_HIS d, HE HErs xx"), 0);
+
+    T_CHECK(string_replace_multi_all(s, patterns, replacements, 0) != 0);
+    T_CHECK(string_replace_multi_all(s, replacements, patterns, 2) != 0);
+
+    string_destroy(s);
+
+    /* long string, many matches */
+    buf = (char *)malloc(n + 1);
+    T_ERROR(buf == NULL);
+
+    for (i = 0; i < n; ++i)
+        buf[i] = "hisa"[i % 4];
+    buf[n] = '\0';
+
+    s = string_create_from_str(buf);
+    T_ERROR(s == NULL);
+
+    T_EXPECT(string_replace_multi_all(s, patterns, replacements, ARRAY_SIZE(patterns)), 0);
+    T_EXPECT(string_get_length(s), (ssize_t)(n / 4 * 8));
+    for (i = 0; i < n / 4 * 8; i += 8)
+        T_ASSERT(strncmp(string_get_str(s) + i, "HIS_HISa", 8), 0);
+
+    string_destroy(s);
+    FREE(buf);
+}
+
 test_f test_clone(void)
 {
     String *s;
@@ -1737,6 +2105,12 @@ void test(void)
     TEST(test_find_substr_c());
     TEST(test_find_substr_str());
     TEST(test_find_substr_string());
+    TEST(test_find_long());
+    TEST(test_sso());
+    TEST(test_view());
+    TEST(test_tokenizer());
+    TEST(test_replace_all_big());
+    TEST(test_replace_multi());
     TEST(test_clone());
     TEST(test_cut());
     TEST(test_delete());
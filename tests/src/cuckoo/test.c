@@ -0,0 +1,184 @@
+#include <cuckoo.h>
+#include <test.h>
+#include <generic.h>
+#include <stdlib.h>
+
+test_f test_sizing(void)
+{
+    T_EXPECT(cuckoo_optimal_fingerprint_bits(0.0), 0);
+    T_EXPECT(cuckoo_optimal_fingerprint_bits(1.0), 0);
+    T_EXPECT(cuckoo_optimal_fingerprint_bits(0.5), 4);
+    T_EXPECT(cuckoo_optimal_fingerprint_bits(0.01), 10);
+    T_EXPECT(cuckoo_optimal_fingerprint_bits(0.000001), 16);
+
+    T_CHECK(cuckoo_filter_create(0, 8) == NULL);
+    T_CHECK(cuckoo_filter_create(100, 3) == NULL);
+    T_CHECK(cuckoo_filter_create(100, 17) == NULL);
+}
+
+test_f test_insert_contains(void)
+{
+    const size_t n = 10000;
+    const double fpr = 0.01;
+    size_t i;
+    size_t key;
+    size_t fp = 0;
+    Cuckoo_filter *filter = cuckoo_filter_create_for(n, fpr);
+    T_ERROR(filter == NULL);
+
+    for (i = 0; i < n; ++i)
+        T_EXPECT(cuckoo_filter_insert(filter, &i, sizeof(i)), 0);
+
+    T_EXPECT(cuckoo_filter_get_num_entries(filter), n);
+
+    for (i = 0; i < n; ++i)
+        T_CHECK(cuckoo_filter_contains(filter, &i, sizeof(i)));
+
+    for (i = 0; i < n * 10; ++i)
+    {
+        key = n + i;
+        fp += cuckoo_filter_contains(filter, &key, sizeof(key));
+    }
+
+    T_CHECK((double)fp / (double)(n * 10) < fpr);
+
+    cuckoo_filter_destroy(filter);
+}
+
+test_f test_delete(void)
+{
+    const size_t n = 5000;
+    size_t i;
+    Cuckoo_filter *filter = cuckoo_filter_create(n, 16);
+    T_ERROR(filter == NULL);
+
+    for (i = 0; i < n; ++i)
+        T_EXPECT(cuckoo_filter_insert(filter, &i, sizeof(i)), 0);
+
+    for (i = 0; i < n; i += 2)
+        T_EXPECT(cuckoo_filter_delete(filter, &i, sizeof(i)), 0);
+
+    T_EXPECT(cuckoo_filter_get_num_entries(filter), n / 2);
+
+    for (i = 1; i < n; i += 2)
+        T_CHECK(cuckoo_filter_contains(filter, &i, sizeof(i)));
+
+    for (i = 1; i < n; i += 2)
+        T_EXPECT(cuckoo_filter_delete(filter, &i, sizeof(i)), 0);
+
+    T_EXPECT(cuckoo_filter_get_num_entries(filter), 0);
+
+    cuckoo_filter_destroy(filter);
+}
+
+test_f test_full(void)
+{
+    size_t i;
+    size_t inserted = 0;
+    Cuckoo_filter *filter = cuckoo_filter_create(64, 12);
+    T_ERROR(filter == NULL);
+
+    for (i = 0; i < 1000; ++i)
+    {
+        if (cuckoo_filter_insert(filter, &i, sizeof(i)))
+            break;
+
+        ++inserted;
+    }
+
+    T_CHECK(inserted < 1000);
+    T_EXPECT(cuckoo_filter_get_num_entries(filter), inserted);
+
+    /* nothing is lost */
+    for (i = 0; i < inserted; ++i)
+        T_CHECK(cuckoo_filter_contains(filter, &i, sizeof(i)));
+
+    /* deletion makes space again */
+    i = 0;
+    T_EXPECT(cuckoo_filter_delete(filter, &i, sizeof(i)), 0);
+    i = 1;
+    T_EXPECT(cuckoo_filter_delete(filter, &i, sizeof(i)), 0);
+    i = 5000;
+    T_EXPECT(cuckoo_filter_insert(filter, &i, sizeof(i)), 0);
+
+    cuckoo_filter_destroy(filter);
+}
+
+test_f test_merge(void)
+{
+    const size_t n = 1000;
+    size_t i;
+    Cuckoo_filter *f1 = cuckoo_filter_create(n * 2, 12);
+    Cuckoo_filter *f2 = cuckoo_filter_create(n * 2, 12);
+    Cuckoo_filter *f3 = cuckoo_filter_create(n * 2, 8);
+    T_ERROR(f1 == NULL || f2 == NULL || f3 == NULL);
+
+    for (i = 0; i < n; ++i)
+        T_EXPECT(cuckoo_filter_insert(ODD(i) ? f1 : f2, &i, sizeof(i)), 0);
+
+    T_CHECK(cuckoo_filter_merge(f1, f3) != 0);
+    T_EXPECT(cuckoo_filter_merge(f1, f2), 0);
+    T_EXPECT(cuckoo_filter_get_num_entries(f1), n);
+
+    for (i = 0; i < n; ++i)
+        T_CHECK(cuckoo_filter_contains(f1, &i, sizeof(i)));
+
+    cuckoo_filter_destroy(f1);
+    cuckoo_filter_destroy(f2);
+    cuckoo_filter_destroy(f3);
+}
+
+test_f test_serialize(void)
+{
+    const size_t n = 1000;
+    size_t i;
+    ssize_t size;
+    BYTE *buf;
+    Cuckoo_filter *f1 = cuckoo_filter_create_for(n, 0.001);
+    Cuckoo_filter *f2;
+    T_ERROR(f1 == NULL);
+
+    for (i = 0; i < n; ++i)
+        T_EXPECT(cuckoo_filter_insert(f1, &i, sizeof(i)), 0);
+
+    size = cuckoo_filter_serialized_size(f1);
+    T_ERROR(size <= 0);
+    buf = (BYTE *)malloc((size_t)size + 1);
+    T_ERROR(buf == NULL);
+
+    T_EXPECT(cuckoo_filter_serialize(f1, buf + 1, (size_t)size - 1), -1);
+    T_EXPECT(cuckoo_filter_serialize(f1, buf + 1, (size_t)size), size);
+    T_CHECK(cuckoo_filter_deserialize(buf + 1, (size_t)size - 1) == NULL);
+
+    f2 = cuckoo_filter_deserialize(buf + 1, (size_t)size);
+    T_ERROR(f2 == NULL);
+    T_EXPECT(cuckoo_filter_get_num_entries(f2), n);
+    for (i = 0; i < n; ++i)
+        T_CHECK(cuckoo_filter_contains(f2, &i, sizeof(i)));
+
+    /* deserialized filter is fully functional */
+    for (i = 0; i < n; ++i)
+        T_EXPECT(cuckoo_filter_delete(f2, &i, sizeof(i)), 0);
+    T_EXPECT(cuckoo_filter_get_num_entries(f2), 0);
+
+    FREE(buf);
+    cuckoo_filter_destroy(f1);
+    cuckoo_filter_destroy(f2);
+}
+
+void test(void)
+{
+    TEST(test_sizing());
+    TEST(test_insert_contains());
+    TEST(test_delete());
+    TEST(test_full());
+    TEST(test_merge());
+    TEST(test_serialize());
+}
+
+int main(void)
+{
+    TEST_INIT("CUCKOO");
+    test();
+    TEST_SUMMARY();
+}
@@ -1577,6 +1577,44 @@ test_f test_search_first(void)
     darray_destroy(da);
 }
 
+test_f test_search_batch(void)
+{
+    Darray *da;
+
+    int t[] = {2, 2, 4, 3, 2, 6, 4, 1, 9, 2, 5, 3};
+    int s[] = {2, 4, 0, 6, 9, 2, 10, 1, 3, 5, 7, 1, 9, 8, 6, 4, 3, 2, 1, 0};
+    ssize_t pos[ARRAY_SIZE(s)];
+    ssize_t num_found;
+
+    int i;
+    int j;
+
+    for (j = 0; j < 2; ++j)
+    {
+        da = darray_create(j == 0 ? DARRAY_UNSORTED : DARRAY_SORTED, 0, sizeof(int), cmp_int, NULL);
+        T_ERROR(da == NULL);
+
+        T_EXPECT(darray_search_batch(da, (void *)s, ARRAY_SIZE(s), pos), -1);
+
+        for (i = 0; i < ARRAY_SIZE(t); ++i)
+            T_EXPECT(darray_insert(da, (void *)&t[i]), 0);
+
+        /* the same as darray_search_first one by one */
+        num_found = 0;
+        for (i = 0; i < ARRAY_SIZE(s); ++i)
+            num_found += darray_search_first(da, (void *)&s[i], NULL) != -1;
+
+        T_EXPECT(darray_search_batch(da, (void *)s, ARRAY_SIZE(s), pos), num_found);
+        for (i = 0; i < ARRAY_SIZE(s); ++i)
+            T_EXPECT(pos[i], darray_search_first(da, (void *)&s[i], NULL));
+
+        T_EXPECT(darray_search_batch(da, (void *)s, 0, pos), -1);
+        T_EXPECT(darray_search_batch(da, (void *)s, ARRAY_SIZE(s), NULL), -1);
+
+        darray_destroy(da);
+    }
+}
+
 test_f test_search_last(void)
 {
     Darray *da;
@@ -2142,6 +2180,7 @@ void test(void)
     TEST(test_sort());
     TEST(test_search_first());
     TEST(test_search_last());
+    TEST(test_search_batch());
     TEST(test_min());
     TEST(test_max());
     TEST(test_for_each());
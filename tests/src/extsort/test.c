@@ -0,0 +1,267 @@
+#include <extsort.h>
+#include <test.h>
+#include <common.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#define RECORD_PAYLOAD 92
+
+/* 100 bytes, window of run is not multiple of page size */
+typedef struct Record
+{
+    int         key;
+    uint32_t    id;
+    char        payload[RECORD_PAYLOAD];
+} Record;
+
+CMP(int)
+
+static int cmp_record(const void *a, const void *b)
+{
+    if (((const Record *)a)->key < ((const Record *)b)->key)
+        return -1;
+
+    if (((const Record *)a)->key > ((const Record *)b)->key)
+        return 1;
+
+    return 0;
+}
+
+static void tmp_path(char *path, size_t size, const char *name)
+{
+    (void)snprintf(path, size, "/tmp/extsort_test_%d_%s", (int)getpid(), name);
+}
+
+static void write_file(const char *path, const void *data, size_t size)
+{
+    FILE *file;
+
+    file = fopen(path, "w");
+    T_ERROR(file == NULL);
+
+    if (size > 0)
+        T_EXPECT(fwrite(data, 1, size, file), size);
+
+    fclose(file);
+}
+
+static void read_file(const char *path, void **data, size_t *size)
+{
+    struct stat st;
+    FILE *file;
+
+    T_ERROR(stat(path, &st) == -1);
+    *size = (size_t)st.st_size;
+
+    *data = malloc(*size + 1);
+    T_ERROR(*data == NULL);
+
+    file = fopen(path, "r");
+    T_ERROR(file == NULL);
+
+    if (*size > 0)
+        T_EXPECT(fread(*data, 1, *size, file), *size);
+
+    fclose(file);
+}
+
+/* output is sorted permutation of input */
+static void check_records(const Record *in, const Record *out, size_t n)
+{
+    bool *seen;
+    size_t i;
+
+    seen = (bool *)calloc(n, sizeof(bool));
+    T_ERROR(seen == NULL);
+
+    for (i = 0; i < n; ++i)
+    {
+        if (i > 0)
+            T_CHECK(out[i - 1].key <= out[i].key);
+
+        T_ERROR(out[i].id >= n);
+        T_EXPECT(seen[out[i].id], false);
+        seen[out[i].id] = true;
+
+        T_EXPECT(out[i].key, in[out[i].id].key);
+        T_EXPECT(memcmp(out[i].payload, in[out[i].id].payload, sizeof(out[i].payload)), 0);
+    }
+
+    FREE(seen);
+}
+
+static void test_records(size_t n, size_t memory, size_t threads, bool in_place, size_t min_runs, size_t min_passes)
+{
+    const Extsort_conf conf = { .memory = memory, .threads = threads, .tmp_dir = NULL };
+    Extsort_stats stats;
+    char in_path[128];
+    char out_path[128];
+    Record *in;
+    Record *out;
+    size_t size;
+    size_t i;
+
+    tmp_path(in_path, sizeof(in_path), "in");
+    tmp_path(out_path, sizeof(out_path), in_place ? "in" : "out");
+
+    in = (Record *)malloc(n * sizeof(Record));
+    T_ERROR(in == NULL);
+
+    for (i = 0; i < n; ++i)
+    {
+        in[i].key = rand() % (int)(n / 2 + 1) - (int)(n / 4);
+        in[i].id = (uint32_t)i;
+        (void)memset(in[i].payload, (int)(i % 251), sizeof(in[i].payload));
+    }
+
+    write_file(in_path, in, n * sizeof(Record));
+
+    T_EXPECT(extsort_file(in_path, out_path, sizeof(Record), cmp_record, &conf, &stats), 0);
+    T_EXPECT(stats.records, n);
+    T_CHECK(stats.runs >= min_runs);
+    T_CHECK(stats.merge_passes >= min_passes);
+
+    read_file(out_path, (void **)&out, &size);
+    T_EXPECT(size, n * sizeof(Record));
+    check_records(in, out, n);
+
+    (void)unlink(in_path);
+    (void)unlink(out_path);
+
+    FREE(in);
+    FREE(out);
+}
+
+test_f test_in_memory(void)
+{
+    /* one run, parts merged straight to output */
+    test_records(10000, BIT(24), 1, false, 1, 0);
+    test_records(10000, BIT(24), 4, false, 1, 0);
+}
+
+test_f test_runs(void)
+{
+    /* 64KB of memory: ~15 runs, 2 runs per merge, many passes */
+    test_records(10000, EXTSORT_MIN_MEMORY, 1, false, 10, 3);
+    test_records(10000, EXTSORT_MIN_MEMORY, 4, false, 10, 3);
+}
+
+test_f test_in_place(void)
+{
+    test_records(10000, EXTSORT_MIN_MEMORY, 2, true, 10, 3);
+    test_records(100, BIT(24), 2, true, 1, 0);
+}
+
+test_f test_ints(void)
+{
+    const Extsort_conf conf = { .memory = EXTSORT_MIN_MEMORY, .threads = 2, .tmp_dir = "/tmp" };
+    const size_t n = BIT(16) + 7;
+    Extsort_stats stats;
+    char in_path[128];
+    char out_path[128];
+    int *in;
+    int *out;
+    size_t size;
+    size_t i;
+
+    tmp_path(in_path, sizeof(in_path), "ints_in");
+    tmp_path(out_path, sizeof(out_path), "ints_out");
+
+    in = (int *)malloc(n * sizeof(int));
+    T_ERROR(in == NULL);
+
+    for (i = 0; i < n; ++i)
+        in[i] = rand();
+
+    write_file(in_path, in, n * sizeof(int));
+
+    /* 4 bytes records: window is page, many runs merged at once */
+    T_EXPECT(extsort_file(in_path, out_path, sizeof(int), cmp_int, &conf, &stats), 0);
+    T_EXPECT(stats.records, n);
+    T_CHECK(stats.runs > 1);
+    T_EXPECT(stats.merge_passes, 1);
+
+    read_file(out_path, (void **)&out, &size);
+    T_EXPECT(size, n * sizeof(int));
+
+    qsort(in, n, sizeof(int), cmp_int);
+    T_EXPECT(memcmp(in, out, size), 0);
+
+    (void)unlink(in_path);
+    (void)unlink(out_path);
+
+    FREE(in);
+    FREE(out);
+}
+
+test_f test_empty(void)
+{
+    Extsort_stats stats;
+    char in_path[128];
+    char out_path[128];
+    void *out;
+    size_t size;
+
+    tmp_path(in_path, sizeof(in_path), "empty_in");
+    tmp_path(out_path, sizeof(out_path), "empty_out");
+
+    write_file(in_path, NULL, 0);
+    write_file(out_path, "old", 3);
+
+    T_EXPECT(extsort_file(in_path, out_path, sizeof(int), cmp_int, NULL, &stats), 0);
+    T_EXPECT(stats.records, 0);
+
+    read_file(out_path, &out, &size);
+    T_EXPECT(size, 0);
+
+    (void)unlink(in_path);
+    (void)unlink(out_path);
+
+    FREE(out);
+}
+
+test_f test_invalid(void)
+{
+    char in_path[128];
+    char out_path[128];
+
+    tmp_path(in_path, sizeof(in_path), "invalid_in");
+    tmp_path(out_path, sizeof(out_path), "invalid_out");
+
+    /* 5 bytes is not a multiple of int */
+    write_file(in_path, "Kukos", 5);
+
+    T_CHECK(extsort_file(in_path, out_path, sizeof(int), cmp_int, NULL, NULL) != 0);
+    T_CHECK(extsort_file(NULL, out_path, sizeof(int), cmp_int, NULL, NULL) != 0);
+    T_CHECK(extsort_file(in_path, NULL, sizeof(int), cmp_int, NULL, NULL) != 0);
+    T_CHECK(extsort_file(in_path, out_path, sizeof(int), NULL, NULL, NULL) != 0);
+    T_CHECK(extsort_file(in_path, out_path, 0, cmp_int, NULL, NULL) != 0);
+    T_CHECK(extsort_file("/nonexistent/extsort", out_path, sizeof(int), cmp_int, NULL, NULL) != 0);
+
+    (void)unlink(in_path);
+    (void)unlink(out_path);
+}
+
+void test(void)
+{
+    TEST(test_in_memory());
+    TEST(test_runs());
+    TEST(test_in_place());
+    TEST(test_ints());
+    TEST(test_empty());
+    TEST(test_invalid());
+}
+
+int main(void)
+{
+    TEST_INIT("EXTSORT");
+    srand((unsigned)time(NULL));
+    test();
+    TEST_SUMMARY();
+}
@@ -7,6 +7,7 @@
 #include <time.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/socket.h>
 
 /* 1MB buffer */
 #define BUFFER_SIZE BIT(20)
@@ -986,6 +987,364 @@ test_f test_incorrect_type_64mode(void)
     FREE(path1);
 }
 
+test_f test_appender_binary(void)
+{
+    char *path1;
+    int fd1;
+    struct stat st;
+    size_t i;
+    size_t val;
+
+    File_appender *fa;
+
+    /* small extent to test growing */
+    const size_t extent = 4096;
+    const size_t records = 10000;
+
+    T_ERROR(asprintf(&path1, "%s/%s", test_dir, __func__) == -1);
+
+    fa = file_appender_create_from_path(path1, O_RDWR | O_CREAT | O_TRUNC, extent);
+    T_ERROR(fa == NULL);
+
+    T_EXPECT(file_appender_get_size(fa), 0);
+
+    /* records with zero bytes inside */
+    for (i = 0; i < records; ++i)
+        T_EXPECT(file_appender_append(fa, &i, sizeof(i)), 0);
+
+    T_EXPECT(file_appender_get_size(fa), records * sizeof(i));
+
+    /* preallocated, bigger than written data */
+    T_ERROR(stat(path1, &st) == -1);
+    T_CHECK((size_t)st.st_size >= records * sizeof(i));
+    T_EXPECT((size_t)st.st_size % extent, 0);
+
+    for (i = 0; i < records; ++i)
+    {
+        memcpy(&val, file_appender_get_buff(fa) + i * sizeof(i), sizeof(val));
+        T_ASSERT(val, i);
+    }
+
+    T_CHECK(file_appender_append(fa, &i, 0) != 0);
+    T_CHECK(file_appender_append(fa, NULL, 1) != 0);
+
+    T_EXPECT(file_appender_destroy(fa), 0);
+
+    /* truncated to written size */
+    T_ERROR(stat(path1, &st) == -1);
+    T_EXPECT((size_t)st.st_size, records * sizeof(i));
+
+    fd1 = open(path1, O_RDONLY);
+    T_ERROR(fd1 == -1);
+
+    for (i = 0; i < records; ++i)
+    {
+        T_ERROR(read(fd1, &val, sizeof(val)) != sizeof(val));
+        T_ASSERT(val, i);
+    }
+
+    close(fd1);
+
+    T_ERROR(remove(path1) == -1);
+
+    FREE(path1);
+}
+
+test_f test_appender_existing_file(void)
+{
+    char *path1;
+    char *path2;
+    int fd1;
+    int fd2;
+
+    File_appender *fa;
+
+    const size_t file_size = BIT(20) + 17;
+    const char *data = "Kukos appender";
+
+    T_ERROR(asprintf(&path1, "%s/%s", test_dir, __func__) == -1);
+    T_ERROR(creat(path1, 0644) == -1);
+
+    fd1 = open(path1, O_RDWR);
+    T_ERROR(fd1 == -1);
+
+    T_ERROR(write_to_file(fd1, file_size, 0));
+
+    T_ERROR(asprintf(&path2, "%s/%s2", test_dir, __func__) == -1);
+    T_ERROR(creat(path2, 0644) == -1);
+
+    fd2 = open(path2, O_RDWR);
+    T_ERROR(fd2 == -1);
+
+    T_ERROR(file_copy(fd1, fd2));
+
+    T_ERROR(lseek(fd2, (off_t)file_size, SEEK_SET) == -1);
+    T_ERROR(write(fd2, data, strlen(data)) == -1);
+    T_ERROR(write(fd2, data, strlen(data)) == -1);
+
+    /* new data after existing content */
+    fa = file_appender_create(fd1, 0);
+    T_ERROR(fa == NULL);
+
+    T_EXPECT(file_appender_get_size(fa), file_size);
+    T_EXPECT(file_appender_append(fa, data, strlen(data)), 0);
+
+    /* zero copy */
+    T_ERROR(file_appender_reserve(fa, 0) != NULL);
+    memcpy(file_appender_reserve(fa, strlen(data)), data, strlen(data));
+
+    T_EXPECT(file_appender_get_size(fa), file_size + 2 * strlen(data));
+    T_EXPECT(file_appender_destroy(fa), 0);
+
+    T_EXPECT(file_cmp(fd1, fd2), 0);
+
+    close(fd1);
+    close(fd2);
+
+    T_ERROR(remove(path1) == -1);
+    T_ERROR(remove(path2) == -1);
+
+    FREE(path1);
+    FREE(path2);
+}
+
+test_f test_appender_sync(void)
+{
+    char *path1;
+    char record[100];
+    struct stat st;
+    size_t i;
+
+    File_appender *fa;
+
+    T_ERROR(asprintf(&path1, "%s/%s", test_dir, __func__) == -1);
+
+    fa = file_appender_create_from_path(path1, O_RDWR | O_CREAT | O_TRUNC, BIT(16));
+    T_ERROR(fa == NULL);
+
+    T_EXPECT(file_appender_set_sync(fa, BIT(12)), 0);
+
+    for (i = 0; i < sizeof(record); ++i)
+        record[i] = (char)('A' + i % ('Z' - 'A' + 1));
+
+    for (i = 0; i < 10000; ++i)
+        T_EXPECT(file_appender_append(fa, record, sizeof(record)), 0);
+
+    T_EXPECT(file_appender_synch(fa), 0);
+    T_EXPECT(memcmp(file_appender_get_buff(fa) + 9999 * sizeof(record), record, sizeof(record)), 0);
+    T_EXPECT(file_appender_destroy(fa), 0);
+
+    T_ERROR(stat(path1, &st) == -1);
+    T_EXPECT((size_t)st.st_size, 10000 * sizeof(record));
+
+    T_ERROR(remove(path1) == -1);
+
+    FREE(path1);
+}
+
+test_f test_window_read(void)
+{
+    char *path1;
+    char *buf;
+    int fd1;
+    size_t i;
+    size_t len;
+    size_t offset;
+    const char *data;
+    char small[1000];
+
+    File_window *fw;
+
+    /* 1MB + something, windows are 64KB, only 4 can be mapped */
+    const size_t file_size = BIT(20) + 123;
+    const size_t window_size = BIT(16);
+
+    T_ERROR(asprintf(&path1, "%s/%s", test_dir, __func__) == -1);
+    T_ERROR(creat(path1, 0644) == -1);
+
+    fd1 = open(path1, O_RDWR);
+    T_ERROR(fd1 == -1);
+
+    T_ERROR(write_to_file(fd1, file_size, 0));
+
+    buf = (char *)malloc(file_size);
+    T_ERROR(buf == NULL);
+    T_ERROR(pread(fd1, buf, file_size, 0) != (ssize_t)file_size);
+
+    fw = file_window_create(fd1, PROT_READ, 0, window_size, 4);
+    T_ERROR(fw == NULL);
+
+    T_EXPECT(file_window_get_size(fw), file_size);
+    T_EXPECT(file_window_get_num_mapped(fw), 0);
+
+    /* random access */
+    for (i = 0; i < 1000; ++i)
+    {
+        offset = (size_t)rand() % file_size;
+        data = (const char *)file_window_get(fw, offset, &len);
+        T_ERROR(data == NULL);
+        T_CHECK(len > 0 && len <= window_size);
+        T_CHECK(offset + len == file_size || (offset + len) % window_size == 0);
+        T_ASSERT(*data, buf[offset]);
+        T_CHECK(file_window_get_num_mapped(fw) <= 4);
+    }
+
+    T_EXPECT(file_window_get_num_mapped(fw), 4);
+    T_CHECK(file_window_get(fw, file_size, &len) == NULL);
+
+    /* read across windows */
+    T_EXPECT(file_window_read(fw, window_size - 500, small, sizeof(small)), sizeof(small));
+    T_EXPECT(memcmp(small, buf + window_size - 500, sizeof(small)), 0);
+
+    T_EXPECT(file_window_read(fw, file_size - 100, small, sizeof(small)), 100);
+    T_EXPECT(memcmp(small, buf + file_size - 100, 100), 0);
+
+    T_EXPECT(file_window_advise(fw, 0, file_size, MADV_DONTNEED), 0);
+    T_EXPECT(file_window_advise(fw, 0, file_size, MADV_WILLNEED), 0);
+    T_EXPECT(file_window_set_advice(fw, MADV_RANDOM), 0);
+    T_CHECK(file_window_set_advice(fw, MADV_WILLNEED) != 0);
+
+    T_EXPECT(file_window_destroy(fw), 0);
+
+    close(fd1);
+
+    T_ERROR(remove(path1) == -1);
+
+    FREE(buf);
+    FREE(path1);
+}
+
+test_f test_window_cursor(void)
+{
+    char *path1;
+    char *buf;
+    int fd1;
+    ssize_t len;
+    size_t offset;
+    const void *data;
+    char small[333];
+
+    File_window *fw;
+    File_window_cursor cursor;
+
+    const size_t file_size = BIT(20) * 3 + 7;
+    const size_t window_size = BIT(18);
+
+    T_ERROR(asprintf(&path1, "%s/%s", test_dir, __func__) == -1);
+    T_ERROR(creat(path1, 0644) == -1);
+
+    fd1 = open(path1, O_RDWR);
+    T_ERROR(fd1 == -1);
+
+    T_ERROR(write_to_file(fd1, file_size, 0));
+
+    buf = (char *)malloc(file_size);
+    T_ERROR(buf == NULL);
+    T_ERROR(pread(fd1, buf, file_size, 0) != (ssize_t)file_size);
+
+    fw = file_window_create_from_path(path1, PROT_READ, O_RDONLY, MAP_POPULATE, window_size, 2);
+    T_ERROR(fw == NULL);
+
+    T_EXPECT(file_window_set_advice(fw, MADV_SEQUENTIAL), 0);
+
+    /* whole file by chunks */
+    T_EXPECT(file_window_cursor_init(fw, &cursor, 0), 0);
+
+    offset = 0;
+    while ((len = file_window_cursor_next(&cursor, &data)) > 0)
+    {
+        T_EXPECT(memcmp(data, buf + offset, (size_t)len), 0);
+        offset += (size_t)len;
+        T_EXPECT(file_window_cursor_get_offset(&cursor), offset);
+        T_CHECK(file_window_get_num_mapped(fw) <= 2);
+    }
+
+    T_EXPECT(len, 0);
+    T_EXPECT(offset, file_size);
+
+    /* whole file by small reads, from the middle of window */
+    T_EXPECT(file_window_cursor_init(fw, &cursor, 100), 0);
+
+    offset = 100;
+    while ((len = file_window_cursor_read(&cursor, small, sizeof(small))) > 0)
+    {
+        T_EXPECT(memcmp(small, buf + offset, (size_t)len), 0);
+        offset += (size_t)len;
+    }
+
+    T_EXPECT(offset, file_size);
+
+    T_EXPECT(file_window_destroy(fw), 0);
+
+    close(fd1);
+
+    T_ERROR(remove(path1) == -1);
+
+    FREE(buf);
+    FREE(path1);
+}
+test_f test_send(void)
+{
+    char *path1;
+    char *buf;
+    int fd1;
+    int sv[2];
+    char recv_buf[BIT(15)];
+    ssize_t n;
+    size_t received;
+
+    File_buffer *fb;
+
+    const size_t file_size = BUFFER_SIZE;
+    const size_t offset = 10;
+
+    T_ERROR(asprintf(&path1, "%s/%s", test_dir, __func__) == -1);
+    T_ERROR(creat(path1, 0644) == -1);
+
+    fd1 = open(path1, O_RDWR);
+    T_ERROR(fd1 == -1);
+    T_ERROR(write_to_file(fd1, file_size, 0));
+
+    fb = file_buffer_create(fd1, PROT_READ | PROT_WRITE);
+    T_ERROR(fb == NULL);
+
+    /* not synched change is visible by sendfile */
+    buf = file_buffer_get_buff(fb);
+    buf[offset] = (char)(buf[offset] + 1);
+
+    T_ERROR(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == -1);
+
+    /* less than socket buffer, so it doesn't block */
+    T_EXPECT(file_buffer_send(fb, sv[0], offset, sizeof(recv_buf)), sizeof(recv_buf));
+
+    received = 0;
+    while (received < sizeof(recv_buf))
+    {
+        n = read(sv[1], recv_buf + received, sizeof(recv_buf) - received);
+        T_ERROR(n <= 0);
+        received += (size_t)n;
+    }
+
+    T_EXPECT(memcmp(recv_buf, buf + offset, sizeof(recv_buf)), 0);
+
+    /* count is trimmed to end of file */
+    T_EXPECT(file_buffer_send(fb, sv[0], file_size - 5, sizeof(recv_buf)), 5);
+    T_EXPECT(read(sv[1], recv_buf, sizeof(recv_buf)), 5);
+    T_EXPECT(memcmp(recv_buf, buf + file_size - 5, 5), 0);
+
+    T_EXPECT(file_buffer_send(fb, sv[0], file_size + 1, 1), -1);
+    T_EXPECT(file_buffer_send(NULL, sv[0], 0, 1), -1);
+
+    close(sv[0]);
+    close(sv[1]);
+
+    file_buffer_destroy(fb);
+    close(fd1);
+
+    T_ERROR(remove(path1) == -1);
+    FREE(path1);
+}
+
 void test(void)
 {
     TEST(test_create_from_fd());
@@ -995,6 +1354,7 @@ void test(void)
     TEST(test_read_write());
     TEST(test_work_on_big_file());
     TEST(test_incorrect_type());
+    TEST(test_send());
 
     TEST(test_create_from_fd_64mode());
     TEST(test_create_from_path_64mode());
@@ -1003,6 +1363,13 @@ void test(void)
     TEST(test_read_write_64mode());
     TEST(test_work_on_big_file_64mode());
     TEST(test_incorrect_type_64mode());
+
+    TEST(test_appender_binary());
+    TEST(test_appender_existing_file());
+    TEST(test_appender_sync());
+
+    TEST(test_window_read());
+    TEST(test_window_cursor());
 }
 int main(void)
 {
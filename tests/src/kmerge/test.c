@@ -0,0 +1,298 @@
+#include <kmerge.h>
+#include <test.h>
+#include <common.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+
+#define MAX_K 64
+
+typedef struct Item
+{
+    int key;
+    int src;    /* source array */
+    int pos;    /* position in source array */
+} Item;
+
+CMP(int)
+CMP(long)
+
+static int cmp_item(const void *a, const void *b)
+{
+    if (((const Item *)a)->key < ((const Item *)b)->key)
+        return -1;
+
+    if (((const Item *)a)->key > ((const Item *)b)->key)
+        return 1;
+
+    return 0;
+}
+
+/* k sorted arrays of items, sizes are random (empty arrays too), keys have many duplicates */
+static void create_arrays(Item **arrays, size_t *num_elements, size_t k, size_t max_n)
+{
+    size_t i;
+    size_t j;
+
+    for (i = 0; i < k; ++i)
+    {
+        num_elements[i] = (size_t)rand() % (max_n + 1);
+        if (i == 0)
+            num_elements[i] = 0;
+
+        arrays[i] = (Item *)malloc((num_elements[i] + 1) * sizeof(Item));
+        T_ERROR(arrays[i] == NULL);
+
+        for (j = 0; j < num_elements[i]; ++j)
+        {
+            arrays[i][j].key = rand() % 100;
+            arrays[i][j].src = (int)i;
+        }
+
+        qsort(arrays[i], num_elements[i], sizeof(Item), cmp_item);
+        for (j = 0; j < num_elements[i]; ++j)
+            arrays[i][j].pos = (int)j;
+    }
+}
+
+static void test_kmerge_k(size_t k, size_t max_n)
+{
+    Item *arrays[MAX_K];
+    size_t num_elements[MAX_K];
+    Item *out;
+    size_t total = 0;
+    size_t i;
+
+    create_arrays(arrays, num_elements, k, max_n);
+    for (i = 0; i < k; ++i)
+        total += num_elements[i];
+
+    out = (Item *)malloc((total + 1) * sizeof(Item));
+    T_ERROR(out == NULL);
+
+    T_EXPECT(kmerge(out, (const void * const *)arrays, num_elements, k, cmp_item, sizeof(Item)), 0);
+
+    /* sorted and stable: equal keys are ordered by source, then by position in source */
+    for (i = 1; i < total; ++i)
+    {
+        T_CHECK(out[i - 1].key <= out[i].key);
+        if (out[i - 1].key == out[i].key)
+            T_CHECK(out[i - 1].src < out[i].src || (out[i - 1].src == out[i].src && out[i - 1].pos < out[i].pos));
+    }
+
+    for (i = 0; i < total; ++i)
+        T_EXPECT(arrays[out[i].src][out[i].pos].key, out[i].key);
+
+    for (i = 0; i < k; ++i)
+        FREE(arrays[i]);
+
+    FREE(out);
+}
+
+test_f test_kmerge(void)
+{
+    test_kmerge_k(1, 100);
+    test_kmerge_k(2, 100);
+    test_kmerge_k(7, 1000);
+    test_kmerge_k(64, 1000);
+    test_kmerge_k(64, 1);
+}
+
+test_f test_loser_tree(void)
+{
+    Item *arrays[MAX_K];
+    size_t num_elements[MAX_K];
+    size_t pos[MAX_K] = {0};
+    const void *heads[MAX_K];
+    const size_t k = 13;
+    Loser_tree *lt;
+    const Item *top;
+    const Item *prev = NULL;
+    ssize_t w;
+    size_t total = 0;
+    size_t count = 0;
+    size_t i;
+
+    create_arrays(arrays, num_elements, k, 500);
+    for (i = 0; i < k; ++i)
+    {
+        total += num_elements[i];
+        heads[i] = num_elements[i] > 0 ? (const void *)arrays[i] : NULL;
+    }
+
+    lt = loser_tree_create(k, cmp_item);
+    T_ERROR(lt == NULL);
+
+    T_EXPECT(loser_tree_init(lt, heads), 0);
+    while ((w = loser_tree_get_winner(lt)) != -1)
+    {
+        top = (const Item *)loser_tree_get_top(lt);
+        T_ERROR(top == NULL);
+        T_EXPECT(top, &arrays[w][pos[w]]);
+
+        if (prev != NULL)
+            T_CHECK(prev->key < top->key || (prev->key == top->key && prev->src <= top->src));
+
+        prev = top;
+        ++count;
+
+        ++pos[w];
+        T_EXPECT(loser_tree_replay(lt, pos[w] < num_elements[w] ? (const void *)&arrays[w][pos[w]] : NULL), 0);
+    }
+
+    T_EXPECT(count, total);
+    T_EXPECT(loser_tree_get_top(lt), NULL);
+
+    /* tree can be reused */
+    for (i = 0; i < k; ++i)
+        heads[i] = NULL;
+
+    heads[k - 1] = (const void *)&arrays[k - 1][0];
+    T_EXPECT(loser_tree_init(lt, heads), 0);
+    T_EXPECT(loser_tree_get_winner(lt), num_elements[k - 1] > 0 ? (ssize_t)(k - 1) : -1);
+
+    loser_tree_destroy(lt);
+
+    for (i = 0; i < k; ++i)
+        FREE(arrays[i]);
+}
+
+test_f test_kmerge_int(void)
+{
+    const size_t k = 9;
+    int *arrays[9];
+    size_t num_elements[9];
+    int *out;
+    int *expected;
+    size_t total = 0;
+    size_t i;
+    size_t j;
+
+    for (i = 0; i < k; ++i)
+    {
+        num_elements[i] = i == 3 ? 0 : (size_t)rand() % 1000 + 1;
+        arrays[i] = (int *)malloc(num_elements[i] * sizeof(int) + 1);
+        T_ERROR(arrays[i] == NULL);
+
+        for (j = 0; j < num_elements[i]; ++j)
+            arrays[i][j] = rand() - RAND_MAX / 2;
+
+        /* extremes can not be mistaken for empty source */
+        if (num_elements[i] > 2)
+        {
+            arrays[i][0] = INT_MIN;
+            arrays[i][1] = INT_MAX;
+        }
+
+        qsort(arrays[i], num_elements[i], sizeof(int), cmp_int);
+        total += num_elements[i];
+    }
+
+    out = (int *)malloc(total * sizeof(int));
+    T_ERROR(out == NULL);
+
+    expected = (int *)malloc(total * sizeof(int));
+    T_ERROR(expected == NULL);
+
+    for (i = 0, total = 0; i < k; ++i)
+    {
+        if (num_elements[i] > 0)
+            (void)memcpy(expected + total, arrays[i], num_elements[i] * sizeof(int));
+
+        total += num_elements[i];
+    }
+
+    qsort(expected, total, sizeof(int), cmp_int);
+
+    T_EXPECT(kmerge_int(out, (const int * const *)arrays, num_elements, k), 0);
+    T_EXPECT(memcmp(out, expected, total * sizeof(int)), 0);
+
+    for (i = 0; i < k; ++i)
+        FREE(arrays[i]);
+
+    FREE(out);
+    FREE(expected);
+}
+
+test_f test_kmerge_typed(void)
+{
+    const unsigned int ua[] = {0, 5, UINT_MAX};
+    const unsigned int ub[] = {1, 5, 6, UINT_MAX};
+    const unsigned int *uarrays[] = {ua, ub};
+    const size_t unum[] = {ARRAY_SIZE(ua), ARRAY_SIZE(ub)};
+    const unsigned int uexpected[] = {0, 1, 5, 5, 6, UINT_MAX, UINT_MAX};
+    unsigned int uout[ARRAY_SIZE(uexpected)];
+
+    const long la[] = {LONG_MIN, -3, 7};
+    const long lb[] = {-4};
+    const long lc[] = {0};
+    const long *larrays[] = {la, lb, lc};
+    const size_t lnum[] = {ARRAY_SIZE(la), ARRAY_SIZE(lb), 0};
+    const long lexpected[] = {LONG_MIN, -4, -3, 7};
+    long lout[ARRAY_SIZE(lexpected)];
+
+    const unsigned long ula[] = {ULONG_MAX};
+    const unsigned long ulb[] = {0, 1, ULONG_MAX};
+    const unsigned long *ularrays[] = {ula, ulb};
+    const size_t ulnum[] = {ARRAY_SIZE(ula), ARRAY_SIZE(ulb)};
+    const unsigned long ulexpected[] = {0, 1, ULONG_MAX, ULONG_MAX};
+    unsigned long ulout[ARRAY_SIZE(ulexpected)];
+
+    T_EXPECT(kmerge_uint(uout, uarrays, unum, ARRAY_SIZE(uarrays)), 0);
+    T_EXPECT(memcmp(uout, uexpected, sizeof(uexpected)), 0);
+
+    T_EXPECT(kmerge_long(lout, larrays, lnum, ARRAY_SIZE(larrays)), 0);
+    T_EXPECT(memcmp(lout, lexpected, sizeof(lexpected)), 0);
+
+    T_EXPECT(kmerge_ulong(ulout, ularrays, ulnum, ARRAY_SIZE(ularrays)), 0);
+    T_EXPECT(memcmp(ulout, ulexpected, sizeof(ulexpected)), 0);
+
+    /* typed and generic merge give the same result */
+    T_EXPECT(kmerge(lout, (const void * const *)larrays, lnum, ARRAY_SIZE(larrays), cmp_long, sizeof(long)), 0);
+    T_EXPECT(memcmp(lout, lexpected, sizeof(lexpected)), 0);
+}
+
+test_f test_invalid(void)
+{
+    const int a[] = {1, 2, 3};
+    const int *arrays[] = {a};
+    const size_t num_elements[] = {ARRAY_SIZE(a)};
+    int out[ARRAY_SIZE(a)];
+
+    T_EXPECT(loser_tree_create(0, cmp_int), NULL);
+    T_EXPECT(loser_tree_create(2, NULL), NULL);
+    T_CHECK(loser_tree_init(NULL, (const void * const *)arrays) != 0);
+    T_EXPECT(loser_tree_get_winner(NULL), -1);
+    T_EXPECT(loser_tree_get_top(NULL), NULL);
+    T_CHECK(loser_tree_replay(NULL, NULL) != 0);
+
+    T_CHECK(kmerge(NULL, (const void * const *)arrays, num_elements, 1, cmp_int, sizeof(int)) != 0);
+    T_CHECK(kmerge(out, NULL, num_elements, 1, cmp_int, sizeof(int)) != 0);
+    T_CHECK(kmerge(out, (const void * const *)arrays, NULL, 1, cmp_int, sizeof(int)) != 0);
+    T_CHECK(kmerge(out, (const void * const *)arrays, num_elements, 0, cmp_int, sizeof(int)) != 0);
+    T_CHECK(kmerge(out, (const void * const *)arrays, num_elements, 1, NULL, sizeof(int)) != 0);
+    T_CHECK(kmerge(out, (const void * const *)arrays, num_elements, 1, cmp_int, 0) != 0);
+
+    T_CHECK(kmerge_int(NULL, arrays, num_elements, 1) != 0);
+    T_CHECK(kmerge_int(out, arrays, num_elements, 0) != 0);
+
+    loser_tree_destroy(NULL);
+}
+
+void test(void)
+{
+    TEST(test_kmerge());
+    TEST(test_loser_tree());
+    TEST(test_kmerge_int());
+    TEST(test_kmerge_typed());
+    TEST(test_invalid());
+}
+
+int main(void)
+{
+    TEST_INIT("KMERGE");
+    srand((unsigned)time(NULL));
+    test();
+    TEST_SUMMARY();
+}
@@ -198,6 +198,50 @@ test_f test_delete_all(void)
     list_destroy(list);
 }
 
+test_f test_delete_last_node(void)
+{
+    List *list;
+
+    int t[] = {3, 3, 3};
+    int t_exp[] = {1, 2, 3};
+    int *rt;
+
+    size_t rsize;
+    int i;
+
+    list = list_create(sizeof(int), cmp_int, NULL);
+    T_ERROR(list == NULL);
+
+    /* delete the only node, tail must not point to freed node */
+    T_EXPECT(list_insert(list, (void *)&t[0]), 0);
+    T_EXPECT(list_delete(list, (void *)&t[0]), 0);
+    T_EXPECT(list_get_num_entries(list), 0);
+
+    /* delete all nodes at once */
+    for (i = 0; i < ARRAY_SIZE(t); ++i)
+        T_EXPECT(list_insert(list, (void *)&t[i]), 0);
+
+    T_EXPECT(list_delete_all(list, (void *)&t[0]), ARRAY_SIZE(t));
+    T_EXPECT(list_get_num_entries(list), 0);
+
+    /* list is still usable, insert goes through tail guard */
+    for (i = ARRAY_SIZE(t_exp) - 1; i >= 0; --i)
+        T_EXPECT(list_insert(list, (void *)&t_exp[i]), 0);
+
+    T_EXPECT(list_get_num_entries(list), ARRAY_SIZE(t_exp));
+    T_EXPECT(list_to_array(list, (void *)&rt, &rsize), 0);
+    T_ASSERT(rsize, ARRAY_SIZE(t_exp));
+    T_EXPECT(array_equal_int(t_exp, rt, rsize), true);
+    FREE(rt);
+
+    T_EXPECT(list_delete(list, (void *)&t_exp[2]), 0);
+    T_EXPECT(list_delete(list, (void *)&t_exp[0]), 0);
+    T_EXPECT(list_delete(list, (void *)&t_exp[1]), 0);
+    T_EXPECT(list_get_num_entries(list), 0);
+
+    list_destroy(list);
+}
+
 test_f test_delete_with_entry(void)
 {
     List *list;
@@ -1110,6 +1154,7 @@ void test(void)
     TEST(test_insert());
     TEST(test_delete());
     TEST(test_delete_all());
+    TEST(test_delete_last_node());
     TEST(test_delete_with_entry());
     TEST(test_delete_all_with_entry());
     TEST(test_delete_with_entry_wo_destr());
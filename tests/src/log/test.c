@@ -0,0 +1,784 @@
+#include <test.h>
+#include <log.h>
+#include <common.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#define THREADS         4
+#define THREAD_MESSAGES 2000
+#define BIG_STRING      512
+#define TRACE_CALLS     1000
+#define RATE_MESSAGES   100
+#define ROTATE_MESSAGES 100
+
+typedef struct Thread_arg
+{
+    int     id;
+    int     n;
+} Thread_arg;
+
+/* log file of this process (name is a timestamp) */
+static char log_file_path[PATH_MAX];
+
+static void log_file_clear(void)
+{
+    FILE *f = log_get_file();
+
+    (void)fflush(f);
+    (void)ftruncate(fileno(f), 0);
+    (void)fseek(f, 0, SEEK_SET);
+}
+
+static char *file_read(const char *path)
+{
+    FILE *f;
+    char *buf;
+    long size;
+
+    f = fopen(path, "r");
+    if (f == NULL)
+        return NULL;
+
+    (void)fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    (void)fseek(f, 0, SEEK_SET);
+
+    buf = (char *)malloc((size_t)size + 1);
+    if (buf == NULL)
+    {
+        (void)fclose(f);
+        return NULL;
+    }
+
+    if (fread(buf, 1, (size_t)size, f) != (size_t)size)
+    {
+        (void)fclose(f);
+        FREE(buf);
+        return NULL;
+    }
+
+    buf[size] = '\0';
+    (void)fclose(f);
+
+    return buf;
+}
+
+static char *log_file_read(void)
+{
+    (void)fflush(log_get_file());
+
+    return file_read(log_file_path);
+}
+
+static size_t count_substr(const char *str, const char *substr)
+{
+    size_t n = 0;
+
+    while ((str = strstr(str, substr)) != NULL)
+    {
+        ++n;
+        str += strlen(substr);
+    }
+
+    return n;
+}
+
+static size_t count_lines(FILE *f, const char *substr)
+{
+    char line[512];
+    size_t n = 0;
+
+    while (fgets(line, sizeof(line), f) != NULL)
+        if (strstr(line, substr) != NULL)
+            ++n;
+
+    return n;
+}
+
+static void traced_func(void)
+{
+    TRACE();
+}
+
+static void *trace_thread(void *arg)
+{
+    int i;
+
+    for (i = 0; i < *(int *)arg; ++i)
+        traced_func();
+
+    return NULL;
+}
+
+static void level_site(int i)
+{
+    LOG_INFO("level site %d\n", i);
+}
+
+static void rate_site(int i)
+{
+    LOG("rate %d\n", i);
+}
+
+static size_t rotated_read(const char *path, int *first, int *last)
+{
+    const char *pos;
+    char *buf;
+    size_t n = 0;
+    int msg;
+
+    buf = file_read(path);
+    if (buf == NULL)
+        return 0;
+
+    for (pos = strstr(buf, "rotation "); pos != NULL; pos = strstr(pos + 1, "rotation "))
+        if (sscanf(pos, "rotation %d", &msg) == 1)
+        {
+            if (n++ == 0)
+                *first = msg;
+
+            *last = msg;
+        }
+
+    FREE(buf);
+
+    return n;
+}
+
+static void *log_thread(void *arg)
+{
+    const Thread_arg *targ = (const Thread_arg *)arg;
+    int i;
+
+    for (i = 0; i < targ->n; ++i)
+        LOG("thread %d msg %d\n", targ->id, i);
+
+    return NULL;
+}
+
+test_f test_async_init(void)
+{
+    T_EXPECT(log_async_is_enabled(), 0);
+    T_CHECK(log_async_flush() != 0);
+    T_CHECK(log_async_init(0, LOG_ASYNC_BLOCK + 1) != 0);
+    T_EXPECT(log_async_is_enabled(), 0);
+
+    T_EXPECT(log_async_init(0, LOG_ASYNC_DROP), 0);
+    T_EXPECT(log_async_is_enabled(), 1);
+    T_CHECK(log_async_init(0, LOG_ASYNC_BLOCK) != 0);
+    T_EXPECT(log_async_flush(), 0);
+    log_async_deinit();
+    T_EXPECT(log_async_is_enabled(), 0);
+
+    T_EXPECT(log_async_init(0, LOG_ASYNC_BLOCK), 0);
+    T_EXPECT(log_async_is_enabled(), 1);
+    T_EXPECT(log_async_get_dropped(), 0);
+    log_async_deinit();
+    T_EXPECT(log_async_is_enabled(), 0);
+
+    /* second deinit is harmless */
+    log_async_deinit();
+}
+
+test_f test_async_flush(void)
+{
+    char name[16];
+    char line[64];
+    char *buf;
+    const char *pos;
+    int i;
+
+    log_file_clear();
+    T_ERROR(log_async_init(0, LOG_ASYNC_BLOCK) != 0);
+
+    /* string is copied, so changing it after LOG doesn't change message */
+    (void)strcpy(name, "before");
+    LOG("async name %s\n", name);
+    (void)strcpy(name, "after");
+
+    for (i = 0; i < 1000; ++i)
+        LOG("async flush %d\n", i);
+
+    /* all messages are in file after flush, without deinit */
+    T_EXPECT(log_async_flush(), 0);
+    buf = log_file_read();
+    T_ERROR(buf == NULL);
+
+    T_CHECK(strstr(buf, "async name before\n") != NULL);
+    T_CHECK(strstr(buf, "async name after\n") == NULL);
+
+    pos = buf;
+    for (i = 0; i < 1000 && pos != NULL; ++i)
+    {
+        (void)snprintf(line, sizeof(line), "async flush %d\n", i);
+        pos = strstr(pos, line);
+    }
+
+    T_CHECK(pos != NULL);
+    T_EXPECT(count_substr(buf, "async flush "), 1000);
+
+    FREE(buf);
+    log_async_deinit();
+}
+
+test_f test_async_threads(void)
+{
+    pthread_t threads[THREADS];
+    Thread_arg args[THREADS];
+    int next[THREADS] = {0};
+    const char *pos;
+    char *buf;
+    int id;
+    int msg;
+    int i;
+
+    log_file_clear();
+
+    /* small ring, threads have to wait for flusher */
+    T_ERROR(log_async_init(1, LOG_ASYNC_BLOCK) != 0);
+
+    for (i = 0; i < THREADS; ++i)
+    {
+        args[i].id = i;
+        args[i].n = THREAD_MESSAGES;
+        T_ERROR(pthread_create(&threads[i], NULL, log_thread, &args[i]) != 0);
+    }
+
+    for (i = 0; i < THREADS; ++i)
+        (void)pthread_join(threads[i], NULL);
+
+    T_EXPECT(log_async_flush(), 0);
+    T_EXPECT(log_async_get_dropped(), 0);
+    log_async_deinit();
+
+    buf = log_file_read();
+    T_ERROR(buf == NULL);
+
+    /* order is kept per thread */
+    for (pos = strstr(buf, "thread "); pos != NULL; pos = strstr(pos + 1, "thread "))
+    {
+        T_ERROR(sscanf(pos, "thread %d msg %d", &id, &msg) != 2);
+        T_ERROR(id < 0 || id >= THREADS);
+        T_EXPECT(msg, next[id]);
+        next[id] = msg + 1;
+    }
+
+    for (i = 0; i < THREADS; ++i)
+        T_EXPECT(next[i], THREAD_MESSAGES);
+
+    FREE(buf);
+}
+
+test_f test_async_drop(void)
+{
+    char big[BIG_STRING];
+    const char *pos;
+    char *buf;
+    size_t dropped;
+    int total;
+    int prev = -1;
+    int msg;
+
+    (void)memset(big, 'x', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+
+    log_file_clear();
+
+    /* minimal ring keeps about 30 messages, producer is faster than write to file */
+    T_ERROR(log_async_init(1, LOG_ASYNC_DROP) != 0);
+
+    for (total = 0; total < 1000000 && log_async_get_dropped() == 0; ++total)
+        LOG("drop %d %s\n", total, big);
+
+    T_EXPECT(log_async_flush(), 0);
+    dropped = log_async_get_dropped();
+    log_async_deinit();
+
+    T_CHECK(dropped > 0);
+
+    buf = log_file_read();
+    T_ERROR(buf == NULL);
+
+    /* every message is written or counted as dropped, written are in order */
+    T_EXPECT(count_substr(buf, "drop "), (size_t)total - dropped);
+    for (pos = strstr(buf, "drop "); pos != NULL; pos = strstr(pos + 1, "drop "))
+    {
+        T_ERROR(sscanf(pos, "drop %d", &msg) != 1);
+        T_CHECK(msg > prev);
+        prev = msg;
+    }
+
+    FREE(buf);
+}
+
+test_f test_async_block(void)
+{
+    char big[BIG_STRING];
+    char *buf;
+    int i;
+
+    (void)memset(big, 'x', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+
+    log_file_clear();
+    T_ERROR(log_async_init(1, LOG_ASYNC_BLOCK) != 0);
+
+    /* much more than ring, nothing can be lost */
+    for (i = 0; i < 5000; ++i)
+        LOG("block %d %s\n", i, big);
+
+    T_EXPECT(log_async_get_dropped(), 0);
+    log_async_deinit();
+
+    buf = log_file_read();
+    T_ERROR(buf == NULL);
+
+    T_EXPECT(count_substr(buf, "block "), 5000);
+
+    FREE(buf);
+}
+
+test_f test_trace_roundtrip(void)
+{
+    Log_trace_header header;
+    Log_trace_site_entry entry;
+    Log_trace_record rec;
+    pthread_t thread;
+    char cmd[PATH_MAX + 64];
+    char *buf;
+    FILE *f;
+    struct stat st;
+    size_t offset;
+    size_t pos;
+    size_t calls = 0;
+    uint32_t site = UINT32_MAX;
+    uint32_t i;
+    int n = TRACE_CALLS;
+    int j;
+
+    T_ERROR(log_trace_init("trace.bin") != 0);
+    T_CHECK(log_trace_init("trace.bin") != 0);
+
+    for (j = 0; j < TRACE_CALLS; ++j)
+        traced_func();
+
+    T_ERROR(pthread_create(&thread, NULL, trace_thread, &n) != 0);
+    (void)pthread_join(thread, NULL);
+
+    log_trace_deinit();
+
+    /* TRACE after deinit is not recorded */
+    traced_func();
+
+    buf = file_read("trace.bin");
+    T_ERROR(buf == NULL);
+    T_ERROR(stat("trace.bin", &st) != 0);
+    T_ERROR((size_t)st.st_size < sizeof(header));
+
+    (void)memcpy(&header, buf, sizeof(header));
+    T_EXPECT(memcmp(header.magic, LOG_TRACE_MAGIC, sizeof(LOG_TRACE_MAGIC)), 0);
+    T_EXPECT(header.version, LOG_TRACE_VERSION);
+    T_EXPECT(header.pid, (uint64_t)getpid());
+    T_CHECK(header.num_sites > 0);
+    T_CHECK(header.ticks_per_sec > 0);
+    T_EXPECT(header.data_offset % (uint64_t)sysconf(_SC_PAGESIZE), 0);
+
+    /* find site of traced_func in site table */
+    offset = sizeof(header);
+    for (i = 0; i < header.num_sites; ++i)
+    {
+        (void)memcpy(&entry, buf + offset, sizeof(entry));
+        offset += sizeof(entry);
+
+        if (entry.func_len == strlen("traced_func") && memcmp(buf + offset + entry.file_len, "traced_func", entry.func_len) == 0)
+        {
+            T_CHECK(memcmp(buf + offset + entry.file_len - strlen("test.c"), "test.c", strlen("test.c")) == 0);
+            site = i;
+        }
+
+        offset += entry.file_len + entry.func_len;
+        offset = (offset + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1);
+    }
+
+    T_ERROR(site == UINT32_MAX);
+
+    /* each thread has own chunk */
+    for (offset = header.data_offset; offset < (size_t)st.st_size; offset += header.chunk_size)
+        for (pos = offset; pos + sizeof(rec) <= offset + header.chunk_size && pos + sizeof(rec) <= (size_t)st.st_size; pos += sizeof(rec))
+        {
+            (void)memcpy(&rec, buf + pos, sizeof(rec));
+            if (rec.ts == 0)
+                break;
+
+            if (rec.site == site)
+                ++calls;
+        }
+
+    T_EXPECT(calls, (size_t)2 * TRACE_CALLS);
+    FREE(buf);
+
+    /* decoder sees the same records */
+    (void)snprintf(cmd, sizeof(cmd), "%s trace.bin", TRACE_DECODER);
+    f = popen(cmd, "r");
+    T_ERROR(f == NULL);
+    T_EXPECT(count_lines(f, ":traced_func."), (size_t)2 * TRACE_CALLS);
+    T_EXPECT(pclose(f), 0);
+
+    (void)snprintf(cmd, sizeof(cmd), "%s -j trace.bin", TRACE_DECODER);
+    f = popen(cmd, "r");
+    T_ERROR(f == NULL);
+    T_EXPECT(count_lines(f, "\"name\":\"traced_func\""), (size_t)2 * TRACE_CALLS);
+    T_EXPECT(pclose(f), 0);
+}
+
+test_f test_trace_thread_exit(void)
+{
+    pthread_t threads[THREADS];
+    char line[PATH_MAX + 128];
+    FILE *f;
+    size_t mapped = 0;
+    int n = 1;
+    int i;
+
+    T_ERROR(log_trace_init("trace_exit.bin") != 0);
+
+    for (i = 0; i < THREADS; ++i)
+        T_ERROR(pthread_create(&threads[i], NULL, trace_thread, &n) != 0);
+
+    for (i = 0; i < THREADS; ++i)
+        (void)pthread_join(threads[i], NULL);
+
+    /* chunks of exited threads are unmapped */
+    f = fopen("/proc/self/maps", "r");
+    T_ERROR(f == NULL);
+
+    while (fgets(line, sizeof(line), f) != NULL)
+        if (strstr(line, "trace_exit.bin") != NULL)
+            ++mapped;
+
+    (void)fclose(f);
+
+    T_EXPECT(mapped, 0);
+
+    log_trace_deinit();
+}
+
+test_f test_levels_spec(void)
+{
+    char long_name[64];
+
+    T_EXPECT(log_get_level("*"), LOG_LEVEL_DEFAULT);
+    T_EXPECT(log_get_level("avl"), LOG_LEVEL_DEFAULT);
+
+    T_EXPECT(log_set_levels("avl=5,rbt.c=3,*=1"), 0);
+    T_EXPECT(log_get_level("avl"), 5);
+    T_EXPECT(log_get_level("avl.c"), 5);
+    T_EXPECT(log_get_level("rbt"), 3);
+    T_EXPECT(log_get_level("rbt.c"), 3);
+    T_EXPECT(log_get_level("*"), 1);
+    T_EXPECT(log_get_level(NULL), 1);
+    T_EXPECT(log_get_level("bst"), LOG_LEVEL_DEFAULT);
+
+    /* only level means all files */
+    T_EXPECT(log_set_levels("2"), 0);
+    T_EXPECT(log_get_level("*"), 2);
+
+    /* overwrite */
+    T_EXPECT(log_set_levels("avl=4"), 0);
+    T_EXPECT(log_get_level("avl"), 4);
+
+    T_CHECK(log_set_levels(NULL) != 0);
+    T_CHECK(log_set_levels("avl=") != 0);
+    T_CHECK(log_set_levels("=3") != 0);
+    T_CHECK(log_set_levels("avl=x") != 0);
+    T_CHECK(log_set_levels("avl=3x") != 0);
+    T_CHECK(log_set_levels("avl=16") != 0);
+    T_CHECK(log_set_levels("avl=-2") != 0);
+    T_CHECK(log_set_levels("avl=3;rbt=2") != 0);
+
+    (void)memset(long_name, 'a', sizeof(long_name) - 1);
+    long_name[sizeof(long_name) - 1] = '\0';
+    T_CHECK(log_set_level(long_name, 1) != 0);
+    T_CHECK(log_set_level("avl", LOG_LEVEL_MAX + 1) != 0);
+    T_CHECK(log_set_level("avl", LOG_LEVEL_DEFAULT - 1) != 0);
+    T_EXPECT(log_get_level("avl"), 4);
+
+    /* levels before error are set */
+    T_CHECK(log_set_levels("bst=4,rbt=x") != 0);
+    T_EXPECT(log_get_level("bst"), 4);
+    T_EXPECT(log_get_level("rbt"), 3);
+
+    /* LOG_LEVEL_DEFAULT removes module */
+    T_EXPECT(log_set_levels("avl=-1,rbt=-1,bst=-1,*=-1"), 0);
+    T_EXPECT(log_get_level("avl"), LOG_LEVEL_DEFAULT);
+    T_EXPECT(log_get_level("rbt"), LOG_LEVEL_DEFAULT);
+    T_EXPECT(log_get_level("bst"), LOG_LEVEL_DEFAULT);
+    T_EXPECT(log_get_level("*"), LOG_LEVEL_DEFAULT);
+}
+
+test_f test_levels_lookup(void)
+{
+    char *buf;
+
+    log_file_clear();
+
+    /* DEBUG_MODE level of this file */
+    level_site(0);
+
+    /* module level is used for this file only */
+    T_EXPECT(log_set_level("avl", LOG_LEVEL_DEBUG), 0);
+    level_site(1);
+
+    T_EXPECT(log_set_level("test", LOG_LEVEL_INFO), 0);
+    level_site(2);
+    LOG_NTCE("level notice module\n");
+
+    /* module level wins over all files level */
+    T_EXPECT(log_set_level("*", LOG_LEVEL_ALWAYS), 0);
+    level_site(3);
+
+    T_EXPECT(log_set_level("test.c", LOG_LEVEL_DEFAULT), 0);
+    level_site(4);
+
+    T_EXPECT(log_set_level("*", LOG_LEVEL_DEBUG), 0);
+    level_site(5);
+    LOG_NTCE("level notice all\n");
+
+    T_EXPECT(log_set_level("*", LOG_LEVEL_DEFAULT), 0);
+    T_EXPECT(log_set_level("avl", LOG_LEVEL_DEFAULT), 0);
+    level_site(6);
+
+    buf = log_file_read();
+    T_ERROR(buf == NULL);
+
+    T_CHECK(strstr(buf, "level site 0\n") == NULL);
+    T_CHECK(strstr(buf, "level site 1\n") == NULL);
+    T_CHECK(strstr(buf, "level site 2\n") != NULL);
+    T_CHECK(strstr(buf, "level notice module\n") == NULL);
+    T_CHECK(strstr(buf, "level site 3\n") != NULL);
+    T_CHECK(strstr(buf, "level site 4\n") == NULL);
+    T_CHECK(strstr(buf, "level site 5\n") != NULL);
+    T_CHECK(strstr(buf, "level notice all\n") != NULL);
+    T_CHECK(strstr(buf, "level site 6\n") == NULL);
+
+    FREE(buf);
+}
+
+test_f test_rate_limit(void)
+{
+    const char *pos;
+    char *buf;
+    size_t limited;
+    size_t written;
+    unsigned suppressed = 0;
+    int i;
+
+    log_file_clear();
+    limited = log_get_rate_limited();
+
+    /* burst of 5, then 10 per second */
+    log_set_rate_limit(10, 5);
+    for (i = 0; i < RATE_MESSAGES; ++i)
+        rate_site(i);
+
+    limited = log_get_rate_limited() - limited;
+
+    buf = log_file_read();
+    T_ERROR(buf == NULL);
+
+    /* bucket is full at start, refill during loop is at most 1 message */
+    written = count_substr(buf, "rate ");
+    T_CHECK(written >= 5 && written <= 6);
+    T_EXPECT(written + limited, RATE_MESSAGES);
+    T_CHECK(strstr(buf, "rate 0\n") != NULL);
+    T_CHECK(strstr(buf, "rate 4\n") != NULL);
+    T_CHECK(strstr(buf, "rate 99\n") == NULL);
+    FREE(buf);
+
+    /* tokens are back, first message says how many were suppressed */
+    (void)usleep(250000);
+    rate_site(RATE_MESSAGES);
+
+    buf = log_file_read();
+    T_ERROR(buf == NULL);
+
+    T_CHECK(strstr(buf, "rate 100\n") != NULL);
+    pos = strstr(buf, "suppressed ");
+    T_ERROR(pos == NULL);
+    T_EXPECT(sscanf(pos, "suppressed %u messages", &suppressed), 1);
+    T_EXPECT((size_t)suppressed, limited);
+    FREE(buf);
+
+    /* no limit */
+    log_set_rate_limit(0, 0);
+    log_file_clear();
+    for (i = 0; i < RATE_MESSAGES; ++i)
+        rate_site(i);
+
+    buf = log_file_read();
+    T_ERROR(buf == NULL);
+    T_EXPECT(count_substr(buf, "rate "), RATE_MESSAGES);
+    FREE(buf);
+}
+
+test_f test_rotation(void)
+{
+    char pad[64];
+    char path[PATH_MAX + 8];
+    struct stat st;
+    size_t n;
+    int expected = ROTATE_MESSAGES - 1;
+    int first;
+    int last;
+    int i;
+    int j;
+
+    (void)memset(pad, 'p', sizeof(pad) - 1);
+    pad[sizeof(pad) - 1] = '\0';
+
+    T_CHECK(log_set_rotation(1000, LOG_ROTATE_MAX_FILES + 1) != 0);
+
+    log_file_clear();
+    T_EXPECT(log_set_rotation(1000, 2), 0);
+
+    for (i = 0; i < ROTATE_MESSAGES; ++i)
+        LOG("rotation %d %s\n", i, pad);
+
+    (void)fflush(log_get_file());
+
+    /* file, file.1, file.2 keep newest messages, without gaps */
+    for (j = 0; j <= 2; ++j)
+    {
+        if (j == 0)
+            (void)snprintf(path, sizeof(path), "%s", log_file_path);
+        else
+            (void)snprintf(path, sizeof(path), "%s.%d", log_file_path, j);
+
+        T_ERROR(stat(path, &st) != 0);
+        T_CHECK(st.st_size < 1000 + 256);
+
+        /* rotation is done after write, so current file can be empty */
+        n = rotated_read(path, &first, &last);
+        if (n == 0 && j == 0)
+            continue;
+
+        T_ERROR(n == 0);
+        T_EXPECT(last, expected);
+        T_EXPECT((size_t)(last - first + 1), n);
+        expected = first - 1;
+    }
+
+    (void)snprintf(path, sizeof(path), "%s.3", log_file_path);
+    T_CHECK(stat(path, &st) != 0);
+
+    /* without old files, file is truncated */
+    for (j = 1; j <= 2; ++j)
+    {
+        (void)snprintf(path, sizeof(path), "%s.%d", log_file_path, j);
+        (void)unlink(path);
+    }
+
+    T_EXPECT(log_set_rotation(1000, 0), 0);
+    for (i = 0; i < ROTATE_MESSAGES; ++i)
+        LOG("rotation %d %s\n", i, pad);
+
+    (void)fflush(log_get_file());
+
+    (void)snprintf(path, sizeof(path), "%s.1", log_file_path);
+    T_CHECK(stat(path, &st) != 0);
+    T_ERROR(stat(log_file_path, &st) != 0);
+    T_CHECK(st.st_size < 1000 + 256);
+
+    n = rotated_read(log_file_path, &first, &last);
+    if (n > 0)
+    {
+        T_EXPECT(last, ROTATE_MESSAGES - 1);
+        T_EXPECT((size_t)(last - first + 1), n);
+    }
+
+    T_EXPECT(log_set_rotation(0, 0), 0);
+}
+
+void test(void)
+{
+    TEST(test_async_init());
+    TEST(test_async_flush());
+    TEST(test_async_threads());
+    TEST(test_async_drop());
+    TEST(test_async_block());
+    TEST(test_trace_roundtrip());
+    TEST(test_trace_thread_exit());
+    TEST(test_levels_spec());
+    TEST(test_levels_lookup());
+    TEST(test_rate_limit());
+    TEST(test_rotation());
+}
+
+static void dir_remove(const char *path)
+{
+    char file[PATH_MAX];
+    struct dirent *entry;
+    DIR *dir;
+
+    dir = opendir(path);
+    if (dir == NULL)
+        return;
+
+    while ((entry = readdir(dir)) != NULL)
+    {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+            continue;
+
+        (void)snprintf(file, sizeof(file), "%s/%s", path, entry->d_name);
+        if (entry->d_type == DT_DIR)
+            dir_remove(file);
+        else
+            (void)unlink(file);
+    }
+
+    (void)closedir(dir);
+    (void)rmdir(path);
+}
+
+int main(void)
+{
+    char dir[] = "/tmp/log_test_XXXXXX";
+    char proc[64];
+    ssize_t len;
+
+    TEST_INIT("LOG");
+
+    /* logger writes to ./logs, so work in own directory */
+    if (mkdtemp(dir) == NULL || chdir(dir) != 0)
+        return 1;
+
+    if (log_init(NULL, LOG_TO_FILE))
+    {
+        dir_remove(dir);
+        return 1;
+    }
+
+    (void)snprintf(proc, sizeof(proc), "/proc/self/fd/%d", fileno(log_get_file()));
+    len = readlink(proc, log_file_path, sizeof(log_file_path) - 1);
+    if (len <= 0)
+    {
+        log_deinit();
+        dir_remove(dir);
+        return 1;
+    }
+
+    log_file_path[len] = '\0';
+
+    test();
+
+    log_deinit();
+    dir_remove(dir);
+
+    TEST_SUMMARY();
+}
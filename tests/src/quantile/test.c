@@ -0,0 +1,432 @@
+#include <quantile.h>
+#include <test.h>
+#include <common.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+#define THREADS 8
+
+CMP(double)
+CMP(uint64_t)
+
+typedef struct Thread_arg
+{
+    Hdr_histogram   *h;
+    const uint64_t  *values;
+    size_t          n;
+} Thread_arg;
+
+static const double quantiles[] = {0.0, 0.01, 0.1, 0.25, 0.5, 0.75, 0.9, 0.99, 0.999, 1.0};
+
+/* distance of q from ranks of value in sorted ([first, last] / n for duplicates) */
+static double rank_error(const double *sorted, size_t n, double value, double q)
+{
+    size_t lo = 0;
+    size_t hi = n;
+    size_t mid;
+    double first;
+    double last;
+
+    while (lo < hi)
+    {
+        mid = (lo + hi) >> 1;
+        if (sorted[mid] < value)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    first = (double)lo / (double)n;
+    hi = n;
+    while (lo < hi)
+    {
+        mid = (lo + hi) >> 1;
+        if (sorted[mid] <= value)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    last = (double)lo / (double)n;
+    if (q < first)
+        return first - q;
+
+    if (q > last)
+        return q - last;
+
+    return 0.0;
+}
+
+/* tails have to be more accurate than middle (~1 / compression) */
+static double max_rank_error(double q)
+{
+    return q < 0.01 || q > 0.99 ? 0.002 : 2.0 / TDIGEST_DEFAULT_COMPRESSION;
+}
+
+static void check_tdigest(Tdigest *td, double *values, size_t n)
+{
+    double value;
+    size_t i;
+
+    qsort(values, n, sizeof(double), cmp_double);
+
+    T_EXPECT(tdigest_get_count(td), (double)n);
+    for (i = 0; i < ARRAY_SIZE(quantiles); ++i)
+    {
+        T_EXPECT(tdigest_get_quantile(td, quantiles[i], &value), 0);
+        T_CHECK(rank_error(values, n, value, quantiles[i]) <= max_rank_error(quantiles[i]));
+    }
+
+    T_EXPECT(tdigest_get_quantile(td, 0.0, &value), 0);
+    T_EXPECT(value, values[0]);
+
+    T_EXPECT(tdigest_get_quantile(td, 1.0, &value), 0);
+    T_EXPECT(value, values[n - 1]);
+}
+
+static void *record_thread(void *arg)
+{
+    Thread_arg *targ = (Thread_arg *)arg;
+    size_t i;
+
+    for (i = 0; i < targ->n; ++i)
+        (void)hdr_histogram_record_concurrent(targ->h, targ->values[i]);
+
+    return NULL;
+}
+
+test_f test_tdigest_uniform(size_t n)
+{
+    Tdigest *td;
+    double *values;
+    size_t i;
+
+    values = (double *)malloc(n * sizeof(double));
+    T_ERROR(values == NULL);
+
+    td = tdigest_create(TDIGEST_DEFAULT_COMPRESSION);
+    T_ERROR(td == NULL);
+
+    for (i = 0; i < n; ++i)
+    {
+        values[i] = (double)rand() / (double)RAND_MAX;
+        T_EXPECT(tdigest_add(td, values[i]), 0);
+    }
+
+    check_tdigest(td, values, n);
+
+    /* constant memory */
+    T_CHECK(tdigest_get_num_centroids(td) <= (size_t)(TDIGEST_DEFAULT_COMPRESSION * 2));
+
+    tdigest_destroy(td);
+    FREE(values);
+}
+
+test_f test_tdigest_long_tail(void)
+{
+    const size_t n = 200000;
+    Tdigest *td;
+    double *values;
+    size_t i;
+
+    values = (double *)malloc(n * sizeof(double));
+    T_ERROR(values == NULL);
+
+    td = tdigest_create(TDIGEST_DEFAULT_COMPRESSION);
+    T_ERROR(td == NULL);
+
+    /* latencies: many duplicates and 1% of slow samples */
+    for (i = 0; i < n; ++i)
+    {
+        values[i] = (double)(100 + rand() % 50);
+        if (rand() % 100 == 0)
+            values[i] *= (double)(10 + rand() % 100);
+
+        T_EXPECT(tdigest_add(td, values[i]), 0);
+    }
+
+    check_tdigest(td, values, n);
+
+    tdigest_destroy(td);
+    FREE(values);
+}
+
+test_f test_tdigest_merge(void)
+{
+    const size_t n = 20000;
+    Tdigest *td[THREADS];
+    Tdigest *all;
+    double *values;
+    size_t i;
+    size_t j;
+
+    values = (double *)malloc(THREADS * n * sizeof(double));
+    T_ERROR(values == NULL);
+
+    all = tdigest_create(TDIGEST_DEFAULT_COMPRESSION);
+    T_ERROR(all == NULL);
+
+    /* every digest has other range of values */
+    for (i = 0; i < THREADS; ++i)
+    {
+        td[i] = tdigest_create(TDIGEST_DEFAULT_COMPRESSION);
+        T_ERROR(td[i] == NULL);
+
+        for (j = 0; j < n; ++j)
+        {
+            values[i * n + j] = (double)(rand() % 10000) + (double)i * 5000.0;
+            T_EXPECT(tdigest_add(td[i], values[i * n + j]), 0);
+        }
+    }
+
+    for (i = 0; i < THREADS; ++i)
+    {
+        T_EXPECT(tdigest_merge(all, td[i]), 0);
+        T_EXPECT(tdigest_get_count(td[i]), (double)n);
+        tdigest_destroy(td[i]);
+    }
+
+    check_tdigest(all, values, THREADS * n);
+
+    tdigest_destroy(all);
+    FREE(values);
+}
+
+test_f test_tdigest_small(void)
+{
+    Tdigest *td;
+    double value;
+
+    td = tdigest_create(TDIGEST_DEFAULT_COMPRESSION);
+    T_ERROR(td == NULL);
+
+    T_CHECK(tdigest_get_quantile(td, 0.5, &value) != 0);
+
+    T_EXPECT(tdigest_add(td, 3.0), 0);
+    T_EXPECT(tdigest_get_quantile(td, 0.5, &value), 0);
+    T_EXPECT(value, 3.0);
+
+    T_EXPECT(tdigest_add(td, 1.0), 0);
+    T_EXPECT(tdigest_add(td, 2.0), 0);
+    T_EXPECT(tdigest_get_quantile(td, 0.5, &value), 0);
+    T_EXPECT(value, 2.0);
+    T_EXPECT(tdigest_get_quantile(td, 0.0, &value), 0);
+    T_EXPECT(value, 1.0);
+    T_EXPECT(tdigest_get_quantile(td, 1.0, &value), 0);
+    T_EXPECT(value, 3.0);
+    T_EXPECT(tdigest_get_num_centroids(td), 3);
+
+    T_EXPECT(tdigest_add_weighted(td, 10.0, 7.0), 0);
+    T_EXPECT(tdigest_get_count(td), 10.0);
+    T_EXPECT(tdigest_get_quantile(td, 0.9, &value), 0);
+    T_EXPECT(value, 10.0);
+
+    tdigest_reset(td);
+    T_EXPECT(tdigest_get_count(td), 0.0);
+    T_CHECK(tdigest_get_quantile(td, 0.5, &value) != 0);
+
+    T_EXPECT(tdigest_create(0.0), NULL);
+    T_CHECK(tdigest_add(NULL, 1.0) != 0);
+    T_CHECK(tdigest_add(td, 0.0 / 0.0) != 0);
+    T_CHECK(tdigest_add_weighted(td, 1.0, 0.0) != 0);
+    T_CHECK(tdigest_merge(td, td) != 0);
+    T_CHECK(tdigest_merge(td, NULL) != 0);
+    T_EXPECT(tdigest_add(td, 1.0), 0);
+    T_CHECK(tdigest_get_quantile(td, 1.5, &value) != 0);
+    T_CHECK(tdigest_get_quantile(td, 0.5, NULL) != 0);
+
+    tdigest_destroy(td);
+    tdigest_destroy(NULL);
+}
+
+test_f test_hdr_accuracy(unsigned precision_bits)
+{
+    const size_t n = 100000;
+    const double max_error = 1.0 / (double)BIT(precision_bits - 1);
+    Hdr_histogram *h;
+    uint64_t *values;
+    uint64_t exact;
+    uint64_t value;
+    uint64_t sum = 0;
+    double mean;
+    size_t rank;
+    size_t i;
+
+    values = (uint64_t *)malloc(n * sizeof(uint64_t));
+    T_ERROR(values == NULL);
+
+    h = hdr_histogram_create(BIT(40), precision_bits, 1);
+    T_ERROR(h == NULL);
+
+    for (i = 0; i < n; ++i)
+    {
+        /* from ns to seconds */
+        values[i] = ((uint64_t)rand() % 1000 + 1) << (rand() % 30);
+        sum += values[i];
+        T_EXPECT(hdr_histogram_record(h, values[i]), 0);
+    }
+
+    qsort(values, n, sizeof(uint64_t), cmp_uint64_t);
+
+    T_EXPECT(hdr_histogram_get_count(h), n);
+    T_EXPECT(hdr_histogram_get_min(h), values[0]);
+    T_EXPECT(hdr_histogram_get_max(h), values[n - 1]);
+
+    for (i = 0; i < ARRAY_SIZE(quantiles); ++i)
+    {
+        rank = (size_t)(quantiles[i] * (double)n + 0.5);
+        rank = rank == 0 ? 0 : rank - 1;
+
+        exact = values[rank];
+        value = hdr_histogram_get_quantile(h, quantiles[i]);
+
+        /* value is the highest equivalent of bucket of exact value */
+        T_CHECK(value >= exact);
+        T_CHECK((double)(value - exact) <= (double)exact * max_error);
+    }
+
+    mean = hdr_histogram_get_mean(h);
+    T_CHECK(mean >= (double)sum / (double)n * (1.0 - max_error));
+    T_CHECK(mean <= (double)sum / (double)n * (1.0 + max_error));
+
+    hdr_histogram_reset(h);
+    T_EXPECT(hdr_histogram_get_count(h), 0);
+    T_EXPECT(hdr_histogram_get_quantile(h, 0.5), 0);
+    T_EXPECT(hdr_histogram_get_min(h), 0);
+    T_EXPECT(hdr_histogram_get_max(h), 0);
+
+    hdr_histogram_destroy(h);
+    FREE(values);
+}
+
+test_f test_hdr_concurrent(void)
+{
+    const size_t n = 100000;
+    pthread_t threads[THREADS];
+    Thread_arg args[THREADS];
+    uint64_t expected[ARRAY_SIZE(quantiles)];
+    uint64_t got[ARRAY_SIZE(quantiles)];
+    Hdr_histogram *h;
+    Hdr_histogram *single;
+    uint64_t *values;
+    size_t i;
+
+    values = (uint64_t *)malloc(THREADS * n * sizeof(uint64_t));
+    T_ERROR(values == NULL);
+
+    h = hdr_histogram_create(BIT(32), 8, 4);
+    T_ERROR(h == NULL);
+
+    single = hdr_histogram_create(BIT(32), 8, 1);
+    T_ERROR(single == NULL);
+
+    for (i = 0; i < THREADS * n; ++i)
+    {
+        values[i] = (uint64_t)rand() % BIT(20);
+        T_EXPECT(hdr_histogram_record(single, values[i]), 0);
+    }
+
+    /* more threads than shards, so shards are shared too */
+    for (i = 0; i < THREADS; ++i)
+    {
+        args[i].h = h;
+        args[i].values = values + i * n;
+        args[i].n = n;
+        T_ERROR(pthread_create(&threads[i], NULL, record_thread, &args[i]) != 0);
+    }
+
+    for (i = 0; i < THREADS; ++i)
+        (void)pthread_join(threads[i], NULL);
+
+    T_EXPECT(hdr_histogram_get_count(h), THREADS * n);
+    T_EXPECT(hdr_histogram_get_min(h), hdr_histogram_get_min(single));
+    T_EXPECT(hdr_histogram_get_max(h), hdr_histogram_get_max(single));
+
+    T_EXPECT(hdr_histogram_get_quantiles(h, quantiles, ARRAY_SIZE(quantiles), got), 0);
+    T_EXPECT(hdr_histogram_get_quantiles(single, quantiles, ARRAY_SIZE(quantiles), expected), 0);
+    T_EXPECT(memcmp(got, expected, sizeof(got)), 0);
+
+    hdr_histogram_destroy(h);
+    hdr_histogram_destroy(single);
+    FREE(values);
+}
+
+test_f test_hdr_merge(void)
+{
+    Hdr_histogram *h1;
+    Hdr_histogram *h2;
+    Hdr_histogram *other;
+    const double qs_unsorted[] = {0.9, 0.1};
+    uint64_t values[2];
+    uint64_t i;
+
+    h1 = hdr_histogram_create(1000, 7, 1);
+    T_ERROR(h1 == NULL);
+
+    h2 = hdr_histogram_create(1000, 7, 2);
+    T_ERROR(h2 == NULL);
+
+    other = hdr_histogram_create(1000, 8, 1);
+    T_ERROR(other == NULL);
+
+    /* values < 2^precision are exact */
+    for (i = 1; i <= 50; ++i)
+        T_EXPECT(hdr_histogram_record(h1, i), 0);
+
+    for (i = 51; i <= 100; ++i)
+        T_EXPECT(hdr_histogram_record_concurrent(h2, i), 0);
+
+    T_EXPECT(hdr_histogram_merge(h1, h2), 0);
+    T_EXPECT(hdr_histogram_get_count(h1), 100);
+    T_EXPECT(hdr_histogram_get_min(h1), 1);
+    T_EXPECT(hdr_histogram_get_max(h1), 100);
+    T_EXPECT(hdr_histogram_get_quantile(h1, 0.5), 50);
+    T_EXPECT(hdr_histogram_get_quantile(h1, 0.99), 99);
+
+    /* bigger than highest are clipped */
+    T_EXPECT(hdr_histogram_record_n(h1, 5000, 100), 0);
+    T_EXPECT(hdr_histogram_get_count(h1), 200);
+    T_EXPECT(hdr_histogram_get_max(h1), 1000);
+    T_EXPECT(hdr_histogram_get_quantile(h1, 1.0), 1000);
+
+    T_CHECK(hdr_histogram_merge(h1, other) != 0);
+    T_CHECK(hdr_histogram_merge(h1, h1) != 0);
+    T_CHECK(hdr_histogram_get_quantiles(h1, qs_unsorted, ARRAY_SIZE(qs_unsorted), values) != 0);
+
+    T_EXPECT(hdr_histogram_create(1000, 1, 1), NULL);
+    T_EXPECT(hdr_histogram_create(1000, 17, 1), NULL);
+    T_EXPECT(hdr_histogram_create(0, 8, 1), NULL);
+    T_EXPECT(hdr_histogram_create(1000, 8, 0), NULL);
+    T_CHECK(hdr_histogram_record(NULL, 1) != 0);
+
+    hdr_histogram_destroy(h1);
+    hdr_histogram_destroy(h2);
+    hdr_histogram_destroy(other);
+    hdr_histogram_destroy(NULL);
+}
+
+void test(void)
+{
+    TEST(test_tdigest_uniform(1000));
+    TEST(test_tdigest_uniform(100000));
+    TEST(test_tdigest_uniform(1000000));
+    TEST(test_tdigest_long_tail());
+    TEST(test_tdigest_merge());
+    TEST(test_tdigest_small());
+
+    TEST(test_hdr_accuracy(2));
+    TEST(test_hdr_accuracy(8));
+    TEST(test_hdr_accuracy(16));
+    TEST(test_hdr_concurrent());
+    TEST(test_hdr_merge());
+}
+
+int main(void)
+{
+    TEST_INIT("QUANTILE");
+    srand((unsigned)time(NULL));
+    test();
+    TEST_SUMMARY();
+}
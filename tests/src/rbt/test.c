@@ -348,6 +348,78 @@ test_f test_search(void)
     rbt_destroy(tree);
 }
 
+test_f test_search_batch(void)
+{
+    Rbt *tree;
+    int *t;
+    int *keys;
+    int *vals;
+    bool *found;
+    size_t size = BIT(10);
+    size_t num_keys = 3 * BIT(10);
+    size_t i;
+    size_t r;
+    ssize_t num_found = 0;
+
+    t = (int *)malloc(sizeof(int) * size);
+    T_ERROR(t == NULL);
+
+    keys = (int *)malloc(sizeof(int) * num_keys);
+    T_ERROR(keys == NULL);
+
+    vals = (int *)malloc(sizeof(int) * num_keys);
+    T_ERROR(vals == NULL);
+
+    found = (bool *)malloc(sizeof(bool) * num_keys);
+    T_ERROR(found == NULL);
+
+    for (i = 0; i < size; ++i)
+        t[i] = (int)(i + 1) * 2;
+
+    for (i = 0; i < size; ++i)
+    {
+        r = rand() % (size - i);
+        SWAP(t[r], t[size - i - 1]);
+    }
+
+    tree = rbt_create(sizeof(int), cmp_int, NULL);
+    T_ERROR(tree == NULL);
+
+    /* empty tree */
+    T_EXPECT(rbt_search_batch(tree, (void *)t, size, (void *)vals, found), 0);
+    T_EXPECT(found[0], false);
+
+    for (i = 0; i < size; ++i)
+        T_EXPECT(rbt_insert(tree, (void *)&t[i]), 0);
+
+    /* even keys exist, odd not, the same key many times */
+    for (i = 0; i < num_keys; ++i)
+    {
+        keys[i] = rand() % (int)(2 * size + 4);
+        num_found += keys[i] > 0 && keys[i] <= (int)(2 * size) && keys[i] % 2 == 0;
+    }
+
+    T_EXPECT(rbt_search_batch(tree, (void *)keys, num_keys, (void *)vals, found), num_found);
+    for (i = 0; i < num_keys; ++i)
+    {
+        T_ASSERT(found[i], rbt_key_exist(tree, (void *)&keys[i]));
+        if (found[i])
+            T_ASSERT(vals[i], keys[i]);
+    }
+
+    /* less keys than lanes, outputs are optional */
+    T_EXPECT(rbt_search_batch(tree, (void *)t, 3, NULL, NULL), 3);
+    T_EXPECT(rbt_search_batch(tree, (void *)keys, 0, NULL, NULL), -1);
+    T_EXPECT(rbt_search_batch(NULL, (void *)keys, 1, NULL, NULL), -1);
+    T_EXPECT(rbt_search_batch(tree, NULL, 1, NULL, NULL), -1);
+
+    FREE(t);
+    FREE(keys);
+    FREE(vals);
+    FREE(found);
+    rbt_destroy(tree);
+}
+
 test_f test_key_exist(void)
 {
     Rbt *tree;
@@ -1466,6 +1538,7 @@ void test(void)
     TEST(test_min_max());
     TEST(test_key_exist());
     TEST(test_search());
+    TEST(test_search_batch());
     TEST(test_delete());
     TEST(test_delete_with_entry());
     TEST(test_delete_with_entry_wo_destr());
@@ -0,0 +1,604 @@
+#include <reactor.h>
+#include <tcp.h>
+#include <test.h>
+#include <common.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <errno.h>
+#include <poll.h>
+
+#define MIN_PORT  8000
+#define RANGE     2000
+
+#define BIG_SIZE  (BIT(22) + 7)
+
+#define HALF_CLOSE_CLIENTS  50
+#define EMFILE_CLIENTS      8
+
+typedef struct Client_ctx
+{
+    const char  *msg;
+    size_t      msg_len;
+    char        *recv;
+    size_t      recv_len;
+    bool        opened;
+    bool        closed;
+} Client_ctx;
+
+typedef struct Server_ctx
+{
+    size_t      received;
+    size_t      max_input;
+    int         num_reads;
+    int         num_closed;
+    int         write_ret;
+} Server_ctx;
+
+typedef struct Timer_ctx
+{
+    int             fired;
+    int             order[8];
+    int             num_order;
+    Reactor_timer   *self;
+} Timer_ctx;
+
+static void echo_on_read(Reactor_conn *conn, void *arg)
+{
+    size_t len;
+    const void *data;
+
+    (void)arg;
+
+    data = reactor_conn_get_input(conn, &len);
+    T_EXPECT(reactor_conn_write(conn, data, len), 0);
+    T_EXPECT(reactor_conn_consume(conn, len), 0);
+}
+
+/* read once and close, peer should see on_close */
+static void close_on_read(Reactor_conn *conn, void *arg)
+{
+    (void)arg;
+
+    reactor_conn_close(conn);
+
+    /* closed connection is still valid in callback */
+    T_EXPECT(reactor_conn_get_fd(conn), -1);
+    T_CHECK(reactor_conn_write(conn, "x", 1) != 0);
+}
+
+static void count_on_read(Reactor_conn *conn, void *arg)
+{
+    Server_ctx *ctx = (Server_ctx *)arg;
+    size_t len;
+
+    (void)reactor_conn_get_input(conn, &len);
+    ctx->received += len;
+    ++ctx->num_reads;
+    T_EXPECT(reactor_conn_consume(conn, len), 0);
+}
+
+/* never consume, input grows to the limit */
+static void hold_on_read(Reactor_conn *conn, void *arg)
+{
+    Server_ctx *ctx = (Server_ctx *)arg;
+    size_t len;
+
+    (void)reactor_conn_get_input(conn, &len);
+    ctx->max_input = MAX(ctx->max_input, len);
+    ++ctx->num_reads;
+}
+
+static void big_write_on_open(Reactor_conn *conn, void *arg)
+{
+    Server_ctx *ctx = (Server_ctx *)arg;
+    char *big;
+
+    big = (char *)calloc(REACTOR_MAX_BUFFER + 1, 1);
+    T_ERROR(big == NULL);
+
+    ctx->write_ret = reactor_conn_write(conn, big, REACTOR_MAX_BUFFER + 1);
+
+    FREE(big);
+}
+
+static void server_on_close(Reactor_conn *conn, void *arg)
+{
+    (void)conn;
+
+    ++((Server_ctx *)arg)->num_closed;
+}
+
+static void client_on_open(Reactor_conn *conn, void *arg)
+{
+    Client_ctx *ctx = (Client_ctx *)arg;
+
+    ctx->opened = true;
+    T_EXPECT(reactor_conn_write(conn, ctx->msg, ctx->msg_len), 0);
+}
+
+static void client_on_read(Reactor_conn *conn, void *arg)
+{
+    Client_ctx *ctx = (Client_ctx *)arg;
+    size_t len;
+    const void *data;
+
+    data = reactor_conn_get_input(conn, &len);
+    T_ERROR(ctx->recv_len + len > ctx->msg_len);
+
+    (void)memcpy(ctx->recv + ctx->recv_len, data, len);
+    ctx->recv_len += len;
+    T_EXPECT(reactor_conn_consume(conn, len), 0);
+
+    if (ctx->recv_len == ctx->msg_len)
+        reactor_stop(reactor_conn_get_reactor(conn));
+}
+
+static void client_on_close(Reactor_conn *conn, void *arg)
+{
+    Client_ctx *ctx = (Client_ctx *)arg;
+
+    ctx->closed = true;
+    reactor_stop(reactor_conn_get_reactor(conn));
+}
+
+static void timeout_cb(Reactor *reactor, Reactor_timer *timer, void *arg)
+{
+    (void)timer;
+
+    *(bool *)arg = true;
+    reactor_stop(reactor);
+}
+
+static void order_cb(Reactor *reactor, Reactor_timer *timer, void *arg)
+{
+    Timer_ctx *ctx = (Timer_ctx *)arg;
+
+    (void)reactor;
+    (void)timer;
+
+    ctx->order[ctx->num_order++] = ctx->fired++;
+}
+
+static void periodic_cb(Reactor *reactor, Reactor_timer *timer, void *arg)
+{
+    Timer_ctx *ctx = (Timer_ctx *)arg;
+
+    T_CHECK(timer == ctx->self);
+
+    if (++ctx->fired == 5)
+    {
+        reactor_timer_cancel(timer);
+        reactor_stop(reactor);
+    }
+}
+
+static void fail_cb(Reactor *reactor, Reactor_timer *timer, void *arg)
+{
+    (void)reactor;
+    (void)timer;
+    (void)arg;
+
+    T_CHECK(false);
+}
+
+/* client and server in one reactor */
+static void test_echo_size(size_t size)
+{
+    const int port = MIN_PORT + rand() % RANGE;
+    const Reactor_handlers server = { .on_read = echo_on_read };
+    Reactor_handlers client = { .on_open = client_on_open, .on_read = client_on_read };
+    Client_ctx ctx = {0};
+    Reactor *reactor;
+    Reactor_conn *conn;
+    Reactor_timer *timeout;
+    char *msg;
+    bool expired = false;
+    size_t i;
+
+    msg = (char *)malloc(size);
+    T_ERROR(msg == NULL);
+
+    for (i = 0; i < size; ++i)
+        msg[i] = (char)(i % 251);
+
+    ctx.msg = msg;
+    ctx.msg_len = size;
+    ctx.recv = (char *)calloc(size, 1);
+    T_ERROR(ctx.recv == NULL);
+
+    reactor = reactor_create();
+    T_ERROR(reactor == NULL);
+
+    T_EXPECT(reactor_listen(reactor, "localhost", port, &server, false), 0);
+
+    client.arg = (void *)&ctx;
+    conn = reactor_connect(reactor, "localhost", port, &client);
+    T_ERROR(conn == NULL);
+
+    timeout = reactor_timer_add(reactor, 10000, 0, timeout_cb, (void *)&expired);
+    T_ERROR(timeout == NULL);
+
+    T_EXPECT(reactor_run(reactor), 0);
+
+    T_EXPECT(expired, false);
+    T_EXPECT(ctx.opened, true);
+    T_EXPECT(ctx.recv_len, size);
+    T_EXPECT(memcmp(ctx.recv, msg, size), 0);
+    T_EXPECT(reactor_conn_get_pending(conn), 0);
+
+    /* client + accepted */
+    T_EXPECT(reactor_get_num_conns(reactor), 2);
+
+    reactor_timer_cancel(timeout);
+    T_EXPECT(reactor_get_num_timers(reactor), 0);
+
+    reactor_destroy(reactor);
+
+    FREE(msg);
+    FREE(ctx.recv);
+}
+
+test_f test_create(void)
+{
+    Reactor *reactor;
+    const Reactor_handlers handlers = {0};
+
+    reactor = reactor_create();
+    T_ERROR(reactor == NULL);
+
+    T_EXPECT(reactor_get_num_conns(reactor), 0);
+    T_EXPECT(reactor_get_num_timers(reactor), 0);
+
+    /* nothing to do */
+    T_EXPECT(reactor_run_once(reactor, 0), 0);
+
+    T_CHECK(reactor_listen(reactor, NULL, MIN_PORT, &handlers, false) != 0);
+    T_CHECK(reactor_timer_add(reactor, 0, 0, NULL, NULL) == NULL);
+
+    reactor_destroy(reactor);
+}
+
+test_f test_echo(void)
+{
+    test_echo_size(sizeof("Kukos"));
+}
+
+test_f test_echo_big(void)
+{
+    /* more than socket buffers, output is buffered and sent on EPOLLOUT */
+    test_echo_size(BIG_SIZE);
+}
+
+test_f test_close_by_peer(void)
+{
+    const int port = MIN_PORT + rand() % RANGE;
+    const Reactor_handlers server = { .on_read = close_on_read };
+    Reactor_handlers client = { .on_open = client_on_open, .on_close = client_on_close };
+    Client_ctx ctx = {0};
+    Reactor *reactor;
+    bool expired = false;
+
+    ctx.msg = "Kukos";
+    ctx.msg_len = strlen(ctx.msg);
+    client.arg = (void *)&ctx;
+
+    reactor = reactor_create();
+    T_ERROR(reactor == NULL);
+
+    T_EXPECT(reactor_listen(reactor, "localhost", port, &server, false), 0);
+    T_ERROR(reactor_connect(reactor, "localhost", port, &client) == NULL);
+    T_ERROR(reactor_timer_add(reactor, 10000, 0, timeout_cb, (void *)&expired) == NULL);
+
+    T_EXPECT(reactor_run(reactor), 0);
+
+    T_EXPECT(expired, false);
+    T_EXPECT(ctx.opened, true);
+    T_EXPECT(ctx.closed, true);
+    T_EXPECT(reactor_get_num_conns(reactor), 0);
+
+    reactor_destroy(reactor);
+}
+
+test_f test_connect_refused(void)
+{
+    const int port = MIN_PORT + rand() % RANGE;
+    Reactor_handlers client = { .on_open = client_on_open, .on_close = client_on_close };
+    Client_ctx ctx = {0};
+    Reactor *reactor;
+    bool expired = false;
+
+    ctx.msg = "Kukos";
+    ctx.msg_len = strlen(ctx.msg);
+    client.arg = (void *)&ctx;
+
+    reactor = reactor_create();
+    T_ERROR(reactor == NULL);
+
+    /* nobody listens */
+    if (reactor_connect(reactor, "localhost", port, &client) != NULL)
+    {
+        T_ERROR(reactor_timer_add(reactor, 10000, 0, timeout_cb, (void *)&expired) == NULL);
+        T_EXPECT(reactor_run(reactor), 0);
+
+        T_EXPECT(expired, false);
+        T_EXPECT(ctx.opened, false);
+        T_EXPECT(ctx.closed, true);
+    }
+
+    T_EXPECT(reactor_get_num_conns(reactor), 0);
+    reactor_destroy(reactor);
+}
+
+test_f test_timers(void)
+{
+    Reactor *reactor;
+    Reactor_timer *timer;
+    Timer_ctx order = {0};
+    Timer_ctx periodic = {0};
+    bool expired = false;
+
+    reactor = reactor_create();
+    T_ERROR(reactor == NULL);
+
+    /* the same deadline, fired in insertion order */
+    T_ERROR(reactor_timer_add(reactor, 0, 0, order_cb, (void *)&order) == NULL);
+    T_ERROR(reactor_timer_add(reactor, 0, 0, order_cb, (void *)&order) == NULL);
+    T_ERROR(reactor_timer_add(reactor, 0, 0, order_cb, (void *)&order) == NULL);
+
+    /* canceled before expiration */
+    timer = reactor_timer_add(reactor, 1, 0, fail_cb, NULL);
+    T_ERROR(timer == NULL);
+    T_EXPECT(reactor_get_num_timers(reactor), 4);
+    reactor_timer_cancel(timer);
+    T_EXPECT(reactor_get_num_timers(reactor), 3);
+
+    periodic.self = reactor_timer_add(reactor, 2, 2, periodic_cb, (void *)&periodic);
+    T_ERROR(periodic.self == NULL);
+
+    T_ERROR(reactor_timer_add(reactor, 10000, 0, timeout_cb, (void *)&expired) == NULL);
+
+    T_EXPECT(reactor_run(reactor), 0);
+
+    T_EXPECT(expired, false);
+    T_EXPECT(order.fired, 3);
+    T_EXPECT(order.order[0], 0);
+    T_EXPECT(order.order[1], 1);
+    T_EXPECT(order.order[2], 2);
+    T_EXPECT(periodic.fired, 5);
+
+    /* only timeout, destroy frees it */
+    T_EXPECT(reactor_get_num_timers(reactor), 1);
+
+    reactor_destroy(reactor);
+}
+
+test_f test_pool(void)
+{
+    const int port = MIN_PORT + rand() % RANGE;
+    const Reactor_handlers server = { .on_read = echo_on_read };
+    const char msg[] = "C Master";
+    char buffer[sizeof(msg)];
+    Reactor_pool *pool;
+    int sockets[8];
+    size_t i;
+    ssize_t n;
+    ssize_t r;
+
+    T_CHECK(reactor_pool_create(0) == NULL);
+
+    pool = reactor_pool_create(2);
+    T_ERROR(pool == NULL);
+
+    T_CHECK(reactor_pool_get(pool, 0) != NULL);
+    T_CHECK(reactor_pool_get(pool, 2) == NULL);
+
+    T_EXPECT(reactor_pool_listen(pool, "localhost", port, &server), 0);
+    T_EXPECT(reactor_pool_start(pool), 0);
+    T_CHECK(reactor_pool_start(pool) != 0);
+
+    /* blocking clients */
+    for (i = 0; i < ARRAY_SIZE(sockets); ++i)
+    {
+        sockets[i] = tcp_request_connection("localhost", port);
+        T_ERROR(sockets[i] == -1);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(sockets); ++i)
+    {
+        T_EXPECT(send(sockets[i], msg, sizeof(msg), 0), (ssize_t)sizeof(msg));
+
+        n = 0;
+        while (n < (ssize_t)sizeof(msg))
+        {
+            r = recv(sockets[i], buffer + n, sizeof(buffer) - (size_t)n, 0);
+            T_ERROR(r <= 0);
+            n += r;
+        }
+
+        T_EXPECT(memcmp(buffer, msg, sizeof(msg)), 0);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(sockets); ++i)
+        tcp_socket_destroy(sockets[i]);
+
+    reactor_pool_destroy(pool);
+}
+
+/* data and FIN come in the same event, connection has to be closed after short read */
+test_f test_half_close(void)
+{
+    const int port = MIN_PORT + rand() % RANGE;
+    Reactor_handlers server = { .on_read = count_on_read, .on_close = server_on_close };
+    Server_ctx ctx = {0};
+    Reactor *reactor;
+    int sockets[HALF_CLOSE_CLIENTS];
+    size_t i;
+    int loops;
+
+    server.arg = (void *)&ctx;
+
+    reactor = reactor_create();
+    T_ERROR(reactor == NULL);
+
+    T_EXPECT(reactor_listen(reactor, "localhost", port, &server, false), 0);
+
+    for (i = 0; i < ARRAY_SIZE(sockets); ++i)
+    {
+        sockets[i] = tcp_request_connection("localhost", port);
+        T_ERROR(sockets[i] == -1);
+        T_EXPECT(send(sockets[i], "hello", 5, 0), 5);
+        T_EXPECT(shutdown(sockets[i], SHUT_WR), 0);
+    }
+
+    for (loops = 0; loops < 100 && ctx.num_closed < HALF_CLOSE_CLIENTS; ++loops)
+        T_CHECK(reactor_run_once(reactor, 100) >= 0);
+
+    T_EXPECT(ctx.num_closed, HALF_CLOSE_CLIENTS);
+    T_EXPECT(ctx.received, (size_t)HALF_CLOSE_CLIENTS * 5);
+    T_EXPECT(reactor_get_num_conns(reactor), 0);
+
+    for (i = 0; i < ARRAY_SIZE(sockets); ++i)
+        tcp_socket_destroy(sockets[i]);
+
+    reactor_destroy(reactor);
+}
+
+test_f test_buffer_limit(void)
+{
+    const int port = MIN_PORT + rand() % RANGE;
+    Reactor_handlers server = { .on_open = big_write_on_open, .on_read = hold_on_read, .on_close = server_on_close };
+    Server_ctx ctx = {0};
+    Reactor *reactor;
+    char *chunk;
+    size_t sent = 0;
+    ssize_t n;
+    int fd;
+    int loops;
+
+    server.arg = (void *)&ctx;
+    ctx.write_ret = -1;
+
+    chunk = (char *)calloc(REACTOR_READ_CHUNK, 1);
+    T_ERROR(chunk == NULL);
+
+    reactor = reactor_create();
+    T_ERROR(reactor == NULL);
+
+    T_EXPECT(reactor_listen(reactor, "localhost", port, &server, false), 0);
+
+    fd = tcp_request_connection("localhost", port);
+    T_ERROR(fd == -1);
+    T_EXPECT(tcp_set_nonblocking(fd), 0);
+
+    /* client sends more than server can hold, server never consumes */
+    for (loops = 0; loops < 10000 && ctx.num_closed == 0; ++loops)
+    {
+        n = send(fd, chunk, REACTOR_READ_CHUNK, MSG_NOSIGNAL);
+        if (n > 0)
+            sent += (size_t)n;
+        else
+            T_CHECK(errno == EAGAIN || errno == EPIPE || errno == ECONNRESET);
+
+        T_CHECK(reactor_run_once(reactor, 1) >= 0);
+    }
+
+    /* output over limit is rejected */
+    T_CHECK(ctx.write_ret != 0);
+
+    T_EXPECT(ctx.num_closed, 1);
+    T_EXPECT(ctx.max_input, REACTOR_MAX_BUFFER);
+    T_CHECK(sent >= REACTOR_MAX_BUFFER);
+    T_EXPECT(reactor_get_num_conns(reactor), 0);
+
+    tcp_socket_destroy(fd);
+    reactor_destroy(reactor);
+    FREE(chunk);
+}
+
+/* out of descriptors, connections from listen queue are dropped instead of waiting forever */
+test_f test_accept_emfile(void)
+{
+    const int port = MIN_PORT + rand() % RANGE;
+    Reactor_handlers server = { .on_close = server_on_close };
+    Server_ctx ctx = {0};
+    Reactor *reactor;
+    struct rlimit old_limit;
+    struct rlimit limit;
+    struct pollfd pfd;
+    int sockets[EMFILE_CLIENTS];
+    char c;
+    size_t i;
+    int dropped = 0;
+    int fd;
+
+    server.arg = (void *)&ctx;
+
+    reactor = reactor_create();
+    T_ERROR(reactor == NULL);
+
+    T_EXPECT(reactor_listen(reactor, "localhost", port, &server, false), 0);
+
+    for (i = 0; i < ARRAY_SIZE(sockets); ++i)
+    {
+        sockets[i] = tcp_request_connection("localhost", port);
+        T_ERROR(sockets[i] == -1);
+    }
+
+    /* lowest free descriptor is the only one which can be opened */
+    fd = dup(0);
+    T_ERROR(fd == -1);
+    close(fd);
+
+    T_ERROR(getrlimit(RLIMIT_NOFILE, &old_limit) != 0);
+    limit = old_limit;
+    limit.rlim_cur = (rlim_t)fd + 1;
+    T_ERROR(setrlimit(RLIMIT_NOFILE, &limit) != 0);
+
+    T_CHECK(reactor_run_once(reactor, 1000) >= 0);
+
+    T_EXPECT(setrlimit(RLIMIT_NOFILE, &old_limit), 0);
+
+    T_EXPECT(reactor_get_num_conns(reactor), 1);
+
+    for (i = 0; i < ARRAY_SIZE(sockets); ++i)
+    {
+        pfd.fd = sockets[i];
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, 100) == 1 && recv(sockets[i], &c, 1, MSG_DONTWAIT) <= 0)
+            ++dropped;
+    }
+
+    T_EXPECT(dropped, EMFILE_CLIENTS - 1);
+
+    for (i = 0; i < ARRAY_SIZE(sockets); ++i)
+        tcp_socket_destroy(sockets[i]);
+
+    reactor_destroy(reactor);
+    T_EXPECT(ctx.num_closed, 1);
+}
+
+void test(void)
+{
+    TEST(test_create());
+    TEST(test_echo());
+    TEST(test_echo_big());
+    TEST(test_close_by_peer());
+    TEST(test_connect_refused());
+    TEST(test_timers());
+    TEST(test_pool());
+    TEST(test_half_close());
+    TEST(test_buffer_limit());
+    TEST(test_accept_emfile());
+}
+
+int main(void)
+{
+    TEST_INIT("REACTOR");
+    test();
+    TEST_SUMMARY();
+}
@@ -0,0 +1,356 @@
+#include <roaring.h>
+#include <test.h>
+#include <generic.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* reference set on plain array of bools */
+#define REF_SIZE BIT(18)
+
+static void fill_random(Roaring *r, bool *ref, size_t n, uint32_t mod)
+{
+    size_t i;
+    uint32_t val;
+
+    for (i = 0; i < n; ++i)
+    {
+        val = (uint32_t)rand() % mod;
+        (void)roaring_add(r, val);
+        ref[val] = true;
+    }
+}
+
+static size_t ref_cardinality(const bool *ref)
+{
+    size_t i;
+    size_t card = 0;
+
+    for (i = 0; i < REF_SIZE; ++i)
+        card += ref[i];
+
+    return card;
+}
+
+static bool ref_equal(const Roaring *r, const bool *ref)
+{
+    size_t i;
+
+    for (i = 0; i < REF_SIZE; ++i)
+        if (roaring_contains(r, (uint32_t)i) != ref[i])
+            return false;
+
+    return (size_t)roaring_get_cardinality(r) == ref_cardinality(ref);
+}
+
+test_f test_create(void)
+{
+    Roaring *r = roaring_create();
+    uint32_t val;
+    T_ERROR(r == NULL);
+
+    T_EXPECT(roaring_get_cardinality(r), 0);
+    T_CHECK(roaring_contains(r, 0) == false);
+    T_CHECK(roaring_min(r, &val) != 0);
+    T_CHECK(roaring_max(r, &val) != 0);
+
+    roaring_destroy(r);
+}
+
+test_f test_add_remove(void)
+{
+    const uint32_t values[] = {0, 1, 100, 65535, 65536, 1000000, UINT32_MAX};
+    Roaring *r = roaring_create();
+    uint32_t val;
+    size_t i;
+    T_ERROR(r == NULL);
+
+    for (i = 0; i < ARRAY_SIZE(values); ++i)
+        T_EXPECT(roaring_add(r, values[i]), 0);
+
+    /* duplicates */
+    for (i = 0; i < ARRAY_SIZE(values); ++i)
+        T_EXPECT(roaring_add(r, values[i]), 0);
+
+    T_EXPECT(roaring_get_cardinality(r), ARRAY_SIZE(values));
+    for (i = 0; i < ARRAY_SIZE(values); ++i)
+        T_CHECK(roaring_contains(r, values[i]));
+
+    T_CHECK(roaring_contains(r, 2) == false);
+    T_CHECK(roaring_contains(r, 65537) == false);
+
+    T_EXPECT(roaring_min(r, &val), 0);
+    T_ASSERT(val, 0);
+    T_EXPECT(roaring_max(r, &val), 0);
+    T_ASSERT(val, UINT32_MAX);
+
+    for (i = 0; i < ARRAY_SIZE(values); ++i)
+    {
+        T_EXPECT(roaring_remove(r, values[i]), 0);
+        T_CHECK(roaring_contains(r, values[i]) == false);
+        T_EXPECT(roaring_get_cardinality(r), ARRAY_SIZE(values) - i - 1);
+    }
+
+    T_EXPECT(roaring_remove(r, 5), 0);
+
+    roaring_destroy(r);
+}
+
+test_f test_dense(void)
+{
+    bool *ref = (bool *)calloc(REF_SIZE, sizeof(bool));
+    Roaring *r = roaring_create();
+    size_t i;
+    T_ERROR(r == NULL);
+    T_ERROR(ref == NULL);
+
+    /* > 4096 values in one chunk -> bitmap container */
+    for (i = 0; i < 10000; ++i)
+    {
+        T_EXPECT(roaring_add(r, (uint32_t)(i * 3)), 0);
+        ref[i * 3] = true;
+    }
+    T_CHECK(ref_equal(r, ref));
+
+    /* back to array */
+    for (i = 0; i < 8000; ++i)
+    {
+        T_EXPECT(roaring_remove(r, (uint32_t)(i * 3)), 0);
+        ref[i * 3] = false;
+    }
+    T_CHECK(ref_equal(r, ref));
+
+    fill_random(r, ref, 50000, REF_SIZE);
+    T_CHECK(ref_equal(r, ref));
+
+    roaring_destroy(r);
+    FREE(ref);
+}
+
+test_f test_run_optimize(void)
+{
+    bool *ref = (bool *)calloc(REF_SIZE, sizeof(bool));
+    Roaring *r = roaring_create();
+    ssize_t size_before;
+    size_t i;
+    T_ERROR(r == NULL);
+    T_ERROR(ref == NULL);
+
+    for (i = 1000; i < 70000; ++i)
+    {
+        T_EXPECT(roaring_add(r, (uint32_t)i), 0);
+        ref[i] = true;
+    }
+    for (i = 100000; i < 100010; ++i)
+    {
+        T_EXPECT(roaring_add(r, (uint32_t)i), 0);
+        ref[i] = true;
+    }
+
+    size_before = roaring_serialized_size(r);
+    T_EXPECT(roaring_run_optimize(r), 0);
+    T_CHECK(roaring_serialized_size(r) < size_before);
+    T_CHECK(ref_equal(r, ref));
+
+    /* modify run containers */
+    T_EXPECT(roaring_remove(r, 5000), 0);
+    ref[5000] = false;
+    T_EXPECT(roaring_add(r, 100020), 0);
+    ref[100020] = true;
+    T_CHECK(ref_equal(r, ref));
+
+    roaring_destroy(r);
+    FREE(ref);
+}
+
+test_f test_set_operations(void)
+{
+    bool *ref1 = (bool *)calloc(REF_SIZE, sizeof(bool));
+    bool *ref2 = (bool *)calloc(REF_SIZE, sizeof(bool));
+    bool *ref = (bool *)calloc(REF_SIZE, sizeof(bool));
+    Roaring *r1 = roaring_create();
+    Roaring *r2 = roaring_create();
+    Roaring *r;
+    size_t i;
+    T_ERROR(r1 == NULL);
+    T_ERROR(r2 == NULL);
+    T_ERROR(ref1 == NULL || ref2 == NULL || ref == NULL);
+
+    /* sparse, dense and run chunks */
+    fill_random(r1, ref1, 3000, REF_SIZE);
+    fill_random(r2, ref2, 3000, REF_SIZE);
+    for (i = 0; i < 20000; ++i)
+    {
+        (void)roaring_add(r1, (uint32_t)(65536 + i * 2));
+        ref1[65536 + i * 2] = true;
+    }
+    for (i = 10000; i < 50000; ++i)
+    {
+        (void)roaring_add(r2, (uint32_t)(65536 + i));
+        ref2[65536 + i] = true;
+    }
+    T_EXPECT(roaring_run_optimize(r2), 0);
+
+    r = roaring_union(r1, r2);
+    T_ERROR(r == NULL);
+    for (i = 0; i < REF_SIZE; ++i)
+        ref[i] = ref1[i] || ref2[i];
+    T_CHECK(ref_equal(r, ref));
+    roaring_destroy(r);
+
+    r = roaring_intersection(r1, r2);
+    T_ERROR(r == NULL);
+    for (i = 0; i < REF_SIZE; ++i)
+        ref[i] = ref1[i] && ref2[i];
+    T_CHECK(ref_equal(r, ref));
+    roaring_destroy(r);
+
+    r = roaring_difference(r1, r2);
+    T_ERROR(r == NULL);
+    for (i = 0; i < REF_SIZE; ++i)
+        ref[i] = ref1[i] && !ref2[i];
+    T_CHECK(ref_equal(r, ref));
+    roaring_destroy(r);
+
+    r = roaring_clone(r2);
+    T_ERROR(r == NULL);
+    T_CHECK(ref_equal(r, ref2));
+    roaring_destroy(r);
+
+    roaring_destroy(r1);
+    roaring_destroy(r2);
+    FREE(ref1);
+    FREE(ref2);
+    FREE(ref);
+}
+
+test_f test_foreach(void)
+{
+    const uint32_t values[] = {7, 3, 100000, 65536, 200, 1 << 20, 99};
+    uint32_t sorted[ARRAY_SIZE(values)];
+    uint32_t *array;
+    uint32_t val;
+    uint32_t node;
+    size_t size;
+    size_t i;
+    size_t j;
+    Roaring *r = roaring_create_from_array(values, ARRAY_SIZE(values));
+    T_ERROR(r == NULL);
+
+    (void)memcpy(sorted, values, sizeof(values));
+    for (i = 0; i < ARRAY_SIZE(sorted); ++i)
+        for (j = i + 1; j < ARRAY_SIZE(sorted); ++j)
+            if (sorted[j] < sorted[i])
+                SWAP(sorted[i], sorted[j]);
+
+    i = 0;
+    for_each(r, Roaring, node, val)
+    {
+        T_ASSERT(val, sorted[i]);
+        T_ASSERT(node, sorted[i]);
+        ++i;
+    }
+    T_ASSERT(i, ARRAY_SIZE(sorted));
+
+    i = ARRAY_SIZE(sorted);
+    for_each_prev(r, Roaring, node, val)
+    {
+        --i;
+        T_ASSERT(val, sorted[i]);
+    }
+    T_ASSERT(i, 0);
+
+    /* iteration over bitmap and run containers */
+    for (i = 0; i < 5000; ++i)
+        (void)roaring_add(r, (uint32_t)(i * 2));
+
+    array = roaring_to_array(r, &size);
+    T_ERROR(array == NULL);
+    T_ASSERT(size, (size_t)roaring_get_cardinality(r));
+
+    i = 0;
+    for_each_data(r, Roaring, val)
+        T_ASSERT(val, array[i++]);
+    T_ASSERT(i, size);
+
+    T_EXPECT(roaring_run_optimize(r), 0);
+    i = size;
+    for_each_data_prev(r, Roaring, val)
+        T_ASSERT(val, array[--i]);
+    T_ASSERT(i, 0);
+
+    FREE(array);
+    roaring_destroy(r);
+}
+
+test_f test_serialize(void)
+{
+    bool *ref = (bool *)calloc(REF_SIZE, sizeof(bool));
+    Roaring *r = roaring_create();
+    Roaring *r2;
+    BYTE *buf;
+    ssize_t size;
+    size_t i;
+    T_ERROR(r == NULL);
+    T_ERROR(ref == NULL);
+
+    fill_random(r, ref, 2000, REF_SIZE);
+    for (i = 70000; i < 80000; ++i)
+    {
+        (void)roaring_add(r, (uint32_t)i);
+        ref[i] = true;
+    }
+    for (i = 140000; i < 190000; i += 5)
+    {
+        (void)roaring_add(r, (uint32_t)i);
+        ref[i] = true;
+    }
+    T_EXPECT(roaring_run_optimize(r), 0);
+
+    size = roaring_serialized_size(r);
+    T_ERROR(size <= 0);
+
+    /* +1 to test unaligned buffer */
+    buf = (BYTE *)malloc((size_t)size + 1);
+    T_ERROR(buf == NULL);
+
+    T_EXPECT(roaring_serialize(r, buf + 1, (size_t)size - 1), -1);
+    T_EXPECT(roaring_serialize(r, buf + 1, (size_t)size), size);
+
+    r2 = roaring_deserialize(buf + 1, (size_t)size);
+    T_ERROR(r2 == NULL);
+    T_CHECK(ref_equal(r2, ref));
+    roaring_destroy(r2);
+
+    for (i = 0; i < REF_SIZE; ++i)
+        T_ASSERT(roaring_serialized_contains(buf + 1, (size_t)size, (uint32_t)i), (int)ref[i]);
+
+    T_EXPECT(roaring_serialized_contains(buf + 1, (size_t)size, (uint32_t)REF_SIZE * 2), 0);
+
+    /* corrupted buffers */
+    T_CHECK(roaring_deserialize(buf + 1, (size_t)size - 1) == NULL);
+    buf[1] ^= 0xFF;
+    T_CHECK(roaring_deserialize(buf + 1, (size_t)size) == NULL);
+    T_EXPECT(roaring_serialized_contains(buf + 1, (size_t)size, 0), -1);
+
+    FREE(buf);
+    roaring_destroy(r);
+    FREE(ref);
+}
+
+void test(void)
+{
+    TEST(test_create());
+    TEST(test_add_remove());
+    TEST(test_dense());
+    TEST(test_run_optimize());
+    TEST(test_set_operations());
+    TEST(test_foreach());
+    TEST(test_serialize());
+}
+
+int main(void)
+{
+    TEST_INIT("ROARING");
+    test();
+    TEST_SUMMARY();
+}
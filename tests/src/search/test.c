@@ -1,9 +1,90 @@
 #include <search.h>
 #include <test.h>
 #include <common.h>
+#include <stdlib.h>
+#include <limits.h>
 
 CMP(int)
 CMP(char)
+CMP(long)
+
+/* check typed searches with linear scan as reference, keys from [min - 1, max + 1] */
+#define TEST_TYPED(TYPE, SUFFIX) \
+static void check_typed_##SUFFIX(TYPE *t, size_t n, TYPE key) \
+{ \
+    ssize_t first = -1; \
+    ssize_t last = -1; \
+    size_t lower = 0; \
+    size_t upper = 0; \
+    size_t i; \
+    \
+    for (i = 0; i < n; ++i) \
+    { \
+        if (t[i] == key) \
+        { \
+            if (first == -1) \
+                first = (ssize_t)i; \
+            last = (ssize_t)i; \
+        } \
+        \
+        lower += t[i] < key; \
+        upper += t[i] <= key; \
+    } \
+    \
+    T_EXPECT(find_first_sorted_##SUFFIX(key, t, n), first); \
+    T_EXPECT(find_last_sorted_##SUFFIX(key, t, n), last); \
+    T_EXPECT(find_lower_bound_##SUFFIX(key, t, n), (ssize_t)lower); \
+    T_EXPECT(find_upper_bound_##SUFFIX(key, t, n), (ssize_t)upper); \
+    T_EXPECT(find_first_interpolation_##SUFFIX(key, t, n), first); \
+    T_EXPECT(find_first_unsorted_##SUFFIX(key, t, n), first); \
+    T_EXPECT(find_last_unsorted_##SUFFIX(key, t, n), last); \
+} \
+\
+static void test_typed_##SUFFIX(size_t n, TYPE step) \
+{ \
+    TYPE *t; \
+    TYPE key; \
+    size_t i; \
+    \
+    t = (TYPE *)malloc(n * sizeof(TYPE)); \
+    T_ERROR(t == NULL); \
+    \
+    /* sorted with duplicates, step makes keys far from uniform */ \
+    t[0] = (TYPE)1; \
+    for (i = 1; i < n; ++i) \
+        t[i] = (TYPE)(t[i - 1] + (TYPE)(rand() % 3) * (i % 8 == 0 ? step : (TYPE)1)); \
+    \
+    for (key = (TYPE)0; key <= (TYPE)(t[n - 1] + 1); key = (TYPE)(key + (key < (TYPE)64 ? (TYPE)1 : step / 4 + 1))) \
+        check_typed_##SUFFIX(t, n, key); \
+    \
+    /* unsorted, values from small range */ \
+    for (i = 0; i < n; ++i) \
+        t[i] = (TYPE)(rand() % 16); \
+    \
+    for (key = (TYPE)0; key <= (TYPE)17; ++key) \
+    { \
+        ssize_t first = -1; \
+        ssize_t last = -1; \
+        \
+        for (i = 0; i < n; ++i) \
+            if (t[i] == key) \
+            { \
+                if (first == -1) \
+                    first = (ssize_t)i; \
+                last = (ssize_t)i; \
+            } \
+        \
+        T_EXPECT(find_first_unsorted_##SUFFIX(key, t, n), first); \
+        T_EXPECT(find_last_unsorted_##SUFFIX(key, t, n), last); \
+    } \
+    \
+    FREE(t); \
+}
+
+TEST_TYPED(int, int)
+TEST_TYPED(unsigned int, uint)
+TEST_TYPED(long, long)
+TEST_TYPED(unsigned long, ulong)
 
 test_f test_find_first_unsorted(void)
 {
@@ -81,6 +162,167 @@ test_f test_find_last_sorted(void)
         T_EXPECT(find_last_sorted((void *)(f2 + i), t2, ARRAY_SIZE(t2) - 1, cmp_char, sizeof(char)), pos2[i]);
 }
 
+test_f test_typed(void)
+{
+    size_t n;
+
+    /* all tails of SIMD blocks and small ranges */
+    for (n = 1; n < 70; ++n)
+    {
+        test_typed_int(n, 1);
+        test_typed_uint(n, 1);
+        test_typed_long(n, 1);
+        test_typed_ulong(n, 1);
+    }
+
+    test_typed_int(10000, 1);
+    test_typed_int(10000, 1000);
+    test_typed_uint(10000, 1000);
+    test_typed_long(10000, 100000);
+    test_typed_ulong(10000, 100000);
+}
+
+test_f test_sorted_random(void)
+{
+    const size_t n = 1000;
+    int t[1000];
+    int key;
+    ssize_t first;
+    ssize_t last;
+    size_t i;
+
+    t[0] = 0;
+    for (i = 1; i < n; ++i)
+        t[i] = t[i - 1] + rand() % 3;
+
+    for (key = -1; key <= t[n - 1] + 1; ++key)
+    {
+        first = -1;
+        last = -1;
+        for (i = 0; i < n; ++i)
+            if (t[i] == key)
+            {
+                if (first == -1)
+                    first = (ssize_t)i;
+                last = (ssize_t)i;
+            }
+
+        T_EXPECT(find_first_sorted((void *)&key, t, n, cmp_int, sizeof(int)), first);
+        T_EXPECT(find_last_sorted((void *)&key, t, n, cmp_int, sizeof(int)), last);
+    }
+}
+
+test_f test_find_first_sorted_batch(void)
+{
+    int t[1000];
+    int keys[1100];
+    ssize_t pos[1100];
+    ssize_t num_found;
+    size_t num_keys;
+    size_t n;
+    size_t i;
+
+    for (n = 1; n <= ARRAY_SIZE(t); n = n < 40 ? n + 1 : n * 3)
+    {
+        n = MIN(n, ARRAY_SIZE(t));
+
+        t[0] = 0;
+        for (i = 1; i < n; ++i)
+            t[i] = t[i - 1] + rand() % 3;
+
+        /* number of keys is not multiple of lanes */
+        num_keys = n + 37;
+        num_found = 0;
+        for (i = 0; i < num_keys; ++i)
+        {
+            keys[i] = rand() % (t[n - 1] + 3) - 1;
+            num_found += find_first_sorted((void *)&keys[i], t, n, cmp_int, sizeof(int)) != -1;
+        }
+
+        T_EXPECT(find_first_sorted_batch(keys, num_keys, t, n, cmp_int, sizeof(int), pos), num_found);
+        for (i = 0; i < num_keys; ++i)
+            T_EXPECT(pos[i], find_first_sorted((void *)&keys[i], t, n, cmp_int, sizeof(int)));
+
+        if (n == ARRAY_SIZE(t))
+            break;
+    }
+
+    T_EXPECT(find_first_sorted_batch(keys, 0, t, n, cmp_int, sizeof(int), pos), -1);
+    T_EXPECT(find_first_sorted_batch(keys, 1, t, 0, cmp_int, sizeof(int), pos), -1);
+    T_EXPECT(find_first_sorted_batch(keys, 1, t, n, cmp_int, sizeof(int), NULL), -1);
+}
+
+test_f test_interpolation_extremes(void)
+{
+    long t[1000];
+    unsigned long u[3] = {0, 1, ULONG_MAX};
+    size_t i;
+
+    /* exponential keys, interpolation is always wrong */
+    for (i = 0; i < ARRAY_SIZE(t); ++i)
+        t[i] = (long)(i < 62 ? BIT(i) : BIT(62)) - (long)BIT(61);
+
+    for (i = 0; i < ARRAY_SIZE(t); ++i)
+        T_EXPECT(find_first_interpolation_long(t[i], t, ARRAY_SIZE(t)), (ssize_t)MIN(i, (size_t)62));
+
+    T_EXPECT(find_first_interpolation_long(3, t, ARRAY_SIZE(t)), -1);
+    T_EXPECT(find_first_interpolation_long(LONG_MIN, t, ARRAY_SIZE(t)), -1);
+    T_EXPECT(find_first_interpolation_long(LONG_MAX, t, ARRAY_SIZE(t)), -1);
+
+    /* distances bigger than LONG_MAX */
+    T_EXPECT(find_first_interpolation_ulong(ULONG_MAX, u, ARRAY_SIZE(u)), 2);
+    T_EXPECT(find_first_interpolation_ulong(1, u, ARRAY_SIZE(u)), 1);
+    T_EXPECT(find_first_interpolation_ulong(2, u, ARRAY_SIZE(u)), -1);
+}
+
+test_f test_eytzinger(void)
+{
+    long sorted[1000];
+    long e[1000];
+    long key;
+    size_t n;
+    size_t i;
+    size_t lower;
+    ssize_t index;
+
+    for (n = 1; n <= ARRAY_SIZE(sorted); n = n < 70 ? n + 1 : n * 2)
+    {
+        n = MIN(n, ARRAY_SIZE(sorted));
+
+        sorted[0] = 0;
+        for (i = 1; i < n; ++i)
+            sorted[i] = sorted[i - 1] + rand() % 3;
+
+        T_EXPECT(eytzinger_build(sorted, n, sizeof(long), e), 0);
+
+        for (key = -1; key <= sorted[n - 1] + 1; ++key)
+        {
+            lower = 0;
+            while (lower < n && sorted[lower] < key)
+                ++lower;
+
+            index = eytzinger_lower_bound_long(key, e, n);
+            if (lower == n)
+                T_EXPECT(index, -1);
+            else
+                T_CHECK(index != -1 && e[index] == sorted[lower]);
+
+            T_EXPECT(eytzinger_lower_bound((void *)&key, e, n, cmp_long, sizeof(long)), index);
+
+            index = eytzinger_find_long(key, e, n);
+            if (lower == n || sorted[lower] != key)
+                T_EXPECT(index, -1);
+            else
+                T_CHECK(index != -1 && e[index] == key);
+        }
+
+        if (n == ARRAY_SIZE(sorted))
+            break;
+    }
+
+    T_EXPECT(eytzinger_build(NULL, 1, sizeof(long), e), 1);
+    T_EXPECT(eytzinger_build(sorted, 0, sizeof(long), e), 1);
+}
 
 test_f test_find_empty_array(void)
 {
@@ -91,6 +333,15 @@ test_f test_find_empty_array(void)
     T_EXPECT(find_last_unsorted((void *)&key, t, 0, cmp_int, sizeof(int)), -1);
     T_EXPECT(find_first_sorted((void *)&key, t, 0, cmp_int, sizeof(int)), -1);
     T_EXPECT(find_last_sorted((void *)&key, t, 0, cmp_int, sizeof(int)), -1);
+
+    T_EXPECT(find_first_unsorted_int(key, t, 0), -1);
+    T_EXPECT(find_last_unsorted_int(key, t, 0), -1);
+    T_EXPECT(find_first_sorted_int(key, t, 0), -1);
+    T_EXPECT(find_last_sorted_int(key, t, 0), -1);
+    T_EXPECT(find_lower_bound_int(key, t, 0), -1);
+    T_EXPECT(find_first_interpolation_int(key, t, 0), -1);
+    T_EXPECT(eytzinger_lower_bound_int(key, t, 0), -1);
+    T_EXPECT(find_first_sorted_int(key, NULL, 1), -1);
 }
 
 void test(void)
@@ -99,6 +350,11 @@ void test(void)
     TEST(test_find_last_unsorted());
     TEST(test_find_first_sorted());
     TEST(test_find_last_sorted());
+    TEST(test_typed());
+    TEST(test_sorted_random());
+    TEST(test_find_first_sorted_batch());
+    TEST(test_interpolation_extremes());
+    TEST(test_eytzinger());
     TEST(test_find_empty_array());
 }
 
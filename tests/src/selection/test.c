@@ -3,6 +3,7 @@
 #include <common.h>
 #include <sort.h>
 #include <stdlib.h>
+#include <string.h>
 
 CMP(int)
 CMP(char)
@@ -108,6 +109,140 @@ test_f test_distinct(void)
     T_ASSERT(t[index], 9);
 }
 
+/* t is partitioned around k and t[k] is kth element of sorted */
+static void check_partitioned(const int *t, const int *sorted, size_t n, size_t k)
+{
+    size_t i;
+
+    T_EXPECT(t[k], sorted[k]);
+
+    for (i = 0; i < k; ++i)
+        T_CHECK(t[i] <= t[k]);
+
+    for (i = k + 1; i < n; ++i)
+        T_CHECK(t[i] >= t[k]);
+}
+
+static void fill_pattern(int *t, size_t n, int pattern)
+{
+    size_t i;
+
+    for (i = 0; i < n; ++i)
+    {
+        switch (pattern)
+        {
+            case 0: t[i] = rand(); break;                   /* random */
+            case 1: t[i] = (int)i; break;                   /* sorted */
+            case 2: t[i] = (int)(n - i); break;             /* reversed */
+            case 3: t[i] = 7; break;                        /* all equal */
+            case 4: t[i] = rand() % 4; break;               /* few distinct */
+            case 5: t[i] = (int)MIN(i, n - i); break;       /* organ pipe */
+            default: t[i] = (int)(i % 2 ? i : n - i); break; /* zig zag */
+        }
+    }
+}
+
+test_f test_kth_inplace(size_t n)
+{
+    const size_t ks[] = {0, n / 100, n / 10, n / 2, n - n / 10 - 1, n - 1};
+    int *t;
+    int *sorted;
+    ssize_t index;
+    int pattern;
+    size_t i;
+
+    t = (int *)malloc(n * sizeof(int));
+    T_ERROR(t == NULL);
+
+    sorted = (int *)malloc(n * sizeof(int));
+    T_ERROR(sorted == NULL);
+
+    for (pattern = 0; pattern < 7; ++pattern)
+        for (i = 0; i < ARRAY_SIZE(ks); ++i)
+        {
+            fill_pattern(sorted, n, pattern);
+
+            /* the same value as select_kth */
+            (void)memcpy(t, sorted, n * sizeof(int));
+            index = select_kth(t, n, sizeof(int), ks[i], cmp_int);
+            T_ERROR(index == -1);
+
+            sort(sorted, n, cmp_int, sizeof(int));
+            T_EXPECT(t[index], sorted[ks[i]]);
+
+            T_EXPECT(select_kth_inplace(t, n, sizeof(int), ks[i], cmp_int), 0);
+            check_partitioned(t, sorted, n, ks[i]);
+        }
+
+    FREE(t);
+    FREE(sorted);
+}
+
+test_f test_multi(size_t n)
+{
+    size_t ks[101];
+    int *t;
+    int *sorted;
+    int pattern;
+    size_t i;
+
+    /* min, p1 .. p99, max */
+    for (i = 0; i < ARRAY_SIZE(ks); ++i)
+        ks[i] = (n - 1) * i / 100;
+
+    t = (int *)malloc(n * sizeof(int));
+    T_ERROR(t == NULL);
+
+    sorted = (int *)malloc(n * sizeof(int));
+    T_ERROR(sorted == NULL);
+
+    for (pattern = 0; pattern < 7; ++pattern)
+    {
+        fill_pattern(sorted, n, pattern);
+        (void)memcpy(t, sorted, n * sizeof(int));
+        sort(sorted, n, cmp_int, sizeof(int));
+
+        T_EXPECT(select_multi_inplace(t, n, sizeof(int), ks, ARRAY_SIZE(ks), cmp_int), 0);
+
+        for (i = 0; i < ARRAY_SIZE(ks); ++i)
+            check_partitioned(t, sorted, n, ks[i]);
+    }
+
+    FREE(t);
+    FREE(sorted);
+}
+
+test_f test_invalid(void)
+{
+    int t[] = {3, 1, 2};
+    const size_t ks[] = {0, 2};
+    const size_t ks_unsorted[] = {2, 0};
+    const size_t ks_out[] = {0, 3};
+
+    T_EXPECT(select_kth(NULL, ARRAY_SIZE(t), sizeof(*t), 0, cmp_int), -1);
+    T_EXPECT(select_kth(t, ARRAY_SIZE(t), sizeof(*t), 3, cmp_int), -1);
+
+    T_CHECK(select_kth_inplace(NULL, ARRAY_SIZE(t), sizeof(*t), 0, cmp_int) != 0);
+    T_CHECK(select_kth_inplace(t, 0, sizeof(*t), 0, cmp_int) != 0);
+    T_CHECK(select_kth_inplace(t, ARRAY_SIZE(t), 0, 0, cmp_int) != 0);
+    T_CHECK(select_kth_inplace(t, ARRAY_SIZE(t), sizeof(*t), 3, cmp_int) != 0);
+    T_CHECK(select_kth_inplace(t, ARRAY_SIZE(t), sizeof(*t), 0, NULL) != 0);
+
+    T_CHECK(select_multi_inplace(t, ARRAY_SIZE(t), sizeof(*t), NULL, 2, cmp_int) != 0);
+    T_CHECK(select_multi_inplace(t, ARRAY_SIZE(t), sizeof(*t), ks, 0, cmp_int) != 0);
+    T_CHECK(select_multi_inplace(t, ARRAY_SIZE(t), sizeof(*t), ks_unsorted, 2, cmp_int) != 0);
+    T_CHECK(select_multi_inplace(t, ARRAY_SIZE(t), sizeof(*t), ks_out, 2, cmp_int) != 0);
+
+    /* failure does not touch array */
+    T_EXPECT(t[0], 3);
+    T_EXPECT(t[1], 1);
+    T_EXPECT(t[2], 2);
+
+    T_EXPECT(select_multi_inplace(t, ARRAY_SIZE(t), sizeof(*t), ks, ARRAY_SIZE(ks), cmp_int), 0);
+    T_EXPECT(t[0], 1);
+    T_EXPECT(t[2], 3);
+}
+
 void test(void)
 {
     TEST(test_selection(1));
@@ -118,6 +253,18 @@ void test(void)
     TEST(test_selection(100000));
 
     TEST(test_distinct());
+
+    TEST(test_kth_inplace(1));
+    TEST(test_kth_inplace(100));
+    TEST(test_kth_inplace(1000));
+    TEST(test_kth_inplace(100000));
+
+    TEST(test_multi(1));
+    TEST(test_multi(50));
+    TEST(test_multi(1000));
+    TEST(test_multi(100000));
+
+    TEST(test_invalid());
 }
 
 int main(void)
@@ -7,6 +7,9 @@
 #include <generic.h>
 #include <time.h>
 #include <sort.h>
+#include <unistd.h>
+
+#define BIG_RECORD_PAYLOAD 300
 
 typedef struct MyStruct
 {
@@ -17,10 +20,28 @@ typedef struct MyStruct
     int key;
 }MyStruct;
 
+typedef struct BigRecord
+{
+    int key;
+    int id;
+    char payload[BIG_RECORD_PAYLOAD];
+}BigRecord;
+
 CMP(int)
 CMP(double)
 CMP(char)
 
+int cmp_big_record(const void *a, const void *b)
+{
+    if (((const BigRecord *)a)->key < ((const BigRecord *)b)->key)
+        return -1;
+
+    if (((const BigRecord *)a)->key > ((const BigRecord *)b)->key)
+        return 1;
+
+    return 0;
+}
+
 int cmp_mystruct(const void *a, const void *b)
 {
     if ((*(MyStruct **)a)->key < (*(MyStruct **)b)->key)
@@ -181,6 +202,37 @@ test_f test_binsort(size_t n)
     FREE(t4);
 }
 
+test_f test_binsort_presorted(void)
+{
+    int *t;
+    size_t n;
+    size_t i;
+
+    /* odd number of elements and sorted input walks through whole temporary array */
+    for (n = 1; n <= 300; ++n)
+    {
+        t = (int *)malloc(sizeof(int) * n);
+        T_ERROR(t == NULL);
+
+        for (i = 0; i < n; ++i)
+            t[i] = (int)i;
+
+        T_EXPECT(binsort((void *)t, n, cmp_int, sizeof(int)), 0);
+        T_EXPECT(check_array_is_sorted((void *)t, n, sizeof(int), cmp_int), true);
+
+        for (i = 0; i < n; ++i)
+            t[i] = (int)(n - i);
+
+        T_EXPECT(binsort((void *)t, n, cmp_int, sizeof(int)), 0);
+        T_EXPECT(check_array_is_sorted((void *)t, n, sizeof(int), cmp_int), true);
+
+        T_EXPECT(sort((void *)t, n, cmp_int, sizeof(int)), 0);
+        T_EXPECT(check_array_is_sorted((void *)t, n, sizeof(int), cmp_int), true);
+
+        FREE(t);
+    }
+}
+
 test_f test_mergesort(size_t n)
 {
     size_t i;
@@ -319,6 +371,269 @@ test_f test_sort_empty(void)
     T_CHECK(mergesort((void *)t, size, cmp_int, sizeof(int)) != 0);
     T_CHECK(quicksort((void *)t, size, cmp_int, sizeof(int)) != 0);
     T_CHECK(sort((void *)t, size, cmp_int, sizeof(int)) != 0);
+    T_CHECK(sort_indirect((void *)t, size, cmp_int, sizeof(int)) != 0);
+}
+
+test_f test_sort_indirect(size_t n)
+{
+    BigRecord *t;
+    bool *seen;
+    size_t i;
+    size_t j;
+
+    t = (BigRecord *)malloc(sizeof(BigRecord) * n);
+    T_ERROR(t == NULL);
+
+    seen = (bool *)calloc(n, sizeof(bool));
+    T_ERROR(seen == NULL);
+
+    for (i = 0; i < n; ++i)
+    {
+        t[i].key = rand() % (int)(n / 2 + 1); /* with duplicates */
+        t[i].id = (int)i;
+        (void)memset(t[i].payload, (int)(i % 251), sizeof(t[i].payload));
+    }
+
+    T_EXPECT(sort_indirect((void *)t, n, cmp_big_record, sizeof(BigRecord)), 0);
+    T_EXPECT(check_array_is_sorted((void *)t, n, sizeof(BigRecord), cmp_big_record), true);
+
+    /* records are moved, not mixed */
+    for (i = 0; i < n; ++i)
+    {
+        T_ERROR(t[i].id < 0 || (size_t)t[i].id >= n);
+        T_EXPECT(seen[t[i].id], false);
+        seen[t[i].id] = true;
+
+        for (j = 0; j < sizeof(t[i].payload); ++j)
+            T_ERROR(t[i].payload[j] != (char)(t[i].id % 251));
+    }
+
+    FREE(t);
+    FREE(seen);
+}
+
+test_f test_sort_tuning(void)
+{
+    Sort_tuning tuning;
+    Sort_tuning tuning2;
+    BigRecord *t;
+    char path[] = "/tmp/sort_tuning_XXXXXX";
+    const size_t n = 1000;
+    size_t i;
+    FILE *file;
+    int fd;
+
+    /* default table */
+    T_EXPECT(sort_tuning_get(sizeof(int), &tuning), 0);
+    T_EXPECT(tuning.size_of, 4);
+    T_EXPECT(tuning.insort_threshold, 32);
+    T_EXPECT(tuning.binsort_threshold, 128);
+    T_EXPECT(tuning.indirect, false);
+
+    /* bigger than the last class */
+    T_EXPECT(sort_tuning_get(4096, &tuning), 0);
+    T_EXPECT(tuning.size_of, 512);
+
+    T_CHECK(sort_tuning_get(0, &tuning) != 0);
+    T_CHECK(sort_tuning_get(4, NULL) != 0);
+
+    /* not a class size */
+    tuning.size_of = 100;
+    T_CHECK(sort_tuning_set(&tuning) != 0);
+
+    /* binsort_threshold < insort_threshold */
+    tuning.size_of = 512;
+    tuning.insort_threshold = 64;
+    tuning.binsort_threshold = 32;
+    T_CHECK(sort_tuning_set(&tuning) != 0);
+
+    /* BigRecord is in class 512, force indirect sort */
+    tuning.insort_threshold = 8;
+    tuning.binsort_threshold = 64;
+    tuning.indirect = true;
+    T_EXPECT(sort_tuning_set(&tuning), 0);
+    T_EXPECT(sort_tuning_get(sizeof(BigRecord), &tuning2), 0);
+    T_EXPECT(tuning2.insort_threshold, 8);
+    T_EXPECT(tuning2.binsort_threshold, 64);
+    T_EXPECT(tuning2.indirect, true);
+
+    t = (BigRecord *)malloc(sizeof(BigRecord) * n);
+    T_ERROR(t == NULL);
+
+    for (i = 0; i < n; ++i)
+        t[i].key = rand();
+
+    T_EXPECT(sort((void *)t, n, cmp_big_record, sizeof(BigRecord)), 0);
+    T_EXPECT(check_array_is_sorted((void *)t, n, sizeof(BigRecord), cmp_big_record), true);
+
+    /* binsort range */
+    for (i = 0; i < 50; ++i)
+        t[i].key = rand();
+
+    T_EXPECT(sort((void *)t, 50, cmp_big_record, sizeof(BigRecord)), 0);
+    T_EXPECT(check_array_is_sorted((void *)t, 50, sizeof(BigRecord), cmp_big_record), true);
+
+    FREE(t);
+
+    /* save and load */
+    fd = mkstemp(path);
+    T_ERROR(fd == -1);
+    close(fd);
+
+    T_EXPECT(sort_tuning_save(path), 0);
+    sort_tuning_reset();
+    T_EXPECT(sort_tuning_get(sizeof(BigRecord), &tuning2), 0);
+    T_EXPECT(tuning2.indirect, false);
+
+    T_EXPECT(sort_tuning_load(path), 0);
+    T_EXPECT(sort_tuning_get(sizeof(BigRecord), &tuning2), 0);
+    T_EXPECT(tuning2.insort_threshold, 8);
+    T_EXPECT(tuning2.binsort_threshold, 64);
+    T_EXPECT(tuning2.indirect, true);
+
+    /* bad file doesn't change table */
+    file = fopen(path, "w");
+    T_ERROR(file == NULL);
+    T_CHECK(fprintf(file, "4 16 64 0\n100 1 2 0\n") > 0);
+    fclose(file);
+
+    T_CHECK(sort_tuning_load(path) != 0);
+    T_EXPECT(sort_tuning_get(sizeof(int), &tuning2), 0);
+    T_EXPECT(tuning2.insort_threshold, 32);
+
+    T_CHECK(sort_tuning_load("/nonexistent/sort_tuning") != 0);
+
+    sort_tuning_reset();
+    T_EXPECT(sort_tuning_get(sizeof(BigRecord), &tuning2), 0);
+    T_EXPECT(tuning2.indirect, false);
+
+    unlink(path);
+}
+
+test_f test_argsort(size_t n)
+{
+    BigRecord *t;
+    size_t *perm;
+    size_t i;
+
+    t = (BigRecord *)calloc(n, sizeof(BigRecord));
+    T_ERROR(t == NULL);
+
+    perm = (size_t *)malloc(sizeof(size_t) * n);
+    T_ERROR(perm == NULL);
+
+    for (i = 0; i < n; ++i)
+    {
+        t[i].key = rand();
+        t[i].id = (int)i;
+    }
+
+    T_EXPECT(argsort((void *)t, n, cmp_big_record, sizeof(BigRecord), perm), 0);
+
+    /* t is not changed */
+    for (i = 0; i < n; ++i)
+        T_EXPECT(t[i].id, (int)i);
+
+    for (i = 1; i < n; ++i)
+        T_CHECK(t[perm[i - 1]].key <= t[perm[i]].key);
+
+    T_EXPECT(sort_permute((void *)t, n, sizeof(BigRecord), perm), 0);
+    T_EXPECT(check_array_is_sorted((void *)t, n, sizeof(BigRecord), cmp_big_record), true);
+
+    /* perm is not changed */
+    for (i = 0; i < n; ++i)
+        T_EXPECT(t[i].id, (int)perm[i]);
+
+    perm[0] = n;
+    T_CHECK(sort_permute((void *)t, n, sizeof(BigRecord), perm) != 0);
+
+    /* duplicated index is not a permutation */
+    if (n > 1)
+    {
+        for (i = 0; i < n; ++i)
+            perm[i] = (i + 1) % n;
+
+        perm[n - 1] = perm[0];
+        T_CHECK(sort_permute((void *)t, n, sizeof(BigRecord), perm) != 0);
+
+        /* t is not changed on failure */
+        T_EXPECT(check_array_is_sorted((void *)t, n, sizeof(BigRecord), cmp_big_record), true);
+    }
+
+    FREE(t);
+    FREE(perm);
+}
+
+test_f test_sort_by_key(size_t n)
+{
+    BigRecord *t;
+    size_t *perm;
+    size_t i;
+
+    t = (BigRecord *)calloc(n, sizeof(BigRecord));
+    T_ERROR(t == NULL);
+
+    perm = (size_t *)malloc(sizeof(size_t) * n);
+    T_ERROR(perm == NULL);
+
+    /* signed key with duplicates, id checks stability */
+    for (i = 0; i < n; ++i)
+    {
+        t[i].key = rand() % (int)(n + 1) - (int)(n / 2);
+        t[i].id = (int)i;
+        (void)memset(t[i].payload, (int)(i % 251), sizeof(t[i].payload));
+    }
+
+    T_EXPECT(argsort_by_key((void *)t, n, sizeof(BigRecord), offsetof(BigRecord, key), sizeof(int), SORT_KEY_SIGNED, perm), 0);
+    for (i = 1; i < n; ++i)
+    {
+        T_CHECK(t[perm[i - 1]].key <= t[perm[i]].key);
+        if (t[perm[i - 1]].key == t[perm[i]].key)
+            T_CHECK(perm[i - 1] < perm[i]);
+    }
+
+    T_EXPECT(SORT_BY_KEY((void *)t, n, BigRecord, key, SORT_KEY_SIGNED), 0);
+    T_EXPECT(check_array_is_sorted((void *)t, n, sizeof(BigRecord), cmp_big_record), true);
+    for (i = 0; i < n; ++i)
+    {
+        T_EXPECT(t[i].id, (int)perm[i]);
+        T_EXPECT(t[i].payload[sizeof(t[i].payload) - 1], (char)(t[i].id % 251));
+    }
+
+    /* unsigned key */
+    for (i = 0; i < n; ++i)
+        t[i].key = rand();
+
+    T_EXPECT(SORT_BY_KEY((void *)t, n, BigRecord, key, SORT_KEY_UNSIGNED), 0);
+    T_EXPECT(check_array_is_sorted((void *)t, n, sizeof(BigRecord), cmp_big_record), true);
+
+    /* bytes key: payload like string */
+    for (i = 0; i < n; ++i)
+        (void)snprintf(t[i].payload, sizeof(t[i].payload), "key%08d", rand() % 100000);
+
+    T_EXPECT(sort_by_key((void *)t, n, sizeof(BigRecord), offsetof(BigRecord, payload), 12, SORT_KEY_BYTES), 0);
+    for (i = 1; i < n; ++i)
+        T_CHECK(strcmp(t[i - 1].payload, t[i].payload) <= 0);
+
+    FREE(t);
+    FREE(perm);
+}
+
+test_f test_sort_by_key_invalid(void)
+{
+    BigRecord t[2];
+    size_t perm[2];
+
+    T_CHECK(sort_by_key(NULL, 2, sizeof(BigRecord), 0, sizeof(int), SORT_KEY_SIGNED) != 0);
+    T_CHECK(sort_by_key((void *)t, 0, sizeof(BigRecord), 0, sizeof(int), SORT_KEY_SIGNED) != 0);
+    T_CHECK(sort_by_key((void *)t, 2, sizeof(BigRecord), sizeof(BigRecord), 1, SORT_KEY_BYTES) != 0);
+    T_CHECK(sort_by_key((void *)t, 2, sizeof(BigRecord), sizeof(BigRecord) - 2, 4, SORT_KEY_BYTES) != 0);
+    T_CHECK(sort_by_key((void *)t, 2, sizeof(BigRecord), 0, 0, SORT_KEY_BYTES) != 0);
+    T_CHECK(sort_by_key((void *)t, 2, sizeof(BigRecord), 0, 3, SORT_KEY_UNSIGNED) != 0);
+    T_CHECK(sort_by_key((void *)t, 2, sizeof(BigRecord), 0, 4, (SORT_KEY_TYPE)7) != 0);
+    T_CHECK(argsort_by_key((void *)t, 2, sizeof(BigRecord), 0, 4, SORT_KEY_SIGNED, NULL) != 0);
+    T_CHECK(argsort(NULL, 2, cmp_big_record, sizeof(BigRecord), perm) != 0);
+    T_CHECK(argsort((void *)t, 2, cmp_big_record, sizeof(BigRecord), NULL) != 0);
 }
 
 void test(void)
@@ -332,6 +647,7 @@ void test(void)
     TEST(test_binsort(2));
     TEST(test_binsort(100));
     TEST(test_binsort(10000));
+    TEST(test_binsort_presorted());
 
     TEST(test_mergesort(1));
     TEST(test_mergesort(2));
@@ -343,6 +659,24 @@ void test(void)
     TEST(test_quicksort(100));
     TEST(test_quicksort(10000));
 
+    TEST(test_sort_indirect(1));
+    TEST(test_sort_indirect(2));
+    TEST(test_sort_indirect(100));
+    TEST(test_sort_indirect(10000));
+
+    TEST(test_sort_tuning());
+
+    TEST(test_argsort(1));
+    TEST(test_argsort(2));
+    TEST(test_argsort(100));
+    TEST(test_argsort(10000));
+
+    TEST(test_sort_by_key(1));
+    TEST(test_sort_by_key(2));
+    TEST(test_sort_by_key(100));
+    TEST(test_sort_by_key(10000));
+    TEST(test_sort_by_key_invalid());
+
     TEST(test_sort_empty());
 }
 
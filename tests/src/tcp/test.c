@@ -1,14 +1,103 @@
 #include <tcp.h>
 #include <test.h>
+#include <common.h>
 #include <unistd.h>
 #include <stdlib.h>
 #include <fcntl.h>
 #include <string.h>
 #include <sys/types.h>
+#include <sys/socket.h>
+#include <pthread.h>
 
 #define MIN_PORT  6000
 #define RANGE     2000
 
+#define DATA_SIZE (BIT(20) * 3 + 11)
+
+typedef struct Receiver
+{
+    int     fd;
+    char    *buf;
+    size_t  size;
+    size_t  received;
+} Receiver;
+
+/* read until size bytes or EOF */
+static void *receiver_thread(void *arg)
+{
+    Receiver *r = (Receiver *)arg;
+    ssize_t n;
+
+    while (r->received < r->size)
+    {
+        n = recv(r->fd, r->buf + r->received, r->size - r->received, 0);
+        if (n <= 0)
+            break;
+
+        r->received += (size_t)n;
+    }
+
+    return NULL;
+}
+
+/* connected client and server sockets in one process */
+static int connection_pair(int *client, int *server)
+{
+    const int port = MIN_PORT + rand() % RANGE;
+    int socket;
+
+    socket = tcp_socket_create_with_flags("localhost", port, TCP_SOCKET_REUSEADDR);
+    if (socket == -1)
+        return 1;
+
+    /* connect is completed by kernel before accept */
+    if (listen(socket, SOMAXCONN) == -1)
+    {
+        tcp_socket_destroy(socket);
+        return 1;
+    }
+
+    *client = tcp_request_connection("localhost", port);
+    *server = tcp_accept_connection(socket);
+    tcp_socket_destroy(socket);
+
+    return *client == -1 || *server == -1;
+}
+
+static char *data_create(size_t size)
+{
+    char *data;
+    size_t i;
+
+    data = (char *)malloc(size);
+    if (data == NULL)
+        return NULL;
+
+    for (i = 0; i < size; ++i)
+        data[i] = (char)(i * 7 + i / 4096);
+
+    return data;
+}
+
+static int file_create(const char *data, size_t size)
+{
+    char path[] = "./tcp_test_XXXXXX";
+    int fd;
+
+    fd = mkstemp(path);
+    if (fd == -1)
+        return -1;
+
+    (void)unlink(path);
+    if (write(fd, data, size) != (ssize_t)size)
+    {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
 test_f test_create_socket(void)
 {
     const int port = MIN_PORT + rand() % RANGE;
@@ -20,6 +109,27 @@ test_f test_create_socket(void)
     tcp_socket_destroy(socket);
 }
 
+test_f test_create_socket_with_flags(void)
+{
+    const int port = MIN_PORT + rand() % RANGE;
+    int socket;
+    int socket2;
+
+    socket = tcp_socket_create_with_flags("localhost", port, TCP_SOCKET_REUSEADDR | TCP_SOCKET_REUSEPORT | TCP_SOCKET_NONBLOCK);
+    T_ERROR(socket == -1);
+    T_CHECK(fcntl(socket, F_GETFL, 0) & O_NONBLOCK);
+
+    /* second socket on the same port */
+    socket2 = tcp_socket_create_with_flags("localhost", port, TCP_SOCKET_REUSEADDR | TCP_SOCKET_REUSEPORT);
+    T_CHECK(socket2 != -1);
+    T_CHECK(!(fcntl(socket2, F_GETFL, 0) & O_NONBLOCK));
+    T_EXPECT(tcp_set_nonblocking(socket2), 0);
+    T_CHECK(fcntl(socket2, F_GETFL, 0) & O_NONBLOCK);
+
+    tcp_socket_destroy(socket2);
+    tcp_socket_destroy(socket);
+}
+
 test_f test_connection_request(void)
 {
     const int port = MIN_PORT + rand() % RANGE;
@@ -144,12 +254,208 @@ test_f test_full_connection(void)
     }
 }
 
+test_f test_sendfile(void)
+{
+    Receiver r = {0};
+    pthread_t thread;
+    char *data;
+    off_t offset;
+    int client;
+    int server;
+    int fd;
+
+    data = data_create(DATA_SIZE);
+    T_ERROR(data == NULL);
+
+    fd = file_create(data, DATA_SIZE);
+    T_ERROR(fd == -1);
+
+    T_ERROR(connection_pair(&client, &server));
+
+    r.fd = server;
+    r.size = DATA_SIZE - 100;
+    r.buf = (char *)malloc(r.size);
+    T_ERROR(r.buf == NULL);
+    T_ERROR(pthread_create(&thread, NULL, receiver_thread, (void *)&r));
+
+    /* from offset 100 to the end */
+    offset = 100;
+    T_EXPECT(tcp_sendfile(client, fd, &offset, DATA_SIZE), (ssize_t)(DATA_SIZE - 100));
+    T_EXPECT(offset, (off_t)DATA_SIZE);
+
+    T_ERROR(pthread_join(thread, NULL));
+    T_EXPECT(r.received, DATA_SIZE - 100);
+    T_EXPECT(memcmp(r.buf, data + 100, DATA_SIZE - 100), 0);
+
+    T_EXPECT(tcp_sendfile(client, -1, NULL, 10), -1);
+
+    FREE(r.buf);
+    FREE(data);
+    close(fd);
+    tcp_socket_destroy(client);
+    tcp_socket_destroy(server);
+}
+
+test_f test_splice(void)
+{
+    Receiver r = {0};
+    pthread_t thread;
+    char *data;
+    off_t offset;
+    int client;
+    int server;
+    int fd;
+
+    data = data_create(DATA_SIZE);
+    T_ERROR(data == NULL);
+
+    fd = file_create(data, DATA_SIZE);
+    T_ERROR(fd == -1);
+
+    T_ERROR(connection_pair(&client, &server));
+
+    r.fd = server;
+    r.size = DATA_SIZE;
+    r.buf = (char *)malloc(r.size);
+    T_ERROR(r.buf == NULL);
+    T_ERROR(pthread_create(&thread, NULL, receiver_thread, (void *)&r));
+
+    /* 2 parts, with offset and from file position */
+    offset = 0;
+    T_EXPECT(tcp_splice(client, fd, &offset, BIT(20)), (ssize_t)BIT(20));
+    T_EXPECT(offset, (off_t)BIT(20));
+
+    T_EXPECT(lseek(fd, (off_t)BIT(20), SEEK_SET), (off_t)BIT(20));
+    T_EXPECT(tcp_splice(client, fd, NULL, DATA_SIZE), (ssize_t)(DATA_SIZE - BIT(20)));
+
+    T_ERROR(pthread_join(thread, NULL));
+    T_EXPECT(r.received, DATA_SIZE);
+    T_EXPECT(memcmp(r.buf, data, DATA_SIZE), 0);
+
+    FREE(r.buf);
+    FREE(data);
+    close(fd);
+    tcp_socket_destroy(client);
+    tcp_socket_destroy(server);
+}
+
+test_f test_writev(void)
+{
+    const char header[] = "HTTP/1.1 200 OK\r\n\r\n";
+    Receiver r = {0};
+    pthread_t thread;
+    struct iovec iov[4];
+    char *data;
+    int client;
+    int server;
+
+    data = data_create(DATA_SIZE);
+    T_ERROR(data == NULL);
+
+    T_ERROR(connection_pair(&client, &server));
+
+    /* body is bigger than socket buffer, so partial writes have to be continued */
+    iov[0].iov_base = (void *)header;
+    iov[0].iov_len = sizeof(header) - 1;
+    iov[1].iov_base = NULL;
+    iov[1].iov_len = 0;
+    iov[2].iov_base = (void *)data;
+    iov[2].iov_len = DATA_SIZE;
+    iov[3].iov_base = (void *)header;
+    iov[3].iov_len = sizeof(header) - 1;
+
+    r.fd = server;
+    r.size = DATA_SIZE + 2 * (sizeof(header) - 1);
+    r.buf = (char *)malloc(r.size);
+    T_ERROR(r.buf == NULL);
+    T_ERROR(pthread_create(&thread, NULL, receiver_thread, (void *)&r));
+
+    T_EXPECT(tcp_writev(client, iov, (int)ARRAY_SIZE(iov)), (ssize_t)r.size);
+
+    T_ERROR(pthread_join(thread, NULL));
+    T_EXPECT(r.received, r.size);
+    T_EXPECT(memcmp(r.buf, header, sizeof(header) - 1), 0);
+    T_EXPECT(memcmp(r.buf + sizeof(header) - 1, data, DATA_SIZE), 0);
+    T_EXPECT(memcmp(r.buf + sizeof(header) - 1 + DATA_SIZE, header, sizeof(header) - 1), 0);
+
+    T_EXPECT(tcp_writev(client, NULL, 1), -1);
+
+    FREE(r.buf);
+    FREE(data);
+    tcp_socket_destroy(client);
+    tcp_socket_destroy(server);
+}
+
+test_f test_zerocopy(void)
+{
+    Receiver r = {0};
+    Tcp_zerocopy zc;
+    pthread_t thread;
+    char *data;
+    uint32_t id;
+    uint32_t id2;
+    int client;
+    int server;
+
+    data = data_create(DATA_SIZE);
+    T_ERROR(data == NULL);
+
+    T_ERROR(connection_pair(&client, &server));
+
+    /* kernel < 4.14 */
+    if (tcp_zerocopy_init(&zc, client))
+    {
+        FREE(data);
+        tcp_socket_destroy(client);
+        tcp_socket_destroy(server);
+        return;
+    }
+
+    T_EXPECT(tcp_zerocopy_get_pending(&zc), 0);
+
+    r.fd = server;
+    r.size = DATA_SIZE * 2;
+    r.buf = (char *)malloc(r.size);
+    T_ERROR(r.buf == NULL);
+    T_ERROR(pthread_create(&thread, NULL, receiver_thread, (void *)&r));
+
+    T_EXPECT(tcp_zerocopy_send(&zc, data, DATA_SIZE, &id), (ssize_t)DATA_SIZE);
+    T_EXPECT(tcp_zerocopy_send(&zc, data, DATA_SIZE, &id2), (ssize_t)DATA_SIZE);
+    T_CHECK(id2 > id);
+
+    T_ERROR(pthread_join(thread, NULL));
+    T_EXPECT(r.received, r.size);
+    T_EXPECT(memcmp(r.buf, data, DATA_SIZE), 0);
+    T_EXPECT(memcmp(r.buf + DATA_SIZE, data, DATA_SIZE), 0);
+
+    /* all data is received, so all completions come */
+    while (tcp_zerocopy_get_pending(&zc) > 0)
+        T_ERROR(tcp_zerocopy_reap(&zc, 1000) == -1);
+
+    T_EXPECT(tcp_zerocopy_is_done(&zc, id), true);
+    T_EXPECT(tcp_zerocopy_is_done(&zc, id2), true);
+    T_EXPECT(tcp_zerocopy_is_done(&zc, id2 + 1), false);
+
+    /* loopback always copies */
+    T_CHECK(tcp_zerocopy_get_copied(&zc) > 0);
+
+    FREE(r.buf);
+    FREE(data);
+    tcp_socket_destroy(client);
+    tcp_socket_destroy(server);
+}
+
 void test(void)
 {
     TEST(test_create_socket());
+    TEST(test_create_socket_with_flags());
     TEST(test_connection_request());
     TEST(test_accept_connection());
     TEST(test_full_connection());
+    TEST(test_sendfile());
+    TEST(test_splice());
+    TEST(test_writev());
+    TEST(test_zerocopy());
 }
 
 int main(void)
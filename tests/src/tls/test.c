@@ -6,6 +6,7 @@
 #include <fcntl.h>
 #include <string.h>
 #include <compiler.h>
+#include <sys/socket.h>
 
 #define MIN_PORT  6000
 #define RANGE     2000
@@ -18,6 +19,71 @@ static ___after_main___(1) void deinit(void);
 
 static int verify_callback(int preverify, X509_STORE_CTX* ctx);
 
+/* connected client and server sockets in one process */
+static int connection_pair(int *client, int *server)
+{
+    const int port = MIN_PORT + rand() % RANGE;
+    int socket;
+
+    socket = tcp_socket_create_with_flags("localhost", port, TCP_SOCKET_REUSEADDR);
+    if (socket == -1)
+        return 1;
+
+    /* connect is completed by kernel before accept */
+    if (listen(socket, SOMAXCONN) == -1)
+    {
+        tcp_socket_destroy(socket);
+        return 1;
+    }
+
+    *client = tcp_request_connection("localhost", port);
+    *server = tcp_accept_connection(socket);
+    tcp_socket_destroy(socket);
+
+    return *client == -1 || *server == -1;
+}
+
+/* drive both non-blocking handshakes in one thread */
+static int handshake_pair(SSL *client, SSL *server)
+{
+    int c = TLS_HANDSHAKE_WANT_WRITE;
+    int s = TLS_HANDSHAKE_WANT_READ;
+    int i;
+
+    for (i = 0; i < 1000 && (c != TLS_HANDSHAKE_DONE || s != TLS_HANDSHAKE_DONE); ++i)
+    {
+        if (c != TLS_HANDSHAKE_DONE)
+            c = tls_handshake(client);
+
+        if (s != TLS_HANDSHAKE_DONE)
+            s = tls_handshake(server);
+
+        if (c == TLS_HANDSHAKE_ERROR || s == TLS_HANDSHAKE_ERROR)
+            return 1;
+    }
+
+    return c != TLS_HANDSHAKE_DONE || s != TLS_HANDSHAKE_DONE;
+}
+
+/* read exactly size bytes from non-blocking ssl */
+static int ssl_read_all(SSL *ssl, char *buf, size_t size)
+{
+    size_t received = 0;
+    int n;
+    int i;
+
+    for (i = 0; i < 100000 && received < size; ++i)
+    {
+        n = SSL_read(ssl, buf + received, (int)(size - received));
+        if (n > 0)
+            received += (size_t)n;
+        else if (SSL_get_error(ssl, n) != SSL_ERROR_WANT_READ)
+            return 1;
+    }
+
+    return received != size;
+}
+
 static ___before_main___(1) void init(void)
 {
     tls_once_init();
@@ -336,6 +402,155 @@ test_f test_full_connection(void)
     }
 }
 
+test_f test_nonblocking_handshake_and_resumption(void)
+{
+    const char text[] = "Kukos";
+    char buffer[sizeof(text)];
+    SSL_CTX *server_ctx;
+    SSL_CTX *client_ctx;
+    SSL_SESSION *session;
+    SSL *client;
+    SSL *server;
+    int client_fd;
+    int server_fd;
+
+    tls_init();
+
+    server_ctx = tls_server_context_create(cert_file, key_file, verify_callback);
+    T_ERROR(server_ctx == NULL);
+    client_ctx = tls_client_context_create(cert_file, key_file, verify_callback);
+    T_ERROR(client_ctx == NULL);
+
+    T_CHECK(tls_context_set_session_cache(server_ctx, -1, 10, true) != 0);
+    T_EXPECT(tls_context_set_session_cache(server_ctx, 128, 60, true), 0);
+
+    /* first connection, full handshake */
+    T_ERROR(connection_pair(&client_fd, &server_fd));
+    T_EXPECT(tcp_set_nonblocking(client_fd), 0);
+    T_EXPECT(tcp_set_nonblocking(server_fd), 0);
+
+    client = tls_connect_start(client_ctx, client_fd, NULL);
+    T_ERROR(client == NULL);
+    server = tls_accept_start(server_ctx, server_fd);
+    T_ERROR(server == NULL);
+
+    /* nothing from server yet */
+    T_EXPECT(tls_handshake(client), TLS_HANDSHAKE_WANT_READ);
+    T_EXPECT(tls_handshake(client), TLS_HANDSHAKE_WANT_READ);
+
+    T_ERROR(handshake_pair(client, server));
+    T_EXPECT(tls_session_reused(client), false);
+    T_EXPECT(tls_session_reused(server), false);
+
+    /* tickets come after handshake, they are read with data */
+    T_EXPECT(SSL_write(server, text, sizeof(text)), (int)sizeof(text));
+    T_EXPECT(ssl_read_all(client, buffer, sizeof(buffer)), 0);
+    T_EXPECT(memcmp(buffer, text, sizeof(text)), 0);
+
+    session = tls_get_session(client);
+    T_ERROR(session == NULL);
+
+    T_EXPECT(tls_shutdown(client), 0);
+    T_EXPECT(tls_shutdown(server), 0);
+
+    tls_ssl_destroy(client);
+    tls_ssl_destroy(server);
+    close(client_fd);
+    close(server_fd);
+
+    /* second connection, session is resumed */
+    T_ERROR(connection_pair(&client_fd, &server_fd));
+    T_EXPECT(tcp_set_nonblocking(client_fd), 0);
+    T_EXPECT(tcp_set_nonblocking(server_fd), 0);
+
+    client = tls_connect_start(client_ctx, client_fd, session);
+    T_ERROR(client == NULL);
+    server = tls_accept_start(server_ctx, server_fd);
+    T_ERROR(server == NULL);
+
+    T_ERROR(handshake_pair(client, server));
+    T_EXPECT(tls_session_reused(client), true);
+    T_EXPECT(tls_session_reused(server), true);
+
+    T_EXPECT(SSL_write(client, text, sizeof(text)), (int)sizeof(text));
+    T_EXPECT(ssl_read_all(server, buffer, sizeof(buffer)), 0);
+    T_EXPECT(memcmp(buffer, text, sizeof(text)), 0);
+
+    tls_session_destroy(session);
+    tls_ssl_destroy(client);
+    tls_ssl_destroy(server);
+    close(client_fd);
+    close(server_fd);
+
+    tls_context_destroy(client_ctx);
+    tls_context_destroy(server_ctx);
+
+    tls_clenup();
+}
+
+test_f test_sendfile(void)
+{
+    char path[] = "./tls_test_XXXXXX";
+    char data[BIT(15)];
+    char buffer[BIT(15)];
+    SSL_CTX *server_ctx;
+    SSL_CTX *client_ctx;
+    SSL *client;
+    SSL *server;
+    int client_fd;
+    int server_fd;
+    int fd;
+    size_t i;
+
+    tls_init();
+
+    for (i = 0; i < sizeof(data); ++i)
+        data[i] = (char)(i * 13);
+
+    fd = mkstemp(path);
+    T_ERROR(fd == -1);
+    T_ERROR(unlink(path) == -1);
+    T_EXPECT(write(fd, data, sizeof(data)), (ssize_t)sizeof(data));
+
+    server_ctx = tls_server_context_create(cert_file, key_file, verify_callback);
+    T_ERROR(server_ctx == NULL);
+    client_ctx = tls_client_context_create(cert_file, key_file, verify_callback);
+    T_ERROR(client_ctx == NULL);
+
+    /* kTLS is used only when kernel has tls module, otherwise data goes by SSL_write */
+    T_EXPECT(tls_context_enable_ktls(server_ctx), 0);
+
+    T_ERROR(connection_pair(&client_fd, &server_fd));
+    T_EXPECT(tcp_set_nonblocking(client_fd), 0);
+    T_EXPECT(tcp_set_nonblocking(server_fd), 0);
+
+    client = tls_connect_start(client_ctx, client_fd, NULL);
+    T_ERROR(client == NULL);
+    server = tls_accept_start(server_ctx, server_fd);
+    T_ERROR(server == NULL);
+
+    T_ERROR(handshake_pair(client, server));
+    (void)tls_ktls_send_enabled(server);
+
+    /* file is smaller than socket buffers, so non-blocking send doesn't fail */
+    T_EXPECT(tls_sendfile(server, fd, 100, sizeof(data)), (ssize_t)(sizeof(data) - 100));
+    T_EXPECT(ssl_read_all(client, buffer, sizeof(data) - 100), 0);
+    T_EXPECT(memcmp(buffer, data + 100, sizeof(data) - 100), 0);
+
+    T_EXPECT(tls_sendfile(NULL, fd, 0, 1), -1);
+
+    tls_ssl_destroy(client);
+    tls_ssl_destroy(server);
+    close(client_fd);
+    close(server_fd);
+    close(fd);
+
+    tls_context_destroy(client_ctx);
+    tls_context_destroy(server_ctx);
+
+    tls_clenup();
+}
+
 void test(void)
 {
     TEST(test_tls_init());
@@ -346,6 +561,8 @@ void test(void)
     TEST(test_connection_request());
     TEST(test_connection_accept());
     TEST(test_full_connection());
+    TEST(test_nonblocking_handshake_and_resumption());
+    TEST(test_sendfile());
 }
 
 int main(void)
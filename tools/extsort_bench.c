@@ -0,0 +1,282 @@
+/*
+    External sort benchmark (see extsort.h)
+
+    Generates file with random records (10 bytes key like in sort benchmark, rest is payload),
+    sorts it by extsort_file with limited memory and checks order of output.
+
+    Usage: extsort_bench [-s MB] [-r record_size] [-m memory_MB] [-t threads] [-d dir]
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+
+    LICENCE: GPL 3.0
+*/
+
+#include <extsort.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <unistd.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define BENCH_KEY_SIZE  10
+#define BENCH_CHUNK     (1 << 20)
+
+/*
+    Compare 10 bytes keys
+
+    PARAMS
+    @IN a - pointer to record
+    @IN b - pointer to record
+
+    RETURN
+    Result of memcmp
+*/
+static int __bench_cmp(const void *a, const void *b);
+
+/*
+    Get time from CLOCK_MONOTONIC in seconds
+
+    PARAMS
+    NO PARAMS
+
+    RETURN
+    Time in seconds
+*/
+static double __bench_now(void);
+
+/*
+    Write size bytes of random records to path
+
+    PARAMS
+    @IN path - path to file
+    @IN size - size of file
+    @IN record_size - size of record
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+static int __bench_generate(const char *path, size_t size, size_t record_size);
+
+/*
+    Check that records in file are sorted
+
+    PARAMS
+    @IN path - path to file
+    @IN size - expected size of file
+    @IN record_size - size of record
+
+    RETURN
+    0 iff file is sorted
+    Non-zero value iff not
+*/
+static int __bench_check(const char *path, size_t size, size_t record_size);
+
+static int __bench_cmp(const void *a, const void *b)
+{
+    return memcmp(a, b, BENCH_KEY_SIZE);
+}
+
+static double __bench_now(void)
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int __bench_generate(const char *path, size_t size, size_t record_size)
+{
+    unsigned char *buf;
+    uint64_t x = (uint64_t)time(NULL) | 1;
+    size_t chunk;
+    size_t written;
+    size_t i;
+    FILE *file;
+    int ret = 0;
+
+    chunk = BENCH_CHUNK / record_size * record_size;
+    buf = (unsigned char *)malloc(chunk);
+    if (buf == NULL)
+        return 1;
+
+    file = fopen(path, "w");
+    if (file == NULL)
+    {
+        free(buf);
+        return 1;
+    }
+
+    for (written = 0; written < size; written += chunk)
+    {
+        chunk = size - written < chunk ? size - written : chunk;
+
+        /* xorshift, fast enough to not hide disk */
+        for (i = 0; i < chunk; ++i)
+        {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+            buf[i] = (unsigned char)x;
+        }
+
+        if (fwrite(buf, 1, chunk, file) != chunk)
+        {
+            ret = 1;
+            break;
+        }
+    }
+
+    if (fclose(file))
+        ret = 1;
+
+    free(buf);
+
+    return ret;
+}
+
+static int __bench_check(const char *path, size_t size, size_t record_size)
+{
+    const unsigned char *data;
+    struct stat st;
+    size_t i;
+    int fd;
+    int ret = 0;
+
+    fd = open(path, O_RDONLY);
+    if (fd == -1)
+        return 1;
+
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size != size)
+    {
+        close(fd);
+        return 1;
+    }
+
+    data = (const unsigned char *)mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return 1;
+
+    (void)madvise((void *)data, size, MADV_SEQUENTIAL);
+    for (i = record_size; i < size; i += record_size)
+        if (__bench_cmp(data + i - record_size, data + i) > 0)
+        {
+            ret = 1;
+            break;
+        }
+
+    (void)munmap((void *)data, size);
+
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    Extsort_conf conf = {0};
+    Extsort_stats stats;
+    char in_path[PATH_MAX];
+    char out_path[PATH_MAX];
+    const char *dir = NULL;
+    size_t mb = 2048;
+    size_t record_size = 100;
+    size_t size;
+    double t;
+    int opt;
+    int ret = 1;
+
+    while ((opt = getopt(argc, argv, "s:r:m:t:d:")) != -1)
+    {
+        switch (opt)
+        {
+            case 's':
+            {
+                mb = (size_t)strtoul(optarg, NULL, 10);
+                break;
+            }
+            case 'r':
+            {
+                record_size = (size_t)strtoul(optarg, NULL, 10);
+                break;
+            }
+            case 'm':
+            {
+                conf.memory = (size_t)strtoul(optarg, NULL, 10) << 20;
+                break;
+            }
+            case 't':
+            {
+                conf.threads = (size_t)strtoul(optarg, NULL, 10);
+                break;
+            }
+            case 'd':
+            {
+                dir = optarg;
+                break;
+            }
+            default:
+            {
+                (void)fprintf(stderr, "Usage: %s [-s MB] [-r record_size] [-m memory_MB] [-t threads] [-d dir]\n", argv[0]);
+                return 1;
+            }
+        }
+    }
+
+    if (mb == 0 || record_size < BENCH_KEY_SIZE)
+    {
+        (void)fprintf(stderr, "MB has to be > 0 and record_size >= %d\n", BENCH_KEY_SIZE);
+        return 1;
+    }
+
+    if (dir == NULL)
+        dir = getenv("TMPDIR") != NULL ? getenv("TMPDIR") : "/tmp";
+
+    conf.tmp_dir = dir;
+    size = (mb << 20) / record_size * record_size;
+
+    (void)snprintf(in_path, sizeof(in_path), "%s/extsort_bench_in_%d", dir, (int)getpid());
+    (void)snprintf(out_path, sizeof(out_path), "%s/extsort_bench_out_%d", dir, (int)getpid());
+
+    t = __bench_now();
+    if (__bench_generate(in_path, size, record_size))
+    {
+        (void)fprintf(stderr, "Cannot generate %s\n", in_path);
+        goto cleanup;
+    }
+
+    t = __bench_now() - t;
+    (void)printf("generate: %zu MB in %.3lfs, %.2lf MB/s\n", mb, t, (double)mb / t);
+
+    t = __bench_now();
+    if (extsort_file(in_path, out_path, record_size, __bench_cmp, &conf, &stats))
+    {
+        (void)fprintf(stderr, "extsort_file failed\n");
+        goto cleanup;
+    }
+
+    t = __bench_now() - t;
+    (void)printf("sort:     %zu MB in %.3lfs, %.2lf MB/s (records %zu, runs %zu, merge passes %zu, memory %zu MB)\n",
+                 mb, t, (double)mb / t, stats.records, stats.runs, stats.merge_passes, conf.memory >> 20);
+
+    if (__bench_check(out_path, size, record_size))
+    {
+        (void)fprintf(stderr, "Output is not sorted\n");
+        goto cleanup;
+    }
+
+    (void)printf("check:    OK\n");
+    ret = 0;
+
+cleanup:
+    (void)unlink(in_path);
+    (void)unlink(out_path);
+
+    return ret;
+}
@@ -0,0 +1,251 @@
+/*
+    Echo server benchmark on loopback (see reactor.h)
+
+    Server is Reactor_pool (1 reactor per thread, SO_REUSEPORT),
+    client is one reactor in main thread with many connections doing ping-pong:
+    message is sent again when whole echo is received.
+
+    Usage: reactor_echo_bench [-t threads] [-c connections] [-s msg_size] [-d seconds] [-p port]
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+
+    LICENCE: GPL 3.0
+*/
+
+#include <reactor.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <time.h>
+
+typedef struct Bench_client
+{
+    const char  *msg;
+    size_t      msg_size;
+    uint64_t    requests;
+    uint64_t    bytes;
+    size_t      opened;
+    size_t      errors;
+} Bench_client;
+
+/*
+    Server handler, send back everything
+
+    PARAMS
+    @IN conn - pointer to connection
+    @IN arg - NULL
+
+    RETURN
+    This is a void function
+*/
+static void __bench_echo_on_read(Reactor_conn *conn, void *arg);
+
+/*
+    Client handlers, first request / count echo and send next request / count errors
+
+    PARAMS
+    @IN conn - pointer to connection
+    @IN arg - pointer to Bench_client
+
+    RETURN
+    This is a void function
+*/
+static void __bench_client_on_open(Reactor_conn *conn, void *arg);
+static void __bench_client_on_read(Reactor_conn *conn, void *arg);
+static void __bench_client_on_close(Reactor_conn *conn, void *arg);
+
+/*
+    End of benchmark
+
+    PARAMS
+    @IN reactor - client reactor
+    @IN timer - timer
+    @IN arg - NULL
+
+    RETURN
+    This is a void function
+*/
+static void __bench_stop(Reactor *reactor, Reactor_timer *timer, void *arg);
+
+static void __bench_echo_on_read(Reactor_conn *conn, void *arg)
+{
+    const void *data;
+    size_t len;
+
+    (void)arg;
+
+    data = reactor_conn_get_input(conn, &len);
+    if (reactor_conn_write(conn, data, len))
+    {
+        reactor_conn_close(conn);
+        return;
+    }
+
+    (void)reactor_conn_consume(conn, len);
+}
+
+static void __bench_client_on_open(Reactor_conn *conn, void *arg)
+{
+    Bench_client *client = (Bench_client *)arg;
+
+    ++client->opened;
+    (void)reactor_conn_write(conn, client->msg, client->msg_size);
+}
+
+static void __bench_client_on_read(Reactor_conn *conn, void *arg)
+{
+    Bench_client *client = (Bench_client *)arg;
+    size_t len;
+
+    (void)reactor_conn_get_input(conn, &len);
+
+    /* echo can come in many parts, wait for whole message */
+    while (len >= client->msg_size)
+    {
+        (void)reactor_conn_consume(conn, client->msg_size);
+        len -= client->msg_size;
+
+        ++client->requests;
+        client->bytes += client->msg_size;
+
+        (void)reactor_conn_write(conn, client->msg, client->msg_size);
+    }
+}
+
+static void __bench_client_on_close(Reactor_conn *conn, void *arg)
+{
+    Bench_client *client = (Bench_client *)arg;
+
+    (void)conn;
+
+    ++client->errors;
+}
+
+static void __bench_stop(Reactor *reactor, Reactor_timer *timer, void *arg)
+{
+    (void)timer;
+    (void)arg;
+
+    reactor_stop(reactor);
+}
+
+int main(int argc, char **argv)
+{
+    Reactor_handlers server = { .on_read = __bench_echo_on_read };
+    Reactor_handlers handlers = { .on_open = __bench_client_on_open, .on_read = __bench_client_on_read, .on_close = __bench_client_on_close };
+    Bench_client client = {0};
+    Reactor_pool *pool;
+    Reactor *reactor;
+    struct timespec start;
+    struct timespec end;
+    char *msg;
+    size_t threads = 1;
+    size_t conns = 64;
+    size_t msg_size = 64;
+    unsigned seconds = 5;
+    int port = 9876;
+    size_t i;
+    double sec;
+    int opt;
+    int ret = 1;
+
+    while ((opt = getopt(argc, argv, "t:c:s:d:p:")) != -1)
+    {
+        switch (opt)
+        {
+            case 't':
+            {
+                threads = (size_t)strtoul(optarg, NULL, 10);
+                break;
+            }
+            case 'c':
+            {
+                conns = (size_t)strtoul(optarg, NULL, 10);
+                break;
+            }
+            case 's':
+            {
+                msg_size = (size_t)strtoul(optarg, NULL, 10);
+                break;
+            }
+            case 'd':
+            {
+                seconds = (unsigned)strtoul(optarg, NULL, 10);
+                break;
+            }
+            case 'p':
+            {
+                port = atoi(optarg);
+                break;
+            }
+            default:
+            {
+                (void)fprintf(stderr, "Usage: %s [-t threads] [-c connections] [-s msg_size] [-d seconds] [-p port]\n", argv[0]);
+                return 1;
+            }
+        }
+    }
+
+    if (threads == 0 || conns == 0 || msg_size == 0 || seconds == 0)
+    {
+        (void)fprintf(stderr, "threads, connections, msg_size and seconds have to be > 0\n");
+        return 1;
+    }
+
+    msg = (char *)malloc(msg_size);
+    if (msg == NULL)
+        return 1;
+
+    (void)memset(msg, 'K', msg_size);
+    client.msg = msg;
+    client.msg_size = msg_size;
+    handlers.arg = (void *)&client;
+
+    pool = reactor_pool_create(threads);
+    if (pool == NULL || reactor_pool_listen(pool, "localhost", port, &server) || reactor_pool_start(pool))
+    {
+        (void)fprintf(stderr, "Cannot start server on localhost:%d\n", port);
+        goto free_pool;
+    }
+
+    reactor = reactor_create();
+    if (reactor == NULL)
+        goto free_pool;
+
+    for (i = 0; i < conns; ++i)
+        if (reactor_connect(reactor, "localhost", port, &handlers) == NULL)
+        {
+            (void)fprintf(stderr, "Cannot connect to localhost:%d\n", port);
+            goto free_reactor;
+        }
+
+    if (reactor_timer_add(reactor, (uint64_t)seconds * 1000, 0, __bench_stop, NULL) == NULL)
+        goto free_reactor;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &start);
+    if (reactor_run(reactor))
+        goto free_reactor;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &end);
+    sec = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+
+    (void)printf("threads = %zu connections = %zu (opened %zu, closed %zu) msg_size = %zu\n",
+                 threads, conns, client.opened, client.errors, msg_size);
+    (void)printf("requests = %" PRIu64 " time = %.3lfs\n", client.requests, sec);
+    (void)printf("%.0lf requests/s %.2lf MB/s\n", (double)client.requests / sec, (double)client.bytes / sec / (1 << 20));
+
+    ret = 0;
+
+free_reactor:
+    reactor_destroy(reactor);
+
+free_pool:
+    reactor_pool_destroy(pool);
+    free(msg);
+
+    return ret;
+}
@@ -0,0 +1,57 @@
+/*
+    Sort tuning tool (see sort.h)
+
+    Calibrates sort thresholds on this machine for every size class
+    and saves table to file (or prints it to stdout).
+    Saved file is loaded before main when SORT_TUNING env points to it,
+    or can be loaded by sort_tuning_load.
+
+    Usage: sort_tune [file]
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+
+    LICENCE: GPL 3.0
+*/
+
+#include <sort.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+int main(int argc, char **argv)
+{
+    Sort_tuning tuning;
+    size_t size_of;
+
+    if (argc > 2)
+    {
+        (void)fprintf(stderr, "Usage: %s [file]\n", argv[0]);
+        return 1;
+    }
+
+    srand((unsigned)time(NULL));
+
+    if (sort_calibrate())
+    {
+        (void)fprintf(stderr, "Calibration failed\n");
+        return 1;
+    }
+
+    if (argc == 2)
+    {
+        if (sort_tuning_save(argv[1]))
+        {
+            (void)fprintf(stderr, "Cannot save tuning to %s\n", argv[1]);
+            return 1;
+        }
+
+        return 0;
+    }
+
+    (void)printf("# size_of insort_threshold binsort_threshold indirect\n");
+    for (size_of = 4; sort_tuning_get(size_of, &tuning) == 0 && tuning.size_of == size_of; size_of <<= 1)
+        (void)printf("%zu %zu %zu %d\n", tuning.size_of, tuning.insort_threshold, tuning.binsort_threshold, (int)tuning.indirect);
+
+    return 0;
+}
@@ -0,0 +1,363 @@
+/*
+    TLS benchmark on loopback (see tls.h)
+
+    Measures handshakes/s for full and resumed handshakes
+    and bulk throughput of SSL_write and tls_sendfile (kTLS iff available).
+    Server is a thread with blocking sockets, client is main thread.
+
+    Usage: tls_bench cert.pem key.pem [-n handshakes] [-s MB] [-p port]
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+
+    LICENCE: GPL 3.0
+*/
+
+#include <tls.h>
+#include <tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/socket.h>
+
+#define BENCH_CHUNK (1 << 14)
+
+typedef struct Bench_server
+{
+    SSL_CTX *ctx;
+    int     socket;
+    size_t  connections; /* to accept */
+    size_t  failed;
+} Bench_server;
+
+/*
+    Server thread, accept connections, read until close_notify
+
+    PARAMS
+    @IN arg - pointer to Bench_server
+
+    RETURN
+    NULL
+*/
+static void *__bench_server(void *arg);
+
+/*
+    Get time from CLOCK_MONOTONIC in seconds
+
+    PARAMS
+    NO PARAMS
+
+    RETURN
+    Time in seconds
+*/
+static double __bench_now(void);
+
+/*
+    Make n connections, resume session iff resume is true
+
+    PARAMS
+    @IN ctx - client context
+    @IN port - port
+    @IN n - number of connections
+    @IN resume - resume session of previous connection
+
+    RETURN
+    Number of resumed connections iff success
+    -1 iff failure
+*/
+static ssize_t __bench_handshakes(SSL_CTX *ctx, int port, size_t n, bool resume);
+
+/*
+    Send size bytes by SSL_write or tls_sendfile
+
+    PARAMS
+    @IN ctx - client context
+    @IN port - port
+    @IN fd - file with at least size bytes
+    @IN size - number of bytes
+    @IN sendfile - use tls_sendfile
+    @OUT ktls - kTLS was used
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+static int __bench_bulk(SSL_CTX *ctx, int port, int fd, size_t size, bool sendfile, bool *ktls);
+
+static void *__bench_server(void *arg)
+{
+    Bench_server *server = (Bench_server *)arg;
+    char buf[BENCH_CHUNK];
+    SSL *ssl;
+    size_t i;
+    int fd;
+
+    for (i = 0; i < server->connections; ++i)
+    {
+        fd = accept(server->socket, NULL, NULL);
+        if (fd == -1)
+        {
+            ++server->failed;
+            continue;
+        }
+
+        ssl = tls_accept(server->ctx, fd);
+        if (ssl == NULL)
+        {
+            ++server->failed;
+            close(fd);
+            continue;
+        }
+
+        while (SSL_read(ssl, buf, sizeof(buf)) > 0)
+            ;
+
+        (void)tls_shutdown(ssl);
+        tls_ssl_destroy(ssl);
+        close(fd);
+    }
+
+    return NULL;
+}
+
+static double __bench_now(void)
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static ssize_t __bench_handshakes(SSL_CTX *ctx, int port, size_t n, bool resume)
+{
+    SSL_SESSION *session = NULL;
+    SSL *ssl;
+    char c;
+    size_t i;
+    ssize_t reused = 0;
+    int fd;
+
+    for (i = 0; i < n; ++i)
+    {
+        fd = tcp_request_connection("localhost", port);
+        if (fd == -1)
+            return -1;
+
+        ssl = tls_request_connection_with_session(ctx, fd, session);
+        if (ssl == NULL)
+        {
+            close(fd);
+            return -1;
+        }
+
+        reused += tls_session_reused(ssl);
+
+        /* close_notify, then wait for server close_notify (tickets are read on the way) */
+        (void)tls_shutdown(ssl);
+        (void)SSL_read(ssl, &c, 1);
+
+        if (resume)
+        {
+            tls_session_destroy(session);
+            session = tls_get_session(ssl);
+        }
+
+        tls_ssl_destroy(ssl);
+        close(fd);
+    }
+
+    tls_session_destroy(session);
+
+    return reused;
+}
+
+static int __bench_bulk(SSL_CTX *ctx, int port, int fd, size_t size, bool sendfile, bool *ktls)
+{
+    char buf[BENCH_CHUNK];
+    SSL *ssl;
+    size_t sent;
+    char c;
+    int socket;
+
+    (void)memset(buf, 'K', sizeof(buf));
+
+    socket = tcp_request_connection("localhost", port);
+    if (socket == -1)
+        return 1;
+
+    ssl = tls_request_connection(ctx, socket);
+    if (ssl == NULL)
+    {
+        close(socket);
+        return 1;
+    }
+
+    *ktls = tls_ktls_send_enabled(ssl);
+    if (sendfile)
+        sent = (size_t)tls_sendfile(ssl, fd, 0, size);
+    else
+        for (sent = 0; sent < size; sent += sizeof(buf))
+            if (SSL_write(ssl, buf, sizeof(buf)) <= 0)
+                break;
+
+    (void)tls_shutdown(ssl);
+    (void)SSL_read(ssl, &c, 1);
+
+    tls_ssl_destroy(ssl);
+    close(socket);
+
+    return sent < size;
+}
+
+int main(int argc, char **argv)
+{
+    Bench_server server = { .socket = -1 };
+    SSL_CTX *client_ctx = NULL;
+    pthread_t thread;
+    char path[] = "/tmp/tls_bench_XXXXXX";
+    char buf[BENCH_CHUNK];
+    const char *cert;
+    const char *key;
+    size_t handshakes = 1000;
+    size_t mb = 256;
+    size_t i;
+    int port = 9443;
+    int opt;
+    int fd = -1;
+    int ret = 1;
+    ssize_t reused;
+    double t;
+    bool ktls = false;
+
+    while ((opt = getopt(argc, argv, "n:s:p:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':
+            {
+                handshakes = (size_t)strtoul(optarg, NULL, 10);
+                break;
+            }
+            case 's':
+            {
+                mb = (size_t)strtoul(optarg, NULL, 10);
+                break;
+            }
+            case 'p':
+            {
+                port = atoi(optarg);
+                break;
+            }
+            default:
+            {
+                (void)fprintf(stderr, "Usage: %s cert.pem key.pem [-n handshakes] [-s MB] [-p port]\n", argv[0]);
+                return 1;
+            }
+        }
+    }
+
+    if (argc - optind != 2 || handshakes == 0 || mb == 0)
+    {
+        (void)fprintf(stderr, "Usage: %s cert.pem key.pem [-n handshakes] [-s MB] [-p port]\n", argv[0]);
+        return 1;
+    }
+
+    cert = argv[optind];
+    key = argv[optind + 1];
+
+    tls_once_init();
+    tls_init();
+
+    server.ctx = tls_server_context_create(cert, key, NULL);
+    client_ctx = tls_client_context_create(cert, key, NULL);
+    if (server.ctx == NULL || client_ctx == NULL)
+    {
+        (void)fprintf(stderr, "Cannot create contexts from %s and %s\n", cert, key);
+        goto cleanup;
+    }
+
+    /* bench measures protocol, not certificate chain */
+    SSL_CTX_set_verify(server.ctx, SSL_VERIFY_NONE, NULL);
+    SSL_CTX_set_verify(client_ctx, SSL_VERIFY_NONE, NULL);
+    (void)tls_context_enable_ktls(server.ctx);
+    (void)tls_context_enable_ktls(client_ctx);
+
+    /* file for tls_sendfile */
+    fd = mkstemp(path);
+    if (fd == -1)
+        goto cleanup;
+
+    (void)unlink(path);
+    (void)memset(buf, 'K', sizeof(buf));
+    for (i = 0; i < mb * (1 << 20) / sizeof(buf); ++i)
+        if (write(fd, buf, sizeof(buf)) != (ssize_t)sizeof(buf))
+            goto cleanup;
+
+    server.socket = tcp_socket_create_with_flags("localhost", port, TCP_SOCKET_REUSEADDR);
+    if (server.socket == -1 || listen(server.socket, SOMAXCONN) == -1)
+    {
+        (void)fprintf(stderr, "Cannot listen on localhost:%d\n", port);
+        goto cleanup;
+    }
+
+    server.connections = 2 * handshakes + 2;
+    if (pthread_create(&thread, NULL, __bench_server, (void *)&server))
+        goto cleanup;
+
+    t = __bench_now();
+    reused = __bench_handshakes(client_ctx, port, handshakes, false);
+    t = __bench_now() - t;
+    if (reused == -1)
+    {
+        /* server thread waits in accept, it's killed with process */
+        (void)fprintf(stderr, "Handshake failed\n");
+        goto cleanup;
+    }
+
+    (void)printf("full handshakes:    %zu in %.3lfs, %.0lf handshakes/s (resumed %zd)\n", handshakes, t, (double)handshakes / t, reused);
+
+    t = __bench_now();
+    reused = __bench_handshakes(client_ctx, port, handshakes, true);
+    t = __bench_now() - t;
+    if (reused == -1)
+    {
+        (void)fprintf(stderr, "Handshake failed\n");
+        goto cleanup;
+    }
+
+    (void)printf("resumed handshakes: %zu in %.3lfs, %.0lf handshakes/s (resumed %zd)\n", handshakes, t, (double)handshakes / t, reused);
+
+    t = __bench_now();
+    if (__bench_bulk(client_ctx, port, fd, mb * (1 << 20), false, &ktls))
+        (void)fprintf(stderr, "SSL_write bulk failed\n");
+    t = __bench_now() - t;
+    (void)printf("SSL_write:    %zu MB in %.3lfs, %.2lf MB/s (kTLS %d)\n", mb, t, (double)mb / t, ktls);
+
+    t = __bench_now();
+    if (__bench_bulk(client_ctx, port, fd, mb * (1 << 20), true, &ktls))
+        (void)fprintf(stderr, "tls_sendfile bulk failed\n");
+    t = __bench_now() - t;
+    (void)printf("tls_sendfile: %zu MB in %.3lfs, %.2lf MB/s (kTLS %d)\n", mb, t, (double)mb / t, ktls);
+
+    (void)pthread_join(thread, NULL);
+    ret = server.failed != 0;
+
+cleanup:
+    if (fd != -1)
+        close(fd);
+
+    if (server.socket != -1)
+        tcp_socket_destroy(server.socket);
+
+    tls_context_destroy(client_ctx);
+    tls_context_destroy(server.ctx);
+    tls_clenup();
+    tls_once_cleanup();
+
+    return ret;
+}
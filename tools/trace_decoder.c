@@ -0,0 +1,370 @@
+/*
+    Decoder of binary trace file (TRACE_MODE_BINARY, see log.h)
+
+    Usage: trace_decoder [-j] trace_file
+    -j - print Chrome trace-event JSON (chrome://tracing, Perfetto) instead of text
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+
+    LICENCE: GPL 3.0
+*/
+
+#include <log.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+
+typedef struct Trace_site
+{
+    const char  *file;
+    const char  *func;
+    uint32_t    line;
+    uint16_t    file_len;
+    uint16_t    func_len;
+} Trace_site;
+
+/*
+    Read whole file to memory
+
+    PARAMS
+    @IN path - path to file
+    @OUT size - size of file
+
+    RETURN
+    NULL iff failure
+    Pointer to buffer iff success
+*/
+static char *__trace_read_file(const char *path, size_t *size);
+
+/*
+    Parse site table
+
+    PARAMS
+    @IN buf - trace file
+    @IN size - size of trace file
+    @IN header - trace header
+    @OUT sites - array of num_sites sites
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+static int __trace_parse_sites(const char *buf, size_t size, const Log_trace_header *header, Trace_site *sites);
+
+/*
+    Collect records from all chunks
+
+    PARAMS
+    @IN buf - trace file
+    @IN size - size of trace file
+    @IN header - trace header
+    @OUT num - number of records
+
+    RETURN
+    NULL iff failure or there is no records
+    Array of records iff success
+*/
+static Log_trace_record *__trace_collect(const char *buf, size_t size, const Log_trace_header *header, size_t *num);
+
+/*
+    Compare records by timestamp, then by thread id
+
+    PARAMS
+    @IN a - record
+    @IN b - record
+
+    RETURN
+    -1 iff a < b
+    0 iff a == b
+    1 iff a > b
+*/
+static int __trace_record_cmp(const void *a, const void *b);
+
+/*
+    Print string as JSON string (with quotes)
+
+    PARAMS
+    @IN out - output
+    @IN str - string
+    @IN len - length of string
+
+    RETURN
+    This is a void function
+*/
+static void __trace_json_string(FILE *out, const char *str, size_t len);
+
+/*
+    Get file name from path
+
+    PARAMS
+    @IN site - site
+    @OUT len - length of file name
+
+    RETURN
+    Pointer to file name
+*/
+static const char *__trace_file_name(const Trace_site *site, size_t *len);
+
+static char *__trace_read_file(const char *path, size_t *size)
+{
+    FILE *file;
+    char *buf;
+    long len;
+
+    file = fopen(path, "rb");
+    if (file == NULL)
+        return NULL;
+
+    if (fseek(file, 0, SEEK_END) || (len = ftell(file)) < 0 || fseek(file, 0, SEEK_SET))
+    {
+        (void)fclose(file);
+        return NULL;
+    }
+
+    buf = (char *)malloc((size_t)len + 1);
+    if (buf == NULL)
+    {
+        (void)fclose(file);
+        return NULL;
+    }
+
+    if (fread(buf, 1, (size_t)len, file) != (size_t)len)
+    {
+        free(buf);
+        (void)fclose(file);
+        return NULL;
+    }
+
+    (void)fclose(file);
+    *size = (size_t)len;
+
+    return buf;
+}
+
+static int __trace_parse_sites(const char *buf, size_t size, const Log_trace_header *header, Trace_site *sites)
+{
+    Log_trace_site_entry entry;
+    size_t offset = sizeof(Log_trace_header);
+    uint32_t i;
+
+    for (i = 0; i < header->num_sites; ++i)
+    {
+        if (offset + sizeof(entry) > header->data_offset)
+            return 1;
+
+        (void)memcpy(&entry, buf + offset, sizeof(entry));
+        offset += sizeof(entry);
+
+        if (offset + entry.file_len + entry.func_len > header->data_offset)
+            return 1;
+
+        sites[i].line = entry.line;
+        sites[i].file_len = entry.file_len;
+        sites[i].func_len = entry.func_len;
+        sites[i].file = buf + offset;
+        sites[i].func = buf + offset + entry.file_len;
+
+        offset += entry.file_len + entry.func_len;
+        offset = (offset + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1);
+    }
+
+    (void)size;
+
+    return 0;
+}
+
+static Log_trace_record *__trace_collect(const char *buf, size_t size, const Log_trace_header *header, size_t *num)
+{
+    Log_trace_record *records = NULL;
+    Log_trace_record *temp;
+    Log_trace_record rec;
+    size_t allocated = 0;
+    size_t len = 0;
+    size_t offset;
+    size_t end;
+    size_t pos;
+
+    for (offset = header->data_offset; offset < size; offset += header->chunk_size)
+    {
+        /* last chunk can be cut when process has been killed */
+        end = offset + header->chunk_size < size ? offset + header->chunk_size : size;
+        for (pos = offset; pos + sizeof(rec) <= end; pos += sizeof(rec))
+        {
+            (void)memcpy(&rec, buf + pos, sizeof(rec));
+            if (rec.ts == 0)
+                break;
+
+            if (rec.site >= header->num_sites)
+                continue;
+
+            if (len == allocated)
+            {
+                allocated = allocated == 0 ? 1024 : allocated * 2;
+                temp = (Log_trace_record *)realloc(records, allocated * sizeof(*records));
+                if (temp == NULL)
+                {
+                    free(records);
+                    return NULL;
+                }
+
+                records = temp;
+            }
+
+            records[len++] = rec;
+        }
+    }
+
+    *num = len;
+
+    return records;
+}
+
+static int __trace_record_cmp(const void *a, const void *b)
+{
+    const Log_trace_record *r1 = (const Log_trace_record *)a;
+    const Log_trace_record *r2 = (const Log_trace_record *)b;
+
+    if (r1->ts != r2->ts)
+        return r1->ts < r2->ts ? -1 : 1;
+
+    if (r1->tid != r2->tid)
+        return r1->tid < r2->tid ? -1 : 1;
+
+    return 0;
+}
+
+static void __trace_json_string(FILE *out, const char *str, size_t len)
+{
+    size_t i;
+
+    (void)fputc('"', out);
+    for (i = 0; i < len; ++i)
+    {
+        if (str[i] == '"' || str[i] == '\\')
+            (void)fputc('\\', out);
+
+        if ((unsigned char)str[i] < 0x20)
+            (void)fprintf(out, "\\u%04x", (unsigned)(unsigned char)str[i]);
+        else
+            (void)fputc(str[i], out);
+    }
+
+    (void)fputc('"', out);
+}
+
+static const char *__trace_file_name(const Trace_site *site, size_t *len)
+{
+    size_t i = site->file_len;
+
+    while (i > 0 && site->file[i - 1] != '/')
+        --i;
+
+    *len = site->file_len - i;
+
+    return site->file + i;
+}
+
+int main(int argc, char **argv)
+{
+    Log_trace_header header;
+    Log_trace_record *records = NULL;
+    Trace_site *sites;
+    const Trace_site *site;
+    const char *path;
+    const char *file;
+    char *buf;
+    size_t size;
+    size_t num = 0;
+    size_t file_len;
+    size_t i;
+    double us;
+    int json = 0;
+
+    if (argc == 3 && strcmp(argv[1], "-j") == 0)
+    {
+        json = 1;
+        path = argv[2];
+    }
+    else if (argc == 2)
+        path = argv[1];
+    else
+    {
+        (void)fprintf(stderr, "Usage: %s [-j] trace_file\n", argv[0]);
+        return 1;
+    }
+
+    buf = __trace_read_file(path, &size);
+    if (buf == NULL)
+    {
+        (void)fprintf(stderr, "Cannot read %s\n", path);
+        return 1;
+    }
+
+    if (size < sizeof(header))
+    {
+        (void)fprintf(stderr, "%s is not a trace file\n", path);
+        free(buf);
+        return 1;
+    }
+
+    (void)memcpy(&header, buf, sizeof(header));
+    if (memcmp(header.magic, LOG_TRACE_MAGIC, sizeof(LOG_TRACE_MAGIC)) != 0 ||
+        header.version != LOG_TRACE_VERSION ||
+        header.data_offset > size ||
+        header.chunk_size == 0 ||
+        header.chunk_size % sizeof(Log_trace_record) != 0 ||
+        header.ticks_per_sec == 0)
+    {
+        (void)fprintf(stderr, "%s is not a trace file or is corrupted\n", path);
+        free(buf);
+        return 1;
+    }
+
+    sites = (Trace_site *)malloc(sizeof(Trace_site) * (header.num_sites + 1));
+    if (sites == NULL || __trace_parse_sites(buf, size, &header, sites))
+    {
+        (void)fprintf(stderr, "Cannot parse sites\n");
+        free(sites);
+        free(buf);
+        return 1;
+    }
+
+    records = __trace_collect(buf, size, &header, &num);
+    if (num > 0)
+        qsort(records, num, sizeof(*records), __trace_record_cmp);
+
+    if (json)
+        (void)printf("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+    for (i = 0; i < num; ++i)
+    {
+        site = &sites[records[i].site];
+        file = __trace_file_name(site, &file_len);
+        us = (double)(records[i].ts - records[0].ts) * 1e6 / (double)header.ticks_per_sec;
+
+        if (json)
+        {
+            (void)printf("{\"name\":");
+            __trace_json_string(stdout, site->func, site->func_len);
+            (void)printf(",\"cat\":");
+            __trace_json_string(stdout, file, file_len);
+            (void)printf(",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":%" PRIu64 ",\"tid\":%" PRIu32 ",\"args\":{\"line\":%" PRIu32 "}}%s\n",
+                         us, header.pid, records[i].tid, site->line, i + 1 < num ? "," : "");
+        }
+        else
+            (void)printf("[TRACE]\t%.3f us\t%" PRIu32 "\t%.*s:%.*s.%" PRIu32 "\n",
+                         us, records[i].tid, (int)file_len, file, (int)site->func_len, site->func, site->line);
+    }
+
+    if (json)
+        (void)printf("]}\n");
+
+    free(records);
+    free(sites);
+    free(buf);
+
+    return 0;
+}